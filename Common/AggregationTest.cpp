@@ -0,0 +1,302 @@
+#include "FeedbackAggregator.h"
+#include "FeedbackProcessor.h"
+#include "TileStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// The checks of FeedbackAggregator: RAW passes feedback through, hysteresis holds a flickering
+// region steady, promotes follow finer feedback and minResidentUpdates holds them. Then
+// SamplerFeedback's former --bench=aggregation replays a feedback trace through the aggregator,
+// FeedbackProcessor and TileStreamer once per policy, where hysteresis has to reload less than raw
+// feedback does. With a path argument it replays a trace the app recorded with --trace=<file>,
+// otherwise a synthetic one. Exits nonzero if any of them fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static void TestRaw() {
+    const uint32_t width = 16, height = 8, pitch = 32;
+    const uint8_t  coarsest = 7;
+
+    FeedbackAggregator aggregator;
+    aggregator.Init(width, height, coarsest, FeedbackAggregator::RAW);
+
+    std::mt19937                       rng(5);
+    std::uniform_int_distribution<int> mip(0, 9);
+    std::vector<uint8_t>               feedback(pitch * height);
+
+    bool same = true;
+
+    for (uint32_t update = 0; update < 50; ++update) {
+        for (auto& wanted : feedback) {
+            wanted = mip(rng) == 9 ? 0xFF : uint8_t(mip(rng));
+        }
+
+        const uint8_t* pTargets = aggregator.Update(feedback.data(), pitch);
+
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x) {
+                same &= pTargets[y * width + x] == (std::min)(feedback[y * pitch + x], coarsest);
+            }
+        }
+    }
+
+    Check(same, "raw: targets are the feedback, clamped to the packed tail");
+}
+
+// one region, fed a sequence; returns the target after every update
+static std::vector<uint8_t> Drive(const FeedbackAggregator::Policy& policy, const std::vector<uint8_t>& wanted) {
+    FeedbackAggregator aggregator;
+    aggregator.Init(1, 1, 7, policy);
+
+    std::vector<uint8_t> targets;
+
+    for (uint8_t mip : wanted) {
+        targets.push_back(*aggregator.Update(&mip, 1));
+    }
+
+    return targets;
+}
+
+static uint32_t Changes(const std::vector<uint8_t>& targets, size_t from) {
+    uint32_t changes = 0;
+
+    for (size_t i = from + 1; i < targets.size(); ++i) {
+        changes += targets[i] != targets[i - 1] ? 1 : 0;
+    }
+
+    return changes;
+}
+
+static void TestHysteresis() {
+    const auto policy = FeedbackAggregator::HYSTERESIS;
+
+    // settles on 2, then flickers between 2 and 3 like a dithered feedback pattern
+    std::vector<uint8_t> flicker(40, 2);
+
+    for (uint32_t i = 0; i < 200; ++i) {
+        flicker.push_back(i % 2 == 0 ? 3 : 2);
+    }
+
+    Check(Changes(Drive(FeedbackAggregator::RAW, flicker), 40) == 199, "hysteresis: raw feedback follows every flicker");
+    Check(Changes(Drive(policy, flicker), 40) == 0, "hysteresis: the target holds steady under flicker");
+
+    // from nothing sampled to mip 0: the target gets there, one promote at a time or at once
+    std::vector<uint8_t> finer(20, 0);
+    std::vector<uint8_t> promoted = Drive(policy, finer);
+
+    auto reached = std::find(promoted.begin(), promoted.end(), uint8_t(0));
+
+    Check(reached != promoted.end() && reached - promoted.begin() < 12, "hysteresis: finer feedback promotes the target");
+    Check(std::is_sorted(promoted.rbegin(), promoted.rend()), "hysteresis: the target only gets finer while feedback asks for finer");
+
+    // mip 0, then nothing sampled any more: the target stays minResidentUpdates after its last promote
+    std::vector<uint8_t> away(20, 0);
+    away.insert(away.end(), 100, 0xFF);
+
+    std::vector<uint8_t> held = Drive(policy, away);
+
+    size_t lastPromote = reached - promoted.begin();
+    size_t firstDemote = 20;
+
+    while (firstDemote < held.size() && held[firstDemote] == 0) {
+        ++firstDemote;
+    }
+
+    Check(firstDemote >= lastPromote + policy.minResidentUpdates, "hysteresis: a promoted target stays minResidentUpdates");
+    Check(firstDemote < held.size() && held.back() == 7, "hysteresis: then it falls back to the packed tail");
+}
+
+struct Replay
+{
+    uint64_t loads    = 0;
+    uint64_t reloads  = 0;
+    double   missRate = 0.0;
+};
+
+static Replay RunReplay(const char* pName, const FeedbackAggregator::Policy& policy, const FeedbackTrace::Header& header,
+                        const std::vector<uint8_t>& maps) {
+    const uint32_t regionsX  = header.regionsX;
+    const uint32_t regionsY  = header.regionsY;
+    const uint8_t  coarsest  = uint8_t(header.standardMips);
+    const size_t   mapSize   = size_t(regionsX) * regionsY;
+    const size_t   updates   = maps.size() / mapSize;
+    const uint32_t poolTiles = (std::max)(uint32_t(mapSize / 2), 16u);
+
+    uint64_t currentUpdate = 0;
+    uint64_t fence         = 0;
+    uint64_t reloads       = 0;
+
+    std::deque<std::pair<uint64_t, uint64_t>> submitted;                // fence value, update
+    std::vector<bool>                         everLoaded(mapSize * 2, false);
+
+    FeedbackAggregator aggregator;
+    FeedbackProcessor  processor;
+    TileStreamer       streamer;
+
+    aggregator.Init(regionsX, regionsY, coarsest, policy);
+
+    streamer.Init({ regionsX, regionsY, header.standardMips, poolTiles, 0, { 0, 16, 0 } }, {
+        .upload = [&](const TileCoord& tile) {
+            // tiles of all standard mips fit in twice the mip 0 count
+            size_t id = 0;
+
+            for (uint32_t mip = 0; mip < tile.mip; ++mip) {
+                id += size_t((std::max)(regionsX >> mip, 1u)) * (std::max)(regionsY >> mip, 1u);
+            }
+
+            id += size_t(tile.y) * (std::max)(regionsX >> tile.mip, 1u) + tile.x;
+
+            reloads       += everLoaded[id] ? 1 : 0;
+            everLoaded[id] = true;
+
+            return true;
+        },
+        .submit = [&](const TileMapping*, uint32_t, bool) {
+            submitted.push_back({ ++fence, currentUpdate });
+            return fence;
+        },
+        .completedValue = [&]() {
+            uint64_t completed = 0;
+
+            for (auto& [value, at] : submitted) {
+                if (at + 2 <= currentUpdate) {
+                    completed = value;
+                }
+            }
+
+            return completed;
+        }
+    });
+
+    uint64_t sampled = 0;
+    uint64_t missed  = 0;
+
+    for (size_t i = 0; i < updates; ++i) {
+        currentUpdate = i;
+
+        const uint8_t* pRaw      = maps.data() + i * mapSize;
+        const uint8_t* pResident = streamer.GetResidency();
+
+        for (size_t r = 0; r < mapSize; ++r) {
+            if (pRaw[r] != 0xFF) {
+                sampled += 1;
+                missed  += pResident[r] > (std::min)(pRaw[r], coarsest) ? 1 : 0;
+            }
+        }
+
+        const uint8_t* pTargets = aggregator.Update(pRaw, regionsX);
+
+        processor.Begin();
+        processor.Process(0, pTargets, regionsX, pResident, regionsX, regionsY, streamer.GetCoarsestMip());
+
+        streamer.Update(pTargets, regionsX, processor.Finish());
+    }
+
+    const auto& stats = streamer.GetStats();
+
+    Replay result = {
+        .loads    = stats.loads,
+        .reloads  = reloads,
+        .missRate = double(missed) / (std::max)(sampled, uint64_t(1))
+    };
+
+    std::cout << "  " << pName << ": " << (stats.loads * uint64_t(TileStreamer::TILE_SIZE)) / (1024 * 1024) << " MB loaded ("
+              << stats.loads << " tiles, " << reloads << " reloads), " << stats.evictions << " evictions, miss rate "
+              << 100.0 * result.missRate << "%" << std::endl;
+
+    return result;
+}
+
+//
+// The synthetic trace: an 8K texture on an object scaling with sin(t) like SamplerFeedback's
+// pyramid, one mip coarser towards the bottom and a +-half mip of per-region flicker as a dithered
+// feedback pattern would show it.
+//
+static void SyntheticTrace(FeedbackTrace::Header& header, std::vector<uint8_t>& maps) {
+    header = { FeedbackTrace::MAGIC, 64, 64, 7 };
+
+    std::mt19937                          rng(11);
+    std::uniform_real_distribution<float> flicker(-0.5f, 0.5f);
+
+    const uint32_t updates = 1200;
+
+    maps.resize(size_t(updates) * header.regionsX * header.regionsY);
+
+    for (uint32_t i = 0; i < updates; ++i) {
+        float t     = i / 60.0f;
+        float scale = (sinf(t) * 0.5f) + 0.5f;
+        float base  = log2f(1.0f / (std::max)(scale, 1.0f / 64.0f));    // mip 0 at full size
+
+        uint8_t* pMap = maps.data() + size_t(i) * header.regionsX * header.regionsY;
+
+        for (uint32_t y = 0; y < header.regionsY; ++y) {
+            for (uint32_t x = 0; x < header.regionsX; ++x) {
+                float wanted = base + float(y) / header.regionsY + flicker(rng);
+
+                pMap[y * header.regionsX + x] = uint8_t((std::min)((std::max)(wanted, 0.0f), float(header.standardMips - 1)) + 0.5f);
+            }
+        }
+    }
+}
+
+static void TestReplay(const std::string& tracePath) {
+    FeedbackTrace::Header header = {};
+    std::vector<uint8_t>  maps;
+
+    if (!tracePath.empty()) {
+        if (!FeedbackTrace::Load(tracePath, header, maps)) {
+            Check(false, "replay: the trace loads");
+            return;
+        }
+    }
+    else {
+        SyntheticTrace(header, maps);
+    }
+
+    std::cout << "replay: " << (tracePath.empty() ? "synthetic trace" : tracePath) << ", " << header.regionsX << " x "
+              << header.regionsY << " regions, " << header.standardMips << " standard mips, "
+              << maps.size() / (size_t(header.regionsX) * header.regionsY) << " updates" << std::endl;
+
+    Replay raw        = RunReplay("raw", FeedbackAggregator::RAW, header, maps);
+    RunReplay("history", { 0.25f, 0.0f, 0.0f, 0 }, header, maps);
+    Replay hysteresis = RunReplay("history + hysteresis", { 0.25f, 0.5f, 0.75f, 0 }, header, maps);
+    Replay minTime    = RunReplay("hysteresis + min time", FeedbackAggregator::HYSTERESIS, header, maps);
+
+    // a recorded trace need not flicker, only the synthetic one is known to
+    if (!tracePath.empty()) {
+        return;
+    }
+
+    Check(hysteresis.reloads < raw.reloads && minTime.reloads < raw.reloads, "replay: hysteresis reloads less than raw feedback");
+    Check(minTime.loads < raw.loads, "replay: hysteresis loads less than raw feedback");
+    Check(minTime.missRate < 0.25, "replay: hysteresis still keeps up with what is sampled");
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "FeedbackAggregator" << std::endl;
+
+    TestRaw();
+    TestHysteresis();
+    TestReplay(argc > 1 ? argv[1] : "");
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
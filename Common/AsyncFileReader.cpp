@@ -0,0 +1,705 @@
+#include "AsyncFileReader.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+// timed waits need IORING_ENTER_EXT_ARG; older headers and kernels get the threads
+#if defined(IORING_FEAT_EXT_ARG)
+#define ASYNC_FILE_READER_URING 1
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+struct AsyncFileReader::Request
+{
+#ifdef _WIN32
+    OVERLAPPED                            overlapped = {};     // completion packets map back through it
+#elif defined(ASYNC_FILE_READER_URING)
+    iovec                                 vector     = {};     // IORING_OP_READV reads through it
+#endif
+    intptr_t                              handle     = -1;
+    bool                                  threaded   = false;
+    uint8_t*                              pDst       = nullptr;
+    uint64_t                              size       = 0;
+    uint64_t                              padding    = 0;      // pDst bytes before the data, direct reads
+    uint64_t                              readOffset = 0;
+    uint64_t                              readSize   = 0;
+    Callback                              callback;
+    std::chrono::steady_clock::time_point submitTime;
+};
+
+#ifdef ASYNC_FILE_READER_URING
+struct AsyncFileReader::Ring
+{
+    int           fd        = -1;
+    void*         pSqMap    = nullptr;
+    size_t        sqMapSize = 0;
+    void*         pCqMap    = nullptr;      // pSqMap with IORING_FEAT_SINGLE_MMAP
+    size_t        cqMapSize = 0;
+    io_uring_sqe* pSqes     = nullptr;
+    size_t        sqesSize  = 0;
+
+    uint32_t*     pSqTail   = nullptr;
+    uint32_t*     pSqArray  = nullptr;
+    uint32_t      sqMask    = 0;
+    uint32_t      sqEntries = 0;
+    uint32_t*     pCqHead   = nullptr;
+    uint32_t*     pCqTail   = nullptr;
+    uint32_t      cqMask    = 0;
+    io_uring_cqe* pCqes     = nullptr;
+
+    void Unmap() {
+        if (pSqes) {
+            munmap(pSqes, sqesSize);
+        }
+
+        if (pCqMap && pCqMap != pSqMap) {
+            munmap(pCqMap, cqMapSize);
+        }
+
+        if (pSqMap) {
+            munmap(pSqMap, sqMapSize);
+        }
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        *this = {};
+    }
+};
+#else
+struct AsyncFileReader::Ring
+{
+};
+#endif
+
+AsyncFileReader::AsyncFileReader() = default;
+
+AsyncFileReader::~AsyncFileReader() {
+    if (!workers.empty()) {
+        Destroy();
+    }
+}
+
+void AsyncFileReader::Init(Backend readerBackend, uint32_t readsInFlight, uint32_t threadCount) {
+    backend     = readerBackend;
+    maxInFlight = (std::max)(readsInFlight, 1u);
+    stopping    = false;
+
+    if (!CreateQueue()) {
+        backend = Backend::Threads;
+    }
+
+    for (uint32_t i = 0; i < (std::max)(threadCount, 1u); ++i) {
+        workers.emplace_back(&AsyncFileReader::Work, this);
+    }
+}
+
+void AsyncFileReader::Destroy() {
+    WaitIdle();
+
+    {
+        std::lock_guard<std::mutex> lock(workMutex);
+        stopping = true;
+    }
+
+    workCv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    workers.clear();
+
+    for (uint32_t i = 0; i < files.size(); ++i) {
+        Close(i);
+    }
+
+    DestroyQueue();
+}
+
+uint32_t AsyncFileReader::Open(const std::filesystem::path& path, bool direct) {
+    bool     threaded = backend == Backend::Threads;
+    uint64_t size     = 0;
+    intptr_t handle   = OpenFile(path, direct, threaded, size);
+
+    if (handle == -1) {
+        return INVALID_FILE;
+    }
+
+    File file { .handle = handle, .size = size, .direct = direct, .threaded = threaded };
+
+    if (!freeFiles.empty()) {
+        uint32_t index = freeFiles.back();
+        freeFiles.pop_back();
+
+        files[index] = file;
+        return index;
+    }
+
+    files.push_back(file);
+
+    return static_cast<uint32_t>(files.size() - 1);
+}
+
+void AsyncFileReader::Close(uint32_t index) {
+    File& file = files[index];
+
+    if (file.handle != -1) {
+        CloseFile(file.handle);
+        file.handle = -1;
+
+        freeFiles.push_back(index);
+    }
+}
+
+void AsyncFileReader::Read(uint32_t index, uint64_t offset, uint64_t size, void* pDst, Callback&& callback) {
+    const File& file = files[index];
+
+    uint64_t padding  = 0;
+    uint64_t readSize = size;
+
+    if (file.direct) {
+        if ((reinterpret_cast<uintptr_t>(pDst) & (ALIGNMENT - 1)) != 0) {
+            throw std::runtime_error("Unaligned destination for a direct read!");
+        }
+
+        padding  = offset & (ALIGNMENT - 1);
+        readSize = AlignedSize(offset, size);
+    }
+
+    // a completion reports the bytes read as a DWORD or an int32_t
+    if (readSize > uint64_t((std::numeric_limits<int32_t>::max)())) {
+        throw std::runtime_error("File read too large!");
+    }
+
+    Request* pRequest = AllocateRequest();
+
+    pRequest->handle     = file.handle;
+    pRequest->threaded   = file.threaded;
+    pRequest->pDst       = reinterpret_cast<uint8_t*>(pDst);
+    pRequest->size       = size;
+    pRequest->padding    = padding;
+    pRequest->readOffset = offset - padding;
+    pRequest->readSize   = readSize;
+    pRequest->callback   = std::move(callback);
+
+    pending.push_back(pRequest);
+}
+
+uint32_t AsyncFileReader::Submit() {
+    uint32_t issued = 0;
+
+    issuing.clear();
+
+    while (!pending.empty() && inFlight < maxInFlight) {
+        Request* pRequest = pending.front();
+        pending.pop_front();
+
+        pRequest->submitTime = std::chrono::steady_clock::now();
+
+        inFlight += 1;
+        issued   += 1;
+
+        if (pRequest->threaded) {
+            {
+                std::lock_guard<std::mutex> lock(workMutex);
+                work.push_back(pRequest);
+            }
+
+            workCv.notify_one();
+            continue;
+        }
+
+        issuing.push_back(pRequest);
+    }
+
+    if (!issuing.empty()) {
+        IssueNative(issuing.data(), uint32_t(issuing.size()));
+    }
+
+    return issued;
+}
+
+uint32_t AsyncFileReader::Poll(uint32_t timeoutMs) {
+    if (inFlight == 0) {
+        return 0;
+    }
+
+    Completion completions[64];
+    uint32_t   count = WaitCompletions(timeoutMs, completions, uint32_t(std::size(completions)));
+
+    auto now = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Request* pRequest = completions[i].pRequest;
+
+        bool ok = completions[i].ok && completions[i].bytes >= pRequest->padding + pRequest->size;
+
+        float latencyMs = std::chrono::duration<float, std::milli>(now - pRequest->submitTime).count();
+
+        statReads   += 1;
+        statBytes   += ok ? pRequest->size : 0;
+        statErrors  += ok ? 0 : 1;
+        statLatency += latencyMs;
+        statMaxLat   = (std::max)(statMaxLat, latencyMs);
+
+        inFlight -= 1;
+
+        Callback       callback = std::move(pRequest->callback);
+        const uint8_t* pData    = pRequest->pDst + pRequest->padding;
+        uint64_t       size     = pRequest->size;
+
+        freeRequests.push_back(pRequest);
+
+        callback(ok, pData, size);
+    }
+
+    Submit();
+
+    return count;
+}
+
+void AsyncFileReader::ReportStats(const char* name, bool force) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (statReads == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+        return;
+    }
+
+    std::cout << "File reads " << name << ": " << statReads << " reads, " << statBytes / (1024 * 1024) << " MB, latency avg "
+              << statLatency / statReads << " ms max " << statMaxLat << " ms, " << statErrors << " errors" << std::endl;
+
+    statReads   = 0;
+    statBytes   = 0;
+    statErrors  = 0;
+    statLatency = 0.0f;
+    statMaxLat  = 0.0f;
+    statStart   = now;
+}
+
+AsyncFileReader::Request* AsyncFileReader::AllocateRequest() {
+    if (freeRequests.empty()) {
+        requests.push_back(std::make_unique<Request>());
+        return requests.back().get();
+    }
+
+    Request* pRequest = freeRequests.back();
+    freeRequests.pop_back();
+
+    return pRequest;
+}
+
+void AsyncFileReader::Work() {
+    for (;;) {
+        Request* pRequest = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(workMutex);
+            workCv.wait(lock, [this] { return stopping || !work.empty(); });
+
+            if (work.empty()) {
+                return;
+            }
+
+            pRequest = work.front();
+            work.pop_front();
+        }
+
+        uint64_t bytes = 0;
+        bool     ok    = ReadBlocking(pRequest, bytes);
+
+        PostCompletion(pRequest, ok, bytes);
+    }
+}
+
+#ifdef _WIN32
+
+//
+// Windows: one I/O completion port for overlapped reads and the workers' completions alike.
+//
+bool AsyncFileReader::CreateQueue() {
+    port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+
+    if (!port) {
+        throw std::runtime_error("Could not create I/O completion port!");
+    }
+
+    return true;
+}
+
+void AsyncFileReader::DestroyQueue() {
+    if (port) {
+        CloseHandle(port);
+        port = nullptr;
+    }
+}
+
+intptr_t AsyncFileReader::OpenFile(const std::filesystem::path& path, bool direct, bool& threaded, uint64_t& size) {
+    DWORD flags = (threaded ? 0 : FILE_FLAG_OVERLAPPED) | (direct ? FILE_FLAG_NO_BUFFERING : 0);
+
+    HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+
+    LARGE_INTEGER fileSize = {};
+    GetFileSizeEx(handle, &fileSize);
+
+    size = uint64_t(fileSize.QuadPart);
+
+    // fallback: reopen for blocking reads on the workers
+    if (!threaded && CreateIoCompletionPort(handle, port, 0, 0) != port) {
+        CloseHandle(handle);
+
+        handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags & ~FILE_FLAG_OVERLAPPED, nullptr);
+
+        if (handle == INVALID_HANDLE_VALUE) {
+            return -1;
+        }
+
+        threaded = true;
+    }
+
+    return reinterpret_cast<intptr_t>(handle);
+}
+
+void AsyncFileReader::CloseFile(intptr_t handle) {
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+}
+
+void AsyncFileReader::IssueNative(Request* const* ppRequests, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        Request* pRequest = ppRequests[i];
+
+        pRequest->overlapped            = {};
+        pRequest->overlapped.Offset     = static_cast<DWORD>(pRequest->readOffset);
+        pRequest->overlapped.OffsetHigh = static_cast<DWORD>(pRequest->readOffset >> 32);
+
+        // the port gets a packet whether this completes right away or not
+        if (!ReadFile(reinterpret_cast<HANDLE>(pRequest->handle), pRequest->pDst, static_cast<DWORD>(pRequest->readSize), nullptr,
+                      &pRequest->overlapped)
+            && GetLastError() != ERROR_IO_PENDING) {
+            PostCompletion(pRequest, false, 0);
+        }
+    }
+}
+
+bool AsyncFileReader::ReadBlocking(Request* pRequest, uint64_t& bytes) {
+    OVERLAPPED position = {};
+    position.Offset     = static_cast<DWORD>(pRequest->readOffset);
+    position.OffsetHigh = static_cast<DWORD>(pRequest->readOffset >> 32);
+
+    DWORD read = 0;
+    BOOL  ok   = ReadFile(reinterpret_cast<HANDLE>(pRequest->handle), pRequest->pDst, static_cast<DWORD>(pRequest->readSize), &read, &position);
+
+    bytes = read;
+
+    return ok;
+}
+
+void AsyncFileReader::PostCompletion(Request* pRequest, bool ok, uint64_t bytes) {
+    pRequest->overlapped.Internal = ok ? 0 : ERROR_READ_FAULT;
+    PostQueuedCompletionStatus(port, DWORD(bytes), 0, &pRequest->overlapped);
+}
+
+uint32_t AsyncFileReader::WaitCompletions(uint32_t timeoutMs, Completion* pCompletions, uint32_t capacity) {
+    OVERLAPPED_ENTRY entries[64];
+    ULONG            count = 0;
+
+    if (!GetQueuedCompletionStatusEx(port, entries, (std::min)(ULONG(std::size(entries)), ULONG(capacity)), &count, timeoutMs, FALSE)) {
+        return 0;
+    }
+
+    for (ULONG i = 0; i < count; ++i) {
+        Request* pRequest = CONTAINING_RECORD(entries[i].lpOverlapped, Request, overlapped);
+
+        pCompletions[i] = { pRequest, pRequest->overlapped.Internal == 0, entries[i].dwNumberOfBytesTransferred };
+    }
+
+    return count;
+}
+
+#else
+
+//
+// Elsewhere: pread on the workers, whose completions queue up under completedMutex, and on Linux an
+// io_uring for Backend::Native. Its rings are shared with the kernel: the reader writes the
+// submission tail and the completion head, the kernel the other two.
+//
+#ifdef ASYNC_FILE_READER_URING
+static int UringSetup(uint32_t entries, io_uring_params* pParams) {
+    return int(syscall(__NR_io_uring_setup, entries, pParams));
+}
+
+static int UringEnter(int fd, uint32_t toSubmit, uint32_t minComplete, uint32_t flags, const void* pArg, size_t argSize) {
+    return int(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, pArg, argSize));
+}
+#endif
+
+bool AsyncFileReader::CreateQueue() {
+#ifdef ASYNC_FILE_READER_URING
+    if (backend != Backend::Native) {
+        return true;
+    }
+
+    io_uring_params params = {};
+
+    int fd = UringSetup(std::bit_ceil(maxInFlight), &params);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    ring     = std::make_unique<Ring>();
+    ring->fd = fd;
+
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+
+    ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ring->sqesSize  = params.sq_entries * sizeof(io_uring_sqe);
+
+    if (single) {
+        ring->sqMapSize = (std::max)(ring->sqMapSize, ring->cqMapSize);
+        ring->cqMapSize = ring->sqMapSize;
+    }
+
+    auto Map = [fd](size_t size, off_t offset) -> void* {
+        void* pMap = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+        return pMap != MAP_FAILED ? pMap : nullptr;
+    };
+
+    ring->pSqMap = Map(ring->sqMapSize, off_t(IORING_OFF_SQ_RING));
+    ring->pCqMap = single ? ring->pSqMap : Map(ring->cqMapSize, off_t(IORING_OFF_CQ_RING));
+    ring->pSqes  = static_cast<io_uring_sqe*>(Map(ring->sqesSize, off_t(IORING_OFF_SQES)));
+
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !ring->pSqMap || !ring->pCqMap || !ring->pSqes) {
+        ring->Unmap();
+        ring.reset();
+        return false;
+    }
+
+    uint8_t* pSq = static_cast<uint8_t*>(ring->pSqMap);
+    uint8_t* pCq = static_cast<uint8_t*>(ring->pCqMap);
+
+    ring->pSqTail   = reinterpret_cast<uint32_t*>(pSq + params.sq_off.tail);
+    ring->pSqArray  = reinterpret_cast<uint32_t*>(pSq + params.sq_off.array);
+    ring->sqMask    = *reinterpret_cast<uint32_t*>(pSq + params.sq_off.ring_mask);
+    ring->sqEntries = params.sq_entries;
+    ring->pCqHead   = reinterpret_cast<uint32_t*>(pCq + params.cq_off.head);
+    ring->pCqTail   = reinterpret_cast<uint32_t*>(pCq + params.cq_off.tail);
+    ring->cqMask    = *reinterpret_cast<uint32_t*>(pCq + params.cq_off.ring_mask);
+    ring->pCqes     = reinterpret_cast<io_uring_cqe*>(pCq + params.cq_off.cqes);
+
+    // a Submit() never has more to write than the submission ring holds
+    maxInFlight = (std::min)(maxInFlight, ring->sqEntries);
+
+    return true;
+#else
+    return backend != Backend::Native;
+#endif
+}
+
+void AsyncFileReader::DestroyQueue() {
+#ifdef ASYNC_FILE_READER_URING
+    if (ring) {
+        ring->Unmap();
+        ring.reset();
+    }
+#endif
+}
+
+intptr_t AsyncFileReader::OpenFile(const std::filesystem::path& path, bool direct, bool&, uint64_t& size) {
+    int flags = O_RDONLY | O_CLOEXEC;
+
+#ifdef O_DIRECT
+    flags |= direct ? O_DIRECT : 0;
+#endif
+
+    int fd = open(path.c_str(), flags);
+
+    // file systems without O_DIRECT refuse it at open
+    if (fd < 0 && direct && errno == EINVAL) {
+        fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat info = {};
+
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size = uint64_t(info.st_size);
+
+    return fd;
+}
+
+void AsyncFileReader::CloseFile(intptr_t handle) {
+    close(int(handle));
+}
+
+void AsyncFileReader::IssueNative(Request* const* ppRequests, uint32_t count) {
+#ifdef ASYNC_FILE_READER_URING
+    std::atomic_ref<uint32_t> sqTail(*ring->pSqTail);
+
+    uint32_t tail = sqTail.load(std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        Request*      pRequest = ppRequests[i];
+        uint32_t      index    = (tail + i) & ring->sqMask;
+        io_uring_sqe& sqe      = ring->pSqes[index];
+
+        pRequest->vector = { pRequest->pDst, size_t(pRequest->readSize) };
+
+        sqe           = {};
+        sqe.opcode    = IORING_OP_READV;
+        sqe.fd        = int(pRequest->handle);
+        sqe.off       = pRequest->readOffset;
+        sqe.addr      = reinterpret_cast<uint64_t>(&pRequest->vector);
+        sqe.len       = 1;
+        sqe.user_data = reinterpret_cast<uint64_t>(pRequest);
+
+        ring->pSqArray[index] = index;
+    }
+
+    sqTail.store(tail + count, std::memory_order_release);
+
+    // the whole batch in one syscall, unless the kernel takes it in parts
+    for (uint32_t submitted = 0; submitted < count;) {
+        int result = UringEnter(ring->fd, count - submitted, 0, 0, nullptr, 0);
+
+        if (result < 0 && errno != EINTR && errno != EAGAIN) {
+            throw std::runtime_error("Could not submit file reads!");
+        }
+
+        submitted += result > 0 ? uint32_t(result) : 0;
+    }
+#else
+    (void)ppRequests;
+    (void)count;
+#endif
+}
+
+bool AsyncFileReader::ReadBlocking(Request* pRequest, uint64_t& bytes) {
+    bytes = 0;
+
+    while (bytes < pRequest->readSize) {
+        ssize_t read = pread(int(pRequest->handle), pRequest->pDst + bytes, size_t(pRequest->readSize - bytes),
+                             off_t(pRequest->readOffset + bytes));
+
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (read < 0) {
+            return false;
+        }
+
+        // short only at the end of the file
+        if (read == 0 || (pRequest->readSize - bytes) > uint64_t(read)) {
+            bytes += uint64_t(read);
+            break;
+        }
+
+        bytes += uint64_t(read);
+    }
+
+    return true;
+}
+
+void AsyncFileReader::PostCompletion(Request* pRequest, bool ok, uint64_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completed.push_back({ pRequest, ok, bytes });
+    }
+
+    completedCv.notify_one();
+}
+
+uint32_t AsyncFileReader::WaitCompletions(uint32_t timeoutMs, Completion* pCompletions, uint32_t capacity) {
+#ifdef ASYNC_FILE_READER_URING
+    if (ring) {
+        std::atomic_ref<uint32_t> cqHead(*ring->pCqHead);
+        std::atomic_ref<uint32_t> cqTail(*ring->pCqTail);
+
+        uint32_t head = cqHead.load(std::memory_order_relaxed);
+        uint32_t tail = cqTail.load(std::memory_order_acquire);
+
+        if (head == tail && timeoutMs != 0) {
+            __kernel_timespec      timeout = { .tv_sec = timeoutMs / 1000, .tv_nsec = (timeoutMs % 1000) * 1000000ll };
+            io_uring_getevents_arg arg     = {};
+
+            arg.sigmask_sz = _NSIG / 8;
+            arg.ts         = timeoutMs != WAIT_FOREVER ? reinterpret_cast<uint64_t>(&timeout) : 0;
+
+            // ETIME and EINTR come back empty handed, like a timed out completion port
+            UringEnter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+            tail = cqTail.load(std::memory_order_acquire);
+        }
+
+        uint32_t count = 0;
+
+        for (; head != tail && count < capacity; ++head, ++count) {
+            const io_uring_cqe& cqe = ring->pCqes[head & ring->cqMask];
+
+            pCompletions[count] = { reinterpret_cast<Request*>(cqe.user_data), cqe.res >= 0, cqe.res >= 0 ? uint64_t(cqe.res) : 0 };
+        }
+
+        cqHead.store(head, std::memory_order_release);
+
+        return count;
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(completedMutex);
+
+    auto Ready = [this] { return !completed.empty(); };
+
+    if (timeoutMs == WAIT_FOREVER) {
+        completedCv.wait(lock, Ready);
+    }
+    else {
+        completedCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), Ready);
+    }
+
+    uint32_t count = 0;
+
+    for (; !completed.empty() && count < capacity; ++count) {
+        pCompletions[count] = completed.front();
+        completed.pop_front();
+    }
+
+    return count;
+}
+
+#endif
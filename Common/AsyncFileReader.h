@@ -0,0 +1,164 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Asynchronous file reads with batched submission and completion. Read() only queues; Submit() issues
+// what is queued, up to maxInFlight; Poll() reaps completions and runs the callbacks on the calling
+// thread, so callers never see one from another thread.
+//
+// Backend::Native is the platform's completion queue: an I/O completion port on Windows, an io_uring
+// on Linux (raw syscalls, kernel 5.11 or later for timed waits), where a whole Submit() goes out in one
+// io_uring_enter. Backend::Threads reads with blocking positional reads on worker threads and posts
+// their completions to the same place, so callers can't tell the difference. Native falls back to
+// threads where there is no io_uring or it is filtered out (seccomp, many containers), and on Windows
+// for files the port won't take; GetBackend() says what Init() ended up with.
+//
+// Direct files bypass the file cache (FILE_FLAG_NO_BUFFERING, O_DIRECT), which needs sector aligned
+// offsets, sizes and memory: Read() rounds the range out and hands the callback a pointer past the
+// padding, the caller provides ALIGNMENT aligned memory of AlignedSize() bytes (upload heaps,
+// VirtualAlloc and mmap are page aligned). File systems without O_DIRECT (tmpfs) read them buffered,
+// under the same rules.
+//
+class AsyncFileReader {
+public:
+    static constexpr uint64_t ALIGNMENT    = 4096;      // 512 byte and 4K sector drives
+    static constexpr uint32_t INVALID_FILE = ~0u;
+    static constexpr uint32_t WAIT_FOREVER = ~0u;       // Poll() timeout, INFINITE on Windows
+
+    enum class Backend {
+        Native,
+        Threads
+    };
+
+    using Callback = std::function<void(bool ok, const uint8_t* pData, uint64_t size)>;
+
+    AsyncFileReader();
+    ~AsyncFileReader();
+
+    void Init(Backend readerBackend, uint32_t readsInFlight, uint32_t threadCount = 4);
+    void Destroy();
+
+    Backend GetBackend() const {
+        return backend;
+    }
+
+    // INVALID_FILE if it can't be opened
+    uint32_t Open(const std::filesystem::path& path, bool direct);
+
+    // reads of the file must have completed
+    void Close(uint32_t index);
+
+    uint64_t GetFileSize(uint32_t index) const {
+        return files[index].size;
+    }
+
+    // bytes the destination of a direct read of [offset, offset + size) has to hold
+    static uint64_t AlignedSize(uint64_t offset, uint64_t size) {
+        uint64_t padding = offset & (ALIGNMENT - 1);
+        return (padding + size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    //
+    // Queues a read of size bytes at offset into pDst. The callback gets the data (pDst, or past the
+    // alignment padding of a direct read) once a Poll() sees the read complete.
+    //
+    void Read(uint32_t index, uint64_t offset, uint64_t size, void* pDst, Callback&& callback);
+
+    // issues queued reads, returns how many went out
+    uint32_t Submit();
+
+    //
+    // Runs the callbacks of completed reads, waiting up to timeoutMs for the first one, then refills
+    // the reads in flight from the queue. Returns the number of completions.
+    //
+    uint32_t Poll(uint32_t timeoutMs = 0);
+
+    void WaitIdle() {
+        Submit();
+
+        while (inFlight > 0) {
+            Poll(WAIT_FOREVER);
+        }
+    }
+
+    uint32_t GetInFlight() const {
+        return inFlight;
+    }
+
+    void ReportStats(const char* name, bool force);
+
+private:
+    struct File
+    {
+        intptr_t handle   = -1;         // HANDLE on Windows, file descriptor elsewhere
+        uint64_t size     = 0;
+        bool     direct   = false;
+        bool     threaded = false;      // read by the workers
+    };
+
+    struct Request;     // per platform, AsyncFileReader.cpp
+    struct Ring;        // io_uring mappings, Linux
+
+    struct Completion
+    {
+        Request* pRequest = nullptr;
+        bool     ok       = false;
+        uint64_t bytes    = 0;
+    };
+
+    Request* AllocateRequest();
+
+    // worker thread: blocking positional reads, completions go where native ones do
+    void Work();
+
+    // the platform part, AsyncFileReader.cpp
+    bool     CreateQueue();
+    void     DestroyQueue();
+    intptr_t OpenFile(const std::filesystem::path& path, bool direct, bool& threaded, uint64_t& size);
+    void     CloseFile(intptr_t handle);
+    void     IssueNative(Request* const* ppRequests, uint32_t count);
+    bool     ReadBlocking(Request* pRequest, uint64_t& bytes);
+    void     PostCompletion(Request* pRequest, bool ok, uint64_t bytes);
+    uint32_t WaitCompletions(uint32_t timeoutMs, Completion* pCompletions, uint32_t capacity);
+
+    Backend                               backend      = Backend::Native;
+    uint32_t                              maxInFlight  = 0;
+    uint32_t                              inFlight     = 0;
+
+    void*                                 port         = nullptr;   // Windows: the completion port
+    std::unique_ptr<Ring>                 ring;                     // Linux: the io_uring, Native only
+
+    std::vector<File>                     files;
+    std::vector<uint32_t>                 freeFiles;
+    std::vector<std::unique_ptr<Request>> requests;
+    std::vector<Request*>                 freeRequests;
+    std::deque<Request*>                  pending;
+    std::vector<Request*>                 issuing;
+
+    std::vector<std::thread>              workers;
+    std::deque<Request*>                  work;
+    std::mutex                            workMutex;
+    std::condition_variable               workCv;
+    bool                                  stopping     = false;
+
+    std::deque<Completion>                completed;                // not Windows: what the workers read
+    std::mutex                            completedMutex;
+    std::condition_variable               completedCv;
+
+    uint64_t                              statReads    = 0;
+    uint64_t                              statBytes    = 0;
+    uint64_t                              statErrors   = 0;
+    float                                 statLatency  = 0.0f;
+    float                                 statMaxLat   = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
@@ -0,0 +1,703 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Frustum.h"
+#include "OcclusionCuller.h"
+
+//
+// Bounding volume hierarchy over AABBs (OcclusionCuller::Boxes, an array per axis of centers and half
+// extents), for culling and queries whose cost follows what they touch rather than the object count.
+// Nodes are 32 bytes in one array, built depth first so subtrees are contiguous (rotations shuffle
+// that a little until the next build); a leaf holds up to MAX_LEAF_OBJECTS objects as a range of
+// objectIndices, whose boxes are copied next to them in leafBoxes, so queries never gather from the
+// object arrays. Build() is a binned SAH build. As objects move, Refit() recomputes the boxes bottom
+// up and on the way applies tree rotations (Kopta et al.): a child swaps places with a grandchild
+// where that shrinks the surface area, which keeps the tree usable for a while. Once the SAH cost has
+// drifted too far, RequestRebuild() snapshots the bounds for a full build on the builder thread, and
+// ApplyRebuild() swaps the result in and refits it to where the objects are by then. Queries see the
+// boxes of the last Build/Refit. Points are 3 floats, the layout of DirectXMath's XMFLOAT3.
+//
+class BoundingVolumeHierarchy {
+public:
+    static constexpr uint32_t MAX_LEAF_OBJECTS = 4;
+    static constexpr uint32_t SAH_BINS         = 16;
+    static constexpr uint32_t LEAF             = 0x80000000u;
+
+    struct Float3
+    {
+        float x, y, z;
+    };
+
+    struct Node
+    {
+        Float3   lo;
+        uint32_t left;          // internal: left child, leaf: first entry in objectIndices
+        Float3   hi;
+        uint32_t right;         // internal: right child, leaf: LEAF | object count
+
+        bool     IsLeaf() const     { return (right & LEAF) != 0; }
+        uint32_t GetCount() const   { return right & ~LEAF; }
+    };
+
+    static_assert(sizeof(Node) == 32);
+
+    struct Box
+    {
+        Float3 lo;
+        Float3 hi;
+    };
+
+    struct Stats {
+        uint64_t refits       = 0;
+        uint64_t rotations    = 0;
+        uint64_t rebuilds     = 0;      // swapped in by ApplyRebuild
+        float    refitMs      = 0.0f;   // sum over refits
+        float    lastBuildMs  = 0.0f;
+    };
+
+    void Init() {
+        builder = std::thread(&BoundingVolumeHierarchy::BuildLoop, this);
+    }
+
+    void Destroy() {
+        {
+            std::lock_guard<std::mutex> lock(buildMutex);
+            stopping = true;
+        }
+
+        buildCv.notify_all();
+
+        if (builder.joinable()) {
+            builder.join();
+        }
+    }
+
+    // objects [0, count) of bounds, on the calling thread
+    void Build(const OcclusionCuller::Boxes& bounds, uint32_t count) {
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<BuildRef> refs;
+        TakeSnapshot(bounds, count, refs);
+
+        BuildTree(refs, nodes, objectIndices);
+
+        objectCount       = count;
+        stats.lastBuildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        Refit(bounds, false);
+        builtCost = cost;
+    }
+
+    // boxes from the objects' current bounds, optionally improving the tree with rotations
+    void Refit(const OcclusionCuller::Boxes& bounds, bool rotate = true) {
+        if (nodes.empty()) {
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        leafBoxes.resize(objectIndices.size());
+
+        const float* pCenter[3] = { bounds.pCenter[0], bounds.pCenter[1], bounds.pCenter[2] };
+        const float* pExtent[3] = { bounds.pExtent[0], bounds.pExtent[1], bounds.pExtent[2] };
+
+        float area = 0.0f;
+        RefitNode(0, pCenter, pExtent, rotate, area);
+
+        cost = area / (std::max)(SurfaceArea(nodes[0].lo, nodes[0].hi), FLT_MIN);
+
+        stats.refits  += 1;
+        stats.refitMs += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // false if a rebuild is already under way
+    bool RequestRebuild(const OcclusionCuller::Boxes& bounds, uint32_t count) {
+        std::lock_guard<std::mutex> lock(buildMutex);
+
+        if (rebuildRequested || rebuildReady) {
+            return false;
+        }
+
+        TakeSnapshot(bounds, count, pending);
+        rebuildRequested = true;
+
+        buildCv.notify_one();
+
+        return true;
+    }
+
+    // swaps in a finished rebuild of the same objects, true if it did
+    bool ApplyRebuild(const OcclusionCuller::Boxes& bounds) {
+        {
+            std::lock_guard<std::mutex> lock(buildMutex);
+
+            if (!rebuildReady) {
+                return false;
+            }
+
+            rebuildReady = false;
+
+            if (pending.size() != objectCount) {
+                return false;
+            }
+
+            nodes.swap(builtNodes);
+            objectIndices.swap(builtIndices);
+            stats.lastBuildMs = builtMs;
+        }
+
+        Refit(bounds, false);
+
+        builtCost       = cost;
+        stats.rebuilds += 1;
+
+        return true;
+    }
+
+    bool IsRebuilding() const {
+        std::lock_guard<std::mutex> lock(buildMutex);
+        return rebuildRequested || rebuildReady;
+    }
+
+    uint32_t GetObjectCount() const {
+        return objectCount;
+    }
+
+    uint32_t GetNodeCount() const {
+        return static_cast<uint32_t>(nodes.size());
+    }
+
+    // SAH cost (traversal steps and object tests per query, relative to the root) after the last refit, and right after the last build
+    float GetCost() const {
+        return cost;
+    }
+
+    float GetBuiltCost() const {
+        return builtCost;
+    }
+
+    //
+    // Objects whose AABB passes the frustum test, in tree order. A node keeps the planes it isn't
+    // entirely in front of; once none are left its whole subtree goes out without further tests.
+    //
+    uint32_t QueryFrustum(const Frustum& frustum, uint32_t* pVisible) const {
+        if (nodes.empty()) {
+            return 0;
+        }
+
+        constexpr uint32_t ALL_PLANES = (1u << Frustum::PLANE_COUNT) - 1;
+
+        auto& stack = TraversalStack();
+        stack.push_back(ALL_PLANES);        // root is node 0, the planes in the low bits
+
+        uint32_t visible = 0;
+
+        while (!stack.empty()) {
+            uint32_t index = uint32_t(stack.back() >> 32);
+            uint32_t mask  = uint32_t(stack.back());
+            stack.pop_back();
+
+            const Node& node = nodes[index];
+
+            if (mask != 0) {
+                Float3 center = { (node.lo.x + node.hi.x) * 0.5f, (node.lo.y + node.hi.y) * 0.5f, (node.lo.z + node.hi.z) * 0.5f };
+                Float3 extent = { (node.hi.x - node.lo.x) * 0.5f, (node.hi.y - node.lo.y) * 0.5f, (node.hi.z - node.lo.z) * 0.5f };
+
+                if (!ClassifyBox(frustum, center, extent, mask)) {
+                    continue;
+                }
+            }
+
+            if (!node.IsLeaf()) {
+                stack.push_back((uint64_t(node.right) << 32) | mask);
+                stack.push_back((uint64_t(node.left) << 32) | mask);
+                continue;
+            }
+
+            for (uint32_t n = node.left; n < node.left + node.GetCount(); ++n) {
+                const Box& box        = leafBoxes[n];
+                uint32_t   objectMask = mask;
+
+                if (objectMask == 0 || ClassifyBox(frustum, { (box.lo.x + box.hi.x) * 0.5f, (box.lo.y + box.hi.y) * 0.5f, (box.lo.z + box.hi.z) * 0.5f },
+                                                   { (box.hi.x - box.lo.x) * 0.5f, (box.hi.y - box.lo.y) * 0.5f, (box.hi.z - box.lo.z) * 0.5f }, objectMask)) {
+                    pVisible[visible++] = objectIndices[n];
+                }
+            }
+        }
+
+        return visible;
+    }
+
+    // objects whose AABB overlaps [lo, hi], returns how many
+    uint32_t QueryBox(const Float3& lo, const Float3& hi, uint32_t* pObjects) const {
+        if (nodes.empty()) {
+            return 0;
+        }
+
+        auto& stack = TraversalStack();
+        stack.push_back(0);
+
+        uint32_t found = 0;
+
+        while (!stack.empty()) {
+            const Node& node = nodes[uint32_t(stack.back())];
+            stack.pop_back();
+
+            if (!Overlaps(node.lo, node.hi, lo, hi)) {
+                continue;
+            }
+
+            if (!node.IsLeaf()) {
+                stack.push_back(node.right);
+                stack.push_back(node.left);
+                continue;
+            }
+
+            for (uint32_t n = node.left; n < node.left + node.GetCount(); ++n) {
+                if (Overlaps(leafBoxes[n].lo, leafBoxes[n].hi, lo, hi)) {
+                    pObjects[found++] = objectIndices[n];
+                }
+            }
+        }
+
+        return found;
+    }
+
+    //
+    // Nearest object AABB the ray origin + t * direction enters for t in [0, maxT]; children are
+    // visited near first and skipped once they start beyond the nearest hit so far.
+    //
+    bool Raycast(const Float3& origin, const Float3& direction, float maxT, uint32_t& hitObject, float& hitT) const {
+        if (nodes.empty()) {
+            return false;
+        }
+
+        Float3 inverse = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+        float nearest = maxT;
+        bool  hit     = false;
+
+        auto& stack = TraversalStack();
+
+        float tRoot = 0.0f;
+        if (RayBox(origin, inverse, nodes[0].lo, nodes[0].hi, nearest, tRoot)) {
+            stack.push_back(0);
+        }
+
+        while (!stack.empty()) {
+            const Node& node = nodes[uint32_t(stack.back())];
+            stack.pop_back();
+
+            if (node.IsLeaf()) {
+                for (uint32_t n = node.left; n < node.left + node.GetCount(); ++n) {
+                    float t = 0.0f;
+                    if (RayBox(origin, inverse, leafBoxes[n].lo, leafBoxes[n].hi, nearest, t)) {
+                        nearest   = t;
+                        hitObject = objectIndices[n];
+                        hit       = true;
+                    }
+                }
+                continue;
+            }
+
+            float tLeft = 0.0f, tRight = 0.0f;
+            bool  hitLeft  = RayBox(origin, inverse, nodes[node.left].lo, nodes[node.left].hi, nearest, tLeft);
+            bool  hitRight = RayBox(origin, inverse, nodes[node.right].lo, nodes[node.right].hi, nearest, tRight);
+
+            // the nearer child goes on top
+            if (hitLeft && hitRight) {
+                stack.push_back(tLeft <= tRight ? node.right : node.left);
+                stack.push_back(tLeft <= tRight ? node.left : node.right);
+            }
+            else if (hitLeft || hitRight) {
+                stack.push_back(hitLeft ? node.left : node.right);
+            }
+        }
+
+        hitT = nearest;
+
+        return hit;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (stats.refits == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "BVH: " << objectCount << " objects, " << nodes.size() << " nodes, SAH cost " << cost << " (built "
+                  << builtCost << "), refit " << stats.refitMs / stats.refits << " ms, " << stats.rotations << " rotations, "
+                  << stats.rebuilds << " rebuilds, last build " << stats.lastBuildMs << " ms" << std::endl;
+
+        stats     = { .lastBuildMs = stats.lastBuildMs };
+        statStart = now;
+    }
+
+private:
+    // what a build reads and reorders, so the builder thread doesn't share the live bounds
+    struct BuildRef
+    {
+        Float3   lo;
+        uint32_t object;
+        Float3   hi;
+        float    padding;
+    };
+
+    // AABBs of objects [0, count)
+    static void TakeSnapshot(const OcclusionCuller::Boxes& bounds, uint32_t count, std::vector<BuildRef>& refs) {
+        refs.resize(count);
+
+        const float* pCenter[3] = { bounds.pCenter[0], bounds.pCenter[1], bounds.pCenter[2] };
+        const float* pExtent[3] = { bounds.pExtent[0], bounds.pExtent[1], bounds.pExtent[2] };
+
+        for (uint32_t i = 0; i < count; ++i) {
+            refs[i] = {
+                .lo      = { pCenter[0][i] - pExtent[0][i], pCenter[1][i] - pExtent[1][i], pCenter[2][i] - pExtent[2][i] },
+                .object  = i,
+                .hi      = { pCenter[0][i] + pExtent[0][i], pCenter[1][i] + pExtent[1][i], pCenter[2][i] + pExtent[2][i] },
+                .padding = 0.0f
+            };
+        }
+    }
+
+    static float SurfaceArea(const Float3& lo, const Float3& hi) {
+        float dx = hi.x - lo.x, dy = hi.y - lo.y, dz = hi.z - lo.z;
+        return 2.0f * (dx * dy + dy * dz + dz * dx);
+    }
+
+    static void Grow(Float3& lo, Float3& hi, const Float3& otherLo, const Float3& otherHi) {
+        lo = { (std::min)(lo.x, otherLo.x), (std::min)(lo.y, otherLo.y), (std::min)(lo.z, otherLo.z) };
+        hi = { (std::max)(hi.x, otherHi.x), (std::max)(hi.y, otherHi.y), (std::max)(hi.z, otherHi.z) };
+    }
+
+    static bool Overlaps(const Float3& aLo, const Float3& aHi, const Float3& bLo, const Float3& bHi) {
+        return aLo.x <= bHi.x && aHi.x >= bLo.x && aLo.y <= bHi.y && aHi.y >= bLo.y && aLo.z <= bHi.z && aHi.z >= bLo.z;
+    }
+
+    // slab test, t is where the ray enters [lo, hi] if that is before maxT
+    static bool RayBox(const Float3& origin, const Float3& inverse, const Float3& lo, const Float3& hi, float maxT, float& t) {
+        float tx0 = (lo.x - origin.x) * inverse.x, tx1 = (hi.x - origin.x) * inverse.x;
+        float ty0 = (lo.y - origin.y) * inverse.y, ty1 = (hi.y - origin.y) * inverse.y;
+        float tz0 = (lo.z - origin.z) * inverse.z, tz1 = (hi.z - origin.z) * inverse.z;
+
+        float tEnter = (std::max)((std::max)((std::min)(tx0, tx1), (std::min)(ty0, ty1)), (std::max)((std::min)(tz0, tz1), 0.0f));
+        float tExit  = (std::min)((std::min)((std::max)(tx0, tx1), (std::max)(ty0, ty1)), (std::min)((std::max)(tz0, tz1), maxT));
+
+        t = tEnter;
+
+        return tEnter <= tExit;
+    }
+
+    //
+    // Box against the planes in mask: false if it is behind one of them, otherwise clears the planes
+    // it is entirely in front of. The same distance and reach as Frustum::TestBox().
+    //
+    static bool ClassifyBox(const Frustum& frustum, const Float3& center, const Float3& extent, uint32_t& mask) {
+        for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p) {
+            if ((mask & (1u << p)) == 0) {
+                continue;
+            }
+
+            const Frustum::Plane& f = frustum.planes[p];
+
+            float distance = center.x * f.x + center.y * f.y + center.z * f.z + f.w;
+            float reach    = extent.x * fabsf(f.x) + extent.y * fabsf(f.y) + extent.z * fabsf(f.z);
+
+            if (distance + reach < 0.0f) {
+                return false;
+            }
+
+            if (distance - reach >= 0.0f) {
+                mask &= ~(1u << p);
+            }
+        }
+
+        return true;
+    }
+
+    // per thread, so queries can run from several jobs at once without allocating
+    static std::vector<uint64_t>& TraversalStack() {
+        thread_local std::vector<uint64_t> stack;
+        stack.clear();
+        return stack;
+    }
+
+    //
+    // Top down binned SAH: objects are binned by centroid along the widest centroid axis, and the
+    // split between bins with the lowest area * count on both sides wins. Ranges of MAX_LEAF_OBJECTS
+    // or fewer become leaves, ranges whose centroids all coincide are halved. The refs are
+    // partitioned in place, so every level streams through contiguous memory.
+    //
+    static void BuildTree(std::vector<BuildRef>& refs, std::vector<Node>& outNodes, std::vector<uint32_t>& outIndices) {
+        outNodes.clear();
+        outIndices.resize(refs.size());
+
+        if (refs.empty()) {
+            return;
+        }
+
+        outNodes.reserve(refs.size() / MAX_LEAF_OBJECTS * 2 + 1);
+
+        BuildNode(refs, outNodes, 0, static_cast<uint32_t>(refs.size()));
+
+        for (size_t n = 0; n < refs.size(); ++n) {
+            outIndices[n] = refs[n].object;
+        }
+    }
+
+    static uint32_t BuildNode(std::vector<BuildRef>& refs, std::vector<Node>& outNodes, uint32_t begin, uint32_t end) {
+        uint32_t index = static_cast<uint32_t>(outNodes.size());
+        outNodes.push_back({});
+
+        auto Centroid = [](const BuildRef& ref, uint32_t axis) {
+            return (reinterpret_cast<const float*>(&ref.lo)[axis] + reinterpret_cast<const float*>(&ref.hi)[axis]) * 0.5f;
+        };
+
+        Float3   lo = refs[begin].lo, hi = refs[begin].hi;
+        float    centroidLo[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, centroidHi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        for (uint32_t n = begin; n < end; ++n) {
+            Grow(lo, hi, refs[n].lo, refs[n].hi);
+
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+                centroidLo[axis] = (std::min)(centroidLo[axis], Centroid(refs[n], axis));
+                centroidHi[axis] = (std::max)(centroidHi[axis], Centroid(refs[n], axis));
+            }
+        }
+
+        uint32_t count = end - begin;
+
+        if (count <= MAX_LEAF_OBJECTS) {
+            outNodes[index] = { .lo = lo, .left = begin, .hi = hi, .right = LEAF | count };
+            return index;
+        }
+
+        uint32_t axis = 0;
+
+        for (uint32_t a = 1; a < 3; ++a) {
+            if (centroidHi[a] - centroidLo[a] > centroidHi[axis] - centroidLo[axis]) {
+                axis = a;
+            }
+        }
+
+        uint32_t mid = begin + count / 2;
+
+        if (centroidHi[axis] > centroidLo[axis]) {
+            struct Bin
+            {
+                Float3   lo    = { FLT_MAX, FLT_MAX, FLT_MAX };
+                Float3   hi    = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+                uint32_t count = 0;
+            };
+
+            Bin   bins[SAH_BINS];
+            float scale = SAH_BINS / (centroidHi[axis] - centroidLo[axis]);
+
+            auto BinOf = [&](const BuildRef& ref) {
+                return (std::min)(uint32_t((Centroid(ref, axis) - centroidLo[axis]) * scale), SAH_BINS - 1);
+            };
+
+            for (uint32_t n = begin; n < end; ++n) {
+                Bin& bin = bins[BinOf(refs[n])];
+
+                Grow(bin.lo, bin.hi, refs[n].lo, refs[n].hi);
+                bin.count += 1;
+            }
+
+            // area * count right of every split, then sweep from the left
+            float    rightCost[SAH_BINS] = {};
+            Float3   sweepLo = bins[SAH_BINS - 1].lo, sweepHi = bins[SAH_BINS - 1].hi;
+            uint32_t sweepCount = 0;
+
+            for (uint32_t b = SAH_BINS - 1; b > 0; --b) {
+                Grow(sweepLo, sweepHi, bins[b].lo, bins[b].hi);
+                sweepCount   += bins[b].count;
+                rightCost[b]  = sweepCount ? SurfaceArea(sweepLo, sweepHi) * sweepCount : 0.0f;
+            }
+
+            sweepLo    = bins[0].lo;
+            sweepHi    = bins[0].hi;
+            sweepCount = 0;
+
+            float    bestCost  = FLT_MAX;
+            uint32_t bestSplit = 0;
+
+            for (uint32_t b = 0; b + 1 < SAH_BINS; ++b) {
+                Grow(sweepLo, sweepHi, bins[b].lo, bins[b].hi);
+                sweepCount += bins[b].count;
+
+                float splitCost = (sweepCount ? SurfaceArea(sweepLo, sweepHi) * sweepCount : 0.0f) + rightCost[b + 1];
+
+                if (sweepCount != 0 && sweepCount != count && splitCost < bestCost) {
+                    bestCost  = splitCost;
+                    bestSplit = b;
+                }
+            }
+
+            if (bestCost < FLT_MAX) {
+                mid = uint32_t(std::partition(refs.begin() + begin, refs.begin() + end,
+                                              [&](const BuildRef& ref) { return BinOf(ref) <= bestSplit; }) - refs.begin());
+            }
+        }
+
+        uint32_t left  = BuildNode(refs, outNodes, begin, mid);
+        uint32_t right = BuildNode(refs, outNodes, mid, end);
+
+        outNodes[index] = { .lo = lo, .left = left, .hi = hi, .right = right };
+
+        return index;
+    }
+
+    // post order; area gathers the SAH cost terms, node area times its traversal or object tests
+    void RefitNode(uint32_t index, const float* (&pCenter)[3], const float* (&pExtent)[3], bool rotate, float& area) {
+        Node& node = nodes[index];
+
+        if (node.IsLeaf()) {
+            node.lo = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+            node.hi = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+            for (uint32_t n = node.left; n < node.left + node.GetCount(); ++n) {
+                uint32_t object = objectIndices[n];
+                Box&     box    = leafBoxes[n];
+
+                box.lo = { pCenter[0][object] - pExtent[0][object], pCenter[1][object] - pExtent[1][object], pCenter[2][object] - pExtent[2][object] };
+                box.hi = { pCenter[0][object] + pExtent[0][object], pCenter[1][object] + pExtent[1][object], pCenter[2][object] + pExtent[2][object] };
+
+                Grow(node.lo, node.hi, box.lo, box.hi);
+            }
+
+            area += SurfaceArea(node.lo, node.hi) * node.GetCount();
+            return;
+        }
+
+        RefitNode(node.left, pCenter, pExtent, rotate, area);
+        RefitNode(node.right, pCenter, pExtent, rotate, area);
+
+        if (rotate) {
+            area -= Rotate(node);
+        }
+
+        node.lo = nodes[node.left].lo;
+        node.hi = nodes[node.left].hi;
+        Grow(node.lo, node.hi, nodes[node.right].lo, nodes[node.right].hi);
+
+        area += SurfaceArea(node.lo, node.hi);
+    }
+
+    //
+    // Swaps one child of node with a child of its other child, whichever of the four shrinks the
+    // other child's box the most, if any, and returns by how much. The node's own box doesn't change.
+    //
+    float Rotate(Node& node) {
+        uint32_t* pBestA   = nullptr;
+        uint32_t* pBestB   = nullptr;
+        uint32_t  parent   = 0;
+        float     bestGain = 0.0f;
+
+        for (uint32_t side = 0; side < 2; ++side) {
+            uint32_t& child = side == 0 ? node.left : node.right;      // swaps with a grandchild under other
+            uint32_t  other = side == 0 ? node.right : node.left;
+
+            Node& otherNode = nodes[other];
+            if (otherNode.IsLeaf()) {
+                continue;
+            }
+
+            float before = SurfaceArea(otherNode.lo, otherNode.hi);
+
+            for (uint32_t grand = 0; grand < 2; ++grand) {
+                uint32_t& grandchild = grand == 0 ? otherNode.left : otherNode.right;
+                uint32_t  kept       = grand == 0 ? otherNode.right : otherNode.left;
+
+                // other would hold child and the grandchild that stays
+                Float3 lo = nodes[child].lo, hi = nodes[child].hi;
+                Grow(lo, hi, nodes[kept].lo, nodes[kept].hi);
+
+                float gain = before - SurfaceArea(lo, hi);
+
+                if (gain > bestGain) {
+                    bestGain = gain;
+                    pBestA   = &child;
+                    pBestB   = &grandchild;
+                    parent   = other;
+                }
+            }
+        }
+
+        if (!pBestA) {
+            return 0.0f;
+        }
+
+        std::swap(*pBestA, *pBestB);
+
+        Node& changed = nodes[parent];
+        changed.lo = nodes[changed.left].lo;
+        changed.hi = nodes[changed.left].hi;
+        Grow(changed.lo, changed.hi, nodes[changed.right].lo, nodes[changed.right].hi);
+
+        stats.rotations += 1;
+
+        return bestGain;
+    }
+
+    // builder thread: one snapshot at a time into builtNodes/builtIndices
+    void BuildLoop() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(buildMutex);
+                buildCv.wait(lock, [this] { return stopping || rebuildRequested; });
+
+                if (stopping) {
+                    return;
+                }
+            }
+
+            auto start = std::chrono::steady_clock::now();
+
+            BuildTree(pending, builtNodes, builtIndices);
+
+            std::lock_guard<std::mutex> lock(buildMutex);
+
+            builtMs          = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            rebuildRequested = false;
+            rebuildReady     = true;
+        }
+    }
+
+    std::vector<Node>                     nodes;
+    std::vector<uint32_t>                 objectIndices;
+    std::vector<Box>                      leafBoxes;          // objectIndices' boxes, as of the last refit
+    uint32_t                              objectCount      = 0;
+    float                                 cost             = 0.0f;
+    float                                 builtCost        = 0.0f;
+
+    // the builder owns pending and the built arrays while rebuildRequested is set
+    std::thread                           builder;
+    mutable std::mutex                    buildMutex;
+    std::condition_variable               buildCv;
+    std::vector<BuildRef>                 pending;
+    std::vector<Node>                     builtNodes;
+    std::vector<uint32_t>                 builtIndices;
+    float                                 builtMs          = 0.0f;
+    bool                                  rebuildRequested = false;
+    bool                                  rebuildReady     = false;
+    bool                                  stopping         = false;
+
+    Stats                                 stats;
+    std::chrono::steady_clock::time_point statStart        = std::chrono::steady_clock::now();
+};
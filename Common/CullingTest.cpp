@@ -0,0 +1,494 @@
+#include "BoundingVolumeHierarchy.h"
+#include "Frustum.h"
+#include "IndirectDraws.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+//
+// The checks of Frustum, BoundingVolumeHierarchy and IndirectDraws, on the scenes of RotatingPyramid's
+// former --bench=bvh and --bench=indirect checks: random boxes in a 200 unit cube seen from outside
+// it. Every BVH query has to find what a loop over all boxes finds, after a build, a rebuild on the
+// builder thread and refits as the boxes move; the draws of Generate(), Build() and Build() on jobs
+// have to be the same and draw exactly the visible boxes. Exits nonzero if any of them fails.
+//
+
+using Matrix = float[4][4];
+using Float3 = BoundingVolumeHierarchy::Float3;
+
+// the matrices of XMMatrixPerspectiveFovLH and XMMatrixLookAtLH, row vectors
+static void Perspective(float fovY, float aspect, float nearZ, float farZ, Matrix& m) {
+    float h     = 1.0f / std::tan(fovY * 0.5f);
+    float range = farZ / (farZ - nearZ);
+
+    m[0][0] = h / aspect; m[0][1] = 0.0f; m[0][2] = 0.0f;            m[0][3] = 0.0f;
+    m[1][0] = 0.0f;       m[1][1] = h;    m[1][2] = 0.0f;            m[1][3] = 0.0f;
+    m[2][0] = 0.0f;       m[2][1] = 0.0f; m[2][2] = range;           m[2][3] = 1.0f;
+    m[3][0] = 0.0f;       m[3][1] = 0.0f; m[3][2] = -range * nearZ;  m[3][3] = 0.0f;
+}
+
+static void LookAt(const Float3& eye, const Float3& at, Matrix& m) {
+    auto Normalize = [](Float3 v) {
+        float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return Float3{ v.x / length, v.y / length, v.z / length };
+    };
+
+    auto Cross = [](const Float3& a, const Float3& b) {
+        return Float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    };
+
+    auto Dot = [](const Float3& a, const Float3& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    };
+
+    Float3 z = Normalize({ at.x - eye.x, at.y - eye.y, at.z - eye.z });
+    Float3 x = Normalize(Cross({ 0.0f, 1.0f, 0.0f }, z));
+    Float3 y = Cross(z, x);
+
+    m[0][0] = x.x;           m[0][1] = y.x;           m[0][2] = z.x;           m[0][3] = 0.0f;
+    m[1][0] = x.y;           m[1][1] = y.y;           m[1][2] = z.y;           m[1][3] = 0.0f;
+    m[2][0] = x.z;           m[2][1] = y.z;           m[2][2] = z.z;           m[2][3] = 0.0f;
+    m[3][0] = -Dot(x, eye);  m[3][1] = -Dot(y, eye);  m[3][2] = -Dot(z, eye);  m[3][3] = 1.0f;
+}
+
+static void Multiply(const Matrix& a, const Matrix& b, Matrix& m) {
+    for (uint32_t r = 0; r < 4; ++r) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            m[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+        }
+    }
+}
+
+// seen from (0, 50, -150) towards the origin, fovY in degrees
+static Frustum ViewFrustum(float fovY) {
+    Matrix view, projection, viewProj;
+
+    LookAt({ 0.0f, 50.0f, -150.0f }, { 0.0f, 0.0f, 0.0f }, view);
+    Perspective(fovY * 3.14159265f / 180.0f, 1920.0f / 1080.0f, 0.1f, 500.0f, projection);
+    Multiply(view, projection, viewProj);
+
+    return Frustum::FromViewProj(viewProj);
+}
+
+// boxes as an array per axis of centers and half extents
+class Scene {
+public:
+    Scene(uint32_t boxCount, uint32_t seed) : count(boxCount), rng(seed) {
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            centers[axis].resize(count);
+            extents[axis].resize(count);
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            for (uint32_t axis = 0; axis < 3; ++axis) {
+                centers[axis][i] = unit(rng) * 100.0f;
+                extents[axis][i] = 1.5f + unit(rng);
+            }
+        }
+    }
+
+    // every box drifts up to half a unit along each axis
+    void Move() {
+        std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+        for (uint32_t axis = 0; axis < 3; ++axis) {
+            for (float& center : centers[axis]) {
+                center += step(rng);
+            }
+        }
+    }
+
+    OcclusionCuller::Boxes GetBoxes() const {
+        return {
+            .pCenter = { centers[0].data(), centers[1].data(), centers[2].data() },
+            .pExtent = { extents[0].data(), extents[1].data(), extents[2].data() }
+        };
+    }
+
+    Float3 Lo(uint32_t i) const {
+        return { centers[0][i] - extents[0][i], centers[1][i] - extents[1][i], centers[2][i] - extents[2][i] };
+    }
+
+    Float3 Hi(uint32_t i) const {
+        return { centers[0][i] + extents[0][i], centers[1][i] + extents[1][i], centers[2][i] + extents[2][i] };
+    }
+
+    // the boxes that pass, one at a time
+    std::vector<uint32_t> Visible(const Frustum& frustum) const {
+        std::vector<uint32_t> visible;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            float center[3] = { centers[0][i], centers[1][i], centers[2][i] };
+            float extent[3] = { extents[0][i], extents[1][i], extents[2][i] };
+
+            if (frustum.TestBox(center, extent)) {
+                visible.push_back(i);
+            }
+        }
+
+        return visible;
+    }
+
+    uint32_t count;
+
+private:
+    std::mt19937       rng;
+    std::vector<float> centers[3];
+    std::vector<float> extents[3];
+};
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static void TestFrustum() {
+    Frustum frustum = ViewFrustum(70.0f);
+
+    struct Case
+    {
+        const char* name;
+        float       center[3];
+        float       extent[3];
+        bool        visible;
+    };
+
+    const Case cases[] = {
+        { "frustum: box at the target",         { 0.0f, 0.0f, 0.0f },      { 1.0f, 1.0f, 1.0f },    true  },
+        { "frustum: box behind the eye",        { 0.0f, 50.0f, -160.0f },  { 1.0f, 1.0f, 1.0f },    false },
+        { "frustum: box past the far plane",    { 0.0f, -100.0f, 400.0f }, { 1.0f, 1.0f, 1.0f },    false },
+        { "frustum: box far to the side",       { 500.0f, 0.0f, 0.0f },    { 1.0f, 1.0f, 1.0f },    false },
+        { "frustum: box around the eye",        { 0.0f, 50.0f, -150.0f },  { 5.0f, 5.0f, 5.0f },    true  },
+        { "frustum: large box reaching inside", { 500.0f, 0.0f, 0.0f },    { 450.0f, 1.0f, 1.0f },  true  },
+    };
+
+    for (const Case& c : cases) {
+        Check(frustum.TestBox(c.center, c.extent) == c.visible, c.name);
+    }
+
+    bool normalized = true;
+
+    for (const Frustum::Plane& plane : frustum.planes) {
+        normalized &= std::fabs(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z - 1.0f) < 1e-5f;
+    }
+
+    Check(normalized, "frustum: the plane normals are unit length");
+}
+
+static bool SameVisible(const std::vector<uint32_t>& expected, std::vector<uint32_t>& found, uint32_t foundCount) {
+    std::sort(found.begin(), found.begin() + foundCount);
+
+    return foundCount == expected.size() && std::equal(expected.begin(), expected.end(), found.begin());
+}
+
+//
+// Queries against loops over all boxes. The BVH tests the boxes it copied next to its leaves, whose
+// center and extent it recomputes from the corners, so the frustum reference does the same.
+//
+static bool QueriesMatch(const BoundingVolumeHierarchy& bvh, const Scene& scene, uint32_t seed) {
+    bool match = true;
+
+    std::vector<uint32_t> found(scene.count);
+
+    for (float fovY : { 70.0f, 10.0f }) {
+        Frustum frustum = ViewFrustum(fovY);
+
+        std::vector<uint32_t> expected;
+
+        for (uint32_t i = 0; i < scene.count; ++i) {
+            Float3 lo = scene.Lo(i), hi = scene.Hi(i);
+
+            float center[3] = { (lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f };
+            float extent[3] = { (hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f };
+
+            if (frustum.TestBox(center, extent)) {
+                expected.push_back(i);
+            }
+        }
+
+        match &= SameVisible(expected, found, bvh.QueryFrustum(frustum, found.data()));
+    }
+
+    std::mt19937                          rng(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    const Float3 origin = { 0.0f, 50.0f, -150.0f };
+
+    for (uint32_t r = 0; r < 64; ++r) {
+        Float3 direction = { unit(rng) * 100.0f, unit(rng) * 100.0f - 50.0f, unit(rng) * 100.0f + 150.0f };
+        Float3 inverse   = { 1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z };
+
+        float nearest = FLT_MAX;
+
+        for (uint32_t i = 0; i < scene.count; ++i) {
+            Float3 lo = scene.Lo(i), hi = scene.Hi(i);
+
+            float tx0 = (lo.x - origin.x) * inverse.x, tx1 = (hi.x - origin.x) * inverse.x;
+            float ty0 = (lo.y - origin.y) * inverse.y, ty1 = (hi.y - origin.y) * inverse.y;
+            float tz0 = (lo.z - origin.z) * inverse.z, tz1 = (hi.z - origin.z) * inverse.z;
+
+            float tEnter = (std::max)((std::max)((std::min)(tx0, tx1), (std::min)(ty0, ty1)), (std::max)((std::min)(tz0, tz1), 0.0f));
+            float tExit  = (std::min)((std::min)((std::max)(tx0, tx1), (std::max)(ty0, ty1)), (std::min)((std::max)(tz0, tz1), nearest));
+
+            if (tEnter <= tExit) {
+                nearest = tEnter;
+            }
+        }
+
+        uint32_t object = ~0u;
+        float    t      = FLT_MAX;
+        bool     hit    = bvh.Raycast(origin, direction, FLT_MAX, object, t);
+
+        match &= hit == (nearest < FLT_MAX) && (!hit || t == nearest);
+
+        if (hit) {
+            Float3 lo = scene.Lo(object), hi = scene.Hi(object);
+            Float3 at = { origin.x + direction.x * t, origin.y + direction.y * t, origin.z + direction.z * t };
+
+            // the object reported is one the ray enters there
+            const float slack = 1e-3f * (1.0f + t);
+
+            match &= at.x >= lo.x - slack && at.x <= hi.x + slack && at.y >= lo.y - slack && at.y <= hi.y + slack
+                     && at.z >= lo.z - slack && at.z <= hi.z + slack;
+        }
+
+        Float3 center = { unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f };
+        Float3 lo     = { center.x - 5.0f, center.y - 5.0f, center.z - 5.0f };
+        Float3 hi     = { center.x + 5.0f, center.y + 5.0f, center.z + 5.0f };
+
+        std::vector<uint32_t> expected;
+
+        for (uint32_t i = 0; i < scene.count; ++i) {
+            Float3 objectLo = scene.Lo(i), objectHi = scene.Hi(i);
+
+            if (objectLo.x <= hi.x && objectHi.x >= lo.x && objectLo.y <= hi.y && objectHi.y >= lo.y && objectLo.z <= hi.z && objectHi.z >= lo.z) {
+                expected.push_back(i);
+            }
+        }
+
+        match &= SameVisible(expected, found, bvh.QueryBox(lo, hi, found.data()));
+    }
+
+    return match;
+}
+
+static void TestBvh() {
+    for (uint32_t count : { 1u, 5u, 1000u, 50'000u }) {
+        Scene scene(count, count);
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Init();
+        bvh.Build(scene.GetBoxes(), count);
+
+        Check(bvh.GetObjectCount() == count, "bvh: the build covers every object");
+        Check(bvh.GetNodeCount() >= 1 && bvh.GetNodeCount() < 2 * count, "bvh: fewer nodes than twice the objects");
+        Check(QueriesMatch(bvh, scene, 1), "bvh: queries after a build find what a loop over the boxes finds");
+
+        // the same objects again, on the builder thread
+        Check(bvh.RequestRebuild(scene.GetBoxes(), count), "bvh: a rebuild is requested");
+        Check(!bvh.RequestRebuild(scene.GetBoxes(), count), "bvh: a second rebuild waits for the first");
+
+        while (!bvh.ApplyRebuild(scene.GetBoxes())) {
+            std::this_thread::yield();
+        }
+
+        Check(!bvh.IsRebuilding(), "bvh: nothing is rebuilding once the rebuild is applied");
+        Check(bvh.GetStats().rebuilds == 1, "bvh: the rebuild is counted");
+        Check(QueriesMatch(bvh, scene, 2), "bvh: queries after a rebuild find what a loop over the boxes finds");
+
+        // the boxes move, one tree only refits and the other rotates too
+        BoundingVolumeHierarchy rotated;
+        rotated.Build(scene.GetBoxes(), count);
+
+        bool refitMatch   = true;
+        bool rotatedMatch = true;
+
+        for (uint32_t step = 0; step < 10; ++step) {
+            scene.Move();
+
+            bvh.Refit(scene.GetBoxes(), false);
+            rotated.Refit(scene.GetBoxes(), true);
+        }
+
+        refitMatch   &= QueriesMatch(bvh, scene, 3);
+        rotatedMatch &= QueriesMatch(rotated, scene, 3);
+
+        Check(refitMatch, "bvh: queries after refits find what a loop over the boxes finds");
+        Check(rotatedMatch, "bvh: queries after refits with rotations find what a loop over the boxes finds");
+        Check(rotated.GetCost() <= bvh.GetCost() * 1.0001f, "bvh: rotations don't make the tree worse than refitting alone");
+
+        if (count == 50'000) {
+            std::cout << "bvh: " << count << " objects, " << bvh.GetNodeCount() << " nodes, SAH cost " << bvh.GetBuiltCost() << " built, "
+                      << bvh.GetCost() << " after 10 moves, " << rotated.GetCost() << " with " << rotated.GetStats().rotations << " rotations" << std::endl;
+        }
+
+        rotated.Destroy();
+        bvh.Destroy();
+    }
+
+    // nothing built: nothing found
+    BoundingVolumeHierarchy empty;
+
+    uint32_t object = 0;
+    float    t      = 0.0f;
+
+    Check(empty.QueryFrustum(ViewFrustum(70.0f), nullptr) == 0, "bvh: an empty tree finds nothing in a frustum");
+    Check(empty.QueryBox({ -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f }, nullptr) == 0, "bvh: an empty tree finds nothing in a box");
+    Check(!empty.Raycast({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, FLT_MAX, object, t), "bvh: an empty tree has nothing to hit");
+}
+
+// the instance slots past each command's count are left as they were, so compare the drawn ones
+static bool SameDraws(const std::vector<IndirectDraws::Command>& aCommands, uint32_t aCount, const std::vector<uint32_t>& aInstances,
+                      const std::vector<IndirectDraws::Command>& bCommands, uint32_t bCount, const std::vector<uint32_t>& bInstances) {
+    if (aCount != bCount) {
+        return false;
+    }
+
+    for (uint32_t c = 0; c < aCount; ++c) {
+        const IndirectDraws::Command& a = aCommands[c];
+        const IndirectDraws::Command& b = bCommands[c];
+
+        if (a.firstInstance != b.firstInstance || memcmp(&a.draw, &b.draw, sizeof(a.draw)) != 0
+            || !std::equal(aInstances.begin() + a.firstInstance, aInstances.begin() + a.firstInstance + a.draw.InstanceCount,
+                           bInstances.begin() + b.firstInstance)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void TestIndirectDraws(JobSystem& jobSystem) {
+    using Command = IndirectDraws::Command;
+
+    const uint32_t indexCount = 12;
+
+    static_assert(sizeof(Command) == 24, "the command signature's stride");
+
+    for (float fovY : { 70.0f, 10.0f }) {
+        for (uint32_t count : { 1u, 63u, 64u, 10'007u, 100'000u }) {
+            Scene   scene(count, 42);
+            Frustum frustum = ViewFrustum(fovY);
+
+            std::vector<uint32_t> visible = scene.Visible(frustum);
+
+            uint32_t maxCommands = IndirectDraws::MaxCommands(count);
+
+            std::vector<Command>  referenceCommands(maxCommands), serialCommands(maxCommands);
+            std::vector<uint32_t> referenceInstances(count), serialInstances(count);
+
+            uint32_t referenceCount = IndirectDraws::Generate(scene.GetBoxes(), frustum, count, indexCount, referenceCommands.data(), referenceInstances.data());
+            uint32_t serialCount    = IndirectDraws::Build(visible.data(), uint32_t(visible.size()), indexCount, serialCommands.data(), serialInstances.data());
+
+            Check(SameDraws(referenceCommands, referenceCount, referenceInstances, serialCommands, serialCount, serialInstances),
+                  "indirect: Build() from the visible list writes what Generate() does");
+
+            // grains that do and don't split the list on group boundaries
+            bool parallelMatch = true;
+
+            for (uint32_t grain : { 1u, 64u, 100u, 4096u }) {
+                IndirectDraws         draws;
+                std::vector<Command>  parallelCommands(maxCommands);
+                std::vector<uint32_t> parallelInstances(count);
+
+                uint32_t parallelCount = draws.Build(jobSystem, grain, visible.data(), uint32_t(visible.size()), indexCount, parallelCommands.data(), parallelInstances.data());
+
+                parallelMatch &= SameDraws(referenceCommands, referenceCount, referenceInstances, parallelCommands, parallelCount, parallelInstances);
+            }
+
+            Check(parallelMatch, "indirect: Build() on jobs writes what Generate() does");
+
+            std::vector<uint8_t> drawn;
+
+            bool valid = IndirectDraws::Expand(referenceCommands.data(), referenceCount, referenceInstances.data(), count, indexCount, drawn);
+
+            uint32_t drawnCount = uint32_t(std::count(drawn.begin(), drawn.end(), uint8_t(1)));
+            bool     allDrawn   = true;
+
+            for (uint32_t object : visible) {
+                allDrawn &= drawn[object] == 1;
+            }
+
+            Check(valid, "indirect: the commands are well formed");
+            Check(allDrawn && drawnCount == visible.size(), "indirect: the commands draw exactly the visible objects");
+            Check(referenceCount <= maxCommands, "indirect: no more commands than groups");
+
+            if (fovY == 70.0f && count == 100'000) {
+                std::cout << "indirect: " << count << " objects, " << visible.size() << " visible in " << referenceCount << " commands" << std::endl;
+            }
+        }
+    }
+
+    // nothing visible, no commands
+    IndirectDraws draws;
+    Command       command  = {};
+    uint32_t      instance = 0;
+
+    Check(IndirectDraws::Build(nullptr, 0, indexCount, &command, &instance) == 0, "indirect: an empty list has no commands");
+    Check(draws.Build(jobSystem, 64, nullptr, 0, indexCount, &command, &instance) == 0, "indirect: an empty list has no commands on jobs");
+
+    // what Expand() has to turn down: objects 0, 1 and 65 of 128
+    std::vector<uint32_t> instances(128, 0);
+    instances[0]  = 0;
+    instances[1]  = 1;
+    instances[64] = 65;
+
+    const Command good[] = { { 0, { indexCount, 2, 0, 0, 0 } }, { 64, { indexCount, 1, 0, 0, 0 } } };
+
+    std::vector<uint8_t> drawn;
+
+    Check(IndirectDraws::Expand(good, 2, instances.data(), 128, indexCount, drawn) && drawn[0] && drawn[1] && drawn[65], "indirect: good commands expand");
+
+    struct Case
+    {
+        const char* name;
+        Command     command;
+        uint32_t    slot0;
+    };
+
+    const Case cases[] = {
+        { "indirect: no instances are malformed",                 { 0, { indexCount, 0, 0, 0, 0 } },      0  },
+        { "indirect: another index count is malformed",           { 0, { indexCount + 3, 2, 0, 0, 0 } },  0  },
+        { "indirect: a first instance off the grid is malformed", { 1, { indexCount, 1, 0, 0, 0 } },      0  },
+        { "indirect: more than a group is malformed",             { 0, { indexCount, 65, 0, 0, 0 } },     0  },
+        { "indirect: an object of another group is malformed",    { 0, { indexCount, 2, 0, 0, 0 } },      70 },
+        { "indirect: an object drawn twice is malformed",         { 0, { indexCount, 2, 0, 0, 0 } },      1  },
+    };
+
+    for (const Case& c : cases) {
+        std::vector<uint32_t> bad = instances;
+        bad[0] = c.slot0;
+
+        Check(!IndirectDraws::Expand(&c.command, 1, bad.data(), 128, indexCount, drawn), c.name);
+    }
+}
+
+int main() {
+    std::cout << "Frustum, BoundingVolumeHierarchy, IndirectDraws" << std::endl;
+
+    JobSystem jobSystem;
+    jobSystem.Init(3);
+
+    TestFrustum();
+    TestBvh();
+    TestIndirectDraws(jobSystem);
+
+    jobSystem.Destroy();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
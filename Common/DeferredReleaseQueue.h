@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+//
+// Like the apps' DeletionQueue, but each entry is keyed on the fence value after which
+// the GPU can no longer be referencing the object. Values must be appended in
+// non-decreasing order.
+//
+class DeferredReleaseQueue {
+public:
+    using Fn    = std::function<void()>;
+    using Queue = std::deque<std::pair<uint64_t, Fn>>;
+
+    template<typename Fn>
+    void Append(uint64_t fenceValue, Fn&& fn) {
+        q.emplace_back(fenceValue, fn);
+    }
+
+    void Collect(uint64_t completedValue) {
+        while (!q.empty() && q.front().first <= completedValue) {
+            q.front().second();
+            q.pop_front();
+        }
+    }
+
+    void Finalize() {
+        for (auto& entry : q) {
+            entry.second();
+        }
+
+        q.clear();
+    }
+
+private:
+    Queue q;
+};
@@ -0,0 +1,265 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+
+//
+// Min and max depth pyramid: the CPU reference of RotatingPyramid's GenHiZ (Mipgen.hlsl), which has
+// to match it exactly, and the software side of CullHiZ (Cull.hlsl). Level 0 is half the depth buffer rounded
+// up, every level half the one before, down to 1x1. A texel reduces the 2x2 below it, clamped to
+// the edge, so it covers exactly the depth pixels under it, including an odd last row or column.
+// TestBox() projects a box and goes to the level where its pixel rectangle spans at most 2x2
+// texels. The box is hidden if its nearest depth is behind the farthest depth of those texels.
+// Points and matrices are laid out as in OcclusionCuller.
+//
+class DepthPyramid {
+public:
+    static constexpr uint32_t MAX_LEVELS = 15;      // keep in sync with Mipgen.hlsl
+
+    // the GPU pyramid keeps one or both, in R32_FLOAT or R32G32_FLOAT; the values are the shader's
+    enum class Reduction : uint32_t {
+        Min,
+        Max,
+        MinMax
+    };
+
+    // a texel: the nearest and farthest depth under it
+    struct Texel
+    {
+        float lo;
+        float hi;
+    };
+
+    static uint32_t LevelSize(uint32_t depthSize, uint32_t level) {
+        return (std::max)((depthSize + (2u << level) - 1) >> (level + 1), 1u);
+    }
+
+    static uint32_t LevelCount(uint32_t depthWidth, uint32_t depthHeight) {
+        uint32_t levels = 1;
+
+        while (levels < MAX_LEVELS && (LevelSize(depthWidth, levels - 1) > 1 || LevelSize(depthHeight, levels - 1) > 1)) {
+            ++levels;
+        }
+
+        return levels;
+    }
+
+    // depth of rowPitch bytes per row
+    void Build(const float* pDepth, uint32_t depthWidth, uint32_t depthHeight, size_t rowPitch) {
+        Resize(depthWidth, depthHeight);
+
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            ReduceRows(pDepth, rowPitch, level, 0, height[level]);
+        }
+    }
+
+    // each level over the job system, in rows
+    void Build(JobSystem& jobs, const float* pDepth, uint32_t depthWidth, uint32_t depthHeight, size_t rowPitch) {
+        Resize(depthWidth, depthHeight);
+
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            uint32_t grain = (std::max)(ROW_TEXELS / width[level], 1u);
+
+            jobs.ParallelFor(0, height[level], grain, [&](uint64_t first, uint64_t last) {
+                ReduceRows(pDepth, rowPitch, level, uint32_t(first), uint32_t(last));
+            });
+        }
+    }
+
+    uint32_t GetLevelCount() const {
+        return levelCount;
+    }
+
+    uint32_t GetWidth(uint32_t level) const {
+        return width[level];
+    }
+
+    uint32_t GetHeight(uint32_t level) const {
+        return height[level];
+    }
+
+    // GetWidth(level) per row
+    const Texel* Get(uint32_t level) const {
+        return levels[level].data();
+    }
+
+    // texels of a GPU level (rowPitch bytes per row, one or two floats each) that differ
+    uint32_t Compare(uint32_t level, Reduction reduction, const uint8_t* pTexels, size_t rowPitch) const {
+        uint32_t mismatches = 0;
+
+        for (uint32_t y = 0; y < height[level]; ++y) {
+            const float* pRow = reinterpret_cast<const float*>(pTexels + y * rowPitch);
+            const Texel* pRef = levels[level].data() + size_t(y) * width[level];
+
+            for (uint32_t x = 0; x < width[level]; ++x) {
+                bool match = reduction == Reduction::Min    ? pRow[x] == pRef[x].lo
+                           : reduction == Reduction::Max    ? pRow[x] == pRef[x].hi
+                                                            : pRow[2 * x] == pRef[x].lo && pRow[2 * x + 1] == pRef[x].hi;
+
+                mismatches += match ? 0 : 1;
+            }
+        }
+
+        return mismatches;
+    }
+
+    // false if the box (world space center and half extents) is hidden or off screen
+    bool TestBox(const float* pCenter, const float* pExtent, const float (&viewProj)[4][4]) const {
+        float xMin = FLT_MAX, xMax = -FLT_MAX, yMin = FLT_MAX, yMax = -FLT_MAX, zMin = FLT_MAX;
+
+        for (uint32_t corner = 0; corner < 8; ++corner) {
+            float p[3] = {
+                pCenter[0] + (corner & 1 ? pExtent[0] : -pExtent[0]),
+                pCenter[1] + (corner & 2 ? pExtent[1] : -pExtent[1]),
+                pCenter[2] + (corner & 4 ? pExtent[2] : -pExtent[2])
+            };
+
+            float clip[4];
+
+            for (uint32_t c = 0; c < 4; ++c) {
+                clip[c] = p[0] * viewProj[0][c] + p[1] * viewProj[1][c] + p[2] * viewProj[2][c] + viewProj[3][c];
+            }
+
+            // reaches behind the near plane, can't be tested
+            if (clip[3] < NEAR_W || clip[2] < 0.0f) {
+                return true;
+            }
+
+            float invW = 1.0f / clip[3];
+            float x    = (clip[0] * invW * 0.5f + 0.5f) * depthWidth;
+            float y    = (0.5f - clip[1] * invW * 0.5f) * depthHeight;
+
+            xMin = (std::min)(xMin, x);
+            xMax = (std::max)(xMax, x);
+            yMin = (std::min)(yMin, y);
+            yMax = (std::max)(yMax, y);
+            zMin = (std::min)(zMin, clip[2] * invW);
+        }
+
+        // depth pixels the rectangle touches, none when off screen
+        int x0 = int((std::max)(floorf(xMin), 0.0f));
+        int y0 = int((std::max)(floorf(yMin), 0.0f));
+        int x1 = int((std::min)(floorf(xMax), float(depthWidth) - 1.0f));
+        int y1 = int((std::min)(floorf(yMax), float(depthHeight) - 1.0f));
+
+        if (x0 > x1 || y0 > y1) {
+            return false;
+        }
+
+        // a level L texel is 2^(L + 1) pixels across, enough for the span to touch two at most
+        uint32_t span  = uint32_t((std::max)(x1 - x0, y1 - y0)) + 1;
+        uint32_t level = (std::min)(span > 1 ? uint32_t(std::bit_width(span - 1)) - 1 : 0u, levelCount - 1);
+
+        float farthest = 0.0f;
+
+        for (int y = y0 >> (level + 1); y <= y1 >> (level + 1); ++y) {
+            for (int x = x0 >> (level + 1); x <= x1 >> (level + 1); ++x) {
+                farthest = (std::max)(farthest, levels[level][size_t(y) * width[level] + x].hi);
+            }
+        }
+
+        return zMin < farthest;
+    }
+
+    //
+    // Keeps the objects (indices into bounds) that TestBox() passes, in order, and returns how many.
+    // grain objects per job; chunks filter in place and then close the gaps.
+    //
+    uint32_t Test(JobSystem& jobs, uint32_t grain, const OcclusionCuller::Boxes& bounds, const float (&viewProj)[4][4], uint32_t* pObjects, uint32_t count) {
+        grain = (std::max)(grain, 1u);
+
+        uint32_t chunks = (count + grain - 1) / grain;
+        chunkKept.resize(chunks);
+
+        jobs.ParallelFor(0, count, grain, [&](uint64_t first, uint64_t last) {
+            uint32_t kept = 0;
+
+            for (uint64_t n = first; n < last; ++n) {
+                uint32_t i = pObjects[n];
+
+                float center[3] = { bounds.pCenter[0][i], bounds.pCenter[1][i], bounds.pCenter[2][i] };
+                float extent[3] = { bounds.pExtent[0][i], bounds.pExtent[1][i], bounds.pExtent[2][i] };
+
+                if (TestBox(center, extent, viewProj)) {
+                    pObjects[first + kept++] = i;
+                }
+            }
+
+            chunkKept[first / grain] = kept;
+        });
+
+        uint32_t kept = 0;
+
+        for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+            if (kept != chunk * grain) {
+                memmove(pObjects + kept, pObjects + chunk * grain, chunkKept[chunk] * sizeof(uint32_t));
+            }
+
+            kept += chunkKept[chunk];
+        }
+
+        return kept;
+    }
+
+private:
+    static constexpr float    NEAR_W     = 1e-4f;       // keep in sync with Cull.hlsl
+    static constexpr uint32_t ROW_TEXELS = 16 * 1024;   // texels per job
+
+    void Resize(uint32_t newDepthWidth, uint32_t newDepthHeight) {
+        depthWidth  = newDepthWidth;
+        depthHeight = newDepthHeight;
+        levelCount  = LevelCount(depthWidth, depthHeight);
+
+        for (uint32_t level = 0; level < levelCount; ++level) {
+            width[level]  = LevelSize(depthWidth, level);
+            height[level] = LevelSize(depthHeight, level);
+
+            levels[level].resize(size_t(width[level]) * height[level]);
+        }
+    }
+
+    // rows [first, last) of a level, level 0 out of the depth buffer
+    void ReduceRows(const float* pDepth, size_t rowPitch, uint32_t level, uint32_t first, uint32_t last) {
+        uint32_t srcWidth  = level == 0 ? depthWidth : width[level - 1];
+        uint32_t srcHeight = level == 0 ? depthHeight : height[level - 1];
+
+        auto Source = [&](uint32_t x, uint32_t y) {
+            x = (std::min)(x, srcWidth - 1);
+            y = (std::min)(y, srcHeight - 1);
+
+            if (level == 0) {
+                float depth = *reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pDepth) + y * rowPitch + x * sizeof(float));
+                return Texel { depth, depth };
+            }
+
+            return levels[level - 1][size_t(y) * srcWidth + x];
+        };
+
+        for (uint32_t y = first; y < last; ++y) {
+            Texel* pRow = levels[level].data() + size_t(y) * width[level];
+
+            for (uint32_t x = 0; x < width[level]; ++x) {
+                Texel a = Source(2 * x, 2 * y), b = Source(2 * x + 1, 2 * y);
+                Texel c = Source(2 * x, 2 * y + 1), d = Source(2 * x + 1, 2 * y + 1);
+
+                pRow[x] = { (std::min)((std::min)(a.lo, b.lo), (std::min)(c.lo, d.lo)), (std::max)((std::max)(a.hi, b.hi), (std::max)(c.hi, d.hi)) };
+            }
+        }
+    }
+
+    uint32_t              depthWidth  = 0;
+    uint32_t              depthHeight = 0;
+    uint32_t              levelCount  = 0;
+    uint32_t              width[MAX_LEVELS]  = {};
+    uint32_t              height[MAX_LEVELS] = {};
+    std::vector<Texel>    levels[MAX_LEVELS];
+    std::vector<uint32_t> chunkKept;            // per chunk of the last Test()
+};
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+//
+// Smooths feedback over time before it reaches the streamer. Every region keeps an exponentially
+// decaying history of the mip it asked for (unsampled counts as the coarsest) and a target mip that
+// only moves when the history leaves a band around it: finer once it gets promoteThreshold below the
+// target, coarser once it gets demoteThreshold above it, and not for minResidentUpdates updates after
+// the target last got finer. Out comes a feedback map of targets, so regions that flicker between
+// two mips (an animated object, a dithered feedback pattern) stop loading and dropping the same tiles.
+//
+class FeedbackAggregator {
+public:
+    struct Policy {
+        float    historyWeight;         // weight of the newest feedback, 1: no history
+        float    promoteThreshold;      // mips below the target before it gets finer
+        float    demoteThreshold;       // mips above the target before it gets coarser, keep below 1 or the target can stay too fine
+        uint32_t minResidentUpdates;    // updates a target stays after getting finer
+    };
+
+    static constexpr Policy RAW        = { 1.0f,  0.0f, 0.0f, 0 };
+    static constexpr Policy HYSTERESIS = { 0.25f, 0.5f, 0.75f, 30 };
+
+    void Init(uint32_t regionsX, uint32_t regionsY, uint8_t coarsest, const Policy& aggregatorPolicy) {
+        width       = regionsX;
+        height      = regionsY;
+        coarsestMip = coarsest;
+        policy      = aggregatorPolicy;
+        update      = 0;
+
+        size_t count = size_t(width) * height;
+
+        history.assign(count, float(coarsestMip));
+        target.assign(count, coarsestMip);
+        promoted.assign(count, 0);
+    }
+
+    // feedback rows are feedbackPitch apart; returns targets, width bytes per row
+    const uint8_t* Update(const uint8_t* feedback, size_t feedbackPitch) {
+        ++update;
+
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* pWanted = feedback + y * feedbackPitch;
+
+            for (uint32_t x = 0; x < width; ++x) {
+                size_t r = size_t(y) * width + x;
+
+                float wanted = float((std::min)(pWanted[x], coarsestMip));
+
+                history[r] += policy.historyWeight * (wanted - history[r]);
+
+                float current = float(target[r]);
+
+                if (history[r] <= current - policy.promoteThreshold && floorf(history[r]) < current) {
+                    target[r]   = static_cast<uint8_t>(floorf(history[r]));
+                    promoted[r] = update;
+                    statPromotes += 1;
+                }
+                else if (history[r] > current + policy.demoteThreshold && update - promoted[r] >= policy.minResidentUpdates) {
+                    float demoted = (std::max)(ceilf(history[r] - policy.demoteThreshold), current + 1.0f);
+
+                    target[r] = static_cast<uint8_t>((std::min)(demoted, float(coarsestMip)));
+                    statDemotes += 1;
+                }
+            }
+        }
+
+        statUpdates += 1;
+
+        return target.data();
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (statUpdates == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Aggregator: " << float(statPromotes) / statUpdates << " promotes, " << float(statDemotes) / statUpdates
+                  << " demotes per update" << std::endl;
+
+        statUpdates  = 0;
+        statPromotes = 0;
+        statDemotes  = 0;
+        statStart    = now;
+    }
+
+private:
+    uint32_t                              width        = 0;
+    uint32_t                              height       = 0;
+    uint8_t                               coarsestMip  = 0;
+    Policy                                policy       = RAW;
+    uint64_t                              update       = 0;
+
+    std::vector<float>                    history;
+    std::vector<uint8_t>                  target;
+    std::vector<uint64_t>                 promoted;     // update the target last got finer
+
+    uint64_t                              statUpdates  = 0;
+    uint64_t                              statPromotes = 0;
+    uint64_t                              statDemotes  = 0;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
+
+//
+// Raw feedback maps as the app processed them, for replaying through AggregationTest. A header
+// (regions across and down, standard mip count) followed by one tightly packed map per update.
+//
+class FeedbackTrace {
+public:
+    struct Header {
+        uint32_t magic;
+        uint32_t regionsX;
+        uint32_t regionsY;
+        uint32_t standardMips;
+    };
+
+    static constexpr uint32_t MAGIC = 0x52544653;   // "SFTR"
+
+    bool Create(const std::string& path, uint32_t regionsX, uint32_t regionsY, uint32_t standardMips) {
+        file.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        header = { MAGIC, regionsX, regionsY, standardMips };
+        file.write(reinterpret_cast<const char*>(&header), sizeof header);
+
+        return bool(file);
+    }
+
+    void Append(const uint8_t* feedback, size_t feedbackPitch) {
+        for (uint32_t y = 0; y < header.regionsY; ++y) {
+            file.write(reinterpret_cast<const char*>(feedback + y * feedbackPitch), header.regionsX);
+        }
+    }
+
+    // whole trace, maps back to back
+    static bool Load(const std::string& path, Header& header, std::vector<uint8_t>& maps) {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof header) || header.magic != MAGIC) {
+            return false;
+        }
+
+        maps.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+
+        size_t mapSize = size_t(header.regionsX) * header.regionsY;
+
+        maps.resize(mapSize ? maps.size() / mapSize * mapSize : 0);
+
+        return !maps.empty();
+    }
+
+    bool IsOpen() const {
+        return file.is_open();
+    }
+
+private:
+    std::ofstream file;
+    Header        header = {};
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//
+// Turns decoded MinMip feedback into residency requests. Feedback holds, per mip region, the finest
+// mip sampled (0xFF: not sampled at all); the residency map holds the finest mip resident in the
+// region. Regions asking for finer data produce a load of the next finer mip (streaming refines
+// coarse to fine), regions resident finer than needed produce an eviction of their finest mip.
+// The compare runs 32 (AVX2) or 16 (SSE2) regions at a time, only differing regions leave the
+// vector loop.
+//
+class FeedbackProcessor {
+public:
+    struct Request {
+        uint32_t texture;
+        uint16_t regionX;
+        uint16_t regionY;
+        uint8_t  mip;           // load: mip to bring in, evict: mip to drop
+        bool     load;
+        uint8_t  priority;      // mip levels between requested and resident, larger first
+    };
+
+    void Begin() {
+        requests.clear();
+        start = std::chrono::steady_clock::now();
+    }
+
+    //
+    // width x height regions. Residency is tightly packed, feedback rows are feedbackPitch apart.
+    // Nothing coarser than coarsestMip (the packed mip tail) is ever requested or evicted.
+    //
+    void Process(uint32_t texture, const uint8_t* feedback, size_t feedbackPitch, const uint8_t* residency,
+                 uint32_t width, uint32_t height, uint8_t coarsestMip) {
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* pWanted   = feedback + y * feedbackPitch;
+            const uint8_t* pResident = residency + y * width;
+
+            uint32_t x = 0;
+
+#if defined(__AVX2__)
+            const __m256i coarsest256 = _mm256_set1_epi8(static_cast<char>(coarsestMip));
+
+            for (; x + 32 <= width; x += 32) {
+                __m256i wanted   = _mm256_min_epu8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(pWanted + x)), coarsest256);
+                __m256i resident = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pResident + x));
+
+                __m256i same     = _mm256_cmpeq_epi8(wanted, resident);
+                __m256i finer    = _mm256_cmpeq_epi8(_mm256_min_epu8(wanted, resident), wanted);    // wanted <= resident
+
+                uint32_t loads   = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(same, finer)));
+                uint32_t evicts  = ~static_cast<uint32_t>(_mm256_movemask_epi8(finer));
+
+                EmitMasked(texture, x, y, pWanted, pResident, coarsestMip, loads, evicts);
+            }
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+            const __m128i coarsest128 = _mm_set1_epi8(static_cast<char>(coarsestMip));
+
+            for (; x + 16 <= width; x += 16) {
+                __m128i wanted   = _mm_min_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pWanted + x)), coarsest128);
+                __m128i resident = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pResident + x));
+
+                __m128i same     = _mm_cmpeq_epi8(wanted, resident);
+                __m128i finer    = _mm_cmpeq_epi8(_mm_min_epu8(wanted, resident), wanted);
+
+                uint32_t loads   = static_cast<uint32_t>(_mm_movemask_epi8(_mm_andnot_si128(same, finer)));
+                uint32_t evicts  = ~static_cast<uint32_t>(_mm_movemask_epi8(finer)) & 0xFFFF;
+
+                EmitMasked(texture, x, y, pWanted, pResident, coarsestMip, loads, evicts);
+            }
+#endif
+
+            ProcessScalar(texture, x, width, y, pWanted, pResident, coarsestMip);
+        }
+    }
+
+    // reference path, same output as Process (in the same order)
+    void ProcessReference(uint32_t texture, const uint8_t* feedback, size_t feedbackPitch, const uint8_t* residency,
+                          uint32_t width, uint32_t height, uint8_t coarsestMip) {
+        for (uint32_t y = 0; y < height; ++y) {
+            ProcessScalar(texture, 0, width, y, feedback + y * feedbackPitch, residency + y * width, coarsestMip);
+        }
+    }
+
+    // sorts loads first, most urgent first
+    const std::vector<Request>& Finish() {
+        std::sort(requests.begin(), requests.end(), [](const Request& a, const Request& b) {
+            return a.load != b.load ? a.load : a.priority > b.priority;
+        });
+
+        float decodeUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        for (const auto& request : requests) {
+            (request.load ? statLoads : statEvicts) += 1;
+        }
+
+        statFrames   += 1;
+        statDecodeUs += decodeUs;
+
+        return requests;
+    }
+
+    const std::vector<Request>& GetRequests() const {
+        return requests;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (statFrames == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Feedback: " << float(statLoads) / statFrames << " loads, " << float(statEvicts) / statFrames
+                  << " evicts per frame, decode " << statDecodeUs / statFrames << " us" << std::endl;
+
+        statFrames   = 0;
+        statLoads    = 0;
+        statEvicts   = 0;
+        statDecodeUs = 0.0f;
+        statStart    = now;
+    }
+
+private:
+    void Emit(uint32_t texture, uint32_t x, uint32_t y, uint8_t wanted, uint8_t resident) {
+        if (wanted < resident) {
+            requests.push_back({ texture, uint16_t(x), uint16_t(y), uint8_t(resident - 1), true, uint8_t(resident - wanted) });
+        }
+        else {
+            requests.push_back({ texture, uint16_t(x), uint16_t(y), resident, false, uint8_t(wanted - resident) });
+        }
+    }
+
+    void EmitMasked(uint32_t texture, uint32_t x, uint32_t y, const uint8_t* pWanted, const uint8_t* pResident,
+                    uint8_t coarsestMip, uint32_t loads, uint32_t evicts) {
+        // keep row order so both paths produce the same sequence
+        for (uint32_t diff = loads | evicts; diff != 0; diff &= diff - 1) {
+            uint32_t i = static_cast<uint32_t>(std::countr_zero(diff));
+
+            Emit(texture, x + i, y, (std::min)(pWanted[x + i], coarsestMip), pResident[x + i]);
+        }
+    }
+
+    void ProcessScalar(uint32_t texture, uint32_t x, uint32_t width, uint32_t y, const uint8_t* pWanted,
+                       const uint8_t* pResident, uint8_t coarsestMip) {
+        for (; x < width; ++x) {
+            uint8_t wanted = (std::min)(pWanted[x], coarsestMip);
+
+            if (wanted != pResident[x]) {
+                Emit(texture, x, y, wanted, pResident[x]);
+            }
+        }
+    }
+
+    std::vector<Request>                  requests;
+    std::chrono::steady_clock::time_point start;
+
+    uint64_t                              statFrames   = 0;
+    uint64_t                              statLoads    = 0;
+    uint64_t                              statEvicts   = 0;
+    float                                 statDecodeUs = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
@@ -0,0 +1,294 @@
+#include "AsyncFileReader.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+//
+// SamplerFeedback's former --bench=fileio: reads a 256 MB file into page aligned memory (standing in
+// for an upload heap) with std::ifstream, a mapped view (memcpy out of it), and AsyncFileReader on the
+// native queue (direct and buffered) and on worker threads; as 1 MB chunks in order and as 64 KB reads
+// in random order, the way tiles stream. Cold runs rewrite the file unbuffered first, which leaves
+// none of it in the file cache; warm runs read it once through the cache beforehand. Direct reads
+// bypass the cache, so their cold and warm numbers should match. Reports GB/s, checks nothing.
+//
+
+static uint8_t* AllocatePages(uint64_t size) {
+#ifdef _WIN32
+    return static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+    void* pPages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return pPages != MAP_FAILED ? static_cast<uint8_t*>(pPages) : nullptr;
+#endif
+}
+
+static void FreePages(uint8_t* pPages, uint64_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(pPages, 0, MEM_RELEASE);
+#else
+    munmap(pPages, size);
+#endif
+}
+
+// writes around the file cache, and drops whatever of the file it still holds
+static bool WriteUnbuffered(const std::string& name, const uint8_t* pSource, uint64_t fileSize) {
+    const uint64_t chunk = 8 << 20;
+
+    bool ok = true;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(name.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    for (uint64_t offset = 0; offset < fileSize && ok; offset += chunk) {
+        DWORD written = 0;
+        ok = WriteFile(file, pSource + offset, DWORD(chunk), &written, nullptr) && written == chunk;
+    }
+
+    CloseHandle(file);
+#else
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+#ifdef O_DIRECT
+    flags |= O_DIRECT;
+#endif
+
+    int fd = open(name.c_str(), flags, 0644);
+
+    if (fd < 0) {
+        fd = open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+
+    if (fd < 0) {
+        return false;
+    }
+
+    for (uint64_t offset = 0; offset < fileSize && ok; offset += chunk) {
+        ok = pwrite(fd, pSource + offset, chunk, off_t(offset)) == ssize_t(chunk);
+    }
+
+    ok = ok && fdatasync(fd) == 0;
+
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+
+    close(fd);
+#endif
+
+    return ok;
+}
+
+// a mapped view of the whole file, memcpy'd out of in chunk order
+static bool ReadMapped(const std::string& name, uint8_t* pDest, const std::vector<std::pair<uint64_t, uint64_t>>& chunks) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    HANDLE      mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* pView   = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+    if (pView) {
+        for (const auto& [offset, size] : chunks) {
+            memcpy(pDest + offset, static_cast<const uint8_t*>(pView) + offset, size);
+        }
+
+        UnmapViewOfFile(pView);
+    }
+
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(file);
+    return pView != nullptr;
+#else
+    int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    void* pView = size > 0 ? mmap(nullptr, size_t(size), PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+
+    if (pView != MAP_FAILED) {
+        for (const auto& [offset, chunkSize] : chunks) {
+            memcpy(pDest + offset, static_cast<const uint8_t*>(pView) + offset, chunkSize);
+        }
+
+        munmap(pView, size_t(size));
+    }
+
+    close(fd);
+    return pView != MAP_FAILED;
+#endif
+}
+
+int main() {
+    using namespace std::chrono;
+
+    const std::string name     = "fileio.bench";
+    const uint64_t    fileSize = 256ull << 20;
+
+    uint8_t* pSource = AllocatePages(fileSize);
+    uint8_t* pDest   = AllocatePages(fileSize);
+
+    if (!pSource || !pDest) {
+        std::cerr << "Could not allocate file I/O buffers" << std::endl;
+        return 1;
+    }
+
+    for (uint64_t i = 0; i < fileSize; i += sizeof(uint32_t)) {
+        *reinterpret_cast<uint32_t*>(pSource + i) = static_cast<uint32_t>(i * 2654435761ull);
+    }
+
+    if (!WriteUnbuffered(name, pSource, fileSize)) {
+        std::cerr << "Could not write " << name << std::endl;
+        FreePages(pSource, fileSize);
+        FreePages(pDest, fileSize);
+        return 1;
+    }
+
+    using Chunks = std::vector<std::pair<uint64_t, uint64_t>>;     // offset, size
+
+    auto MakeChunks = [&](uint64_t chunkSize, bool shuffle) {
+        Chunks chunks;
+
+        for (uint64_t offset = 0; offset < fileSize; offset += chunkSize) {
+            chunks.push_back({ offset, chunkSize });
+        }
+
+        if (shuffle) {
+            std::shuffle(chunks.begin(), chunks.end(), std::mt19937(7));
+        }
+
+        return chunks;
+    };
+
+    auto ReadStream = [&](const Chunks& chunks) {
+        std::ifstream in(name, std::ios::in | std::ios::binary);
+
+        for (const auto& [offset, size] : chunks) {
+            in.seekg(std::streamoff(offset));
+            in.read(reinterpret_cast<char*>(pDest + offset), std::streamsize(size));
+        }
+
+        return bool(in);
+    };
+
+    auto ReadAsync = [&](const Chunks& chunks, AsyncFileReader::Backend backend, bool direct) {
+        AsyncFileReader reader;
+        reader.Init(backend, 32);
+
+        uint32_t file = reader.Open(name, direct);
+        bool     ok   = file != AsyncFileReader::INVALID_FILE;
+
+        if (ok) {
+            for (const auto& [offset, size] : chunks) {
+                reader.Read(file, offset, size, pDest + offset, [&ok](bool readOk, const uint8_t*, uint64_t) {
+                    ok &= readOk;
+                });
+            }
+
+            reader.WaitIdle();
+        }
+
+        reader.Destroy();
+        return ok;
+    };
+
+    struct Method {
+        const char*                        name;
+        std::function<bool(const Chunks&)> read;
+    };
+
+    const Method methods[] = {
+        { "ifstream",        ReadStream },
+        { "mapped",          [&](const Chunks& chunks) { return ReadMapped(name, pDest, chunks); } },
+        { "native direct",   [&](const Chunks& chunks) { return ReadAsync(chunks, AsyncFileReader::Backend::Native, true); } },
+        { "native buffered", [&](const Chunks& chunks) { return ReadAsync(chunks, AsyncFileReader::Backend::Native, false); } },
+        { "threads direct",  [&](const Chunks& chunks) { return ReadAsync(chunks, AsyncFileReader::Backend::Threads, true); } },
+        { "threads",         [&](const Chunks& chunks) { return ReadAsync(chunks, AsyncFileReader::Backend::Threads, false); } },
+    };
+
+    struct Pattern {
+        const char* name;
+        Chunks      chunks;
+    };
+
+    const Pattern patterns[] = {
+        { "1 MB in order", MakeChunks(1 << 20, false) },
+        { "64 KB random",  MakeChunks(64 << 10, true) },
+    };
+
+    {
+        AsyncFileReader probe;
+        probe.Init(AsyncFileReader::Backend::Native, 1, 1);
+
+#ifdef _WIN32
+        const char* pNative = "I/O completion port";
+#else
+        const char* pNative = probe.GetBackend() == AsyncFileReader::Backend::Native ? "io_uring" : "threads, io_uring not available";
+#endif
+
+        std::cout << "File I/O: " << (fileSize >> 20) << " MB file, native is " << pNative << ", GB/s" << std::endl;
+
+        probe.Destroy();
+    }
+
+    for (const auto& pattern : patterns) {
+        for (int warm = 0; warm < 2; ++warm) {
+            std::cout << "  " << pattern.name << (warm ? ", warm:" : ", cold:");
+
+            for (const auto& method : methods) {
+                bool prepared = warm ? ReadStream(MakeChunks(8 << 20, false)) : WriteUnbuffered(name, pSource, fileSize);
+
+                memset(pDest, 0, fileSize);
+
+                auto begin = steady_clock::now();
+                bool ok    = prepared && method.read(pattern.chunks);
+                auto end   = steady_clock::now();
+
+                ok = ok && memcmp(pSource, pDest, fileSize) == 0;
+
+                std::cout << " " << method.name << " " << (fileSize / double(1 << 30)) / duration<double>(end - begin).count()
+                          << (ok ? "" : " (FAILED)") << (&method == &methods[std::size(methods) - 1] ? "" : ",");
+            }
+
+            std::cout << std::endl;
+        }
+    }
+
+    std::remove(name.c_str());
+
+    FreePages(pSource, fileSize);
+    FreePages(pDest, fileSize);
+
+    return 0;
+}
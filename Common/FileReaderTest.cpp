@@ -0,0 +1,191 @@
+#include "AsyncFileReader.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+//
+// The checks of AsyncFileReader, once per backend, buffered and direct: reads of random offsets and
+// sizes (unaligned ones too, direct reads round them out) have to deliver the file's bytes, on the
+// thread that polls, with no more in flight than asked for. Reads past the end of the file fail,
+// files that aren't there don't open and closed file slots are reused. Exits nonzero if any of them
+// fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+// byte i of the test file
+static uint8_t Pattern(uint64_t i) {
+    return uint8_t((i * 2654435761ull) >> 13);
+}
+
+// ALIGNMENT aligned memory for direct reads
+struct AlignedBuffer
+{
+    explicit AlignedBuffer(size_t size) : storage(size + AsyncFileReader::ALIGNMENT) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+        pData = storage.data() + ((AsyncFileReader::ALIGNMENT - (address & (AsyncFileReader::ALIGNMENT - 1))) & (AsyncFileReader::ALIGNMENT - 1));
+    }
+
+    std::vector<uint8_t> storage;
+    uint8_t*             pData = nullptr;
+};
+
+static void TestReads(const std::filesystem::path& path, uint64_t fileSize, AsyncFileReader::Backend backend, bool direct) {
+    const uint32_t readCount   = 2000;
+    const uint32_t maxInFlight = 16;
+
+    AsyncFileReader reader;
+    reader.Init(backend, maxInFlight);
+
+    std::cout << (reader.GetBackend() == AsyncFileReader::Backend::Native ? "native" : "threads") << (direct ? ", direct" : ", buffered")
+              << (reader.GetBackend() != backend ? " (native not available)" : "") << std::endl;
+
+    uint32_t file = reader.Open(path, direct);
+
+    Check(file != AsyncFileReader::INVALID_FILE, "reads: the file opens");
+
+    if (file == AsyncFileReader::INVALID_FILE) {
+        reader.Destroy();
+        return;
+    }
+
+    Check(reader.GetFileSize(file) == fileSize, "reads: the file size is reported");
+
+    std::mt19937                            rng(direct ? 3 : 2);
+    std::uniform_int_distribution<uint64_t> sizes(1, 256 << 10);
+
+    struct Target
+    {
+        uint64_t      offset;
+        uint64_t      size;
+        AlignedBuffer buffer;
+    };
+
+    std::vector<std::unique_ptr<Target>> targets;
+
+    const std::thread::id caller = std::this_thread::get_id();
+
+    uint32_t completed  = 0;
+    uint32_t wrong      = 0;
+    uint32_t failed     = 0;
+    uint32_t offThread  = 0;
+    uint32_t maxSeen    = 0;
+
+    for (uint32_t i = 0; i < readCount; ++i) {
+        uint64_t size   = sizes(rng);
+        uint64_t offset = std::uniform_int_distribution<uint64_t>(0, fileSize - size)(rng);
+
+        // every fourth read of a direct file starts and ends on the sector grid, the rest don't
+        if (direct && i % 4 == 0) {
+            offset &= ~(AsyncFileReader::ALIGNMENT - 1);
+            size    = (size + AsyncFileReader::ALIGNMENT - 1) & ~(AsyncFileReader::ALIGNMENT - 1);
+            size    = (std::min)(size, fileSize - offset);
+        }
+
+        targets.push_back(std::make_unique<Target>(Target { offset, size, AlignedBuffer(size_t(AsyncFileReader::AlignedSize(offset, size))) }));
+
+        Target& target = *targets.back();
+
+        reader.Read(file, offset, size, target.buffer.pData, [&, offset](bool ok, const uint8_t* pData, uint64_t readSize) {
+            completed += 1;
+            failed    += ok ? 0 : 1;
+            offThread += std::this_thread::get_id() == caller ? 0 : 1;
+
+            for (uint64_t b = 0; ok && b < readSize; ++b) {
+                if (pData[b] != Pattern(offset + b)) {
+                    wrong += 1;
+                    break;
+                }
+            }
+        });
+
+        // a few queued at a time, the way streaming issues them
+        if (i % 7 == 6) {
+            reader.Submit();
+            maxSeen = (std::max)(maxSeen, reader.GetInFlight());
+            reader.Poll(0);
+        }
+    }
+
+    while (reader.GetInFlight() > 0 || reader.Submit() > 0) {
+        maxSeen = (std::max)(maxSeen, reader.GetInFlight());
+        reader.Poll(AsyncFileReader::WAIT_FOREVER);
+    }
+
+    Check(completed == readCount, "reads: every callback runs once");
+    Check(failed == 0, "reads: reads inside the file succeed");
+    Check(wrong == 0, "reads: the callback gets the file's bytes");
+    Check(offThread == 0, "reads: callbacks run on the polling thread");
+    Check(maxSeen > 0 && maxSeen <= maxInFlight, "reads: no more in flight than asked for");
+
+    // past the end: a short read is a failed one
+    AlignedBuffer tail(size_t(AsyncFileReader::AlignedSize(fileSize - 100, 200)));
+    bool          tailOk = true;
+
+    reader.Read(file, fileSize - 100, 200, tail.pData, [&tailOk](bool ok, const uint8_t*, uint64_t) {
+        tailOk = ok;
+    });
+
+    reader.WaitIdle();
+
+    Check(!tailOk, "reads: a read past the end of the file fails");
+
+    // nothing in flight, nothing to wait for
+    Check(reader.Poll(10) == 0, "reads: Poll with nothing in flight returns at once");
+
+    reader.Close(file);
+
+    Check(reader.Open(path, direct) == file, "reads: a closed file's slot is reused");
+    Check(reader.Open(path.string() + ".missing", direct) == AsyncFileReader::INVALID_FILE, "reads: a missing file doesn't open");
+
+    reader.Destroy();
+}
+
+int main() {
+    const uint64_t              fileSize = (8ull << 20) + 1234;      // not a whole number of sectors
+    const std::filesystem::path path     = "FileReaderTest.bin";
+
+    {
+        std::vector<uint8_t> data(fileSize);
+
+        for (uint64_t i = 0; i < fileSize; ++i) {
+            data[i] = Pattern(i);
+        }
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+
+        if (!out) {
+            std::cout << "FAILED: could not write " << path.string() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "AsyncFileReader, " << fileSize << " byte file" << std::endl;
+
+    for (auto backend : { AsyncFileReader::Backend::Native, AsyncFileReader::Backend::Threads }) {
+        for (bool direct : { false, true }) {
+            TestReads(path, fileSize, backend, direct);
+        }
+    }
+
+    std::filesystem::remove(path);
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
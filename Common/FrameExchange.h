@@ -0,0 +1,194 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+//
+// Bounded lock-free queue between exactly one producer thread (Push) and one consumer thread (Pop).
+// Each side keeps a cached copy of the other's index and only reloads it when the queue looks full
+// or empty, so the two cache lines are only shared when they have to be.
+//
+template <typename T, uint32_t CAPACITY>
+class SpscQueue {
+    static_assert(std::has_single_bit(CAPACITY), "SpscQueue capacity must be a power of two");
+
+public:
+    // producer; false if full
+    bool Push(const T& value) {
+        uint32_t tail = tailIndex.load(std::memory_order_relaxed);
+
+        if (tail - headCache == CAPACITY) {
+            headCache = headIndex.load(std::memory_order_acquire);
+
+            if (tail - headCache == CAPACITY) {
+                return false;
+            }
+        }
+
+        items[tail & (CAPACITY - 1)] = value;
+        tailIndex.store(tail + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // consumer; false if empty
+    bool Pop(T& value) {
+        uint32_t head = headIndex.load(std::memory_order_relaxed);
+
+        if (head == tailCache) {
+            tailCache = tailIndex.load(std::memory_order_acquire);
+
+            if (head == tailCache) {
+                return false;
+            }
+        }
+
+        value = items[head & (CAPACITY - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+
+        return true;
+    }
+
+private:
+    alignas(64) std::atomic<uint32_t> headIndex = 0;   // consumer
+    uint32_t                          tailCache = 0;
+    alignas(64) std::atomic<uint32_t> tailIndex = 0;   // producer
+    uint32_t                          headCache = 0;
+    alignas(64) std::array<T, CAPACITY> items = {};
+};
+
+//
+// Triple buffered hand-off of frame packets from one producer thread to one consumer thread. Slot
+// indices travel through two SpscQueues, so neither side ever blocks on the other: the producer
+// fills a free slot and publishes it, the consumer takes the newest published slot and gives back
+// the one it was done with, along with any it skipped over. When the consumer is behind and holds
+// every slot, Begin() comes back empty and that update is skipped; when nothing new was published,
+// Acquire() returns the current packet again.
+//
+template <typename Packet, uint32_t SLOTS = 3>
+class FrameExchange {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats {
+        uint64_t published = 0;
+        uint64_t skipped   = 0;     // updates without a free slot
+        uint64_t acquired  = 0;     // new packets taken by the consumer
+        uint64_t dropped   = 0;     // published, superseded before the consumer got to them
+        uint64_t repeated  = 0;     // acquires with nothing new
+        float    ageSum    = 0.0f;  // publish to acquire, ms
+        float    ageMax    = 0.0f;
+    };
+
+    void Init() {
+        for (uint32_t i = 0; i < SLOTS; ++i) {
+            freeSlots.Push(i);
+        }
+    }
+
+    // producer: the packet to fill, nullptr if the consumer holds every slot
+    Packet* Begin() {
+        if (writing == NONE && !freeSlots.Pop(writing)) {
+            skipped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        return &slots[writing];
+    }
+
+    // producer: hands the packet from Begin() over
+    void Publish() {
+        publishTimes[writing] = Clock::now();
+
+        readySlots.Push(writing);
+        writing = NONE;
+
+        published.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // consumer: the newest packet, valid until the next Acquire(); nullptr before the first Publish()
+    const Packet* Acquire() {
+        uint32_t newest = NONE;
+        uint32_t slot   = NONE;
+
+        while (readySlots.Pop(slot)) {
+            if (newest != NONE) {
+                freeSlots.Push(newest);
+                stats.dropped += 1;
+            }
+
+            newest = slot;
+        }
+
+        if (newest == NONE) {
+            stats.repeated += current != NONE ? 1 : 0;
+            return current != NONE ? &slots[current] : nullptr;
+        }
+
+        if (current != NONE) {
+            freeSlots.Push(current);
+        }
+
+        current = newest;
+
+        float ageMs = std::chrono::duration<float, std::milli>(Clock::now() - publishTimes[current]).count();
+
+        stats.acquired += 1;
+        stats.ageSum   += ageMs;
+        stats.ageMax    = (std::max)(stats.ageMax, ageMs);
+
+        return &slots[current];
+    }
+
+    // consumer
+    Stats GetStats() const {
+        Stats total     = stats;
+        total.published = published.load(std::memory_order_relaxed);
+        total.skipped   = skipped.load(std::memory_order_relaxed);
+
+        return total;
+    }
+
+    // consumer
+    void ReportStats(bool force) {
+        auto now = Clock::now();
+
+        if (!force && (now - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
+
+        Stats total = GetStats();
+
+        std::cout << "Frame packets: " << total.published << " published, " << total.skipped << " skipped, "
+                  << total.dropped << " dropped, " << total.repeated << " repeated, age avg "
+                  << (total.acquired > 0 ? total.ageSum / total.acquired : 0.0f) << " ms max " << total.ageMax << " ms" << std::endl;
+
+        published.fetch_sub(total.published, std::memory_order_relaxed);
+        skipped.fetch_sub(total.skipped, std::memory_order_relaxed);
+
+        stats     = {};
+        statStart = now;
+    }
+
+private:
+    static constexpr uint32_t NONE     = ~0u;
+    static constexpr uint32_t CAPACITY = std::bit_ceil(SLOTS);
+
+    std::array<Packet, SLOTS>            slots        = {};
+    std::array<Clock::time_point, SLOTS> publishTimes = {};
+    SpscQueue<uint32_t, CAPACITY>        readySlots;        // producer -> consumer
+    SpscQueue<uint32_t, CAPACITY>        freeSlots;         // consumer -> producer
+
+    uint32_t                             writing      = NONE;     // producer's slot
+    uint32_t                             current      = NONE;     // consumer's slot
+    std::atomic<uint64_t>                published    = 0;
+    std::atomic<uint64_t>                skipped      = 0;
+
+    Stats                                stats;
+    Clock::time_point                    statStart    = Clock::now();
+};
@@ -0,0 +1,390 @@
+#include "FrameExchange.h"
+#include "SimulatedGpu.h"
+#include "SimulationClock.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+//
+// The checks of SpscQueue, FrameExchange and SimulationClock. The queue and the exchange run a
+// producer and a consumer thread flat out: the queue has to deliver every value once and in order,
+// the exchange must never hand out a torn or older packet and its stats have to add up. The clock
+// is driven with made-up times. Then SamplerFeedback's former --bench=renderthread: a 60 Hz display
+// and a message handler stalling the main thread 100 ms once a second, rendered in one loop and on
+// a render thread fed by the exchange; the render thread has to hitch less. Exits nonzero if any
+// of them fails.
+//
+
+using Clock = SimulatedGpu::Clock;
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static void TestQueue() {
+    const uint32_t count = 2'000'000;
+
+    SpscQueue<uint32_t, 64> queue;
+
+    uint32_t ok = 0;
+    uint32_t value;
+
+    Check(!queue.Pop(value), "queue: starts empty");
+
+    for (uint32_t i = 0; i < 64; ++i) {
+        ok += queue.Push(i) ? 1 : 0;
+    }
+
+    Check(ok == 64 && !queue.Push(64), "queue: takes CAPACITY values, then is full");
+
+    ok = 0;
+
+    for (uint32_t i = 0; i < 64; ++i) {
+        ok += queue.Pop(value) && value == i ? 1 : 0;
+    }
+
+    Check(ok == 64 && !queue.Pop(value), "queue: gives them back in order, then is empty");
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < count; ++i) {
+            while (!queue.Push(i)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool     inOrder  = true;
+
+    while (expected < count) {
+        if (!queue.Pop(value)) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        inOrder  &= value == expected;
+        expected += 1;
+    }
+
+    producer.join();
+
+    Check(inOrder, "queue: two threads, every value once and in order");
+    Check(!queue.Pop(value), "queue: nothing left over");
+}
+
+struct Packet
+{
+    uint64_t                  step  = 0;
+    std::array<uint64_t, 61>  words = {};     // all derived from step, so a torn packet shows
+};
+
+static void TestExchangeSingle() {
+    FrameExchange<Packet> exchange;
+    exchange.Init();
+
+    Check(exchange.Acquire() == nullptr, "exchange: nothing before the first Publish");
+
+    // the consumer holds nothing yet: all three slots can be published
+    for (uint64_t step = 1; step <= 3; ++step) {
+        Packet* pPacket = exchange.Begin();
+
+        Check(pPacket != nullptr, "exchange: a free slot while the consumer holds none");
+
+        if (pPacket) {
+            pPacket->step = step;
+            exchange.Publish();
+        }
+    }
+
+    Check(exchange.Begin() == nullptr, "exchange: no slot left while all three are published");
+
+    const Packet* pNewest = exchange.Acquire();
+
+    Check(pNewest != nullptr && pNewest->step == 3, "exchange: Acquire takes the newest packet");
+    Check(exchange.Acquire() == pNewest, "exchange: with nothing new, Acquire returns the same packet again");
+
+    // the consumer holds one, the other two came back
+    uint32_t begun = 0;
+
+    for (uint64_t step = 4; step <= 5; ++step) {
+        if (Packet* pPacket = exchange.Begin()) {
+            pPacket->step = step;
+            exchange.Publish();
+            begun += 1;
+        }
+    }
+
+    Check(begun == 2 && exchange.Begin() == nullptr, "exchange: the consumer's slot is not handed out");
+
+    auto stats = exchange.GetStats();
+
+    Check(stats.published == 5 && stats.skipped == 2, "exchange: published and skipped are counted");
+    Check(stats.acquired == 1 && stats.dropped == 2 && stats.repeated == 1, "exchange: acquired, dropped and repeated are counted");
+}
+
+static void TestExchangeThreads() {
+    const uint64_t updates = 500'000;
+
+    FrameExchange<Packet> exchange;
+    exchange.Init();
+
+    std::atomic<bool> done          = false;
+    uint64_t          skipped       = 0;
+    uint64_t          lastPublished = 0;
+
+    std::thread producer([&] {
+        for (uint64_t step = 1; step <= updates; ++step) {
+            Packet* pPacket = exchange.Begin();
+
+            if (!pPacket) {
+                skipped += 1;
+                std::this_thread::yield();
+                continue;
+            }
+
+            pPacket->step = step;
+
+            for (size_t i = 0; i < pPacket->words.size(); ++i) {
+                pPacket->words[i] = step * 0x9E3779B97F4A7C15ull + i;
+            }
+
+            exchange.Publish();
+            lastPublished = step;
+        }
+
+        done.store(true, std::memory_order_release);
+    });
+
+    uint64_t torn      = 0;
+    uint64_t backwards = 0;
+    uint64_t lastStep  = 0;
+
+    auto Consume = [&] {
+        const Packet* pPacket = exchange.Acquire();
+
+        // nothing new: let the producer have the core
+        if (!pPacket || pPacket->step == lastStep) {
+            std::this_thread::yield();
+            return;
+        }
+
+        for (size_t i = 0; i < pPacket->words.size(); ++i) {
+            torn += pPacket->words[i] != pPacket->step * 0x9E3779B97F4A7C15ull + i ? 1 : 0;
+        }
+
+        backwards += pPacket->step < lastStep ? 1 : 0;
+        lastStep   = pPacket->step;
+    };
+
+    while (!done.load(std::memory_order_acquire)) {
+        Consume();
+    }
+
+    producer.join();
+
+    // whatever was still published
+    Consume();
+
+    auto stats = exchange.GetStats();
+
+    std::cout << "exchange, two threads: " << stats.published << " published, " << stats.skipped << " skipped, "
+              << stats.acquired << " acquired, " << stats.dropped << " dropped, " << stats.repeated << " repeated" << std::endl;
+
+    Check(torn == 0, "exchange: no packet is torn");
+    Check(backwards == 0, "exchange: no packet is older than the one before");
+    Check(lastStep == lastPublished, "exchange: the last packet published is the last one acquired");
+    Check(stats.skipped == skipped && stats.published + stats.skipped == updates, "exchange: every update is published or skipped");
+    Check(stats.published == stats.acquired + stats.dropped, "exchange: every published packet is acquired or dropped");
+}
+
+static void TestClock() {
+    using namespace std::chrono;
+
+    const Clock::time_point origin = Clock::time_point() + hours(1);
+
+    SimulationClock clock;
+    clock.Init(100, 8, origin);
+
+    Check(clock.Advance(origin) == 1, "clock: the first step is due at the start");
+    Check(clock.Advance(origin + milliseconds(5)) == 0, "clock: nothing due within a step");
+    Check(clock.Advance(origin + milliseconds(35)) == 3, "clock: the steps that fell due since the last call");
+    Check(clock.GetStep() == 4 && std::abs(clock.GetTime() - 0.04) < 1e-9, "clock: step and time count them");
+    Check(clock.GetNextStep() == origin + milliseconds(40), "clock: the next step is one period on");
+
+    // a one second stall: 8 steps run, the rest dropped
+    uint32_t due = clock.Advance(origin + milliseconds(1035));
+
+    Check(due == 8, "clock: a stall runs at most maxCatchUp steps");
+    Check(clock.GetLostSteps() == 92, "clock: the steps past maxCatchUp are lost");
+    Check(clock.GetNextStep() > origin + milliseconds(1035), "clock: after a stall the next step is in the future");
+    Check(clock.Advance(origin + milliseconds(1045)) == 1, "clock: after a stall it steps at the normal rate");
+}
+
+struct Display
+{
+    size_t   frames   = 0;
+    double   mean     = 0.0;
+    double   jitter   = 0.0;
+    float    p99      = 0.0f;
+    float    max      = 0.0f;
+    uint32_t hitches  = 0;
+};
+
+// 60 Hz display (blocking vsync present), 4-8 ms of rendering, 120 Hz simulation, 100 ms stall per second
+static Display RunDisplay(bool threaded) {
+    using namespace std::chrono;
+
+    const auto period     = duration_cast<Clock::duration>(duration<double>(1.0 / 60.0));
+    const auto stallEvery = seconds(1);
+    const auto stall      = milliseconds(100);
+    const auto simCost    = microseconds(300);
+    const auto runTime    = seconds(3);
+
+    FrameExchange<Packet> exchange;
+    SimulationClock       simulation;
+    std::atomic<bool>     done = false;
+
+    const Clock::time_point origin = Clock::now();
+
+    exchange.Init();
+    simulation.Init(120, 8, origin);
+
+    std::vector<Clock::time_point> shown;
+    std::mt19937                   rng(42);
+    std::uniform_int_distribution  renderUs(4000, 8000);
+
+    Clock::time_point nextStall = origin + stallEvery;
+
+    // main thread side: a message now and then, simulation steps as they fall due
+    auto PumpAndSimulate = [&] {
+        if (Clock::now() >= nextStall) {
+            std::this_thread::sleep_for(stall);
+            nextStall += stallEvery;
+        }
+
+        uint32_t steps = simulation.Advance(Clock::now());
+
+        if (steps == 0) {
+            return;
+        }
+
+        SimulatedGpu::SpinUntil(Clock::now() + simCost * steps);
+
+        if (Packet* pPacket = exchange.Begin()) {
+            pPacket->step = simulation.GetStep();
+            exchange.Publish();
+        }
+    };
+
+    // render side: the newest packet, the frame's work, then the present blocks to the vblank
+    auto RenderFrame = [&] {
+        if (!exchange.Acquire()) {
+            std::this_thread::yield();
+            return;
+        }
+
+        SimulatedGpu::SpinUntil(Clock::now() + microseconds(renderUs(rng)));
+
+        Clock::time_point vblank = origin + period * ((Clock::now() - origin) / period + 1);
+        SimulatedGpu::SpinUntil(vblank);
+
+        shown.push_back(vblank);
+    };
+
+    if (threaded) {
+        std::thread renderer([&] {
+            while (!done.load(std::memory_order_acquire)) {
+                RenderFrame();
+            }
+        });
+
+        while (Clock::now() - origin < runTime) {
+            PumpAndSimulate();
+            SimulatedGpu::SpinUntil(simulation.GetNextStep());
+        }
+
+        done.store(true, std::memory_order_release);
+        renderer.join();
+    }
+    else {
+        while (Clock::now() - origin < runTime) {
+            PumpAndSimulate();
+            RenderFrame();
+        }
+    }
+
+    Display result;
+    result.frames = shown.size();
+
+    std::vector<float> intervals;
+
+    for (size_t i = 1; i < shown.size(); ++i) {
+        intervals.push_back(duration<float, std::milli>(shown[i] - shown[i - 1]).count());
+    }
+
+    if (intervals.empty()) {
+        return result;
+    }
+
+    float  periodMs = duration<float, std::milli>(period).count();
+    double sum      = 0.0;
+    double sqSum    = 0.0;
+
+    for (float interval : intervals) {
+        sum            += interval;
+        sqSum          += double(interval) * interval;
+        result.hitches += interval > periodMs * 1.5f ? 1 : 0;
+    }
+
+    std::sort(intervals.begin(), intervals.end());
+
+    result.mean   = sum / intervals.size();
+    result.jitter = sqrt((std::max)(sqSum / intervals.size() - result.mean * result.mean, 0.0));
+    result.p99    = intervals[size_t(intervals.size() * 0.99f)];
+    result.max    = intervals.back();
+
+    std::cout << "  " << (threaded ? "render thread" : "one thread") << ": " << result.frames << " frames, interval avg "
+              << result.mean << " ms, jitter " << result.jitter << " ms, p99 " << result.p99 << " ms, max " << result.max
+              << " ms, " << result.hitches << " hitches" << std::endl;
+
+    return result;
+}
+
+static void TestRenderThread() {
+    std::cout << "render thread: 60 Hz, render 4-8 ms, simulation 120 Hz, 100 ms message stall per second" << std::endl;
+
+    Display single   = RunDisplay(false);
+    Display threaded = RunDisplay(true);
+
+    Check(single.frames > 0 && threaded.frames > 0, "render thread: frames are shown");
+    Check(single.hitches > 0, "render thread: the stalls hitch a single thread");
+    Check(threaded.hitches < single.hitches, "render thread: a render thread hitches less");
+    Check(threaded.max < single.max, "render thread: a render thread shortens the longest interval");
+}
+
+int main() {
+    std::cout << "SpscQueue, FrameExchange, SimulationClock" << std::endl;
+
+    TestQueue();
+    TestExchangeSingle();
+    TestExchangeThreads();
+    TestClock();
+    TestRenderThread();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
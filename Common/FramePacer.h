@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+//
+// Decides when the CPU starts recording a frame. With SleepToDeadline the frame starts as late as
+// it can while still finishing on the GPU `margin` ahead of the vblank it targets, so whatever is
+// latched at the start (input, animation time) is as fresh as possible when it reaches the screen.
+// Display timing only comes in through OnVblank, so the policy runs just as well against a
+// simulated display clock (see FramePacerTest.cpp).
+//
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Policy {
+        None,               // start as soon as the swap chain and the scheduler allow
+        SleepToDeadline
+    };
+
+    void Init(Policy pacingPolicy, Clock::duration safetyMargin) {
+        policy = pacingPolicy;
+        margin = safetyMargin;
+    }
+
+    Policy GetPolicy() const {
+        return policy;
+    }
+
+    // a vblank the display went through; refreshCount increments once per vblank
+    void OnVblank(Clock::time_point when, uint64_t refreshCount) {
+        if (haveVblank && refreshCount > lastRefresh) {
+            auto measured = (when - lastVblank) / static_cast<Clock::rep>(refreshCount - lastRefresh);
+
+            period = (period * 7 + measured) / 8;
+        }
+
+        lastVblank  = when;
+        lastRefresh = refreshCount;
+        haveVblank  = true;
+    }
+
+    //
+    // Start of recording to GPU completion of a finished frame. Rises immediately and decays
+    // slowly, so one long frame pulls the start earlier for a while instead of missing again.
+    //
+    void OnFrameWork(Clock::duration work) {
+        workEstimate = work > workEstimate ? work : (workEstimate * 15 + work) / 16;
+    }
+
+    Clock::time_point NextStart(Clock::time_point now) const {
+        if (policy == Policy::None || !haveVblank) {
+            return now;
+        }
+
+        auto lead  = workEstimate + margin;
+        auto ahead = (now + lead) - lastVblank;
+
+        // first vblank that can still be made
+        Clock::rep periods = ahead <= Clock::duration::zero() ? 1 : (ahead + period - Clock::duration(1)) / period;
+
+        return lastVblank + period * (std::max)(periods, Clock::rep(1)) - lead;
+    }
+
+    Clock::duration GetPeriod() const {
+        return period;
+    }
+
+private:
+    Policy            policy       = Policy::None;
+    Clock::duration   margin       = {};
+    Clock::duration   period       = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / 60.0));
+    Clock::duration   workEstimate = {};
+    Clock::time_point lastVblank;
+    uint64_t          lastRefresh  = 0;
+    bool              haveVblank   = false;
+};
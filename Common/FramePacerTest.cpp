@@ -0,0 +1,182 @@
+#include "FramePacer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//
+// The checks of FramePacer, on SamplerFeedback's former --bench=pacing: a 60 Hz display in virtual
+// time. Each frame latches its state at the start of recording and is shown at the first free
+// vblank after the GPU is done, at most `latency` frames can be queued (waitable swap chain).
+// Sleeping to the deadline has to cut latch-to-scanout latency while seldom repeating a vblank.
+// Exits nonzero if any of them fails.
+//
+
+using Clock = FramePacer::Clock;
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static const Clock::duration PERIOD = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / 60.0));
+
+// the estimates alone, no display loop
+static void TestEstimates() {
+    using namespace std::chrono;
+
+    const Clock::time_point origin = Clock::time_point() + hours(1);
+
+    FramePacer none;
+    none.Init(FramePacer::Policy::None, milliseconds(1));
+    none.OnVblank(origin, 0);
+
+    Check(none.NextStart(origin + milliseconds(3)) == origin + milliseconds(3), "estimates: no pacing starts right away");
+
+    FramePacer pacer;
+    pacer.Init(FramePacer::Policy::SleepToDeadline, milliseconds(1));
+
+    Check(pacer.NextStart(origin) == origin, "estimates: no vblank seen yet starts right away");
+
+    // a 50 Hz display, reported every other vblank
+    const auto period50 = milliseconds(20);
+
+    for (uint64_t refresh = 0; refresh <= 200; refresh += 2) {
+        pacer.OnVblank(origin + period50 * refresh, refresh);
+    }
+
+    auto periodError = pacer.GetPeriod() > period50 ? pacer.GetPeriod() - period50 : period50 - pacer.GetPeriod();
+
+    Check(periodError < microseconds(50), "estimates: the period converges to the display's");
+
+    // 5 ms of work plus 1 ms margin before the next vblank at 200 * 20 ms
+    pacer.OnFrameWork(milliseconds(5));
+
+    Clock::time_point lastVblank = origin + period50 * 200;
+    Clock::time_point start      = pacer.NextStart(lastVblank + milliseconds(1));
+    auto              startError = start - (lastVblank + pacer.GetPeriod() - milliseconds(6));
+
+    Check(startError < microseconds(1) && startError > -microseconds(1), "estimates: starts work + margin ahead of the next vblank");
+
+    // too late for that one, aims at the one after
+    Check(pacer.NextStart(lastVblank + milliseconds(16)) > lastVblank + pacer.GetPeriod(), "estimates: a missed vblank moves the target to the next one");
+
+    // one long frame pulls the start earlier at once, and only decays back slowly
+    pacer.OnFrameWork(milliseconds(12));
+
+    Clock::time_point longStart = pacer.NextStart(lastVblank + milliseconds(1));
+
+    pacer.OnFrameWork(milliseconds(5));
+
+    Clock::time_point decayedStart = pacer.NextStart(lastVblank + milliseconds(1));
+
+    Check(longStart <= start - milliseconds(6), "estimates: a long frame starts the next earlier at once");
+    Check(decayedStart < start && decayedStart > longStart, "estimates: the work estimate decays back slowly");
+}
+
+struct Result
+{
+    double   latencyAvg = 0.0;
+    float    latencyMax = 0.0f;
+    uint64_t repeats    = 0;
+};
+
+static Result RunDisplay(FramePacer::Policy policy, uint32_t latency, uint32_t frameCount) {
+    using namespace std::chrono;
+
+    const auto gpuCost = milliseconds(4);
+
+    FramePacer pacer;
+    pacer.Init(policy, milliseconds(1));
+
+    std::mt19937                       rng(42);
+    std::uniform_int_distribution<int> cpuUs(3000, 7000);
+    std::vector<Clock::time_point>     shown(frameCount);
+
+    const Clock::time_point origin = Clock::time_point() + hours(1);
+
+    Clock::time_point now     = origin;
+    Clock::time_point gpuFree = origin;
+
+    Result result;
+    double latencySum = 0.0;
+
+    for (uint32_t i = 0; i < frameCount; ++i) {
+        // waitable object: only `latency` frames may be queued for display
+        if (i >= latency) {
+            now = (std::max)(now, shown[i - latency]);
+        }
+
+        // frame statistics report the latest vblank
+        Clock::rep refresh = (now - origin) / PERIOD;
+        pacer.OnVblank(origin + PERIOD * refresh, refresh);
+
+        now = (std::max)(now, pacer.NextStart(now));
+
+        Clock::time_point latch = now;
+
+        now    += microseconds(cpuUs(rng));
+        gpuFree = (std::max)(gpuFree, now) + gpuCost;
+
+        // one frame per vblank, in order
+        Clock::time_point ready = i > 0 ? (std::max)(gpuFree, shown[i - 1] + PERIOD) : gpuFree;
+        shown[i] = origin + PERIOD * ((ready - origin + PERIOD - Clock::duration(1)) / PERIOD);
+
+        pacer.OnFrameWork(gpuFree - latch);
+
+        float latencyMs = duration<float, std::milli>(shown[i] - latch).count();
+
+        latencySum        += latencyMs;
+        result.latencyMax  = (std::max)(result.latencyMax, latencyMs);
+
+        if (i > 0) {
+            result.repeats += (shown[i] - shown[i - 1]) / PERIOD - 1;
+        }
+    }
+
+    result.latencyAvg = latencySum / frameCount;
+
+    return result;
+}
+
+static void TestDisplay() {
+    const uint32_t frameCount = 3600;
+
+    std::cout << "display: 60 Hz, cpu 3-7 ms, gpu 4 ms, " << frameCount << " frames" << std::endl;
+
+    Result queued   = RunDisplay(FramePacer::Policy::None, 3, frameCount);
+    Result single   = RunDisplay(FramePacer::Policy::None, 1, frameCount);
+    Result deadline = RunDisplay(FramePacer::Policy::SleepToDeadline, 1, frameCount);
+
+    auto Report = [](const char* pName, const Result& result) {
+        std::cout << "  " << pName << ": latency avg " << result.latencyAvg << " ms max " << result.latencyMax
+                  << " ms, repeated vblanks " << result.repeats << std::endl;
+    };
+
+    Report("none, latency 3", queued);
+    Report("none, latency 1", single);
+    Report("deadline, latency 1", deadline);
+
+    Check(single.latencyAvg < queued.latencyAvg, "display: a shorter queue cuts latency");
+    Check(deadline.latencyAvg < single.latencyAvg * 0.75, "display: sleeping to the deadline cuts latency further");
+
+    // the CPU cost varies from 3 to 7 ms, so a frame now and then outruns the work estimate
+    Check(deadline.repeats <= frameCount / 20, "display: sleeping to the deadline rarely misses a vblank");
+}
+
+int main() {
+    std::cout << "FramePacer" << std::endl;
+
+    TestEstimates();
+    TestDisplay();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
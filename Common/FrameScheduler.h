@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+
+//
+// Paces the CPU against the GPU with a runtime number of frames in flight (1 to MAX_FRAMES).
+// Every queue gets a monotonic timeline; signals made while recording a frame are remembered
+// in that frame's slot, and NextFrame() blocks until the slot it is about to reuse has retired
+// on every queue it touched. The GPU is only reached through Backend, so the same code runs
+// against D3D12 fences or a simulated clock (see SimulatedGpu.h and FrameSchedulerTest.cpp).
+//
+class FrameScheduler {
+public:
+    static constexpr uint32_t MAX_QUEUES = 4;
+    static constexpr uint32_t MAX_FRAMES = 8;
+
+    struct TimelinePoint {
+        uint32_t queue;
+        uint64_t value;
+    };
+
+    struct Backend {
+        std::function<uint64_t(uint32_t queue)>                                       completedValue;
+        std::function<void(uint32_t queue, uint64_t value)>                           signal;
+        std::function<void(const TimelinePoint* points, uint32_t count, bool waitAll)> wait;    // blocks until any/all points completed
+    };
+
+    struct Stats {
+        uint64_t frames      = 0;
+        double   totalWaitMs = 0.0;
+        float    maxWaitMs   = 0.0f;
+        float    lastWaitMs  = 0.0f;
+    };
+
+    void Init(uint32_t queues, uint32_t frames, Backend gpuBackend) {
+        if (queues == 0 || queues > MAX_QUEUES) {
+            throw std::runtime_error("Unsupported number of queues!");
+        }
+
+        queueCount = queues;
+        backend    = std::move(gpuBackend);
+
+        SetFramesInFlight(frames);
+    }
+
+    //
+    // Drains the GPU, so the slot mapping can change under per-frame resources safely.
+    //
+    void SetFramesInFlight(uint32_t frames) {
+        WaitIdle();
+
+        framesInFlight = (std::clamp)(frames, 1u, MAX_FRAMES);
+
+        for (auto& slot : slotValues) {
+            slot.fill(0);
+        }
+    }
+
+    uint32_t GetFramesInFlight() const {
+        return framesInFlight;
+    }
+
+    // index of the per-frame resources the frame being recorded may use
+    uint32_t GetFrameSlot() const {
+        return static_cast<uint32_t>(frameNumber % framesInFlight);
+    }
+
+    uint64_t GetFrameNumber() const {
+        return frameNumber;
+    }
+
+    //
+    // Signals the next value on a queue's timeline. Frame scoped signals hold back the reuse of
+    // the current slot; pass false for work that isn't tied to a frame (e.g. streaming).
+    //
+    uint64_t Signal(uint32_t queue, bool frameScoped = true) {
+        uint64_t value = ++lastSignaled[queue];
+
+        backend.signal(queue, value);
+
+        if (frameScoped) {
+            slotValues[GetFrameSlot()][queue] = value;
+        }
+
+        return value;
+    }
+
+    uint64_t GetLastSignaled(uint32_t queue) const {
+        return lastSignaled[queue];
+    }
+
+    // value the next Signal on the queue will use
+    uint64_t GetNextValue(uint32_t queue) const {
+        return lastSignaled[queue] + 1;
+    }
+
+    uint64_t GetCompletedValue(uint32_t queue) const {
+        return backend.completedValue(queue);
+    }
+
+    bool IsComplete(TimelinePoint point) const {
+        return backend.completedValue(point.queue) >= point.value;
+    }
+
+    // returns the CPU time blocked in ms
+    float WaitAll(const TimelinePoint* points, uint32_t count) {
+        TimelinePoint pending[MAX_QUEUES];
+        uint32_t      pendingCount = Pending(points, count, pending);
+
+        if (pendingCount == 0) {
+            return 0.0f;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        backend.wait(pending, pendingCount, true);
+
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // returns the index of a completed point
+    uint32_t WaitAny(const TimelinePoint* points, uint32_t count, float* pWaitMs = nullptr) {
+        if (pWaitMs) {
+            *pWaitMs = 0.0f;
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            if (IsComplete(points[i])) {
+                return i;
+            }
+        }
+
+        TimelinePoint pending[MAX_QUEUES];
+        uint32_t      pendingCount = Pending(points, count, pending);
+
+        if (pendingCount != 0) {
+            auto start = std::chrono::steady_clock::now();
+            backend.wait(pending, pendingCount, false);
+
+            if (pWaitMs) {
+                *pWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            }
+        }
+
+        for (uint32_t i = 0; i < count; ++i) {
+            if (IsComplete(points[i])) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Wait returned before any fence completed!");
+    }
+
+    // waits for everything signaled so far on every queue
+    float WaitIdle() {
+        TimelinePoint points[MAX_QUEUES];
+
+        for (uint32_t q = 0; q < queueCount; ++q) {
+            points[q] = { q, lastSignaled[q] };
+        }
+
+        return WaitAll(points, queueCount);
+    }
+
+    //
+    // Closes the frame being recorded and waits until the slot of the next frame has retired.
+    // Returns the CPU wait in ms, which also goes into the stats.
+    //
+    float NextFrame() {
+        ++frameNumber;
+
+        auto& slot = slotValues[GetFrameSlot()];
+
+        TimelinePoint points[MAX_QUEUES];
+        uint32_t      count = 0;
+
+        for (uint32_t q = 0; q < queueCount; ++q) {
+            if (slot[q] != 0) {
+                points[count++] = { q, slot[q] };
+            }
+        }
+
+        float waitMs = WaitAll(points, count);
+
+        slot.fill(0);
+
+        stats.frames      += 1;
+        stats.totalWaitMs += waitMs;
+        stats.maxWaitMs    = (std::max)(stats.maxWaitMs, waitMs);
+        stats.lastWaitMs   = waitMs;
+
+        return waitMs;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    void ResetStats() {
+        stats = {};
+    }
+
+    // prints the CPU wait roughly once a second
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (stats.frames == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Frames: " << framesInFlight << " in flight, CPU wait avg "
+                  << stats.totalWaitMs / stats.frames << " ms max " << stats.maxWaitMs
+                  << " ms over " << stats.frames << " frames" << std::endl;
+
+        stats     = {};
+        statStart = now;
+    }
+
+private:
+    uint32_t Pending(const TimelinePoint* points, uint32_t count, TimelinePoint* pending) const {
+        if (count > MAX_QUEUES) {
+            throw std::runtime_error("Too many timeline points to wait on!");
+        }
+
+        uint32_t pendingCount = 0;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            if (!IsComplete(points[i])) {
+                pending[pendingCount++] = points[i];
+            }
+        }
+
+        return pendingCount;
+    }
+
+    Backend                                                  backend;
+    uint32_t                                                 queueCount     = 0;
+    uint32_t                                                 framesInFlight = 1;
+    uint64_t                                                 frameNumber    = 0;
+    std::array<uint64_t, MAX_QUEUES>                         lastSignaled   = {};
+    std::array<std::array<uint64_t, MAX_QUEUES>, MAX_FRAMES> slotValues     = {};
+
+    Stats                                                    stats;
+    std::chrono::steady_clock::time_point                    statStart      = std::chrono::steady_clock::now();
+};
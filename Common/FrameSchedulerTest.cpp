@@ -0,0 +1,372 @@
+#include "FrameScheduler.h"
+#include "SimulatedGpu.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+//
+// The checks of FrameScheduler. The pacing rules run against a GPU that only moves when waited on,
+// so every wait can be checked; the frame times of SamplerFeedback's former --bench=scheduler run
+// against SimulatedGpu and are only checked loosely, since they depend on the machine's timer.
+// Exits nonzero if any of them fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+// completes nothing by itself: a wait completes all of its points, or the first one for wait-any
+class VirtualGpu {
+public:
+    struct WaitCall {
+        std::vector<FrameScheduler::TimelinePoint> points;
+        bool                                       waitAll;
+    };
+
+    FrameScheduler::Backend MakeBackend() {
+        return {
+            .completedValue = [this](uint32_t queue) { return completed[queue]; },
+            .signal         = [this](uint32_t queue, uint64_t value) { signaled[queue] = value; },
+            .wait           = [this](const FrameScheduler::TimelinePoint* points, uint32_t count, bool waitAll) {
+                waits.push_back({ std::vector<FrameScheduler::TimelinePoint>(points, points + count), waitAll });
+
+                for (uint32_t i = 0; i < (waitAll ? count : 1); ++i) {
+                    Complete(points[i].queue, points[i].value);
+                }
+            }
+        };
+    }
+
+    void Complete(uint32_t queue, uint64_t value) {
+        completed[queue] = (std::max)(completed[queue], value);
+    }
+
+    uint64_t              completed[FrameScheduler::MAX_QUEUES] = {};
+    uint64_t              signaled[FrameScheduler::MAX_QUEUES]  = {};
+    std::vector<WaitCall> waits;
+};
+
+static void TestClamp() {
+    VirtualGpu     gpu;
+    FrameScheduler scheduler;
+
+    scheduler.Init(1, 0, gpu.MakeBackend());
+    Check(scheduler.GetFramesInFlight() == 1, "clamp: 0 frames in flight become 1");
+
+    scheduler.SetFramesInFlight(100);
+    Check(scheduler.GetFramesInFlight() == FrameScheduler::MAX_FRAMES, "clamp: too many frames in flight become MAX_FRAMES");
+
+    bool threw = false;
+
+    try {
+        FrameScheduler invalid;
+        invalid.Init(FrameScheduler::MAX_QUEUES + 1, 2, gpu.MakeBackend());
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+
+    Check(threw, "clamp: more than MAX_QUEUES queues is an error");
+}
+
+//
+// With N frames in flight, starting frame i waits for what frame i - N signaled, on every queue it
+// signaled and on nothing else. Signals not scoped to a frame never hold a slot back.
+//
+static void TestNextFrame() {
+    for (uint32_t frames = 1; frames <= FrameScheduler::MAX_FRAMES; ++frames) {
+        VirtualGpu     gpu;
+        FrameScheduler scheduler;
+
+        scheduler.Init(2, frames, gpu.MakeBackend());
+
+        std::vector<uint64_t> graphicsValues, computeValues;
+        bool                  waitsRight = true, slotsRight = true;
+
+        for (uint32_t i = 0; i < 40; ++i) {
+            slotsRight &= scheduler.GetFrameSlot() == i % frames && scheduler.GetFrameNumber() == i;
+
+            graphicsValues.push_back(scheduler.Signal(0));
+
+            // async compute only every other frame, and a streaming signal that no frame owns
+            computeValues.push_back(i % 2 == 0 ? scheduler.Signal(1) : 0);
+            scheduler.Signal(1, false);
+
+            gpu.waits.clear();
+            scheduler.NextFrame();
+
+            uint32_t next = i + 1;
+
+            if (next < frames) {
+                waitsRight &= gpu.waits.empty();
+                continue;
+            }
+
+            uint32_t retiring = next - frames;
+
+            std::vector<FrameScheduler::TimelinePoint> expected = { { 0, graphicsValues[retiring] } };
+
+            if (computeValues[retiring] != 0) {
+                expected.push_back({ 1, computeValues[retiring] });
+            }
+
+            waitsRight &= gpu.waits.size() == 1 && gpu.waits[0].waitAll && gpu.waits[0].points.size() == expected.size();
+
+            for (size_t p = 0; waitsRight && p < expected.size(); ++p) {
+                waitsRight &= gpu.waits[0].points[p].queue == expected[p].queue && gpu.waits[0].points[p].value == expected[p].value;
+            }
+        }
+
+        Check(slotsRight, "next frame: frame i uses slot i % frames");
+        Check(waitsRight, "next frame: waits on exactly what the frame frames back signaled");
+        Check(scheduler.GetStats().frames == 40, "next frame: every frame is counted");
+
+        scheduler.WaitIdle();
+        Check(gpu.completed[0] == gpu.signaled[0] && gpu.completed[1] == gpu.signaled[1], "next frame: idle waits for every queue");
+    }
+
+    // a slot that already retired costs no wait
+    VirtualGpu     gpu;
+    FrameScheduler scheduler;
+
+    scheduler.Init(1, 2, gpu.MakeBackend());
+
+    gpu.Complete(0, scheduler.Signal(0));
+    scheduler.NextFrame();
+    scheduler.NextFrame();
+
+    Check(gpu.waits.empty(), "next frame: a retired slot isn't waited on");
+}
+
+static void TestWaits() {
+    VirtualGpu     gpu;
+    FrameScheduler scheduler;
+
+    scheduler.Init(3, 1, gpu.MakeBackend());
+
+    FrameScheduler::TimelinePoint points[] = {
+        { 0, scheduler.Signal(0, false) },
+        { 1, scheduler.Signal(1, false) },
+        { 2, scheduler.Signal(2, false) }
+    };
+
+    gpu.Complete(1, points[1].value);
+
+    Check(scheduler.WaitAny(points, 3) == 1, "wait-any: returns a point that already completed");
+    Check(gpu.waits.empty(), "wait-any: doesn't wait when a point completed");
+
+    scheduler.WaitAll(points, 3);
+
+    Check(gpu.waits.size() == 1 && gpu.waits[0].waitAll && gpu.waits[0].points.size() == 2, "wait-all: waits on the pending points only");
+    Check(scheduler.IsComplete(points[0]) && scheduler.IsComplete(points[2]), "wait-all: every point completed");
+
+    FrameScheduler::TimelinePoint next[] = {
+        { 0, scheduler.Signal(0, false) },
+        { 2, scheduler.Signal(2, false) }
+    };
+
+    gpu.waits.clear();
+
+    uint32_t first = scheduler.WaitAny(next, 2);
+
+    Check(gpu.waits.size() == 1 && !gpu.waits[0].waitAll, "wait-any: waits for any of the pending points");
+    Check(first == 0 && scheduler.IsComplete(next[0]) && !scheduler.IsComplete(next[1]), "wait-any: returns the point that completed");
+}
+
+//
+// Fixed CPU and GPU costs: the frame time drops from cpu + graphics at one frame in flight to
+// max(cpu, graphics) once the CPU can run ahead, and wait-any across queues returns as soon as the
+// shorter queue finishes. The bounds are loose, a loaded machine only oversleeps.
+//
+static void TestSimulated() {
+    using namespace std::chrono;
+
+    const auto     cpuCost      = milliseconds(4);
+    const auto     graphicsCost = milliseconds(6);
+    const auto     computeCost  = milliseconds(3);
+    const uint32_t frameCount   = 60;
+
+    std::cout << "simulated: cpu 4 ms, graphics 6 ms, async compute 3 ms, " << frameCount << " frames" << std::endl;
+
+    float frameMs[4] = {};
+
+    for (uint32_t frames = 1; frames <= 3; ++frames) {
+        SimulatedGpu   gpu;
+        FrameScheduler scheduler;
+
+        scheduler.Init(2, frames, MakeSimulatedBackend(gpu));
+
+        auto start = steady_clock::now();
+
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            SimulatedGpu::SpinUntil(steady_clock::now() + cpuCost);
+
+            gpu.Submit(0, graphicsCost);
+            scheduler.Signal(0);
+
+            gpu.Submit(1, computeCost);
+            scheduler.Signal(1);
+
+            scheduler.NextFrame();
+        }
+
+        scheduler.WaitIdle();
+
+        frameMs[frames] = duration<float, std::milli>(steady_clock::now() - start).count() / frameCount;
+
+        const auto& stats = scheduler.GetStats();
+
+        std::cout << "  " << frames << " in flight: " << frameMs[frames] << " ms/frame, CPU wait avg "
+                  << stats.totalWaitMs / stats.frames << " ms max " << stats.maxWaitMs << " ms" << std::endl;
+    }
+
+    Check(frameMs[1] >= 9.5f, "simulated: one frame in flight serializes cpu and gpu");
+    Check(frameMs[2] < frameMs[1] * 0.8f, "simulated: two frames in flight overlap cpu and gpu");
+
+    SimulatedGpu   gpu;
+    FrameScheduler scheduler;
+
+    scheduler.Init(2, 1, MakeSimulatedBackend(gpu));
+
+    gpu.Submit(0, milliseconds(40));
+    gpu.Submit(1, milliseconds(2));
+
+    FrameScheduler::TimelinePoint points[] = {
+        { 0, scheduler.Signal(0, false) },
+        { 1, scheduler.Signal(1, false) }
+    };
+
+    float    anyMs = 0.0f;
+    uint32_t first = scheduler.WaitAny(points, 2, &anyMs);
+    float    allMs = scheduler.WaitAll(points, 2);
+
+    std::cout << "  wait-any: queue " << first << " after " << anyMs << " ms, wait-all: " << anyMs + allMs << " ms" << std::endl;
+
+    Check(first == 1, "simulated: wait-any returns the shorter queue");
+    Check(anyMs < 30.0f && anyMs + allMs >= 38.0f, "simulated: wait-any doesn't wait for the longer queue, wait-all does");
+}
+
+//
+// The compute to graphics handoff of the generated mips, as RotatingPyramid's AcquireTexture()
+// does it: frames keep rendering while compute builds the mips, the texture is only acquired
+// once the compute point completed, and the graphics queue waits on that point on the GPU before
+// sampling. Against doing the mips first and rendering after, the handoff overlaps the two.
+//
+static void TestMipHandoff() {
+    using namespace std::chrono;
+
+    const uint32_t QUEUE_GRAPHICS = 0;
+    const uint32_t QUEUE_COMPUTE  = 1;
+
+    const auto     mipCost      = milliseconds(30);
+    const auto     cpuCost      = milliseconds(2);
+    const auto     graphicsCost = milliseconds(3);
+    const uint32_t frameCount   = 20;
+
+    // a queue wait alone orders graphics after compute, without the CPU blocking
+    {
+        SimulatedGpu   gpu;
+        FrameScheduler scheduler;
+
+        scheduler.Init(2, 2, MakeSimulatedBackend(gpu));
+
+        auto start = steady_clock::now();
+
+        gpu.Submit(QUEUE_COMPUTE, milliseconds(20));
+        FrameScheduler::TimelinePoint mips = { QUEUE_COMPUTE, scheduler.Signal(QUEUE_COMPUTE, false) };
+
+        gpu.QueueWait(QUEUE_GRAPHICS, mips);
+        gpu.Submit(QUEUE_GRAPHICS, milliseconds(1));
+        FrameScheduler::TimelinePoint sampled = { QUEUE_GRAPHICS, scheduler.Signal(QUEUE_GRAPHICS) };
+
+        float submitMs = duration<float, std::milli>(steady_clock::now() - start).count();
+
+        Check(!scheduler.IsComplete(sampled), "mip handoff: sampling doesn't complete before compute");
+
+        scheduler.WaitAll(&sampled, 1);
+
+        float sampledMs = duration<float, std::milli>(steady_clock::now() - start).count();
+
+        Check(submitMs < 5.0f, "mip handoff: the queue wait doesn't block the CPU");
+        Check(scheduler.IsComplete(mips) && sampledMs >= 20.0f, "mip handoff: sampling completes after compute");
+    }
+
+    auto Run = [&](bool handoff, uint32_t& framesBeforeAcquire, bool& acquiredEarly) {
+        SimulatedGpu   gpu;
+        FrameScheduler scheduler;
+
+        scheduler.Init(2, 2, MakeSimulatedBackend(gpu));
+
+        auto start = steady_clock::now();
+
+        gpu.Submit(QUEUE_COMPUTE, mipCost);
+        FrameScheduler::TimelinePoint mips = { QUEUE_COMPUTE, scheduler.Signal(QUEUE_COMPUTE, false) };
+
+        if (!handoff) {
+            scheduler.WaitAll(&mips, 1);
+        }
+
+        bool textureAcquired = false;
+
+        framesBeforeAcquire = 0;
+        acquiredEarly       = false;
+
+        for (uint32_t i = 0; i < frameCount; ++i) {
+            SimulatedGpu::SpinUntil(steady_clock::now() + cpuCost);
+
+            if (!textureAcquired && scheduler.IsComplete(mips)) {
+                acquiredEarly   = gpu.CompletedValue(QUEUE_COMPUTE) < mips.value;
+                textureAcquired = true;
+
+                gpu.QueueWait(QUEUE_GRAPHICS, mips);
+            }
+
+            framesBeforeAcquire += textureAcquired ? 0 : 1;
+
+            gpu.Submit(QUEUE_GRAPHICS, graphicsCost);
+            scheduler.Signal(QUEUE_GRAPHICS);
+
+            scheduler.NextFrame();
+        }
+
+        scheduler.WaitIdle();
+
+        return duration<float, std::milli>(steady_clock::now() - start).count();
+    };
+
+    uint32_t framesBeforeAcquire = 0, serialFrames = 0;
+    bool     acquiredEarly = false, serialEarly = false;
+
+    float handoffMs = Run(true, framesBeforeAcquire, acquiredEarly);
+    float serialMs  = Run(false, serialFrames, serialEarly);
+
+    std::cout << "  mip handoff: " << frameCount << " frames in " << handoffMs << " ms, " << framesBeforeAcquire
+              << " before the texture was acquired; mips first: " << serialMs << " ms" << std::endl;
+
+    Check(framesBeforeAcquire >= 3, "mip handoff: frames render while compute builds the mips");
+    Check(framesBeforeAcquire < frameCount, "mip handoff: the texture is acquired");
+    Check(!acquiredEarly, "mip handoff: the texture is only acquired once compute completed");
+    Check(handoffMs < serialMs * 0.9f, "mip handoff: overlaps compute with rendering");
+}
+
+int main() {
+    std::cout << "FrameScheduler" << std::endl;
+
+    TestClamp();
+    TestNextFrame();
+    TestWaits();
+    TestSimulated();
+    TestMipHandoff();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+//
+// The six planes of a view-projection matrix (row vectors, D3D clip depth 0 to w), normalized and
+// facing inwards: a point is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them. The
+// matrix is 4x4 floats and a plane 4 floats, the layout of DirectXMath's XMFLOAT4X4 and XMFLOAT4, so
+// that it builds without it.
+//
+struct Frustum
+{
+    enum {
+        LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE,
+        PLANE_COUNT
+    };
+
+    struct Plane
+    {
+        float x, y, z, w;
+    };
+
+    Plane planes[PLANE_COUNT];
+
+    static Frustum FromViewProj(const float (&m)[4][4]) {
+        float raw[PLANE_COUNT][4];
+
+        for (uint32_t e = 0; e < 4; ++e) {
+            raw[LEFT][e]       = m[e][3] + m[e][0];
+            raw[RIGHT][e]      = m[e][3] - m[e][0];
+            raw[BOTTOM][e]     = m[e][3] + m[e][1];
+            raw[TOP][e]        = m[e][3] - m[e][1];
+            raw[NEAR_PLANE][e] = m[e][2];
+            raw[FAR_PLANE][e]  = m[e][3] - m[e][2];
+        }
+
+        Frustum frustum;
+
+        for (uint32_t p = 0; p < PLANE_COUNT; ++p) {
+            float length = sqrtf(raw[p][0] * raw[p][0] + raw[p][1] * raw[p][1] + raw[p][2] * raw[p][2]);
+
+            frustum.planes[p] = { raw[p][0] / length, raw[p][1] / length, raw[p][2] / length, raw[p][3] / length };
+        }
+
+        return frustum;
+    }
+
+    //
+    // False if the box (center and half extents) is entirely behind one of the planes: its corner
+    // furthest along the normal, the extents projected on the normal's absolute value, is behind it.
+    // The box test of RotatingPyramid's CullingSystem and CullDraws, in the same order of operations.
+    //
+    bool TestBox(const float* pCenter, const float* pExtent) const {
+        for (const Plane& f : planes) {
+            float distance = pCenter[0] * f.x + pCenter[1] * f.y + pCenter[2] * f.z + f.w;
+            float reach    = pExtent[0] * fabsf(f.x) + pExtent[1] * fabsf(f.y) + pExtent[2] * fabsf(f.z);
+
+            if (distance + reach < 0.0f) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
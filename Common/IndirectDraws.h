@@ -0,0 +1,173 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+
+//
+// Indirect draws as RotatingPyramid's CullDraws (Cull.hlsl) writes them, and the CPU reference it is
+// checked against. Objects go in groups of GROUP_SIZE, and a group with anything visible appends one
+// command: its root constant is the group's first instance slot, and the group's visible objects
+// fill its GROUP_SIZE slots from there, in order. The GPU appends the commands as its groups finish,
+// so only their order may differ from Generate()'s; Expand() doesn't look at it. The draw arguments
+// are D3D12's layout, so the header builds without d3d12.h.
+//
+class IndirectDraws {
+public:
+    static constexpr uint32_t GROUP_SIZE = 64;      // keep in sync with Cull.hlsl
+
+    // D3D12_DRAW_INDEXED_ARGUMENTS
+    struct DrawIndexedArguments
+    {
+        uint32_t IndexCountPerInstance;
+        uint32_t InstanceCount;
+        uint32_t StartIndexLocation;
+        int32_t  BaseVertexLocation;
+        uint32_t StartInstanceLocation;
+    };
+
+    // keep in sync with the command signature and CullDraws: the root constant, then the draw
+    struct Command
+    {
+        uint32_t             firstInstance;
+        DrawIndexedArguments draw;
+    };
+
+    static uint32_t MaxCommands(uint32_t objectCount) {
+        return (objectCount + GROUP_SIZE - 1) / GROUP_SIZE;
+    }
+
+    // what CullDraws does, a group at a time with Frustum::TestBox()
+    static uint32_t Generate(const OcclusionCuller::Boxes& bounds, const Frustum& frustum, uint32_t objectCount, uint32_t indexCount, Command* pCommands, uint32_t* pInstances) {
+        uint32_t commands = 0;
+
+        for (uint32_t first = 0; first < objectCount; first += GROUP_SIZE) {
+            uint32_t last    = (std::min)(first + GROUP_SIZE, objectCount);
+            uint32_t visible = 0;
+
+            for (uint32_t i = first; i < last; ++i) {
+                float center[3] = { bounds.pCenter[0][i], bounds.pCenter[1][i], bounds.pCenter[2][i] };
+                float extent[3] = { bounds.pExtent[0][i], bounds.pExtent[1][i], bounds.pExtent[2][i] };
+
+                if (frustum.TestBox(center, extent)) {
+                    pInstances[first + visible++] = i;
+                }
+            }
+
+            if (visible > 0) {
+                pCommands[commands++] = { first, { indexCount, visible, 0, 0, 0 } };
+            }
+        }
+
+        return commands;
+    }
+
+    // the same out of a visible list in ascending order, as a frustum cull writes it
+    static uint32_t Build(const uint32_t* pVisible, uint32_t visibleCount, uint32_t indexCount, Command* pCommands, uint32_t* pInstances) {
+        uint32_t commands = 0;
+
+        for (uint32_t n = 0; n < visibleCount;) {
+            uint32_t first = pVisible[n] / GROUP_SIZE * GROUP_SIZE;
+            uint32_t count = 0;
+
+            while (n < visibleCount && pVisible[n] < first + GROUP_SIZE) {
+                pInstances[first + count++] = pVisible[n++];
+            }
+
+            pCommands[commands++] = { first, { indexCount, count, 0, 0, 0 } };
+        }
+
+        return commands;
+    }
+
+    //
+    // Over the job system in chunks of about grain visible objects, each moved up to the start of a
+    // group so none straddles two. A chunk writes its commands from its first group's index on, and
+    // they are then moved down to close the gaps.
+    //
+    uint32_t Build(JobSystem& jobs, uint32_t grain, const uint32_t* pVisible, uint32_t visibleCount, uint32_t indexCount, Command* pCommands, uint32_t* pInstances) {
+        grain = (std::max)(grain, GROUP_SIZE);
+
+        uint32_t chunks = (visibleCount + grain - 1) / grain;
+
+        chunkFirst.resize(chunks + 1);
+        chunkCommands.resize(chunks);
+
+        for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+            uint32_t n = chunk * grain;
+
+            while (n > 0 && n < visibleCount && pVisible[n] / GROUP_SIZE == pVisible[n - 1] / GROUP_SIZE) {
+                ++n;
+            }
+
+            chunkFirst[chunk] = n;
+        }
+
+        chunkFirst[chunks] = visibleCount;
+
+        auto FirstGroup = [&](uint32_t chunk) {
+            return chunkFirst[chunk] < chunkFirst[chunk + 1] ? pVisible[chunkFirst[chunk]] / GROUP_SIZE : 0;
+        };
+
+        jobs.ParallelFor(0, chunks, 1, [&](uint64_t first, uint64_t last) {
+            for (uint32_t chunk = uint32_t(first); chunk < last; ++chunk) {
+                uint32_t begin = chunkFirst[chunk];
+
+                chunkCommands[chunk] = Build(pVisible + begin, chunkFirst[chunk + 1] - begin, indexCount, pCommands + FirstGroup(chunk), pInstances);
+            }
+        });
+
+        uint32_t commands = 0;
+
+        for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+            uint32_t group = FirstGroup(chunk);
+
+            if (commands != group && chunkCommands[chunk] > 0) {
+                memmove(pCommands + commands, pCommands + group, chunkCommands[chunk] * sizeof(Command));
+            }
+
+            commands += chunkCommands[chunk];
+        }
+
+        return commands;
+    }
+
+    //
+    // Marks the objects the commands draw in drawn (objectCount flags). False if a command is
+    // malformed: no instances or more than a group, another index count, instance slots outside its
+    // group, or an object that isn't in the group or is drawn twice.
+    //
+    static bool Expand(const Command* pCommands, uint32_t commandCount, const uint32_t* pInstances, uint32_t objectCount, uint32_t indexCount, std::vector<uint8_t>& drawn) {
+        drawn.assign(objectCount, 0);
+
+        for (uint32_t c = 0; c < commandCount; ++c) {
+            const Command& command = pCommands[c];
+
+            if (command.firstInstance % GROUP_SIZE != 0 || command.firstInstance + command.draw.InstanceCount > objectCount || command.draw.InstanceCount == 0
+                || command.draw.InstanceCount > GROUP_SIZE || command.draw.IndexCountPerInstance != indexCount) {
+                return false;
+            }
+
+            for (uint32_t n = 0; n < command.draw.InstanceCount; ++n) {
+                uint32_t object = pInstances[command.firstInstance + n];
+
+                if (object / GROUP_SIZE != command.firstInstance / GROUP_SIZE || object >= objectCount || drawn[object]) {
+                    return false;
+                }
+
+                drawn[object] = 1;
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> chunkFirst;       // visible list position of each chunk of the last parallel Build()
+    std::vector<uint32_t> chunkCommands;
+};
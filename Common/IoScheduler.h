@@ -0,0 +1,224 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+//
+// Decides which streaming reads go out each frame. Reads are keyed by the caller (a tile id) and go
+// out oldest first, by the update they were first wanted on (so nothing starves behind newer, more
+// important reads), then by screen-space importance. Every frame has a byte and a request budget,
+// and the bytes in flight are capped so the device queue stays short. The caller re-states what it
+// wants every update, between BeginUpdate() and Dispatch(); a queued read that wasn't wanted again
+// is stale (the feedback moved on) and gets cancelled. Reads are asynchronous: Backend::read starts
+// one and Complete() reports it finished.
+//
+class IoScheduler {
+public:
+    struct Config {
+        uint64_t bytesPerFrame;         // 0: no byte budget
+        uint32_t requestsPerFrame;
+        uint64_t maxBytesInFlight;      // 0: no cap
+    };
+
+    struct Request {
+        uint64_t key;
+        uint32_t bytes;
+        float    importance;            // screen-space weight, summed over the wants of an update
+        uint64_t firstWanted;           // update frame the read was first wanted on
+    };
+
+    struct Backend {
+        std::function<bool(const Request& request)> read;      // start an asynchronous read, false: no room for it this frame
+    };
+
+    struct Stats {
+        uint64_t reads         = 0;
+        uint64_t bytes         = 0;
+        uint64_t completions   = 0;
+        uint64_t cancelled     = 0;
+        uint64_t maxFrameBytes = 0;
+    };
+
+    void Init(const Config& schedulerConfig, Backend schedulerBackend) {
+        config  = schedulerConfig;
+        backend = std::move(schedulerBackend);
+    }
+
+    void BeginUpdate(uint64_t updateFrame) {
+        frame       = updateFrame;
+        generation += 1;
+    }
+
+    // several wants of one update add up their importance
+    void Want(uint64_t key, uint32_t bytes, float importance) {
+        auto [it, inserted] = entries.try_emplace(key);
+        Entry& entry = it->second;
+
+        if (inserted) {
+            entry.request = { key, bytes, 0.0f, frame };
+        }
+
+        if (entry.inFlight) {
+            return;
+        }
+
+        if (entry.generation != generation) {
+            entry.generation         = generation;
+            entry.request.importance = 0.0f;
+        }
+
+        entry.request.importance += importance;
+    }
+
+    //
+    // Cancels stale reads, then starts queued ones in priority order until a budget runs out or the
+    // backend has no room. Returns the number of reads started.
+    //
+    uint32_t Dispatch() {
+        queue.clear();
+
+        for (auto it = entries.begin(); it != entries.end();) {
+            Entry& entry = it->second;
+
+            if (!entry.inFlight && entry.generation != generation) {
+                stats.cancelled += 1;
+                it = entries.erase(it);
+                continue;
+            }
+
+            if (!entry.inFlight) {
+                queue.push_back(&entry.request);
+            }
+
+            ++it;
+        }
+
+        auto later = [](const Request* a, const Request* b) {
+            return a->firstWanted != b->firstWanted ? a->firstWanted > b->firstWanted : a->importance < b->importance;
+        };
+
+        std::make_heap(queue.begin(), queue.end(), later);
+
+        uint32_t started    = 0;
+        uint64_t frameBytes = 0;
+
+        while (!queue.empty() && started < config.requestsPerFrame) {
+            const Request& request = *queue.front();
+
+            // the first read of a frame always fits, however large
+            if (started > 0 && config.bytesPerFrame != 0 && frameBytes + request.bytes > config.bytesPerFrame) {
+                break;
+            }
+
+            if (bytesInFlight > 0 && config.maxBytesInFlight != 0 && bytesInFlight + request.bytes > config.maxBytesInFlight) {
+                break;
+            }
+
+            if (!backend.read(request)) {
+                break;
+            }
+
+            std::pop_heap(queue.begin(), queue.end(), later);
+            queue.pop_back();
+
+            entries[request.key].inFlight = true;
+
+            bytesInFlight += request.bytes;
+            frameBytes    += request.bytes;
+            started       += 1;
+
+            stats.reads += 1;
+            stats.bytes += request.bytes;
+        }
+
+        stats.maxFrameBytes = (std::max)(stats.maxFrameBytes, frameBytes);
+        queued              = static_cast<uint32_t>(queue.size());
+
+        return started;
+    }
+
+    void Complete(uint64_t key) {
+        auto it = entries.find(key);
+
+        if (it == entries.end() || !it->second.inFlight) {
+            return;
+        }
+
+        const Entry& entry = it->second;
+
+        bytesInFlight     -= entry.request.bytes;
+        stats.completions += 1;
+
+        latencies.push_back(static_cast<uint32_t>(frame - entry.request.firstWanted));
+
+        entries.erase(it);
+    }
+
+    // reads wanted but left queued by the last Dispatch
+    uint32_t GetQueued() const {
+        return queued;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    // frames from first wanted to completed, p in [0, 1] over the completions since the last reset
+    uint32_t GetLatency(float p) {
+        if (latencies.empty()) {
+            return 0;
+        }
+
+        size_t n = (std::min)(size_t(p * latencies.size()), latencies.size() - 1);
+
+        std::nth_element(latencies.begin(), latencies.begin() + n, latencies.end());
+
+        return latencies[n];
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (!force && (now - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
+
+        std::cout << "I/O: " << stats.reads << " reads, " << stats.bytes / (1024 * 1024) << " MB (max " << stats.maxFrameBytes / 1024
+                  << " KB/frame), " << queued << " queued, " << stats.cancelled << " cancelled, latency p50 " << GetLatency(0.5f)
+                  << " p99 " << GetLatency(0.99f) << " frames" << std::endl;
+
+        ResetStats();
+        statStart = now;
+    }
+
+    void ResetStats() {
+        stats = {};
+        latencies.clear();
+    }
+
+private:
+    struct Entry
+    {
+        Request  request    = {};
+        uint64_t generation = 0;        // last update that wanted it
+        bool     inFlight   = false;
+    };
+
+    Config                                config        = {};
+    Backend                               backend;
+    std::unordered_map<uint64_t, Entry>   entries;
+    std::vector<const Request*>           queue;
+    uint64_t                              frame         = 0;
+    uint64_t                              generation    = 0;
+    uint64_t                              bytesInFlight = 0;
+    uint32_t                              queued        = 0;
+
+    Stats                                 stats;
+    std::vector<uint32_t>                 latencies;
+    std::chrono::steady_clock::time_point statStart     = std::chrono::steady_clock::now();
+};
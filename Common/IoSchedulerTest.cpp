@@ -0,0 +1,363 @@
+#include "FeedbackProcessor.h"
+#include "IoScheduler.h"
+#include "TileStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+//
+// The checks of IoScheduler against a backend that records the reads it is handed: the order
+// reads go out in, the request, byte and in-flight budgets, and which reads get cancelled. Then
+// SamplerFeedback's former --bench=io, a fly-through streamed from a simulated device.
+// Exits nonzero if any of them fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+class RecordingDevice {
+public:
+    IoScheduler::Backend MakeBackend() {
+        return {
+            .read = [this](const IoScheduler::Request& request) {
+                if (!accept) {
+                    return false;
+                }
+
+                reads.push_back(request.key);
+                return true;
+            }
+        };
+    }
+
+    bool                  accept = true;
+    std::vector<uint64_t> reads;
+};
+
+static const IoScheduler::Config UNBUDGETED = { 0, UINT32_MAX, 0 };
+
+//
+// Oldest first, by the update a read was first wanted on, then by importance summed over the wants
+// of the update.
+//
+static void TestOrder() {
+    RecordingDevice device;
+    IoScheduler     io;
+
+    io.Init({ 0, 1, 0 }, device.MakeBackend());
+
+    // A is wanted first, but the device has no room for it
+    device.accept = false;
+
+    io.BeginUpdate(1);
+    io.Want('A', 64, 1.0f);
+    io.Dispatch();
+
+    Check(device.reads.empty() && io.GetQueued() == 1, "order: a read the device refuses stays queued");
+
+    device.accept = true;
+
+    io.BeginUpdate(2);
+    io.Want('A', 64, 1.0f);
+    io.Want('B', 64, 10.0f);
+    io.Dispatch();
+
+    Check(device.reads == std::vector<uint64_t>{ 'A' }, "order: an older read goes before a more important one");
+
+    io.BeginUpdate(3);
+    io.Want('B', 64, 1.0f);
+    io.Want('C', 64, 5.0f);
+    io.Want('D', 64, 4.0f);
+    io.Want('D', 64, 4.0f);
+
+    while (io.Dispatch() > 0) {}
+
+    Check(device.reads == std::vector<uint64_t>{ 'A', 'B', 'D', 'C' }, "order: then by importance, summed over an update's wants");
+}
+
+static void TestBudgets() {
+    // requests per frame
+    {
+        RecordingDevice device;
+        IoScheduler     io;
+
+        io.Init({ 0, 4, 0 }, device.MakeBackend());
+        io.BeginUpdate(1);
+
+        for (uint64_t key = 0; key < 10; ++key) {
+            io.Want(key, 64, 1.0f);
+        }
+
+        Check(io.Dispatch() == 4 && io.GetQueued() == 6, "budgets: at most requestsPerFrame reads a frame");
+    }
+
+    // bytes per frame; the first read of a frame always fits
+    {
+        RecordingDevice device;
+        IoScheduler     io;
+
+        io.Init({ 100, 1024, 0 }, device.MakeBackend());
+        io.BeginUpdate(1);
+
+        for (uint64_t key = 0; key < 10; ++key) {
+            io.Want(key, 30, 1.0f);
+        }
+
+        Check(io.Dispatch() == 3, "budgets: at most bytesPerFrame a frame");
+        Check(io.GetStats().maxFrameBytes == 90, "budgets: the most read in a frame is tracked");
+
+        io.BeginUpdate(2);
+        io.Want(100, 200, 1000.0f);
+
+        for (uint64_t key = 0; key < 10; ++key) {
+            io.Want(key, 30, 1.0f);
+        }
+
+        // the 7 left from update 1 are older than the large one
+        Check(io.Dispatch() == 3, "budgets: the budget holds over later frames");
+
+        io.BeginUpdate(3);
+        io.Want(100, 200, 1000.0f);
+
+        for (uint64_t key = 0; key < 10; ++key) {
+            io.Want(key, 30, 1.0f);
+        }
+
+        io.Dispatch();
+        io.BeginUpdate(4);
+        io.Want(100, 200, 1000.0f);
+
+        Check(io.Dispatch() == 1 && device.reads.back() == 100, "budgets: a read larger than the budget goes out alone");
+    }
+
+    // bytes in flight
+    {
+        RecordingDevice device;
+        IoScheduler     io;
+
+        io.Init({ 0, 1024, 100 }, device.MakeBackend());
+
+        auto Update = [&](uint64_t frame) {
+            io.BeginUpdate(frame);
+
+            for (uint64_t key = 0; key < 4; ++key) {
+                io.Want(key, 40, 1.0f);
+            }
+
+            return io.Dispatch();
+        };
+
+        Check(Update(1) == 2, "budgets: at most maxBytesInFlight in flight");
+        Check(Update(2) == 0, "budgets: nothing more goes out until a read completes");
+
+        io.Complete(device.reads[0]);
+
+        Check(Update(3) == 1, "budgets: a completion makes room for another read");
+    }
+}
+
+static void TestCancel() {
+    RecordingDevice device;
+    IoScheduler     io;
+
+    io.Init(UNBUDGETED, device.MakeBackend());
+
+    io.BeginUpdate(1);
+    io.Want(1, 64, 1.0f);
+    io.Dispatch();
+
+    // 2 is queued but refused, then nobody wants either any more
+    device.accept = false;
+
+    io.BeginUpdate(2);
+    io.Want(2, 64, 1.0f);
+    io.Dispatch();
+
+    device.accept = true;
+
+    io.BeginUpdate(3);
+    io.Want(3, 64, 1.0f);
+    io.Dispatch();
+
+    Check(io.GetStats().cancelled == 1, "cancel: a queued read nobody wants any more is cancelled");
+    Check(device.reads == std::vector<uint64_t>{ 1, 3 }, "cancel: a cancelled read never goes out");
+
+    // a read in flight isn't cancelled, and wanting it again doesn't read it twice
+    io.BeginUpdate(4);
+    io.Want(1, 64, 1.0f);
+    io.Dispatch();
+
+    Check(device.reads.size() == 2, "cancel: a read in flight isn't read again");
+
+    io.BeginUpdate(5);
+    io.Complete(1);
+    io.Complete(3);
+    io.Complete(42);
+
+    const auto& stats = io.GetStats();
+
+    Check(stats.completions == 2 && stats.reads == 2 && stats.bytes == 128, "cancel: reads in flight still complete");
+    Check(io.GetLatency(0.0f) == 2 && io.GetLatency(1.0f) == 4, "cancel: latency counts frames from first wanted to completed");
+}
+
+//
+// A camera flying over a 32K x 32K texture (256 x 256 regions, 9 standard mips) at a speed that
+// keeps changing, from hovering to crossing the texture in about a second. Reads go to a simulated
+// device (400 MB/s, served in order, 0.2 ms latency on top) and tiles become resident once their
+// batch has been read. Compares no budget, the old fixed number of loads per frame and a byte
+// budget with a cap on bytes in flight: sustained throughput, the most read in a single frame (what
+// the copy queue absorbs on top of the frame), want -> resident latency and how much of what is on
+// screen is under-resident.
+//
+struct FlyThrough
+{
+    double   megabytesPerSecond = 0.0;
+    double   maxFrameMegabytes  = 0.0;
+    double   p99Ms              = 0.0;
+    double   underResident      = 0.0;
+    uint64_t cancelled          = 0;
+};
+
+static FlyThrough RunFlyThrough(const char* pName, const IoScheduler::Config& config) {
+    const uint32_t regions      = 256;
+    const uint32_t standardMips = 9;
+    const uint32_t frames       = 1200;
+    const uint32_t pool         = 8192;
+    const double   frameMs      = 1000.0 / 60.0;
+    const double   bytesPerMs   = 400.0 * 1024 * 1024 / 1000.0;
+    const double   latencyMs    = 0.2;
+
+    double   now        = 0.0;
+    double   deviceFree = 0.0;
+    double   batchDone  = 0.0;
+    uint64_t fence      = 0;
+    uint64_t completed  = 0;
+
+    std::deque<std::pair<uint64_t, double>> submitted;      // fence value, time its reads are done
+
+    TileStreamer      streamer;
+    FeedbackProcessor processor;
+
+    streamer.Init({ regions, regions, standardMips, pool, 0, config }, {
+        .upload = [&](const TileCoord&) {
+            deviceFree = (std::max)(deviceFree, now) + TileStreamer::TILE_SIZE / bytesPerMs;
+            batchDone  = deviceFree + latencyMs;
+            return true;
+        },
+        .submit = [&](const TileMapping*, uint32_t, bool) {
+            submitted.push_back({ ++fence, batchDone });
+            return fence;
+        },
+        .completedValue = [&]() {
+            while (!submitted.empty() && submitted.front().second <= now) {
+                completed = submitted.front().first;
+                submitted.pop_front();
+            }
+
+            return completed;
+        }
+    });
+
+    std::vector<uint8_t> feedback(regions * regions);
+
+    float    position    = 0.0f;
+    uint64_t sampled     = 0;
+    uint64_t underServed = 0;
+
+    for (uint32_t i = 0; i < frames; ++i) {
+        now = i * frameMs;
+
+        float speed = 2.0f * (1.0f - cosf(i * 0.01f));     // 0 to 4 regions per frame
+
+        position += speed;
+
+        float focusX = regions * (0.5f + 0.35f * sinf(position * 0.011f));
+        float focusY = regions * (0.5f + 0.35f * sinf(position * 0.007f + 1.0f));
+
+        for (uint32_t ry = 0; ry < regions; ++ry) {
+            for (uint32_t rx = 0; rx < regions; ++rx) {
+                float distance = sqrtf((rx - focusX) * (rx - focusX) + (ry - focusY) * (ry - focusY));
+
+                uint8_t wanted = 0xFF;
+
+                if (distance < 12.0f) {
+                    wanted = 0;
+                }
+                else if (distance < 128.0f) {
+                    wanted = uint8_t((std::min)(uint32_t(log2f(distance / 12.0f)) + 1, standardMips - 1));
+                }
+
+                feedback[ry * regions + rx] = wanted;
+            }
+        }
+
+        processor.Begin();
+        processor.Process(0, feedback.data(), regions, streamer.GetResidency(), regions, regions, streamer.GetCoarsestMip());
+
+        streamer.Update(feedback.data(), regions, processor.Finish());
+
+        const uint8_t* pResidency = streamer.GetResidency();
+
+        for (uint32_t r = 0; r < regions * regions; ++r) {
+            if (feedback[r] != 0xFF) {
+                sampled     += 1;
+                underServed += pResidency[r] > feedback[r] ? 1 : 0;
+            }
+        }
+    }
+
+    IoScheduler& io    = streamer.GetIoScheduler();
+    const auto&  stats = io.GetStats();
+
+    FlyThrough result = {
+        .megabytesPerSecond = stats.bytes / (1024.0 * 1024.0) / (frames * frameMs / 1000.0),
+        .maxFrameMegabytes  = stats.maxFrameBytes / (1024.0 * 1024.0),
+        .p99Ms              = io.GetLatency(0.99f) * frameMs,
+        .underResident      = double(underServed) / sampled,
+        .cancelled          = stats.cancelled
+    };
+
+    std::cout << "  " << pName << ": " << result.megabytesPerSecond << " MB/s, max " << result.maxFrameMegabytes
+              << " MB/frame, latency p50 " << io.GetLatency(0.5f) * frameMs << " ms p99 " << result.p99Ms << " ms, "
+              << result.cancelled << " cancelled, under-resident " << 100.0 * result.underResident << "% of sampled regions" << std::endl;
+
+    return result;
+}
+
+static void TestFlyThrough() {
+    std::cout << "fly-through: 32K x 32K, 1200 frames at 60 Hz, device 400 MB/s" << std::endl;
+
+    FlyThrough unbudgeted = RunFlyThrough("unbudgeted", UNBUDGETED);
+    FlyThrough fixed      = RunFlyThrough("16 loads/frame", { 0, 16, 0 });
+    FlyThrough budgeted   = RunFlyThrough("4 MB/frame, 16 MB in flight", { 4u << 20, 1024, 16u << 20 });
+
+    Check(budgeted.maxFrameMegabytes <= 4.0, "fly-through: the byte budget caps a frame's reads");
+    Check(budgeted.maxFrameMegabytes < unbudgeted.maxFrameMegabytes, "fly-through: unbudgeted bursts exceed the budget");
+    Check(budgeted.megabytesPerSecond > fixed.megabytesPerSecond, "fly-through: a byte budget streams more than a fixed number of loads");
+    Check(budgeted.underResident < fixed.underResident, "fly-through: and leaves less on screen under-resident");
+    Check(budgeted.cancelled > 0, "fly-through: reads the camera left behind are cancelled");
+}
+
+int main() {
+    std::cout << "IoScheduler" << std::endl;
+
+    TestOrder();
+    TestBudgets();
+    TestCancel();
+    TestFlyThrough();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
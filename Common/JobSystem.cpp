@@ -0,0 +1,381 @@
+#include "JobSystem.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <iostream>
+
+// pins a thread to one core; a no-op where the platform has no way to
+static void PinThread(std::thread& thread, uint32_t core) {
+#ifdef _WIN32
+    SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core % CPU_SETSIZE, &set);
+
+    pthread_setaffinity_np(thread.native_handle(), sizeof set, &set);
+#else
+    (void)thread;
+    (void)core;
+#endif
+}
+
+void JobSystem::Init(uint32_t workerCount, bool pinThreads) {
+    // a system started again after Destroy() counts from zero, like its new workers
+    stopping.store(false, std::memory_order_relaxed);
+    externalSpawned.store(0, std::memory_order_relaxed);
+    externalExecuted.store(0, std::memory_order_relaxed);
+    externalSteals.store(0, std::memory_order_relaxed);
+    externalFailed.store(0, std::memory_order_relaxed);
+
+    statLast  = {};
+    statStart = std::chrono::steady_clock::now();
+
+    workers.resize(workerCount);
+
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers[i] = std::make_unique<Worker>();
+    }
+
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers[i]->thread = std::thread(&JobSystem::Work, this, i);
+
+        if (pinThreads) {
+            PinThread(workers[i]->thread, i);
+        }
+    }
+}
+
+void JobSystem::Destroy() {
+    // parked jobs count as spawned, so they run too once what they depend on is done
+    while (!Drained()) {
+        if (Job* pJob = FindJob(NOT_A_WORKER)) {
+            Execute(pJob, NOT_A_WORKER);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+
+    stopping.store(true, std::memory_order_release);
+
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCv.notify_all();
+    }
+
+    for (auto& worker : workers) {
+        worker->thread.join();
+
+        for (Job* pJob : worker->freeJobs) {
+            delete pJob;
+        }
+    }
+
+    workers.clear();
+
+    for (Job* pJob : injected) {
+        delete pJob;
+    }
+
+    injected.clear();
+}
+
+void JobSystem::Spawn(Function&& fn, Counter* signal, Counter* dependency) {
+    Job* pJob = AllocateJob();
+
+    pJob->fn     = std::move(fn);
+    pJob->signal = signal;
+
+    uint32_t index = GetWorkerIndex();
+
+    (index != NOT_A_WORKER ? workers[index]->spawned : externalSpawned).fetch_add(1, std::memory_order_relaxed);
+
+    if (signal) {
+        signal->value.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (dependency) {
+        std::lock_guard<std::mutex> lock(dependency->mutex);
+
+        if (dependency->value.load(std::memory_order_acquire) != 0) {
+            dependency->waiters.push_back(pJob);
+            return;
+        }
+    }
+
+    Enqueue(pJob);
+}
+
+void JobSystem::Wait(Counter& counter, bool help) {
+    uint32_t index = GetWorkerIndex();
+    uint32_t spins = 0;
+
+    while (counter.Get() != 0) {
+        if (Job* pJob = help ? FindJob(index) : nullptr) {
+            Execute(pJob, index);
+            spins = 0;
+        }
+        else if (++spins > 64) {
+            std::this_thread::yield();
+        }
+    }
+
+    // the job that zeroed it may still hold the lock, and the counter can die once we return
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+JobSystem::Stats JobSystem::GetStats() const {
+    Stats total;
+
+    for (const auto& worker : workers) {
+        total.executed += worker->executed.load(std::memory_order_relaxed);
+        total.steals   += worker->steals.load(std::memory_order_relaxed);
+        total.failed   += worker->failed.load(std::memory_order_relaxed);
+        total.sleeps   += worker->sleeps.load(std::memory_order_relaxed);
+    }
+
+    total.executed += externalExecuted.load(std::memory_order_relaxed);
+    total.steals   += externalSteals.load(std::memory_order_relaxed);
+    total.failed   += externalFailed.load(std::memory_order_relaxed);
+
+    return total;
+}
+
+void JobSystem::ReportStats(bool force) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (!force && (now - statStart) < std::chrono::seconds(1)) {
+        return;
+    }
+
+    Stats stats = GetStats();
+
+    if (stats.executed == statLast.executed) {
+        return;
+    }
+
+    std::cout << "Jobs: " << workers.size() << " workers, " << stats.executed - statLast.executed << " jobs, "
+              << stats.steals - statLast.steals << " steals (" << stats.failed - statLast.failed << " failed), "
+              << stats.sleeps - statLast.sleeps << " sleeps" << std::endl;
+
+    statLast  = stats;
+    statStart = now;
+}
+
+JobSystem::Job* JobSystem::AllocateJob() {
+    uint32_t index = GetWorkerIndex();
+
+    if (index != NOT_A_WORKER && !workers[index]->freeJobs.empty()) {
+        Job* pJob = workers[index]->freeJobs.back();
+        workers[index]->freeJobs.pop_back();
+        return pJob;
+    }
+
+    return new Job;
+}
+
+void JobSystem::FreeJob(Job* pJob, uint32_t index) {
+    if (index != NOT_A_WORKER && workers[index]->freeJobs.size() < MAX_FREE_JOBS) {
+        pJob->fn = nullptr;
+        workers[index]->freeJobs.push_back(pJob);
+        return;
+    }
+
+    delete pJob;
+}
+
+void JobSystem::Enqueue(Job* pJob) {
+    uint32_t index = GetWorkerIndex();
+
+    if (index != NOT_A_WORKER) {
+        workers[index]->deque.Push(pJob);
+    }
+    else {
+        std::lock_guard<std::mutex> lock(injectMutex);
+        injected.push_back(pJob);
+        injectedCount.store(injected.size(), std::memory_order_release);
+    }
+
+    // pairs with the fence in Work(): either it sees the job or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleeping.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        sleepCv.notify_one();
+    }
+}
+
+JobSystem::Job* JobSystem::FindJob(uint32_t index) {
+    if (index != NOT_A_WORKER) {
+        if (Job* pJob = workers[index]->deque.Pop()) {
+            return pJob;
+        }
+    }
+
+    if (injectedCount.load(std::memory_order_acquire) > 0) {
+        std::lock_guard<std::mutex> lock(injectMutex);
+
+        if (!injected.empty()) {
+            Job* pJob = injected.front();
+            injected.pop_front();
+            injectedCount.store(injected.size(), std::memory_order_release);
+            return pJob;
+        }
+    }
+
+    uint32_t count = static_cast<uint32_t>(workers.size());
+
+    if (count == 0) {
+        return nullptr;
+    }
+
+    uint32_t start = index != NOT_A_WORKER ? NextRandom(*workers[index]) : 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t victim = (start + i) % count;
+
+        if (victim == index) {
+            continue;
+        }
+
+        Job* pJob = workers[victim]->deque.Steal();
+
+        if (index != NOT_A_WORKER) {
+            (pJob ? workers[index]->steals : workers[index]->failed).fetch_add(1, std::memory_order_relaxed);
+        }
+        else {
+            (pJob ? externalSteals : externalFailed).fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (pJob) {
+            return pJob;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::Execute(Job* pJob, uint32_t index) {
+    pJob->fn();
+
+    // release: whoever sees the job counted as executed also sees what it spawned counted
+    if (index != NOT_A_WORKER) {
+        workers[index]->executed.fetch_add(1, std::memory_order_release);
+    }
+    else {
+        externalExecuted.fetch_add(1, std::memory_order_release);
+    }
+
+    Counter* signal = pJob->signal;
+
+    FreeJob(pJob, index);
+
+    if (!signal) {
+        return;
+    }
+
+    std::vector<void*> released;
+
+    {
+        std::lock_guard<std::mutex> lock(signal->mutex);
+
+        if (signal->value.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            released.swap(signal->waiters);
+        }
+    }
+
+    for (void* pWaiter : released) {
+        Enqueue(static_cast<Job*>(pWaiter));
+    }
+}
+
+bool JobSystem::HasWork() const {
+    if (injectedCount.load(std::memory_order_relaxed) > 0) {
+        return true;
+    }
+
+    for (const auto& worker : workers) {
+        if (!worker->deque.Empty()) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// Executed counts are read before spawned counts: both only grow and no job runs before it is
+// spawned, so equal sums mean nothing was outstanding when the executed counts were read, and
+// nothing (no job being left to spawn it) was spawned since.
+//
+bool JobSystem::Drained() const {
+    uint64_t executed = externalExecuted.load(std::memory_order_acquire);
+
+    for (const auto& worker : workers) {
+        executed += worker->executed.load(std::memory_order_acquire);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    uint64_t spawned = externalSpawned.load(std::memory_order_relaxed);
+
+    for (const auto& worker : workers) {
+        spawned += worker->spawned.load(std::memory_order_relaxed);
+    }
+
+    return executed == spawned;
+}
+
+uint32_t JobSystem::NextRandom(Worker& worker) {
+    // xorshift
+    worker.rng ^= worker.rng << 13;
+    worker.rng ^= worker.rng >> 17;
+    worker.rng ^= worker.rng << 5;
+    return worker.rng;
+}
+
+void JobSystem::Work(uint32_t index) {
+    currentSystem = this;
+    currentWorker = index;
+
+    Worker& worker = *workers[index];
+    worker.rng     = 0x9E3779B9u * (index + 1);
+
+    uint32_t idle = 0;
+
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (Job* pJob = FindJob(index)) {
+            Execute(pJob, index);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < 256) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+
+        sleeping.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!HasWork() && !stopping.load(std::memory_order_acquire)) {
+            worker.sleeps.fetch_add(1, std::memory_order_relaxed);
+            sleepCv.wait_for(lock, std::chrono::milliseconds(10));
+        }
+
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+
+        idle = 0;
+    }
+
+    currentSystem = nullptr;
+}
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Chase-Lev work-stealing deque of pointers (the C11 formulation of Le et al.). The owner pushes and
+// pops at the bottom, any thread steals from the top; only the last element is contended. The array
+// grows on push, retired arrays stay alive until the deque dies since a thief may still read them.
+//
+template <typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(int64_t capacity = 1024) {
+        arrays.push_back(std::make_unique<Array>(capacity));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    // owner only
+    void Push(T* item) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array*  a = array.load(std::memory_order_relaxed);
+
+        if (b - t > a->mask) {
+            a = Grow(a, t, b);
+        }
+
+        a->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // owner only, nullptr if empty
+    T* Pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array*  a = array.load(std::memory_order_relaxed);
+
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = a->Get(b);
+
+        // last one: race the thieves for it
+        if (t == b) {
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    // any thread, nullptr if empty or another thief won
+    T* Steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        T* item = array.load(std::memory_order_acquire)->Get(t);
+
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return item;
+    }
+
+    bool Empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array
+    {
+        explicit Array(int64_t capacity) : mask(capacity - 1), items(new std::atomic<T*>[size_t(capacity)]) {}
+
+        T* Get(int64_t i) const {
+            return items[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t i, T* item) {
+            items[i & mask].store(item, std::memory_order_relaxed);
+        }
+
+        int64_t                         mask;
+        std::unique_ptr<std::atomic<T*>[]> items;
+    };
+
+    Array* Grow(Array* a, int64_t t, int64_t b) {
+        arrays.push_back(std::make_unique<Array>((a->mask + 1) * 2));
+
+        Array* grown = arrays.back().get();
+
+        for (int64_t i = t; i < b; ++i) {
+            grown->Put(i, a->Get(i));
+        }
+
+        array.store(grown, std::memory_order_release);
+        return grown;
+    }
+
+    alignas(64) std::atomic<int64_t>    top    = 0;
+    alignas(64) std::atomic<int64_t>    bottom = 0;
+    alignas(64) std::atomic<Array*>     array  = nullptr;
+    std::vector<std::unique_ptr<Array>> arrays;             // owner only, the current one is last
+};
+
+//
+// Work-stealing job system. Every worker owns a WorkStealingDeque: jobs it spawns go to its own
+// bottom and it runs them newest first, while idle workers steal the oldest from a random victim.
+// Threads that aren't workers spawn into a shared queue the workers drain after their own deques.
+// Jobs can signal a Counter (incremented on spawn, decremented when the job is done) and can depend
+// on one, in which case they are parked on it until it drops to zero. Wait() runs jobs until its
+// counter is zero, so waiting never idles a worker and a non-worker helps instead of blocking.
+// Workers with nothing to do spin briefly, then sleep until something is spawned.
+//
+class JobSystem {
+public:
+    static constexpr uint32_t NOT_A_WORKER = ~0u;
+
+    using Function = std::function<void()>;
+
+    class Counter {
+    public:
+        uint32_t Get() const {
+            return value.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class JobSystem;
+
+        std::atomic<uint32_t> value = 0;
+        std::mutex            mutex;
+        std::vector<void*>    waiters;          // jobs depending on this counter
+    };
+
+    struct Stats {
+        uint64_t executed = 0;
+        uint64_t steals   = 0;
+        uint64_t failed   = 0;                  // steal attempts that came back empty
+        uint64_t sleeps   = 0;
+    };
+
+    // Destroy(), unless it already ran: workers must not outlive the system
+    ~JobSystem() {
+        if (!workers.empty()) {
+            Destroy();
+        }
+    }
+
+    // workerCount threads, pinned to one core each when pinThreads is set
+    void Init(uint32_t workerCount, bool pinThreads = false);
+
+    // runs every job spawned so far, and whatever they spawn, before the workers stop
+    void Destroy();
+
+    uint32_t GetWorkerCount() const {
+        return static_cast<uint32_t>(workers.size());
+    }
+
+    // worker index of the calling thread, NOT_A_WORKER for other threads
+    uint32_t GetWorkerIndex() const {
+        return currentSystem == this ? currentWorker : NOT_A_WORKER;
+    }
+
+    //
+    // Runs fn on some worker. signal (optional) is incremented now and decremented when fn returns;
+    // fn doesn't start before dependency (optional) is zero.
+    //
+    void Spawn(Function&& fn, Counter* signal = nullptr, Counter* dependency = nullptr);
+
+    // co_await jobSystem.Schedule() continues the coroutine on a worker
+    auto Schedule() {
+        struct Awaiter {
+            JobSystem* pJobs;
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            void await_suspend(std::coroutine_handle<> handle) {
+                pJobs->Spawn([handle] { handle.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter { this };
+    }
+
+    //
+    // fn(first, last) over [begin, end) in batches of grain, blocking until all of them are done.
+    // The calling thread runs batches too.
+    //
+    template <typename F>
+    void ParallelFor(uint64_t begin, uint64_t end, uint64_t grain, const F& fn) {
+        if (begin >= end) {
+            return;
+        }
+
+        grain = (std::max)(grain, uint64_t(1));
+
+        Counter counter;
+
+        for (uint64_t first = begin; first < end; first += grain) {
+            uint64_t last = (std::min)(first + grain, end);
+
+            Spawn([&fn, first, last] { fn(first, last); }, &counter);
+        }
+
+        Wait(counter);
+    }
+
+    // helps run jobs until counter drops to zero; without help it only yields
+    void Wait(Counter& counter, bool help = true);
+
+    Stats GetStats() const;
+
+    void ReportStats(bool force);
+
+private:
+    static constexpr uint32_t MAX_FREE_JOBS = 1024;     // per worker, the rest go back to the heap
+
+    struct Job
+    {
+        Function fn;
+        Counter* signal = nullptr;
+    };
+
+    struct alignas(64) Worker
+    {
+        WorkStealingDeque<Job> deque;
+        std::vector<Job*>      freeJobs;
+        std::thread            thread;
+        uint32_t               rng      = 0;
+        std::atomic<uint64_t>  spawned  = 0;
+        std::atomic<uint64_t>  executed = 0;
+        std::atomic<uint64_t>  steals   = 0;
+        std::atomic<uint64_t>  failed   = 0;
+        std::atomic<uint64_t>  sleeps   = 0;
+    };
+
+    Job*     AllocateJob();
+    void     FreeJob(Job* pJob, uint32_t index);
+    void     Enqueue(Job* pJob);
+
+    // own deque, then the shared queue, then a steal from a random victim
+    Job*     FindJob(uint32_t index);
+
+    void     Execute(Job* pJob, uint32_t index);
+    bool     HasWork() const;
+    bool     Drained() const;           // every job spawned so far has run
+    uint32_t NextRandom(Worker& worker);
+    void     Work(uint32_t index);
+
+    static inline thread_local JobSystem* currentSystem = nullptr;
+    static inline thread_local uint32_t   currentWorker = NOT_A_WORKER;
+
+    std::vector<std::unique_ptr<Worker>>  workers;
+    std::deque<Job*>                      injected;
+    std::mutex                            injectMutex;
+    std::atomic<size_t>                   injectedCount    = 0;
+    std::atomic<uint64_t>                 externalSpawned  = 0;     // by non-workers
+    std::atomic<uint64_t>                 externalExecuted = 0;     // by non-workers helping in Wait()
+    std::atomic<uint64_t>                 externalSteals   = 0;
+    std::atomic<uint64_t>                 externalFailed   = 0;
+
+    std::mutex                            sleepMutex;
+    std::condition_variable               sleepCv;
+    std::atomic<uint32_t>                 sleeping         = 0;
+    std::atomic<bool>                     stopping         = false;
+
+    Stats                                 statLast;
+    std::chrono::steady_clock::time_point statStart        = std::chrono::steady_clock::now();
+};
@@ -0,0 +1,176 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//
+// SamplerFeedback's former --bench=jobs: job system costs and scaling. Spawn overhead is spawn plus run of an empty job, from a worker
+// (own deque) and from a non-worker (shared queue). The tree splits recursively down to small
+// leaves from one root job, so the work reaches the other workers by stealing only; the bench
+// thread waits without helping there. Scaling is a ParallelFor over independent math, up to 64
+// threads (oversubscribed past the core count), unpinned and pinned to a core per worker. Reports
+// numbers, checks nothing.
+//
+int main() {
+    using namespace std::chrono;
+
+    const uint32_t cores = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+    std::cout << "Jobs: " << cores << " cores" << std::endl;
+
+    //
+    // Spawn overhead
+    //
+    {
+        const uint32_t jobCount = 1 << 20;
+
+        for (uint32_t threads : { 1u, cores }) {
+            JobSystem jobSystem;
+            jobSystem.Init(threads);
+
+            JobSystem::Counter root;
+            double             workerNs = 0.0;
+
+            jobSystem.Spawn([&] {
+                JobSystem::Counter counter;
+
+                auto begin = steady_clock::now();
+
+                for (uint32_t i = 0; i < jobCount; ++i) {
+                    jobSystem.Spawn([] {}, &counter);
+                }
+
+                jobSystem.Wait(counter);
+
+                workerNs = duration<double, std::nano>(steady_clock::now() - begin).count() / jobCount;
+            }, &root);
+
+            jobSystem.Wait(root, false);
+
+            JobSystem::Counter counter;
+
+            auto begin = steady_clock::now();
+
+            for (uint32_t i = 0; i < jobCount; ++i) {
+                jobSystem.Spawn([] {}, &counter);
+            }
+
+            jobSystem.Wait(counter);
+
+            double externalNs = duration<double, std::nano>(steady_clock::now() - begin).count() / jobCount;
+
+            std::cout << "  spawn, " << threads << " workers: " << workerNs << " ns/job from a worker, " << externalNs
+                      << " ns/job from outside" << std::endl;
+
+            jobSystem.Destroy();
+        }
+    }
+
+    // a few microseconds of math, kept alive through the result
+    auto Busy = [](uint64_t seed, uint32_t iterations) {
+        float x = float(seed & 0xFFFF) * 0.001f;
+
+        for (uint32_t i = 0; i < iterations; ++i) {
+            x = x * 0.9999f + sqrtf(x + 1.0f) * 0.0001f;
+        }
+
+        return x;
+    };
+
+    //
+    // Steal rate
+    //
+    {
+        const uint32_t depth = 16;
+
+        for (uint32_t threads : { 2u, 4u, 8u, 16u, 64u }) {
+            JobSystem jobSystem;
+            jobSystem.Init(threads);
+
+            JobSystem::Counter    counter;
+            std::atomic<uint32_t> leaves = 0;
+            std::atomic<uint32_t> sink   = 0;
+
+            std::function<void(uint32_t)> Split = [&](uint32_t level) {
+                if (level == 0) {
+                    sink += Busy(leaves.fetch_add(1, std::memory_order_relaxed), 2000) > 0.0f ? 1 : 0;
+                    return;
+                }
+
+                jobSystem.Spawn([&Split, level] { Split(level - 1); }, &counter);
+                jobSystem.Spawn([&Split, level] { Split(level - 1); }, &counter);
+            };
+
+            auto before = jobSystem.GetStats();
+            auto begin  = steady_clock::now();
+
+            jobSystem.Spawn([&] { Split(depth); }, &counter);
+            jobSystem.Wait(counter, false);
+
+            double seconds = duration<double>(steady_clock::now() - begin).count();
+            auto   after   = jobSystem.GetStats();
+
+            uint64_t executed = after.executed - before.executed;
+            uint64_t steals   = after.steals - before.steals;
+
+            std::cout << "  tree, " << threads << " workers" << (threads > cores ? " (oversubscribed)" : "") << ": " << executed << " jobs in " << seconds * 1000.0 << " ms, "
+                      << steals << " steals (" << 100.0 * steals / executed << "% of jobs, " << uint64_t(steals / seconds) << "/s), "
+                      << after.failed - before.failed << " empty steals" << (sink == leaves ? "" : " (FAILED)") << std::endl;
+
+            jobSystem.Destroy();
+        }
+    }
+
+    //
+    // Scaling
+    //
+    {
+        const uint64_t elements = 1 << 22;
+        const uint64_t grain    = 1 << 12;
+
+        std::vector<float> results(elements / grain);
+
+        auto Run = [&](uint32_t threads, bool pinned) {
+            JobSystem jobSystem;
+            jobSystem.Init(threads, pinned);
+
+            auto begin = steady_clock::now();
+
+            jobSystem.ParallelFor(0, elements, grain, [&](uint64_t first, uint64_t last) {
+                float sum = 0.0f;
+
+                for (uint64_t i = first; i < last; ++i) {
+                    sum += Busy(i, 64);
+                }
+
+                results[first / grain] = sum;
+            });
+
+            double seconds = duration<double>(steady_clock::now() - begin).count();
+
+            jobSystem.Destroy();
+            return seconds;
+        };
+
+        double baseline = Run(1, false);
+
+        std::cout << "  scaling, " << elements << " elements in batches of " << grain << ", speedup over 1 worker:" << std::endl;
+
+        for (uint32_t threads : { 1u, 2u, 4u, 8u, 16u, 32u, 64u }) {
+            double unpinned = Run(threads, false);
+            double pinned   = Run(threads, true);
+
+            std::cout << "    " << threads << " workers" << (threads > cores ? " (oversubscribed)" : "") << ": "
+                      << baseline / unpinned << "x, pinned " << baseline / pinned << "x" << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+//
+// The checks of JobSystem: every spawned job runs once, from workers and from outside, jobs that
+// depend on a counter start only after it drops to zero, ParallelFor covers its range once in any
+// grain, and Destroy() (or the destructor) runs everything spawned before the workers stop, parked
+// jobs included. Exits nonzero if any of them fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static void TestSpawn() {
+    const uint32_t jobCount = 100'000;
+
+    JobSystem jobSystem;
+    jobSystem.Init(4);
+
+    Check(jobSystem.GetWorkerIndex() == JobSystem::NOT_A_WORKER, "spawn: the main thread is not a worker");
+
+    JobSystem::Counter    counter;
+    std::atomic<uint32_t> ran        = 0;
+    std::atomic<uint32_t> badIndex   = 0;
+    std::atomic<uint32_t> grandchild = 0;
+
+    for (uint32_t i = 0; i < jobCount; ++i) {
+        jobSystem.Spawn([&] {
+            ran.fetch_add(1, std::memory_order_relaxed);
+
+            uint32_t index = jobSystem.GetWorkerIndex();
+
+            // the main thread helps in Wait(), so a job may run outside the workers too
+            if (index != JobSystem::NOT_A_WORKER && index >= jobSystem.GetWorkerCount()) {
+                badIndex.fetch_add(1, std::memory_order_relaxed);
+            }
+        }, &counter);
+    }
+
+    // spawned from a worker: into its own deque, counted on the same counter
+    jobSystem.Spawn([&] {
+        for (uint32_t i = 0; i < 1000; ++i) {
+            jobSystem.Spawn([&] { grandchild.fetch_add(1, std::memory_order_relaxed); }, &counter);
+        }
+    }, &counter);
+
+    jobSystem.Wait(counter);
+
+    Check(counter.Get() == 0, "spawn: the counter is zero after Wait");
+    Check(ran == jobCount, "spawn: every job from outside runs once");
+    Check(grandchild == 1000, "spawn: every job spawned from a worker runs once");
+    Check(badIndex == 0, "spawn: worker indices are below the worker count");
+    Check(jobSystem.GetStats().executed == jobCount + 1001, "spawn: stats count every job");
+
+    jobSystem.Destroy();
+}
+
+static void TestDependencies() {
+    JobSystem jobSystem;
+    jobSystem.Init(4);
+
+    // three stages, each waiting on the counter of the one before; a stage checks all of it is done
+    const uint32_t width = 200;
+
+    JobSystem::Counter    stages[3];
+    std::atomic<uint32_t> done[3]   = {};
+    std::atomic<uint32_t> early     = 0;
+    JobSystem::Counter    last;
+
+    for (uint32_t stage = 0; stage < 3; ++stage) {
+        for (uint32_t i = 0; i < width; ++i) {
+            jobSystem.Spawn([&, stage] {
+                if (stage > 0 && done[stage - 1].load(std::memory_order_acquire) != width) {
+                    early.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                std::this_thread::sleep_for(std::chrono::microseconds(stage == 0 ? 50 : 0));
+
+                done[stage].fetch_add(1, std::memory_order_acq_rel);
+            }, stage < 2 ? &stages[stage] : &last, stage > 0 ? &stages[stage - 1] : nullptr);
+        }
+    }
+
+    jobSystem.Wait(last);
+
+    Check(early == 0, "dependencies: no job starts before the counter it depends on is zero");
+    Check(done[0] == width && done[1] == width && done[2] == width, "dependencies: every stage runs");
+
+    // a dependency that is already zero doesn't park
+    JobSystem::Counter zero;
+    JobSystem::Counter signal;
+    std::atomic<bool>  ran = false;
+
+    jobSystem.Spawn([&] { ran = true; }, &signal, &zero);
+    jobSystem.Wait(signal, false);
+
+    Check(ran, "dependencies: a zero dependency runs the job right away");
+
+    jobSystem.Destroy();
+}
+
+static void TestParallelFor() {
+    JobSystem jobSystem;
+    jobSystem.Init(4);
+
+    struct Case
+    {
+        uint64_t begin;
+        uint64_t end;
+        uint64_t grain;
+    };
+
+    const Case cases[] = {
+        { 0, 100'000, 1000 },
+        { 17, 10'017, 333 },        // not a multiple of the grain
+        { 0, 5000, 0 },             // grain 0 is 1
+        { 0, 10, 100 },             // one batch
+        { 50, 50, 10 },             // empty
+        { 60, 50, 10 },             // inverted, empty too
+    };
+
+    bool covered    = true;
+    bool inBounds   = true;
+    bool batchSizes = true;
+
+    for (const Case& c : cases) {
+        uint64_t size = c.end > c.begin ? c.end - c.begin : 0;
+
+        std::vector<std::atomic<uint32_t>> hits(size);
+
+        jobSystem.ParallelFor(c.begin, c.end, c.grain, [&](uint64_t first, uint64_t last) {
+            if (first < c.begin || last > c.end || first >= last) {
+                inBounds = false;
+                return;
+            }
+
+            if (last - first > (std::max)(c.grain, uint64_t(1))) {
+                batchSizes = false;
+            }
+
+            for (uint64_t i = first; i < last; ++i) {
+                hits[i - c.begin].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+
+        for (const auto& hit : hits) {
+            covered &= hit.load() == 1;
+        }
+    }
+
+    Check(inBounds, "parallel for: batches stay inside the range");
+    Check(batchSizes, "parallel for: batches are at most grain long");
+    Check(covered, "parallel for: every index is covered exactly once");
+
+    // nested: a ParallelFor on a worker helps instead of blocking it
+    std::atomic<uint64_t> sum = 0;
+
+    jobSystem.ParallelFor(0, 64, 1, [&](uint64_t outer, uint64_t) {
+        jobSystem.ParallelFor(0, 1000, 100, [&](uint64_t first, uint64_t last) {
+            for (uint64_t i = first; i < last; ++i) {
+                sum.fetch_add(outer * 1000 + i, std::memory_order_relaxed);
+            }
+        });
+    });
+
+    Check(sum == uint64_t(64 * 1000) * (64 * 1000 - 1) / 2, "parallel for: nested loops complete");
+
+    jobSystem.Destroy();
+}
+
+static void TestDestroy() {
+    JobSystem jobSystem;
+    jobSystem.Init(4);
+
+    std::atomic<uint32_t> ran    = 0;
+    std::atomic<uint32_t> parked = 0;
+
+    // 500 jobs that each spawn a child, and 100 parked on a gate that opens only once a slow job is done
+    JobSystem::Counter gate;
+
+    jobSystem.Spawn([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ran.fetch_add(1, std::memory_order_relaxed);
+    }, &gate);
+
+    for (uint32_t i = 0; i < 100; ++i) {
+        jobSystem.Spawn([&] { parked.fetch_add(1, std::memory_order_relaxed); }, nullptr, &gate);
+    }
+
+    for (uint32_t i = 0; i < 500; ++i) {
+        jobSystem.Spawn([&] {
+            ran.fetch_add(1, std::memory_order_relaxed);
+            jobSystem.Spawn([&] { ran.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+
+    // no Wait: Destroy has to drain it all
+    jobSystem.Destroy();
+
+    Check(ran == 1001, "destroy: every spawned job and every child runs before the workers stop");
+    Check(parked == 100, "destroy: parked jobs run once their dependency is done");
+    Check(jobSystem.GetWorkerCount() == 0, "destroy: the workers are gone");
+
+    // and the system can start again
+    jobSystem.Init(2);
+
+    JobSystem::Counter counter;
+    std::atomic<bool>  again = false;
+
+    jobSystem.Spawn([&] { again = true; }, &counter);
+    jobSystem.Wait(counter, false);
+
+    Check(again, "destroy: Init after Destroy runs jobs again");
+
+    jobSystem.Destroy();
+
+    // the destructor destroys a system that is still running, and drains it too
+    std::atomic<uint32_t> leftover = 0;
+
+    {
+        JobSystem scoped;
+        scoped.Init(2);
+
+        for (uint32_t i = 0; i < 100; ++i) {
+            scoped.Spawn([&] {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                leftover.fetch_add(1, std::memory_order_relaxed);
+            });
+        }
+    }
+
+    Check(leftover == 100, "destroy: the destructor runs what is left and stops the workers");
+}
+
+int main() {
+    std::cout << "JobSystem" << std::endl;
+
+    TestSpawn();
+    TestDependencies();
+    TestParallelFor();
+    TestDestroy();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,702 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "JobSystem.h"
+
+//
+// Masked software occlusion culling (Hasselgren et al.) on the CPU, at low resolution. The depth
+// buffer is made of 32x8 pixel tiles. Instead of a depth per pixel, a tile keeps a coverage bit per
+// pixel and two depth bounds. zMax0 is the farthest depth anywhere in the tile. zMax1 is the
+// farthest depth of the pixels whose bit is set, the working layer. A triangle merges into the
+// working layer; once that covers the tile it becomes the new zMax0. If the working layer is
+// closer to zMax0 than to the triangle, it is dropped and started over, which only loses occlusion.
+// An occludee box is projected to a rectangle and its nearest depth. It is hidden in a tile where
+// zMax0 is nearer, or where zMax1 is nearer and the rectangle only touches working layer pixels.
+// Coverage of a tile's 8 rows is computed 8 wide with AVX2, a row per lane, from where each edge
+// crosses the row centers. Front faces are clockwise and back faces are culled, as in the graphics
+// pipeline. Triangles reaching behind the near plane are skipped. AddOccluder() sets triangles up
+// once a frame; Rasterize() over the job system takes a row of tiles per job.
+// Points are 3 consecutive floats and matrices 4x4 floats multiplying row vectors, the layout of
+// DirectXMath's XMFLOAT3 and XMFLOAT4X4, so the culler builds without it. It lives in a header so that it
+// compiles with the instruction set of the app including it.
+//
+class OcclusionCuller {
+public:
+    static constexpr uint32_t TILE_WIDTH  = 32;
+    static constexpr uint32_t TILE_HEIGHT = 8;
+
+    // box bounds as a structure of arrays, an array per axis: centers and half extents
+    struct Boxes {
+        const float* pCenter[3];
+        const float* pExtent[3];
+    };
+
+    struct Stats {
+        uint64_t frames    = 0;
+        uint64_t triangles = 0;     // set up, i.e. front facing and in front of the near plane
+        uint64_t tested    = 0;
+        uint64_t occluded  = 0;
+        float    rasterMs  = 0.0f;
+        float    testMs    = 0.0f;
+    };
+
+    void Init(uint32_t bufferWidth, uint32_t bufferHeight) {
+        width  = bufferWidth;
+        height = bufferHeight;
+        tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+        tiles.resize(size_t(tilesX) * tilesY);
+
+        Clear();
+    }
+
+    uint32_t GetWidth() const {
+        return width;
+    }
+
+    uint32_t GetHeight() const {
+        return height;
+    }
+
+    // everything at the far plane, no occluders
+    void Clear() {
+        for (Tile& tile : tiles) {
+            tile = {};
+        }
+
+        triangles.clear();
+    }
+
+    //
+    // Sets up the triangles of an occluder mesh (indexCount / 3 triangles of positions that are
+    // positionStride bytes apart) under mvp, for the next Rasterize().
+    //
+    void AddOccluder(const float (&mvp)[4][4], const float* pPositions, size_t positionStride, const uint32_t* pIndices, uint32_t indexCount) {
+        for (uint32_t t = 0; t + 3 <= indexCount; t += 3) {
+            float screen[3][3];
+            bool  behind = false;
+
+            for (uint32_t v = 0; v < 3; ++v) {
+                const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + pIndices[t + v] * positionStride);
+
+                float clip[4];
+
+                for (uint32_t c = 0; c < 4; ++c) {
+                    clip[c] = p[0] * mvp[0][c] + p[1] * mvp[1][c] + p[2] * mvp[2][c] + mvp[3][c];
+                }
+
+                if (clip[3] < NEAR_W || clip[2] < 0.0f) {
+                    behind = true;
+                    break;
+                }
+
+                ToScreen(clip, screen[v]);
+            }
+
+            if (!behind) {
+                SetupTriangle(screen);
+            }
+        }
+    }
+
+    uint32_t GetTriangleCount() const {
+        return static_cast<uint32_t>(triangles.size());
+    }
+
+    void Rasterize() {
+        auto start = std::chrono::steady_clock::now();
+
+        RasterizeRows(0, tilesY);
+
+        AddRasterTime(start);
+    }
+
+    // a row of tiles per job, every job goes through all triangles
+    void Rasterize(JobSystem& jobs) {
+        auto start = std::chrono::steady_clock::now();
+
+        jobs.ParallelFor(0, tilesY, 1, [&](uint64_t first, uint64_t last) {
+            RasterizeRows(uint32_t(first), uint32_t(last));
+        });
+
+        AddRasterTime(start);
+    }
+
+    // false if the box (world space center and half extents) is occluded or off screen
+    bool TestBox(const float* pCenter, const float* pExtent, const float (&viewProj)[4][4]) const {
+        Rect rect;
+
+        if (!ProjectBox(pCenter, pExtent, viewProj, rect)) {
+            return true;
+        }
+
+        if (rect.x0 > rect.x1 || rect.y0 > rect.y1) {
+            return false;
+        }
+
+        for (int ty = rect.y0 / int(TILE_HEIGHT); ty <= rect.y1 / int(TILE_HEIGHT); ++ty) {
+            int rowLo = (std::max)(rect.y0 - ty * int(TILE_HEIGHT), 0);
+            int rowHi = (std::min)(rect.y1 - ty * int(TILE_HEIGHT), int(TILE_HEIGHT) - 1);
+
+            for (int tx = rect.x0 / int(TILE_WIDTH); tx <= rect.x1 / int(TILE_WIDTH); ++tx) {
+                const Tile& tile = tiles[size_t(ty) * tilesX + tx];
+
+                if (rect.zMin >= tile.zMax0) {
+                    continue;
+                }
+
+                if (rect.zMin < tile.zMax1) {
+                    return true;
+                }
+
+                // between the layers: visible if it touches a pixel outside the working layer
+                int      colLo   = (std::max)(rect.x0 - tx * int(TILE_WIDTH), 0);
+                int      colHi   = (std::min)(rect.x1 - tx * int(TILE_WIDTH), int(TILE_WIDTH) - 1);
+                uint32_t columns = (colHi == 31 ? ~0u : (1u << (colHi + 1)) - 1) & ~((1u << colLo) - 1);
+
+#if defined(__AVX2__)
+                __m256i rows  = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                __m256i inside = _mm256_and_si256(_mm256_cmpgt_epi32(rows, _mm256_set1_epi32(rowLo - 1)),
+                                                  _mm256_cmpgt_epi32(_mm256_set1_epi32(rowHi + 1), rows));
+                __m256i touched = _mm256_and_si256(inside, _mm256_set1_epi32(int(columns)));
+
+                if (!_mm256_testc_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(tile.mask)), touched)) {
+                    return true;
+                }
+#else
+                for (int r = rowLo; r <= rowHi; ++r) {
+                    if ((columns & ~tile.mask[r]) != 0) {
+                        return true;
+                    }
+                }
+#endif
+            }
+        }
+
+        return false;
+    }
+
+    // keeps the objects (indices into bounds) that TestBox() passes, in order; returns how many
+    uint32_t Test(const Boxes& bounds, const float (&viewProj)[4][4], uint32_t* pObjects, uint32_t count) {
+        auto start = std::chrono::steady_clock::now();
+
+        uint32_t kept = TestRange(bounds, viewProj, pObjects, count);
+
+        AddTestTime(start, count, kept);
+
+        return kept;
+    }
+
+    // over the job system, grain objects per job; chunks filter in place and then close the gaps
+    uint32_t Test(JobSystem& jobs, uint32_t grain, const Boxes& bounds, const float (&viewProj)[4][4], uint32_t* pObjects, uint32_t count) {
+        auto start = std::chrono::steady_clock::now();
+
+        grain = (std::max)(grain, 1u);
+
+        uint32_t chunks = (count + grain - 1) / grain;
+        chunkKept.resize(chunks);
+
+        jobs.ParallelFor(0, count, grain, [&](uint64_t first, uint64_t last) {
+            chunkKept[first / grain] = TestRange(bounds, viewProj, pObjects + first, uint32_t(last - first));
+        });
+
+        uint32_t kept = 0;
+
+        for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+            if (kept != chunk * grain) {
+                memmove(pObjects + kept, pObjects + chunk * grain, chunkKept[chunk] * sizeof(uint32_t));
+            }
+
+            kept += chunkKept[chunk];
+        }
+
+        AddTestTime(start, count, kept);
+
+        return kept;
+    }
+
+    //
+    // The references the culler is checked against: a depth per pixel (width x height) from the same
+    // triangles and coverage, each pixel the plane's depth at its center, and the box test against that.
+    //
+    void RasterizeReference(std::vector<float>& depth) const {
+        depth.assign(size_t(width) * height, 1.0f);
+
+        for (const Triangle& tri : triangles) {
+            for (int ty = tri.tileMinY; ty <= tri.tileMaxY; ++ty) {
+                for (int tx = tri.tileMinX; tx <= tri.tileMaxX; ++tx) {
+                    uint32_t rows[TILE_HEIGHT];
+                    CoverageScalar(tri, tx * TILE_WIDTH, ty * TILE_HEIGHT, rows);
+
+                    for (uint32_t r = 0; r < TILE_HEIGHT; ++r) {
+                        for (uint32_t c = 0; c < TILE_WIDTH; ++c) {
+                            uint32_t x = tx * TILE_WIDTH + c, y = ty * TILE_HEIGHT + r;
+
+                            if ((rows[r] & (1u << c)) && x < width && y < height) {
+                                float& d = depth[size_t(y) * width + x];
+
+                                d = (std::min)(d, tri.zA * (x + 0.5f) + tri.zB * (y + 0.5f) + tri.zC);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    bool TestBoxReference(const std::vector<float>& depth, const float* pCenter, const float* pExtent, const float (&viewProj)[4][4]) const {
+        Rect rect;
+
+        if (!ProjectBox(pCenter, pExtent, viewProj, rect)) {
+            return true;
+        }
+
+        for (int y = rect.y0; y <= rect.y1; ++y) {
+            for (int x = rect.x0; x <= rect.x1; ++x) {
+                if (depth[size_t(y) * width + x] > rect.zMin) {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // tiles of samples random triangles where Coverage() and CoverageScalar() disagree, 0 when correct
+    uint32_t CoverageMismatches(uint32_t samples, uint32_t seed) const {
+        std::mt19937                          rng(seed);
+        std::uniform_int_distribution<size_t> pick(0, triangles.empty() ? 0 : triangles.size() - 1);
+
+        uint32_t mismatches = 0;
+
+        for (uint32_t s = 0; s < samples && !triangles.empty(); ++s) {
+            const Triangle& tri = triangles[pick(rng)];
+
+            for (int ty = tri.tileMinY; ty <= tri.tileMaxY; ++ty) {
+                for (int tx = tri.tileMinX; tx <= tri.tileMaxX; ++tx) {
+                    alignas(32) uint32_t simd[TILE_HEIGHT];
+                    uint32_t             scalar[TILE_HEIGHT];
+
+                    Coverage(tri, tx * TILE_WIDTH, ty * TILE_HEIGHT, simd);
+                    CoverageScalar(tri, tx * TILE_WIDTH, ty * TILE_HEIGHT, scalar);
+
+                    mismatches += memcmp(simd, scalar, sizeof(scalar)) != 0 ? 1 : 0;
+                }
+            }
+        }
+
+        return mismatches;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (stats.frames == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Occlusion: " << width << "x" << height << ", " << stats.triangles / stats.frames << " occluder triangles, "
+                  << stats.occluded / stats.frames << " of " << stats.tested / stats.frames << " occluded, raster "
+                  << stats.rasterMs / stats.frames << " ms, test " << stats.testMs / stats.frames << " ms" << std::endl;
+
+        stats     = {};
+        statStart = now;
+    }
+
+private:
+    static constexpr float NEAR_W = 1e-4f;
+
+    struct alignas(32) Tile
+    {
+        uint32_t mask[TILE_HEIGHT] = {};    // working layer coverage, a row per element
+        float    zMax0             = 1.0f;
+        float    zMax1             = 0.0f;
+    };
+
+    static_assert(sizeof(Tile) == 64);
+
+    //
+    // Each edge that isn't horizontal bounds rows from the left or the right: at row center y it
+    // crosses x = edgeX + (y - edgeY) * edgeSlope. Horizontal edges are covered by the row range,
+    // [yMin, yMax]. z = zA * x + zB * y + zC across the triangle.
+    //
+    struct Triangle
+    {
+        float    edgeX[3];
+        float    edgeY[3];
+        float    edgeSlope[3];
+        uint32_t edges;             // bit e: edge e bounds rows
+        uint32_t rightEdges;        // bit e: from the right
+        float    yMin, yMax;
+        float    zA, zB, zC;
+        float    zMax;
+        int      tileMinX, tileMaxX;
+        int      tileMinY, tileMaxY;
+    };
+
+    // pixels x0..x1, y0..y1 (inclusive, clamped to the buffer) and the nearest depth
+    struct Rect
+    {
+        int   x0, y0, x1, y1;
+        float zMin;
+    };
+
+    void ToScreen(const float (&clip)[4], float (&screen)[3]) const {
+        float invW = 1.0f / clip[3];
+
+        screen[0] = (clip[0] * invW * 0.5f + 0.5f) * width;
+        screen[1] = (0.5f - clip[1] * invW * 0.5f) * height;
+        screen[2] = clip[2] * invW;
+    }
+
+    void SetupTriangle(const float (&v)[3][3]) {
+        // y grows downwards, so clockwise is a positive area
+        float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[2][0] - v[0][0]) * (v[1][1] - v[0][1]);
+
+        if (!(area > 0.0f)) {
+            return;
+        }
+
+        Triangle tri;
+
+        float xMin = (std::min)((std::min)(v[0][0], v[1][0]), v[2][0]), xMax = (std::max)((std::max)(v[0][0], v[1][0]), v[2][0]);
+        tri.yMin   = (std::min)((std::min)(v[0][1], v[1][1]), v[2][1]);
+        tri.yMax   = (std::max)((std::max)(v[0][1], v[1][1]), v[2][1]);
+
+        if (xMax < 0.0f || tri.yMax < 0.0f || xMin >= float(width) || tri.yMin >= float(height)) {
+            return;
+        }
+
+        tri.tileMinX = (std::max)(int(xMin) / int(TILE_WIDTH), 0);
+        tri.tileMaxX = (std::min)(int(xMax) / int(TILE_WIDTH), int(tilesX) - 1);
+        tri.tileMinY = (std::max)(int(tri.yMin) / int(TILE_HEIGHT), 0);
+        tri.tileMaxY = (std::min)(int(tri.yMax) / int(TILE_HEIGHT), int(tilesY) - 1);
+
+        tri.edges      = 0;
+        tri.rightEdges = 0;
+
+        for (uint32_t e = 0; e < 3; ++e) {
+            const float* a = v[e];
+            const float* b = v[(e + 1) % 3];
+
+            float dy = b[1] - a[1];
+
+            tri.edgeX[e]     = a[0];
+            tri.edgeY[e]     = a[1];
+            tri.edgeSlope[e] = dy != 0.0f ? (b[0] - a[0]) / dy : 0.0f;
+
+            // going down, the inside is on the left of a clockwise edge
+            if (dy != 0.0f) {
+                tri.edges      |= 1u << e;
+                tri.rightEdges |= dy > 0.0f ? 1u << e : 0;
+            }
+        }
+
+        tri.zA   = ((v[1][2] - v[0][2]) * (v[2][1] - v[0][1]) - (v[2][2] - v[0][2]) * (v[1][1] - v[0][1])) / area;
+        tri.zB   = ((v[1][0] - v[0][0]) * (v[2][2] - v[0][2]) - (v[2][0] - v[0][0]) * (v[1][2] - v[0][2])) / area;
+        tri.zC   = v[0][2] - tri.zA * v[0][0] - tri.zB * v[0][1];
+        tri.zMax = (std::max)((std::max)(v[0][2], v[1][2]), v[2][2]);
+
+        triangles.push_back(tri);
+    }
+
+    // first pixel (offset from the tile's first center) a left edge keeps, one past the last for a right edge
+    static int EdgeStart(float offset, bool right) {
+        offset = (std::min)((std::max)(offset, -1.0f), float(TILE_WIDTH + 1));
+        return (std::min)((std::max)(right ? int(floorf(offset)) + 1 : int(ceilf(offset)), 0), int(TILE_WIDTH));
+    }
+
+    // rows of the tile at (tileX, tileY) the triangle covers, bit c of rows[r] is pixel (c, r)
+    static void CoverageScalar(const Triangle& tri, int tileX, int tileY, uint32_t (&rows)[TILE_HEIGHT]) {
+        for (uint32_t r = 0; r < TILE_HEIGHT; ++r) {
+            float y = float(tileY) + r + 0.5f;
+
+            rows[r] = y >= tri.yMin && y <= tri.yMax ? ~0u : 0u;
+
+            for (uint32_t e = 0; e < 3; ++e) {
+                if ((tri.edges & (1u << e)) == 0) {
+                    continue;
+                }
+
+                float x     = std::fma(y - tri.edgeY[e], tri.edgeSlope[e], tri.edgeX[e]);
+                bool  right = (tri.rightEdges & (1u << e)) != 0;
+                int   start = EdgeStart(x - (float(tileX) + 0.5f), right);
+
+                uint32_t from = start >= int(TILE_WIDTH) ? 0u : ~0u << start;
+
+                rows[r] &= right ? ~from : from;
+            }
+        }
+    }
+
+    static void Coverage(const Triangle& tri, int tileX, int tileY, uint32_t (&rows)[TILE_HEIGHT]) {
+#if defined(__AVX2__)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(rows), CoverageAvx2(tri, tileX, tileY));
+#else
+        CoverageScalar(tri, tileX, tileY, rows);
+#endif
+    }
+
+#if defined(__AVX2__)
+    // CoverageScalar() with a row per lane; variable shifts by 32 give 0 like the scalar special case
+    static __m256i CoverageAvx2(const Triangle& tri, int tileX, int tileY) {
+        const __m256  rowY = _mm256_add_ps(_mm256_set1_ps(float(tileY)), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+        const __m256i ones = _mm256_set1_epi32(-1);
+
+        __m256i cover = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(rowY, _mm256_set1_ps(tri.yMin), _CMP_GE_OQ),
+                                                          _mm256_cmp_ps(rowY, _mm256_set1_ps(tri.yMax), _CMP_LE_OQ)));
+
+        for (uint32_t e = 0; e < 3; ++e) {
+            if ((tri.edges & (1u << e)) == 0) {
+                continue;
+            }
+
+            __m256 x      = _mm256_fmadd_ps(_mm256_sub_ps(rowY, _mm256_set1_ps(tri.edgeY[e])), _mm256_set1_ps(tri.edgeSlope[e]), _mm256_set1_ps(tri.edgeX[e]));
+            __m256 offset = _mm256_sub_ps(x, _mm256_set1_ps(float(tileX) + 0.5f));
+
+            offset = _mm256_min_ps(_mm256_max_ps(offset, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(float(TILE_WIDTH + 1)));
+
+            bool    right = (tri.rightEdges & (1u << e)) != 0;
+            __m256i start = right ? _mm256_add_epi32(_mm256_cvttps_epi32(_mm256_floor_ps(offset)), _mm256_set1_epi32(1))
+                                  : _mm256_cvttps_epi32(_mm256_ceil_ps(offset));
+
+            start = _mm256_min_epi32(_mm256_max_epi32(start, _mm256_setzero_si256()), _mm256_set1_epi32(TILE_WIDTH));
+
+            __m256i from = _mm256_sllv_epi32(ones, start);
+
+            cover = right ? _mm256_andnot_si256(from, cover) : _mm256_and_si256(from, cover);
+        }
+
+        return cover;
+    }
+#endif
+
+    void RasterizeRows(uint32_t firstRow, uint32_t lastRow) {
+        for (const Triangle& tri : triangles) {
+            int rowLo = (std::max)(tri.tileMinY, int(firstRow));
+            int rowHi = (std::min)(tri.tileMaxY, int(lastRow) - 1);
+
+            for (int ty = rowLo; ty <= rowHi; ++ty) {
+                for (int tx = tri.tileMinX; tx <= tri.tileMaxX; ++tx) {
+                    Tile& tile = tiles[size_t(ty) * tilesX + tx];
+
+                    // farthest the triangle gets inside the tile: its plane at the tile's corner pixel centers
+                    float x0 = tx * float(TILE_WIDTH) + 0.5f, x1 = x0 + TILE_WIDTH - 1;
+                    float y0 = ty * float(TILE_HEIGHT) + 0.5f, y1 = y0 + TILE_HEIGHT - 1;
+                    float z  = (std::min)(tri.zC + tri.zA * (tri.zA > 0.0f ? x1 : x0) + tri.zB * (tri.zB > 0.0f ? y1 : y0), tri.zMax);
+
+                    if (z >= tile.zMax0) {
+                        continue;
+                    }
+
+                    alignas(32) uint32_t rows[TILE_HEIGHT];
+                    Coverage(tri, tx * TILE_WIDTH, ty * TILE_HEIGHT, rows);
+
+                    UpdateTile(tile, rows, z);
+                }
+            }
+        }
+    }
+
+    static void UpdateTile(Tile& tile, const uint32_t (&rows)[TILE_HEIGHT], float z) {
+#if defined(__AVX2__)
+        __m256i coverage = _mm256_load_si256(reinterpret_cast<const __m256i*>(rows));
+
+        if (_mm256_testz_si256(coverage, coverage)) {
+            return;
+        }
+
+        // the working layer is nearer the reference layer than this triangle: start it over
+        if (tile.zMax1 - z > tile.zMax0 - tile.zMax1) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(tile.mask), _mm256_setzero_si256());
+            tile.zMax1 = 0.0f;
+        }
+
+        __m256i mask = _mm256_or_si256(_mm256_load_si256(reinterpret_cast<const __m256i*>(tile.mask)), coverage);
+        tile.zMax1   = (std::max)(tile.zMax1, z);
+
+        if (_mm256_testc_si256(mask, _mm256_set1_epi32(-1))) {
+            tile.zMax0 = tile.zMax1;
+            tile.zMax1 = 0.0f;
+            mask       = _mm256_setzero_si256();
+        }
+
+        _mm256_store_si256(reinterpret_cast<__m256i*>(tile.mask), mask);
+#else
+        uint32_t any = 0;
+
+        for (uint32_t row : rows) {
+            any |= row;
+        }
+
+        if (any == 0) {
+            return;
+        }
+
+        if (tile.zMax1 - z > tile.zMax0 - tile.zMax1) {
+            std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+            tile.zMax1 = 0.0f;
+        }
+
+        uint32_t full = ~0u;
+
+        for (uint32_t r = 0; r < TILE_HEIGHT; ++r) {
+            tile.mask[r] |= rows[r];
+            full         &= tile.mask[r];
+        }
+
+        tile.zMax1 = (std::max)(tile.zMax1, z);
+
+        if (full == ~0u) {
+            tile.zMax0 = tile.zMax1;
+            tile.zMax1 = 0.0f;
+            std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+        }
+#endif
+    }
+
+    // false if a corner is behind the near plane: the box can't be tested and counts as visible
+    bool ProjectBox(const float* pCenter, const float* pExtent, const float (&viewProj)[4][4], Rect& rect) const {
+        float xMin = FLT_MAX, xMax = -FLT_MAX, yMin = FLT_MAX, yMax = -FLT_MAX;
+
+#if defined(__AVX2__)
+        // a corner per lane
+        __m256 p[3] = {
+            _mm256_fmadd_ps(_mm256_setr_ps(-1, 1, -1, 1, -1, 1, -1, 1), _mm256_set1_ps(pExtent[0]), _mm256_set1_ps(pCenter[0])),
+            _mm256_fmadd_ps(_mm256_setr_ps(-1, -1, 1, 1, -1, -1, 1, 1), _mm256_set1_ps(pExtent[1]), _mm256_set1_ps(pCenter[1])),
+            _mm256_fmadd_ps(_mm256_setr_ps(-1, -1, -1, -1, 1, 1, 1, 1), _mm256_set1_ps(pExtent[2]), _mm256_set1_ps(pCenter[2]))
+        };
+
+        __m256 clip[4];
+
+        for (uint32_t c = 0; c < 4; ++c) {
+            clip[c] = _mm256_fmadd_ps(p[0], _mm256_set1_ps(viewProj[0][c]),
+                      _mm256_fmadd_ps(p[1], _mm256_set1_ps(viewProj[1][c]),
+                      _mm256_fmadd_ps(p[2], _mm256_set1_ps(viewProj[2][c]), _mm256_set1_ps(viewProj[3][c]))));
+        }
+
+        __m256 behind = _mm256_or_ps(_mm256_cmp_ps(clip[3], _mm256_set1_ps(NEAR_W), _CMP_LT_OQ), _mm256_cmp_ps(clip[2], _mm256_setzero_ps(), _CMP_LT_OQ));
+
+        if (_mm256_movemask_ps(behind) != 0) {
+            return false;
+        }
+
+        __m256 invW = _mm256_div_ps(_mm256_set1_ps(1.0f), clip[3]);
+        __m256 half = _mm256_set1_ps(0.5f);
+        __m256 x    = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_mul_ps(clip[0], invW), half, half), _mm256_set1_ps(float(width)));
+        __m256 y    = _mm256_mul_ps(_mm256_fnmadd_ps(_mm256_mul_ps(clip[1], invW), half, half), _mm256_set1_ps(float(height)));
+
+        xMin      = HorizontalMin(x);
+        xMax      = -HorizontalMin(_mm256_sub_ps(_mm256_setzero_ps(), x));
+        yMin      = HorizontalMin(y);
+        yMax      = -HorizontalMin(_mm256_sub_ps(_mm256_setzero_ps(), y));
+        rect.zMin = HorizontalMin(_mm256_mul_ps(clip[2], invW));
+#else
+        rect.zMin = FLT_MAX;
+
+        for (uint32_t corner = 0; corner < 8; ++corner) {
+            float p[3] = {
+                pCenter[0] + (corner & 1 ? pExtent[0] : -pExtent[0]),
+                pCenter[1] + (corner & 2 ? pExtent[1] : -pExtent[1]),
+                pCenter[2] + (corner & 4 ? pExtent[2] : -pExtent[2])
+            };
+
+            float clip[4];
+
+            for (uint32_t c = 0; c < 4; ++c) {
+                clip[c] = p[0] * viewProj[0][c] + p[1] * viewProj[1][c] + p[2] * viewProj[2][c] + viewProj[3][c];
+            }
+
+            if (clip[3] < NEAR_W || clip[2] < 0.0f) {
+                return false;
+            }
+
+            float screen[3];
+            ToScreen(clip, screen);
+
+            xMin      = (std::min)(xMin, screen[0]);
+            xMax      = (std::max)(xMax, screen[0]);
+            yMin      = (std::min)(yMin, screen[1]);
+            yMax      = (std::max)(yMax, screen[1]);
+            rect.zMin = (std::min)(rect.zMin, screen[2]);
+        }
+#endif
+
+        // every pixel the rectangle touches; off screen comes out empty
+        rect.x0 = int((std::max)(floorf(xMin), 0.0f));
+        rect.y0 = int((std::max)(floorf(yMin), 0.0f));
+        rect.x1 = int((std::min)(floorf(xMax), float(width) - 1.0f));
+        rect.y1 = int((std::min)(floorf(yMax), float(height) - 1.0f));
+
+        return true;
+    }
+
+#if defined(__AVX2__)
+    static float HorizontalMin(__m256 v) {
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m        = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        m        = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+
+        return _mm_cvtss_f32(m);
+    }
+#endif
+
+    uint32_t TestRange(const Boxes& bounds, const float (&viewProj)[4][4], uint32_t* pObjects, uint32_t count) const {
+        uint32_t kept = 0;
+
+        for (uint32_t n = 0; n < count; ++n) {
+            uint32_t i = pObjects[n];
+
+            float center[3] = { bounds.pCenter[0][i], bounds.pCenter[1][i], bounds.pCenter[2][i] };
+            float extent[3] = { bounds.pExtent[0][i], bounds.pExtent[1][i], bounds.pExtent[2][i] };
+
+            if (TestBox(center, extent, viewProj)) {
+                pObjects[kept++] = i;
+            }
+        }
+
+        return kept;
+    }
+
+    void AddRasterTime(std::chrono::steady_clock::time_point start) {
+        stats.frames    += 1;
+        stats.triangles += triangles.size();
+        stats.rasterMs  += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void AddTestTime(std::chrono::steady_clock::time_point start, uint32_t tested, uint32_t kept) {
+        stats.tested   += tested;
+        stats.occluded += tested - kept;
+        stats.testMs   += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint32_t                              width     = 0;
+    uint32_t                              height    = 0;
+    uint32_t                              tilesX    = 0;
+    uint32_t                              tilesY    = 0;
+    std::vector<Tile>                     tiles;
+    std::vector<Triangle>                 triangles;
+    std::vector<uint32_t>                 chunkKept;    // per chunk of the last parallel Test()
+
+    Stats                                 stats;
+    std::chrono::steady_clock::time_point statStart = std::chrono::steady_clock::now();
+};
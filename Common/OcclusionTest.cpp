@@ -0,0 +1,407 @@
+#include "DepthPyramid.h"
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//
+// The checks of OcclusionCuller and DepthPyramid, on the scenes of RotatingPyramid's --bench=occlusion:
+// a thick wall with boxes around it, and a city of 20x20 random buildings seen from street level with
+// 100K small boxes scattered through it. A pyramid level has to hold the nearest and farthest depth
+// of the pixels under each texel, and a pyramid built from the city's reference depth never culls a
+// box the reference shows. Exits nonzero if any of them fails. Built twice, with and without AVX2,
+// since the coverage only has a second implementation to disagree with under AVX2.
+//
+
+using Matrix = float[4][4];
+
+struct Float3
+{
+    float x, y, z;
+};
+
+// the matrices of XMMatrixPerspectiveFovLH, XMMatrixLookAtLH and scaling then translation, row vectors
+static void Perspective(float fovY, float aspect, float nearZ, float farZ, Matrix& m) {
+    float h     = 1.0f / std::tan(fovY * 0.5f);
+    float range = farZ / (farZ - nearZ);
+
+    m[0][0] = h / aspect; m[0][1] = 0.0f; m[0][2] = 0.0f;            m[0][3] = 0.0f;
+    m[1][0] = 0.0f;       m[1][1] = h;    m[1][2] = 0.0f;            m[1][3] = 0.0f;
+    m[2][0] = 0.0f;       m[2][1] = 0.0f; m[2][2] = range;           m[2][3] = 1.0f;
+    m[3][0] = 0.0f;       m[3][1] = 0.0f; m[3][2] = -range * nearZ;  m[3][3] = 0.0f;
+}
+
+static void LookAt(const Float3& eye, const Float3& at, Matrix& m) {
+    auto Normalize = [](Float3 v) {
+        float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        return Float3{ v.x / length, v.y / length, v.z / length };
+    };
+
+    auto Cross = [](const Float3& a, const Float3& b) {
+        return Float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+    };
+
+    auto Dot = [](const Float3& a, const Float3& b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    };
+
+    Float3 z = Normalize({ at.x - eye.x, at.y - eye.y, at.z - eye.z });
+    Float3 x = Normalize(Cross({ 0.0f, 1.0f, 0.0f }, z));
+    Float3 y = Cross(z, x);
+
+    m[0][0] = x.x;           m[0][1] = y.x;           m[0][2] = z.x;           m[0][3] = 0.0f;
+    m[1][0] = x.y;           m[1][1] = y.y;           m[1][2] = z.y;           m[1][3] = 0.0f;
+    m[2][0] = x.z;           m[2][1] = y.z;           m[2][2] = z.z;           m[2][3] = 0.0f;
+    m[3][0] = -Dot(x, eye);  m[3][1] = -Dot(y, eye);  m[3][2] = -Dot(z, eye);  m[3][3] = 1.0f;
+}
+
+static void ScaleTranslate(const Float3& scale, const Float3& offset, Matrix& m) {
+    m[0][0] = scale.x;  m[0][1] = 0.0f;     m[0][2] = 0.0f;     m[0][3] = 0.0f;
+    m[1][0] = 0.0f;     m[1][1] = scale.y;  m[1][2] = 0.0f;     m[1][3] = 0.0f;
+    m[2][0] = 0.0f;     m[2][1] = 0.0f;     m[2][2] = scale.z;  m[2][3] = 0.0f;
+    m[3][0] = offset.x; m[3][1] = offset.y; m[3][2] = offset.z; m[3][3] = 1.0f;
+}
+
+static void Multiply(const Matrix& a, const Matrix& b, Matrix& m) {
+    for (uint32_t r = 0; r < 4; ++r) {
+        for (uint32_t c = 0; c < 4; ++c) {
+            m[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
+        }
+    }
+}
+
+// a unit cube, each face clockwise seen from outside
+static void CubeMesh(std::vector<Float3>& positions, std::vector<uint32_t>& indices) {
+    for (uint32_t corner = 0; corner < 8; ++corner) {
+        positions.push_back({ corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f });
+    }
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        for (int side : { -1, 1 }) {
+            uint32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
+
+            if (side < 0) {
+                std::swap(u, v);
+            }
+
+            auto Corner = [&](int du, int dv) {
+                return (side > 0 ? 1u << axis : 0u) | (du > 0 ? 1u << u : 0u) | (dv > 0 ? 1u << v : 0u);
+            };
+
+            for (uint32_t index : { Corner(-1, -1), Corner(1, -1), Corner(1, 1), Corner(-1, -1), Corner(1, 1), Corner(-1, 1) }) {
+                indices.push_back(index);
+            }
+        }
+    }
+}
+
+class Scene {
+public:
+    Scene(const Float3& eye, const Float3& at) {
+        Matrix view, projection;
+
+        LookAt(eye, at, view);
+        Perspective(70.0f * 3.14159265f / 180.0f, 1920.0f / 1080.0f, 0.1f, 500.0f, projection);
+        Multiply(view, projection, viewProj);
+
+        CubeMesh(cube, cubeIndices);
+    }
+
+    void AddBox(OcclusionCuller& culler, const Float3& center, const Float3& extent) const {
+        Matrix world, mvp;
+
+        ScaleTranslate(extent, center, world);
+        Multiply(world, viewProj, mvp);
+
+        culler.AddOccluder(mvp, &cube[0].x, sizeof(Float3), cubeIndices.data(), uint32_t(cubeIndices.size()));
+    }
+
+    Matrix viewProj;
+
+private:
+    std::vector<Float3>   cube;
+    std::vector<uint32_t> cubeIndices;
+};
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+// a wall from z = 0 to 10 in front of the camera, and boxes that it does and doesn't hide
+static void TestWall() {
+    Scene scene({ 0.0f, 0.0f, -20.0f }, { 0.0f, 0.0f, 0.0f });
+
+    OcclusionCuller culler;
+    culler.Init(320, 180);
+
+    scene.AddBox(culler, { 0.0f, 0.0f, 5.0f }, { 10.0f, 10.0f, 5.0f });
+    culler.Rasterize();
+
+    Check(culler.GetTriangleCount() == 2, "wall: only the front face is set up");
+
+    struct Case
+    {
+        const char* name;
+        Float3      center;
+        bool        visible;
+    };
+
+    const Case cases[] = {
+        { "wall: box behind",         { 0.0f, 0.0f, 20.0f },    false },
+        { "wall: box inside",         { 0.0f, 0.0f, 5.0f },     false },
+        { "wall: box in front",       { 0.0f, 0.0f, -5.0f },    true  },
+        { "wall: box beside",         { 30.0f, 0.0f, 20.0f },   true  },
+        { "wall: box peeking over",   { 0.0f, 25.0f, 30.0f },   true  },
+        { "wall: box off screen",     { 200.0f, 0.0f, 20.0f },  false },
+        { "wall: box behind the eye", { 0.0f, 0.0f, -30.0f },   true  },
+    };
+
+    const Float3 extent = { 1.0f, 1.0f, 1.0f };
+
+    for (const Case& c : cases) {
+        Check(culler.TestBox(&c.center.x, &extent.x, scene.viewProj) == c.visible, c.name);
+    }
+}
+
+//
+// A grid of 20x20 buildings 10 units apart, seen from street level at one end. The culler may keep
+// hidden boxes, but never drops one that the per pixel reference shows, and rasterizing or testing
+// on jobs gives what one thread does.
+//
+static void TestCity(JobSystem& jobSystem) {
+    Scene scene({ 5.0f, 2.0f, -110.0f }, { 5.0f, 2.0f, 0.0f });
+
+    std::mt19937                          rng(11);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    OcclusionCuller serialCuller, jobsCuller;
+    serialCuller.Init(320, 180);
+    jobsCuller.Init(320, 180);
+
+    for (int z = 0; z < 20; ++z) {
+        for (int x = 0; x < 20; ++x) {
+            float  height = 3.0f + unit(rng) * 17.0f;
+            Float3 center = { x * 10.0f - 95.0f, height, z * 10.0f - 95.0f };
+            Float3 extent = { 2.0f + unit(rng) * 2.5f, height, 2.0f + unit(rng) * 2.5f };
+
+            scene.AddBox(serialCuller, center, extent);
+            scene.AddBox(jobsCuller, center, extent);
+        }
+    }
+
+    serialCuller.Rasterize();
+    jobsCuller.Rasterize(jobSystem);
+
+    const uint32_t BOXES = 100000;
+
+    std::vector<float> centers[3], extents[3];
+
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        centers[axis].resize(BOXES);
+        extents[axis].assign(BOXES, 0.5f);
+    }
+
+    for (uint32_t i = 0; i < BOXES; ++i) {
+        centers[0][i] = unit(rng) * 200.0f - 100.0f;
+        centers[1][i] = unit(rng) * 10.0f;
+        centers[2][i] = unit(rng) * 200.0f - 100.0f;
+    }
+
+    const OcclusionCuller::Boxes boxes = {
+        .pCenter = { centers[0].data(), centers[1].data(), centers[2].data() },
+        .pExtent = { extents[0].data(), extents[1].data(), extents[2].data() }
+    };
+
+    std::vector<uint32_t> serial(BOXES), parallel(BOXES);
+
+    for (uint32_t i = 0; i < BOXES; ++i) {
+        serial[i]   = i;
+        parallel[i] = i;
+    }
+
+    uint32_t serialKept   = serialCuller.Test(boxes, scene.viewProj, serial.data(), BOXES);
+    uint32_t parallelKept = jobsCuller.Test(jobSystem, 256, boxes, scene.viewProj, parallel.data(), BOXES);
+
+    Check(serialKept == parallelKept && std::equal(serial.begin(), serial.begin() + serialKept, parallel.begin()),
+          "city: culling on jobs keeps what one thread keeps");
+
+    std::vector<float> depth;
+    serialCuller.RasterizeReference(depth);
+
+    uint32_t referenceHidden = 0, wronglyCulled = 0;
+    size_t   next            = 0;
+
+    for (uint32_t i = 0; i < BOXES; ++i) {
+        bool kept = next < serialKept && serial[next] == i;
+        next     += kept ? 1 : 0;
+
+        float center[3] = { centers[0][i], centers[1][i], centers[2][i] };
+        float extent[3] = { extents[0][i], extents[1][i], extents[2][i] };
+
+        bool visible = serialCuller.TestBoxReference(depth, center, extent, scene.viewProj);
+
+        referenceHidden += visible ? 0 : 1;
+        wronglyCulled   += visible && !kept ? 1 : 0;
+    }
+
+    std::cout << "city: " << serialCuller.GetTriangleCount() << " triangles, " << BOXES - serialKept << " of " << BOXES
+              << " boxes culled, reference " << referenceHidden << ", " << wronglyCulled << " wrongly culled" << std::endl;
+
+    Check(wronglyCulled == 0, "city: no box the reference shows is culled");
+    Check(serialKept < BOXES, "city: the buildings hide some boxes");
+    Check(serialCuller.CoverageMismatches(1000, 5) == 0, "city: the AVX2 coverage matches the scalar coverage");
+
+    // the same boxes against a pyramid of the reference depth
+    DepthPyramid pyramid;
+    pyramid.Build(jobSystem, depth.data(), serialCuller.GetWidth(), serialCuller.GetHeight(), serialCuller.GetWidth() * sizeof(float));
+
+    std::vector<uint32_t> pyramidSerial, pyramidParallel(BOXES);
+
+    uint32_t pyramidWrong = 0;
+
+    for (uint32_t i = 0; i < BOXES; ++i) {
+        float center[3] = { centers[0][i], centers[1][i], centers[2][i] };
+        float extent[3] = { extents[0][i], extents[1][i], extents[2][i] };
+
+        bool kept = pyramid.TestBox(center, extent, scene.viewProj);
+
+        if (kept) {
+            pyramidSerial.push_back(i);
+        }
+
+        pyramidParallel[i] = i;
+        pyramidWrong      += !kept && serialCuller.TestBoxReference(depth, center, extent, scene.viewProj) ? 1 : 0;
+    }
+
+    uint32_t pyramidKept = pyramid.Test(jobSystem, 1000, boxes, scene.viewProj, pyramidParallel.data(), BOXES);
+
+    std::cout << "city: pyramid culls " << BOXES - pyramidSerial.size() << " of " << BOXES << " boxes, " << pyramidWrong << " wrongly" << std::endl;
+
+    Check(pyramidWrong == 0, "city: the pyramid culls no box the reference shows");
+    Check(pyramidSerial.size() < BOXES, "city: the pyramid culls some boxes");
+    Check(pyramidKept == pyramidSerial.size() && std::equal(pyramidSerial.begin(), pyramidSerial.end(), pyramidParallel.begin()),
+          "city: the pyramid test on jobs keeps what one box at a time keeps");
+}
+
+//
+// Random depth in odd and even sizes, with a row pitch wider than the rows. Every texel of every
+// level is checked against the pixels under it, a build on jobs has to match one thread exactly, and
+// Compare() finds the one texel of a GPU level that differs.
+//
+static void TestPyramid(JobSystem& jobSystem) {
+    struct Case
+    {
+        uint32_t width;
+        uint32_t height;
+    };
+
+    const Case cases[] = { { 1, 1 }, { 2, 2 }, { 37, 23 }, { 320, 180 }, { 1917, 1079 } };
+
+    std::mt19937                          rng(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    bool levelCounts = true, levelsMatch = true, jobsMatch = true, compares = true;
+
+    for (const Case& c : cases) {
+        const uint32_t pitch = c.width + 3;
+
+        std::vector<float> depth(size_t(pitch) * c.height);
+
+        for (float& d : depth) {
+            d = unit(rng);
+        }
+
+        DepthPyramid serial, parallel;
+        serial.Build(depth.data(), c.width, c.height, pitch * sizeof(float));
+        parallel.Build(jobSystem, depth.data(), c.width, c.height, pitch * sizeof(float));
+
+        uint32_t levels = serial.GetLevelCount();
+
+        levelCounts &= levels == DepthPyramid::LevelCount(c.width, c.height) && parallel.GetLevelCount() == levels;
+        levelCounts &= serial.GetWidth(levels - 1) == 1 && serial.GetHeight(levels - 1) == 1;
+
+        for (uint32_t level = 0; level < levels; ++level) {
+            uint32_t width  = serial.GetWidth(level);
+            uint32_t height = serial.GetHeight(level);
+            uint32_t scale  = 2u << level;
+
+            const DepthPyramid::Texel* pTexels = serial.Get(level);
+
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    float lo = 1.0f, hi = 0.0f;
+
+                    for (uint32_t py = y * scale; py < (std::min)((y + 1) * scale, c.height); ++py) {
+                        for (uint32_t px = x * scale; px < (std::min)((x + 1) * scale, c.width); ++px) {
+                            lo = (std::min)(lo, depth[size_t(py) * pitch + px]);
+                            hi = (std::max)(hi, depth[size_t(py) * pitch + px]);
+                        }
+                    }
+
+                    levelsMatch &= pTexels[size_t(y) * width + x].lo == lo && pTexels[size_t(y) * width + x].hi == hi;
+                }
+            }
+
+            jobsMatch &= memcmp(pTexels, parallel.Get(level), size_t(width) * height * sizeof(DepthPyramid::Texel)) == 0;
+
+            // the level as the GPU reads it back, each reduction, with one texel off
+            std::vector<float> minRows(size_t(width + 1) * height), maxRows(size_t(width + 1) * height), minMaxRows(size_t(width + 1) * height * 2);
+
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    const DepthPyramid::Texel& texel = pTexels[size_t(y) * width + x];
+
+                    minRows[size_t(y) * (width + 1) + x]            = texel.lo;
+                    maxRows[size_t(y) * (width + 1) + x]            = texel.hi;
+                    minMaxRows[(size_t(y) * (width + 1) + x) * 2]     = texel.lo;
+                    minMaxRows[(size_t(y) * (width + 1) + x) * 2 + 1] = texel.hi;
+                }
+            }
+
+            auto Bytes = [](const std::vector<float>& rows) { return reinterpret_cast<const uint8_t*>(rows.data()); };
+
+            compares &= serial.Compare(level, DepthPyramid::Reduction::Min, Bytes(minRows), (width + 1) * sizeof(float)) == 0;
+            compares &= serial.Compare(level, DepthPyramid::Reduction::Max, Bytes(maxRows), (width + 1) * sizeof(float)) == 0;
+            compares &= serial.Compare(level, DepthPyramid::Reduction::MinMax, Bytes(minMaxRows), (width + 1) * 2 * sizeof(float)) == 0;
+
+            minMaxRows[(size_t(height - 1) * (width + 1) + width - 1) * 2 + 1] += 1.0f;
+
+            compares &= serial.Compare(level, DepthPyramid::Reduction::MinMax, Bytes(minMaxRows), (width + 1) * 2 * sizeof(float)) == 1;
+        }
+    }
+
+    Check(levelCounts, "pyramid: levels halve down to 1x1");
+    Check(levelsMatch, "pyramid: a texel holds the nearest and farthest depth of the pixels under it");
+    Check(jobsMatch, "pyramid: building on jobs gives what one thread does");
+    Check(compares, "pyramid: Compare() finds exactly the texels that differ");
+}
+
+int main() {
+#if defined(__AVX2__)
+    std::cout << "OcclusionCuller, AVX2 coverage" << std::endl;
+#else
+    std::cout << "OcclusionCuller, scalar coverage" << std::endl;
+#endif
+
+    JobSystem jobSystem;
+    jobSystem.Init(3);
+
+    TestWall();
+    TestCity(jobSystem);
+    TestPyramid(jobSystem);
+
+    jobSystem.Destroy();
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+// Windows only: the apps include it, the Common library doesn't build it
+#include <Windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+//
+// Watches a directory on a background thread and reports the files that changed.
+// Notifications are coalesced for a short quiet period so an editor's save (which
+// usually fires several writes) results in a single callback. When more changes
+// arrive than the notification buffer holds, Windows drops all of them; the watcher
+// then reports every file in the list passed to Start() as changed.
+//
+class ShaderWatcher {
+public:
+    using Callback = std::function<void(const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange)>;
+
+    static constexpr DWORD QUIET_PERIOD_MS = 50;
+
+    ~ShaderWatcher() {
+        Stop();
+    }
+
+    bool Start(const std::wstring& directory, std::vector<std::wstring>&& files, Callback&& callback) {
+        dirHandle = CreateFileW(directory.c_str(), FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+            OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+
+        if (dirHandle == INVALID_HANDLE_VALUE) {
+            dirHandle = NULL;
+            return false;
+        }
+
+        stopEvent    = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+        watchedFiles = std::move(files);
+        onChange     = std::move(callback);
+        thread       = std::thread(&ShaderWatcher::Watch, this);
+
+        return true;
+    }
+
+    void Stop() {
+        if (thread.joinable()) {
+            SetEvent(stopEvent);
+            thread.join();
+        }
+
+        if (dirHandle) {
+            CloseHandle(dirHandle);
+            dirHandle = NULL;
+        }
+
+        if (stopEvent) {
+            CloseHandle(stopEvent);
+            stopEvent = NULL;
+        }
+    }
+
+private:
+    void Watch() {
+        alignas(DWORD) BYTE buffer[4096];
+
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+
+        std::vector<std::wstring>             pending;
+        std::chrono::steady_clock::time_point firstChange;
+
+        auto Arm = [&] {
+            ResetEvent(overlapped.hEvent);
+            return ReadDirectoryChangesW(dirHandle, buffer, sizeof buffer, FALSE,
+                FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, nullptr, &overlapped, nullptr);
+        };
+
+        auto Add = [&](std::wstring&& name) {
+            if (pending.empty()) {
+                firstChange = std::chrono::steady_clock::now();
+            }
+
+            if (std::find(pending.begin(), pending.end(), name) == pending.end()) {
+                pending.push_back(std::move(name));
+            }
+        };
+
+        bool armed = Arm();
+
+        while (armed) {
+            HANDLE handles[] = { overlapped.hEvent, stopEvent };
+            DWORD  result    = WaitForMultipleObjects(2, handles, FALSE, pending.empty() ? INFINITE : QUIET_PERIOD_MS);
+
+            if (result == WAIT_TIMEOUT) {
+                onChange(pending, firstChange);
+                pending.clear();
+                continue;
+            }
+
+            if (result != WAIT_OBJECT_0) {
+                break;
+            }
+
+            DWORD bytes = 0;
+            BOOL  done  = GetOverlappedResult(dirHandle, &overlapped, &bytes, FALSE);
+
+            if (done && bytes > 0) {
+                BYTE* cursor = buffer;
+
+                for (;;) {
+                    auto* info = reinterpret_cast<FILE_NOTIFY_INFORMATION*>(cursor);
+
+                    Add(std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR)));
+
+                    if (info->NextEntryOffset == 0) {
+                        break;
+                    }
+
+                    cursor += info->NextEntryOffset;
+                }
+            }
+            else if (done || GetLastError() == ERROR_NOTIFY_ENUM_DIR) {
+                // the buffer overflowed and the changes are lost, so any of the files may have changed
+                for (const std::wstring& file : watchedFiles) {
+                    Add(std::wstring(file));
+                }
+            }
+
+            armed = Arm();
+        }
+
+        CancelIoEx(dirHandle, &overlapped);
+
+        DWORD bytes = 0;
+        GetOverlappedResult(dirHandle, &overlapped, &bytes, TRUE);
+        CloseHandle(overlapped.hEvent);
+    }
+
+    HANDLE                    dirHandle = NULL;
+    HANDLE                    stopEvent = NULL;
+    std::vector<std::wstring> watchedFiles;         // reported on overflow
+    Callback                  onChange;
+    std::thread               thread;
+};
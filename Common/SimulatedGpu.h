@@ -0,0 +1,102 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "FrameScheduler.h"
+
+//
+// Stand-in for the GPU: each queue runs its submissions back to back, every submission costing
+// the time handed to Submit(). Completion is derived from the wall clock. QueueWait() is the GPU side
+// wait of ID3D12CommandQueue::Wait: what is submitted after it starts once the point has completed.
+//
+class SimulatedGpu {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void Submit(uint32_t queue, Clock::duration cost) {
+        pendingCost[queue] += cost;
+    }
+
+    void Signal(uint32_t queue, uint64_t value) {
+        busyUntil[queue] = (std::max)(Clock::now(), busyUntil[queue]) + pendingCost[queue];
+        pendingCost[queue] = {};
+
+        signals[queue].push_back({ value, busyUntil[queue] });
+    }
+
+    void QueueWait(uint32_t queue, FrameScheduler::TimelinePoint point) {
+        busyUntil[queue]   = (std::max)(Clock::now(), busyUntil[queue]) + pendingCost[queue];
+        pendingCost[queue] = {};
+
+        busyUntil[queue] = (std::max)(busyUntil[queue], CompletionTime(point.queue, point.value));
+    }
+
+    uint64_t CompletedValue(uint32_t queue) {
+        auto  now    = Clock::now();
+        auto& queued = signals[queue];
+
+        while (!queued.empty() && queued.front().second <= now) {
+            completed[queue] = queued.front().first;
+            queued.pop_front();
+        }
+
+        return completed[queue];
+    }
+
+    void Wait(const FrameScheduler::TimelinePoint* points, uint32_t count, bool waitAll) {
+        Clock::time_point deadline = waitAll ? (Clock::time_point::min)() : (Clock::time_point::max)();
+
+        for (uint32_t i = 0; i < count; ++i) {
+            auto at  = CompletionTime(points[i].queue, points[i].value);
+            deadline = waitAll ? (std::max)(deadline, at) : (std::min)(deadline, at);
+        }
+
+        SpinUntil(deadline);
+    }
+
+    // sleeps while far away, spins the last stretch so the default timer resolution doesn't skew results
+    static void SpinUntil(Clock::time_point deadline) {
+        while (deadline - Clock::now() > std::chrono::milliseconds(2)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        while (Clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    Clock::time_point CompletionTime(uint32_t queue, uint64_t value) {
+        if (CompletedValue(queue) >= value) {
+            return Clock::now();
+        }
+
+        for (auto& [signaled, at] : signals[queue]) {
+            if (signaled >= value) {
+                return at;
+            }
+        }
+
+        throw std::runtime_error("Waiting on a value that was never signaled!");
+    }
+
+    std::array<std::deque<std::pair<uint64_t, Clock::time_point>>, FrameScheduler::MAX_QUEUES> signals;
+    std::array<Clock::time_point, FrameScheduler::MAX_QUEUES>                                  busyUntil   = {};
+    std::array<Clock::duration, FrameScheduler::MAX_QUEUES>                                    pendingCost = {};
+    std::array<uint64_t, FrameScheduler::MAX_QUEUES>                                           completed   = {};
+};
+
+inline FrameScheduler::Backend MakeSimulatedBackend(SimulatedGpu& gpu) {
+    return {
+        .completedValue = [&gpu](uint32_t queue) { return gpu.CompletedValue(queue); },
+        .signal         = [&gpu](uint32_t queue, uint64_t value) { gpu.Signal(queue, value); },
+        .wait           = [&gpu](const FrameScheduler::TimelinePoint* points, uint32_t count, bool waitAll) { gpu.Wait(points, count, waitAll); }
+    };
+}
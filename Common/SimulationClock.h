@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+//
+// Fixed step simulation time. Advance() returns the steps of 1/hz that fell due since the last call.
+// After a stall, steps beyond maxCatchUp are dropped instead of run in a burst, so simulated time
+// pauses with the stall rather than racing to catch up afterwards.
+//
+class SimulationClock {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    void Init(uint32_t hz, uint32_t maxCatchUp, Clock::time_point start) {
+        period   = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+        seconds  = 1.0 / hz;
+        maxSteps = maxCatchUp;
+        next     = start;
+        steps    = 0;
+        lost     = 0;
+    }
+
+    uint32_t Advance(Clock::time_point now) {
+        uint32_t due = 0;
+
+        while (next <= now && due < maxSteps) {
+            next += period;
+            due  += 1;
+        }
+
+        if (next <= now) {
+            Clock::rep behind = (now - next) / period + 1;
+
+            next += period * behind;
+            lost += behind;
+        }
+
+        steps += due;
+
+        return due;
+    }
+
+    uint64_t GetStep() const {
+        return steps;
+    }
+
+    double GetTime() const {
+        return steps * seconds;
+    }
+
+    Clock::time_point GetNextStep() const {
+        return next;
+    }
+
+    uint64_t GetLostSteps() const {
+        return lost;
+    }
+
+private:
+    Clock::duration   period   = {};
+    double            seconds  = 0.0;
+    uint32_t          maxSteps = 1;
+    Clock::time_point next;
+    uint64_t          steps    = 0;
+    uint64_t          lost     = 0;
+};
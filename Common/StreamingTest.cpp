@@ -0,0 +1,210 @@
+#include "FeedbackProcessor.h"
+#include "TileStreamer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+//
+// The checks of TileStreamer, on SamplerFeedback's former --bench=streaming: a 16K x 16K texture
+// (128 x 128 regions, 8 standard mips) against a simulated tile mapper. Synthetic feedback follows
+// a focus point circling the texture: mip 0 next to it, one mip coarser per doubling of distance,
+// nothing sampled far away. Uploads complete two updates after submission. The mapper fails the
+// test if a heap tile or tile coordinate is ever mapped twice, and the residency the streamer
+// reports has to be backed by mapped tiles all the way to the packed tail.
+// Exits nonzero if any of them fails.
+//
+
+static uint32_t failures = 0;
+
+static void Check(bool condition, const char* pWhat) {
+    if (!condition) {
+        std::cout << "FAILED: " << pWhat << std::endl;
+        failures += 1;
+    }
+}
+
+static uint64_t TileKey(uint32_t mip, uint32_t x, uint32_t y) {
+    return (uint64_t(mip) << 40) | (uint64_t(y) << 20) | x;
+}
+
+struct Result
+{
+    uint64_t loads          = 0;
+    uint64_t evictions      = 0;
+    uint64_t mappingErrors  = 0;
+    uint64_t unbackedRegion = 0;     // residency finer than the mapped chain under it
+    uint64_t tileCountError = 0;     // mapped tiles that are neither resident nor loading, or the other way round
+    double   underResident  = 0.0;   // share of sampled regions resident coarser than wanted
+};
+
+static Result Run(uint32_t pool, uint32_t frames) {
+    const uint32_t regions      = 128;
+    const uint32_t standardMips = 8;
+
+    uint64_t currentFrame = 0;
+    uint64_t fence        = 0;
+
+    Result result;
+
+    std::deque<std::pair<uint64_t, uint64_t>> submitted;     // fence value, frame
+    std::vector<bool>                         heapUsed(pool, false);
+    std::unordered_map<uint64_t, uint32_t>    mapped;
+
+    TileStreamer      streamer;
+    FeedbackProcessor processor;
+
+    streamer.Init({ regions, regions, standardMips, pool, 0, { 0, 64, 0 } }, {
+        .upload = [](const TileCoord&) {
+            return true;
+        },
+        .submit = [&](const TileMapping* pMappings, uint32_t count, bool) {
+            for (uint32_t i = 0; i < count; ++i) {
+                const TileMapping& mapping = pMappings[i];
+                uint64_t           key     = TileKey(mapping.coord.mip, mapping.coord.x, mapping.coord.y);
+
+                auto it = mapped.find(key);
+
+                if (mapping.heapTile == TileStreamer::UNMAPPED) {
+                    if (it == mapped.end()) {
+                        result.mappingErrors += 1;
+                        continue;
+                    }
+
+                    heapUsed[it->second] = false;
+                    mapped.erase(it);
+                }
+                else {
+                    if (it != mapped.end() || mapping.heapTile >= pool || heapUsed[mapping.heapTile]) {
+                        result.mappingErrors += 1;
+                        continue;
+                    }
+
+                    heapUsed[mapping.heapTile] = true;
+                    mapped[key] = mapping.heapTile;
+                }
+            }
+
+            submitted.push_back({ ++fence, currentFrame });
+            return fence;
+        },
+        .completedValue = [&]() {
+            uint64_t completed = 0;
+
+            for (auto& [value, frame] : submitted) {
+                if (frame + 2 <= currentFrame) {
+                    completed = value;
+                }
+            }
+
+            return completed;
+        }
+    });
+
+    std::vector<uint8_t> feedback(regions * regions);
+
+    uint64_t sampled     = 0;
+    uint64_t underServed = 0;
+
+    for (uint32_t i = 0; i < frames; ++i) {
+        currentFrame = i;
+
+        float angle  = i * 0.01f;
+        float focusX = regions * 0.5f + regions * 0.3f * cosf(angle);
+        float focusY = regions * 0.5f + regions * 0.3f * sinf(angle);
+
+        for (uint32_t ry = 0; ry < regions; ++ry) {
+            for (uint32_t rx = 0; rx < regions; ++rx) {
+                float distance = sqrtf((rx - focusX) * (rx - focusX) + (ry - focusY) * (ry - focusY));
+
+                uint8_t wanted = 0xFF;
+
+                if (distance < 4.0f) {
+                    wanted = 0;
+                }
+                else if (distance < 48.0f) {
+                    wanted = uint8_t((std::min)(uint32_t(log2f(distance / 4.0f)) + 1, standardMips - 1));
+                }
+
+                feedback[ry * regions + rx] = wanted;
+            }
+        }
+
+        processor.Begin();
+        processor.Process(0, feedback.data(), regions, streamer.GetResidency(), regions, regions, streamer.GetCoarsestMip());
+
+        streamer.Update(feedback.data(), regions, processor.Finish());
+
+        const uint8_t* pResidency = streamer.GetResidency();
+
+        for (uint32_t r = 0; r < regions * regions; ++r) {
+            if (feedback[r] != 0xFF) {
+                sampled     += 1;
+                underServed += pResidency[r] > feedback[r] ? 1 : 0;
+            }
+        }
+
+        if (mapped.size() != size_t(streamer.GetResidentTiles()) + streamer.GetLoadingTiles()) {
+            result.tileCountError += 1;
+        }
+
+        // every few frames, the whole chain under every region
+        if (i % 20 != 0) {
+            continue;
+        }
+
+        for (uint32_t ry = 0; ry < regions; ++ry) {
+            for (uint32_t rx = 0; rx < regions; ++rx) {
+                for (uint32_t mip = pResidency[ry * regions + rx]; mip < standardMips; ++mip) {
+                    if (!mapped.contains(TileKey(mip, rx >> mip, ry >> mip))) {
+                        result.unbackedRegion += 1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    const auto& stats = streamer.GetStats();
+
+    result.loads         = stats.loads;
+    result.evictions     = stats.evictions;
+    result.underResident = double(underServed) / sampled;
+
+    std::cout << "  pool " << pool << " tiles: " << stats.loads << " loads, " << stats.evictions << " evictions, "
+              << stats.misses << " misses, under-resident " << 100.0 * result.underResident << "% of sampled regions, "
+              << result.mappingErrors << " mapping errors" << std::endl;
+
+    return result;
+}
+
+int main() {
+    const uint32_t frames  = 1200;
+    const uint32_t pools[] = { 256, 1024, 4096 };
+
+    std::cout << "TileStreamer, 16K x 16K, " << frames << " frames" << std::endl;
+
+    Result results[3];
+
+    for (uint32_t i = 0; i < 3; ++i) {
+        results[i] = Run(pools[i], frames);
+
+        Check(results[i].mappingErrors == 0, "streaming: no heap tile or tile is mapped twice, nothing unmapped that wasn't mapped");
+        Check(results[i].unbackedRegion == 0, "streaming: residency is backed by mapped tiles down to the packed tail");
+        Check(results[i].tileCountError == 0, "streaming: mapped tiles are the resident and loading ones");
+        Check(results[i].loads > 0, "streaming: tiles load");
+        Check(results[i].loads - results[i].evictions <= pools[i], "streaming: never more tiles mapped than the pool holds");
+    }
+
+    Check(results[0].evictions > 0, "streaming: a small pool evicts");
+    Check(results[2].underResident <= results[0].underResident, "streaming: a larger pool is under-resident less");
+    Check(results[2].underResident < 0.05, "streaming: a pool that fits the working set keeps up with the feedback");
+
+    std::cout << (failures == 0 ? "passed" : "FAILED") << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,372 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <vector>
+
+#include "FeedbackProcessor.h"
+#include "IoScheduler.h"
+
+struct TileCoord
+{
+    uint32_t mip;
+    uint32_t x;
+    uint32_t y;
+};
+
+struct TileMapping
+{
+    TileCoord coord;
+    uint32_t  heapTile;         // TileStreamer::UNMAPPED unmaps
+};
+
+//
+// Keeps the standard mips of a reserved texture resident as feedback asks for them, out of a fixed
+// pool of 64 KB heap tiles. Tiles stream coarse to fine: a tile only loads once its parent (the tile
+// one mip coarser covering it) is resident, and tiles with mapped children are never evicted, so each
+// region is backed by an unbroken chain down to the packed mip tail, which stays mapped throughout.
+// Victims are picked least recently used, "used" being what the last feedback asked for; tiles the
+// feedback reports as over-resident are moved to the front of the list. Loads go through an
+// IoScheduler, weighted by how many regions want them and how far off their residency is, and the
+// mapping changes and uploads of one Update go out as a single batch through Backend.
+//
+class TileStreamer {
+public:
+    static constexpr uint32_t UNMAPPED  = ~0u;
+    static constexpr uint32_t TILE_SIZE = 64 * 1024;
+
+    struct Config {
+        uint32_t regionsX;          // mip 0 tiles, one feedback region each
+        uint32_t regionsY;
+        uint32_t standardMips;      // streamed mips, the rest is the packed tail
+        uint32_t poolTiles;
+        uint32_t firstHeapTile;     // heap tiles before this one hold the packed tail
+        IoScheduler::Config io;     // per update load budgets
+    };
+
+    struct Backend {
+        std::function<bool(const TileCoord& tile)>                                              upload;          // queue the tile's data, false: staging full
+        std::function<uint64_t(const TileMapping* mappings, uint32_t count, bool reusesTiles)> submit;          // apply mappings, kick uploads, return their fence value
+        std::function<uint64_t()>                                                              completedValue;
+    };
+
+    struct Stats {
+        uint64_t loads     = 0;
+        uint64_t evictions = 0;
+        uint64_t misses    = 0;     // loads wanted but left queued (budget, pool or staging)
+    };
+
+    void Init(const Config& streamerConfig, Backend streamerBackend) {
+        config  = streamerConfig;
+        backend = std::move(streamerBackend);
+
+        uint32_t tileCount = 0;
+
+        for (uint32_t mip = 0; mip < config.standardMips; ++mip) {
+            mipOffset.push_back(tileCount);
+            tilesX.push_back((std::max)(config.regionsX >> mip, 1u));
+            tilesY.push_back((std::max)(config.regionsY >> mip, 1u));
+
+            tileCount += tilesX[mip] * tilesY[mip];
+        }
+
+        tiles.resize(tileCount);
+
+        for (uint32_t mip = 0; mip < config.standardMips; ++mip) {
+            for (uint32_t y = 0; y < tilesY[mip]; ++y) {
+                for (uint32_t x = 0; x < tilesX[mip]; ++x) {
+                    tiles[TileId(mip, x, y)].coord = { mip, x, y };
+                }
+            }
+        }
+
+        for (uint32_t i = config.poolTiles; i > 0; --i) {
+            freeHeapTiles.push_back(config.firstHeapTile + i - 1);
+        }
+
+        residency.assign(size_t(config.regionsX) * config.regionsY, uint8_t(config.standardMips));
+
+        io.Init(config.io, {
+            .read = [this](const IoScheduler::Request& request) {
+                return StartLoad(static_cast<uint32_t>(request.key));
+            }
+        });
+    }
+
+    //
+    // One streaming step: retire finished uploads, record what feedback used, then hand the loads the
+    // requests ask for to the I/O scheduler, which issues what fits this update's budget.
+    //
+    void Update(const uint8_t* feedback, size_t feedbackPitch, const std::vector<FeedbackProcessor::Request>& requests) {
+        ++frame;
+
+        io.BeginUpdate(frame);
+
+        uint64_t completed = backend.completedValue();
+
+        while (!loading.empty() && tiles[loading.front()].fenceValue <= completed) {
+            Tile& tile = tiles[loading.front()];
+
+            tile.state = State::Resident;
+            residentTiles += 1;
+            loadingTiles  -= 1;
+
+            io.Complete(loading.front());
+
+            UpdateResidency(tile.coord);
+            loading.pop_front();
+        }
+
+        for (uint32_t ry = 0; ry < config.regionsY; ++ry) {
+            const uint8_t* pWanted = feedback + ry * feedbackPitch;
+
+            for (uint32_t rx = 0; rx < config.regionsX; ++rx) {
+                for (uint32_t mip = pWanted[rx]; mip < config.standardMips; ++mip) {
+                    Touch(TileId(mip, rx >> mip, ry >> mip));
+                }
+            }
+        }
+
+        for (const auto& request : requests) {
+            if (request.mip >= config.standardMips) {
+                continue;
+            }
+
+            uint32_t id   = TileId(request.mip, request.regionX >> request.mip, request.regionY >> request.mip);
+            Tile&    tile = tiles[id];
+
+            if (!request.load) {
+                // not wanted by this region, and nobody else used it this frame either
+                if (tile.state == State::Resident && tile.lastUsed != frame) {
+                    lru.splice(lru.begin(), lru, tile.lru);
+                }
+                continue;
+            }
+
+            // already on its way, or its parent isn't yet (a later update will pick it up)
+            if (tile.state != State::Unmapped || !ParentResident(tile.coord)) {
+                continue;
+            }
+
+            // several regions share coarser tiles, each adds to its importance
+            io.Want(id, TILE_SIZE, float(request.priority));
+        }
+
+        mappings.clear();
+        issued.clear();
+
+        reusesTiles = false;
+
+        io.Dispatch();
+
+        stats.misses += io.GetQueued();
+
+        if (mappings.empty()) {
+            return;
+        }
+
+        uint64_t fenceValue = backend.submit(mappings.data(), static_cast<uint32_t>(mappings.size()), reusesTiles);
+
+        for (uint32_t id : issued) {
+            tiles[id].fenceValue = fenceValue;
+            loading.push_back(id);
+        }
+    }
+
+    // finest resident mip per region, regionsX wide
+    const uint8_t* GetResidency() const {
+        return residency.data();
+    }
+
+    uint8_t GetCoarsestMip() const {
+        return uint8_t(config.standardMips);
+    }
+
+    uint32_t GetResidentTiles() const {
+        return residentTiles;
+    }
+
+    uint32_t GetLoadingTiles() const {
+        return loadingTiles;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    IoScheduler& GetIoScheduler() {
+        return io;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (!force && (now - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
+
+        std::cout << "Streaming: " << residentTiles << "/" << config.poolTiles << " tiles resident ("
+                  << (residentTiles * uint64_t(TILE_SIZE)) / (1024 * 1024) << " MB), " << loadingTiles << " loading, "
+                  << stats.loads << " loads, " << stats.evictions << " evictions, " << stats.misses << " misses" << std::endl;
+
+        io.ReportStats(true);
+
+        stats     = {};
+        statStart = now;
+    }
+
+private:
+    enum class State : uint8_t {
+        Unmapped,
+        Loading,
+        Resident
+    };
+
+    struct Tile
+    {
+        TileCoord                     coord       = {};
+        uint32_t                      heapTile    = UNMAPPED;
+        State                         state       = State::Unmapped;
+        uint32_t                      children    = 0;      // mapped tiles one mip finer
+        uint64_t                      fenceValue  = 0;      // upload of a loading tile
+        uint64_t                      lastUsed    = 0;
+        std::list<uint32_t>::iterator lru;
+    };
+
+    uint32_t TileId(uint32_t mip, uint32_t x, uint32_t y) const {
+        return mipOffset[mip] + y * tilesX[mip] + x;
+    }
+
+    Tile* Parent(const TileCoord& coord) {
+        return coord.mip + 1 < config.standardMips ? &tiles[TileId(coord.mip + 1, coord.x >> 1, coord.y >> 1)] : nullptr;
+    }
+
+    bool ParentResident(const TileCoord& coord) {
+        Tile* pParent = Parent(coord);
+        return !pParent || pParent->state == State::Resident;
+    }
+
+    // IoScheduler read: maps a heap tile (evicting if need be) and queues the upload
+    bool StartLoad(uint32_t id) {
+        Tile& tile = tiles[id];
+
+        uint32_t heapTile = AllocateHeapTile();
+
+        if (heapTile == UNMAPPED) {
+            return false;
+        }
+
+        if (!backend.upload(tile.coord)) {
+            freeHeapTiles.push_back(heapTile);
+            return false;
+        }
+
+        tile.heapTile = heapTile;
+        tile.state    = State::Loading;
+        tile.lastUsed = frame;
+        tile.lru      = lru.insert(lru.end(), id);
+
+        if (Tile* pParent = Parent(tile.coord)) {
+            pParent->children += 1;
+        }
+
+        loadingTiles += 1;
+        stats.loads  += 1;
+
+        mappings.push_back({ tile.coord, heapTile });
+        issued.push_back(id);
+
+        return true;
+    }
+
+    void Touch(uint32_t id) {
+        Tile& tile = tiles[id];
+
+        if (tile.state != State::Unmapped && tile.lastUsed != frame) {
+            tile.lastUsed = frame;
+            lru.splice(lru.end(), lru, tile.lru);
+        }
+    }
+
+    uint32_t AllocateHeapTile() {
+        if (!freeHeapTiles.empty()) {
+            uint32_t heapTile = freeHeapTiles.back();
+            freeHeapTiles.pop_back();
+            return heapTile;
+        }
+
+        for (uint32_t id : lru) {
+            Tile& victim = tiles[id];
+
+            if (victim.state != State::Resident || victim.children != 0 || victim.lastUsed == frame) {
+                continue;
+            }
+
+            uint32_t heapTile = victim.heapTile;
+
+            mappings.push_back({ victim.coord, UNMAPPED });
+            lru.erase(victim.lru);
+
+            if (Tile* pParent = Parent(victim.coord)) {
+                pParent->children -= 1;
+            }
+
+            victim.heapTile = UNMAPPED;
+            victim.state    = State::Unmapped;
+
+            residentTiles   -= 1;
+            stats.evictions += 1;
+            reusesTiles      = true;
+
+            UpdateResidency(victim.coord);
+
+            return heapTile;
+        }
+
+        return UNMAPPED;
+    }
+
+    // recomputes the regions under a tile: finest mip with an unbroken resident chain to the tail
+    void UpdateResidency(const TileCoord& coord) {
+        uint32_t x0 = coord.x << coord.mip, x1 = (std::min)((coord.x + 1) << coord.mip, config.regionsX);
+        uint32_t y0 = coord.y << coord.mip, y1 = (std::min)((coord.y + 1) << coord.mip, config.regionsY);
+
+        for (uint32_t ry = y0; ry < y1; ++ry) {
+            for (uint32_t rx = x0; rx < x1; ++rx) {
+                uint32_t resident = config.standardMips;
+
+                while (resident > 0 && tiles[TileId(resident - 1, rx >> (resident - 1), ry >> (resident - 1))].state == State::Resident) {
+                    --resident;
+                }
+
+                residency[ry * config.regionsX + rx] = uint8_t(resident);
+            }
+        }
+    }
+
+    Config                                config        = {};
+    Backend                               backend;
+    std::vector<Tile>                     tiles;
+    std::vector<uint32_t>                 mipOffset;
+    std::vector<uint32_t>                 tilesX;
+    std::vector<uint32_t>                 tilesY;
+    std::vector<uint32_t>                 freeHeapTiles;
+    std::list<uint32_t>                   lru;
+    std::deque<uint32_t>                  loading;
+    std::vector<uint8_t>                  residency;
+    std::vector<TileMapping>              mappings;
+    std::vector<uint32_t>                 issued;
+    IoScheduler                           io;
+    bool                                  reusesTiles   = false;    // this update's batch takes over evicted tiles
+    uint64_t                              frame         = 0;
+    uint32_t                              residentTiles = 0;
+    uint32_t                              loadingTiles  = 0;
+
+    Stats                                 stats;
+    std::chrono::steady_clock::time_point statStart     = std::chrono::steady_clock::now();
+};
@@ -402,7 +402,7 @@ void Harmony::CreateCommandQueue() {
 
         pCopyQueue = cmdQueue.Detach();
 
-        delQ.Append([cCommandQueue = pCommandQueue] {
+        delQ.Append([cCommandQueue = pCopyQueue] {
             cCommandQueue->Release();
         });
     }
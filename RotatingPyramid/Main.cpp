@@ -12,16 +12,37 @@
 #include <fstream>
 #include <map>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <random>
+#include <bit>
+#include <cfloat>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
+#include <dxcapi.h>
+#include <immintrin.h>
+#include <intrin.h>
 using namespace DirectX;
 
 #include <wrl.h>
 using Microsoft::WRL::ComPtr;
 
+#include "BoundingVolumeHierarchy.h"
+#include "DeferredReleaseQueue.h"
+#include "DepthPyramid.h"
+#include "FrameScheduler.h"
+#include "Frustum.h"
+#include "IndirectDraws.h"
+#include "JobSystem.h"
+#include "OcclusionCuller.h"
+#include "ShaderWatcher.h"
+
 #define APPLICATION_NAME        "Rotating Pyramid"
 #define WINDOW_WIDTH            1920
 #define WINDOW_HEIGHT           1080
@@ -51,6 +72,29 @@ private:
     Queue q;
 };
 
+struct ShaderSource
+{
+    const wchar_t* file;
+    const wchar_t* entry;
+    const wchar_t* target;
+};
+
+// keep in sync with compileshaders.bat
+static const ShaderSource shaderSources[] = {
+    { L"Shaders.hlsl", L"VsMain",     L"vs_6_6" },
+    { L"Shaders.hlsl", L"VsInstanced", L"vs_6_6" },
+    { L"Shaders.hlsl", L"VsIndirect", L"vs_6_6" },
+    { L"Shaders.hlsl", L"PsMain",     L"ps_6_6" },
+    { L"Mipgen.hlsl",  L"GenMips",    L"cs_6_6" },
+    { L"Mipgen.hlsl",  L"GenHiZ",     L"cs_6_6" },
+    { L"Cull.hlsl",    L"CullHiZ",    L"cs_6_6" },
+    { L"Cull.hlsl",    L"CullDraws",  L"cs_6_6" },
+};
+
+#ifndef SHADER_SOURCE_DIR
+#define SHADER_SOURCE_DIR       "shaders"
+#endif
+
 struct Vertex
 {
     DirectX::XMFLOAT3 position;
@@ -91,6 +135,39 @@ struct UniformBuffer
 
 static_assert(sizeof(UniformBuffer) == 256);
 
+// keep in sync with InstanceData (Shaders.hlsl): a StructuredBuffer element, no padding
+struct InstanceData
+{
+    XMFLOAT4X4 mvp;
+    uint32_t   material;
+};
+
+static_assert(sizeof(InstanceData) == 68);
+
+// keep in sync with Box (Cull.hlsl): world space bounds of a visible object
+struct HiZBox
+{
+    XMFLOAT3 center;
+    uint32_t object;
+    XMFLOAT3 extent;
+    uint32_t padding;
+};
+
+static_assert(sizeof(HiZBox) == 32);
+
+inline D3D12_RESOURCE_BARRIER TransitionBarrier(ID3D12Resource* pResource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after) {
+    return D3D12_RESOURCE_BARRIER {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pResource,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = before,
+            .StateAfter  = after,
+        }
+    };
+}
+
 inline void WaitForFence (ID3D12Fence* fence, UINT64 completionValue, HANDLE waitEvent) {
     if (fence->GetCompletedValue() < completionValue) {
         fence->SetEventOnCompletion (completionValue, waitEvent);
@@ -108,518 +185,681 @@ inline UINT Align(UINT val, UINT alignment) {
     return val;
 }
 
-#pragma region ClassDecl
-
-class alignas(64) Harmony
+//
+// SIMD lanes the transform and culling kernels run on: 16 objects per register with AVX-512, 8 with
+// AVX2, 4 with SSE. Store() writes WIDTH matrices out of 16 registers holding one element each
+// (m[r * 4 + c] is row r, column c of every lane), transposing them into row-major 4x4 floats, stride
+// bytes apart. MaskGe() returns one bit per lane, Compact() writes base + lane for every set bit of a
+// mask to pOut and returns how many it wrote.
+//
+struct SimdSse
 {
-public:
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
-    static constexpr uint32_t DEFAULT_CHUNK_SIZE   = 128 * 1024 * 1024;
+    using V = __m128;
 
-    bool Init(HINSTANCE inst);
-    void Run();
-    void Shutdown();
-    void Resize();
+    static constexpr uint32_t WIDTH = 4;
 
-private:
-    inline uint32_t GetSizeInMB(UINT64 sizeInBytes) {
-        return (sizeInBytes >> 20) & 0xFFFFFFFF;
-    }
+    static V Load(const float* p)       { return _mm_loadu_ps(p); }
+    static V Set1(float f)              { return _mm_set1_ps(f); }
+    static V Add(V a, V b)              { return _mm_add_ps(a, b); }
+    static V Sub(V a, V b)              { return _mm_sub_ps(a, b); }
+    static V Mul(V a, V b)              { return _mm_mul_ps(a, b); }
+    static V MulAdd(V a, V b, V c)      { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static V Min(V a, V b)              { return _mm_min_ps(a, b); }
 
-    void OpenWindow(HINSTANCE instance);
-    void CreateAdapter();
-    void CreateDevice();
-    void CreateCommandQueue();
-    void CreateSwapChain();
-    void CreateHeaps();
-    void CreateResourcesAndViews();
-    void CreatePipelines();
-    void CreateCommandLists();
-    void CreateSyncObjects();
-    void DownloadDataAndGenMips();
+    static uint32_t MaskGe(V a, V b)    { return uint32_t(_mm_movemask_ps(_mm_cmpge_ps(a, b))); }
 
-    void UpdateUbo();
-    void PopulateCommandList();
-    void MoveToNextFrame();
-    void WaitForGpu();
-    void Render();
+    static V Gather(const float* p, const uint32_t* pIndices) {
+        return _mm_setr_ps(p[pIndices[0]], p[pIndices[1]], p[pIndices[2]], p[pIndices[3]]);
+    }
 
-    static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam,
-        LPARAM lParam);
+    static uint32_t Compact(uint32_t mask, uint32_t base, uint32_t* pOut) {
+        uint32_t written = 0;
 
-    DeletionQueue              delQ;
+        for (; mask != 0; mask &= mask - 1) {
+            pOut[written++] = base + uint32_t(std::countr_zero(mask));
+        }
 
-    IDXGIFactory7*             pFactory7         = nullptr;
-    IDXGIAdapter1*             pAdapter1         = nullptr;
-    IDXGISwapChain4*           pSwapChain4       = nullptr;
+        return written;
+    }
 
-    ID3D12Device9*             pDevice9          = nullptr;
-    ID3D12CommandQueue*        pCommandQueue     = nullptr;
-    ID3D12CommandQueue*        pCopyQueue        = nullptr;
+    static void Store(V (&m)[16], uint8_t* pDst, size_t stride) {
+        for (uint32_t r = 0; r < 4; ++r) {
+            V row0 = m[r * 4 + 0], row1 = m[r * 4 + 1], row2 = m[r * 4 + 2], row3 = m[r * 4 + 3];
+            _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
 
-    ID3D12DescriptorHeap*      pRtvHeap          = nullptr;
-    ID3D12DescriptorHeap*      pDsvHeap          = nullptr;
-    ID3D12DescriptorHeap*      pSrvHeap          = nullptr;
-    ID3D12DescriptorHeap*      pSmpHeap          = nullptr;
+            _mm_storeu_ps(reinterpret_cast<float*>(pDst + 0 * stride) + r * 4, row0);
+            _mm_storeu_ps(reinterpret_cast<float*>(pDst + 1 * stride) + r * 4, row1);
+            _mm_storeu_ps(reinterpret_cast<float*>(pDst + 2 * stride) + r * 4, row2);
+            _mm_storeu_ps(reinterpret_cast<float*>(pDst + 3 * stride) + r * 4, row3);
+        }
+    }
+};
 
-    ID3D12Resource*            pRenderTargets[MAX_FRAMES_IN_FLIGHT] = { nullptr };
-    ID3D12CommandAllocator*    pCommandAllocators[MAX_FRAMES_IN_FLIGHT] = { nullptr };
-    ID3D12GraphicsCommandList* pCommandList      = nullptr;
-    ID3D12Fence*               pFence            = nullptr;
-    ID3D12Heap*                pResourceHeap     = nullptr;
+#if defined(__AVX2__)
+struct SimdAvx2
+{
+    using V = __m256;
 
-    ID3D12RootSignature*       pRootSignature    = nullptr;
-    ID3D12PipelineState*       pPipelineState    = nullptr;
+    static constexpr uint32_t WIDTH = 8;
 
-    ID3D12RootSignature*       pCsRootSignature  = nullptr;
-    ID3D12PipelineState*       pCsPipelineState  = nullptr;
+    static V Load(const float* p)       { return _mm256_loadu_ps(p); }
+    static V Set1(float f)              { return _mm256_set1_ps(f); }
+    static V Add(V a, V b)              { return _mm256_add_ps(a, b); }
+    static V Sub(V a, V b)              { return _mm256_sub_ps(a, b); }
+    static V Mul(V a, V b)              { return _mm256_mul_ps(a, b); }
+    static V MulAdd(V a, V b, V c)      { return _mm256_fmadd_ps(a, b, c); }
+    static V Min(V a, V b)              { return _mm256_min_ps(a, b); }
 
-    ID3D12Resource*            pConstantBuffer   = nullptr;
-    ID3D12Resource*            pDepthBuffer      = nullptr;
-    ID3D12Resource*            pTexture          = nullptr;
-    ID3D12Resource*            pVertexBuffer     = nullptr;
-    ID3D12Resource*            pIndexBuffer      = nullptr;
-    ID3D12Resource*            pUploadBuffer     = nullptr;
+    static uint32_t MaskGe(V a, V b)    { return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GE_OQ))); }
 
-    HINSTANCE                  hInstance         = NULL;
-    HWND                       hMainWindow       = NULL;
+    static V Gather(const float* p, const uint32_t* pIndices) {
+        return _mm256_i32gather_ps(p, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pIndices)), 4);
+    }
 
-    UINT                       frameIndex        = 0;
-    HANDLE                     fenceHandle       = NULL;
-    UINT64                     fenceValues[MAX_FRAMES_IN_FLIGHT] = { 0 };
+    static uint32_t Compact(uint32_t mask, uint32_t base, uint32_t* pOut) {
+        return SimdSse::Compact(mask, base, pOut);
+    }
 
-    UINT                       rtvDescriptorSize = 0;
-    UINT                       dsvDescriptorSize = 0;
-    UINT                       srvDescriptorSize = 0;
-    UINT                       smpDescriptorSize = 0;
+    // 8x8 transpose of v[0..7]: lane i of every register ends up in register i
+    static void Transpose8(V (&v)[8]) {
+        V t0 = _mm256_unpacklo_ps(v[0], v[1]), t1 = _mm256_unpackhi_ps(v[0], v[1]);
+        V t2 = _mm256_unpacklo_ps(v[2], v[3]), t3 = _mm256_unpackhi_ps(v[2], v[3]);
+        V t4 = _mm256_unpacklo_ps(v[4], v[5]), t5 = _mm256_unpackhi_ps(v[4], v[5]);
+        V t6 = _mm256_unpacklo_ps(v[6], v[7]), t7 = _mm256_unpackhi_ps(v[6], v[7]);
+
+        V s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        V s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)), s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        V s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0)), s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        V s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0)), s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        v[0] = _mm256_permute2f128_ps(s0, s4, 0x20);
+        v[1] = _mm256_permute2f128_ps(s1, s5, 0x20);
+        v[2] = _mm256_permute2f128_ps(s2, s6, 0x20);
+        v[3] = _mm256_permute2f128_ps(s3, s7, 0x20);
+        v[4] = _mm256_permute2f128_ps(s0, s4, 0x31);
+        v[5] = _mm256_permute2f128_ps(s1, s5, 0x31);
+        v[6] = _mm256_permute2f128_ps(s2, s6, 0x31);
+        v[7] = _mm256_permute2f128_ps(s3, s7, 0x31);
+    }
 
-    D3D_FEATURE_LEVEL          featureLevel      = D3D_FEATURE_LEVEL_12_2;
-    D3D12_VIEWPORT             viewport;
-    D3D12_RECT                 scissorRect;
+    // elements 0-7 (rows 0 and 1) and 8-15 (rows 2 and 3) transpose separately
+    static void Store(V (&m)[16], uint8_t* pDst, size_t stride) {
+        for (uint32_t half = 0; half < 2; ++half) {
+            V v[8];
 
-    D3D12_FEATURE_DATA_D3D12_OPTIONS featureDataOpts;
+            for (uint32_t i = 0; i < 8; ++i) {
+                v[i] = m[half * 8 + i];
+            }
 
-#ifdef _DEBUG
-    static inline const bool enableDebugLayers = true;
-#else
-    static inline const bool enableDebugLayers = false;
-#endif
+            Transpose8(v);
+
+            for (uint32_t lane = 0; lane < 8; ++lane) {
+                _mm256_storeu_ps(reinterpret_cast<float*>(pDst + lane * stride) + half * 8, v[lane]);
+            }
+        }
+    }
 };
+#endif
 
-#pragma endregion
+#if defined(__AVX512F__)
+struct SimdAvx512
+{
+    using V = __m512;
 
-#pragma region Public Interface
+    static constexpr uint32_t WIDTH = 16;
 
-bool Harmony::Init(HINSTANCE inst) {
-    hInstance = inst;
+    static V Load(const float* p)       { return _mm512_loadu_ps(p); }
+    static V Set1(float f)              { return _mm512_set1_ps(f); }
+    static V Add(V a, V b)              { return _mm512_add_ps(a, b); }
+    static V Sub(V a, V b)              { return _mm512_sub_ps(a, b); }
+    static V Mul(V a, V b)              { return _mm512_mul_ps(a, b); }
+    static V MulAdd(V a, V b, V c)      { return _mm512_fmadd_ps(a, b, c); }
+    static V Min(V a, V b)              { return _mm512_min_ps(a, b); }
 
-    try {
-        OpenWindow(hInstance);
+    static uint32_t MaskGe(V a, V b)    { return uint32_t(_mm512_cmp_ps_mask(a, b, _CMP_GE_OQ)); }
 
-        CreateAdapter();
+    static V Gather(const float* p, const uint32_t* pIndices) {
+        return _mm512_i32gather_ps(_mm512_loadu_si512(pIndices), p, 4);
+    }
 
-        CreateDevice();
+    // the visible lanes' indices in one compressing store
+    static uint32_t Compact(uint32_t mask, uint32_t base, uint32_t* pOut) {
+        __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
 
-        CreateCommandQueue();
+        _mm512_mask_compressstoreu_epi32(pOut, __mmask16(mask), _mm512_add_epi32(_mm512_set1_epi32(int(base)), lanes));
 
-        CreateSwapChain();
+        return uint32_t(std::popcount(mask));
+    }
 
-        CreateHeaps();
+    // the two 8 lane halves go out through the AVX2 transpose
+    static void Store(V (&m)[16], uint8_t* pDst, size_t stride) {
+        for (uint32_t half = 0; half < 2; ++half) {
+            SimdAvx2::V v[16];
 
-        CreateResourcesAndViews();
+            for (uint32_t i = 0; i < 16; ++i) {
+                __m512d bits = _mm512_castps_pd(m[i]);
+                v[i] = _mm256_castpd_ps(half == 0 ? _mm512_castpd512_pd256(bits) : _mm512_extractf64x4_pd(bits, 1));
+            }
 
-        CreatePipelines();
+            SimdAvx2::Store(v, pDst + half * 8 * stride, stride);
+        }
+    }
+};
+#endif
 
-        CreateCommandLists();
+//
+// Position, rotation (unit quaternion) and scale of many objects, one array per component, so the
+// kernels load WIDTH objects per register. Compute() writes each object's world matrix (optional)
+// and world * viewProj, row-major like XMMATRIX, straight to where they are consumed: the constant
+// upload ring, an instance buffer. The widest kernel the build targets runs, the remainder goes
+// through the scalar path.
+//
+class TransformSystem {
+public:
+    enum Component {
+        POS_X, POS_Y, POS_Z,
+        ROT_X, ROT_Y, ROT_Z, ROT_W,
+        SCALE_X, SCALE_Y, SCALE_Z,
+        COMPONENT_COUNT
+    };
 
-        CreateSyncObjects();
+#if defined(__AVX512F__)
+    using Simd = SimdAvx512;
+#elif defined(__AVX2__)
+    using Simd = SimdAvx2;
+#else
+    using Simd = SimdSse;
+#endif
 
-        DownloadDataAndGenMips();
+    static constexpr const char* KERNEL = Simd::WIDTH == 16 ? "AVX-512" : Simd::WIDTH == 8 ? "AVX2" : "SSE";
+
+    // new objects sit at the origin, unrotated, unscaled
+    void Resize(uint32_t objectCount) {
+        count = objectCount;
+
+        for (uint32_t c = 0; c < COMPONENT_COUNT; ++c) {
+            float identity = c == ROT_W || c >= SCALE_X ? 1.0f : 0.0f;
+            components[c].resize(count, identity);
+        }
     }
-    catch (std::runtime_error& err) {
-        std::cerr << err.what() << std::endl;
-        return false;
+
+    uint32_t GetCount() const {
+        return count;
     }
 
-    return true;
-}
+    float* Get(Component component) {
+        return components[component].data();
+    }
 
-void Harmony::Run() {
-    for (;;) {
-        MSG msg;
+    const float* Get(Component component) const {
+        return components[component].data();
+    }
 
-        while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+    void Set(uint32_t index, const XMFLOAT3& position, const XMFLOAT4& rotation, const XMFLOAT3& scale) {
+        const float values[COMPONENT_COUNT] = {
+            position.x, position.y, position.z,
+            rotation.x, rotation.y, rotation.z, rotation.w,
+            scale.x, scale.y, scale.z
+        };
+
+        for (uint32_t c = 0; c < COMPONENT_COUNT; ++c) {
+            components[c][index] = values[c];
         }
+    }
 
-        if (msg.message == WM_QUIT) {
-            break;
+    //
+    // Objects [first, last): MVP of object i at pMvp + (i - first) * mvpStride, its world matrix at
+    // pWorld + (i - first) * worldStride if pWorld is set.
+    //
+    void Compute(uint32_t first, uint32_t last, const XMFLOAT4X4& viewProj, uint8_t* pMvp, size_t mvpStride,
+                 uint8_t* pWorld = nullptr, size_t worldStride = 0) const {
+        uint32_t i = first;
+
+        for (; i + Simd::WIDTH <= last; i += Simd::WIDTH) {
+            ComputeLanes<Simd>(i, nullptr, viewProj, pMvp + (i - first) * mvpStride, mvpStride,
+                               pWorld ? pWorld + (i - first) * worldStride : nullptr, worldStride);
         }
 
-        Render();
+        for (; i < last; ++i) {
+            ComputeOne(i, viewProj, pMvp + (i - first) * mvpStride, pWorld ? pWorld + (i - first) * worldStride : nullptr);
+        }
     }
-}
 
-void Harmony::Shutdown() {
-    WaitForGpu();
+    // the objects listed in pIndices (a culling pass' visible list), MVP of pIndices[n] at pMvp + n * mvpStride
+    void ComputeIndexed(const uint32_t* pIndices, uint32_t indexCount, const XMFLOAT4X4& viewProj, uint8_t* pMvp, size_t mvpStride) const {
+        uint32_t n = 0;
 
-    delQ.Finalize();
-}
+        for (; n + Simd::WIDTH <= indexCount; n += Simd::WIDTH) {
+            ComputeLanes<Simd>(0, pIndices + n, viewProj, pMvp + n * mvpStride, mvpStride, nullptr, 0);
+        }
 
-void Harmony::Resize() {
-    //TODO:
-}
+        for (; n < indexCount; ++n) {
+            ComputeOne(pIndices[n], viewProj, pMvp + n * mvpStride, nullptr);
+        }
+    }
 
-#pragma endregion
+    // all objects over the job system, grain objects per job (rounded to whole registers)
+    void Compute(JobSystem& jobs, uint32_t grain, const XMFLOAT4X4& viewProj, uint8_t* pMvp, size_t mvpStride,
+                 uint8_t* pWorld = nullptr, size_t worldStride = 0) const {
+        grain = (std::max)((grain + Simd::WIDTH - 1) / Simd::WIDTH * Simd::WIDTH, Simd::WIDTH);
 
-#pragma region Init Calls
+        jobs.ParallelFor(0, count, grain, [&](uint64_t first, uint64_t last) {
+            Compute(uint32_t(first), uint32_t(last), viewProj, pMvp + first * mvpStride, mvpStride,
+                    pWorld ? pWorld + first * worldStride : nullptr, worldStride);
+        });
+    }
 
-void Harmony::OpenWindow(HINSTANCE instance) {
-    WNDCLASSEX wcex{
-       sizeof(WNDCLASSEX),
-       CS_HREDRAW | CS_VREDRAW,
-       WndProc,
-       0,
-       0,
-       instance,
-       LoadIcon(instance, IDI_APPLICATION),
-       LoadCursor(instance, IDC_ARROW),
-       (HBRUSH)GetStockObject(BLACK_BRUSH),
-       NULL,
-       APPLICATION_NAME,
-       LoadIcon(instance, IDI_APPLICATION)
-    };
+    // one XMMATRIX product per object; the reference the kernels are checked against
+    void ComputeReference(uint32_t first, uint32_t last, const XMFLOAT4X4& viewProj, uint8_t* pMvp, size_t mvpStride) const {
+        XMMATRIX vp = XMLoadFloat4x4(&viewProj);
 
-    if (!RegisterClassEx(&wcex)) {
-        throw std::runtime_error("Could not register class!");
+        for (uint32_t i = first; i < last; ++i) {
+            XMMATRIX world = XMMatrixScaling(components[SCALE_X][i], components[SCALE_Y][i], components[SCALE_Z][i])
+                           * XMMatrixRotationQuaternion(XMVectorSet(components[ROT_X][i], components[ROT_Y][i], components[ROT_Z][i], components[ROT_W][i]))
+                           * XMMatrixTranslation(components[POS_X][i], components[POS_Y][i], components[POS_Z][i]);
+
+            XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(pMvp + (i - first) * mvpStride), world * vp);
+        }
     }
 
-    int screenWidth  = GetSystemMetrics(SM_CXSCREEN);
-    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+private:
+    //
+    // World = scale * rotation * translation (row vectors). Its last column is (0, 0, 0, 1), so each
+    // MVP row is three multiply-adds of viewProj rows, plus viewProj's last row for the translation.
+    // Lanes are objects i to i + WIDTH, or the WIDTH objects pIndices lists.
+    //
+    template <typename S>
+    void ComputeLanes(uint32_t i, const uint32_t* pIndices, const XMFLOAT4X4& viewProj, uint8_t* pMvp, size_t mvpStride,
+                      uint8_t* pWorld, size_t worldStride) const {
+        using V = typename S::V;
 
-    int windowX = screenWidth / 2 - WINDOW_WIDTH / 2;
-    int windowY = screenHeight / 2 - WINDOW_HEIGHT / 2;
+        auto Fetch = [&](Component c) {
+            return pIndices ? S::Gather(components[c].data(), pIndices) : S::Load(&components[c][i]);
+        };
 
-    hMainWindow = CreateWindowEx(
-        WS_EX_OVERLAPPEDWINDOW, APPLICATION_NAME, APPLICATION_NAME,
-        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
-        windowX, windowY, WINDOW_WIDTH, WINDOW_HEIGHT,
-        NULL,
-        NULL,
-        instance,
-        NULL);
+        V x = Fetch(ROT_X), y = Fetch(ROT_Y);
+        V z = Fetch(ROT_Z), w = Fetch(ROT_W);
 
-    if (!hMainWindow) {
-        throw std::runtime_error("Could not create main window!");
-    }
+        V one = S::Set1(1.0f);
+        V x2  = S::Add(x, x), y2 = S::Add(y, y), z2 = S::Add(z, z);
 
-    ShowWindow(hMainWindow, SW_SHOW);
-    UpdateWindow(hMainWindow);
-    SetForegroundWindow(hMainWindow);
-    SetFocus(hMainWindow);
+        V xx = S::Mul(x, x2), yy = S::Mul(y, y2), zz = S::Mul(z, z2);
+        V xy = S::Mul(x, y2), xz = S::Mul(x, z2), yz = S::Mul(y, z2);
+        V wx = S::Mul(w, x2), wy = S::Mul(w, y2), wz = S::Mul(w, z2);
 
-    SetWindowLongPtr(hMainWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+        V sx = Fetch(SCALE_X), sy = Fetch(SCALE_Y), sz = Fetch(SCALE_Z);
 
-    delQ.Append(
-        [ cHwnd = hMainWindow] {
-            DestroyWindow(cHwnd);
-        }
-    );
-}
+        V world[16] = {
+            S::Mul(sx, S::Sub(one, S::Add(yy, zz))), S::Mul(sx, S::Add(xy, wz)), S::Mul(sx, S::Sub(xz, wy)), S::Set1(0.0f),
+            S::Mul(sy, S::Sub(xy, wz)), S::Mul(sy, S::Sub(one, S::Add(xx, zz))), S::Mul(sy, S::Add(yz, wx)), S::Set1(0.0f),
+            S::Mul(sz, S::Add(xz, wy)), S::Mul(sz, S::Sub(yz, wx)), S::Mul(sz, S::Sub(one, S::Add(xx, yy))), S::Set1(0.0f),
+            Fetch(POS_X), Fetch(POS_Y), Fetch(POS_Z), one,
+        };
 
-void Harmony::CreateAdapter() {
-    UINT dxgiFactoryFlags = 0;
+        V mvp[16];
 
-    if constexpr (enableDebugLayers) {
-        ComPtr<ID3D12Debug> debugController;
+        for (uint32_t c = 0; c < 4; ++c) {
+            V vp0 = S::Set1(viewProj.m[0][c]), vp1 = S::Set1(viewProj.m[1][c]);
+            V vp2 = S::Set1(viewProj.m[2][c]), vp3 = S::Set1(viewProj.m[3][c]);
 
-        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
-            debugController->EnableDebugLayer();
+            for (uint32_t r = 0; r < 3; ++r) {
+                mvp[r * 4 + c] = S::MulAdd(world[r * 4 + 2], vp2, S::MulAdd(world[r * 4 + 1], vp1, S::Mul(world[r * 4 + 0], vp0)));
+            }
 
-            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+            mvp[12 + c] = S::MulAdd(world[14], vp2, S::MulAdd(world[13], vp1, S::MulAdd(world[12], vp0, vp3)));
         }
-    }
 
-    ComPtr<IDXGIFactory> factory;
-    if (FAILED(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)))) {
-        throw std::runtime_error("Could not create DXGI factory!");
+        S::Store(mvp, pMvp, mvpStride);
+
+        if (pWorld) {
+            S::Store(world, pWorld, worldStride);
+        }
     }
 
-    ComPtr<IDXGIAdapter1> adapter1;
-    ComPtr<IDXGIFactory7> factory7;
-    if (SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&factory7)))) {
-        UINT adapterIndex = 0;
+    void ComputeOne(uint32_t i, const XMFLOAT4X4& viewProj, uint8_t* pMvp, uint8_t* pWorld) const {
+        float x = components[ROT_X][i], y = components[ROT_Y][i], z = components[ROT_Z][i], w = components[ROT_W][i];
+        float sx = components[SCALE_X][i], sy = components[SCALE_Y][i], sz = components[SCALE_Z][i];
 
-        for (; SUCCEEDED(factory7->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter1))); ++adapterIndex)
-        {
-            DXGI_ADAPTER_DESC1 desc;
-            adapter1->GetDesc1(&desc);
+        float world[4][4] = {
+            { sx * (1 - 2 * (y * y + z * z)), sx * 2 * (x * y + w * z),       sx * 2 * (x * z - w * y),       0.0f },
+            { sy * 2 * (x * y - w * z),       sy * (1 - 2 * (x * x + z * z)), sy * 2 * (y * z + w * x),       0.0f },
+            { sz * 2 * (x * z + w * y),       sz * 2 * (y * z - w * x),       sz * (1 - 2 * (x * x + y * y)), 0.0f },
+            { components[POS_X][i],           components[POS_Y][i],           components[POS_Z][i],           1.0f },
+        };
 
-            if (desc.Flags & DXGI_ADAPTER_FLAG::DXGI_ADAPTER_FLAG_SOFTWARE) {
-                continue;
-            }
+        float* pOut = reinterpret_cast<float*>(pMvp);
 
-            if (SUCCEEDED(D3D12CreateDevice(adapter1.Get(), featureLevel, __uuidof(ID3D12Device), nullptr))) {
-                break;
+        for (uint32_t r = 0; r < 4; ++r) {
+            for (uint32_t c = 0; c < 4; ++c) {
+                pOut[r * 4 + c] = world[r][0] * viewProj.m[0][c] + world[r][1] * viewProj.m[1][c]
+                                + world[r][2] * viewProj.m[2][c] + world[r][3] * viewProj.m[3][c];
             }
         }
-    }
 
-    if (!adapter1.Get()) {
-        throw std::runtime_error("Could not find GPU HW adapter!");
+        if (pWorld) {
+            memcpy(pWorld, world, sizeof(world));
+        }
     }
 
-    pFactory7 = factory7.Detach();
-    pAdapter1 = adapter1.Detach();
+    uint32_t                                        count = 0;
+    std::array<std::vector<float>, COMPONENT_COUNT> components;
+};
 
-    delQ.Append([cFactory = pFactory7, cAdapter = pAdapter1] {
-        cAdapter->Release();
-        cFactory->Release();
-    });
+//
+// World space bounds of the TransformSystem's objects, one array per component like the transforms,
+// and the frustum test over them: bounding spheres or AABBs (center and half extents) against the six
+// planes, WIDTH objects per register. Cull() writes the indices of the objects that pass, in order.
+// Over the job system every chunk compacts into its own part of the output, and the chunks are then
+// moved down to close the gaps.
+//
+class CullingSystem {
+public:
+    enum Component {
+        CENTER_X, CENTER_Y, CENTER_Z,
+        EXTENT_X, EXTENT_Y, EXTENT_Z,
+        RADIUS,
+        COMPONENT_COUNT
+    };
 
-    DXGI_ADAPTER_DESC1 adDesc = {};
-    pAdapter1->GetDesc1(&adDesc);
+    enum class Test {
+        Sphere,
+        Box
+    };
 
-    std::wcout << "Running on: " << adDesc.Description << std::endl;
-    std::wcout << "     Video  Mem: " << GetSizeInMB(adDesc.DedicatedVideoMemory)  << "MB" << std::endl;
-    std::wcout << "     System Mem: " << GetSizeInMB(adDesc.DedicatedSystemMemory) << "MB" << std::endl;
-    std::wcout << "     Shared Mem: " << GetSizeInMB(adDesc.SharedSystemMemory)    << "MB" << std::endl;
-}
+    using Simd = TransformSystem::Simd;
 
-void Harmony::CreateDevice() {
-    ComPtr<ID3D12Device9> device;
+    void Resize(uint32_t objectCount) {
+        count = objectCount;
 
-    if (FAILED(D3D12CreateDevice(pAdapter1, featureLevel, IID_PPV_ARGS(&device)))) {
-        throw std::runtime_error("Could not create ID3D12Device9 device!");
+        for (auto& component : components) {
+            component.resize(count, 0.0f);
+        }
     }
 
-    pDevice9 = device.Detach();
-
-    delQ.Append([cDevice = pDevice9] {
-        cDevice->Release();
-    });
+    uint32_t GetCount() const {
+        return count;
+    }
 
-    // Query feature 
-    pDevice9->CheckFeatureSupport(D3D12_FEATURE::D3D12_FEATURE_D3D12_OPTIONS, &featureDataOpts, sizeof featureDataOpts);
-    if (featureDataOpts.ResourceHeapTier != D3D12_RESOURCE_HEAP_TIER_2) {
-        std::cout << "Resource heap Tier is not Tier 2!" << std::endl;
+    const float* Get(Component component) const {
+        return components[component].data();
     }
 
-    D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_5 };
+    //
+    // Bounds of objects [first, last) from their transforms and the mesh's local AABB: the box rotated
+    // and scaled gets the AABB around it, the sphere is the local box's at the largest scale.
+    //
+    void UpdateBounds(const TransformSystem& transforms, uint32_t first, uint32_t last, const XMFLOAT3& localCenter, const XMFLOAT3& localExtent) {
+        const float* pPos[3]   = { transforms.Get(TransformSystem::POS_X), transforms.Get(TransformSystem::POS_Y), transforms.Get(TransformSystem::POS_Z) };
+        const float* pRot[4]   = { transforms.Get(TransformSystem::ROT_X), transforms.Get(TransformSystem::ROT_Y),
+                                   transforms.Get(TransformSystem::ROT_Z), transforms.Get(TransformSystem::ROT_W) };
+        const float* pScale[3] = { transforms.Get(TransformSystem::SCALE_X), transforms.Get(TransformSystem::SCALE_Y), transforms.Get(TransformSystem::SCALE_Z) };
+
+        float localRadius = sqrtf(localExtent.x * localExtent.x + localExtent.y * localExtent.y + localExtent.z * localExtent.z);
+
+        for (uint32_t i = first; i < last; ++i) {
+            float x = pRot[0][i], y = pRot[1][i], z = pRot[2][i], w = pRot[3][i];
+            float sx = pScale[0][i], sy = pScale[1][i], sz = pScale[2][i];
+
+            // world rows as in TransformSystem::ComputeOne
+            float m[3][3] = {
+                { sx * (1 - 2 * (y * y + z * z)), sx * 2 * (x * y + w * z),       sx * 2 * (x * z - w * y)       },
+                { sy * 2 * (x * y - w * z),       sy * (1 - 2 * (x * x + z * z)), sy * 2 * (y * z + w * x)       },
+                { sz * 2 * (x * z + w * y),       sz * 2 * (y * z - w * x),       sz * (1 - 2 * (x * x + y * y)) },
+            };
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel)))
-        || (shaderModel.HighestShaderModel < D3D_SHADER_MODEL_6_5)) {
-        throw std::runtime_error("Shader Model 6.5 is not supported!");
-    }
+            for (uint32_t c = 0; c < 3; ++c) {
+                components[CENTER_X + c][i] = pPos[c][i] + localCenter.x * m[0][c] + localCenter.y * m[1][c] + localCenter.z * m[2][c];
+                components[EXTENT_X + c][i] = localExtent.x * fabsf(m[0][c]) + localExtent.y * fabsf(m[1][c]) + localExtent.z * fabsf(m[2][c]);
+            }
 
-    D3D12_FEATURE_DATA_D3D12_OPTIONS7 features = {};
+            components[RADIUS][i] = localRadius * (std::max)((std::max)(fabsf(sx), fabsf(sy)), fabsf(sz));
+        }
+    }
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &features, sizeof(features)))
-        || (features.MeshShaderTier == D3D12_MESH_SHADER_TIER_NOT_SUPPORTED)) {
-        throw std::exception("Mesh Shaders aren't supported!");
+    // objects [first, last) that pass into pVisible, returns how many
+    uint32_t Cull(Test test, const Frustum& frustum, uint32_t first, uint32_t last, uint32_t* pVisible) const {
+        return test == Test::Sphere ? CullRange<Simd, Test::Sphere>(frustum, first, last, pVisible)
+                                    : CullRange<Simd, Test::Box>(frustum, first, last, pVisible);
     }
-}
 
-void Harmony::CreateCommandQueue() {
-    ComPtr<ID3D12CommandQueue> cmdQueue;
+    // objects [0, objectCount) over the job system, grain objects per job (rounded to whole registers)
+    uint32_t Cull(JobSystem& jobs, uint32_t grain, Test test, const Frustum& frustum, uint32_t objectCount, uint32_t* pVisible) {
+        grain = (std::max)((grain + Simd::WIDTH - 1) / Simd::WIDTH * Simd::WIDTH, Simd::WIDTH);
 
-    {
-        D3D12_COMMAND_QUEUE_DESC desc = {
-            .Type     = D3D12_COMMAND_LIST_TYPE_DIRECT,
-            .Priority = 0,
-            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
-            .NodeMask = 0
-        };
+        uint32_t chunks = (objectCount + grain - 1) / grain;
+        chunkVisible.resize(chunks);
 
-        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
-            throw std::runtime_error("Could not create graphics command queue");
-        }
+        jobs.ParallelFor(0, objectCount, grain, [&](uint64_t first, uint64_t last) {
+            chunkVisible[first / grain] = Cull(test, frustum, uint32_t(first), uint32_t(last), pVisible + first);
+        });
 
-        pCommandQueue = cmdQueue.Detach();
+        uint32_t visible = 0;
 
-        delQ.Append([cCommandQueue = pCommandQueue] {
-            cCommandQueue->Release();
-        });
+        for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+            if (visible != chunk * grain) {
+                memmove(pVisible + visible, pVisible + chunk * grain, chunkVisible[chunk] * sizeof(uint32_t));
+            }
+
+            visible += chunkVisible[chunk];
+        }
+
+        return visible;
     }
 
-    {
-        D3D12_COMMAND_QUEUE_DESC desc = {
-            .Type     = D3D12_COMMAND_LIST_TYPE_COPY,
-            .Priority = 0,
-            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
-            .NodeMask = 0
-        };
+    // one object and one plane at a time; the reference the kernels are checked against
+    uint32_t CullReference(Test test, const Frustum& frustum, uint32_t first, uint32_t last, uint32_t* pVisible) const {
+        uint32_t visible = 0;
 
-        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
-            throw std::runtime_error("Could not create copy command queue");
+        for (uint32_t i = first; i < last; ++i) {
+            if (test == Test::Sphere ? CullOne<Test::Sphere>(frustum, i) : CullOne<Test::Box>(frustum, i)) {
+                pVisible[visible++] = i;
+            }
         }
 
-        pCopyQueue = cmdQueue.Detach();
-
-        delQ.Append([cCommandQueue = pCommandQueue] {
-            cCommandQueue->Release();
-        });
+        return visible;
     }
-}
-
-void Harmony::CreateSwapChain() {
-    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = { 0 };
 
-    swapChainDesc.BufferCount = MAX_FRAMES_IN_FLIGHT;
-    swapChainDesc.Width       = WINDOW_WIDTH;
-    swapChainDesc.Height      = WINDOW_HEIGHT;
-    swapChainDesc.Format      = DXGI_FORMAT_R8G8B8A8_UNORM;
-    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.SwapEffect  = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+private:
+    //
+    // An object is outside when it is entirely behind one plane: the sphere's center further behind
+    // it than the radius, or the AABB's corner furthest along the normal behind it (the extents
+    // projected on the normal's absolute value). The kernel takes the minimum over the planes, and
+    // one compare per register.
+    //
+    template <typename S, Test TEST>
+    uint32_t CullRange(const Frustum& frustum, uint32_t first, uint32_t last, uint32_t* pVisible) const {
+        using V = typename S::V;
+
+        V plane[Frustum::PLANE_COUNT][4];
+        V absNormal[Frustum::PLANE_COUNT][3];
+
+        for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p) {
+            const Frustum::Plane& f = frustum.planes[p];
+
+            plane[p][0]     = S::Set1(f.x);
+            plane[p][1]     = S::Set1(f.y);
+            plane[p][2]     = S::Set1(f.z);
+            plane[p][3]     = S::Set1(f.w);
+            absNormal[p][0] = S::Set1(fabsf(f.x));
+            absNormal[p][1] = S::Set1(fabsf(f.y));
+            absNormal[p][2] = S::Set1(fabsf(f.z));
+        }
 
-    swapChainDesc.SampleDesc.Count   = 1;
-    swapChainDesc.SampleDesc.Quality = 0;
+        V zero = S::Set1(0.0f);
 
-    ComPtr<IDXGISwapChain1> swapChain;
-    
-    if (FAILED(pFactory7->CreateSwapChainForHwnd(pCommandQueue, hMainWindow, &swapChainDesc, nullptr, nullptr, &swapChain))) {
-        throw std::runtime_error("Could not create swap chain!");
-    }
+        uint32_t visible = 0;
+        uint32_t i       = first;
 
-    if (FAILED(pFactory7->MakeWindowAssociation(hMainWindow, DXGI_MWA_NO_ALT_ENTER))) {
-        throw std::runtime_error("Could not associate swap chain with hWnd!");
-    }
+        for (; i + S::WIDTH <= last; i += S::WIDTH) {
+            V cx = S::Load(&components[CENTER_X][i]), cy = S::Load(&components[CENTER_Y][i]), cz = S::Load(&components[CENTER_Z][i]);
 
-    swapChain->QueryInterface(&pSwapChain4);
-    if (!pSwapChain4) {
-        throw std::runtime_error("Could not get SwapChain4 interface!");
-    }
+            V ex, ey, ez, radius;
 
-    frameIndex = pSwapChain4->GetCurrentBackBufferIndex();
+            if constexpr (TEST == Test::Sphere) {
+                radius = S::Load(&components[RADIUS][i]);
+            }
+            else {
+                ex = S::Load(&components[EXTENT_X][i]), ey = S::Load(&components[EXTENT_Y][i]), ez = S::Load(&components[EXTENT_Z][i]);
+            }
 
-    delQ.Append([cSwapChain = pSwapChain4 ] {
-        cSwapChain->Release();
-    });
+            V nearest = S::Set1(FLT_MAX);
 
-    viewport    = D3D12_VIEWPORT{ .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = WINDOW_WIDTH, .Height = WINDOW_HEIGHT, .MinDepth = D3D12_MIN_DEPTH, .MaxDepth = D3D12_MAX_DEPTH };
-    scissorRect = D3D12_RECT{ .left = 0, .top = 0, .right = WINDOW_WIDTH, .bottom = WINDOW_HEIGHT };
-}
+            for (uint32_t p = 0; p < Frustum::PLANE_COUNT; ++p) {
+                V distance = S::MulAdd(cz, plane[p][2], S::MulAdd(cy, plane[p][1], S::MulAdd(cx, plane[p][0], plane[p][3])));
 
-void Harmony::CreateHeaps() {
-    ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+                if constexpr (TEST == Test::Sphere) {
+                    distance = S::Add(distance, radius);
+                }
+                else {
+                    distance = S::MulAdd(ez, absNormal[p][2], S::MulAdd(ey, absNormal[p][1], S::MulAdd(ex, absNormal[p][0], distance)));
+                }
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
-            .NumDescriptors = MAX_FRAMES_IN_FLIGHT,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
-        };
+                nearest = S::Min(nearest, distance);
+            }
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create RTV heap!");
+            visible += S::Compact(S::MaskGe(nearest, zero), i, pVisible + visible);
         }
 
-        rtvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-        pRtvHeap = descriptorHeap.Detach();
+        for (; i < last; ++i) {
+            if (CullOne<TEST>(frustum, i)) {
+                pVisible[visible++] = i;
+            }
+        }
 
-        delQ.Append([cHeap = pRtvHeap] {
-            cHeap->Release();
-        });
+        return visible;
     }
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
-            .NumDescriptors = 1,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
-        };
+    template <Test TEST>
+    bool CullOne(const Frustum& frustum, uint32_t i) const {
+        for (const Frustum::Plane& f : frustum.planes) {
+            float distance = components[CENTER_X][i] * f.x + components[CENTER_Y][i] * f.y + components[CENTER_Z][i] * f.z + f.w;
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create DSV heap!");
-        }
+            float reach = TEST == Test::Sphere
+                        ? components[RADIUS][i]
+                        : components[EXTENT_X][i] * fabsf(f.x) + components[EXTENT_Y][i] * fabsf(f.y) + components[EXTENT_Z][i] * fabsf(f.z);
 
-        dsvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
-        pDsvHeap = descriptorHeap.Detach();
+            if (distance + reach < 0.0f) {
+                return false;
+            }
+        }
 
-        delQ.Append([cHeap = pDsvHeap] {
-            cHeap->Release();
-        });
+        return true;
     }
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-            .NumDescriptors = 128, // sufficiently large to hold mipgen SRV and UAV chain
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-        };
+    uint32_t                                        count = 0;
+    std::array<std::vector<float>, COMPONENT_COUNT> components;
+    std::vector<uint32_t>                           chunkVisible;       // per chunk of the last parallel Cull()
+};
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
-        }
+// the culling system's center and extent arrays, the boxes the occlusion culler, the BVH and the draws read
+static OcclusionCuller::Boxes CullingBoxes(const CullingSystem& bounds) {
+    return {
+        .pCenter = { bounds.Get(CullingSystem::CENTER_X), bounds.Get(CullingSystem::CENTER_Y), bounds.Get(CullingSystem::CENTER_Z) },
+        .pExtent = { bounds.Get(CullingSystem::EXTENT_X), bounds.Get(CullingSystem::EXTENT_Y), bounds.Get(CullingSystem::EXTENT_Z) }
+    };
+}
 
-        srvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        pSrvHeap = descriptorHeap.Detach();
+//
+// CPU and GPU cost of the objects drawn, per frame and per instance, printed roughly once a second.
+// CPU time is transforms (animation and culling included) plus command recording; GPU time spans the
+// draws. GPU frames arrive a few frames late, so each side averages its own instance count.
+//
+class InstanceStats {
+public:
+    void AddCpu(uint32_t objects, uint32_t instances, float transformMs, float recordMs) {
+        cpuFrames    += 1;
+        cpuObjects   += objects;
+        cpuInstances += instances;
+        transformSum += transformMs;
+        recordSum    += recordMs;
+    }
 
-        delQ.Append([cHeap = pSrvHeap] {
-            cHeap->Release();
-        });
+    void AddGpu(uint32_t instances, float gpuMs) {
+        gpuFrames    += 1;
+        gpuInstances += instances;
+        gpuSum       += gpuMs;
     }
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC smpHeapDesc {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
-            .NumDescriptors = 8,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-        };
+    // returns true if it printed
+    bool Report(bool force) {
+        auto now = std::chrono::steady_clock::now();
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&smpHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        if (cpuFrames == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return false;
         }
 
-        smpDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
-        pSmpHeap = descriptorHeap.Detach();
+        float cpuMs = (transformSum + recordSum) / cpuFrames;
 
-        delQ.Append([cHeap = pSmpHeap] {
-            cHeap->Release();
-        });
-    }
+        std::cout << "Instances: " << cpuInstances / cpuFrames << " of " << cpuObjects / cpuFrames << ", CPU " << cpuMs << " ms (transforms "
+                  << transformSum / cpuFrames << " record " << recordSum / cpuFrames << ") "
+                  << (transformSum + recordSum) * 1e6f / float((std::max)(cpuInstances, uint64_t(1))) << " ns/instance";
 
-    auto AllocateHeap = [cDevice = pDevice9](UINT64 chunkSize, D3D12_HEAP_TYPE type) -> ID3D12Heap* {
-        D3D12_HEAP_PROPERTIES hProps = cDevice->GetCustomHeapProperties(0, type);
+        if (gpuFrames > 0 && gpuInstances > 0) {
+            std::cout << ", GPU " << gpuSum / gpuFrames << " ms " << gpuSum * 1e6f / float(gpuInstances) << " ns/instance";
+        }
 
-        D3D12_HEAP_DESC heapDesc {
-            .SizeInBytes = chunkSize,
-            .Properties = {.Type = type, .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN, .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN, .CreationNodeMask = hProps.CreationNodeMask , .VisibleNodeMask = hProps.VisibleNodeMask },
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Flags      = D3D12_HEAP_FLAG_NONE
-        };
+        std::cout << std::endl;
 
-        ComPtr<ID3D12Heap> memHeap;
-        if (FAILED(cDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&memHeap)))) {
-            throw std::runtime_error("Could not create default memory heap!");
-        }
+        cpuFrames    = 0;
+        gpuFrames    = 0;
+        cpuObjects   = 0;
+        cpuInstances = 0;
+        gpuInstances = 0;
+        transformSum = 0.0f;
+        recordSum    = 0.0f;
+        gpuSum       = 0.0f;
+        statStart    = now;
 
-        return memHeap.Detach();
-    };
+        return true;
+    }
 
-    pResourceHeap = AllocateHeap(DEFAULT_CHUNK_SIZE, D3D12_HEAP_TYPE_DEFAULT);
-    
-    delQ.Append([cHeap = pResourceHeap] {
-        cHeap->Release();
-    });
-}
+private:
+    uint64_t                              cpuFrames    = 0;
+    uint64_t                              gpuFrames    = 0;
+    uint64_t                              cpuObjects   = 0;
+    uint64_t                              cpuInstances = 0;
+    uint64_t                              gpuInstances = 0;
+    float                                 transformSum = 0.0f;
+    float                                 recordSum    = 0.0f;
+    float                                 gpuSum       = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
 
-void Harmony::CreateResourcesAndViews() {
-    UINT64 defaultHeapOffset = 0;
+//
+// Streams data into default heap resources through a persistently mapped staging
+// ring on the copy queue. Requests are batched into one command list per Submit().
+// Destinations must be in COMMON: the copy queue promotes them to COPY_DEST and
+// they decay back to COMMON when the batch completes, so the consuming queue waits
+// on the returned fence value and transitions from COMMON itself.
+//
+class UploadManager {
+public:
+    static constexpr UINT64 STAGING_SIZE = 64 * 1024 * 1024;
 
-    {
-        D3D12_RESOURCE_DESC cbDesc {
+    void Init(ID3D12Device* device, ID3D12CommandQueue* queue) {
+        pDevice = device;
+        pQueue  = queue;
+
+        if (FAILED(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&pFence)))) {
+            throw std::runtime_error("Could not create upload fence!");
+        }
+
+        waitEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!waitEvent) {
+            throw std::runtime_error("Could not create upload event!");
+        }
+
+        D3D12_RESOURCE_DESC stagingDesc {
             .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
             .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width            = sizeof(UniformBuffer) * MAX_FRAMES_IN_FLIGHT,
+            .Width            = STAGING_SIZE,
             .Height           = 1,
             .DepthOrArraySize = 1,
             .MipLevels        = 1,
             .Format           = DXGI_FORMAT_UNKNOWN,
             .SampleDesc       = { .Count = 1, .Quality = 0 },
             .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags            = D3D12_RESOURCE_FLAG_NONE,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE
         };
 
         D3D12_HEAP_PROPERTIES uploadHeapProps {
@@ -630,979 +870,4530 @@ void Harmony::CreateResourcesAndViews() {
             .VisibleNodeMask        = 0
         };
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &cbDesc);
-        if (resInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
-            cbDesc.Alignment = resInfo.Alignment;
+        if (FAILED(pDevice->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &stagingDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pStaging)))) {
+            throw std::runtime_error("Could not create upload staging ring!");
         }
 
-        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pConstantBuffer)))) {
-            throw std::runtime_error("Could not create constant buffer!");
+        void* pData = nullptr;
+        if (FAILED(pStaging->Map(0, nullptr, &pData)) || pData == nullptr) {
+            throw std::runtime_error("Could not map upload staging ring!");
         }
 
-        delQ.Append([cbuff = pConstantBuffer] {
-            cbuff->Release();
-        });
+        pStagingData = reinterpret_cast<uint8_t*>(pData);
     }
-    
-    {
-        D3D12_CLEAR_VALUE dsVal {
-            .Format = DXGI_FORMAT_D32_FLOAT,
-            .Color = { 1.0f, 1.0f, 1.0f, 1.0f }
-        };
 
-        D3D12_RESOURCE_DESC depthDesc {
-            .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width     = WINDOW_WIDTH,
-            .Height    = WINDOW_HEIGHT,
-            .DepthOrArraySize = 1,
-            .MipLevels = 1,
-            .Format = DXGI_FORMAT_D32_FLOAT,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
-            .Flags  = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL,
-        };
+    void Destroy() {
+        WaitIdle();
+        ReportStats(true);
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &depthDesc);
-        
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &depthDesc, D3D12_RESOURCE_STATE_COMMON, &dsVal, IID_PPV_ARGS(&pDepthBuffer)))) {
-            throw std::runtime_error("Could not create depth buffer!");
+        for (auto* pAllocator : freeAllocators) {
+            pAllocator->Release();
         }
+        freeAllocators.clear();
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+        if (isRecording) {
+            pCommandList->Close();
+            recording.pAllocator->Release();
+            isRecording = false;
+        }
 
-        delQ.Append([cbuff = pDepthBuffer] {
-            cbuff->Release();
-        });
+        if (pCommandList) pCommandList->Release();
+        if (pStaging)     pStaging->Release();
+        if (pFence)       pFence->Release();
+        if (waitEvent)    CloseHandle(waitEvent);
+
+        pCommandList = nullptr;
+        pStaging     = nullptr;
+        pFence       = nullptr;
+        waitEvent    = NULL;
     }
 
-    {
-        D3D12_CLEAR_VALUE texVal {
-            .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .Color = { 0.0f, 0.0f, 0.0f, 0.0f }
+    //
+    // Queue a copy into a buffer. Returns false if the staging ring can't hold the data
+    // right now; Submit/Poll and retry.
+    //
+    bool UploadBuffer(ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size) {
+        if (!BeginBatch()) {
+            return false;
+        }
+
+        UINT64 offset = AllocateStaging(size, 4);
+        if (offset == INVALID_OFFSET) {
+            return false;
+        }
+
+        memcpy_s(pStagingData + offset, size, data, size);
+
+        pCommandList->CopyBufferRegion(dst, dstOffset, pStaging, offset, size);
+        recording.payloadBytes += size;
+
+        return true;
+    }
+
+    //
+    // Queue a copy of a width x height texel block into (dstX, dstY) of a texture subresource.
+    // srcRowPitch is the pitch of the tightly laid out source data.
+    //
+    bool UploadTexture(ID3D12Resource* dst, UINT subresource, UINT dstX, UINT dstY, UINT width, UINT height, const void* data, UINT64 srcRowPitch) {
+        if (!BeginBatch()) {
+            return false;
+        }
+
+        D3D12_RESOURCE_DESC regionDesc = dst->GetDesc();
+        regionDesc.Alignment        = 0;
+        regionDesc.Width            = width;
+        regionDesc.Height           = height;
+        regionDesc.DepthOrArraySize = 1;
+        regionDesc.MipLevels        = 1;
+        regionDesc.Layout           = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        regionDesc.Flags            = D3D12_RESOURCE_FLAG_NONE;
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        UINT   numRows    = 0;
+        UINT64 rowSize    = 0;
+        UINT64 totalBytes = 0;
+
+        pDevice->GetCopyableFootprints(&regionDesc, 0, 1, 0, &footprint, &numRows, &rowSize, &totalBytes);
+
+        UINT64 offset = AllocateStaging(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (offset == INVALID_OFFSET) {
+            return false;
+        }
+
+        const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(data);
+
+        for (UINT row = 0; row < numRows; ++row) {
+            memcpy_s(pStagingData + offset + row * footprint.Footprint.RowPitch, rowSize, pSrc + row * srcRowPitch, rowSize);
+        }
+
+        footprint.Offset = offset;
+
+        D3D12_TEXTURE_COPY_LOCATION dstLoc {
+            .pResource        = dst,
+            .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+            .SubresourceIndex = subresource,
         };
 
-        D3D12_RESOURCE_DESC texDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = TEXTURE_WIDTH,
-            .Height     = TEXTURE_HEIGHT,
-            .DepthOrArraySize = 1,
-            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
-            .Format     = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE,
-            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+        D3D12_TEXTURE_COPY_LOCATION srcLoc {
+            .pResource       = pStaging,
+            .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+            .PlacedFootprint = footprint
         };
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &texDesc);
+        pCommandList->CopyTextureRegion(&dstLoc, dstX, dstY, 0, &srcLoc, nullptr);
+        recording.payloadBytes += rowSize * numRows;
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, &texVal, IID_PPV_ARGS(&pTexture)))) {
-            throw std::runtime_error("Could not create texture!");
+        return true;
+    }
+
+    //
+    // Kick the batch recorded so far. Returns the fence value the consumer has to wait on
+    // (the last submitted value if nothing was recorded).
+    //
+    UINT64 Submit() {
+        if (!isRecording) {
+            return nextFenceValue - 1;
         }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+        pCommandList->Close();
 
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
-            .Format                  = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
-            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-            .Texture2D = {
-                .MostDetailedMip     = 0,
-                .MipLevels           = texDesc.MipLevels,
-                .PlaneSlice          = 0,
-                .ResourceMinLODClamp = 5.0f
-            }
-        };
+        ID3D12CommandList* lists[] = { pCommandList };
+        pQueue->ExecuteCommandLists(1, lists);
 
-        pDevice9->CreateShaderResourceView(pTexture, &srvDesc, pSrvHeap->GetCPUDescriptorHandleForHeapStart());
+        recording.fenceValue = nextFenceValue++;
+        recording.submitTime = std::chrono::steady_clock::now();
+        pQueue->Signal(pFence, recording.fenceValue);
 
-        delQ.Append([ctex = pTexture] {
-            ctex->Release();
-        });
+        inFlight.push_back(recording);
+        isRecording = false;
+
+        return recording.fenceValue;
     }
 
-    {
-        D3D12_SAMPLER_DESC smpDesc {
-            .Filter         = D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT,
-            .AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .MipLODBias     = 0.0f,
-            .MaxAnisotropy  = 0,
-            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
-            .BorderColor    = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK,
-            .MinLOD         = 0.0f,
-            .MaxLOD         = D3D12_FLOAT32_MAX 
-        };
+    // Recycles finished batches; call once per frame.
+    void Poll() {
+        UINT64 completed = pFence->GetCompletedValue();
 
-        pDevice9->CreateSampler(&smpDesc, pSmpHeap->GetCPUDescriptorHandleForHeapStart());
+        while (!inFlight.empty() && inFlight.front().fenceValue <= completed) {
+            Retire(inFlight.front());
+            inFlight.pop_front();
+        }
+
+        ReportStats(false);
+    }
+
+    void WaitIdle() {
+        if (!pFence) {
+            return;
+        }
+
+        Submit();
+        WaitForFence(pFence, nextFenceValue - 1, waitEvent);
+        Poll();
+    }
+
+    ID3D12Fence* GetFence() const {
+        return pFence;
     }
 
+private:
+    static constexpr UINT64 INVALID_OFFSET = ~0ull;
+
+    struct Batch
     {
-        D3D12_RESOURCE_DESC vbDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = sizeof(vertices),
-            .Height     = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels  = 1,
-            .Format     = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags      = D3D12_RESOURCE_FLAG_NONE
-        };
+        UINT64                                fenceValue   = 0;
+        UINT64                                stagingBytes = 0;    // ring space incl. padding, freed on retire
+        UINT64                                payloadBytes = 0;
+        ID3D12CommandAllocator*               pAllocator   = nullptr;
+        std::chrono::steady_clock::time_point submitTime;
+    };
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &vbDesc);
+    bool BeginBatch() {
+        if (isRecording) {
+            return true;
+        }
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &vbDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pVertexBuffer)))) {
-            throw std::runtime_error("Could not create vertex buffer!");
+        ID3D12CommandAllocator* pAllocator = nullptr;
+
+        if (!freeAllocators.empty()) {
+            pAllocator = freeAllocators.back();
+            freeAllocators.pop_back();
+        }
+        else if (FAILED(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&pAllocator)))) {
+            return false;
         }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+        if (!pCommandList) {
+            if (FAILED(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, pAllocator, nullptr, IID_PPV_ARGS(&pCommandList)))) {
+                pAllocator->Release();
+                return false;
+            }
+        }
+        else {
+            pCommandList->Reset(pAllocator, nullptr);
+        }
 
-        delQ.Append([cbuff = pVertexBuffer] {
-            cbuff->Release();
-        });
+        recording   = Batch{ .pAllocator = pAllocator };
+        isRecording = true;
+
+        return true;
     }
 
-    {
-        D3D12_RESOURCE_DESC ibDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = sizeof(indices),
-            .Height     = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels  = 1,
-            .Format     = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags      = D3D12_RESOURCE_FLAG_NONE
-        };
+    //
+    // Ring allocation: live data is the contiguous (wrapping) range of usedBytes ending at head,
+    // so anything that fits in the remaining space can't overlap an in-flight batch.
+    //
+    UINT64 AllocateStaging(UINT64 size, UINT64 alignment) {
+        UINT64 offset   = (head + alignment - 1) & ~(alignment - 1);
+        UINT64 consumed = offset + size - head;
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &ibDesc);
+        if (offset + size > STAGING_SIZE) {
+            offset   = 0;
+            consumed = (STAGING_SIZE - head) + size;
+        }
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &ibDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pIndexBuffer)))) {
-            throw std::runtime_error("Could not create index buffer!");
+        if (usedBytes + consumed > STAGING_SIZE) {
+            return INVALID_OFFSET;
         }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+        head       = (offset + size) % STAGING_SIZE;
+        usedBytes += consumed;
 
-        delQ.Append([cbuff = pIndexBuffer] {
-            cbuff->Release();
-        });
+        recording.stagingBytes += consumed;
+
+        return offset;
     }
 
-    {
-        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = pRtvHeap->GetCPUDescriptorHandleForHeapStart();
+    void Retire(const Batch& batch) {
+        auto now = std::chrono::steady_clock::now();
 
-        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-            if (FAILED(pSwapChain4->GetBuffer(i, IID_PPV_ARGS(&pRenderTargets[i])))) {
-                throw std::runtime_error("Could not Get swap chain buffer!");
-            }
+        usedBytes -= batch.stagingBytes;
 
-            pDevice9->CreateRenderTargetView(pRenderTargets[i], nullptr, rtvHandle);
-            rtvHandle.ptr += rtvDescriptorSize;
+        batch.pAllocator->Reset();
+        freeAllocators.push_back(batch.pAllocator);
+
+        // batches complete in order, so the busy time is the union of [submit, complete]
+        auto busyFrom = (std::max)(batch.submitTime, busyUntil);
+
+        statBusy     += now - busyFrom;
+        busyUntil     = now;
+
+        float latencyMs = std::chrono::duration<float, std::milli>(now - batch.submitTime).count();
+
+        statBatches  += 1;
+        statBytes    += batch.payloadBytes;
+        statLatency  += latencyMs;
+        statMaxLat    = (std::max)(statMaxLat, latencyMs);
+
+        if (statBatches == 1) {
+            statStart = batch.submitTime;
         }
     }
 
-    {
-        D3D12_DEPTH_STENCIL_VIEW_DESC dsViewDesc {
-            .Format        = DXGI_FORMAT_D32_FLOAT,
-            .ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D,
-            .Flags         = D3D12_DSV_FLAG_NONE,
-            .Texture2D     = { 0 }
-        };
+    //
+    // Latency is submit -> completion observed by Poll, so it includes up to a frame of
+    // polling slack. Throughput is measured over the time the copy queue had work queued.
+    //
+    void ReportStats(bool force) {
+        if (statBatches == 0) {
+            return;
+        }
 
-        D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+        if (!force && (std::chrono::steady_clock::now() - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
 
-        pDevice9->CreateDepthStencilView(pDepthBuffer, &dsViewDesc, dsvHandle);
+        float busySec = std::chrono::duration<float>(statBusy).count();
+        float mb      = statBytes / (1024.0f * 1024.0f);
+
+        std::cout << "Uploads: " << statBatches << " batches, " << mb << " MB, "
+                  << (busySec > 0.0f ? mb / busySec : 0.0f) << " MB/s, latency avg "
+                  << statLatency / statBatches << " ms max " << statMaxLat << " ms" << std::endl;
+
+        statBatches = 0;
+        statBytes   = 0;
+        statLatency = 0.0f;
+        statMaxLat  = 0.0f;
+        statBusy    = {};
     }
-}
 
-void Harmony::CreatePipelines() {
-    D3D12_FEATURE_DATA_ROOT_SIGNATURE rootFeatures = {};
+    ID3D12Device*                        pDevice        = nullptr;
+    ID3D12CommandQueue*                  pQueue         = nullptr;
+    ID3D12GraphicsCommandList*           pCommandList   = nullptr;
+    ID3D12Fence*                         pFence         = nullptr;
+    ID3D12Resource*                      pStaging       = nullptr;
+    uint8_t*                             pStagingData   = nullptr;
+    HANDLE                               waitEvent      = NULL;
+
+    std::deque<Batch>                    inFlight;
+    std::vector<ID3D12CommandAllocator*> freeAllocators;
+    Batch                                recording;
+    bool                                 isRecording    = false;
+
+    UINT64                               head           = 0;
+    UINT64                               usedBytes      = 0;
+    UINT64                               nextFenceValue = 1;
+
+    UINT64                               statBatches    = 0;
+    UINT64                               statBytes      = 0;
+    float                                statLatency    = 0.0f;
+    float                                statMaxLat     = 0.0f;
+    std::chrono::steady_clock::duration  statBusy       = {};
+    std::chrono::steady_clock::time_point statStart;
+    std::chrono::steady_clock::time_point busyUntil;
+};
 
-    rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+enum class DrawPath {
+    PerObject,          // a root CBV and a draw per object
+    Instanced,          // one draw, per-instance data in a structured buffer
+    Indirect            // the GPU culls and writes the draws, one ExecuteIndirect
+};
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &rootFeatures, sizeof rootFeatures))) {
-        rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1;
+enum class CullMode {
+    Off,
+    Sphere,
+    Box,
+    Bvh                 // box test through the BoundingVolumeHierarchy
+};
+
+struct Settings
+{
+    uint32_t    objects   = 1;
+    DrawPath    drawPath  = DrawPath::Instanced;
+    CullMode    cull      = CullMode::Box;
+    bool        occlusion = false;      // frustum survivors are also tested against the nearest objects
+    bool        occlusionPyramid = false;   // against a DepthPyramid of their per pixel depth, not the masked buffer
+    bool        hiz       = false;      // depth pyramid built on the GPU, visible boxes tested against it
+    DepthPyramid::Reduction hizReduction = DepthPyramid::Reduction::Max;
+    bool        stress    = false;
+    std::string bench;
+};
+
+#pragma region ClassDecl
+
+class alignas(64) Harmony
+{
+public:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
+    static constexpr uint32_t SWAP_CHAIN_BUFFERS   = 3;
+    static constexpr uint32_t DEFAULT_CHUNK_SIZE   = 128 * 1024 * 1024;
+
+    // scheduler timelines
+    static constexpr uint32_t QUEUE_GRAPHICS       = 0;
+    static constexpr uint32_t QUEUE_COMPUTE        = 1;
+    static constexpr uint32_t QUEUE_COUNT          = 2;
+    static constexpr uint32_t TRANSFORM_GRAIN      = 1024;     // objects animated and transformed per job
+    static constexpr uint32_t MATERIAL_COUNT       = 4;        // keep in sync with materialTints (Shaders.hlsl)
+    static constexpr float    BVH_REBUILD_COST     = 1.3f;     // rebuild once refits let the SAH cost grow this much
+
+    // --occlusion: the software depth buffer, and how many of the nearest visible objects fill it
+    static constexpr uint32_t OCCLUSION_WIDTH      = 320;
+    static constexpr uint32_t OCCLUSION_HEIGHT     = 180;
+    static constexpr uint32_t MAX_OCCLUDERS        = 256;
+
+    // --hiz: first pSrvHeap descriptor of the Hi-Z views, and the pyramid read back and checked once
+    static constexpr uint32_t HIZ_DESCRIPTORS      = 64;
+    static constexpr uint64_t HIZ_VALIDATE_FRAME   = 100;
+
+    // --draw=indirect: first pSrvHeap descriptor of the CullDraws views, and the draws read back and checked once
+    static constexpr uint32_t INDIRECT_DESCRIPTORS = 96;
+    static constexpr uint64_t INDIRECT_VALIDATE_FRAME = 100;
+
+    // --stress: objects drawn start here and double every interval, up to settings.objects
+    static constexpr uint32_t STRESS_START_OBJECTS = 1024;
+    static constexpr uint32_t STRESS_INTERVAL_MS   = 2000;
+    static constexpr uint32_t STRESS_OBJECTS       = 512 * 1024;   // default --objects for --stress
+
+    bool Init(HINSTANCE inst, const Settings& appSettings);
+    void Run();
+    void Shutdown();
+    void Resize();
+
+    // false once a --hiz or --draw=indirect validation frame found the GPU results wrong
+    bool Validated() const {
+        return !validationFailed;
     }
 
-    // Graphics root signature (has 3 params for the shader)
-    {
-        D3D12_ROOT_PARAMETER rootParams[3];
+private:
+    inline uint32_t GetSizeInMB(UINT64 sizeInBytes) {
+        return (sizeInBytes >> 20) & 0xFFFFFFFF;
+    }
 
-        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-        };
+    void OpenWindow(HINSTANCE instance);
+    void CreateAdapter();
+    void CreateDevice();
+    void CreateCommandQueue();
+    void CreateSwapChain();
+    void CreateHeaps();
+    void CreateResourcesAndViews();
+    void CreatePipelines();
+    void CreateCommandLists();
+    void CreateSyncObjects();
+    void CreateUploadManager();
+    void CreateJobSystem();
+    void CreateScene();
+    void CreateFrameTiming();
+    void CreateHiZ();
+    void CreateIndirect();
+    void DownloadDataAndGenMips();
+    void StartShaderWatcher();
+
+    ID3D12PipelineState* BuildGraphicsPipeline(const std::vector<char>& vs, const std::vector<char>& ps);
+    ID3D12PipelineState* BuildComputePipeline(const std::vector<char>& cs);
+    ID3D12Resource* CreateBuffer(D3D12_HEAP_TYPE type, UINT64 size, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES state, const char* pName);
+
+    void ReloadShaders(const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange);
+    void ApplyReloadedPipelines();
+
+    void Animate(uint32_t first, uint32_t last, float time);
+    void UpdateUbo();
+    void UpdateBvh();
+    void CullOccluded(const XMFLOAT4X4& viewProj, const XMFLOAT3& eye);
+    void CullOccludedPyramid(const XMFLOAT4X4& viewProj);
+    void UpdateStress();
+    void CollectFrameTiming();
+    void CollectHiZ();
+    void CollectIndirect();
+    bool AcquireTexture();
+    bool RecordHiZCull();
+    void RecordHiZBuild();
+    bool RecordIndirectCull();
+    void RecordIndirectReadback();
+    void PopulateCommandList(bool acquireTexture);
+    void MoveToNextFrame();
+    void WaitForGpu();
+    void Render();
+
+    static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam,
+        LPARAM lParam);
+
+    DeletionQueue              delQ;
+    DeferredReleaseQueue       retireQ;
+
+    IDXGIFactory7*             pFactory7         = nullptr;
+    IDXGIAdapter1*             pAdapter1         = nullptr;
+    IDXGISwapChain4*           pSwapChain4       = nullptr;
+
+    ID3D12Device9*             pDevice9          = nullptr;
+    ID3D12CommandQueue*        pCommandQueue     = nullptr;
+    ID3D12CommandQueue*        pCopyQueue        = nullptr;
+    ID3D12CommandQueue*        pComputeQueue     = nullptr;
+
+    ID3D12DescriptorHeap*      pRtvHeap          = nullptr;
+    ID3D12DescriptorHeap*      pDsvHeap          = nullptr;
+    ID3D12DescriptorHeap*      pSrvHeap          = nullptr;
+    ID3D12DescriptorHeap*      pSmpHeap          = nullptr;
+
+    ID3D12Resource*            pRenderTargets[SWAP_CHAIN_BUFFERS] = { nullptr };
+    ID3D12CommandAllocator*    pCommandAllocators[MAX_FRAMES_IN_FLIGHT] = { nullptr };
+    ID3D12GraphicsCommandList* pCommandList      = nullptr;
+    ID3D12Fence*               pFence            = nullptr;
+    ID3D12Fence*               pComputeFence     = nullptr;
+    ID3D12Heap*                pResourceHeap     = nullptr;
+
+    ID3D12RootSignature*       pRootSignature    = nullptr;
+    ID3D12PipelineState*       pPipelineState    = nullptr;
+    ID3D12PipelineState*       pInstancedPipelineState = nullptr;
+    ID3D12PipelineState*       pIndirectPipelineState  = nullptr;
+    ID3D12CommandSignature*    pCommandSignature = nullptr;
+
+    ID3D12RootSignature*       pCsRootSignature  = nullptr;
+    ID3D12PipelineState*       pCsPipelineState  = nullptr;
+    ID3D12PipelineState*       pHiZGenPipelineState  = nullptr;
+    ID3D12PipelineState*       pHiZCullPipelineState = nullptr;
+    ID3D12PipelineState*       pCullDrawsPipelineState = nullptr;
+
+    ID3D12Resource*            pConstantBuffer   = nullptr;    // DrawPath::PerObject: settings.objects MVPs per frame slot
+    uint8_t*                   pConstantData     = nullptr;    // stays mapped
+    ID3D12Resource*            pInstanceBuffer   = nullptr;    // DrawPath::Instanced and Indirect: settings.objects InstanceData per frame slot
+    uint8_t*                   pInstanceData     = nullptr;    // stays mapped
+    ID3D12Resource*            pDepthBuffer      = nullptr;
+    ID3D12Resource*            pTexture          = nullptr;
+    ID3D12Resource*            pVertexBuffer     = nullptr;
+    ID3D12Resource*            pIndexBuffer      = nullptr;
+
+    HINSTANCE                  hInstance         = NULL;
+    HWND                       hMainWindow       = NULL;
+
+    UINT                       frameIndex        = 0;      // slot of the per-frame resources, from the scheduler
+    UINT                       backBufferIndex   = 0;
+    HANDLE                     fenceHandle       = NULL;
+    FrameScheduler             scheduler;
+
+    UploadManager              uploadManager;
+    JobSystem                  jobSystem;
+    Settings                   settings;
+
+    // the objects sit on a square grid, sceneScale pulls the camera back to fit it
+    TransformSystem            transforms;
+    float                      sceneScale        = 1.0f;
+    uint32_t                   activeObjects     = 0;       // the first activeObjects are animated and culled
+    std::chrono::steady_clock::time_point stressStart;
+
+    // bounds of the pyramid mesh, the visible list of this frame and how much of it is used
+    CullingSystem              culling;
+    BoundingVolumeHierarchy    bvh;
+    XMFLOAT3                   meshCenter        = {};
+    XMFLOAT3                   meshExtent        = {};
+    std::vector<uint32_t>      visibleList;
+    uint32_t                   visibleObjects    = 0;
+
+    // --occlusion: occluders of this frame and their MVPs
+    OcclusionCuller            occlusion;
+    std::vector<uint32_t>      occluders;
+    std::vector<XMFLOAT4X4>    occluderMvps;
+
+    // --occlusion=pyramid: the occluders' per pixel depth, its pyramid, and what testing against it found
+    std::vector<float>         occlusionDepth;
+    DepthPyramid               occlusionPyramid;
+    uint64_t                   pyramidStatFrames = 0;
+    uint64_t                   pyramidStatTested = 0;
+    uint64_t                   pyramidStatKept   = 0;
+    float                      pyramidStatMs     = 0.0f;   // depth, pyramid and box tests
+    std::chrono::steady_clock::time_point pyramidStatStart = std::chrono::steady_clock::now();
+
+    // --hiz: pyramid of the last frame's depth, and per frame slot the visible boxes CullHiZ tests
+    // against it and what it found, counts only; with --draw=indirect CullDraws tests against it instead
+    ID3D12Resource*            pHiZPyramid       = nullptr;
+    ID3D12Resource*            pHiZScratch       = nullptr;    // GenHiZ: finished groups, then level 5 and coarser
+    ID3D12Resource*            pHiZBoxes         = nullptr;    // upload: a zero header, then settings.objects HiZBox per slot
+    HiZBox*                    pHiZBoxData       = nullptr;    // stays mapped
+    ID3D12Resource*            pHiZResults       = nullptr;    // visible count, then a flag per box, per slot
+    ID3D12Resource*            pHiZReadback      = nullptr;    // visible count per slot
+    ID3D12Resource*            pHiZValidation    = nullptr;    // depth and pyramid of HIZ_VALIDATE_FRAME
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT hizFootprints[1 + DepthPyramid::MAX_LEVELS] = {};    // depth, then the levels
+    D3D12_GPU_DESCRIPTOR_HANDLE hizGenSrv        = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE hizGenUavs       = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE hizCullSrvs[MAX_FRAMES_IN_FLIGHT] = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE hizCullUavs[MAX_FRAMES_IN_FLIGHT] = {};
+    XMFLOAT4X4                 hizViewProj       = {};     // this frame's
+    XMFLOAT4X4                 hizPyramidViewProj = {};    // the one the pyramid's depth was drawn with
+    uint32_t                   hizLevels         = 0;
+    uint32_t                   hizGroupsX        = 0;
+    uint32_t                   hizGroupsY        = 0;
+    uint32_t                   hizTested[MAX_FRAMES_IN_FLIGHT] = { 0 };
+    uint64_t                   hizBuilt          = 0;      // pyramids built
+    UINT                       hizValidateSlot   = UINT(-1);
+    uint64_t                   hizStatTested     = 0;
+    uint64_t                   hizStatVisible    = 0;
+    std::chrono::steady_clock::time_point hizStatStart = std::chrono::steady_clock::now();
+
+    // --draw=indirect: per frame slot the boxes of every active object, and the commands, instance
+    // slots and counts CullDraws makes of them
+    ID3D12Resource*            pDrawBoxes        = nullptr;    // upload: a zero header, then settings.objects HiZBox per slot
+    HiZBox*                    pDrawBoxData      = nullptr;    // stays mapped
+    ID3D12Resource*            pDrawCommands     = nullptr;    // IndirectDraws::MaxCommands(settings.objects) per slot
+    ID3D12Resource*            pDrawInstances    = nullptr;    // settings.objects object indices per slot
+    ID3D12Resource*            pDrawCounts       = nullptr;    // commands, then visible objects, per slot
+    ID3D12Resource*            pDrawReadback     = nullptr;    // the counts of each slot
+    ID3D12Resource*            pDrawValidation   = nullptr;    // commands and instance slots of INDIRECT_VALIDATE_FRAME
+    D3D12_GPU_DESCRIPTOR_HANDLE drawSrvs[MAX_FRAMES_IN_FLIGHT] = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE drawUavs[MAX_FRAMES_IN_FLIGHT] = {};
+    Frustum                    drawFrustum       = {};     // this frame's
+    uint32_t                   drawMaxCommands   = 0;      // per slot
+    uint32_t                   drawTested[MAX_FRAMES_IN_FLIGHT] = { 0 };    // objects CullDraws tested, 0: nothing drawn
+    uint64_t                   drawFrames        = 0;      // frames culled by CullDraws
+    UINT                       drawValidateSlot  = UINT(-1);
+    bool                       drawValidateHiZ   = false;  // the validated frame also tested the pyramid
+    std::vector<IndirectDraws::Command> drawReference;     // CPU commands and instance slots of that frame
+    std::vector<uint32_t>      drawReferenceInstances;
+    uint32_t                   drawReferenceCommands = 0;
+    uint64_t                   drawStatFrames    = 0;
+    uint64_t                   drawStatCommands  = 0;
+    uint64_t                   drawStatVisible   = 0;
+    uint64_t                   drawStatTested    = 0;
+    std::chrono::steady_clock::time_point drawStatStart = std::chrono::steady_clock::now();
+
+    bool                       validationFailed  = false;
+
+    // two timestamps around the draws per frame slot, and the objects that frame drew
+    ID3D12QueryHeap*           pTimestampHeap    = nullptr;
+    ID3D12Resource*            pTimestampReadback = nullptr;
+    UINT64                     gpuTimestampFrequency = 0;
+    uint32_t                   frameObjects[MAX_FRAMES_IN_FLIGHT] = { 0 };
+    InstanceStats              instanceStats;
+
+    DeletionQueue              initQ;                   // upload/mipgen objects, released once the texture is acquired
+    UINT64                     mipsReadyValue    = 0;   // QUEUE_COMPUTE value at which the mip chain is complete
+    bool                       textureAcquired   = false;
+
+    UINT                       rtvDescriptorSize = 0;
+    UINT                       dsvDescriptorSize = 0;
+    UINT                       srvDescriptorSize = 0;
+    UINT                       smpDescriptorSize = 0;
+
+    D3D_FEATURE_LEVEL          featureLevel      = D3D_FEATURE_LEVEL_12_2;
+    D3D12_VIEWPORT             viewport;
+    D3D12_RECT                 scissorRect;
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS featureDataOpts;
+
+    ShaderWatcher              shaderWatcher;
+    ComPtr<IDxcUtils>          dxcUtils;
+    ComPtr<IDxcCompiler3>      dxcCompiler;
+    ComPtr<IDxcIncludeHandler> dxcIncludeHandler;
+
+    // entry point -> last good bytecode (only touched by the watcher thread after Init)
+    std::map<std::wstring, std::vector<char>> shaderBytecode;
+
+    // pipelines compiled on the watcher thread, swapped in at the next frame boundary
+    std::mutex                 reloadMutex;
+    std::vector<std::pair<ID3D12PipelineState**, ID3D12PipelineState*>> reloadedPipelines;
+
+#ifdef _DEBUG
+    static inline const bool enableDebugLayers = true;
+#else
+    static inline const bool enableDebugLayers = false;
+#endif
+};
+
+#pragma endregion
+
+#pragma region Public Interface
+
+bool Harmony::Init(HINSTANCE inst, const Settings& appSettings) {
+    hInstance = inst;
+    settings  = appSettings;
+
+    try {
+        OpenWindow(hInstance);
+
+        CreateAdapter();
+
+        CreateDevice();
+
+        CreateCommandQueue();
+
+        CreateSwapChain();
+
+        CreateHeaps();
+
+        CreateResourcesAndViews();
+
+        CreatePipelines();
+
+        CreateCommandLists();
+
+        CreateSyncObjects();
+
+        CreateUploadManager();
+
+        CreateJobSystem();
+
+        CreateScene();
+
+        CreateFrameTiming();
+
+        CreateHiZ();
+
+        CreateIndirect();
+
+        DownloadDataAndGenMips();
+
+        StartShaderWatcher();
+    }
+    catch (std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void Harmony::Run() {
+    for (;;) {
+        MSG msg;
+
+        while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        if (msg.message == WM_QUIT) {
+            break;
+        }
+
+        Render();
+    }
+}
+
+void Harmony::Shutdown() {
+    shaderWatcher.Stop();
+
+    // the mip generation too, if the texture was never acquired
+    WaitForGpu();
+
+    instanceStats.Report(true);
+
+    if (!textureAcquired) {
+        initQ.Finalize();
+    }
+
+    for (auto& [slot, pso] : reloadedPipelines) {
+        pso->Release();
+    }
+    reloadedPipelines.clear();
+
+    retireQ.Finalize();
+    delQ.Finalize();
+}
+
+void Harmony::Resize() {
+    //TODO:
+}
+
+#pragma endregion
+
+#pragma region Init Calls
+
+void Harmony::OpenWindow(HINSTANCE instance) {
+    WNDCLASSEX wcex{
+       sizeof(WNDCLASSEX),
+       CS_HREDRAW | CS_VREDRAW,
+       WndProc,
+       0,
+       0,
+       instance,
+       LoadIcon(instance, IDI_APPLICATION),
+       LoadCursor(instance, IDC_ARROW),
+       (HBRUSH)GetStockObject(BLACK_BRUSH),
+       NULL,
+       APPLICATION_NAME,
+       LoadIcon(instance, IDI_APPLICATION)
+    };
+
+    if (!RegisterClassEx(&wcex)) {
+        throw std::runtime_error("Could not register class!");
+    }
+
+    int screenWidth  = GetSystemMetrics(SM_CXSCREEN);
+    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+
+    int windowX = screenWidth / 2 - WINDOW_WIDTH / 2;
+    int windowY = screenHeight / 2 - WINDOW_HEIGHT / 2;
+
+    hMainWindow = CreateWindowEx(
+        WS_EX_OVERLAPPEDWINDOW, APPLICATION_NAME, APPLICATION_NAME,
+        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
+        windowX, windowY, WINDOW_WIDTH, WINDOW_HEIGHT,
+        NULL,
+        NULL,
+        instance,
+        NULL);
+
+    if (!hMainWindow) {
+        throw std::runtime_error("Could not create main window!");
+    }
+
+    ShowWindow(hMainWindow, SW_SHOW);
+    UpdateWindow(hMainWindow);
+    SetForegroundWindow(hMainWindow);
+    SetFocus(hMainWindow);
+
+    SetWindowLongPtr(hMainWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+    delQ.Append(
+        [ cHwnd = hMainWindow] {
+            DestroyWindow(cHwnd);
+        }
+    );
+}
+
+void Harmony::CreateAdapter() {
+    UINT dxgiFactoryFlags = 0;
+
+    if constexpr (enableDebugLayers) {
+        ComPtr<ID3D12Debug> debugController;
+
+        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
+            debugController->EnableDebugLayer();
+
+            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+        }
+    }
+
+    ComPtr<IDXGIFactory> factory;
+    if (FAILED(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)))) {
+        throw std::runtime_error("Could not create DXGI factory!");
+    }
+
+    ComPtr<IDXGIAdapter1> adapter1;
+    ComPtr<IDXGIFactory7> factory7;
+    if (SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&factory7)))) {
+        UINT adapterIndex = 0;
+
+        for (; SUCCEEDED(factory7->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter1))); ++adapterIndex)
+        {
+            DXGI_ADAPTER_DESC1 desc;
+            adapter1->GetDesc1(&desc);
+
+            if (desc.Flags & DXGI_ADAPTER_FLAG::DXGI_ADAPTER_FLAG_SOFTWARE) {
+                continue;
+            }
+
+            if (SUCCEEDED(D3D12CreateDevice(adapter1.Get(), featureLevel, __uuidof(ID3D12Device), nullptr))) {
+                break;
+            }
+        }
+    }
+
+    if (!adapter1.Get()) {
+        throw std::runtime_error("Could not find GPU HW adapter!");
+    }
+
+    pFactory7 = factory7.Detach();
+    pAdapter1 = adapter1.Detach();
+
+    delQ.Append([cFactory = pFactory7, cAdapter = pAdapter1] {
+        cAdapter->Release();
+        cFactory->Release();
+    });
+
+    DXGI_ADAPTER_DESC1 adDesc = {};
+    pAdapter1->GetDesc1(&adDesc);
+
+    std::wcout << "Running on: " << adDesc.Description << std::endl;
+    std::wcout << "     Video  Mem: " << GetSizeInMB(adDesc.DedicatedVideoMemory)  << "MB" << std::endl;
+    std::wcout << "     System Mem: " << GetSizeInMB(adDesc.DedicatedSystemMemory) << "MB" << std::endl;
+    std::wcout << "     Shared Mem: " << GetSizeInMB(adDesc.SharedSystemMemory)    << "MB" << std::endl;
+}
+
+void Harmony::CreateDevice() {
+    ComPtr<ID3D12Device9> device;
+
+    if (FAILED(D3D12CreateDevice(pAdapter1, featureLevel, IID_PPV_ARGS(&device)))) {
+        throw std::runtime_error("Could not create ID3D12Device9 device!");
+    }
+
+    pDevice9 = device.Detach();
+
+    delQ.Append([cDevice = pDevice9] {
+        cDevice->Release();
+    });
+
+    // Query feature 
+    pDevice9->CheckFeatureSupport(D3D12_FEATURE::D3D12_FEATURE_D3D12_OPTIONS, &featureDataOpts, sizeof featureDataOpts);
+    if (featureDataOpts.ResourceHeapTier != D3D12_RESOURCE_HEAP_TIER_2) {
+        std::cout << "Resource heap Tier is not Tier 2!" << std::endl;
+    }
+
+    D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_5 };
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel)))
+        || (shaderModel.HighestShaderModel < D3D_SHADER_MODEL_6_5)) {
+        throw std::runtime_error("Shader Model 6.5 is not supported!");
+    }
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS7 features = {};
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &features, sizeof(features)))
+        || (features.MeshShaderTier == D3D12_MESH_SHADER_TIER_NOT_SUPPORTED)) {
+        throw std::exception("Mesh Shaders aren't supported!");
+    }
+}
+
+void Harmony::CreateCommandQueue() {
+    ComPtr<ID3D12CommandQueue> cmdQueue;
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_DIRECT,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create graphics command queue");
+        }
+
+        pCommandQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pCommandQueue] {
+            cCommandQueue->Release();
+        });
+    }
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_COPY,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create copy command queue");
+        }
+
+        pCopyQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pCopyQueue] {
+            cCommandQueue->Release();
+        });
+    }
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_COMPUTE,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create compute command queue");
+        }
+
+        pComputeQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pComputeQueue] {
+            cCommandQueue->Release();
+        });
+    }
+}
+
+void Harmony::CreateSwapChain() {
+    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = { 0 };
+
+    swapChainDesc.BufferCount = SWAP_CHAIN_BUFFERS;
+    swapChainDesc.Width       = WINDOW_WIDTH;
+    swapChainDesc.Height      = WINDOW_HEIGHT;
+    swapChainDesc.Format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.SwapEffect  = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+
+    swapChainDesc.SampleDesc.Count   = 1;
+    swapChainDesc.SampleDesc.Quality = 0;
+
+    ComPtr<IDXGISwapChain1> swapChain;
+    
+    if (FAILED(pFactory7->CreateSwapChainForHwnd(pCommandQueue, hMainWindow, &swapChainDesc, nullptr, nullptr, &swapChain))) {
+        throw std::runtime_error("Could not create swap chain!");
+    }
+
+    if (FAILED(pFactory7->MakeWindowAssociation(hMainWindow, DXGI_MWA_NO_ALT_ENTER))) {
+        throw std::runtime_error("Could not associate swap chain with hWnd!");
+    }
+
+    swapChain->QueryInterface(&pSwapChain4);
+    if (!pSwapChain4) {
+        throw std::runtime_error("Could not get SwapChain4 interface!");
+    }
+
+    backBufferIndex = pSwapChain4->GetCurrentBackBufferIndex();
+
+    delQ.Append([cSwapChain = pSwapChain4 ] {
+        cSwapChain->Release();
+    });
+
+    viewport    = D3D12_VIEWPORT{ .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = WINDOW_WIDTH, .Height = WINDOW_HEIGHT, .MinDepth = D3D12_MIN_DEPTH, .MaxDepth = D3D12_MAX_DEPTH };
+    scissorRect = D3D12_RECT{ .left = 0, .top = 0, .right = WINDOW_WIDTH, .bottom = WINDOW_HEIGHT };
+}
+
+void Harmony::CreateHeaps() {
+    ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+            .NumDescriptors = SWAP_CHAIN_BUFFERS,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create RTV heap!");
+        }
+
+        rtvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        pRtvHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pRtvHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+            .NumDescriptors = 1,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create DSV heap!");
+        }
+
+        dsvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+        pDsvHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pDsvHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+            .NumDescriptors = 128, // sufficiently large to hold mipgen SRV and UAV chain
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        }
+
+        srvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        pSrvHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pSrvHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC smpHeapDesc {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+            .NumDescriptors = 8,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&smpHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        }
+
+        smpDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+        pSmpHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pSmpHeap] {
+            cHeap->Release();
+        });
+    }
+
+    auto AllocateHeap = [cDevice = pDevice9](UINT64 chunkSize, D3D12_HEAP_TYPE type) -> ID3D12Heap* {
+        D3D12_HEAP_PROPERTIES hProps = cDevice->GetCustomHeapProperties(0, type);
+
+        D3D12_HEAP_DESC heapDesc {
+            .SizeInBytes = chunkSize,
+            .Properties = {.Type = type, .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN, .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN, .CreationNodeMask = hProps.CreationNodeMask , .VisibleNodeMask = hProps.VisibleNodeMask },
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Flags      = D3D12_HEAP_FLAG_NONE
+        };
+
+        ComPtr<ID3D12Heap> memHeap;
+        if (FAILED(cDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&memHeap)))) {
+            throw std::runtime_error("Could not create default memory heap!");
+        }
+
+        return memHeap.Detach();
+    };
+
+    pResourceHeap = AllocateHeap(DEFAULT_CHUNK_SIZE, D3D12_HEAP_TYPE_DEFAULT);
+    
+    delQ.Append([cHeap = pResourceHeap] {
+        cHeap->Release();
+    });
+}
+
+void Harmony::CreateResourcesAndViews() {
+    UINT64 defaultHeapOffset = 0;
+
+    {
+        D3D12_RESOURCE_DESC cbDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = sizeof(UniformBuffer) * (settings.drawPath == DrawPath::PerObject ? settings.objects : 1) * MAX_FRAMES_IN_FLIGHT,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_HEAP_PROPERTIES uploadHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &cbDesc);
+        if (resInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+            cbDesc.Alignment = resInfo.Alignment;
+        }
+
+        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pConstantBuffer)))) {
+            throw std::runtime_error("Could not create constant buffer!");
+        }
+
+        delQ.Append([cbuff = pConstantBuffer] {
+            cbuff->Release();
+        });
+
+        // the transforms write it every frame, no point in mapping it every frame
+        D3D12_RANGE noRead { 0, 0 };
+        if (FAILED(pConstantBuffer->Map(0, &noRead, reinterpret_cast<void**>(&pConstantData)))) {
+            throw std::runtime_error("Could not map CB!");
+        }
+    }
+
+    // Instance data, read by VsInstanced and VsIndirect straight from the upload heap
+    if (settings.drawPath != DrawPath::PerObject) {
+        D3D12_RESOURCE_DESC bufferDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = UINT64(sizeof(InstanceData)) * settings.objects * MAX_FRAMES_IN_FLIGHT,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_HEAP_PROPERTIES uploadHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pInstanceBuffer)))) {
+            throw std::runtime_error("Could not create instance buffer!");
+        }
+
+        delQ.Append([cbuff = pInstanceBuffer] {
+            cbuff->Release();
+        });
+
+        D3D12_RANGE noRead { 0, 0 };
+        if (FAILED(pInstanceBuffer->Map(0, &noRead, reinterpret_cast<void**>(&pInstanceData)))) {
+            throw std::runtime_error("Could not map instance buffer!");
+        }
+    }
+    
+    {
+        D3D12_CLEAR_VALUE dsVal {
+            .Format = DXGI_FORMAT_D32_FLOAT,
+            .Color = { 1.0f, 1.0f, 1.0f, 1.0f }
+        };
+
+        D3D12_RESOURCE_DESC depthDesc {
+            .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width     = WINDOW_WIDTH,
+            .Height    = WINDOW_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels = 1,
+            .Format = DXGI_FORMAT_R32_TYPELESS,     // D32_FLOAT to draw, R32_FLOAT for GenHiZ to read
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags  = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &depthDesc);
+        
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &depthDesc, D3D12_RESOURCE_STATE_COMMON, &dsVal, IID_PPV_ARGS(&pDepthBuffer)))) {
+            throw std::runtime_error("Could not create depth buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pDepthBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    {
+        D3D12_CLEAR_VALUE texVal {
+            .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .Color = { 0.0f, 0.0f, 0.0f, 0.0f }
+        };
+
+        D3D12_RESOURCE_DESC texDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = TEXTURE_WIDTH,
+            .Height     = TEXTURE_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
+            .Format     = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE,
+            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &texDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &texDesc, D3D12_RESOURCE_STATE_COMMON, &texVal, IID_PPV_ARGS(&pTexture)))) {
+            throw std::runtime_error("Could not create texture!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
+            .Format                  = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Texture2D = {
+                .MostDetailedMip     = 0,
+                .MipLevels           = texDesc.MipLevels,
+                .PlaneSlice          = 0,
+                .ResourceMinLODClamp = 5.0f
+            }
+        };
+
+        pDevice9->CreateShaderResourceView(pTexture, &srvDesc, pSrvHeap->GetCPUDescriptorHandleForHeapStart());
+
+        delQ.Append([ctex = pTexture] {
+            ctex->Release();
+        });
+    }
+
+    {
+        D3D12_SAMPLER_DESC smpDesc {
+            .Filter         = D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT,
+            .AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .MipLODBias     = 0.0f,
+            .MaxAnisotropy  = 0,
+            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
+            .BorderColor    = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK,
+            .MinLOD         = 0.0f,
+            .MaxLOD         = D3D12_FLOAT32_MAX 
+        };
+
+        pDevice9->CreateSampler(&smpDesc, pSmpHeap->GetCPUDescriptorHandleForHeapStart());
+    }
+
+    {
+        D3D12_RESOURCE_DESC vbDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = sizeof(vertices),
+            .Height     = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &vbDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &vbDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pVertexBuffer)))) {
+            throw std::runtime_error("Could not create vertex buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pVertexBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    {
+        D3D12_RESOURCE_DESC ibDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = sizeof(indices),
+            .Height     = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &ibDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &ibDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pIndexBuffer)))) {
+            throw std::runtime_error("Could not create index buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pIndexBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = pRtvHeap->GetCPUDescriptorHandleForHeapStart();
+
+        for (UINT i = 0; i < SWAP_CHAIN_BUFFERS; ++i) {
+            if (FAILED(pSwapChain4->GetBuffer(i, IID_PPV_ARGS(&pRenderTargets[i])))) {
+                throw std::runtime_error("Could not Get swap chain buffer!");
+            }
+
+            pDevice9->CreateRenderTargetView(pRenderTargets[i], nullptr, rtvHandle);
+            rtvHandle.ptr += rtvDescriptorSize;
+        }
+    }
+
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsViewDesc {
+            .Format        = DXGI_FORMAT_D32_FLOAT,
+            .ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D,
+            .Flags         = D3D12_DSV_FLAG_NONE,
+            .Texture2D     = { 0 }
+        };
+
+        D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+
+        pDevice9->CreateDepthStencilView(pDepthBuffer, &dsViewDesc, dsvHandle);
+    }
+}
+
+void Harmony::CreatePipelines() {
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE rootFeatures = {};
+
+    rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &rootFeatures, sizeof rootFeatures))) {
+        rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1;
+    }
+
+    // Graphics root signature (has 6 params for the shader)
+    {
+        D3D12_ROOT_PARAMETER rootParams[6];
+
+        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+        };
+
+        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_CBV;
+        rootParams[0].Descriptor.ShaderRegister           = 0;
+        rootParams[0].Descriptor.RegisterSpace            = 0;
+        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[1];
+        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[2];
+        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // instance data of VsInstanced (t1)
+        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        rootParams[3].Descriptor.ShaderRegister           = 1;
+        rootParams[3].Descriptor.RegisterSpace            = 0;
+        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        // VsIndirect: first instance slot of the draw (b1), set by each command, and the slots (t2)
+        rootParams[4].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParams[4].Constants.ShaderRegister            = 1;
+        rootParams[4].Constants.RegisterSpace             = 0;
+        rootParams[4].Constants.Num32BitValues            = 1;
+        rootParams[4].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        rootParams[5].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_SRV;
+        rootParams[5].Descriptor.ShaderRegister           = 2;
+        rootParams[5].Descriptor.RegisterSpace            = 0;
+        rootParams[5].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        D3D12_ROOT_SIGNATURE_DESC rDesc {
+            .NumParameters     = 6,
+            .pParameters       = rootParams,
+            .NumStaticSamplers = 0,
+            .pStaticSamplers   = nullptr,
+            .Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
+        };
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> errBlob;
+
+        // FIXME: Root signature version 1_1 not working
+        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
+            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
+        }
+
+        ComPtr<ID3D12RootSignature> rs;
+        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rs)))) {
+            throw std::runtime_error("Could not create root signature!");
+        }
+
+        pRootSignature = rs.Detach();
+        delQ.Append([cRootSignature = pRootSignature] {
+            cRootSignature->Release();
+        });
+    }
+
+    // Graphics pipelines
+    {
+        std::vector<char>           vs, vsInstanced, ps;
+        
+        UINT compileFlags = 0;
+
+        if constexpr (enableDebugLayers) {
+            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        }
+
+        //load VS
+        {
+            std::ifstream file("shaders/vs.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load vs.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            vs.resize((size_t)filesize);
+            file.read(vs.data(), filesize);
+        }
+
+        // load instanced VS
+        {
+            std::ifstream file("shaders/vsinstanced.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load vsinstanced.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            vsInstanced.resize((size_t)filesize);
+            file.read(vsInstanced.data(), filesize);
+        }
+
+        // load PS
+        {
+            std::ifstream file("shaders/ps.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load ps.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            ps.resize((size_t)filesize);
+            file.read(ps.data(), filesize);
+        }
+
+        pPipelineState          = BuildGraphicsPipeline(vs, ps);
+        pInstancedPipelineState = BuildGraphicsPipeline(vsInstanced, ps);
+
+        shaderBytecode[L"VsMain"]      = std::move(vs);
+        shaderBytecode[L"VsInstanced"] = std::move(vsInstanced);
+        shaderBytecode[L"PsMain"]      = std::move(ps);
+
+        delQ.Append([&cPipelineState = pPipelineState] {
+            cPipelineState->Release();
+            });
+
+        delQ.Append([&cPipelineState = pInstancedPipelineState] {
+            cPipelineState->Release();
+        });
+    }
+
+    // Compute root signature (has 3 tables and root constants); GenHiZ, CullHiZ and CullDraws use the wider ranges and constants
+    {
+        D3D12_ROOT_PARAMETER rootParams[4];
+
+        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 2,  .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 17, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+        };
+
+        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParams[0].Constants.ShaderRegister            = 0;
+        rootParams[0].Constants.RegisterSpace             = 0;
+        rootParams[0].Constants.Num32BitValues            = 48;
+        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[0];
+        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[1];
+        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[2];
+        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        D3D12_ROOT_SIGNATURE_DESC rDesc {
+            .NumParameters     = 4,
+            .pParameters       = rootParams,
+            .NumStaticSamplers = 0,
+            .pStaticSamplers   = nullptr,
+            .Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE
+        };
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> errBlob;
+
+        // FIXME: Root signature version 1_1 not working
+        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
+            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
+        }
+
+        ComPtr<ID3D12RootSignature> cs;
+        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&cs)))) {
+            throw std::runtime_error("Could not create root signature!");
+        }
+
+        pCsRootSignature = cs.Detach();
+        delQ.Append([cRootSignature = pCsRootSignature] {
+            cRootSignature->Release();
+        });
+    }
+
+    // Compute pipeline
+    {
+        std::vector<char>           cs;
+
+        UINT compileFlags = 0;
+
+        if constexpr (enableDebugLayers) {
+            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        }
+
+        //load CS
+        {
+            std::ifstream file("shaders/mipgen.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load mipgen.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            cs.resize((size_t)filesize);
+            file.read(cs.data(), filesize);
+        }
+
+        pCsPipelineState = BuildComputePipeline(cs);
+
+        shaderBytecode[L"GenMips"] = std::move(cs);
+
+        delQ.Append([&cPipelineState = pCsPipelineState] {
+            cPipelineState->Release();
+        });
+    }
+
+    // Hi-Z pipelines
+    if (settings.hiz) {
+        std::vector<char>           genCs, cullCs;
+
+        //load GenHiZ
+        {
+            std::ifstream file("shaders/genhiz.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load genhiz.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            genCs.resize((size_t)filesize);
+            file.read(genCs.data(), filesize);
+        }
+
+        //load CullHiZ
+        {
+            std::ifstream file("shaders/cullhiz.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load cullhiz.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            cullCs.resize((size_t)filesize);
+            file.read(cullCs.data(), filesize);
+        }
+
+        pHiZGenPipelineState  = BuildComputePipeline(genCs);
+        pHiZCullPipelineState = BuildComputePipeline(cullCs);
+
+        shaderBytecode[L"GenHiZ"]  = std::move(genCs);
+        shaderBytecode[L"CullHiZ"] = std::move(cullCs);
+
+        delQ.Append([&cPipelineState = pHiZGenPipelineState] {
+            cPipelineState->Release();
+        });
+
+        delQ.Append([&cPipelineState = pHiZCullPipelineState] {
+            cPipelineState->Release();
+        });
+    }
+
+    // Indirect pipelines, and the command signature of IndirectDraws::Command
+    if (settings.drawPath == DrawPath::Indirect) {
+        std::vector<char>           vsIndirect, cullCs;
+
+        // load indirect VS
+        {
+            std::ifstream file("shaders/vsindirect.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load vsindirect.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            vsIndirect.resize((size_t)filesize);
+            file.read(vsIndirect.data(), filesize);
+        }
+
+        //load CullDraws
+        {
+            std::ifstream file("shaders/culldraws.bin", std::ios::in | std::ios::binary);
+            if (!file) {
+                throw std::runtime_error("Could not load culldraws.bin!");
+            }
+
+            file.seekg(0, std::ios_base::end);
+            std::streampos filesize = file.tellg();
+            file.seekg(0, std::ios_base::beg);
+
+            cullCs.resize((size_t)filesize);
+            file.read(cullCs.data(), filesize);
+        }
+
+        pIndirectPipelineState  = BuildGraphicsPipeline(vsIndirect, shaderBytecode[L"PsMain"]);
+        pCullDrawsPipelineState = BuildComputePipeline(cullCs);
+
+        shaderBytecode[L"VsIndirect"] = std::move(vsIndirect);
+        shaderBytecode[L"CullDraws"]  = std::move(cullCs);
+
+        delQ.Append([&cPipelineState = pIndirectPipelineState] {
+            cPipelineState->Release();
+        });
+
+        delQ.Append([&cPipelineState = pCullDrawsPipelineState] {
+            cPipelineState->Release();
+        });
+
+        // the root constant first (firstInstance of VsIndirect), then the draw
+        static_assert(sizeof(IndirectDraws::Command) == sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+        static_assert(offsetof(IndirectDraws::Command, draw) == sizeof(UINT));
+
+        D3D12_INDIRECT_ARGUMENT_DESC arguments[2] = {
+            { .Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT, .Constant = { .RootParameterIndex = 4, .DestOffsetIn32BitValues = 0, .Num32BitValuesToSet = 1 } },
+            { .Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED },
+        };
+
+        D3D12_COMMAND_SIGNATURE_DESC signatureDesc {
+            .ByteStride       = sizeof(IndirectDraws::Command),
+            .NumArgumentDescs = UINT(std::size(arguments)),
+            .pArgumentDescs   = arguments,
+            .NodeMask         = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandSignature(&signatureDesc, pRootSignature, IID_PPV_ARGS(&pCommandSignature)))) {
+            throw std::runtime_error("Could not create command signature!");
+        }
+
+        delQ.Append([cSignature = pCommandSignature] {
+            cSignature->Release();
+        });
+    }
+}
+
+ID3D12PipelineState* Harmony::BuildGraphicsPipeline(const std::vector<char>& vs, const std::vector<char>& ps) {
+    ComPtr<ID3D12PipelineState> pso;
+
+    D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        { "COLOR",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    };
+
+    D3D12_BLEND_DESC blendDesc {
+        .AlphaToCoverageEnable  = FALSE,
+        .IndependentBlendEnable = FALSE
+    };
+
+    for (UINT i = 0; i < 8; ++i) {
+        blendDesc.RenderTarget[i] = {
+            FALSE,FALSE,
+            D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+            D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+            D3D12_LOGIC_OP_NOOP,
+            D3D12_COLOR_WRITE_ENABLE_ALL,
+        };
+    }
+
+    D3D12_RASTERIZER_DESC rastDesc {
+        .FillMode               = D3D12_FILL_MODE_SOLID,
+        .CullMode               = D3D12_CULL_MODE_BACK,
+        .FrontCounterClockwise  = FALSE,
+        .DepthBias              = 0,
+        .DepthBiasClamp         = 0.0f,
+        .SlopeScaledDepthBias   = 0.0f,
+        .DepthClipEnable        = FALSE,
+        .MultisampleEnable      = FALSE,
+        .AntialiasedLineEnable  = FALSE,
+        .ForcedSampleCount      = 0,
+        .ConservativeRaster     = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
+    };
+
+    D3D12_DEPTH_STENCILOP_DESC defaultStencilOp {
+        .StencilFailOp      = D3D12_STENCIL_OP_KEEP,
+        .StencilDepthFailOp = D3D12_STENCIL_OP_KEEP,
+        .StencilPassOp      = D3D12_STENCIL_OP_KEEP,
+        .StencilFunc        = D3D12_COMPARISON_FUNC_ALWAYS
+    };
+
+    D3D12_DEPTH_STENCIL_DESC dsDesc {
+        .DepthEnable      = TRUE,
+        .DepthWriteMask   = D3D12_DEPTH_WRITE_MASK_ALL,
+        .DepthFunc        = D3D12_COMPARISON_FUNC_LESS_EQUAL,
+        .StencilEnable    = FALSE,
+        .StencilReadMask  = 0,
+        .StencilWriteMask = 0,
+        .FrontFace        = defaultStencilOp,
+        .BackFace         = defaultStencilOp
+    };
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc {
+        .pRootSignature        = pRootSignature,
+        .VS                    = { .pShaderBytecode = vs.data(), .BytecodeLength = vs.size() },
+        .PS                    = { .pShaderBytecode = ps.data(), .BytecodeLength = ps.size() },
+        .BlendState            = blendDesc,
+        .SampleMask            = D3D12_DEFAULT_SAMPLE_MASK,
+        .RasterizerState       = rastDesc,
+        .DepthStencilState     = dsDesc,
+        .InputLayout           = { .pInputElementDescs = inputElementDesc, .NumElements = 3 },
+        .IBStripCutValue       = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED,
+        .PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
+        .NumRenderTargets      = 1,
+        .RTVFormats            = { DXGI_FORMAT_R8G8B8A8_UNORM },
+        .DSVFormat             = DXGI_FORMAT_D32_FLOAT,
+        .SampleDesc            = { .Count = 1, .Quality = 0 },
+        .NodeMask              = 0,
+        .CachedPSO             = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
+        .Flags                 = D3D12_PIPELINE_STATE_FLAG_NONE
+    };
+
+    if(FAILED(pDevice9->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
+        throw std::runtime_error("Could not create pipeline state object!");
+    }
+
+    return pso.Detach();
+}
+
+ID3D12PipelineState* Harmony::BuildComputePipeline(const std::vector<char>& cs) {
+    ComPtr<ID3D12PipelineState> pso;
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc {
+        .pRootSignature = pCsRootSignature,
+        .CS             = { .pShaderBytecode = cs.data(), .BytecodeLength = cs.size() },
+        .NodeMask       = 0,
+        .CachedPSO      = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
+        .Flags          = D3D12_PIPELINE_STATE_FLAG_NONE
+    };
+
+    if(FAILED(pDevice9->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
+        throw std::runtime_error("Could not create compute pipeline state object!");
+    }
+
+    return pso.Detach();
+}
+
+void Harmony::CreateCommandLists() {
+    for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        if (FAILED(pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&pCommandAllocators[i])))) {
+            throw std::runtime_error("Could not allocate command allocator!");
+        }
+    }
+
+    ComPtr<ID3D12GraphicsCommandList> cmdList;
+    if (FAILED(pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocators[0], nullptr, IID_PPV_ARGS(&cmdList)))) {
+        throw std::runtime_error("Could not create command list!");
+    }
+
+    pCommandList = cmdList.Detach();
+    pCommandList->Close();
+
+    delQ.Append([cCommandList = pCommandList, cCommandAllocators = pCommandAllocators] {
+        cCommandList->Release();
+
+        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            cCommandAllocators[i]->Release();
+        }
+    });
+}
+
+void Harmony::CreateSyncObjects() {
+    ComPtr<ID3D12Fence> fence;
+
+    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+        throw std::runtime_error("Could not create fence!");
+    }
+
+    fenceHandle = CreateEventA(nullptr, FALSE, FALSE, "gpuFence");
+    if (!fenceHandle) {
+        throw std::runtime_error("Could not create fence event!");
+    }
+
+    pFence = fence.Detach();
+
+    delQ.Append([cEvent = fenceHandle, cFence = pFence] {
+        cFence->Release();
+        CloseHandle(cEvent);
+    });
+
+    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+        throw std::runtime_error("Could not create compute fence!");
+    }
+
+    pComputeFence = fence.Detach();
+
+    delQ.Append([cFence = pComputeFence] {
+        cFence->Release();
+    });
+
+    auto queueFence = [this](uint32_t queue) {
+        return queue == QUEUE_COMPUTE ? pComputeFence : pFence;
+    };
+
+    auto queue = [this](uint32_t queue) {
+        return queue == QUEUE_COMPUTE ? pComputeQueue : pCommandQueue;
+    };
+
+    scheduler.Init(QUEUE_COUNT, MAX_FRAMES_IN_FLIGHT, {
+        .completedValue = [queueFence](uint32_t q) {
+            return queueFence(q)->GetCompletedValue();
+        },
+        .signal = [queueFence, queue](uint32_t q, uint64_t value) {
+            queue(q)->Signal(queueFence(q), value);
+        },
+        .wait = [this, queueFence](const FrameScheduler::TimelinePoint* points, uint32_t count, bool waitAll) {
+            ID3D12Fence* fences[FrameScheduler::MAX_QUEUES];
+            UINT64       values[FrameScheduler::MAX_QUEUES];
+
+            for (uint32_t i = 0; i < count; ++i) {
+                fences[i] = queueFence(points[i].queue);
+                values[i] = points[i].value;
+            }
+
+            D3D12_MULTIPLE_FENCE_WAIT_FLAGS flags = waitAll ? D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL : D3D12_MULTIPLE_FENCE_WAIT_FLAG_ANY;
+
+            if (FAILED(pDevice9->SetEventOnMultipleFenceCompletion(fences, values, count, flags, fenceHandle))) {
+                throw std::runtime_error("Could not wait on fences!");
+            }
+
+            WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
+        }
+    });
+
+    frameIndex = scheduler.GetFrameSlot();
+}
+
+void Harmony::CreateUploadManager() {
+    uploadManager.Init(pDevice9, pCopyQueue);
+
+    delQ.Append([cUploadManager = &uploadManager] {
+        cUploadManager->Destroy();
+    });
+}
+
+void Harmony::CreateJobSystem() {
+    jobSystem.Init((std::max)(std::thread::hardware_concurrency(), 2u) - 1);
+
+    delQ.Append([cJobs = &jobSystem] {
+        cJobs->ReportStats(true);
+        cJobs->Destroy();
+    });
+}
+
+void Harmony::CreateScene() {
+    uint32_t side = static_cast<uint32_t>(ceil(sqrt(double(settings.objects))));
+
+    const float spacing = 1.5f;
+
+    transforms.Resize(settings.objects);
+
+    float* pPosX = transforms.Get(TransformSystem::POS_X);
+    float* pPosZ = transforms.Get(TransformSystem::POS_Z);
+
+    for (uint32_t i = 0; i < settings.objects; ++i) {
+        pPosX[i] = (float(i % side) - (side - 1) * 0.5f) * spacing;
+        pPosZ[i] = (float(i / side) - (side - 1) * 0.5f) * spacing;
+    }
+
+    sceneScale = (std::max)(1.0f, side * spacing * 0.5f);
+
+    XMFLOAT3 lo = vertices[0].position, hi = vertices[0].position;
+
+    for (const Vertex& vertex : vertices) {
+        lo = { (std::min)(lo.x, vertex.position.x), (std::min)(lo.y, vertex.position.y), (std::min)(lo.z, vertex.position.z) };
+        hi = { (std::max)(hi.x, vertex.position.x), (std::max)(hi.y, vertex.position.y), (std::max)(hi.z, vertex.position.z) };
+    }
+
+    meshCenter = { (lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f, (lo.z + hi.z) * 0.5f };
+    meshExtent = { (hi.x - lo.x) * 0.5f, (hi.y - lo.y) * 0.5f, (hi.z - lo.z) * 0.5f };
+
+    culling.Resize(settings.objects);
+    visibleList.resize(settings.objects);
+
+    if (settings.cull == CullMode::Bvh) {
+        bvh.Init();
+
+        delQ.Append([cBvh = &bvh] {
+            cBvh->ReportStats(true);
+            cBvh->Destroy();
+        });
+    }
+
+    if (settings.occlusion) {
+        occlusion.Init(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+        occluderMvps.resize(MAX_OCCLUDERS);
+
+        delQ.Append([cOcclusion = &occlusion] {
+            cOcclusion->ReportStats(true);
+        });
+    }
+
+    activeObjects = settings.stress ? (std::min)(STRESS_START_OBJECTS, settings.objects) : settings.objects;
+    stressStart   = std::chrono::steady_clock::now();
+}
+
+void Harmony::CreateFrameTiming() {
+    D3D12_QUERY_HEAP_DESC queryHeapDesc {
+        .Type     = D3D12_QUERY_HEAP_TYPE_TIMESTAMP,
+        .Count    = 2 * MAX_FRAMES_IN_FLIGHT,
+        .NodeMask = 0
+    };
+
+    if (FAILED(pDevice9->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&pTimestampHeap)))) {
+        throw std::runtime_error("Could not create timestamp query heap!");
+    }
+
+    delQ.Append([cHeap = pTimestampHeap] {
+        cHeap->Release();
+    });
+
+    D3D12_RESOURCE_DESC readbackDesc {
+        .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+        .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+        .Width            = 2 * MAX_FRAMES_IN_FLIGHT * sizeof(UINT64),
+        .Height           = 1,
+        .DepthOrArraySize = 1,
+        .MipLevels        = 1,
+        .Format           = DXGI_FORMAT_UNKNOWN,
+        .SampleDesc       = { .Count = 1, .Quality = 0 },
+        .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+        .Flags            = D3D12_RESOURCE_FLAG_NONE,
+    };
+
+    D3D12_HEAP_PROPERTIES readbackHeapProps {
+        .Type                   = D3D12_HEAP_TYPE_READBACK,
+        .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+        .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+        .CreationNodeMask       = 0,
+        .VisibleNodeMask        = 0
+    };
+
+    if (FAILED(pDevice9->CreateCommittedResource(&readbackHeapProps, D3D12_HEAP_FLAG_NONE, &readbackDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pTimestampReadback)))) {
+        throw std::runtime_error("Could not create timestamp readback buffer!");
+    }
+
+    delQ.Append([cbuff = pTimestampReadback] {
+        cbuff->Release();
+    });
+
+    if (FAILED(pCommandQueue->GetTimestampFrequency(&gpuTimestampFrequency))) {
+        throw std::runtime_error("Could not query timestamp frequency!");
+    }
+}
+
+// a committed buffer, released with the rest on shutdown
+ID3D12Resource* Harmony::CreateBuffer(D3D12_HEAP_TYPE type, UINT64 size, D3D12_RESOURCE_FLAGS flags, D3D12_RESOURCE_STATES state, const char* pName) {
+    D3D12_HEAP_PROPERTIES heapProps {
+        .Type                   = type,
+        .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+        .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+        .CreationNodeMask       = 0,
+        .VisibleNodeMask        = 0
+    };
+
+    D3D12_RESOURCE_DESC bufferDesc {
+        .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+        .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+        .Width            = size,
+        .Height           = 1,
+        .DepthOrArraySize = 1,
+        .MipLevels        = 1,
+        .Format           = DXGI_FORMAT_UNKNOWN,
+        .SampleDesc       = { .Count = 1, .Quality = 0 },
+        .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+        .Flags            = flags,
+    };
+
+    ID3D12Resource* pBuffer = nullptr;
+
+    if (FAILED(pDevice9->CreateCommittedResource(&heapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, state, nullptr, IID_PPV_ARGS(&pBuffer)))) {
+        throw std::runtime_error(std::string("Could not create ") + pName + "!");
+    }
+
+    delQ.Append([cbuff = pBuffer] {
+        cbuff->Release();
+    });
+
+    return pBuffer;
+}
+
+//
+// --hiz: the pyramid GenHiZ builds out of the depth buffer after the draws, and per frame slot the
+// boxes and results of CullHiZ. The views go to pSrvHeap from HIZ_DESCRIPTORS on, laid out for the
+// tables of the compute root signature:
+//   +0           depth SRV                                GenHiZ t0
+//   +1 ... +17   null, a UAV per level, scratch          GenHiZ u0 ... u16
+//   +18 + 2 * n  pyramid and box SRVs of slot n           CullHiZ t0, t1
+//   +24 + n      results UAV of slot n                    CullHiZ u0
+//
+void Harmony::CreateHiZ() {
+    if (!settings.hiz) {
+        return;
+    }
+
+    if (settings.hizReduction == DepthPyramid::Reduction::Min) {
+        std::cout << "Hi-Z: a min pyramid has no farthest depth to cull against, it is only built and validated" << std::endl;
+    }
+
+    hizLevels  = DepthPyramid::LevelCount(WINDOW_WIDTH, WINDOW_HEIGHT);
+    hizGroupsX = (DepthPyramid::LevelSize(WINDOW_WIDTH, 0) + 31) / 32;
+    hizGroupsY = (DepthPyramid::LevelSize(WINDOW_HEIGHT, 0) + 31) / 32;
+
+    bool        minMax        = settings.hizReduction == DepthPyramid::Reduction::MinMax;
+    DXGI_FORMAT pyramidFormat = minMax ? DXGI_FORMAT_R32G32_FLOAT : DXGI_FORMAT_R32_FLOAT;
+    UINT64      slotBoxes     = UINT64(settings.objects) + 1;
+
+    D3D12_RESOURCE_DESC pyramidDesc {
+        .Dimension        = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+        .Alignment        = 0,
+        .Width            = DepthPyramid::LevelSize(WINDOW_WIDTH, 0),
+        .Height           = DepthPyramid::LevelSize(WINDOW_HEIGHT, 0),
+        .DepthOrArraySize = 1,
+        .MipLevels        = UINT16(hizLevels),
+        .Format           = pyramidFormat,
+        .SampleDesc       = { .Count = 1, .Quality = 0 },
+        .Layout           = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+        .Flags            = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+    };
+
+    D3D12_HEAP_PROPERTIES defaultHeapProps {
+        .Type                   = D3D12_HEAP_TYPE_DEFAULT,
+        .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+        .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+        .CreationNodeMask       = 0,
+        .VisibleNodeMask        = 0
+    };
+
+    if (FAILED(pDevice9->CreateCommittedResource(&defaultHeapProps, D3D12_HEAP_FLAG_NONE, &pyramidDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pHiZPyramid)))) {
+        throw std::runtime_error("Could not create Hi-Z pyramid!");
+    }
+
+    delQ.Append([ctex = pHiZPyramid] {
+        ctex->Release();
+    });
+
+    // committed, so the counter starts out zero; the levels past 5 take less than the groups' texels
+    UINT64 scratchSize = 16 + 2 * UINT64(hizGroupsX) * hizGroupsY * sizeof(XMFLOAT2);
+
+    pHiZScratch    = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, scratchSize, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "Hi-Z scratch buffer");
+    pHiZBoxes      = CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, slotBoxes * MAX_FRAMES_IN_FLIGHT * sizeof(HiZBox), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, "Hi-Z box buffer");
+    pHiZResults    = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, slotBoxes * MAX_FRAMES_IN_FLIGHT * sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "Hi-Z result buffer");
+    pHiZReadback   = CreateBuffer(D3D12_HEAP_TYPE_READBACK, MAX_FRAMES_IN_FLIGHT * sizeof(uint32_t), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, "Hi-Z readback buffer");
+
+    D3D12_RANGE noRead { 0, 0 };
+    if (FAILED(pHiZBoxes->Map(0, &noRead, reinterpret_cast<void**>(&pHiZBoxData)))) {
+        throw std::runtime_error("Could not map Hi-Z box buffer!");
+    }
+
+    // the header of each slot is copied over the visible count to reset it
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; ++slot) {
+        pHiZBoxData[slot * slotBoxes] = {};
+    }
+
+    // the depth buffer, then all levels
+    D3D12_RESOURCE_DESC depthDesc  = pDepthBuffer->GetDesc();
+    UINT64              depthBytes = 0;
+    UINT64              levelBytes = 0;
+
+    pDevice9->GetCopyableFootprints(&depthDesc, 0, 1, 0, &hizFootprints[0], nullptr, nullptr, &depthBytes);
+
+    UINT64 levelsOffset = (depthBytes + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~UINT64(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+
+    pDevice9->GetCopyableFootprints(&pyramidDesc, 0, hizLevels, levelsOffset, &hizFootprints[1], nullptr, nullptr, &levelBytes);
+
+    pHiZValidation = CreateBuffer(D3D12_HEAP_TYPE_READBACK, levelsOffset + levelBytes, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, "Hi-Z validation buffer");
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+
+    auto Cpu = [&](uint32_t offset) {
+        return D3D12_CPU_DESCRIPTOR_HANDLE { cpuHandle.ptr + SIZE_T(HIZ_DESCRIPTORS + offset) * srvDescriptorSize };
+    };
+
+    auto Gpu = [&](uint32_t offset) {
+        return D3D12_GPU_DESCRIPTOR_HANDLE { gpuHandle.ptr + UINT64(HIZ_DESCRIPTORS + offset) * srvDescriptorSize };
+    };
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC depthSrvDesc {
+        .Format                  = DXGI_FORMAT_R32_FLOAT,
+        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
+    };
+
+    pDevice9->CreateShaderResourceView(pDepthBuffer, &depthSrvDesc, Cpu(0));
+
+    // u0 belongs to GenMips
+    for (uint32_t uav = 0; uav <= DepthPyramid::MAX_LEVELS; ++uav) {
+        uint32_t level = uav - 1;
+        bool     used  = uav > 0 && level < hizLevels;
+
+        D3D12_UNORDERED_ACCESS_VIEW_DESC levelUavDesc {
+            .Format        = pyramidFormat,
+            .ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D,
+            .Texture2D     = { .MipSlice = used ? level : 0, .PlaneSlice = 0 }
+        };
+
+        pDevice9->CreateUnorderedAccessView(used ? pHiZPyramid : nullptr, nullptr, &levelUavDesc, Cpu(1 + uav));
+    }
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC scratchUavDesc {
+        .Format        = DXGI_FORMAT_R32_TYPELESS,
+        .ViewDimension = D3D12_UAV_DIMENSION_BUFFER,
+        .Buffer        = { .FirstElement = 0, .NumElements = UINT(scratchSize / 4), .StructureByteStride = 0, .CounterOffsetInBytes = 0, .Flags = D3D12_BUFFER_UAV_FLAG_RAW }
+    };
+
+    pDevice9->CreateUnorderedAccessView(pHiZScratch, nullptr, &scratchUavDesc, Cpu(17));
+
+    hizGenSrv  = Gpu(0);
+    hizGenUavs = Gpu(1);
+
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; ++slot) {
+        D3D12_SHADER_RESOURCE_VIEW_DESC pyramidSrvDesc {
+            .Format                  = pyramidFormat,
+            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Texture2D               = { .MostDetailedMip = 0, .MipLevels = hizLevels, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
+        };
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC boxSrvDesc {
+            .Format                  = DXGI_FORMAT_UNKNOWN,
+            .ViewDimension           = D3D12_SRV_DIMENSION_BUFFER,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Buffer                  = { .FirstElement = slot * slotBoxes + 1, .NumElements = settings.objects, .StructureByteStride = sizeof(HiZBox), .Flags = D3D12_BUFFER_SRV_FLAG_NONE }
+        };
+
+        D3D12_UNORDERED_ACCESS_VIEW_DESC resultUavDesc {
+            .Format        = DXGI_FORMAT_R32_TYPELESS,
+            .ViewDimension = D3D12_UAV_DIMENSION_BUFFER,
+            .Buffer        = { .FirstElement = slot * slotBoxes, .NumElements = UINT(slotBoxes), .StructureByteStride = 0, .CounterOffsetInBytes = 0, .Flags = D3D12_BUFFER_UAV_FLAG_RAW }
+        };
+
+        pDevice9->CreateShaderResourceView(pHiZPyramid, &pyramidSrvDesc, Cpu(18 + 2 * slot));
+        pDevice9->CreateShaderResourceView(pHiZBoxes, &boxSrvDesc, Cpu(19 + 2 * slot));
+        pDevice9->CreateUnorderedAccessView(pHiZResults, nullptr, &resultUavDesc, Cpu(24 + slot));
+
+        hizCullSrvs[slot] = Gpu(18 + 2 * slot);
+        hizCullUavs[slot] = Gpu(24 + slot);
+    }
+}
+
+//
+// --draw=indirect: per frame slot the boxes CullDraws tests and the commands, instance slots and
+// counts it writes. The counts are reset by copying the boxes' zero header over them. The views
+// go to pSrvHeap from INDIRECT_DESCRIPTORS on, six per slot n at +6n:
+//   +0, +1       pyramid (null without --hiz) and box SRVs      CullDraws t0, t1
+//   +2 ... +5    null, commands, instance slots, counts UAVs    CullDraws u0 ... u3
+//
+void Harmony::CreateIndirect() {
+    if (settings.drawPath != DrawPath::Indirect) {
+        return;
+    }
+
+    drawMaxCommands = IndirectDraws::MaxCommands(settings.objects);
+
+    UINT64 slotBoxes    = UINT64(settings.objects) + 1;
+    UINT64 commandBytes = UINT64(drawMaxCommands) * sizeof(IndirectDraws::Command);
+    UINT64 countBytes   = 2 * sizeof(uint32_t);
+
+    pDrawBoxes      = CreateBuffer(D3D12_HEAP_TYPE_UPLOAD, slotBoxes * MAX_FRAMES_IN_FLIGHT * sizeof(HiZBox), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ, "draw box buffer");
+    pDrawCommands   = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, commandBytes * MAX_FRAMES_IN_FLIGHT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "draw command buffer");
+    pDrawInstances  = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, UINT64(settings.objects) * sizeof(uint32_t) * MAX_FRAMES_IN_FLIGHT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "draw instance buffer");
+    pDrawCounts     = CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, countBytes * MAX_FRAMES_IN_FLIGHT, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON, "draw count buffer");
+    pDrawReadback   = CreateBuffer(D3D12_HEAP_TYPE_READBACK, countBytes * MAX_FRAMES_IN_FLIGHT, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, "draw readback buffer");
+    pDrawValidation = CreateBuffer(D3D12_HEAP_TYPE_READBACK, commandBytes + UINT64(settings.objects) * sizeof(uint32_t), D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST, "draw validation buffer");
+
+    D3D12_RANGE noRead { 0, 0 };
+    if (FAILED(pDrawBoxes->Map(0, &noRead, reinterpret_cast<void**>(&pDrawBoxData)))) {
+        throw std::runtime_error("Could not map draw box buffer!");
+    }
+
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; ++slot) {
+        pDrawBoxData[slot * slotBoxes] = {};
+    }
+
+    drawReference.resize(drawMaxCommands);
+    drawReferenceInstances.resize(settings.objects);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE cpuHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+    D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+
+    auto Cpu = [&](uint32_t offset) {
+        return D3D12_CPU_DESCRIPTOR_HANDLE { cpuHandle.ptr + SIZE_T(INDIRECT_DESCRIPTORS + offset) * srvDescriptorSize };
+    };
+
+    auto Gpu = [&](uint32_t offset) {
+        return D3D12_GPU_DESCRIPTOR_HANDLE { gpuHandle.ptr + UINT64(INDIRECT_DESCRIPTORS + offset) * srvDescriptorSize };
+    };
+
+    bool minMax = settings.hizReduction == DepthPyramid::Reduction::MinMax;
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC pyramidSrvDesc {
+        .Format                  = pHiZPyramid && minMax ? DXGI_FORMAT_R32G32_FLOAT : DXGI_FORMAT_R32_FLOAT,
+        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = pHiZPyramid ? hizLevels : 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
+    };
+
+    D3D12_UNORDERED_ACCESS_VIEW_DESC nullUavDesc {
+        .Format        = DXGI_FORMAT_R32_UINT,
+        .ViewDimension = D3D12_UAV_DIMENSION_BUFFER,
+        .Buffer        = { .FirstElement = 0, .NumElements = 1, .StructureByteStride = 0, .CounterOffsetInBytes = 0, .Flags = D3D12_BUFFER_UAV_FLAG_NONE }
+    };
+
+    auto RawUavDesc = [](UINT64 firstByte, UINT64 bytes) {
+        return D3D12_UNORDERED_ACCESS_VIEW_DESC {
+            .Format        = DXGI_FORMAT_R32_TYPELESS,
+            .ViewDimension = D3D12_UAV_DIMENSION_BUFFER,
+            .Buffer        = { .FirstElement = firstByte / 4, .NumElements = UINT(bytes / 4), .StructureByteStride = 0, .CounterOffsetInBytes = 0, .Flags = D3D12_BUFFER_UAV_FLAG_RAW }
+        };
+    };
+
+    for (uint32_t slot = 0; slot < MAX_FRAMES_IN_FLIGHT; ++slot) {
+        D3D12_SHADER_RESOURCE_VIEW_DESC boxSrvDesc {
+            .Format                  = DXGI_FORMAT_UNKNOWN,
+            .ViewDimension           = D3D12_SRV_DIMENSION_BUFFER,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Buffer                  = { .FirstElement = slot * slotBoxes + 1, .NumElements = settings.objects, .StructureByteStride = sizeof(HiZBox), .Flags = D3D12_BUFFER_SRV_FLAG_NONE }
+        };
+
+        UINT64 instanceBytes = UINT64(settings.objects) * sizeof(uint32_t);
+
+        D3D12_UNORDERED_ACCESS_VIEW_DESC commandUavDesc  = RawUavDesc(slot * commandBytes, commandBytes);
+        D3D12_UNORDERED_ACCESS_VIEW_DESC instanceUavDesc = RawUavDesc(slot * instanceBytes, instanceBytes);
+        D3D12_UNORDERED_ACCESS_VIEW_DESC countUavDesc    = RawUavDesc(slot * countBytes, countBytes);
+
+        uint32_t base = 6 * slot;
+
+        pDevice9->CreateShaderResourceView(pHiZPyramid, &pyramidSrvDesc, Cpu(base));
+        pDevice9->CreateShaderResourceView(pDrawBoxes, &boxSrvDesc, Cpu(base + 1));
+        pDevice9->CreateUnorderedAccessView(nullptr, nullptr, &nullUavDesc, Cpu(base + 2));
+        pDevice9->CreateUnorderedAccessView(pDrawCommands, nullptr, &commandUavDesc, Cpu(base + 3));
+        pDevice9->CreateUnorderedAccessView(pDrawInstances, nullptr, &instanceUavDesc, Cpu(base + 4));
+        pDevice9->CreateUnorderedAccessView(pDrawCounts, nullptr, &countUavDesc, Cpu(base + 5));
+
+        drawSrvs[slot] = Gpu(base);
+        drawUavs[slot] = Gpu(base + 2);
+    }
+}
+
+void Harmony::DownloadDataAndGenMips() {
+    ComPtr<ID3D12GraphicsCommandList>   mipsCmdlist;
+    ComPtr<ID3D12CommandAllocator>      mipsCmdAllocator;
+
+    HRESULT hr;
+
+    hr = pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS (&mipsCmdAllocator));
+    if (FAILED(hr)) {
+        throw std::runtime_error("Could not create compute command allocator!");
+    }
+
+    hr = pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, mipsCmdAllocator.Get (), nullptr, IID_PPV_ARGS (&mipsCmdlist));
+    if (FAILED(hr)) {
+        throw std::runtime_error("Could not create compute command list!");
+    }
+
+    std::vector<UINT> texels(TEXTURE_WIDTH * TEXTURE_HEIGHT);
+
+    {
+        for (UINT i = 0; i < TEXTURE_HEIGHT; ++i) {
+            UINT* pRow = texels.data() + (i * TEXTURE_WIDTH);
+
+            for (UINT j = 0; j < TEXTURE_HEIGHT; ++j) {
+                if (((j / 96) % 2) == 0)
+                {
+                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0F0F0FFF : 0x0;
+                }
+                else
+                {
+                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0 : 0x0F0F0FFF;
+                }
+            }
+        }
+    }
+
+    //
+    // Mesh and mip 0 go through the copy queue
+    //
+    bool queued = uploadManager.UploadBuffer(pVertexBuffer, 0, vertices, sizeof vertices)
+               && uploadManager.UploadBuffer(pIndexBuffer, 0, indices, sizeof indices)
+               && uploadManager.UploadTexture(pTexture, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, texels.data(), TEXTURE_WIDTH * sizeof(UINT));
+
+    if (!queued) {
+        throw std::runtime_error("Could not stage initial uploads!");
+    }
+
+    UINT64 uploadValue = uploadManager.Submit();
+
+    //
+    // Generate texture mip maps on the compute queue. It only waits on the upload above; the
+    // render loop starts right away and acquires the texture once the chain is done (AcquireTexture).
+    //
+    // Everything leaves the copy queue in COMMON. The buffers are promoted implicitly by the graphics
+    // queue, which is ordered after the copy through the compute fence it waits on.
+    //
+    pComputeQueue->Wait(uploadManager.GetFence(), uploadValue);
+
+    D3D12_RESOURCE_BARRIER barrierTex {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pTexture,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
+            .StateAfter  = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,   // to Gen Mips
+        }
+    };
+
+    mipsCmdlist->ResourceBarrier(1, &barrierTex);
+
+    D3D12_RESOURCE_DESC tdesc = pTexture->GetDesc();
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
+        .Format                  = tdesc.Format,
+        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
+    };
+    
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc {
+        .Format                  = tdesc.Format,
+        .ViewDimension           = D3D12_UAV_DIMENSION_TEXTURE2D,
+        .Texture2D               = { .MipSlice = 0, .PlaneSlice = 0 }
+    };
+    
+    mipsCmdlist->SetComputeRootSignature(pCsRootSignature);
+    mipsCmdlist->SetPipelineState(pCsPipelineState);
+    
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+
+    mipsCmdlist->SetDescriptorHeaps(2, pDescHeaps);
+
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+
+        D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+        
+        UINT mipgenSrvHeapOffset = 1;
+
+        D3D12_RESOURCE_BARRIER uavBarrier {
+            .Type  = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+            .UAV   = pTexture
+        };
+
+        union FloatAsInt {
+            UINT  u;
+            FLOAT f;
+
+            explicit FloatAsInt(float val)
+                : f(val)
+            {}
+        };
+
+        // set sampler state in root once
+        mipsCmdlist->SetComputeRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+
+        for (UINT16 i = 0; i < (tdesc.MipLevels - 1); ++i) {
+            UINT dstWidth  = TEXTURE_WIDTH  >> (i + 1);
+            UINT dstHeight = TEXTURE_HEIGHT >> (i + 1);
+
+            SIZE_T bytesToSrv = (mipgenSrvHeapOffset + i) * srvDescriptorSize;
+
+            srvHandle.ptr += bytesToSrv;
+            srvGpuHandle.ptr += bytesToSrv;
+
+            SIZE_T bytesToUav = (mipgenSrvHeapOffset + i + 1) * srvDescriptorSize;
+
+            uavHandle.ptr += bytesToUav;
+            uavGpuHandle.ptr += bytesToUav;
+
+            srvDesc.Texture2D.MostDetailedMip = i;
+            pDevice9->CreateShaderResourceView(pTexture, &srvDesc, srvHandle);
+
+            uavDesc.Texture2D.MipSlice = i + 1;
+            pDevice9->CreateUnorderedAccessView(pTexture, nullptr, &uavDesc, uavHandle);
+
+            UINT rootConstData[2] = { FloatAsInt(1.0f / dstWidth).u, FloatAsInt(1.0f / dstHeight).u };
+
+            mipsCmdlist->SetComputeRoot32BitConstants(0, 2, rootConstData, 0);
+            mipsCmdlist->SetComputeRootDescriptorTable(1, srvGpuHandle);
+            mipsCmdlist->SetComputeRootDescriptorTable(2, uavGpuHandle);
+            
+            UINT dispatchX = max(dstWidth  / 8, 1u);
+            UINT dispatchY = max(dstHeight / 8, 1u);
+
+            mipsCmdlist->Dispatch(dispatchX, dispatchY, 1);
+
+            mipsCmdlist->ResourceBarrier(1, &uavBarrier);
+        }
+
+        // compute lists can't name PIXEL_SHADER_RESOURCE, leave it in COMMON for the graphics queue
+        barrierTex.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        barrierTex.Transition.StateAfter  = D3D12_RESOURCE_STATE_COMMON;
+
+        mipsCmdlist->ResourceBarrier(1, &barrierTex);
+    }
+    
+    mipsCmdlist->Close();
+
+    ID3D12CommandList* mipsLists[] = { mipsCmdlist.Get() };
+    pComputeQueue->ExecuteCommandLists(1, mipsLists);
+
+    mipsReadyValue = scheduler.Signal(QUEUE_COMPUTE, false);
+
+    initQ.Append([cMipsCmdList = mipsCmdlist.Detach(), cMipsAllocator = mipsCmdAllocator.Detach()] {
+        cMipsAllocator->Release();
+        cMipsCmdList->Release();
+    });
+}
+
+#pragma endregion
+
+#pragma region Shader Hot Reload
+
+void Harmony::StartShaderWatcher() {
+    //
+    // dxcompiler.dll is loaded on demand so the app still runs (without hot reload) when it is missing.
+    // Place dxil.dll next to it, otherwise the produced DXIL is unsigned and PSO creation will fail.
+    //
+    HMODULE dxcModule = LoadLibraryW(L"dxcompiler.dll");
+    if (!dxcModule) {
+        std::cout << "dxcompiler.dll not found, shader hot reload disabled" << std::endl;
+        return;
+    }
+
+    auto pfnDxcCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(dxcModule, "DxcCreateInstance"));
+
+    if (!pfnDxcCreateInstance
+        || FAILED(pfnDxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils)))
+        || FAILED(pfnDxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler)))
+        || FAILED(dxcUtils->CreateDefaultIncludeHandler(&dxcIncludeHandler))) {
+        std::cout << "Could not create DXC instance, shader hot reload disabled" << std::endl;
+        return;
+    }
+
+    delQ.Append([cModule = dxcModule] {
+        FreeLibrary(cModule);
+    });
+
+    const std::wstring shaderDir = L"" SHADER_SOURCE_DIR;
+
+    // reported when the watcher loses track of the changes
+    std::vector<std::wstring> files;
+
+    for (const ShaderSource& source : shaderSources) {
+        if (std::find(files.begin(), files.end(), source.file) == files.end()) {
+            files.push_back(source.file);
+        }
+    }
+
+    bool watching = shaderWatcher.Start(shaderDir, std::move(files),
+        [this](const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange) {
+            ReloadShaders(files, firstChange);
+        });
+
+    if (watching) {
+        std::wcout << "Watching " << shaderDir << " for shader changes" << std::endl;
+    }
+}
+
+//
+// Runs on the watcher thread: recompiles only the entry points that live in the changed files and
+// builds the affected PSOs. Nothing the render loop touches is modified here; the new pipelines are
+// handed over through reloadedPipelines.
+//
+void Harmony::ReloadShaders(const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange) {
+    const std::wstring shaderDir = L"" SHADER_SOURCE_DIR;
+
+    for (const std::wstring& file : files) {
+        bool graphicsDirty = false;
+        bool computeDirty  = false;
+        bool failed        = false;
+        UINT entryCount    = 0;
+
+        for (const ShaderSource& source : shaderSources) {
+            if (_wcsicmp(source.file, file.c_str()) != 0) {
+                continue;
+            }
+
+            std::wstring path = shaderDir + L"/" + file;
+
+            ComPtr<IDxcBlobEncoding> sourceBlob;
+            if (FAILED(dxcUtils->LoadFile(path.c_str(), nullptr, &sourceBlob))) {
+                // editors may still hold the file, the next write notification retries
+                failed = true;
+                break;
+            }
+
+            DxcBuffer sourceBuffer {
+                .Ptr      = sourceBlob->GetBufferPointer(),
+                .Size     = sourceBlob->GetBufferSize(),
+                .Encoding = DXC_CP_ACP
+            };
+
+            std::vector<LPCWSTR> args = { path.c_str(), L"-E", source.entry, L"-T", source.target };
+
+            if constexpr (enableDebugLayers) {
+                args.push_back(DXC_ARG_DEBUG);
+                args.push_back(DXC_ARG_SKIP_OPTIMIZATIONS);
+            }
+
+            ComPtr<IDxcResult> result;
+            HRESULT            status = E_FAIL;
+
+            if (SUCCEEDED(dxcCompiler->Compile(&sourceBuffer, args.data(), static_cast<UINT32>(args.size()), dxcIncludeHandler.Get(), IID_PPV_ARGS(&result)))) {
+                result->GetStatus(&status);
+            }
+
+            if (FAILED(status)) {
+                ComPtr<IDxcBlobUtf8> errors;
+
+                if (result && SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) && errors && errors->GetStringLength()) {
+                    std::cerr << errors->GetStringPointer() << std::endl;
+                }
+
+                failed = true;
+                break;
+            }
+
+            ComPtr<IDxcBlob> object;
+            result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+
+            const char* bytes = reinterpret_cast<const char*>(object->GetBufferPointer());
+            shaderBytecode[source.entry].assign(bytes, bytes + object->GetBufferSize());
+
+            if (wcsncmp(source.target, L"cs_", 3) == 0) {
+                computeDirty = true;
+            }
+            else {
+                graphicsDirty = true;
+            }
+
+            ++entryCount;
+        }
+
+        if (failed) {
+            std::wcerr << "Hot reload: " << file << " failed, keeping previous pipelines" << std::endl;
+            continue;
+        }
+
+        if (entryCount == 0) {
+            continue;
+        }
+
+        std::vector<std::pair<ID3D12PipelineState**, ID3D12PipelineState*>> built;
+
+        try {
+            if (graphicsDirty) {
+                built.emplace_back(&pPipelineState, BuildGraphicsPipeline(shaderBytecode[L"VsMain"], shaderBytecode[L"PsMain"]));
+                built.emplace_back(&pInstancedPipelineState, BuildGraphicsPipeline(shaderBytecode[L"VsInstanced"], shaderBytecode[L"PsMain"]));
+
+                if (settings.drawPath == DrawPath::Indirect) {
+                    built.emplace_back(&pIndirectPipelineState, BuildGraphicsPipeline(shaderBytecode[L"VsIndirect"], shaderBytecode[L"PsMain"]));
+                }
+            }
+
+            if (computeDirty) {
+                built.emplace_back(&pCsPipelineState, BuildComputePipeline(shaderBytecode[L"GenMips"]));
+
+                if (settings.hiz) {
+                    built.emplace_back(&pHiZGenPipelineState, BuildComputePipeline(shaderBytecode[L"GenHiZ"]));
+                    built.emplace_back(&pHiZCullPipelineState, BuildComputePipeline(shaderBytecode[L"CullHiZ"]));
+                }
+
+                if (settings.drawPath == DrawPath::Indirect) {
+                    built.emplace_back(&pCullDrawsPipelineState, BuildComputePipeline(shaderBytecode[L"CullDraws"]));
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(reloadMutex);
+            reloadedPipelines.insert(reloadedPipelines.end(), built.begin(), built.end());
+        }
+        catch (std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+
+            for (auto& [slot, pso] : built) {
+                pso->Release();
+            }
+            continue;
+        }
+
+        float latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - firstChange).count();
+
+        std::wcout << "Hot reload: " << file << " (" << entryCount << " entry points) in " << latencyMs << " ms" << std::endl;
+    }
+}
+
+//
+// Called at the frame boundary: swaps in the pipelines built by the watcher thread and retires the
+// old ones once the frame being recorded now (and hence every earlier frame) has completed on the GPU.
+//
+void Harmony::ApplyReloadedPipelines() {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+
+    for (auto& [slot, pso] : reloadedPipelines) {
+        retireQ.Append(scheduler.GetNextValue(QUEUE_GRAPHICS), [cPipelineState = *slot] {
+            cPipelineState->Release();
+        });
+
+        *slot = pso;
+    }
+
+    reloadedPipelines.clear();
+}
+
+#pragma endregion
+
+#pragma region Misc
+
+LRESULT Harmony::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    Harmony* pApp = reinterpret_cast<Harmony*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+
+    switch (msg) {
+    case WM_CLOSE:
+    case WM_DESTROY:
+        PostQuitMessage(0);         // close the application entirely
+        return 0;
+
+    case WM_SIZE:
+        if (pApp) {
+            pApp->Resize();
+        }
+        return 0;
+    }
+
+    return DefWindowProc(hWnd, msg, wParam, lParam);
+}
+
+#pragma endregion
+
+#pragma region Rendering
+
+void Harmony::Render() {
+    retireQ.Collect(scheduler.GetCompletedValue(QUEUE_GRAPHICS));
+    ApplyReloadedPipelines();
+
+    uploadManager.Poll();
+
+    CollectFrameTiming();
+    CollectHiZ();
+    CollectIndirect();
+    UpdateStress();
+
+    auto cpuStart = std::chrono::steady_clock::now();
+
+    UpdateUbo();
+
+    auto recordStart = std::chrono::steady_clock::now();
+
+    PopulateCommandList(AcquireTexture());
+
+    auto recordEnd = std::chrono::steady_clock::now();
+
+    using Ms = std::chrono::duration<float, std::milli>;
+    instanceStats.AddCpu(activeObjects, visibleObjects, Ms(recordStart - cpuStart).count(), Ms(recordEnd - recordStart).count());
+    instanceStats.Report(false);
+
+    ID3D12CommandList* ppCmdLists[] = { pCommandList };
+    pCommandQueue->ExecuteCommandLists(1, ppCmdLists);
+
+    pSwapChain4->Present(1, 0);
+
+    MoveToNextFrame();
+}
+
+//
+// Spins and bobs objects [first, last) like the single pyramid always did, each a little out of
+// phase with the one before.
+//
+void Harmony::Animate(uint32_t first, uint32_t last, float time) {
+    float* pPosY = transforms.Get(TransformSystem::POS_Y);
+    float* pRotY = transforms.Get(TransformSystem::ROT_Y);
+    float* pRotW = transforms.Get(TransformSystem::ROT_W);
+
+    for (uint32_t i = first; i < last; ++i) {
+        float t     = time + i * 0.37f;
+        float angle = t * XMConvertToRadians(90.0f);
+
+        pPosY[i] = (sin(t * 5) * 0.25f) - 0.25f;
+        pRotY[i] = sin(angle * 0.5f);
+        pRotW[i] = cos(angle * 0.5f);
+    }
+}
+
+void Harmony::UpdateUbo() {
+    static auto epoch = std::chrono::high_resolution_clock::now();
+
+    auto current = std::chrono::high_resolution_clock::now();
+    float time   = std::chrono::duration<float, std::chrono::seconds::period>( current - epoch ).count();
+
+    const XMVECTOR Eye = XMVectorSet( 0.0f,  0.75f * sceneScale, -1.5f * sceneScale, 0.0f );
+    const XMVECTOR At  = XMVectorSet( 0.0f,  0.0f,  0.0f, 0.0f );
+    const XMVECTOR Up  = XMVectorSet( 0.0f,  1.0f,  0.0f, 0.0f );
+
+    XMMATRIX  view       = XMMatrixLookAtLH( Eye, At, Up );
+    XMMATRIX  projection = XMMatrixPerspectiveFovLH(70, WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 20.0f * sceneScale);
+
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4(&viewProj, view * projection);
+
+    hizViewProj = viewProj;
+
+    // MVPs go to the instance buffer or the constant buffer, whichever the draw path reads
+    bool     instanced  = settings.drawPath != DrawPath::PerObject;
+    size_t   stride     = instanced ? sizeof(InstanceData) : sizeof(UniformBuffer);
+    uint8_t* pFrameData = (instanced ? pInstanceData : pConstantData) + size_t(frameIndex) * settings.objects * stride;
+
+    auto WriteMaterials = [&](const uint32_t* pIndices, uint64_t first, uint64_t last) {
+        if (instanced) {
+            InstanceData* pInstances = reinterpret_cast<InstanceData*>(pFrameData);
+
+            for (uint64_t n = first; n < last; ++n) {
+                pInstances[n].material = (pIndices ? pIndices[n] : uint32_t(n)) % MATERIAL_COUNT;
+            }
+        }
+    };
+
+    // boxes for CullHiZ and CullDraws, after the header of the frame slot: pIndices picks the objects
+    const float* pCenter[3] = { culling.Get(CullingSystem::CENTER_X), culling.Get(CullingSystem::CENTER_Y), culling.Get(CullingSystem::CENTER_Z) };
+    const float* pExtent[3] = { culling.Get(CullingSystem::EXTENT_X), culling.Get(CullingSystem::EXTENT_Y), culling.Get(CullingSystem::EXTENT_Z) };
+
+    auto WriteBoxes = [&](HiZBox* pBoxData, const uint32_t* pIndices, uint64_t first, uint64_t last) {
+        if (!pBoxData) {
+            return;
+        }
+
+        HiZBox* pBoxes = pBoxData + size_t(frameIndex) * (size_t(settings.objects) + 1) + 1;
+
+        for (uint64_t n = first; n < last; ++n) {
+            uint32_t i = pIndices ? pIndices[n] : uint32_t(n);
+
+            pBoxes[n] = {
+                .center  = { pCenter[0][i], pCenter[1][i], pCenter[2][i] },
+                .object  = i,
+                .extent  = { pExtent[0][i], pExtent[1][i], pExtent[2][i] },
+                .padding = 0
+            };
+        }
+    };
+
+    // --draw=indirect: every active object gets its matrix and box in object order, CullDraws culls
+    if (settings.drawPath == DrawPath::Indirect) {
+        jobSystem.ParallelFor(0, activeObjects, TRANSFORM_GRAIN, [&](uint64_t first, uint64_t last) {
+            Animate(uint32_t(first), uint32_t(last), time);
+            culling.UpdateBounds(transforms, uint32_t(first), uint32_t(last), meshCenter, meshExtent);
+            transforms.Compute(uint32_t(first), uint32_t(last), viewProj, pFrameData + first * stride, stride);
+            WriteMaterials(nullptr, first, last);
+            WriteBoxes(pDrawBoxData, nullptr, first, last);
+        });
+
+        drawFrustum    = Frustum::FromViewProj(viewProj.m);
+        visibleObjects = activeObjects;
+        return;
+    }
+
+    // each batch is animated and transformed by the same job, while it's still in cache
+    if (settings.cull == CullMode::Off) {
+        jobSystem.ParallelFor(0, activeObjects, TRANSFORM_GRAIN, [&](uint64_t first, uint64_t last) {
+            Animate(uint32_t(first), uint32_t(last), time);
+            transforms.Compute(uint32_t(first), uint32_t(last), viewProj, pFrameData + first * stride, stride);
+            WriteMaterials(nullptr, first, last);
+        });
+
+        visibleObjects = activeObjects;
+        return;
+    }
+
+    jobSystem.ParallelFor(0, activeObjects, TRANSFORM_GRAIN, [&](uint64_t first, uint64_t last) {
+        Animate(uint32_t(first), uint32_t(last), time);
+        culling.UpdateBounds(transforms, uint32_t(first), uint32_t(last), meshCenter, meshExtent);
+    });
+
+    if (settings.cull == CullMode::Bvh) {
+        UpdateBvh();
+
+        visibleObjects = bvh.QueryFrustum(Frustum::FromViewProj(viewProj.m), visibleList.data());
+    }
+    else {
+        CullingSystem::Test test = settings.cull == CullMode::Sphere ? CullingSystem::Test::Sphere : CullingSystem::Test::Box;
+
+        visibleObjects = culling.Cull(jobSystem, TRANSFORM_GRAIN, test, Frustum::FromViewProj(viewProj.m), activeObjects, visibleList.data());
+    }
+
+    if (settings.occlusion) {
+        XMFLOAT3 eye;
+        XMStoreFloat3(&eye, Eye);
+
+        CullOccluded(viewProj, eye);
+    }
+
+    // only what survived gets a matrix, packed in visible list order, and with --hiz a box for CullHiZ
+    jobSystem.ParallelFor(0, visibleObjects, TRANSFORM_GRAIN, [&](uint64_t first, uint64_t last) {
+        transforms.ComputeIndexed(visibleList.data() + first, uint32_t(last - first), viewProj, pFrameData + first * stride, stride);
+        WriteMaterials(visibleList.data(), first, last);
+        WriteBoxes(pHiZBoxData, visibleList.data(), first, last);
+    });
+}
+
+//
+// Keeps the BVH over the active objects: a new object count builds it right away, otherwise a
+// finished rebuild is swapped in or the tree is refitted, and a rebuild is requested once the
+// refits have let it degrade by BVH_REBUILD_COST.
+//
+void Harmony::UpdateBvh() {
+    if (bvh.GetObjectCount() != activeObjects) {
+        bvh.Build(CullingBoxes(culling), activeObjects);
+    }
+    else if (!bvh.ApplyRebuild(CullingBoxes(culling))) {
+        bvh.Refit(CullingBoxes(culling));
+
+        if (bvh.GetCost() > bvh.GetBuiltCost() * BVH_REBUILD_COST) {
+            bvh.RequestRebuild(CullingBoxes(culling), activeObjects);
+        }
+    }
+
+    bvh.ReportStats(false);
+}
+
+//
+// --occlusion: rasterizes the MAX_OCCLUDERS visible objects nearest the eye into the software depth
+// buffer and drops the visible ones it hides, occluders included, keeping the list in order. With
+// --occlusion=pyramid the same triangles go to CullOccludedPyramid() instead.
+//
+void Harmony::CullOccluded(const XMFLOAT4X4& viewProj, const XMFLOAT3& eye) {
+    const float* pCenter[3] = { culling.Get(CullingSystem::CENTER_X), culling.Get(CullingSystem::CENTER_Y), culling.Get(CullingSystem::CENTER_Z) };
+
+    auto Distance = [&](uint32_t i) {
+        float dx = pCenter[0][i] - eye.x, dy = pCenter[1][i] - eye.y, dz = pCenter[2][i] - eye.z;
+        return dx * dx + dy * dy + dz * dz;
+    };
+
+    occluders.assign(visibleList.begin(), visibleList.begin() + visibleObjects);
+
+    if (occluders.size() > MAX_OCCLUDERS) {
+        std::nth_element(occluders.begin(), occluders.begin() + MAX_OCCLUDERS, occluders.end(), [&](uint32_t a, uint32_t b) {
+            return Distance(a) < Distance(b);
+        });
+
+        occluders.resize(MAX_OCCLUDERS);
+    }
+
+    uint32_t occluderCount = static_cast<uint32_t>(occluders.size());
+
+    transforms.ComputeIndexed(occluders.data(), occluderCount, viewProj, reinterpret_cast<uint8_t*>(occluderMvps.data()), sizeof(XMFLOAT4X4));
+
+    occlusion.Clear();
+
+    for (uint32_t n = 0; n < occluderCount; ++n) {
+        occlusion.AddOccluder(occluderMvps[n].m, &vertices[0].position.x, sizeof(Vertex), indices, uint32_t(std::size(indices)));
+    }
+
+    if (settings.occlusionPyramid) {
+        CullOccludedPyramid(viewProj);
+        return;
+    }
+
+    occlusion.Rasterize(jobSystem);
+
+    visibleObjects = occlusion.Test(jobSystem, TRANSFORM_GRAIN, CullingBoxes(culling), viewProj.m, visibleList.data(), visibleObjects);
+
+    occlusion.ReportStats(false);
+}
+
+//
+// --occlusion=pyramid: the occluder triangles CullOccluded() set up are rasterized with a depth per
+// pixel, reduced to a DepthPyramid on jobs, and the visible boxes are tested against that, the CPU
+// version of what CullHiZ does on the GPU. It hides a little more than the masked buffer, which is
+// conservative per tile, but the per pixel rasterization is slower; --bench=hiz times both.
+//
+void Harmony::CullOccludedPyramid(const XMFLOAT4X4& viewProj) {
+    auto start = std::chrono::steady_clock::now();
+
+    occlusion.RasterizeReference(occlusionDepth);
+    occlusionPyramid.Build(jobSystem, occlusionDepth.data(), OCCLUSION_WIDTH, OCCLUSION_HEIGHT, OCCLUSION_WIDTH * sizeof(float));
+
+    uint32_t tested = visibleObjects;
+
+    visibleObjects = occlusionPyramid.Test(jobSystem, TRANSFORM_GRAIN, CullingBoxes(culling), viewProj.m, visibleList.data(), visibleObjects);
+
+    auto now = std::chrono::steady_clock::now();
+
+    pyramidStatFrames += 1;
+    pyramidStatTested += tested;
+    pyramidStatKept   += visibleObjects;
+    pyramidStatMs     += std::chrono::duration<float, std::milli>(now - start).count();
+
+    if ((now - pyramidStatStart) < std::chrono::seconds(1)) {
+        return;
+    }
+
+    std::cout << "Occlusion pyramid: " << OCCLUSION_WIDTH << "x" << OCCLUSION_HEIGHT << ", " << (pyramidStatTested - pyramidStatKept) / pyramidStatFrames
+              << " of " << pyramidStatTested / pyramidStatFrames << " occluded, " << pyramidStatMs / pyramidStatFrames << " ms" << std::endl;
+
+    pyramidStatFrames = 0;
+    pyramidStatTested = 0;
+    pyramidStatKept   = 0;
+    pyramidStatMs     = 0.0f;
+    pyramidStatStart  = now;
+}
+
+// --stress: doubles the objects drawn every STRESS_INTERVAL_MS until all of them are
+void Harmony::UpdateStress() {
+    if (!settings.stress || activeObjects == settings.objects) {
+        return;
+    }
+
+    if (std::chrono::steady_clock::now() - stressStart >= std::chrono::milliseconds(STRESS_INTERVAL_MS)) {
+        activeObjects = (std::min)(activeObjects * 2, settings.objects);
+        stressStart   = std::chrono::steady_clock::now();
+
+        instanceStats.Report(true);
+    }
+}
+
+//
+// GPU time of the draws of the frame this slot held before; MoveToNextFrame waited for it, so its
+// timestamps have landed in the readback buffer.
+//
+void Harmony::CollectFrameTiming() {
+    if (frameObjects[frameIndex] == 0) {
+        return;
+    }
+
+    D3D12_RANGE readRange { frameIndex * 2 * sizeof(UINT64), (frameIndex + 1) * 2 * sizeof(UINT64) };
+    D3D12_RANGE noWrite   { 0, 0 };
+
+    void* pData = nullptr;
+    if (FAILED(pTimestampReadback->Map(0, &readRange, &pData))) {
+        throw std::runtime_error("Could not map timestamp readback!");
+    }
+
+    const UINT64* pTimestamps = reinterpret_cast<const UINT64*>(pData) + frameIndex * 2;
+
+    float gpuMs = float(double(pTimestamps[1] - pTimestamps[0]) * 1000.0 / double(gpuTimestampFrequency));
+
+    pTimestampReadback->Unmap(0, &noWrite);
+
+    instanceStats.AddGpu(frameObjects[frameIndex], gpuMs);
+    frameObjects[frameIndex] = 0;
+}
+
+//
+// --hiz: the visible count CullHiZ left for the frame this slot held before, reported once a second,
+// and at HIZ_VALIDATE_FRAME the pyramid GenHiZ built, checked texel for texel against DepthPyramid
+// over the same depth buffer. A texel that differs fails validation.
+//
+void Harmony::CollectHiZ() {
+    if (!pHiZPyramid) {
+        return;
+    }
+
+    D3D12_RANGE noWrite { 0, 0 };
+
+    if (hizTested[frameIndex] > 0) {
+        D3D12_RANGE readRange { frameIndex * sizeof(uint32_t), (frameIndex + 1) * sizeof(uint32_t) };
+
+        void* pData = nullptr;
+        if (FAILED(pHiZReadback->Map(0, &readRange, &pData))) {
+            throw std::runtime_error("Could not map Hi-Z readback!");
+        }
+
+        hizStatVisible += reinterpret_cast<const uint32_t*>(pData)[frameIndex];
+        hizStatTested  += hizTested[frameIndex];
+
+        pHiZReadback->Unmap(0, &noWrite);
+
+        hizTested[frameIndex] = 0;
+    }
+
+    if (hizValidateSlot == frameIndex) {
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& top = hizFootprints[hizLevels];
+
+        D3D12_RANGE readRange { 0, SIZE_T(top.Offset + UINT64(top.Footprint.RowPitch) * top.Footprint.Height) };
+
+        void* pData = nullptr;
+        if (FAILED(pHiZValidation->Map(0, &readRange, &pData))) {
+            throw std::runtime_error("Could not map Hi-Z validation buffer!");
+        }
+
+        const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+
+        DepthPyramid reference;
+        reference.Build(jobSystem, reinterpret_cast<const float*>(pBytes + hizFootprints[0].Offset), WINDOW_WIDTH, WINDOW_HEIGHT, hizFootprints[0].Footprint.RowPitch);
+
+        uint64_t texels     = 0;
+        uint32_t mismatches = 0;
+
+        for (uint32_t level = 0; level < hizLevels; ++level) {
+            const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = hizFootprints[1 + level];
+
+            texels     += uint64_t(reference.GetWidth(level)) * reference.GetHeight(level);
+            mismatches += reference.Compare(level, settings.hizReduction, pBytes + footprint.Offset, footprint.Footprint.RowPitch);
+        }
+
+        pHiZValidation->Unmap(0, &noWrite);
+
+        std::cout << "Hi-Z validation: " << mismatches << " of " << texels << " texels in " << hizLevels
+                  << " levels differ from the CPU pyramid" << std::endl;
+
+        validationFailed |= mismatches > 0;
+
+        hizValidateSlot = UINT(-1);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (hizStatTested == 0 || (now - hizStatStart) < std::chrono::seconds(1)) {
+        return;
+    }
+
+    std::cout << "Hi-Z: " << hizStatTested - hizStatVisible << " of " << hizStatTested << " visible boxes occluded ("
+              << 100.0 * double(hizStatTested - hizStatVisible) / double(hizStatTested) << "%)" << std::endl;
+
+    hizStatTested  = 0;
+    hizStatVisible = 0;
+    hizStatStart   = now;
+}
+
+//
+// --draw=indirect: the counts CullDraws left for the frame this slot held before, reported once a
+// second, and at INDIRECT_VALIDATE_FRAME its draws expanded and checked against IndirectDraws'
+// reference over the same boxes. Objects missing from the draws are only reported, since with --hiz
+// the pyramid hides more; malformed commands or extra objects fail validation.
+//
+void Harmony::CollectIndirect() {
+    if (!pDrawCounts) {
+        return;
+    }
+
+    uint32_t tested    = drawTested[frameIndex];
+    uint32_t counts[2] = { 0, 0 };     // commands, visible objects
+
+    D3D12_RANGE noWrite { 0, 0 };
+
+    if (tested > 0) {
+        D3D12_RANGE readRange { frameIndex * sizeof(counts), (frameIndex + 1) * sizeof(counts) };
+
+        void* pData = nullptr;
+        if (FAILED(pDrawReadback->Map(0, &readRange, &pData))) {
+            throw std::runtime_error("Could not map draw readback!");
+        }
+
+        memcpy(counts, reinterpret_cast<const uint8_t*>(pData) + frameIndex * sizeof(counts), sizeof(counts));
+
+        pDrawReadback->Unmap(0, &noWrite);
+
+        drawStatFrames   += 1;
+        drawStatCommands += counts[0];
+        drawStatVisible  += counts[1];
+        drawStatTested   += tested;
+
+        drawTested[frameIndex] = 0;
+    }
+
+    if (drawValidateSlot == frameIndex) {
+        UINT64   commandBytes = UINT64(drawMaxCommands) * sizeof(IndirectDraws::Command);
+        uint32_t indexCount   = uint32_t(std::size(indices));
+
+        D3D12_RANGE readRange { 0, SIZE_T(commandBytes + UINT64(settings.objects) * sizeof(uint32_t)) };
+
+        void* pData = nullptr;
+        if (FAILED(pDrawValidation->Map(0, &readRange, &pData))) {
+            throw std::runtime_error("Could not map draw validation buffer!");
+        }
+
+        const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+
+        std::vector<uint8_t> drawn, expected;
+
+        bool wellFormed = counts[0] <= IndirectDraws::MaxCommands(tested)
+                          && IndirectDraws::Expand(reinterpret_cast<const IndirectDraws::Command*>(pBytes), counts[0],
+                                                   reinterpret_cast<const uint32_t*>(pBytes + commandBytes), tested, indexCount, drawn)
+                          && uint32_t(std::count(drawn.begin(), drawn.end(), uint8_t(1))) == counts[1];
+
+        pDrawValidation->Unmap(0, &noWrite);
+
+        IndirectDraws::Expand(drawReference.data(), drawReferenceCommands, drawReferenceInstances.data(), tested, indexCount, expected);
+
+        uint32_t missing = 0;
+        uint32_t extra   = 0;
+
+        for (uint32_t n = 0; n < tested; ++n) {
+            missing += expected[n] && !drawn[n];
+            extra   += drawn[n] && !expected[n];
+        }
+
+        std::cout << "Indirect validation: " << counts[0] << " commands drawing " << counts[1] << " of " << tested << " objects, "
+                  << (wellFormed ? "well formed" : "malformed") << "; against the CPU frustum test " << extra << " extra, " << missing
+                  << " missing" << (drawValidateHiZ ? " (Hi-Z occluded)" : "") << std::endl;
+
+        validationFailed |= !wellFormed || extra > 0;
+
+        drawValidateSlot = UINT(-1);
+    }
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (drawStatFrames == 0 || (now - drawStatStart) < std::chrono::seconds(1)) {
+        return;
+    }
+
+    std::cout << "Indirect: " << drawStatCommands / drawStatFrames << " draws, " << drawStatVisible / drawStatFrames << " of "
+              << drawStatTested / drawStatFrames << " objects visible (" << 100.0 * double(drawStatVisible) / double(drawStatTested) << "%)" << std::endl;
+
+    drawStatFrames   = 0;
+    drawStatCommands = 0;
+    drawStatVisible  = 0;
+    drawStatTested   = 0;
+    drawStatStart    = now;
+}
+
+//
+// Hands the mip chain over from the compute queue once it has finished. Returns true on the
+// frame that has to transition the texture for pixel shader reads.
+//
+bool Harmony::AcquireTexture() {
+    if (textureAcquired || !scheduler.IsComplete({ QUEUE_COMPUTE, mipsReadyValue })) {
+        return false;
+    }
+
+    // already complete, but orders the graphics queue after the compute writes
+    pCommandQueue->Wait(pComputeFence, mipsReadyValue);
+
+    textureAcquired = true;
+    initQ.Finalize();
+
+    return true;
+}
+
+//
+// --hiz: CullHiZ over the boxes of this frame's visible list, against the pyramid of the frame before
+// and the view projection it was drawn with. The count is reset by copying the zero header of the
+// slot's boxes over it, and copied back for CollectHiZ. Returns false if there was nothing to test.
+//
+bool Harmony::RecordHiZCull() {
+    hizTested[frameIndex] = 0;
+
+    if (!pHiZPyramid || !textureAcquired || hizBuilt == 0 || visibleObjects == 0 || settings.hizReduction == DepthPyramid::Reduction::Min) {
+        return false;
+    }
+
+    UINT64 slotBoxes    = UINT64(settings.objects) + 1;
+    UINT64 resultOffset = frameIndex * slotBoxes * sizeof(uint32_t);
+
+    D3D12_RESOURCE_BARRIER before[2] = {
+        TransitionBarrier(pHiZResults, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+    };
+
+    pCommandList->ResourceBarrier(2, before);
+    pCommandList->CopyBufferRegion(pHiZResults, resultOffset, pHiZBoxes, frameIndex * slotBoxes * sizeof(HiZBox), sizeof(uint32_t));
+
+    D3D12_RESOURCE_BARRIER toUav = TransitionBarrier(pHiZResults, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    pCommandList->ResourceBarrier(1, &toUav);
+
+    // keep in sync with the CB of Cull.hlsl, up to boxCount
+    struct {
+        XMFLOAT4X4 viewProj;
+        uint32_t   depthSize[2];
+        uint32_t   levelCount;
+        uint32_t   reduction;
+        uint32_t   boxCount;
+    } constants {
+        .viewProj   = hizPyramidViewProj,
+        .depthSize  = { WINDOW_WIDTH, WINDOW_HEIGHT },
+        .levelCount = hizLevels,
+        .reduction  = uint32_t(settings.hizReduction),
+        .boxCount   = visibleObjects
+    };
+
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+
+    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+    pCommandList->SetComputeRootSignature(pCsRootSignature);
+    pCommandList->SetPipelineState(pHiZCullPipelineState);
+    pCommandList->SetComputeRoot32BitConstants(0, sizeof(constants) / 4, &constants, 0);
+    pCommandList->SetComputeRootDescriptorTable(1, hizCullSrvs[frameIndex]);
+    pCommandList->SetComputeRootDescriptorTable(2, hizCullUavs[frameIndex]);
+    pCommandList->Dispatch((visibleObjects + 63) / 64, 1, 1);
+
+    D3D12_RESOURCE_BARRIER after[2] = {
+        TransitionBarrier(pHiZResults, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON),
+    };
+
+    pCommandList->ResourceBarrier(2, after);
+    pCommandList->CopyBufferRegion(pHiZReadback, frameIndex * sizeof(uint32_t), pHiZResults, resultOffset, sizeof(uint32_t));
+
+    D3D12_RESOURCE_BARRIER toCommon = TransitionBarrier(pHiZResults, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON);
+    pCommandList->ResourceBarrier(1, &toCommon);
+
+    hizTested[frameIndex] = visibleObjects;
+
+    return true;
+}
+
+//
+// --hiz: GenHiZ over the depth buffer the frame has just drawn, in one dispatch of a group per 32x32
+// level 0 texels. HIZ_VALIDATE_FRAME also copies the depth buffer and the pyramid out for CollectHiZ.
+//
+void Harmony::RecordHiZBuild() {
+    D3D12_RESOURCE_BARRIER before[3] = {
+        TransitionBarrier(pDepthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        TransitionBarrier(pHiZScratch, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+    };
+
+    pCommandList->ResourceBarrier(3, before);
+
+    // keep in sync with the CB of Mipgen.hlsl, after texelSize
+    uint32_t constants[5] = { WINDOW_WIDTH, WINDOW_HEIGHT, hizLevels, uint32_t(settings.hizReduction), hizGroupsX * hizGroupsY };
+
+    pCommandList->SetComputeRootSignature(pCsRootSignature);
+    pCommandList->SetPipelineState(pHiZGenPipelineState);
+    pCommandList->SetComputeRoot32BitConstants(0, 5, constants, 2);
+    pCommandList->SetComputeRootDescriptorTable(1, hizGenSrv);
+    pCommandList->SetComputeRootDescriptorTable(2, hizGenUavs);
+    pCommandList->Dispatch(hizGroupsX, hizGroupsY, 1);
+
+    hizPyramidViewProj = hizViewProj;
+    hizBuilt          += 1;
+
+    bool validate = hizBuilt == HIZ_VALIDATE_FRAME;
+
+    D3D12_RESOURCE_STATES state = validate ? D3D12_RESOURCE_STATE_COPY_SOURCE : D3D12_RESOURCE_STATE_COMMON;
+
+    D3D12_RESOURCE_BARRIER after[3] = {
+        TransitionBarrier(pDepthBuffer, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, state),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, state),
+        TransitionBarrier(pHiZScratch, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON),
+    };
+
+    pCommandList->ResourceBarrier(3, after);
+
+    if (!validate) {
+        return;
+    }
+
+    for (uint32_t i = 0; i <= hizLevels; ++i) {
+        D3D12_TEXTURE_COPY_LOCATION srcLoc {
+            .pResource        = i == 0 ? pDepthBuffer : pHiZPyramid,
+            .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+            .SubresourceIndex = i == 0 ? 0 : i - 1
+        };
+
+        D3D12_TEXTURE_COPY_LOCATION dstLoc {
+            .pResource        = pHiZValidation,
+            .Type             = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+            .PlacedFootprint  = hizFootprints[i]
+        };
+
+        pCommandList->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
+    }
+
+    D3D12_RESOURCE_BARRIER toCommon[2] = {
+        TransitionBarrier(pDepthBuffer, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+    };
+
+    pCommandList->ResourceBarrier(2, toCommon);
+
+    hizValidateSlot = frameIndex;
+}
+
+//
+// --draw=indirect: CullDraws over the boxes of every active object, with --hiz also against the
+// pyramid of the frame before. The counts are reset by copying the zero header of the slot's boxes
+// over them. INDIRECT_VALIDATE_FRAME also builds the CPU reference for CollectIndirect. Returns
+// false if there was nothing to cull, and then nothing is drawn.
+//
+bool Harmony::RecordIndirectCull() {
+    drawTested[frameIndex] = 0;
+
+    if (!pDrawCounts || !textureAcquired || activeObjects == 0) {
+        return false;
+    }
+
+    bool   hizEnabled  = pHiZPyramid && hizBuilt > 0 && settings.hizReduction != DepthPyramid::Reduction::Min;
+    UINT64 slotBoxes   = UINT64(settings.objects) + 1;
+    UINT64 countOffset = frameIndex * 2 * sizeof(uint32_t);
+
+    D3D12_RESOURCE_BARRIER before[4] = {
+        TransitionBarrier(pDrawCounts, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+        TransitionBarrier(pDrawCommands, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        TransitionBarrier(pDrawInstances, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+    };
+
+    pCommandList->ResourceBarrier(hizEnabled ? 4 : 3, before);
+    pCommandList->CopyBufferRegion(pDrawCounts, countOffset, pDrawBoxes, frameIndex * slotBoxes * sizeof(HiZBox), 2 * sizeof(uint32_t));
+
+    D3D12_RESOURCE_BARRIER toUav = TransitionBarrier(pDrawCounts, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+    pCommandList->ResourceBarrier(1, &toUav);
+
+    // keep in sync with the CB of Cull.hlsl
+    struct {
+        XMFLOAT4X4     viewProj;
+        uint32_t       depthSize[2];
+        uint32_t       levelCount;
+        uint32_t       reduction;
+        uint32_t       boxCount;
+        uint32_t       hizEnabled;
+        uint32_t       indexCount;
+        uint32_t       padding;
+        Frustum::Plane frustum[Frustum::PLANE_COUNT];
+    } constants {
+        .viewProj   = hizPyramidViewProj,
+        .depthSize  = { WINDOW_WIDTH, WINDOW_HEIGHT },
+        .levelCount = hizLevels,
+        .reduction  = uint32_t(settings.hizReduction),
+        .boxCount   = activeObjects,
+        .hizEnabled = hizEnabled ? 1u : 0u,
+        .indexCount = uint32_t(std::size(indices)),
+        .padding    = 0
+    };
+
+    std::copy(std::begin(drawFrustum.planes), std::end(drawFrustum.planes), constants.frustum);
+
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+
+    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+    pCommandList->SetComputeRootSignature(pCsRootSignature);
+    pCommandList->SetPipelineState(pCullDrawsPipelineState);
+    pCommandList->SetComputeRoot32BitConstants(0, sizeof(constants) / 4, &constants, 0);
+    pCommandList->SetComputeRootDescriptorTable(1, drawSrvs[frameIndex]);
+    pCommandList->SetComputeRootDescriptorTable(2, drawUavs[frameIndex]);
+    pCommandList->Dispatch(IndirectDraws::MaxCommands(activeObjects), 1, 1);
+
+    D3D12_RESOURCE_BARRIER after[4] = {
+        TransitionBarrier(pDrawCounts, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+        TransitionBarrier(pDrawCommands, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+        TransitionBarrier(pDrawInstances, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE),
+        TransitionBarrier(pHiZPyramid, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COMMON),
+    };
+
+    pCommandList->ResourceBarrier(hizEnabled ? 4 : 3, after);
+
+    drawTested[frameIndex] = activeObjects;
+    drawFrames            += 1;
+
+    if (drawFrames == INDIRECT_VALIDATE_FRAME) {
+        drawReferenceCommands = IndirectDraws::Generate(CullingBoxes(culling), drawFrustum, activeObjects, uint32_t(std::size(indices)), drawReference.data(), drawReferenceInstances.data());
+        drawValidateHiZ       = hizEnabled;
+        drawValidateSlot      = frameIndex;
+    }
+
+    return true;
+}
+
+//
+// --draw=indirect: after the draws, the counts go back for CollectIndirect, and at
+// INDIRECT_VALIDATE_FRAME the commands and instance slots too.
+//
+void Harmony::RecordIndirectReadback() {
+    UINT64 commandBytes  = UINT64(drawMaxCommands) * sizeof(IndirectDraws::Command);
+    UINT64 instanceBytes = UINT64(settings.objects) * sizeof(uint32_t);
+    UINT64 countBytes    = 2 * sizeof(uint32_t);
+
+    D3D12_RESOURCE_BARRIER before[3] = {
+        TransitionBarrier(pDrawCounts, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        TransitionBarrier(pDrawCommands, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, D3D12_RESOURCE_STATE_COPY_SOURCE),
+        TransitionBarrier(pDrawInstances, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE),
+    };
+
+    pCommandList->ResourceBarrier(3, before);
+    pCommandList->CopyBufferRegion(pDrawReadback, frameIndex * countBytes, pDrawCounts, frameIndex * countBytes, countBytes);
+
+    if (drawValidateSlot == frameIndex) {
+        pCommandList->CopyBufferRegion(pDrawValidation, 0, pDrawCommands, frameIndex * commandBytes, commandBytes);
+        pCommandList->CopyBufferRegion(pDrawValidation, commandBytes, pDrawInstances, frameIndex * instanceBytes, instanceBytes);
+    }
+
+    D3D12_RESOURCE_BARRIER after[3] = {
+        TransitionBarrier(pDrawCounts, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+        TransitionBarrier(pDrawCommands, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+        TransitionBarrier(pDrawInstances, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON),
+    };
+
+    pCommandList->ResourceBarrier(3, after);
+}
+
+void Harmony::PopulateCommandList(bool acquireTexture) {
+    ID3D12PipelineState* pDrawPipelineState = settings.drawPath == DrawPath::Instanced ? pInstancedPipelineState
+                                              : settings.drawPath == DrawPath::Indirect ? pIndirectPipelineState : pPipelineState;
+
+    pCommandAllocators[frameIndex]->Reset();
+    pCommandList->Reset(pCommandAllocators[frameIndex], pDrawPipelineState);
+
+    // --draw=indirect: the draws themselves out of this frame's boxes; --hiz: the boxes of the visible
+    // list against the last frame's pyramid
+    bool culled = settings.drawPath == DrawPath::Indirect ? RecordIndirectCull() : RecordHiZCull();
+
+    if (culled) {
+        pCommandList->SetPipelineState(pDrawPipelineState);
+    }
+
+    pCommandList->SetGraphicsRootSignature(pRootSignature);
+
+    D3D12_RESOURCE_BARRIER rtBarrier {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pRenderTargets[backBufferIndex],
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_PRESENT,
+            .StateAfter  = D3D12_RESOURCE_STATE_RENDER_TARGET,
+        }
+    };
+
+    pCommandList->ResourceBarrier(1, &rtBarrier);
+
+    D3D12_RESOURCE_BARRIER dsBarrier {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pDepthBuffer,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
+            .StateAfter  = D3D12_RESOURCE_STATE_DEPTH_WRITE,
+        }
+    };
+
+    pCommandList->ResourceBarrier(1, &dsBarrier);
+
+    if (acquireTexture) {
+        D3D12_RESOURCE_BARRIER texBarrier {
+            .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+            .Transition = {
+                .pResource   = pTexture,
+                .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                .StateBefore = D3D12_RESOURCE_STATE_COMMON,
+                .StateAfter  = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+            }
+        };
+
+        pCommandList->ResourceBarrier(1, &texBarrier);
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE rtHandle = static_cast<D3D12_CPU_DESCRIPTOR_HANDLE>(pRtvHeap->GetCPUDescriptorHandleForHeapStart().ptr + backBufferIndex * rtvDescriptorSize);
+    D3D12_CPU_DESCRIPTOR_HANDLE dsHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+
+    pCommandList->OMSetRenderTargets(1, &rtHandle, FALSE, &dsHandle);
+
+    pCommandList->RSSetViewports(1, &viewport);
+    pCommandList->RSSetScissorRects(1, &scissorRect);
+
+    const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    pCommandList->ClearRenderTargetView(rtHandle, clearColor, 0, nullptr);
+    pCommandList->ClearDepthStencilView(dsHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+    
+    pCommandList->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    D3D12_INDEX_BUFFER_VIEW ibv {
+        pIndexBuffer->GetGPUVirtualAddress(),
+        sizeof indices,
+        DXGI_FORMAT_R32_UINT,
+    };
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{
+        pVertexBuffer->GetGPUVirtualAddress(),
+        sizeof vertices,
+        sizeof Vertex
+    };
+
+    pCommandList->IASetIndexBuffer(&ibv);
+    pCommandList->IASetVertexBuffers(0, 1, &vbv);
+
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+
+    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+
+    pCommandList->SetGraphicsRootDescriptorTable(1, pSrvHeap->GetGPUDescriptorHandleForHeapStart());
+    pCommandList->SetGraphicsRootDescriptorTable(2, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+
+    // nothing to sample until the mip chain has been handed over
+    if (textureAcquired) {
+        pCommandList->EndQuery(pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2);
+
+        if (settings.drawPath == DrawPath::Instanced) {
+            pCommandList->SetGraphicsRootShaderResourceView(3, pInstanceBuffer->GetGPUVirtualAddress() + UINT64(frameIndex) * settings.objects * sizeof(InstanceData));
+            pCommandList->DrawIndexedInstanced(12, visibleObjects, 0, 0, 0);
+        }
+        else if (settings.drawPath == DrawPath::Indirect) {
+            // as many commands as CullDraws appended, the count buffer says
+            if (drawTested[frameIndex] > 0) {
+                UINT64 commandOffset = UINT64(frameIndex) * drawMaxCommands * sizeof(IndirectDraws::Command);
+
+                pCommandList->SetGraphicsRootShaderResourceView(3, pInstanceBuffer->GetGPUVirtualAddress() + UINT64(frameIndex) * settings.objects * sizeof(InstanceData));
+                pCommandList->SetGraphicsRootShaderResourceView(5, pDrawInstances->GetGPUVirtualAddress() + UINT64(frameIndex) * settings.objects * sizeof(uint32_t));
+                pCommandList->ExecuteIndirect(pCommandSignature, IndirectDraws::MaxCommands(drawTested[frameIndex]), pDrawCommands, commandOffset,
+                                              pDrawCounts, UINT64(frameIndex) * 2 * sizeof(uint32_t));
+            }
+        }
+        else {
+            D3D12_GPU_VIRTUAL_ADDRESS cbAddress = pConstantBuffer->GetGPUVirtualAddress() + UINT64(frameIndex) * settings.objects * sizeof(UniformBuffer);
+
+            for (uint32_t i = 0; i < visibleObjects; ++i) {
+                pCommandList->SetGraphicsRootConstantBufferView(0, cbAddress + i * sizeof(UniformBuffer));
+                pCommandList->DrawIndexedInstanced(12, 1, 0, 0, 0);
+            }
+        }
+
+        pCommandList->EndQuery(pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2 + 1);
+        pCommandList->ResolveQueryData(pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, frameIndex * 2, 2, pTimestampReadback, frameIndex * 2 * sizeof(UINT64));
+
+        frameObjects[frameIndex] = visibleObjects;
+    }
+
+    // --draw=indirect: the draws' counts back for CollectIndirect, which leaves their buffers in COMMON
+    if (drawTested[frameIndex] > 0) {
+        RecordIndirectReadback();
+    }
+
+    // --hiz: the pyramid of what was just drawn, which leaves the depth buffer in COMMON too
+    if (pHiZPyramid && textureAcquired) {
+        RecordHiZBuild();
+    }
+    else {
+        std::swap(dsBarrier.Transition.StateBefore, dsBarrier.Transition.StateAfter);
+        pCommandList->ResourceBarrier(1, &dsBarrier);
+    }
+
+    std::swap(rtBarrier.Transition.StateBefore, rtBarrier.Transition.StateAfter);
+    pCommandList->ResourceBarrier(1, &rtBarrier);
+
+    pCommandList->Close();
+}
+
+//
+// The per-frame slots come from the scheduler and the render target from the swap chain, so the
+// two no longer have to advance in lockstep.
+//
+void Harmony::MoveToNextFrame() {
+    scheduler.Signal(QUEUE_GRAPHICS);
+    scheduler.NextFrame();
+
+    frameIndex      = scheduler.GetFrameSlot();
+    backBufferIndex = pSwapChain4->GetCurrentBackBufferIndex();
+}
+
+void Harmony::WaitForGpu() {
+    scheduler.WaitIdle();
+}
+
+#pragma endregion
+
+#pragma region Benchmarks
+
+// every benchmark runs on all hardware threads, at least 2: the calling thread and threads - 1 workers
+static uint32_t InitBenchJobs(JobSystem& jobSystem) {
+    uint32_t threads = (std::max)(std::thread::hardware_concurrency(), 2u);
+
+    jobSystem.Init(threads - 1);
+
+    return threads;
+}
+
+// ms per run of fn, repeated for at least 200 ms
+static double TimeMs(const std::function<void()>& fn) {
+    using namespace std::chrono;
+
+    uint64_t runs  = 0;
+    auto     begin = steady_clock::now();
+
+    do {
+        fn();
+        runs += 1;
+    } while (steady_clock::now() - begin < milliseconds(200));
+
+    return duration<double, std::milli>(steady_clock::now() - begin).count() / runs;
+}
+
+//
+// Random TRS objects in a 200 unit cube, scaled 1 to 3: the scene of the benchmarks below
+//
+static void RandomScene(TransformSystem& transforms, uint32_t count, uint32_t seed) {
+    std::mt19937                          rng(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    transforms.Resize(count);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        XMFLOAT4 rotation;
+        XMStoreFloat4(&rotation, XMQuaternionNormalize(XMVectorSet(unit(rng), unit(rng), unit(rng), unit(rng))));
+
+        transforms.Set(i, { unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f }, rotation,
+                       { unit(rng) + 2.0f, unit(rng) + 2.0f, unit(rng) + 2.0f });
+    }
+}
+
+//
+// --bench=transforms: world and MVP matrices for 1K to 100K objects with random TRS, written at the
+// constant buffer stride. Compares an XMMATRIX product per object against the SoA kernel on one
+// thread and over the job system; rates are matrices per second per thread. Also checks the
+// kernel against the XMMATRIX path, false past a relative error of MAX_ERROR.
+//
+static bool BenchTransforms() {
+    const float MAX_ERROR = 1e-4f;
+
+    JobSystem jobSystem;
+
+    const uint32_t threads = InitBenchJobs(jobSystem);
+
+    bool passed = true;
+
+    std::cout << "Transforms: " << TransformSystem::KERNEL << " kernel, " << threads << " threads, M matrices/s per thread" << std::endl;
+
+    for (uint32_t count : { 1000u, 10000u, 100000u }) {
+        TransformSystem transforms;
+        RandomScene(transforms, count, 42);
+
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, XMMatrixLookAtLH(XMVectorSet(0.0f, 50.0f, -150.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+                                   * XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f));
+
+        std::vector<UniformBuffer> reference(count);
+        std::vector<UniformBuffer> output(count);
+
+        uint8_t* pReference = reinterpret_cast<uint8_t*>(reference.data());
+        uint8_t* pOutput    = reinterpret_cast<uint8_t*>(output.data());
+
+        // matrices per second
+        auto Rate = [&](const std::function<void()>& fn) {
+            return count * 1000.0 / TimeMs(fn);
+        };
+
+        double perObject = Rate([&] { transforms.ComputeReference(0, count, viewProj, pReference, sizeof(UniformBuffer)); });
+        double kernel    = Rate([&] { transforms.Compute(0, count, viewProj, pOutput, sizeof(UniformBuffer)); });
+        double parallel  = Rate([&] { transforms.Compute(jobSystem, Harmony::TRANSFORM_GRAIN, viewProj, pOutput, sizeof(UniformBuffer)); });
+
+        float maxError = 0.0f;
+
+        for (uint32_t i = 0; i < count; ++i) {
+            const float* pA = reinterpret_cast<const float*>(&reference[i].mvp);
+            const float* pB = reinterpret_cast<const float*>(&output[i].mvp);
+
+            for (uint32_t e = 0; e < 16; ++e) {
+                maxError = (std::max)(maxError, fabsf(pA[e] - pB[e]) / (std::max)(fabsf(pA[e]), 1.0f));
+            }
+        }
+
+        std::cout << "  " << count << " objects: XMMATRIX " << perObject / 1e6 << ", SoA " << kernel / 1e6 << " ("
+                  << kernel / perObject << "x), SoA on jobs " << parallel / threads / 1e6 << " per thread ("
+                  << parallel / 1e6 << " total), max rel error " << maxError << (maxError <= MAX_ERROR ? "" : ", TOO LARGE") << std::endl;
+
+        passed &= maxError <= MAX_ERROR;
+    }
+
+    jobSystem.Destroy();
+
+    return passed;
+}
+
+//
+// --bench=cull: sphere and AABB frustum tests over 1K to 1M random objects (about 90% of them
+// visible). Compares the one object at a time reference against the SIMD kernel on one thread and
+// over the job system, in M objects culled per second. False if the visible lists differ.
+//
+static bool BenchCull() {
+    JobSystem jobSystem;
+
+    const uint32_t threads = InitBenchJobs(jobSystem);
+
+    bool passed = true;
+
+    std::cout << "Culling: " << TransformSystem::KERNEL << " kernel, " << threads << " threads, M objects/s" << std::endl;
+
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4(&viewProj, XMMatrixLookAtLH(XMVectorSet(0.0f, 50.0f, -150.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+                               * XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f));
+
+    Frustum frustum = Frustum::FromViewProj(viewProj.m);
+
+    for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u }) {
+        TransformSystem transforms;
+        RandomScene(transforms, count, 42);
+
+        CullingSystem culling;
+        culling.Resize(count);
+        culling.UpdateBounds(transforms, 0, count, { 0.0f, 0.5f, 0.0f }, { 0.5f, 0.5f, 0.5f });
+
+        std::vector<uint32_t> reference(count), simd(count), parallel(count);
+
+        // objects per second
+        auto Rate = [&](const std::function<void()>& fn) {
+            return count * 1000.0 / TimeMs(fn);
+        };
+
+        for (CullingSystem::Test test : { CullingSystem::Test::Sphere, CullingSystem::Test::Box }) {
+            uint32_t referenceVisible = 0, simdVisible = 0, parallelVisible = 0;
+
+            double scalar = Rate([&] { referenceVisible = culling.CullReference(test, frustum, 0, count, reference.data()); });
+            double kernel = Rate([&] { simdVisible = culling.Cull(test, frustum, 0, count, simd.data()); });
+            double jobs   = Rate([&] { parallelVisible = culling.Cull(jobSystem, Harmony::TRANSFORM_GRAIN, test, frustum, count, parallel.data()); });
+
+            bool match = simdVisible == referenceVisible && parallelVisible == referenceVisible
+                      && std::equal(reference.begin(), reference.begin() + referenceVisible, simd.begin())
+                      && std::equal(reference.begin(), reference.begin() + referenceVisible, parallel.begin());
+
+            std::cout << "  " << count << " objects, " << (test == CullingSystem::Test::Sphere ? "spheres" : "AABBs") << ": "
+                      << referenceVisible << " visible, scalar " << scalar / 1e6 << ", SIMD " << kernel / 1e6 << " ("
+                      << kernel / scalar << "x), SIMD on jobs " << jobs / 1e6 << (match ? "" : ", VISIBLE LISTS DIFFER") << std::endl;
+
+            passed &= match;
+        }
+    }
+
+    jobSystem.Destroy();
+
+    return passed;
+}
+
+//
+// --bench=bvh: the hierarchy against the linear SIMD cull at 1K to 1M random objects. Build is the
+// SAH build on this thread and on the builder thread; refit follows every object moving a little,
+// with and without rotations, and shows the SAH cost drift. Frustum queries run for a wide and a
+// narrow view against CullingSystem::Cull on one thread and on jobs; ray and box queries against a
+// loop over all objects. All results are checked against the linear ones; false if any differ.
+//
+static bool BenchBvh() {
+    using namespace std::chrono;
+
+    using Float3 = BoundingVolumeHierarchy::Float3;
+
+    JobSystem jobSystem;
+
+    const uint32_t threads = InitBenchJobs(jobSystem);
+
+    bool passed = true;
+
+    std::cout << "BVH: " << TransformSystem::KERNEL << " linear kernel, " << threads << " threads" << std::endl;
+
+    const XMFLOAT3 meshCenter = { 0.0f, 0.5f, 0.0f };
+    const XMFLOAT3 meshExtent = { 0.5f, 0.5f, 0.5f };
+
+    const XMVECTOR eye = XMVectorSet(0.0f, 50.0f, -150.0f, 0.0f);
+    const XMMATRIX view = XMMatrixLookAtLH(eye, XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+    XMFLOAT4X4 wide, narrow;
+    XMStoreFloat4x4(&wide, view * XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f));
+    XMStoreFloat4x4(&narrow, view * XMMatrixPerspectiveFovLH(XMConvertToRadians(10.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f));
+
+    for (uint32_t count : { 1000u, 10000u, 100000u, 1000000u }) {
+        TransformSystem transforms;
+        RandomScene(transforms, count, 42);
+
+        CullingSystem culling;
+        culling.Resize(count);
+        culling.UpdateBounds(transforms, 0, count, meshCenter, meshExtent);
+
+        BoundingVolumeHierarchy bvh;
+        bvh.Init();
+
+        double buildMs = TimeMs([&] { bvh.Build(CullingBoxes(culling), count); });
+        float  built   = bvh.GetBuiltCost();
+
+        auto asyncStart = steady_clock::now();
+
+        bvh.RequestRebuild(CullingBoxes(culling), count);
+        while (!bvh.ApplyRebuild(CullingBoxes(culling))) {
+            std::this_thread::yield();
+        }
+
+        double asyncMs = duration<double, std::milli>(steady_clock::now() - asyncStart).count();
+
+        // every object drifts up to half a unit per step, 20 steps
+        std::mt19937                          rng(7);
+        std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+        float* pPos[3] = { transforms.Get(TransformSystem::POS_X), transforms.Get(TransformSystem::POS_Y), transforms.Get(TransformSystem::POS_Z) };
+
+        double refitMs = 0.0, rotateMs = 0.0;
+        float  refitCost = 0.0f;
+
+        BoundingVolumeHierarchy rotated;
+        rotated.Build(CullingBoxes(culling), count);
+
+        for (uint32_t s = 0; s < 20; ++s) {
+            for (uint32_t i = 0; i < count; ++i) {
+                for (float* pAxis : pPos) {
+                    pAxis[i] += step(rng);
+                }
+            }
+
+            culling.UpdateBounds(transforms, 0, count, meshCenter, meshExtent);
+
+            auto start = steady_clock::now();
+            bvh.Refit(CullingBoxes(culling), false);
+            auto middle = steady_clock::now();
+            rotated.Refit(CullingBoxes(culling), true);
+            auto end = steady_clock::now();
+
+            refitMs  += duration<double, std::milli>(middle - start).count() / 20;
+            rotateMs += duration<double, std::milli>(end - middle).count() / 20;
+        }
+
+        refitCost = bvh.GetCost();
+
+        std::cout << "  " << count << " objects, " << bvh.GetNodeCount() << " nodes: build " << buildMs << " ms (builder thread "
+                  << asyncMs << " ms), SAH cost " << built << "; 20 moves: refit " << refitMs << " ms cost " << refitCost
+                  << ", refit+rotations " << rotateMs << " ms cost " << rotated.GetCost() << std::endl;
+
+        bvh.Build(CullingBoxes(culling), count);
+
+        std::vector<uint32_t> linear(count), tree(count);
+
+        for (const XMFLOAT4X4* pViewProj : { &wide, &narrow }) {
+            Frustum frustum = Frustum::FromViewProj(pViewProj->m);
+
+            uint32_t linearVisible = 0, treeVisible = 0;
+
+            double linearMs = TimeMs([&] { linearVisible = culling.Cull(CullingSystem::Test::Box, frustum, 0, count, linear.data()); });
+            double jobsMs   = TimeMs([&] { culling.Cull(jobSystem, Harmony::TRANSFORM_GRAIN, CullingSystem::Test::Box, frustum, count, linear.data()); });
+            double treeMs   = TimeMs([&] { treeVisible = bvh.QueryFrustum(frustum, tree.data()); });
+
+            std::sort(tree.begin(), tree.begin() + treeVisible);
+
+            bool match = linearVisible == treeVisible && std::equal(linear.begin(), linear.begin() + linearVisible, tree.begin());
+
+            std::cout << "    frustum " << (pViewProj == &wide ? "wide" : "narrow") << ", " << linearVisible << " visible: linear "
+                      << linearMs << " ms, linear on jobs " << jobsMs << " ms, BVH " << treeMs << " ms"
+                      << (match ? "" : ", VISIBLE LISTS DIFFER") << std::endl;
+
+            passed &= match;
+        }
+
+        // rays from the eye into the cube, boxes of 10 units anywhere in it
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+        const uint32_t RAYS = 256;
+
+        std::vector<Float3> directions(RAYS), boxes(RAYS);
+
+        for (uint32_t r = 0; r < RAYS; ++r) {
+            XMFLOAT3 target = { unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f };
+            directions[r]   = { target.x, target.y - 50.0f, target.z + 150.0f };
+            boxes[r]        = { unit(rng) * 100.0f, unit(rng) * 100.0f, unit(rng) * 100.0f };
+        }
+
+        const float* pCenter[3] = { culling.Get(CullingSystem::CENTER_X), culling.Get(CullingSystem::CENTER_Y), culling.Get(CullingSystem::CENTER_Z) };
+        const float* pExtent[3] = { culling.Get(CullingSystem::EXTENT_X), culling.Get(CullingSystem::EXTENT_Y), culling.Get(CullingSystem::EXTENT_Z) };
+
+        auto ObjectLo = [&](uint32_t i, uint32_t a) { return pCenter[a][i] - pExtent[a][i]; };
+        auto ObjectHi = [&](uint32_t i, uint32_t a) { return pCenter[a][i] + pExtent[a][i]; };
+
+        const Float3 origin = { 0.0f, 50.0f, -150.0f };
+
+        std::vector<float> linearT(RAYS), treeT(RAYS);
 
-        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_CBV;
-        rootParams[0].Descriptor.ShaderRegister           = 0;
-        rootParams[0].Descriptor.RegisterSpace            = 0;
-        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+        double linearRayMs = TimeMs([&] {
+            for (uint32_t r = 0; r < RAYS; ++r) {
+                const float o[3]   = { origin.x, origin.y, origin.z };
+                const float inv[3] = { 1.0f / directions[r].x, 1.0f / directions[r].y, 1.0f / directions[r].z };
 
-        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[1];
-        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+                float nearest = FLT_MAX;
 
-        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[2];
-        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+                for (uint32_t i = 0; i < count; ++i) {
+                    float tEnter = 0.0f, tExit = nearest;
 
-        D3D12_ROOT_SIGNATURE_DESC rDesc {
-            .NumParameters     = 3,
-            .pParameters       = rootParams,
-            .NumStaticSamplers = 0,
-            .pStaticSamplers   = nullptr,
-            .Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
-        };
+                    for (uint32_t a = 0; a < 3; ++a) {
+                        float t0 = (ObjectLo(i, a) - o[a]) * inv[a], t1 = (ObjectHi(i, a) - o[a]) * inv[a];
+                        tEnter = (std::max)(tEnter, (std::min)(t0, t1));
+                        tExit  = (std::min)(tExit, (std::max)(t0, t1));
+                    }
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> errBlob;
+                    if (tEnter <= tExit) {
+                        nearest = tEnter;
+                    }
+                }
 
-        // FIXME: Root signature version 1_1 not working
-        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
-            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
-        }
+                linearT[r] = nearest;
+            }
+        });
 
-        ComPtr<ID3D12RootSignature> rs;
-        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rs)))) {
-            throw std::runtime_error("Could not create root signature!");
-        }
+        double treeRayMs = TimeMs([&] {
+            for (uint32_t r = 0; r < RAYS; ++r) {
+                uint32_t object = 0;
+                float    t      = FLT_MAX;
 
-        pRootSignature = rs.Detach();
-        delQ.Append([cRootSignature = pRootSignature] {
-            cRootSignature->Release();
+                treeT[r] = bvh.Raycast(origin, directions[r], FLT_MAX, object, t) ? t : FLT_MAX;
+            }
         });
-    }
 
-    // Graphics pipeline
-    {
-        ComPtr<ID3D12PipelineState> pso;
-        std::vector<char>           vs, ps;
-        
-        UINT compileFlags = 0;
+        uint32_t rayMismatches = 0;
 
-        if constexpr (enableDebugLayers) {
-            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        for (uint32_t r = 0; r < RAYS; ++r) {
+            rayMismatches += linearT[r] == treeT[r] ? 0 : 1;
         }
 
-        //load VS
-        {
-            std::ifstream file("shaders/vs.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load vs.bin!");
-            }
+        uint64_t linearFound = 0, treeFound = 0;
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+        double linearBoxMs = TimeMs([&] {
+            linearFound = 0;
 
-            vs.resize((size_t)filesize);
-            file.read(vs.data(), filesize);
-        }
+            for (const Float3& box : boxes) {
+                for (uint32_t i = 0; i < count; ++i) {
+                    if (ObjectLo(i, 0) <= box.x + 5.0f && ObjectHi(i, 0) >= box.x - 5.0f && ObjectLo(i, 1) <= box.y + 5.0f
+                        && ObjectHi(i, 1) >= box.y - 5.0f && ObjectLo(i, 2) <= box.z + 5.0f && ObjectHi(i, 2) >= box.z - 5.0f) {
+                        linearFound += 1;
+                    }
+                }
+            }
+        });
 
-        // load PS
-        {
-            std::ifstream file("shaders/ps.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load ps.bin!");
+        double treeBoxMs = TimeMs([&] {
+            treeFound = 0;
+
+            for (const Float3& box : boxes) {
+                treeFound += bvh.QueryBox({ box.x - 5.0f, box.y - 5.0f, box.z - 5.0f }, { box.x + 5.0f, box.y + 5.0f, box.z + 5.0f }, tree.data());
             }
+        });
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+        std::cout << "    " << RAYS << " rays: linear " << linearRayMs << " ms, BVH " << treeRayMs << " ms, " << rayMismatches
+                  << " mismatches; " << RAYS << " boxes: linear " << linearBoxMs << " ms, BVH " << treeBoxMs << " ms, "
+                  << (linearFound == treeFound ? "same objects" : "OBJECT COUNTS DIFFER") << std::endl;
 
-            ps.resize((size_t)filesize);
-            file.read(ps.data(), filesize);
-        }
+        passed &= rayMismatches == 0 && linearFound == treeFound;
 
-        D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
-            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            { "COLOR",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        };
+        rotated.Destroy();
+        bvh.Destroy();
+    }
 
-        D3D12_BLEND_DESC blendDesc {
-            .AlphaToCoverageEnable  = FALSE,
-            .IndependentBlendEnable = FALSE
-        };
+    jobSystem.Destroy();
 
-        for (UINT i = 0; i < 8; ++i) {
-            blendDesc.RenderTarget[i] = {
-                FALSE,FALSE,
-                D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-                D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-                D3D12_LOGIC_OP_NOOP,
-                D3D12_COLOR_WRITE_ENABLE_ALL,
-            };
-        }
+    return passed;
+}
 
-        D3D12_RASTERIZER_DESC rastDesc {
-            .FillMode               = D3D12_FILL_MODE_SOLID,
-            .CullMode               = D3D12_CULL_MODE_BACK,
-            .FrontCounterClockwise  = FALSE,
-            .DepthBias              = 0,
-            .DepthBiasClamp         = 0.0f,
-            .SlopeScaledDepthBias   = 0.0f,
-            .DepthClipEnable        = FALSE,
-            .MultisampleEnable      = FALSE,
-            .AntialiasedLineEnable  = FALSE,
-            .ForcedSampleCount      = 0,
-            .ConservativeRaster     = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
-        };
+//
+// A unit cube, each face clockwise seen from outside, and a 20x20 grid of cubes scaled into
+// buildings of random size 10 units apart: the occluders of the occlusion benchmarks, which go on
+// to scatter their boxes with the same generator
+//
+static void CubeMesh(std::vector<XMFLOAT3>& positions, std::vector<uint32_t>& indices) {
+    for (uint32_t corner = 0; corner < 8; ++corner) {
+        positions.push_back({ corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f });
+    }
 
-        D3D12_DEPTH_STENCILOP_DESC defaultStencilOp {
-            .StencilFailOp      = D3D12_STENCIL_OP_KEEP,
-            .StencilDepthFailOp = D3D12_STENCIL_OP_KEEP,
-            .StencilPassOp      = D3D12_STENCIL_OP_KEEP,
-            .StencilFunc        = D3D12_COMPARISON_FUNC_ALWAYS
-        };
+    for (uint32_t axis = 0; axis < 3; ++axis) {
+        for (int side : { -1, 1 }) {
+            uint32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
 
-        D3D12_DEPTH_STENCIL_DESC dsDesc {
-            .DepthEnable      = TRUE,
-            .DepthWriteMask   = D3D12_DEPTH_WRITE_MASK_ALL,
-            .DepthFunc        = D3D12_COMPARISON_FUNC_LESS_EQUAL,
-            .StencilEnable    = FALSE,
-            .StencilReadMask  = 0,
-            .StencilWriteMask = 0,
-            .FrontFace        = defaultStencilOp,
-            .BackFace         = defaultStencilOp
-        };
+            if (side < 0) {
+                std::swap(u, v);
+            }
 
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc {
-            .pRootSignature        = pRootSignature,
-            .VS                    = { .pShaderBytecode = vs.data(), .BytecodeLength = vs.size() },
-            .PS                    = { .pShaderBytecode = ps.data(), .BytecodeLength = ps.size() },
-            .BlendState            = blendDesc,
-            .SampleMask            = D3D12_DEFAULT_SAMPLE_MASK,
-            .RasterizerState       = rastDesc,
-            .DepthStencilState     = dsDesc,
-            .InputLayout           = { .pInputElementDescs = inputElementDesc, .NumElements = 3 },
-            .IBStripCutValue       = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED,
-            .PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
-            .NumRenderTargets      = 1,
-            .RTVFormats            = { DXGI_FORMAT_R8G8B8A8_UNORM },
-            .DSVFormat             = DXGI_FORMAT_D32_FLOAT,
-            .SampleDesc            = { .Count = 1, .Quality = 0 },
-            .NodeMask              = 0,
-            .CachedPSO             = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
-            .Flags                 = D3D12_PIPELINE_STATE_FLAG_NONE
-        };
+            auto Corner = [&](int du, int dv) {
+                return (side > 0 ? 1u << axis : 0u) | (du > 0 ? 1u << u : 0u) | (dv > 0 ? 1u << v : 0u);
+            };
 
-        if(FAILED(pDevice9->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
-            throw std::runtime_error("Could not create pipeline state object!");
+            for (uint32_t index : { Corner(-1, -1), Corner(1, -1), Corner(1, 1), Corner(-1, -1), Corner(1, 1), Corner(-1, 1) }) {
+                indices.push_back(index);
+            }
         }
+    }
+}
 
-        pPipelineState = pso.Detach();
+struct Building
+{
+    XMFLOAT3 center;
+    XMFLOAT3 extent;
+};
 
-        delQ.Append([cPipelineState = pPipelineState] {
-            cPipelineState->Release();
-            });
-    }
+static std::vector<Building> CityScene(std::mt19937& rng) {
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-    // Compute root signature (has 3 params and 1 root constant)
-    {
-        D3D12_ROOT_PARAMETER rootParams[4];
+    std::vector<Building> buildings;
 
-        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-        };
+    for (int z = 0; z < 20; ++z) {
+        for (int x = 0; x < 20; ++x) {
+            float height = 3.0f + unit(rng) * 17.0f;
 
-        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[0].Constants.ShaderRegister            = 0;
-        rootParams[0].Constants.RegisterSpace             = 0;
-        rootParams[0].Constants.Num32BitValues            = 2;
-        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+            buildings.push_back({ { x * 10.0f - 95.0f, height, z * 10.0f - 95.0f }, { 2.0f + unit(rng) * 2.5f, height, 2.0f + unit(rng) * 2.5f } });
+        }
+    }
 
-        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[0];
-        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+    return buildings;
+}
 
-        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[1];
-        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+//
+// --bench=occlusion: the masked occlusion culler at 320x180 on synthetic scenes of box occluders.
+// A thick wall checks the basic cases. A city of random buildings is seen from street level, with
+// 100K small boxes scattered through it. The AVX2 coverage has to match the scalar coverage, and a
+// depth buffer with a depth per pixel from the same triangles has to show every box the culler
+// drops as hidden. Times setup and rasterization on one thread and on jobs, and the box tests.
+// False if any of the checks fails.
+//
+static bool BenchOcclusion() {
+    JobSystem jobSystem;
 
-        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[2];
-        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+    const uint32_t threads = InitBenchJobs(jobSystem);
 
-        D3D12_ROOT_SIGNATURE_DESC rDesc {
-            .NumParameters     = 4,
-            .pParameters       = rootParams,
-            .NumStaticSamplers = 0,
-            .pStaticSamplers   = nullptr,
-            .Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE
-        };
+    bool passed = true;
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> errBlob;
+#if defined(__AVX2__)
+    std::cout << "Occlusion: AVX2 coverage, " << threads << " threads" << std::endl;
+#else
+    std::cout << "Occlusion: scalar coverage, " << threads << " threads" << std::endl;
+#endif
 
-        // FIXME: Root signature version 1_1 not working
-        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
-            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
-        }
+    std::vector<XMFLOAT3> cube;
+    std::vector<uint32_t> cubeIndices;
+    CubeMesh(cube, cubeIndices);
 
-        ComPtr<ID3D12RootSignature> cs;
-        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&cs)))) {
-            throw std::runtime_error("Could not create root signature!");
-        }
+    auto AddBox = [&](OcclusionCuller& culler, const XMFLOAT3& center, const XMFLOAT3& extent, const XMMATRIX& viewProj) {
+        XMFLOAT4X4 mvp;
+        XMStoreFloat4x4(&mvp, XMMatrixScaling(extent.x, extent.y, extent.z) * XMMatrixTranslation(center.x, center.y, center.z) * viewProj);
 
-        pCsRootSignature = cs.Detach();
-        delQ.Append([cRootSignature = pCsRootSignature] {
-            cRootSignature->Release();
-        });
-    }
+        culler.AddOccluder(mvp.m, &cube[0].x, sizeof(XMFLOAT3), cubeIndices.data(), uint32_t(cubeIndices.size()));
+    };
 
-    // Compute pipeline
+    const XMMATRIX projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f);
+
+    // a wall from z = 0 to 10 in front of the camera
     {
-        ComPtr<ID3D12PipelineState> pso;
-        std::vector<char>           cs;
+        XMMATRIX   view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -20.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, view * projection);
 
-        UINT compileFlags = 0;
+        OcclusionCuller culler;
+        culler.Init(320, 180);
 
-        if constexpr (enableDebugLayers) {
-            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-        }
+        AddBox(culler, { 0.0f, 0.0f, 5.0f }, { 10.0f, 10.0f, 5.0f }, view * projection);
+        culler.Rasterize();
 
-        //load CS
+        struct Case
         {
-            std::ifstream file("shaders/mipgen.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load mipgen.bin!");
-            }
+            const char* name;
+            XMFLOAT3    center;
+            bool        visible;
+        };
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+        const Case cases[] = {
+            { "behind",         { 0.0f, 0.0f, 20.0f },    false },
+            { "inside",         { 0.0f, 0.0f, 5.0f },     false },
+            { "in front",       { 0.0f, 0.0f, -5.0f },    true  },
+            { "beside",         { 30.0f, 0.0f, 20.0f },   true  },
+            { "peeking over",   { 0.0f, 25.0f, 30.0f },   true  },
+            { "off screen",     { 200.0f, 0.0f, 20.0f },  false },
+            { "behind the eye", { 0.0f, 0.0f, -30.0f },   true  },
+        };
 
-            cs.resize((size_t)filesize);
-            file.read(cs.data(), filesize);
-        }
+        const XMFLOAT3 extent = { 1.0f, 1.0f, 1.0f };
 
-        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc {
-            .pRootSignature = pCsRootSignature,
-            .CS             = { .pShaderBytecode = cs.data(), .BytecodeLength = cs.size() },
-            .NodeMask       = 0,
-            .CachedPSO      = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
-            .Flags          = D3D12_PIPELINE_STATE_FLAG_NONE
-        };
+        uint32_t failed = 0;
 
-        if(FAILED(pDevice9->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
-            throw std::runtime_error("Could not create compute pipeline state object!");
+        for (const Case& c : cases) {
+            if (culler.TestBox(&c.center.x, &extent.x, viewProj.m) != c.visible) {
+                std::cout << "  wall: box " << c.name << " should be " << (c.visible ? "visible" : "culled") << std::endl;
+                failed += 1;
+            }
         }
 
-        pCsPipelineState = pso.Detach();
+        std::cout << "  wall: " << culler.GetTriangleCount() << " of " << cubeIndices.size() / 3 << " triangles front facing, "
+                  << std::size(cases) - failed << " of " << std::size(cases) << " cases right" << std::endl;
 
-        delQ.Append([cPipelineState = pCsPipelineState] {
-            cPipelineState->Release();
-        });
+        passed &= failed == 0;
     }
-}
 
-void Harmony::CreateCommandLists() {
-    for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        if (FAILED(pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&pCommandAllocators[i])))) {
-            throw std::runtime_error("Could not allocate command allocator!");
-        }
-    }
+    // a city block grid of 20x20 buildings, 10 units apart, seen from street level at one end
+    {
+        XMMATRIX   view = XMMatrixLookAtLH(XMVectorSet(5.0f, 2.0f, -110.0f, 0.0f), XMVectorSet(5.0f, 2.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, view * projection);
 
-    ComPtr<ID3D12GraphicsCommandList> cmdList;
-    if (FAILED(pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocators[0], nullptr, IID_PPV_ARGS(&cmdList)))) {
-        throw std::runtime_error("Could not create command list!");
-    }
+        std::mt19937                          rng(11);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-    pCommandList = cmdList.Detach();
-    pCommandList->Close();
+        std::vector<Building> buildings = CityScene(rng);
 
-    delQ.Append([cCommandList = pCommandList, cCommandAllocators = pCommandAllocators] {
-        cCommandList->Release();
+        const uint32_t OCCLUDEES = 100000;
 
-        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-            cCommandAllocators[i]->Release();
+        TransformSystem occludees;
+        occludees.Resize(OCCLUDEES);
+
+        for (uint32_t i = 0; i < OCCLUDEES; ++i) {
+            occludees.Set(i, { unit(rng) * 200.0f - 100.0f, unit(rng) * 10.0f, unit(rng) * 200.0f - 100.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f });
         }
-    });
-}
 
-void Harmony::CreateSyncObjects() {
-    ComPtr<ID3D12Fence> fence;
+        CullingSystem bounds;
+        bounds.Resize(OCCLUDEES);
+        bounds.UpdateBounds(occludees, 0, OCCLUDEES, { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f });
 
-    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
-        throw std::runtime_error("Could not create fence!");
-    }
+        OcclusionCuller culler;
+        culler.Init(320, 180);
 
-    fenceHandle = CreateEventA(nullptr, FALSE, FALSE, "gpuFence");
-    if (!fenceHandle) {
-        throw std::runtime_error("Could not create fence event!");
-    }
+        auto Setup = [&] {
+            culler.Clear();
 
-    pFence = fence.Detach();
+            for (const Building& building : buildings) {
+                AddBox(culler, building.center, building.extent, view * projection);
+            }
+        };
 
-    delQ.Append([cEvent = fenceHandle, cFence = pFence] {
-        cFence->Release();
-        CloseHandle(cEvent);
-    });
-}
+        double setupMs  = TimeMs(Setup);
+        double serialMs = TimeMs([&] { Setup(); culler.Rasterize(); });
+        double jobsMs   = TimeMs([&] { Setup(); culler.Rasterize(jobSystem); });
 
-void Harmony::DownloadDataAndGenMips() {
-    ComPtr<ID3D12GraphicsCommandList>   initCmdlist;
-    ComPtr<ID3D12CommandAllocator>      initCmdAllocator;
-    ComPtr<ID3D12Fence>                 initFence;
+        std::vector<uint32_t> all(OCCLUDEES), serial(OCCLUDEES), parallel(OCCLUDEES);
 
-    HRESULT hr;
-    void*   pData = nullptr;
+        for (uint32_t i = 0; i < OCCLUDEES; ++i) {
+            all[i] = i;
+        }
 
-    hr = pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS (&initFence));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create fence!");
-    }
-    
-    hr = pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS (&initCmdAllocator));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create command allocator!");
-    }
+        uint32_t serialKept = 0, parallelKept = 0;
 
-    hr = pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, initCmdAllocator.Get (), nullptr, IID_PPV_ARGS (&initCmdlist));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create command list!");
-    }
+        const OcclusionCuller::Boxes boxes = CullingBoxes(bounds);
 
-    HANDLE initCompleteEvent = CreateEvent (nullptr, FALSE, FALSE, nullptr);
-    if (initCompleteEvent == NULL) {
-        throw std::runtime_error("Could not create event!");
-    }
+        double testMs     = TimeMs([&] { serial = all; serialKept = culler.Test(boxes, viewProj.m, serial.data(), OCCLUDEES); });
+        double testJobsMs = TimeMs([&] { parallel = all; parallelKept = culler.Test(jobSystem, Harmony::TRANSFORM_GRAIN, boxes, viewProj.m, parallel.data(), OCCLUDEES); });
 
-    UINT   rowPitch     = Align(TEXTURE_WIDTH * sizeof(uint32_t), D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
-    UINT64 textureBytes = rowPitch * TEXTURE_HEIGHT;
+        bool sameLists = serialKept == parallelKept && std::equal(serial.begin(), serial.begin() + serialKept, parallel.begin());
 
-    UINT   meshSize     = sizeof vertices + sizeof indices;
-    UINT64 textureBase  = Align(meshSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        // the culler may keep hidden boxes, but never drop one the reference shows
+        std::vector<float> depth;
+        culler.RasterizeReference(depth);
 
-    UINT64 totalBytes   = textureBase + textureBytes;
+        uint32_t referenceHidden = 0, wronglyCulled = 0;
+        size_t   next            = 0;
 
-    D3D12_SUBRESOURCE_FOOTPRINT subresFP {
-        .Format   = DXGI_FORMAT_R8G8B8A8_UNORM,
-        .Width    = TEXTURE_WIDTH,
-        .Height   = TEXTURE_HEIGHT,
-        .Depth    = 1,
-        .RowPitch = rowPitch
-    };
+        for (uint32_t i = 0; i < OCCLUDEES; ++i) {
+            bool kept = next < serialKept && serial[next] == i;
+            next     += kept ? 1 : 0;
 
-    D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedSFP{
-        .Offset    = textureBase,
-        .Footprint = subresFP
-    };
+            float center[3] = { boxes.pCenter[0][i], boxes.pCenter[1][i], boxes.pCenter[2][i] };
+            float extent[3] = { boxes.pExtent[0][i], boxes.pExtent[1][i], boxes.pExtent[2][i] };
 
-    D3D12_RESOURCE_DESC bufferDesc {
-        .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-        .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-        .Width      = totalBytes,
-        .Height     = 1,
-        .DepthOrArraySize = 1,
-        .MipLevels  = 1,
-        .Format     = DXGI_FORMAT_UNKNOWN,
-        .SampleDesc = { 1, 0 },
-        .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        .Flags      = D3D12_RESOURCE_FLAG_NONE
-    };
+            bool visible = culler.TestBoxReference(depth, center, extent, viewProj.m);
 
-    D3D12_HEAP_PROPERTIES uploadHeapProps {
-        .Type                   = D3D12_HEAP_TYPE_UPLOAD,
-        .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
-        .CreationNodeMask       = 0,
-        .VisibleNodeMask        = 0
-    };
+            referenceHidden += visible ? 0 : 1;
+            wronglyCulled   += visible && !kept ? 1 : 0;
+        }
 
-    hr = pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pUploadBuffer));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create upload buffer!");
-    }
+        uint32_t culled     = OCCLUDEES - serialKept;
+        uint32_t mismatches = culler.CoverageMismatches(1000, 5);
 
-    if (FAILED(pUploadBuffer->Map(0, 0, &pData)) || pData == nullptr) {
-        throw std::runtime_error("Could not map upload buffer!");
+        std::cout << "  city: " << buildings.size() << " buildings, " << culler.GetTriangleCount() << " triangles: setup " << setupMs
+                  << " ms, setup+raster " << serialMs << " ms, on jobs " << jobsMs << " ms; " << OCCLUDEES << " boxes: test "
+                  << testMs << " ms, on jobs " << testJobsMs << " ms" << (sameLists ? "" : ", LISTS DIFFER") << std::endl;
+
+        std::cout << "    " << culled << " culled (" << 100.0 * culled / OCCLUDEES << "%), reference " << referenceHidden
+                  << " (" << 100.0 * referenceHidden / OCCLUDEES << "%), " << wronglyCulled << " wrongly culled, "
+                  << mismatches << " coverage mismatches" << std::endl;
+
+        passed &= sameLists && wronglyCulled == 0 && mismatches == 0;
     }
 
-    char* px = reinterpret_cast<char*>(pData);
+    jobSystem.Destroy();
 
-    memcpy_s(px, sizeof vertices, vertices, sizeof vertices);
-    px += sizeof vertices;
+    return passed;
+}
+
+//
+// --bench=hiz: the CPU depth pyramid. A 1917x1079 depth buffer of random ramps and noise, odd so
+// every level has a clamped last row and column, is reduced on one thread and on jobs. Every texel
+// is checked against the min and max over the depth pixels it covers. Then the city of
+// --bench=occlusion is rasterized by the reference depth buffer of OcclusionCuller at 320x180. The
+// pyramid of that must never hide a box the per pixel buffer shows, and is timed against it, one
+// box at a time and as --occlusion=pyramid tests the visible list on jobs. False if a check fails.
+//
+static bool BenchHiZ() {
+    JobSystem jobSystem;
+
+    const uint32_t threads = InitBenchJobs(jobSystem);
+
+    bool passed = true;
+
+    std::cout << "Hi-Z: " << threads << " threads" << std::endl;
 
-    memcpy_s(px, sizeof indices, indices, sizeof indices);
-    
     {
-        px = reinterpret_cast<char*>(pData) + textureBase;
+        const uint32_t WIDTH = 1917, HEIGHT = 1079;
 
-        for (UINT i = 0; i < TEXTURE_HEIGHT; ++i) {
-            UINT* pRow = reinterpret_cast<UINT*>(px) + (i * TEXTURE_WIDTH);
+        std::mt19937                          rng(3);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-            for (UINT j = 0; j < TEXTURE_HEIGHT; ++j) {
-                if (((j / 96) % 2) == 0)
-                {
-                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0F0F0FFF : 0x0;
-                }
-                else
-                {
-                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0 : 0x0F0F0FFF;
-                }
+        std::vector<float> depth(size_t(WIDTH) * HEIGHT);
+
+        for (uint32_t y = 0; y < HEIGHT; ++y) {
+            for (uint32_t x = 0; x < WIDTH; ++x) {
+                depth[size_t(y) * WIDTH + x] = (std::min)(0.5f * x / WIDTH + 0.3f * y / HEIGHT + 0.2f * unit(rng), 1.0f);
             }
         }
-    }
 
-    pUploadBuffer->Unmap(0, nullptr);
-    
-    // copy all
-    initCmdlist->CopyBufferRegion(pVertexBuffer, 0, pUploadBuffer, 0, sizeof vertices);
-    initCmdlist->CopyBufferRegion(pIndexBuffer, 0, pUploadBuffer, sizeof vertices, sizeof indices);
+        DepthPyramid serial, parallel;
 
-    {
-        D3D12_TEXTURE_COPY_LOCATION dstLoc{
-            .pResource        = pTexture,
-            .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
-            .SubresourceIndex = 0,
-        };
+        double serialMs = TimeMs([&] { serial.Build(depth.data(), WIDTH, HEIGHT, WIDTH * sizeof(float)); });
+        double jobsMs   = TimeMs([&] { parallel.Build(jobSystem, depth.data(), WIDTH, HEIGHT, WIDTH * sizeof(float)); });
 
-        D3D12_TEXTURE_COPY_LOCATION srcLoc{
-            .pResource       = pUploadBuffer,
-            .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
-            .PlacedFootprint = placedSFP
-        };
+        uint32_t mismatches = 0;
+
+        for (uint32_t level = 0; level < serial.GetLevelCount(); ++level) {
+            uint32_t cover = 2u << level;
+
+            for (uint32_t ty = 0; ty < serial.GetHeight(level); ++ty) {
+                for (uint32_t tx = 0; tx < serial.GetWidth(level); ++tx) {
+                    DepthPyramid::Texel expected = { FLT_MAX, -FLT_MAX };
 
-        initCmdlist->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-    }
-    
-    //
-    // Transition resources to thier next OPs
-    //
+                    for (uint32_t y = ty * cover; y < (std::min)((ty + 1) * cover, HEIGHT); ++y) {
+                        for (uint32_t x = tx * cover; x < (std::min)((tx + 1) * cover, WIDTH); ++x) {
+                            expected.lo = (std::min)(expected.lo, depth[size_t(y) * WIDTH + x]);
+                            expected.hi = (std::max)(expected.hi, depth[size_t(y) * WIDTH + x]);
+                        }
+                    }
 
-    D3D12_RESOURCE_BARRIER barrierIB {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pIndexBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_INDEX_BUFFER,
-        }
-    };
+                    const DepthPyramid::Texel& texel = serial.Get(level)[size_t(ty) * serial.GetWidth(level) + tx];
+                    const DepthPyramid::Texel& other = parallel.Get(level)[size_t(ty) * serial.GetWidth(level) + tx];
 
-    D3D12_RESOURCE_BARRIER barrierVB {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pVertexBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
-        }
-    };
+                    bool match = texel.lo == expected.lo && texel.hi == expected.hi && other.lo == texel.lo && other.hi == texel.hi;
 
-    D3D12_RESOURCE_BARRIER barrierTex {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pTexture,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,   // to Gen Mips
+                    mismatches += match ? 0 : 1;
+                }
+            }
         }
-    };
-    
-    D3D12_RESOURCE_BARRIER barriers[] = { barrierIB, barrierVB, barrierTex };
-    initCmdlist->ResourceBarrier(3, barriers);
 
-    //
-    // Generate texture mip maps
-    //
+        std::cout << "  " << WIDTH << "x" << HEIGHT << ", " << serial.GetLevelCount() << " levels: build " << serialMs << " ms, on jobs "
+                  << jobsMs << " ms, " << mismatches << " texels wrong" << std::endl;
 
-    D3D12_RESOURCE_DESC tdesc = pTexture->GetDesc();
+        passed &= mismatches == 0;
+    }
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
-        .Format                  = tdesc.Format,
-        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
-        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
-    };
-    
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc {
-        .Format                  = tdesc.Format,
-        .ViewDimension           = D3D12_UAV_DIMENSION_TEXTURE2D,
-        .Texture2D               = { .MipSlice = 0, .PlaneSlice = 0 }
-    };
-    
-    initCmdlist->SetComputeRootSignature(pCsRootSignature);
-    initCmdlist->SetPipelineState(pCsPipelineState);
-    
-    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+    {
+        XMMATRIX   view = XMMatrixLookAtLH(XMVectorSet(5.0f, 2.0f, -110.0f, 0.0f), XMVectorSet(5.0f, 2.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+        XMMATRIX   projection = XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f);
+        XMFLOAT4X4 viewProj;
+        XMStoreFloat4x4(&viewProj, view * projection);
 
-    initCmdlist->SetDescriptorHeaps(2, pDescHeaps);
+        std::mt19937                          rng(11);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
 
-    {
-        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+        OcclusionCuller culler;
+        culler.Init(320, 180);
 
-        D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
-        
-        UINT mipgenSrvHeapOffset = 1;
+        std::vector<XMFLOAT3> cube;
+        std::vector<uint32_t> cubeIndices;
+        CubeMesh(cube, cubeIndices);
 
-        D3D12_RESOURCE_BARRIER uavBarrier {
-            .Type  = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-            .UAV   = pTexture
-        };
+        for (const Building& building : CityScene(rng)) {
+            XMFLOAT4X4 mvp;
+            XMStoreFloat4x4(&mvp, XMMatrixScaling(building.extent.x, building.extent.y, building.extent.z)
+                                * XMMatrixTranslation(building.center.x, building.center.y, building.center.z) * view * projection);
 
-        union FloatAsInt {
-            UINT  u;
-            FLOAT f;
+            culler.AddOccluder(mvp.m, &cube[0].x, sizeof(XMFLOAT3), cubeIndices.data(), uint32_t(cubeIndices.size()));
+        }
 
-            explicit FloatAsInt(float val)
-                : f(val)
-            {}
-        };
+        culler.Rasterize();
 
-        // set sampler state in root once
-        initCmdlist->SetComputeRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+        std::vector<float> depth;
+        culler.RasterizeReference(depth);
 
-        for (UINT16 i = 0; i < (tdesc.MipLevels - 1); ++i) {
-            UINT dstWidth  = TEXTURE_WIDTH  >> (i + 1);
-            UINT dstHeight = TEXTURE_HEIGHT >> (i + 1);
+        DepthPyramid pyramid;
+        pyramid.Build(depth.data(), culler.GetWidth(), culler.GetHeight(), culler.GetWidth() * sizeof(float));
 
-            SIZE_T bytesToSrv = (mipgenSrvHeapOffset + i) * srvDescriptorSize;
+        const uint32_t BOXES = 100000;
 
-            srvHandle.ptr += bytesToSrv;
-            srvGpuHandle.ptr += bytesToSrv;
+        TransformSystem occludees;
+        occludees.Resize(BOXES);
 
-            SIZE_T bytesToUav = (mipgenSrvHeapOffset + i + 1) * srvDescriptorSize;
+        for (uint32_t i = 0; i < BOXES; ++i) {
+            occludees.Set(i, { unit(rng) * 200.0f - 100.0f, unit(rng) * 10.0f, unit(rng) * 200.0f - 100.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f });
+        }
 
-            uavHandle.ptr += bytesToUav;
-            uavGpuHandle.ptr += bytesToUav;
+        CullingSystem bounds;
+        bounds.Resize(BOXES);
+        bounds.UpdateBounds(occludees, 0, BOXES, { 0.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f });
 
-            srvDesc.Texture2D.MostDetailedMip = i;
-            pDevice9->CreateShaderResourceView(pTexture, &srvDesc, srvHandle);
+        const OcclusionCuller::Boxes boxes = CullingBoxes(bounds);
 
-            uavDesc.Texture2D.MipSlice = i + 1;
-            pDevice9->CreateUnorderedAccessView(pTexture, nullptr, &uavDesc, uavHandle);
+        auto Center = [&](uint32_t i) {
+            return XMFLOAT3(boxes.pCenter[0][i], boxes.pCenter[1][i], boxes.pCenter[2][i]);
+        };
 
-            UINT rootConstData[2] = { FloatAsInt(1.0f / dstWidth).u, FloatAsInt(1.0f / dstHeight).u };
+        const XMFLOAT3 extent = { 0.5f, 0.5f, 0.5f };
 
-            initCmdlist->SetComputeRoot32BitConstants(0, 2, rootConstData, 0);
-            initCmdlist->SetComputeRootDescriptorTable(1, srvGpuHandle);
-            initCmdlist->SetComputeRootDescriptorTable(2, uavGpuHandle);
-            
-            UINT dispatchX = max(dstWidth  / 8, 1u);
-            UINT dispatchY = max(dstHeight / 8, 1u);
+        uint32_t referenceHidden = 0, wronglyCulled = 0;
 
-            initCmdlist->Dispatch(dispatchX, dispatchY, 1);
+        for (uint32_t i = 0; i < BOXES; ++i) {
+            XMFLOAT3 center  = Center(i);
+            bool     visible = culler.TestBoxReference(depth, &center.x, &extent.x, viewProj.m);
 
-            initCmdlist->ResourceBarrier(1, &uavBarrier);
+            referenceHidden += visible ? 0 : 1;
+            wronglyCulled   += visible && !pyramid.TestBox(&center.x, &extent.x, viewProj.m) ? 1 : 0;
         }
 
-        barrierTex.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-        barrierTex.Transition.StateAfter  = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+        uint32_t pyramidKept = 0, maskedKept = 0, jobsKept = 0;
 
-        initCmdlist->ResourceBarrier(1, &barrierTex);
-    }
-    
-    initCmdlist->Close();
+        double pyramidMs = TimeMs([&] {
+            pyramidKept = 0;
 
-    ID3D12CommandList* commandLists[] = { initCmdlist.Get() };
-    pCommandQueue->ExecuteCommandLists(1, commandLists);
-    pCommandQueue->Signal(initFence.Get(), 1);
+            for (uint32_t i = 0; i < BOXES; ++i) {
+                XMFLOAT3 center = Center(i);
 
-    WaitForFence(initFence.Get(), 1, initCompleteEvent);
-    initCmdAllocator->Reset();
-    CloseHandle(initCompleteEvent);
-}
+                pyramidKept += pyramid.TestBox(&center.x, &extent.x, viewProj.m) ? 1 : 0;
+            }
+        });
 
-#pragma endregion
+        // what --occlusion=pyramid runs: the visible list filtered in place on jobs
+        std::vector<uint32_t> all(BOXES), list(BOXES);
 
-#pragma region Misc
+        for (uint32_t i = 0; i < BOXES; ++i) {
+            all[i] = i;
+        }
 
-LRESULT Harmony::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    Harmony* pApp = reinterpret_cast<Harmony*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+        double jobsMs = TimeMs([&] { list = all; jobsKept = pyramid.Test(jobSystem, Harmony::TRANSFORM_GRAIN, boxes, viewProj.m, list.data(), BOXES); });
 
-    switch (msg) {
-    case WM_CLOSE:
-    case WM_DESTROY:
-        PostQuitMessage(0);         // close the application entirely
-        return 0;
+        bool sameLists = jobsKept == pyramidKept;
 
-    case WM_SIZE:
-        if (pApp) {
-            pApp->Resize();
+        for (uint32_t n = 0; n < jobsKept && sameLists; ++n) {
+            XMFLOAT3 center = Center(list[n]);
+
+            sameLists = pyramid.TestBox(&center.x, &extent.x, viewProj.m) && (n == 0 || list[n] > list[n - 1]);
         }
-        return 0;
-    }
 
-    return DefWindowProc(hWnd, msg, wParam, lParam);
-}
+        double maskedMs = TimeMs([&] {
+            maskedKept = 0;
 
-#pragma endregion
+            for (uint32_t i = 0; i < BOXES; ++i) {
+                XMFLOAT3 center = Center(i);
 
-#pragma region Rendering
+                maskedKept += culler.TestBox(&center.x, &extent.x, viewProj.m) ? 1 : 0;
+            }
+        });
 
-void Harmony::Render() {
-    UpdateUbo();
-    PopulateCommandList();
+        std::cout << "  city at " << culler.GetWidth() << "x" << culler.GetHeight() << ", " << BOXES << " boxes: pyramid " << pyramidMs
+                  << " ms, on jobs " << jobsMs << " ms, " << 100.0 * (BOXES - pyramidKept) / BOXES << "% culled, " << wronglyCulled
+                  << " wrongly" << (sameLists ? "" : ", LISTS DIFFER") << "; masked " << maskedMs << " ms, "
+                  << 100.0 * (BOXES - maskedKept) / BOXES << "% culled; reference " << 100.0 * referenceHidden / BOXES << "% hidden" << std::endl;
 
-    ID3D12CommandList* ppCmdLists[] = { pCommandList };
-    pCommandQueue->ExecuteCommandLists(1, ppCmdLists);
+        passed &= wronglyCulled == 0 && sameLists;
+    }
 
-    pSwapChain4->Present(1, 0);
+    jobSystem.Destroy();
 
-    MoveToNextFrame();
+    return passed;
 }
 
-void Harmony::UpdateUbo() {
-    static auto epoch = std::chrono::high_resolution_clock::now();
-
-    auto current = std::chrono::high_resolution_clock::now();
-    float time   = std::chrono::duration<float, std::chrono::seconds::period>( current - epoch ).count();
+//
+// --bench=indirect: the CPU side of CullDraws for 10K to 1M random objects. Generate() is the
+// reference, the shader's algorithm a group at a time; it is timed against the SIMD cull plus
+// Build() from the visible list, on one thread and on jobs, and against Build() alone. The commands
+// all three write must be the same, and must draw exactly the visible list. False if they don't.
+//
+static bool BenchIndirect() {
+    JobSystem jobSystem;
 
-    const XMVECTOR Eye = XMVectorSet( 0.0f,  0.75f, -1.5f, 0.0f );
-    const XMVECTOR At  = XMVectorSet( 0.0f,  0.0f,  0.0f, 0.0f );
-    const XMVECTOR Up  = XMVectorSet( 0.0f,  1.0f,  0.0f, 0.0f );
+    const uint32_t threads    = InitBenchJobs(jobSystem);
+    const uint32_t indexCount = 12;
 
-    float yDisplacement = (sin(time * 5) * 0.25f) - 0.25f;
+    bool passed = true;
 
-    XMMATRIX  world      = XMMatrixRotationY(time * XMConvertToRadians(90.0f));
-    world *= XMMatrixTranslation(0.0f, yDisplacement, 0.0f);
+    std::cout << "Indirect draws: " << TransformSystem::KERNEL << " kernel, " << threads << " threads, ms per frame" << std::endl;
 
-    XMMATRIX  view       = XMMatrixLookAtLH( Eye, At, Up );
-    XMMATRIX  projection = XMMatrixPerspectiveFovLH(70, WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 20.0f);
-    
-    void* pData = nullptr;
-    if (FAILED(pConstantBuffer->Map(0, nullptr, &pData)) || pData == nullptr) {
-        throw std::runtime_error("Could not map CB!");
-    }
+    XMFLOAT4X4 viewProj;
+    XMStoreFloat4x4(&viewProj, XMMatrixLookAtLH(XMVectorSet(0.0f, 50.0f, -150.0f, 0.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f))
+                               * XMMatrixPerspectiveFovLH(XMConvertToRadians(70.0f), WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 500.0f));
 
-    UniformBuffer ubo;
-    ubo.mvp = world * view * projection;
+    Frustum frustum = Frustum::FromViewProj(viewProj.m);
 
-    uint8_t* pBytePtr = ((uint8_t*)pData) + frameIndex * sizeof(UniformBuffer);
+    for (uint32_t count : { 10000u, 100000u, 1000000u }) {
+        TransformSystem transforms;
+        RandomScene(transforms, count, 42);
 
-    memcpy_s(pBytePtr, sizeof(XMMATRIX), &ubo.mvp, sizeof(XMMATRIX));
-    
-    pConstantBuffer->Unmap(0, nullptr);
-}
+        CullingSystem culling;
+        culling.Resize(count);
+        culling.UpdateBounds(transforms, 0, count, { 0.0f, 0.5f, 0.0f }, { 0.5f, 0.5f, 0.5f });
 
-void Harmony::PopulateCommandList() {
-    pCommandAllocators[frameIndex]->Reset();
-    pCommandList->Reset(pCommandAllocators[frameIndex], pPipelineState);
+        using Command = IndirectDraws::Command;
 
-    pCommandList->SetGraphicsRootSignature(pRootSignature);
+        uint32_t maxCommands = IndirectDraws::MaxCommands(count);
 
-    D3D12_RESOURCE_BARRIER rtBarrier {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pRenderTargets[frameIndex],
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_PRESENT,
-            .StateAfter  = D3D12_RESOURCE_STATE_RENDER_TARGET,
-        }
-    };
+        std::vector<Command>  referenceCommands(maxCommands), serialCommands(maxCommands), parallelCommands(maxCommands);
+        std::vector<uint32_t> referenceInstances(count), serialInstances(count), parallelInstances(count);
+        std::vector<uint32_t> visibleList(count);
+        IndirectDraws         draws;
 
-    pCommandList->ResourceBarrier(1, &rtBarrier);
+        uint32_t referenceCount = 0, serialCount = 0, parallelCount = 0, visible = 0;
 
-    D3D12_RESOURCE_BARRIER dsBarrier {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pDepthBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
-            .StateAfter  = D3D12_RESOURCE_STATE_DEPTH_WRITE,
-        }
-    };
+        double referenceMs = TimeMs([&] {
+            referenceCount = IndirectDraws::Generate(CullingBoxes(culling), frustum, count, indexCount, referenceCommands.data(), referenceInstances.data());
+        });
 
-    pCommandList->ResourceBarrier(1, &dsBarrier);
+        double serialMs = TimeMs([&] {
+            visible     = culling.Cull(CullingSystem::Test::Box, frustum, 0, count, visibleList.data());
+            serialCount = IndirectDraws::Build(visibleList.data(), visible, indexCount, serialCommands.data(), serialInstances.data());
+        });
 
-    D3D12_CPU_DESCRIPTOR_HANDLE rtHandle = static_cast<D3D12_CPU_DESCRIPTOR_HANDLE>(pRtvHeap->GetCPUDescriptorHandleForHeapStart().ptr + frameIndex * rtvDescriptorSize);
-    D3D12_CPU_DESCRIPTOR_HANDLE dsHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+        double buildMs = TimeMs([&] {
+            serialCount = IndirectDraws::Build(visibleList.data(), visible, indexCount, serialCommands.data(), serialInstances.data());
+        });
 
-    pCommandList->OMSetRenderTargets(1, &rtHandle, FALSE, &dsHandle);
+        double parallelMs = TimeMs([&] {
+            visible       = culling.Cull(jobSystem, Harmony::TRANSFORM_GRAIN, CullingSystem::Test::Box, frustum, count, visibleList.data());
+            parallelCount = draws.Build(jobSystem, Harmony::TRANSFORM_GRAIN, visibleList.data(), visible, indexCount, parallelCommands.data(), parallelInstances.data());
+        });
 
-    pCommandList->RSSetViewports(1, &viewport);
-    pCommandList->RSSetScissorRects(1, &scissorRect);
+        // the instance slots past each command's count are left as they were, so compare the drawn ones
+        auto Same = [&](const std::vector<Command>& commands, uint32_t commandCount, const std::vector<uint32_t>& instances) {
+            if (commandCount != referenceCount) {
+                return false;
+            }
 
-    const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    pCommandList->ClearRenderTargetView(rtHandle, clearColor, 0, nullptr);
-    pCommandList->ClearDepthStencilView(dsHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+            for (uint32_t c = 0; c < commandCount; ++c) {
+                const Command& a = referenceCommands[c];
+                const Command& b = commands[c];
 
-    
-    pCommandList->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+                if (a.firstInstance != b.firstInstance || memcmp(&a.draw, &b.draw, sizeof(a.draw)) != 0
+                    || !std::equal(referenceInstances.begin() + a.firstInstance, referenceInstances.begin() + a.firstInstance + a.draw.InstanceCount,
+                                   instances.begin() + b.firstInstance)) {
+                    return false;
+                }
+            }
 
-    D3D12_INDEX_BUFFER_VIEW ibv {
-        pIndexBuffer->GetGPUVirtualAddress(),
-        sizeof indices,
-        DXGI_FORMAT_R32_UINT,
-    };
+            return true;
+        };
 
-    D3D12_VERTEX_BUFFER_VIEW vbv{
-        pVertexBuffer->GetGPUVirtualAddress(),
-        sizeof vertices,
-        sizeof Vertex
-    };
+        std::vector<uint8_t> drawn;
 
-    pCommandList->IASetIndexBuffer(&ibv);
-    pCommandList->IASetVertexBuffers(0, 1, &vbv);
+        bool valid = IndirectDraws::Expand(referenceCommands.data(), referenceCount, referenceInstances.data(), count, indexCount, drawn);
 
-    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+        uint32_t drawnCount = uint32_t(std::count(drawn.begin(), drawn.end(), uint8_t(1)));
 
-    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+        for (uint32_t n = 0; n < visible; ++n) {
+            valid = valid && drawn[visibleList[n]];
+        }
 
-    pCommandList->SetGraphicsRootConstantBufferView(0, pConstantBuffer->GetGPUVirtualAddress() + frameIndex * sizeof(UniformBuffer) );
-    pCommandList->SetGraphicsRootDescriptorTable(1, pSrvHeap->GetGPUDescriptorHandleForHeapStart());
-    pCommandList->SetGraphicsRootDescriptorTable(2, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+        bool match = valid && drawnCount == visible && Same(serialCommands, serialCount, serialInstances) && Same(parallelCommands, parallelCount, parallelInstances);
 
-    pCommandList->DrawIndexedInstanced(12, 1, 0, 0, 0);
+        std::cout << "  " << count << " objects, " << visible << " visible in " << referenceCount << " commands: reference " << referenceMs
+                  << ", SIMD cull + build " << serialMs << " (build " << buildMs << "), on jobs " << parallelMs
+                  << (match ? "" : ", COMMANDS DIFFER") << std::endl;
 
-    std::swap(dsBarrier.Transition.StateBefore, dsBarrier.Transition.StateAfter);
-    pCommandList->ResourceBarrier(1, &dsBarrier);
+        passed &= match;
+    }
 
-    std::swap(rtBarrier.Transition.StateBefore, rtBarrier.Transition.StateAfter);
-    pCommandList->ResourceBarrier(1, &rtBarrier);
+    jobSystem.Destroy();
 
-    pCommandList->Close();
+    return passed;
 }
 
-void Harmony::MoveToNextFrame() {
-    auto curFenceVal = fenceValues[frameIndex];
-
-    // signal in cmd queue
-    pCommandQueue->Signal(pFence, curFenceVal);
+static bool RunBenchmark(const Settings& settings) {
+    const std::string& name = settings.bench;
 
-    // move frame index
-    frameIndex = pSwapChain4->GetCurrentBackBufferIndex();
+    if (name == "transforms") {
+        return BenchTransforms();
+    }
 
-    if (pFence->GetCompletedValue() < fenceValues[frameIndex]) {
-        pFence->SetEventOnCompletion(fenceValues[frameIndex], fenceHandle);
+    if (name == "cull") {
+        return BenchCull();
+    }
 
-        WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
+    if (name == "bvh") {
+        return BenchBvh();
     }
 
-    fenceValues[frameIndex] = curFenceVal + 1;
-}
+    if (name == "occlusion") {
+        return BenchOcclusion();
+    }
 
-void Harmony::WaitForGpu() {
-    pCommandQueue->Signal(pFence, fenceValues[frameIndex]);
+    if (name == "hiz") {
+        return BenchHiZ();
+    }
 
-    pFence->SetEventOnCompletion(fenceValues[frameIndex], fenceHandle);
-    WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
+    if (name == "indirect") {
+        return BenchIndirect();
+    }
 
-    fenceValues[frameIndex] += 1;
+    std::cerr << "Unknown benchmark: " << name << std::endl;
+    return false;
 }
 
 #pragma endregion
@@ -1618,14 +5409,137 @@ static void MakeConsole() {
     freopen_s(&fDummy, "CONOUT$", "w", stdout);
 }
 
+//
+// The SIMD kernels are built for one instruction set (RP_SIMD in CMake), so a CPU or OS without it
+// would fault in the first one. Checks the CPUID feature bits and that the OS saves the registers.
+//
+static bool CpuSupportsBuild(const char*& pName) {
+#if defined(__AVX512F__) || defined(__AVX2__)
+    int info[4] = {};
+
+    __cpuid(info, 1);
+
+    bool fma     = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+    __cpuidex(info, 7, 0);
+
+#if defined(__AVX512F__)
+    pName = "AVX-512";
+    return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 5)) != 0 && fma;
+#else
+    pName = "AVX2";
+    return (xcr0 & 0x06) == 0x06 && (info[1] & (1 << 5)) != 0 && fma;
+#endif
+#else
+    pName = "SSE";
+    return true;
+#endif
+}
+
+static Settings ParseSettings(int argc, char* argv[]) {
+    Settings settings;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--objects=", 0) == 0) {
+            settings.objects = (std::max)(static_cast<uint32_t>(strtoul(arg.c_str() + 10, nullptr, 10)), 1u);
+        }
+        else if (arg == "--draw=perobject") {
+            settings.drawPath = DrawPath::PerObject;
+        }
+        else if (arg == "--draw=instanced") {
+            settings.drawPath = DrawPath::Instanced;
+        }
+        else if (arg == "--draw=indirect") {
+            settings.drawPath = DrawPath::Indirect;
+        }
+        else if (arg == "--cull=off") {
+            settings.cull = CullMode::Off;
+        }
+        else if (arg == "--cull=sphere") {
+            settings.cull = CullMode::Sphere;
+        }
+        else if (arg == "--cull=box") {
+            settings.cull = CullMode::Box;
+        }
+        else if (arg == "--cull=bvh") {
+            settings.cull = CullMode::Bvh;
+        }
+        else if (arg == "--occlusion" || arg == "--occlusion=masked") {
+            settings.occlusion        = true;
+            settings.occlusionPyramid = false;
+        }
+        else if (arg == "--occlusion=pyramid") {
+            settings.occlusion        = true;
+            settings.occlusionPyramid = true;
+        }
+        else if (arg == "--hiz" || arg == "--hiz=max") {
+            settings.hiz          = true;
+            settings.hizReduction = DepthPyramid::Reduction::Max;
+        }
+        else if (arg == "--hiz=min") {
+            settings.hiz          = true;
+            settings.hizReduction = DepthPyramid::Reduction::Min;
+        }
+        else if (arg == "--hiz=minmax") {
+            settings.hiz          = true;
+            settings.hizReduction = DepthPyramid::Reduction::MinMax;
+        }
+        else if (arg == "--stress") {
+            settings.stress = true;
+        }
+        else if (arg.rfind("--bench=", 0) == 0) {
+            settings.bench = arg.substr(8);
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    // a stress run without an object count goes up to the default
+    if (settings.stress && settings.objects == 1) {
+        settings.objects = Harmony::STRESS_OBJECTS;
+    }
+
+    // indirect draws are culled on the GPU, the software occlusion culler has no visible list to trim
+    if (settings.drawPath == DrawPath::Indirect && settings.occlusion) {
+        std::cout << "--occlusion has no effect with --draw=indirect, ignored" << std::endl;
+        settings.occlusion = false;
+    }
+
+    // occlusion and Hi-Z test the frustum survivors, so they need a frustum cull
+    if ((settings.occlusion || settings.hiz) && settings.cull == CullMode::Off) {
+        settings.cull = CullMode::Box;
+    }
+
+    return settings;
+}
+
 int main(int argc, char* argv[]) {
     HINSTANCE instance = NULL;
 
     MakeConsole();
 
+    const char* pSimd = nullptr;
+
+    if (!CpuSupportsBuild(pSimd)) {
+        std::cerr << "Built for " << pSimd << ", which this CPU doesn't support; rebuild with -DRP_SIMD=SSE" << std::endl;
+        return -1;
+    }
+
+    Settings settings = ParseSettings(argc, argv);
+
+    if (!settings.bench.empty()) {
+        return RunBenchmark(settings) ? 0 : -1;
+    }
+
     Harmony app;
 
-    if (!app.Init(instance)) {
+    if (!app.Init(instance, settings)) {
         std::cerr << "App::Init failed!" << std::endl;
         return -1;
     }
@@ -1633,6 +5547,11 @@ int main(int argc, char* argv[]) {
     app.Run();
     app.Shutdown();
 
+    if (!app.Validated()) {
+        std::cerr << "GPU validation failed" << std::endl;
+        return -1;
+    }
+
 	return 0;
 }
 
@@ -0,0 +1,185 @@
+//
+// CullHiZ: tests boxes against the min/max depth pyramid of GenHiZ (Mipgen.hlsl), the same test as
+// DepthPyramid::TestBox (Common/DepthPyramid.h). The box is projected to the depth pixels it
+// touches and its nearest depth. It is hidden if that is behind the farthest depth of the texels
+// covering those pixels, at the level where they span at most 2x2 texels.
+//
+
+// keep in sync with HiZBox (Main.cpp)
+struct Box
+{
+    float3 center;
+    uint   object;
+    float3 extent;
+    uint   padding;
+};
+
+static const float NEAR_W            = 1e-4f;
+static const uint  REDUCTION_MIN_MAX = 2;
+
+Texture2D<float2>       Pyramid     : register(t0);
+StructuredBuffer<Box>   Boxes       : register(t1);
+RWByteAddressBuffer     Results     : register(u0);    // visible count, then 1 per visible box
+
+cbuffer CB : register(b0)
+{
+    row_major float4x4 viewProj;        // the pyramid's
+    uint2              depthSize;
+    uint               levelCount;
+    uint               reduction;
+    uint               boxCount;
+
+    // CullDraws
+    uint               hizEnabled;
+    uint               indexCount;
+    uint               padding;
+    float4             frustum[6];      // Frustum (Common/Frustum.h) of this frame
+}
+
+bool BoxVisible(Box box)
+{
+    float2 lo   = 3.402823e38f;
+    float2 hi   = -3.402823e38f;
+    float  zMin = 3.402823e38f;
+
+    for (uint corner = 0; corner < 8; ++corner) {
+        float3 sign = float3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f);
+        float4 clip = mul(float4(box.center + box.extent * sign, 1.0f), viewProj);
+
+        // reaches behind the near plane, can't be tested
+        if (clip.w < NEAR_W || clip.z < 0.0f) {
+            return true;
+        }
+
+        float  invW  = 1.0f / clip.w;
+        float2 pixel = float2(clip.x * invW * 0.5f + 0.5f, 0.5f - clip.y * invW * 0.5f) * float2(depthSize);
+
+        lo   = min(lo, pixel);
+        hi   = max(hi, pixel);
+        zMin = min(zMin, clip.z * invW);
+    }
+
+    // depth pixels the rectangle touches, none when off screen
+    int2 p0 = int2(max(floor(lo), 0.0f));
+    int2 p1 = int2(min(floor(hi), float2(depthSize) - 1.0f));
+
+    if (any(p0 > p1)) {
+        return false;
+    }
+
+    // a level L texel is 2^(L + 1) pixels across, enough for the span to touch two at most
+    uint span  = uint(max(p1.x - p0.x, p1.y - p0.y)) + 1;
+    uint level = min(span > 1 ? firstbithigh(span - 1) : 0, levelCount - 1);
+
+    int2 t0 = p0 >> (level + 1);
+    int2 t1 = p1 >> (level + 1);
+
+    float farthest = 0.0f;
+
+    for (int y = t0.y; y <= t1.y; ++y) {
+        for (int x = t0.x; x <= t1.x; ++x) {
+            float2 texel = Pyramid.Load(int3(x, y, level));
+            farthest     = max(farthest, reduction == REDUCTION_MIN_MAX ? texel.y : texel.x);
+        }
+    }
+
+    return zMin < farthest;
+}
+
+[numthreads(64, 1, 1)]
+void CullHiZ(uint3 tid : SV_DispatchThreadID)
+{
+    if (tid.x >= boxCount) {
+        return;
+    }
+
+    bool visible = BoxVisible(Boxes[tid.x]);
+
+    Results.Store(4 + tid.x * 4, visible ? 1 : 0);
+
+    if (visible) {
+        Results.InterlockedAdd(0, 1);
+    }
+}
+
+//
+// CullDraws: the indirect draws of IndirectDraws (Common/IndirectDraws.h). Every object gets
+// Frustum::TestBox (Common/Frustum.h) and, with hizEnabled, the test above. A group packs its visible objects
+// into its instance slots in object order and appends one command if it has any.
+//
+
+// keep in sync with IndirectDraws::Command (Common/IndirectDraws.h) and the command signature
+static const uint COMMAND_SIZE = 24;
+
+RWByteAddressBuffer Commands  : register(u1);
+RWByteAddressBuffer Instances : register(u2);
+RWByteAddressBuffer Counts    : register(u3);    // commands, then visible objects
+
+groupshared uint drawMask[2];
+
+bool InFrustum(Box box)
+{
+    for (uint p = 0; p < 6; ++p) {
+        float4 f        = frustum[p];
+        float  distance = box.center.x * f.x + box.center.y * f.y + box.center.z * f.z + f.w;
+        float  reach    = box.extent.x * abs(f.x) + box.extent.y * abs(f.y) + box.extent.z * abs(f.z);
+
+        if (distance + reach < 0.0f) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// IndirectDraws::GROUP_SIZE threads
+[numthreads(64, 1, 1)]
+void CullDraws(uint3 tid : SV_DispatchThreadID, uint3 gid : SV_GroupID, uint gi : SV_GroupIndex)
+{
+    if (gi < 2) {
+        drawMask[gi] = 0;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // threads past the last box (all of them when boxCount is 0) read nothing, but reach the barriers
+    Box  box     = (Box)0;
+    bool visible = false;
+
+    if (tid.x < boxCount) {
+        box     = Boxes[tid.x];
+        visible = InFrustum(box) && (hizEnabled == 0 || BoxVisible(box));
+    }
+
+    if (visible) {
+        InterlockedOr(drawMask[gi >> 5], 1u << (gi & 31));
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    // nothing left to do for them: thread 0 of a group with any boxes in it has one of its own
+    if (tid.x >= boxCount) {
+        return;
+    }
+
+    // slots in thread order: the visible threads before this one
+    uint low   = countbits(drawMask[0]);
+    uint slot  = gi < 32 ? countbits(drawMask[0] & ((1u << gi) - 1)) : low + countbits(drawMask[1] & ((1u << (gi - 32)) - 1));
+    uint first = gid.x * 64;
+
+    if (visible) {
+        Instances.Store((first + slot) * 4, box.object);
+    }
+
+    uint total = low + countbits(drawMask[1]);
+
+    if (gi == 0 && total > 0) {
+        uint command;
+        Counts.InterlockedAdd(0, 1, command);
+        Counts.InterlockedAdd(4, total);
+
+        // firstInstance, then D3D12_DRAW_INDEXED_ARGUMENTS
+        Commands.Store3(command * COMMAND_SIZE, uint3(first, indexCount, total));
+        Commands.Store3(command * COMMAND_SIZE + 12, uint3(0, 0, 0));
+    }
+}
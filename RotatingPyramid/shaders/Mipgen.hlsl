@@ -5,6 +5,12 @@ SamplerState        BilinearClamp       : register(s0);
 cbuffer CB : register(b0)
 {
     float2 texelSize;  // inverse of destination dimensions
+
+    // GenHiZ
+    uint2  depthSize;
+    uint   levelCount;
+    uint   reduction;  // DepthPyramid::Reduction (Common/DepthPyramid.h)
+    uint   groupCount;
 }
 
 [numthreads(8, 8, 1)]
@@ -15,3 +21,147 @@ void GenMips(uint3 tid : SV_DispatchThreadID)
     
     DestinationTexture[tid.xy] = col;
 }
+
+//
+// Min/max depth pyramid of a D32 depth buffer (SourceTexture) in one pass, keep in sync with
+// DepthPyramid (Common/DepthPyramid.h), which has to match it exactly. Level 0 is half the depth buffer
+// rounded up, each texel the 2x2 below it clamped to the edge. A group reduces 32x32 level 0
+// texels down to level 5 in group shared memory. The last group to finish, counted in
+// HiZScratch, then reduces the level 5 texels the groups left in HiZScratch to the top.
+//
+static const uint HIZ_MAX_LEVELS    = 15;
+static const uint REDUCTION_MIN     = 0;
+static const uint REDUCTION_MAX     = 1;
+static const uint SCRATCH_TEXELS    = 16;      // bytes before the texels, the counter is the first word
+
+globallycoherent RWTexture2D<float2> HiZLevels[HIZ_MAX_LEVELS] : register(u1);
+globallycoherent RWByteAddressBuffer HiZScratch                : register(u16);
+
+groupshared float2 hizShared[16][16];
+groupshared bool   hizLastGroup;
+
+float2 Reduce(float2 a, float2 b)
+{
+    return float2(min(a.x, b.x), max(a.y, b.y));
+}
+
+float2 Reduce4(float2 a, float2 b, float2 c, float2 d)
+{
+    return Reduce(Reduce(a, b), Reduce(c, d));
+}
+
+uint2 LevelSize(uint level)
+{
+    return max((depthSize + (2u << level) - 1) >> (level + 1), 1u);
+}
+
+float2 LoadDepth(uint2 pixel)
+{
+    return SourceTexture.Load(int3(min(pixel, depthSize - 1), 0)).rr;
+}
+
+// min in x, max in y; a min or max pyramid keeps its one value in x
+void StoreHiZ(uint level, uint2 texel, float2 value)
+{
+    if (level < levelCount && all(texel < LevelSize(level))) {
+        HiZLevels[level][texel] = reduction == REDUCTION_MAX ? value.yx : value;
+    }
+}
+
+float2 LoadScratch(uint offset, uint2 size, uint2 texel)
+{
+    texel = min(texel, size - 1);
+    return asfloat(HiZScratch.Load2(offset + (texel.y * size.x + texel.x) * 8));
+}
+
+[numthreads(16, 16, 1)]
+void GenHiZ(uint3 gid : SV_GroupID, uint3 gtid : SV_GroupThreadID, uint gi : SV_GroupIndex)
+{
+    // level 0 and 1: a thread reduces 4x4 depth pixels to 2x2 texels to 1
+    uint2  base = gid.xy * 32 + gtid.xy * 2;
+    float2 quad[4];
+
+    for (uint q = 0; q < 4; ++q) {
+        uint2 texel = base + uint2(q & 1, q >> 1);
+        uint2 pixel = texel * 2;
+
+        quad[q] = Reduce4(LoadDepth(pixel), LoadDepth(pixel + uint2(1, 0)), LoadDepth(pixel + uint2(0, 1)), LoadDepth(pixel + uint2(1, 1)));
+        StoreHiZ(0, texel, quad[q]);
+    }
+
+    float2 value = Reduce4(quad[0], quad[1], quad[2], quad[3]);
+
+    StoreHiZ(1, gid.xy * 16 + gtid.xy, value);
+    hizShared[gtid.y][gtid.x] = value;
+
+    // levels 2 to 5, a quarter of the threads of the level before
+    for (uint level = 2; level <= 5; ++level) {
+        uint size = 16 >> (level - 1);
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (all(gtid.xy < size)) {
+            uint2 s = gtid.xy * 2;
+            value   = Reduce4(hizShared[s.y][s.x], hizShared[s.y][s.x + 1], hizShared[s.y + 1][s.x], hizShared[s.y + 1][s.x + 1]);
+        }
+
+        GroupMemoryBarrierWithGroupSync();
+
+        if (all(gtid.xy < size)) {
+            hizShared[gtid.y][gtid.x] = value;
+            StoreHiZ(level, gid.xy * size + gtid.xy, value);
+        }
+    }
+
+    // level 5 has a texel per group
+    uint2 groups = LevelSize(5);
+
+    if (gi == 0) {
+        HiZScratch.Store2(SCRATCH_TEXELS + (gid.y * groups.x + gid.x) * 8, asuint(value));
+    }
+
+    DeviceMemoryBarrierWithGroupSync();
+
+    if (gi == 0) {
+        uint finished;
+        HiZScratch.InterlockedAdd(0, 1, finished);
+
+        hizLastGroup = finished == groupCount - 1;
+    }
+
+    GroupMemoryBarrierWithGroupSync();
+
+    if (!hizLastGroup) {
+        return;
+    }
+
+    // the rest of the levels, each into the scratch buffer after the level before
+    uint  source = SCRATCH_TEXELS;
+    uint2 size   = groups;
+
+    for (uint level = 6; level < levelCount; ++level) {
+        uint2 dst         = LevelSize(level);
+        uint  destination = source + size.x * size.y * 8;
+
+        for (uint i = gi; i < dst.x * dst.y; i += 256) {
+            uint2 texel = uint2(i % dst.x, i / dst.x);
+            uint2 s     = texel * 2;
+
+            float2 reduced = Reduce4(LoadScratch(source, size, s), LoadScratch(source, size, s + uint2(1, 0)),
+                                     LoadScratch(source, size, s + uint2(0, 1)), LoadScratch(source, size, s + uint2(1, 1)));
+
+            HiZScratch.Store2(destination + i * 8, asuint(reduced));
+            StoreHiZ(level, texel, reduced);
+        }
+
+        DeviceMemoryBarrierWithGroupSync();
+
+        source = destination;
+        size   = dst;
+    }
+
+    // ready for the next pass
+    if (gi == 0) {
+        HiZScratch.Store(0, 0);
+    }
+}
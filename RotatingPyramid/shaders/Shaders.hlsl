@@ -30,6 +30,58 @@ VsOutput VsMain(VsInput v)
     return output;
 }
 
+// keep in sync with InstanceData (Main.cpp), tightly packed: 68 bytes
+struct InstanceData
+{
+    matrix mvp;
+    uint   material;
+};
+
+StructuredBuffer<InstanceData> instances : register(t1);
+
+static const float3 materialTints[4] = {
+    float3(1.0f, 1.0f, 1.0f),
+    float3(1.0f, 0.5f, 0.5f),
+    float3(0.5f, 1.0f, 0.5f),
+    float3(0.5f, 0.5f, 1.0f),
+};
+
+VsOutput VsInstanced(VsInput v, uint instanceId : SV_InstanceID)
+{
+    InstanceData instance = instances[instanceId];
+
+    VsOutput output;
+
+    output.position = mul(instance.mvp, float4(v.position, 1.0f));
+    output.color    = v.color * materialTints[instance.material & 3];
+    output.uv       = v.uv;
+
+    return output;
+}
+
+// DrawPath::Indirect: a command's root constant is the first of its group's instance slots, which
+// hold the objects CullDraws (Cull.hlsl) found visible
+cbuffer DrawConstants : register(b1)
+{
+    uint firstInstance;
+}
+
+ByteAddressBuffer drawInstances : register(t2);
+
+VsOutput VsIndirect(VsInput v, uint instanceId : SV_InstanceID)
+{
+    uint         object   = drawInstances.Load((firstInstance + instanceId) * 4);
+    InstanceData instance = instances[object];
+
+    VsOutput output;
+
+    output.position = mul(instance.mvp, float4(v.position, 1.0f));
+    output.color    = v.color * materialTints[instance.material & 3];
+    output.uv       = v.uv;
+
+    return output;
+}
+
 Texture2D<float4> colorTexture : register(t0);
 SamplerState      colorSampler : register(s0);
 
@@ -2,6 +2,16 @@
 
 "c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T vs_6_6 -E VsMain -Fo vs.bin Shaders.hlsl
 
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T vs_6_6 -E VsInstanced -Fo vsinstanced.bin Shaders.hlsl
+
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T vs_6_6 -E VsIndirect -Fo vsindirect.bin Shaders.hlsl
+
 "c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T ps_6_6 -E PsMain -Fo ps.bin Shaders.hlsl
 
 "c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T cs_6_6 -E GenMips -Fo mipgen.bin Mipgen.hlsl
+
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T cs_6_6 -E GenHiZ -Fo genhiz.bin Mipgen.hlsl
+
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T cs_6_6 -E CullHiZ -Fo cullhiz.bin Cull.hlsl
+
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T cs_6_6 -E CullDraws -Fo culldraws.bin Cull.hlsl
@@ -5,23 +5,54 @@
 #include <string>
 #include <vector>
 #include <deque>
+#include <list>
 #include <array>
 #include <optional>
 #include <functional>
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <map>
+#include <unordered_map>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <random>
+#include <limits>
+#include <bit>
 
 #include <d3d12.h>
 #include <dxgi1_6.h>
 #include <D3Dcompiler.h>
 #include <DirectXMath.h>
+#include <dxcapi.h>
+#include <compressapi.h>
+#include <immintrin.h>
 using namespace DirectX;
 
 #include <wrl.h>
 using Microsoft::WRL::ComPtr;
 
+#include "AsyncFileReader.h"
+#include "DeferredReleaseQueue.h"
+#include "FeedbackAggregator.h"
+#include "FeedbackProcessor.h"
+#include "FrameExchange.h"
+#include "FramePacer.h"
+#include "FrameScheduler.h"
+#include "IoScheduler.h"
+#include "JobSystem.h"
+#include "ShaderWatcher.h"
+#include "SimulatedGpu.h"
+#include "SimulationClock.h"
+#include "TileStreamer.h"
+
 #define APPLICATION_NAME        "Rotating Pyramid"
 #define WINDOW_WIDTH            1920
 #define WINDOW_HEIGHT           1080
@@ -32,6 +63,11 @@ using Microsoft::WRL::ComPtr;
 #define TEXTURE_MMW             128
 #define TEXTURE_MMH             128
 
+// decoded MinMip feedback, one texel per mip region. Decoded rows in a buffer are pitch aligned.
+#define FEEDBACK_WIDTH          (TEXTURE_WIDTH / TEXTURE_MMW)
+#define FEEDBACK_HEIGHT         (TEXTURE_HEIGHT / TEXTURE_MMH)
+#define FEEDBACK_ROW_PITCH      D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+
 class DeletionQueue {
 public:
     using Fn    = std::function<void()>;
@@ -54,6 +90,25 @@ private:
     Queue q;
 };
 
+struct ShaderSource
+{
+    const wchar_t* file;
+    const wchar_t* entry;
+    const wchar_t* target;
+};
+
+// keep in sync with compileshaders.bat
+static const ShaderSource shaderSources[] = {
+    { L"Shaders.hlsl", L"VsMain",     L"vs_6_6" },
+    { L"Shaders.hlsl", L"PsFeedback", L"ps_6_6" },
+    { L"Shaders.hlsl", L"PsMain",     L"ps_6_6" },
+    { L"Mipgen.hlsl",  L"GenMips",    L"cs_6_6" },
+};
+
+#ifndef SHADER_SOURCE_DIR
+#define SHADER_SOURCE_DIR       "shaders"
+#endif
+
 struct Vertex
 {
     DirectX::XMFLOAT3 position;
@@ -94,6 +149,28 @@ struct UniformBuffer
 
 static_assert(sizeof(UniformBuffer) == 256);
 
+struct DrawItem
+{
+    XMFLOAT4X4 world;
+    uint32_t   indexCount;
+    uint32_t   firstIndex;
+};
+
+//
+// Everything the render thread needs from the simulation for one frame, by value, so a packet can
+// be rendered while the simulation writes the next one.
+//
+struct FramePacket
+{
+    static constexpr uint32_t MAX_DRAWS = 16;
+
+    uint64_t                        step      = 0;      // simulation step it was taken at
+    double                          time      = 0.0;    // simulated seconds
+    XMFLOAT4X4                      viewProj  = {};
+    uint32_t                        drawCount = 0;
+    std::array<DrawItem, MAX_DRAWS> draws     = {};
+};
+
 inline void WaitForFence (ID3D12Fence* fence, UINT64 completionValue, HANDLE waitEvent) {
     if (fence->GetCompletedValue() < completionValue) {
         fence->SetEventOnCompletion (completionValue, waitEvent);
@@ -111,1706 +188,5714 @@ inline UINT Align(UINT val, UINT alignment) {
     return val;
 }
 
-#pragma region ClassDecl
-
-class alignas(64) Harmony
-{
+//
+// Coroutine of the async API. Tasks start suspended: spawning one on a CoroutineExecutor or awaiting
+// it from another Task starts it, and the awaiting Task resumes right where it finishes (symmetric
+// transfer, the stack doesn't grow with the chain). An exception travels to whoever awaits it.
+//
+class Task {
 public:
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 3;
-    static constexpr uint32_t DEFAULT_CHUNK_SIZE   = 128 * 1024 * 1024;
+    struct promise_type
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr      exception;
+        std::atomic<bool>       finished = false;       // set once suspended for good, the frame may go
 
-    bool Init(HINSTANCE inst);
-    void Run();
-    void Shutdown();
-    void Resize();
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
 
-private:
-    inline uint32_t GetSizeInMB(UINT64 sizeInBytes) {
-        return (sizeInBytes >> 20) & 0xFFFFFFFF;
-    }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
 
-    void OpenWindow(HINSTANCE instance);
-    void CreateAdapter();
-    void CreateDevice();
-    void CreateCommandQueue();
-    void CreateSwapChain();
-    void CreateHeaps();
-    void CreateResourcesAndViews();
-    void CreatePipelines();
-    void CreateCommandLists();
-    void CreateSyncObjects();
-    void DownloadDataAndGenMips();
+        auto final_suspend() noexcept {
+            struct Final {
+                bool await_ready() const noexcept {
+                    return false;
+                }
 
-    void UpdateUbo();
-    void PopulateCommandList();
-    void MoveToNextFrame(bool singlestep = true);
-    void WaitForGpu();
-    void Render();
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    promise_type&           promise = handle.promise();
+                    std::coroutine_handle<> next    = promise.continuation ? promise.continuation : std::noop_coroutine();
 
-    static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam,
-        LPARAM lParam);
+                    promise.finished.store(true, std::memory_order_release);
+                    return next;
+                }
 
-    DeletionQueue               delQ;
+                void await_resume() const noexcept {}
+            };
 
-    IDXGIFactory7*              pFactory7         = nullptr;
-    IDXGIAdapter1*              pAdapter1         = nullptr;
-    IDXGISwapChain4*            pSwapChain4       = nullptr;
+            return Final {};
+        }
 
-    ID3D12Device9*              pDevice9          = nullptr;
-    ID3D12CommandQueue*         pCommandQueue     = nullptr;
-    ID3D12CommandQueue*         pCopyQueue        = nullptr;
+        void return_void() {}
 
-    ID3D12DescriptorHeap*       pRtvHeap          = nullptr;
-    ID3D12DescriptorHeap*       pDsvHeap          = nullptr;
-    ID3D12DescriptorHeap*       pSrvHeap          = nullptr;
-    ID3D12DescriptorHeap*       pUavHeap          = nullptr;
-    ID3D12DescriptorHeap*       pSmpHeap          = nullptr;
+        void unhandled_exception() {
+            exception = std::current_exception();
+        }
+    };
 
-    ID3D12Resource*             pRenderTargets[MAX_FRAMES_IN_FLIGHT] = { nullptr };
-    ID3D12CommandAllocator*     pCommandAllocators[MAX_FRAMES_IN_FLIGHT] = { nullptr };
-    ID3D12GraphicsCommandList1* pCommandList      = nullptr;
-    ID3D12Fence*                pFence            = nullptr;
-    ID3D12Heap*                 pResourceHeap     = nullptr;
+    Task() = default;
 
-    ID3D12RootSignature*        pRootSignature    = nullptr;
-    ID3D12PipelineState*        pPipelineState    = nullptr;
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
 
-    ID3D12RootSignature*        pCsRootSignature  = nullptr;
-    ID3D12PipelineState*        pCsPipelineState  = nullptr;
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
 
-    ID3D12Resource*             pConstantBuffer   = nullptr;
-    ID3D12Resource*             pDepthBuffer      = nullptr;
-    ID3D12Resource*             pTexture          = nullptr;
-    ID3D12Resource*             pFeedbackTexture  = nullptr;
-    ID3D12Resource*             pResolveTexture   = nullptr;
-    ID3D12Resource*             pVertexBuffer     = nullptr;
-    ID3D12Resource*             pIndexBuffer      = nullptr;
-    ID3D12Resource*             pUploadBuffer     = nullptr;
-    ID3D12Resource*             pFeedbackBuffer   = nullptr;
+            handle = std::exchange(other.handle, nullptr);
+        }
 
-    HINSTANCE                   hInstance         = NULL;
-    HWND                        hMainWindow       = NULL;
+        return *this;
+    }
 
-    UINT                        frameIndex        = 0;
-    HANDLE                      fenceHandle       = NULL;
-    UINT64                      fenceValues[MAX_FRAMES_IN_FLIGHT] = { 0 };
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
 
-    UINT                        rtvDescriptorSize    = 0;
-    UINT                        dsvDescriptorSize    = 0;
-    UINT                        srvDescriptorSize    = 0;
-    UINT                        srvCpuDescriptorSize = 0;
-    UINT                        smpDescriptorSize    = 0;
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
 
-    D3D_FEATURE_LEVEL           featureLevel         = D3D_FEATURE_LEVEL_12_2;
-    D3D12_VIEWPORT              viewport;
-    D3D12_RECT                  scissorRect;
+    bool IsFinished() const {
+        return handle && handle.promise().finished.load(std::memory_order_acquire);
+    }
 
-    D3D12_FEATURE_DATA_D3D12_OPTIONS featureDataOpts;
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
 
-#ifdef _DEBUG
-    static inline const bool enableDebugLayers = true;
-#else
-    static inline const bool enableDebugLayers = false;
-#endif
-};
+            bool await_ready() const noexcept {
+                return false;
+            }
 
-#pragma endregion
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
 
-#pragma region Public Interface
+            void await_resume() const {
+                if (handle.promise().exception) {
+                    std::rethrow_exception(handle.promise().exception);
+                }
+            }
+        };
 
-bool Harmony::Init(HINSTANCE inst) {
-    hInstance = inst;
+        return Awaiter { handle };
+    }
 
-    try {
-        OpenWindow(hInstance);
+private:
+    friend class CoroutineExecutor;
 
-        CreateAdapter();
+    explicit Task(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {}
 
-        CreateDevice();
+    std::coroutine_handle<promise_type> handle;
+};
 
-        CreateCommandQueue();
+//
+// Runs Tasks against the frame loop: Poll() once per frame on the frame thread resumes everything
+// whose wait is over, on that thread. Tasks wait on
+//   Fence(pFence, value)   anything with GetCompletedValue(), an ID3D12Fence typically
+//   FileRead(...)          an AsyncFileReader read, issued and completed by Poll()
+//   Yield()                nothing, just back to the frame thread at the next Poll()
+// and hop onto job workers with jobSystem.Schedule(). The awaitables can be used from any thread;
+// whatever follows them runs on the frame thread. Failed tasks rethrow from Poll().
+//
+class CoroutineExecutor {
+public:
+    struct ReadResult {
+        bool           ok;
+        const uint8_t* pData;
+        UINT64         size;
+    };
 
-        CreateSwapChain();
+    struct Stats {
+        uint64_t resumes   = 0;
+        uint64_t fences    = 0;
+        uint64_t reads     = 0;
+        uint64_t finished  = 0;
+        uint32_t maxActive = 0;
+    };
 
-        CreateHeaps();
+    // fileReader may be null for an executor that never awaits FileRead
+    void Init(AsyncFileReader* fileReader) {
+        pReader = fileReader;
+    }
 
-        CreateResourcesAndViews();
+    //
+    // Waits for tasks running elsewhere (on workers) to come back and park on a wait, then destroys
+    // all of them. Safe to call twice.
+    //
+    void Destroy() {
+        if (pReader) {
+            pReader->WaitIdle();
+        }
 
-        CreatePipelines();
+        for (;;) {
+            Reap(false);
 
-        CreateCommandLists();
+            if (parked.load(std::memory_order_acquire) >= tasks.size()) {
+                break;
+            }
 
-        CreateSyncObjects();
+            std::this_thread::yield();
+        }
 
-        DownloadDataAndGenMips();
+        tasks.clear();
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ready.clear();
+        fences.clear();
+        reads.clear();
+        parked = 0;
     }
-    catch (std::runtime_error& err) {
-        std::cerr << err.what() << std::endl;
-        return false;
+
+    // starts the task on this thread, it runs until its first wait
+    void Spawn(Task&& task) {
+        tasks.push_back(std::move(task));
+        stats.maxActive = (std::max)(stats.maxActive, static_cast<uint32_t>(tasks.size()));
+
+        tasks.back().handle.resume();
     }
 
-    return true;
-}
+    void Poll() {
+        std::vector<Read> issue;
 
-void Harmony::Run() {
-    for (;;) {
-        MSG msg;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            issue.swap(reads);
+        }
 
-        while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+        for (Read& read : issue) {
+            // an executor without a reader fails its reads rather than leaving the tasks parked
+            if (!pReader) {
+                *read.pResult = { false, nullptr, 0 };
+                Post(read.handle, false);
+                continue;
+            }
+
+            pReader->Read(read.file, read.offset, read.size, read.pDst, [this, read](bool ok, const uint8_t* pData, UINT64 size) {
+                *read.pResult = { ok, pData, size };
+                Post(read.handle, false);
+            });
         }
 
-        if (msg.message == WM_QUIT) {
-            break;
+        if (pReader) {
+            pReader->Submit();
+            pReader->Poll(0);
         }
 
-        Render();
-    }
-}
+        std::vector<std::coroutine_handle<>> resume;
 
-void Harmony::Shutdown() {
-    WaitForGpu();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
 
-    delQ.Finalize();
-}
+            auto done = std::partition(fences.begin(), fences.end(), [](const FenceWait& wait) {
+                return !wait.reached(wait.pFence, wait.value);
+            });
 
-void Harmony::Resize() {
-    //TODO:
-}
+            for (auto it = done; it != fences.end(); ++it) {
+                resume.push_back(it->handle);
+            }
 
-#pragma endregion
+            fences.erase(done, fences.end());
 
-#pragma region Init Calls
+            resume.insert(resume.end(), ready.begin(), ready.end());
+            ready.clear();
+        }
 
-void Harmony::OpenWindow(HINSTANCE instance) {
-    WNDCLASSEX wcex{
-       sizeof(WNDCLASSEX),
-       CS_HREDRAW | CS_VREDRAW,
-       WndProc,
-       0,
-       0,
-       instance,
-       LoadIcon(instance, IDI_APPLICATION),
-       LoadCursor(instance, IDC_ARROW),
-       (HBRUSH)GetStockObject(BLACK_BRUSH),
-       NULL,
-       APPLICATION_NAME,
-       LoadIcon(instance, IDI_APPLICATION)
-    };
+        // a task that yields again lands in ready and waits for the next Poll
+        for (std::coroutine_handle<> handle : resume) {
+            parked.fetch_sub(1, std::memory_order_acq_rel);
+            stats.resumes += 1;
 
-    if (!RegisterClassEx(&wcex)) {
-        throw std::runtime_error("Could not register class!");
+            handle.resume();
+        }
+
+        Reap(true);
     }
 
-    int screenWidth  = GetSystemMetrics(SM_CXSCREEN);
-    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+    auto Yield() {
+        struct Awaiter {
+            CoroutineExecutor* pExecutor;
 
-    int windowX = screenWidth / 2 - WINDOW_WIDTH / 2;
-    int windowY = screenHeight / 2 - WINDOW_HEIGHT / 2;
+            bool await_ready() const noexcept {
+                return false;
+            }
 
-    hMainWindow = CreateWindowEx(
-        WS_EX_OVERLAPPEDWINDOW, APPLICATION_NAME, APPLICATION_NAME,
-        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
-        windowX, windowY, WINDOW_WIDTH, WINDOW_HEIGHT,
-        NULL,
-        NULL,
-        instance,
-        NULL);
+            void await_suspend(std::coroutine_handle<> handle) {
+                pExecutor->Post(handle, true);
+            }
 
-    if (!hMainWindow) {
-        throw std::runtime_error("Could not create main window!");
+            void await_resume() const noexcept {}
+        };
+
+        return Awaiter { this };
     }
 
-    ShowWindow(hMainWindow, SW_SHOW);
-    UpdateWindow(hMainWindow);
-    SetForegroundWindow(hMainWindow);
-    SetFocus(hMainWindow);
+    template <typename F>
+    auto Fence(F* pFence, UINT64 value) {
+        struct Awaiter {
+            CoroutineExecutor* pExecutor;
+            F*                 pFence;
+            UINT64             value;
 
-    SetWindowLongPtr(hMainWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+            bool await_ready() const {
+                return pFence->GetCompletedValue() >= value;
+            }
 
-    delQ.Append(
-        [ cHwnd = hMainWindow] {
-            DestroyWindow(cHwnd);
-        }
-    );
-}
+            void await_suspend(std::coroutine_handle<> handle) {
+                auto reached = [](void* pWaited, UINT64 waitedValue) {
+                    return static_cast<F*>(pWaited)->GetCompletedValue() >= waitedValue;
+                };
 
-void Harmony::CreateAdapter() {
-    UINT dxgiFactoryFlags = 0;
+                std::lock_guard<std::mutex> lock(pExecutor->mutex);
 
-    if constexpr (enableDebugLayers) {
-        ComPtr<ID3D12Debug> debugController;
+                pExecutor->fences.push_back({ reached, pFence, value, handle });
+                pExecutor->parked.fetch_add(1, std::memory_order_acq_rel);
+                pExecutor->stats.fences += 1;
+            }
 
-        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
-            debugController->EnableDebugLayer();
+            void await_resume() const noexcept {}
+        };
 
-            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
-        }
+        return Awaiter { this, pFence, value };
     }
 
-    ComPtr<IDXGIFactory> factory;
-    if (FAILED(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)))) {
-        throw std::runtime_error("Could not create DXGI factory!");
-    }
+    // size bytes of file at offset into pDst, see AsyncFileReader::Read for direct files
+    auto FileRead(uint32_t file, UINT64 offset, UINT64 size, void* pDst) {
+        struct Awaiter {
+            CoroutineExecutor* pExecutor;
+            Read               read;
+            ReadResult         result;
 
-    ComPtr<IDXGIAdapter1> adapter1;
-    ComPtr<IDXGIFactory7> factory7;
-    if (SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&factory7)))) {
-        UINT adapterIndex = 0;
+            bool await_ready() const noexcept {
+                return false;
+            }
 
-        for (; SUCCEEDED(factory7->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter1))); ++adapterIndex)
-        {
-            DXGI_ADAPTER_DESC1 desc;
-            adapter1->GetDesc1(&desc);
+            void await_suspend(std::coroutine_handle<> handle) {
+                read.handle  = handle;
+                read.pResult = &result;
 
-            if (desc.Flags & DXGI_ADAPTER_FLAG::DXGI_ADAPTER_FLAG_SOFTWARE) {
-                continue;
+                std::lock_guard<std::mutex> lock(pExecutor->mutex);
+
+                pExecutor->reads.push_back(read);
+                pExecutor->parked.fetch_add(1, std::memory_order_acq_rel);
+                pExecutor->stats.reads += 1;
             }
 
-            if (SUCCEEDED(D3D12CreateDevice(adapter1.Get(), featureLevel, __uuidof(ID3D12Device), nullptr))) {
-                break;
+            ReadResult await_resume() const noexcept {
+                return result;
             }
-        }
+        };
+
+        return Awaiter { this, { file, offset, size, pDst, nullptr, {} }, {} };
     }
 
-    if (!adapter1.Get()) {
-        throw std::runtime_error("Could not find GPU HW adapter!");
+    uint32_t GetActiveTasks() const {
+        return static_cast<uint32_t>(tasks.size());
     }
 
-    pFactory7 = factory7.Detach();
-    pAdapter1 = adapter1.Detach();
+    Stats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
 
-    delQ.Append([cFactory = pFactory7, cAdapter = pAdapter1] {
-        cAdapter->Release();
-        cFactory->Release();
-    });
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
 
-    DXGI_ADAPTER_DESC1 adDesc = {};
-    pAdapter1->GetDesc1(&adDesc);
+        if (!force && (now - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
 
-    std::wcout << "Running on: " << adDesc.Description << std::endl;
-    std::wcout << "     Video  Mem: " << GetSizeInMB(adDesc.DedicatedVideoMemory)  << "MB" << std::endl;
-    std::wcout << "     System Mem: " << GetSizeInMB(adDesc.DedicatedSystemMemory) << "MB" << std::endl;
-    std::wcout << "     Shared Mem: " << GetSizeInMB(adDesc.SharedSystemMemory)    << "MB" << std::endl;
-}
+        Stats current = GetStats();
 
-void Harmony::CreateDevice() {
-    ComPtr<ID3D12Device9> device;
+        if (current.resumes == 0 && current.finished == 0) {
+            return;
+        }
 
-    if (FAILED(D3D12CreateDevice(pAdapter1, featureLevel, IID_PPV_ARGS(&device)))) {
-        throw std::runtime_error("Could not create ID3D12Device9 device!");
+        std::cout << "Tasks: " << tasks.size() << " active (max " << current.maxActive << "), " << current.finished << " finished, "
+                  << current.resumes << " resumes, " << current.fences << " fence waits, " << current.reads << " reads" << std::endl;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats = {};
+        }
+
+        statStart = now;
     }
 
-    pDevice9 = device.Detach();
+private:
+    struct FenceWait
+    {
+        bool                    (*reached)(void* pFence, UINT64 value);
+        void*                   pFence;
+        UINT64                  value;
+        std::coroutine_handle<> handle;
+    };
 
-    delQ.Append([cDevice = pDevice9] {
-        cDevice->Release();
-    });
+    struct Read
+    {
+        uint32_t                file;
+        UINT64                  offset;
+        UINT64                  size;
+        void*                   pDst;
+        ReadResult*             pResult;
+        std::coroutine_handle<> handle;
+    };
 
-    // Query feature 
-    pDevice9->CheckFeatureSupport(D3D12_FEATURE::D3D12_FEATURE_D3D12_OPTIONS, &featureDataOpts, sizeof featureDataOpts);
-    if (featureDataOpts.ResourceHeapTier != D3D12_RESOURCE_HEAP_TIER_2) {
-        std::cout << "Resource heap Tier is not Tier 2!" << std::endl;
-    }
+    // park: false for completed reads, they were counted when queued
+    void Post(std::coroutine_handle<> handle, bool park) {
+        std::lock_guard<std::mutex> lock(mutex);
 
-    D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_6 };
+        ready.push_back(handle);
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel)))
-        || (shaderModel.HighestShaderModel < D3D_SHADER_MODEL_6_6)) {
-        throw std::runtime_error("Shader Model 6.6 is not supported!");
+        if (park) {
+            parked.fetch_add(1, std::memory_order_acq_rel);
+        }
     }
 
-    D3D12_FEATURE_DATA_D3D12_OPTIONS7 features = {};
+    // drops finished tasks, rethrowing the first failure if asked to
+    void Reap(bool rethrow) {
+        std::exception_ptr failure;
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &features, sizeof(features)))
-        || (features.SamplerFeedbackTier == D3D12_SAMPLER_FEEDBACK_TIER_NOT_SUPPORTED)) {
-        throw std::exception("Sampler Feedback isn't supported!");
-    }
-}
+        for (size_t i = 0; i < tasks.size();) {
+            if (!tasks[i].IsFinished()) {
+                ++i;
+                continue;
+            }
 
-void Harmony::CreateCommandQueue() {
-    ComPtr<ID3D12CommandQueue> cmdQueue;
+            if (!failure) {
+                failure = tasks[i].handle.promise().exception;
+            }
 
-    {
-        D3D12_COMMAND_QUEUE_DESC desc = {
-            .Type     = D3D12_COMMAND_LIST_TYPE_DIRECT,
-            .Priority = 0,
-            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
-            .NodeMask = 0
-        };
+            tasks.erase(tasks.begin() + i);
+            stats.finished += 1;
+        }
 
-        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
-            throw std::runtime_error("Could not create graphics command queue");
+        if (failure && rethrow) {
+            std::rethrow_exception(failure);
         }
+    }
 
-        pCommandQueue = cmdQueue.Detach();
+    AsyncFileReader*                      pReader   = nullptr;
+    std::vector<Task>                     tasks;
 
-        delQ.Append([cCommandQueue = pCommandQueue] {
-            cCommandQueue->Release();
-        });
-    }
+    mutable std::mutex                    mutex;
+    std::vector<std::coroutine_handle<>>  ready;
+    std::vector<FenceWait>                fences;
+    std::vector<Read>                     reads;
+    std::atomic<size_t>                   parked    = 0;    // handles in the lists above and reads in flight
 
-    {
-        D3D12_COMMAND_QUEUE_DESC desc = {
-            .Type     = D3D12_COMMAND_LIST_TYPE_COPY,
-            .Priority = 0,
-            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
-            .NodeMask = 0
-        };
+    Stats                                 stats;
+    std::chrono::steady_clock::time_point statStart = std::chrono::steady_clock::now();
+};
 
-        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
-            throw std::runtime_error("Could not create copy command queue");
+//
+// Assets in independently decompressible chunks: a header, the chunk table, then the chunks. Chunks
+// are compressed with the Windows compression API in raw block mode (XPRESS Huffman unless asked
+// otherwise) and stored as they are when that doesn't make them smaller. The table places every
+// chunk both in the file and in the uncompressed asset, so any chunk (a streamed tile, say) can be
+// loaded on its own.
+//
+class ChunkedAsset {
+public:
+    static constexpr uint32_t MAGIC         = 0x41434653;   // "SFCA"
+    static constexpr uint32_t STORED        = 0;            // algorithm of assets that aren't compressed
+    static constexpr uint32_t MAX_CHUNK     = 256 * 1024;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t algorithm;         // COMPRESS_ALGORITHM_*, or STORED
+        uint32_t chunkCount;
+        uint32_t maxStoredSize;
+        UINT64   rawSize;
+    };
+
+    struct Chunk {
+        UINT64   fileOffset;
+        UINT64   rawOffset;
+        uint32_t storedSize;        // == rawSize: stored uncompressed
+        uint32_t rawSize;
+    };
+
+    //
+    // Cooks size bytes into chunkSize chunks. The file is written unbuffered (padded to whole sectors),
+    // so it doesn't start out in the file cache.
+    //
+    static bool Write(const std::wstring& path, const uint8_t* pData, UINT64 size, uint32_t chunkSize, uint32_t algorithm) {
+        if (chunkSize == 0 || chunkSize > MAX_CHUNK) {
+            throw std::runtime_error("Unsupported asset chunk size!");
         }
 
-        pCopyQueue = cmdQueue.Detach();
+        uint32_t chunkCount = static_cast<uint32_t>((size + chunkSize - 1) / chunkSize);
 
-        delQ.Append([cCommandQueue = pCommandQueue] {
-            cCommandQueue->Release();
-        });
-    }
-}
+        Header             header { MAGIC, algorithm, chunkCount, 0, size };
+        std::vector<Chunk> chunks(chunkCount);
+        std::vector<uint8_t> stored;
 
-void Harmony::CreateSwapChain() {
-    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = { 0 };
+        COMPRESSOR_HANDLE compressor = NULL;
 
-    swapChainDesc.BufferCount = MAX_FRAMES_IN_FLIGHT;
-    swapChainDesc.Width       = WINDOW_WIDTH;
-    swapChainDesc.Height      = WINDOW_HEIGHT;
-    swapChainDesc.Format      = DXGI_FORMAT_R8G8B8A8_UNORM;
-    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-    swapChainDesc.SwapEffect  = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+        if (algorithm != STORED && !CreateCompressor(algorithm | COMPRESS_RAW, nullptr, &compressor)) {
+            return false;
+        }
 
-    swapChainDesc.SampleDesc.Count   = 1;
-    swapChainDesc.SampleDesc.Quality = 0;
+        std::vector<uint8_t> scratch(chunkSize);
 
-    ComPtr<IDXGISwapChain1> swapChain;
-    
-    if (FAILED(pFactory7->CreateSwapChainForHwnd(pCommandQueue, hMainWindow, &swapChainDesc, nullptr, nullptr, &swapChain))) {
-        throw std::runtime_error("Could not create swap chain!");
-    }
+        for (uint32_t i = 0; i < chunkCount; ++i) {
+            Chunk& chunk = chunks[i];
 
-    if (FAILED(pFactory7->MakeWindowAssociation(hMainWindow, DXGI_MWA_NO_ALT_ENTER))) {
-        throw std::runtime_error("Could not associate swap chain with hWnd!");
-    }
+            chunk.rawOffset = UINT64(i) * chunkSize;
+            chunk.rawSize   = static_cast<uint32_t>((std::min)(UINT64(chunkSize), size - chunk.rawOffset));
 
-    swapChain->QueryInterface(&pSwapChain4);
-    if (!pSwapChain4) {
-        throw std::runtime_error("Could not get SwapChain4 interface!");
-    }
+            const uint8_t* pChunk         = pData + chunk.rawOffset;
+            SIZE_T         compressedSize = 0;
 
-    frameIndex = pSwapChain4->GetCurrentBackBufferIndex();
+            // too big for scratch (no smaller than the chunk itself) fails, and the chunk is stored
+            if (compressor && Compress(compressor, pChunk, chunk.rawSize, scratch.data(), chunk.rawSize - 1, &compressedSize)) {
+                chunk.storedSize = static_cast<uint32_t>(compressedSize);
+                stored.insert(stored.end(), scratch.data(), scratch.data() + compressedSize);
+            }
+            else {
+                chunk.storedSize = chunk.rawSize;
+                stored.insert(stored.end(), pChunk, pChunk + chunk.rawSize);
+            }
 
-    delQ.Append([cSwapChain = pSwapChain4 ] {
-        cSwapChain->Release();
-    });
+            chunk.fileOffset     = stored.size() - chunk.storedSize;
+            header.maxStoredSize = (std::max)(header.maxStoredSize, chunk.storedSize);
+        }
 
-    viewport    = D3D12_VIEWPORT{ .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = WINDOW_WIDTH, .Height = WINDOW_HEIGHT, .MinDepth = D3D12_MIN_DEPTH, .MaxDepth = D3D12_MAX_DEPTH };
-    scissorRect = D3D12_RECT{ .left = 0, .top = 0, .right = WINDOW_WIDTH, .bottom = WINDOW_HEIGHT };
-}
+        if (compressor) {
+            CloseCompressor(compressor);
+        }
 
-void Harmony::CreateHeaps() {
-    ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+        UINT64 dataOffset = sizeof(Header) + sizeof(Chunk) * UINT64(chunkCount);
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
-            .NumDescriptors = MAX_FRAMES_IN_FLIGHT,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
-        };
+        for (auto& chunk : chunks) {
+            chunk.fileOffset += dataOffset;
+        }
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create RTV heap!");
+        UINT64 fileSize   = dataOffset + stored.size();
+        UINT64 paddedSize = (fileSize + AsyncFileReader::ALIGNMENT - 1) & ~(AsyncFileReader::ALIGNMENT - 1);
+
+        uint8_t* pImage = static_cast<uint8_t*>(VirtualAlloc(nullptr, paddedSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (!pImage) {
+            return false;
         }
 
-        rtvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-        pRtvHeap = descriptorHeap.Detach();
+        memcpy(pImage, &header, sizeof header);
+        memcpy(pImage + sizeof header, chunks.data(), sizeof(Chunk) * chunkCount);
+        memcpy(pImage + dataOffset, stored.data(), stored.size());
 
-        delQ.Append([cHeap = pRtvHeap] {
-            cHeap->Release();
-        });
-    }
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, nullptr);
+        bool   ok   = file != INVALID_HANDLE_VALUE;
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
-            .NumDescriptors = 1,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
-        };
+        for (UINT64 offset = 0; ok && offset < paddedSize;) {
+            DWORD toWrite = static_cast<DWORD>((std::min)(paddedSize - offset, UINT64(64) << 20));
+            DWORD written = 0;
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create DSV heap!");
+            ok      = WriteFile(file, pImage + offset, toWrite, &written, nullptr) && written == toWrite;
+            offset += toWrite;
         }
 
-        dsvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
-        pDsvHeap = descriptorHeap.Detach();
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
 
-        delQ.Append([cHeap = pDsvHeap] {
-            cHeap->Release();
-        });
+        VirtualFree(pImage, 0, MEM_RELEASE);
+
+        return ok;
     }
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-            .NumDescriptors = 128, // sufficiently large to hold mipgen SRV and UAV chain
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-        };
+    //
+    // Header and chunk table, blocking. Fails on anything the loader can't trust: a table that doesn't
+    // fit the file, or a chunk that lies outside the file or the asset, or is bigger than the header
+    // (and so the loader's read buffers) or MAX_CHUNK allow.
+    //
+    bool Open(const std::wstring& assetPath) {
+        HANDLE file = CreateFileW(assetPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
         }
 
-        srvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-        pSrvHeap = descriptorHeap.Detach();
+        LARGE_INTEGER fileSize = {};
+        DWORD         read     = 0;
 
-        // CPU only (for UAV clear)
-        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create CBV_SRV_UAV CPU only heap!");
-        }
+        bool ok = GetFileSizeEx(file, &fileSize) && UINT64(fileSize.QuadPart) >= sizeof header
+               && ReadFile(file, &header, sizeof header, &read, nullptr) && read == sizeof header
+               && header.magic == MAGIC && header.maxStoredSize <= MAX_CHUNK
+               && header.chunkCount <= (UINT64(fileSize.QuadPart) - sizeof header) / sizeof(Chunk);
 
-        pUavHeap = descriptorHeap.Detach();
+        if (ok) {
+            chunks.resize(header.chunkCount);
 
-        delQ.Append([cHeap = pUavHeap] {
-            cHeap->Release();
-        });
-    }
+            DWORD tableSize = static_cast<DWORD>(sizeof(Chunk) * header.chunkCount);
 
-    {
-        D3D12_DESCRIPTOR_HEAP_DESC smpHeapDesc {
-            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
-            .NumDescriptors = 8,
-            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
-        };
+            ok = ReadFile(file, chunks.data(), tableSize, &read, nullptr) && read == tableSize;
+        }
 
-        if (FAILED(pDevice9->CreateDescriptorHeap(&smpHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
-            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        for (size_t i = 0; ok && i < chunks.size(); ++i) {
+            const Chunk& chunk = chunks[i];
+
+            ok = chunk.rawSize != 0 && chunk.rawSize <= MAX_CHUNK
+              && chunk.storedSize != 0 && chunk.storedSize <= chunk.rawSize && chunk.storedSize <= header.maxStoredSize
+              && (header.algorithm != STORED || chunk.storedSize == chunk.rawSize)
+              && chunk.rawOffset <= header.rawSize && chunk.rawSize <= header.rawSize - chunk.rawOffset
+              && chunk.fileOffset <= UINT64(fileSize.QuadPart) && chunk.storedSize <= UINT64(fileSize.QuadPart) - chunk.fileOffset;
         }
 
-        smpDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
-        pSmpHeap = descriptorHeap.Detach();
+        CloseHandle(file);
 
-        delQ.Append([cHeap = pSmpHeap] {
-            cHeap->Release();
-        });
+        path = assetPath;
+
+        return ok;
     }
 
-    auto AllocateHeap = [cDevice = pDevice9](UINT64 chunkSize, D3D12_HEAP_TYPE type) -> ID3D12Heap* {
-        D3D12_HEAP_PROPERTIES hProps = cDevice->GetCustomHeapProperties(0, type);
+    const Header& GetHeader() const {
+        return header;
+    }
 
-        D3D12_HEAP_DESC heapDesc {
-            .SizeInBytes = chunkSize,
-            .Properties = {.Type = type, .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN, .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN, .CreationNodeMask = hProps.CreationNodeMask , .VisibleNodeMask = hProps.VisibleNodeMask },
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Flags      = D3D12_HEAP_FLAG_NONE
-        };
+    const std::vector<Chunk>& GetChunks() const {
+        return chunks;
+    }
 
-        ComPtr<ID3D12Heap> memHeap;
-        if (FAILED(cDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&memHeap)))) {
-            throw std::runtime_error("Could not create default memory heap!");
-        }
+    const std::wstring& GetPath() const {
+        return path;
+    }
 
-        return memHeap.Detach();
+private:
+    Header             header = {};
+    std::vector<Chunk> chunks;
+    std::wstring       path;
+};
+
+//
+// Loads chunks of a ChunkedAsset straight into caller memory, an upload heap typically. Stored chunks
+// are read direct through the AsyncFileReader into page aligned read buffers and decompressed by
+// jobs into their destination, so the asset's bytes are written once, where the GPU copies them
+// from. Reads and decompression overlap: a read buffer goes back to the reader as soon as its chunk
+// is decoded. Each job system worker keeps its own decompressors (a decompressor is single threaded).
+// Load() blocks the calling thread; LoadAsync() does the same as a Task on a CoroutineExecutor.
+//
+class ChunkLoader {
+public:
+    struct Target {
+        uint32_t chunk;
+        uint8_t* pDst;              // the chunk's rawSize bytes go here
     };
 
-    pResourceHeap = AllocateHeap(DEFAULT_CHUNK_SIZE, D3D12_HEAP_TYPE_DEFAULT);
-    
-    delQ.Append([cHeap = pResourceHeap] {
-        cHeap->Release();
-    });
-}
+    void Init(AsyncFileReader* fileReader, JobSystem* jobSystem, uint32_t readBuffers = 32) {
+        if (jobSystem->GetWorkerCount() == 0 || readBuffers == 0) {
+            throw std::runtime_error("Chunk loader needs job workers and read buffers!");
+        }
 
-void Harmony::CreateResourcesAndViews() {
-    UINT64 defaultHeapOffset = 0;
+        pReader     = fileReader;
+        pJobs       = jobSystem;
+        bufferSize  = AsyncFileReader::AlignedSize(AsyncFileReader::ALIGNMENT - 1, ChunkedAsset::MAX_CHUNK);
+        bufferCount = readBuffers;
 
-    // CB
-    {
-        D3D12_RESOURCE_DESC cbDesc {
-            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width            = sizeof(UniformBuffer) * MAX_FRAMES_IN_FLIGHT,
-            .Height           = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels        = 1,
-            .Format           = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc       = { .Count = 1, .Quality = 0 },
-            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags            = D3D12_RESOURCE_FLAG_NONE,
-        };
+        pBuffers = static_cast<uint8_t*>(VirtualAlloc(nullptr, bufferSize * bufferCount, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (!pBuffers) {
+            throw std::runtime_error("Could not allocate chunk read buffers!");
+        }
 
-        D3D12_HEAP_PROPERTIES uploadHeapProps {
-            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
-            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
-            .CreationNodeMask       = 0,
-            .VisibleNodeMask        = 0
-        };
+        decompressors.resize(pJobs->GetWorkerCount());
+    }
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &cbDesc);
-        if (resInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
-            cbDesc.Alignment = resInfo.Alignment;
+    // loads must have finished
+    void Destroy() {
+        for (auto& workerDecompressors : decompressors) {
+            for (auto& [algorithm, decompressor] : workerDecompressors) {
+                CloseDecompressor(decompressor);
+            }
         }
 
-        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pConstantBuffer)))) {
-            throw std::runtime_error("Could not create constant buffer!");
-        }
+        decompressors.clear();
 
-        delQ.Append([cbuff = pConstantBuffer] {
-            cbuff->Release();
-        });
+        if (pBuffers) {
+            VirtualFree(pBuffers, 0, MEM_RELEASE);
+            pBuffers = nullptr;
+        }
     }
 
-    // Feedback readback
-    {
-        D3D12_RESOURCE_DESC fbBuffDesc {
-            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width            = (TEXTURE_WIDTH / TEXTURE_MMW) * (TEXTURE_HEIGHT / TEXTURE_MMH), // 16 texels
-            .Height           = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels        = 1,
-            .Format           = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc       = { .Count = 1, .Quality = 0 },
-            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags            = D3D12_RESOURCE_FLAG_NONE,
-        };
+    //
+    // Loads the targets' chunks from file (the asset, opened direct on the reader) and blocks until
+    // all of them are decoded. False if a read or a decode failed.
+    //
+    bool Load(const ChunkedAsset& asset, uint32_t file, const std::vector<Target>& targets) {
+        const auto& chunks = asset.GetChunks();
 
-        D3D12_HEAP_PROPERTIES readbackHeapProps {
-            .Type                   = D3D12_HEAP_TYPE_READBACK,
-            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
-            .CreationNodeMask       = 0,
-            .VisibleNodeMask        = 0
-        };
+        std::vector<uint32_t> freeBuffers;
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &fbBuffDesc);
-        if (resInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
-            fbBuffDesc.Alignment = resInfo.Alignment;
+        for (uint32_t i = bufferCount; i > 0; --i) {
+            freeBuffers.push_back(i - 1);
         }
 
-        if (FAILED(pDevice9->CreateCommittedResource(&readbackHeapProps, D3D12_HEAP_FLAG_NONE, &fbBuffDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pFeedbackBuffer)))) {
-            throw std::runtime_error("Could not create readback buffer!");
-        }
+        size_t   next    = 0;
+        size_t   decoded = 0;
+        bool     ok      = true;
+        uint32_t algo    = asset.GetHeader().algorithm;
+
+        auto begin = std::chrono::steady_clock::now();
+
+        while (decoded < targets.size()) {
+            // keep every free buffer reading
+            for (; next < targets.size() && !freeBuffers.empty(); ++next) {
+                const Target&              target = targets[next];
+                const ChunkedAsset::Chunk& chunk  = chunks[target.chunk];
+
+                uint32_t buffer = freeBuffers.back();
+                freeBuffers.pop_back();
+
+                statStored += chunk.storedSize;
+                statRaw    += chunk.rawSize;
+
+                pReader->Read(file, chunk.fileOffset, chunk.storedSize, pBuffers + size_t(buffer) * bufferSize,
+                    [this, &ok, buffer, algo, chunk, pDst = target.pDst](bool readOk, const uint8_t* pData, UINT64) {
+                        if (!readOk) {
+                            ok = false;
+                            Finish(buffer, false);
+                            return;
+                        }
+
+                        pJobs->Spawn([this, job = Job { pData, chunk.storedSize, pDst, chunk.rawSize, algo, buffer }] {
+                            Finish(job.buffer, Decode(job));
+                        });
+                    });
+            }
 
-        delQ.Append([cbuff = pFeedbackBuffer] {
-            cbuff->Release();
-            });
-    }
-    
-    // DS
-    {
-        D3D12_CLEAR_VALUE dsVal {
-            .Format = DXGI_FORMAT_D32_FLOAT,
-            .Color = { 1.0f, 1.0f, 1.0f, 1.0f }
-        };
+            pReader->Submit();
 
-        D3D12_RESOURCE_DESC depthDesc {
-            .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width     = WINDOW_WIDTH,
-            .Height    = WINDOW_HEIGHT,
-            .DepthOrArraySize = 1,
-            .MipLevels = 1,
-            .Format = DXGI_FORMAT_D32_FLOAT,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
-            .Flags  = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL,
-        };
+            bool progressed = pReader->Poll(0) > 0;
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &depthDesc);
-        
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &depthDesc, D3D12_RESOURCE_STATE_COMMON, &dsVal, IID_PPV_ARGS(&pDepthBuffer)))) {
-            throw std::runtime_error("Could not create depth buffer!");
-        }
+            {
+                std::unique_lock<std::mutex> lock(mutex);
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+                // nothing came in: wait on the reads, or on the workers once everything has been read
+                if (!progressed && finished.empty()) {
+                    if (pReader->GetInFlight() > 0) {
+                        lock.unlock();
+                        pReader->Poll(1);
+                        lock.lock();
+                    }
+                    else {
+                        doneCv.wait(lock, [this] { return !finished.empty(); });
+                    }
+                }
 
-        delQ.Append([cbuff = pDepthBuffer] {
-            cbuff->Release();
-        });
-    }
+                for (const auto& [buffer, decodeOk] : finished) {
+                    freeBuffers.push_back(buffer);
+                    ok      &= decodeOk;
+                    decoded += 1;
+                }
 
-    // Texture + SRV. then Feedback + UAV.
-    {
-        //
-        // tex
-        //
-        D3D12_CLEAR_VALUE texVal {
-            .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .Color = { 0.0f, 0.0f, 0.0f, 0.0f }
-        };
+                finished.clear();
+            }
+        }
 
-        D3D12_RESOURCE_DESC texDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = TEXTURE_WIDTH,
-            .Height     = TEXTURE_HEIGHT,
-            .DepthOrArraySize = 1,
-            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
-            .Format     = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE,
-            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-        };
+        statLoads += 1;
+        statMs    += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count();
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &texDesc);
+        return ok;
+    }
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &texDesc, D3D12_RESOURCE_STATE_COPY_DEST, &texVal, IID_PPV_ARGS(&pTexture)))) {
-            throw std::runtime_error("Could not create texture!");
+    //
+    // Load() without blocking: every read buffer is a lane, a Task that co_awaits the read of the next
+    // chunk nobody has taken yet and decodes it on a worker. This task only yields to the frame loop
+    // until the lanes are done, so the frame thread just issues reads. ok is false if a read or a
+    // decode failed. The targets and the asset have to outlive the task.
+    //
+    Task LoadAsync(CoroutineExecutor& executor, const ChunkedAsset& asset, uint32_t file, const std::vector<Target>& targets, bool& ok) {
+        auto begin = std::chrono::steady_clock::now();
+
+        for (const Target& target : targets) {
+            statStored += asset.GetChunks()[target.chunk].storedSize;
+            statRaw    += asset.GetChunks()[target.chunk].rawSize;
         }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+        AsyncLoad load { .pAsset = &asset, .pTargets = &targets, .file = file };
 
-        delQ.Append([ctex = pTexture] {
-            ctex->Release();
-            });
+        uint32_t lanes = static_cast<uint32_t>((std::min)(size_t(bufferCount), targets.size()));
 
-        //
-        // feedback texture dimensions is same size as paired resource
-        // size is controlled by mip regions ( 8x8 with mips here )
-        // 
-        D3D12_RESOURCE_DESC1 feedbackDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = TEXTURE_WIDTH,
-            .Height     = TEXTURE_HEIGHT,
-            .DepthOrArraySize = 1,
-            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
-            .Format     = DXGI_FORMAT_SAMPLER_FEEDBACK_MIN_MIP_OPAQUE,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_UNKNOWN,
-            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
-            .SamplerFeedbackMipRegion = { .Width = TEXTURE_MMW, .Height = TEXTURE_MMH, .Depth = 1 }
-        };
+        load.lanes.store(lanes, std::memory_order_relaxed);
 
-        D3D12_RESOURCE_ALLOCATION_INFO fbInfo = pDevice9->GetResourceAllocationInfo2(0, 1, &feedbackDesc, nullptr);
+        for (uint32_t buffer = 0; buffer < lanes; ++buffer) {
+            executor.Spawn(LoadLane(executor, load, buffer));
+        }
 
-        if (FAILED(pDevice9->CreatePlacedResource1(pResourceHeap, defaultHeapOffset, &feedbackDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pFeedbackTexture)))) {
-            throw std::runtime_error("Could not create feedback texture!");
+        while (load.lanes.load(std::memory_order_acquire) > 0) {
+            co_await executor.Yield();
         }
 
-        defaultHeapOffset += fbInfo.SizeInBytes;
+        ok = load.ok.load(std::memory_order_relaxed);
 
-        delQ.Append([ctex = pFeedbackTexture] {
-            ctex->Release();
-            });
+        statLoads += 1;
+        statMs    += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
 
-        //
-        // SRV
-        //
-        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
-            .Format                  = DXGI_FORMAT_R8G8B8A8_UNORM,
-            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
-            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-            .Texture2D = {
-                .MostDetailedMip     = 0,
-                .MipLevels           = texDesc.MipLevels,
-                .PlaneSlice          = 0,
-                .ResourceMinLODClamp = 0.0f
-            }
-        };
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
 
-        D3D12_CPU_DESCRIPTOR_HANDLE viewCpuHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        pDevice9->CreateShaderResourceView(pTexture, &srvDesc, viewCpuHandle);
+        if (statLoads == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
 
-        //
-        // feedback UAV
-        //
-        viewCpuHandle.ptr += srvDescriptorSize;
-        pDevice9->CreateSamplerFeedbackUnorderedAccessView(pTexture, pFeedbackTexture, viewCpuHandle);
+        std::cout << "Assets: " << statLoads << " loads, " << statRaw / (1024 * 1024) << " MB from " << statStored / (1024 * 1024)
+                  << " MB read, " << statRaw / (1024.0 * 1024.0) / (statMs / 1000.0f) << " MB/s while loading" << std::endl;
 
-        //
-        // feedback UAV CPU only Heap handle
-        //
-        viewCpuHandle = pUavHeap->GetCPUDescriptorHandleForHeapStart();
-        pDevice9->CreateSamplerFeedbackUnorderedAccessView(pTexture, pFeedbackTexture, viewCpuHandle);
+        statLoads  = 0;
+        statRaw    = 0;
+        statStored = 0;
+        statMs     = 0.0f;
+        statStart  = now;
     }
 
-    // Feedback resolve texture
+private:
+    struct Job
     {
-        D3D12_RESOURCE_DESC fbDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = (TEXTURE_WIDTH / TEXTURE_MMW) * (TEXTURE_HEIGHT / TEXTURE_MMH), // 16 texels
-            .Height     = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels  = 1,
-            .Format     = DXGI_FORMAT_R8_UINT,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_UNKNOWN,
-            .Flags      = D3D12_RESOURCE_FLAG_NONE,
-        };
-
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &fbDesc);
+        const uint8_t* pStored;
+        uint32_t       storedSize;
+        uint8_t*       pDst;
+        uint32_t       rawSize;
+        uint32_t       algorithm;
+        uint32_t       buffer;
+    };
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &fbDesc, D3D12_RESOURCE_STATE_RESOLVE_DEST, nullptr, IID_PPV_ARGS(&pResolveTexture)))) {
-            throw std::runtime_error("Could not create resolve texture!");
+    void Finish(uint32_t buffer, bool decodeOk) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.push_back({ buffer, decodeOk });
         }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
-
-        delQ.Append([ctex = pResolveTexture] {
-            ctex->Release();
-            });
+        doneCv.notify_one();
     }
 
-    // Sampler 
+    // shared by the lanes of a LoadAsync
+    struct AsyncLoad
     {
-        D3D12_SAMPLER_DESC smpDesc {
-            .Filter         = D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT,
-            .AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
-            .MipLODBias     = 0.0f,
-            .MaxAnisotropy  = 0,
-            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
-            .BorderColor    = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK,
-            .MinLOD         = 0.0f,
-            .MaxLOD         = D3D12_FLOAT32_MAX 
-        };
+        const ChunkedAsset*        pAsset   = nullptr;
+        const std::vector<Target>* pTargets = nullptr;
+        uint32_t                   file     = 0;
+        std::atomic<size_t>        next     = 0;        // first target no lane has taken
+        std::atomic<uint32_t>      lanes    = 0;        // still running
+        std::atomic<bool>          ok       = true;
+    };
 
-        pDevice9->CreateSampler(&smpDesc, pSmpHeap->GetCPUDescriptorHandleForHeapStart());
-    }
+    // resumes on a worker after the decode, so the next read is awaited from there
+    Task LoadLane(CoroutineExecutor& executor, AsyncLoad& load, uint32_t buffer) {
+        const auto& chunks = load.pAsset->GetChunks();
+        uint32_t    algo   = load.pAsset->GetHeader().algorithm;
 
-    // VB
-    {
-        D3D12_RESOURCE_DESC vbDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = sizeof(vertices),
-            .Height     = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels  = 1,
-            .Format     = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags      = D3D12_RESOURCE_FLAG_NONE
-        };
+        for (size_t i = load.next++; i < load.pTargets->size() && load.ok; i = load.next++) {
+            const Target&              target = (*load.pTargets)[i];
+            const ChunkedAsset::Chunk& chunk  = chunks[target.chunk];
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &vbDesc);
+            auto read = co_await executor.FileRead(load.file, chunk.fileOffset, chunk.storedSize, pBuffers + size_t(buffer) * bufferSize);
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &vbDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pVertexBuffer)))) {
-            throw std::runtime_error("Could not create vertex buffer!");
-        }
+            if (!read.ok) {
+                load.ok = false;
+                break;
+            }
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+            co_await pJobs->Schedule();
 
-        delQ.Append([cbuff = pVertexBuffer] {
-            cbuff->Release();
-        });
-    }
+            if (!Decode({ read.pData, chunk.storedSize, target.pDst, chunk.rawSize, algo, buffer })) {
+                load.ok = false;
+            }
+        }
 
-    // IB
-    {
-        D3D12_RESOURCE_DESC ibDesc {
-            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-            .Width      = sizeof(indices),
-            .Height     = 1,
-            .DepthOrArraySize = 1,
-            .MipLevels  = 1,
-            .Format     = DXGI_FORMAT_UNKNOWN,
-            .SampleDesc = {.Count = 1, .Quality = 0 },
-            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-            .Flags      = D3D12_RESOURCE_FLAG_NONE
-        };
+        // last touch of load, LoadAsync may return as soon as it sees the count drop
+        load.lanes.fetch_sub(1, std::memory_order_acq_rel);
+    }
 
-        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &ibDesc);
+    bool Decode(const Job& job) {
+        bool decodeOk = true;
 
-        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &ibDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pIndexBuffer)))) {
-            throw std::runtime_error("Could not create index buffer!");
+        if (job.storedSize == job.rawSize) {
+            memcpy(job.pDst, job.pStored, job.rawSize);
         }
+        else {
+            uint32_t            worker       = pJobs->GetWorkerIndex();
+            DECOMPRESSOR_HANDLE decompressor = NULL;
+            SIZE_T              size         = 0;
 
-        defaultHeapOffset += resInfo.SizeInBytes;
+            // jobs run on workers, but a non-worker helping out in a Wait gets a decompressor of its own
+            if (worker != JobSystem::NOT_A_WORKER) {
+                auto it = decompressors[worker].find(job.algorithm);
 
-        delQ.Append([cbuff = pIndexBuffer] {
-            cbuff->Release();
-        });
-    }
+                if (it != decompressors[worker].end()) {
+                    decompressor = it->second;
+                }
+                else if (CreateDecompressor(job.algorithm | COMPRESS_RAW, nullptr, &decompressor)) {
+                    decompressors[worker][job.algorithm] = decompressor;
+                }
+            }
+            else if (!CreateDecompressor(job.algorithm | COMPRESS_RAW, nullptr, &decompressor)) {
+                decompressor = NULL;
+            }
 
-    // RTV
-    {
-        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = pRtvHeap->GetCPUDescriptorHandleForHeapStart();
+            decodeOk = decompressor && Decompress(decompressor, job.pStored, job.storedSize, job.pDst, job.rawSize, &size) && size == job.rawSize;
 
-        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-            if (FAILED(pSwapChain4->GetBuffer(i, IID_PPV_ARGS(&pRenderTargets[i])))) {
-                throw std::runtime_error("Could not Get swap chain buffer!");
+            if (worker == JobSystem::NOT_A_WORKER && decompressor) {
+                CloseDecompressor(decompressor);
             }
-
-            pDevice9->CreateRenderTargetView(pRenderTargets[i], nullptr, rtvHandle);
-            rtvHandle.ptr += rtvDescriptorSize;
         }
+
+        return decodeOk;
     }
 
-    // DSV
-    {
-        D3D12_DEPTH_STENCIL_VIEW_DESC dsViewDesc {
-            .Format        = DXGI_FORMAT_D32_FLOAT,
-            .ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D,
-            .Flags         = D3D12_DSV_FLAG_NONE,
-            .Texture2D     = { 0 }
-        };
+    AsyncFileReader*                         pReader      = nullptr;
+    JobSystem*                               pJobs        = nullptr;
+    uint8_t*                                 pBuffers     = nullptr;
+    UINT64                                   bufferSize   = 0;
+    uint32_t                                 bufferCount  = 0;
+
+    std::vector<std::map<uint32_t, DECOMPRESSOR_HANDLE>> decompressors;    // per worker, by algorithm
+    std::vector<std::pair<uint32_t, bool>>   finished;     // read buffer, decoded
+    std::mutex                               mutex;
+    std::condition_variable                  doneCv;
+
+    uint64_t                                 statLoads    = 0;
+    uint64_t                                 statRaw      = 0;
+    uint64_t                                 statStored   = 0;
+    float                                    statMs       = 0.0f;
+    std::chrono::steady_clock::time_point    statStart    = std::chrono::steady_clock::now();
+};
 
-        D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+//
+// Streams data into default heap resources through a persistently mapped staging
+// ring on the copy queue. Requests are batched into one command list per Submit().
+// Destinations must be in COMMON: the copy queue promotes them to COPY_DEST and
+// they decay back to COMMON when the batch completes, so the consuming queue waits
+// on the returned fence value and transitions from COMMON itself.
+//
+class UploadManager {
+public:
+    static constexpr UINT64 STAGING_SIZE = 64 * 1024 * 1024;
+
+    void Init(ID3D12Device* device, ID3D12CommandQueue* queue) {
+        pDevice = device;
+        pQueue  = queue;
+
+        if (FAILED(pDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&pFence)))) {
+            throw std::runtime_error("Could not create upload fence!");
+        }
+
+        waitEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (!waitEvent) {
+            throw std::runtime_error("Could not create upload event!");
+        }
+
+        D3D12_RESOURCE_DESC stagingDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = STAGING_SIZE,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_HEAP_PROPERTIES uploadHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        if (FAILED(pDevice->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &stagingDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pStaging)))) {
+            throw std::runtime_error("Could not create upload staging ring!");
+        }
+
+        void* pData = nullptr;
+        if (FAILED(pStaging->Map(0, nullptr, &pData)) || pData == nullptr) {
+            throw std::runtime_error("Could not map upload staging ring!");
+        }
+
+        pStagingData = reinterpret_cast<uint8_t*>(pData);
+    }
+
+    void Destroy() {
+        WaitIdle();
+        ReportStats(true);
+
+        for (auto* pAllocator : freeAllocators) {
+            pAllocator->Release();
+        }
+        freeAllocators.clear();
+
+        if (isRecording) {
+            pCommandList->Close();
+            recording.pAllocator->Release();
+            isRecording = false;
+        }
+
+        if (pCommandList) pCommandList->Release();
+        if (pStaging)     pStaging->Release();
+        if (pFence)       pFence->Release();
+        if (waitEvent)    CloseHandle(waitEvent);
+
+        pCommandList = nullptr;
+        pStaging     = nullptr;
+        pFence       = nullptr;
+        waitEvent    = NULL;
+    }
+
+    //
+    // Queue a copy into a buffer. Returns false if the staging ring can't hold the data
+    // right now; Submit/Poll and retry.
+    //
+    bool UploadBuffer(ID3D12Resource* dst, UINT64 dstOffset, const void* data, UINT64 size) {
+        if (!BeginBatch()) {
+            return false;
+        }
+
+        UINT64 offset = AllocateStaging(size, 4);
+        if (offset == INVALID_OFFSET) {
+            return false;
+        }
+
+        memcpy_s(pStagingData + offset, size, data, size);
+
+        pCommandList->CopyBufferRegion(dst, dstOffset, pStaging, offset, size);
+        recording.payloadBytes += size;
+
+        return true;
+    }
+
+    //
+    // Queue a copy of a width x height texel block into (dstX, dstY) of a texture subresource.
+    // srcRowPitch is the pitch of the tightly laid out source data.
+    //
+    bool UploadTexture(ID3D12Resource* dst, UINT subresource, UINT dstX, UINT dstY, UINT width, UINT height, const void* data, UINT64 srcRowPitch) {
+        UINT     rowPitch = 0;
+        UINT     numRows  = 0;
+        UINT64   rowSize  = 0;
+        uint8_t* pStaged  = MapTexture(dst, subresource, dstX, dstY, width, height, rowPitch, numRows, rowSize);
+
+        if (!pStaged) {
+            return false;
+        }
+
+        const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(data);
+
+        for (UINT row = 0; row < numRows; ++row) {
+            memcpy_s(pStaged + UINT64(row) * rowPitch, rowSize, pSrc + row * srcRowPitch, rowSize);
+        }
+
+        return true;
+    }
+
+    //
+    // Like UploadTexture, but hands out the staging memory instead of copying into it: numRows rows
+    // of rowSize bytes, rowPitch apart, which the caller fills before Submit(). Lets loaders produce
+    // the texels in place (decompress into upload memory). nullptr if the ring can't hold them now.
+    //
+    uint8_t* MapTexture(ID3D12Resource* dst, UINT subresource, UINT dstX, UINT dstY, UINT width, UINT height, UINT& rowPitch, UINT& numRows, UINT64& rowSize) {
+        if (!BeginBatch()) {
+            return nullptr;
+        }
+
+        D3D12_RESOURCE_DESC regionDesc = dst->GetDesc();
+        regionDesc.Alignment        = 0;
+        regionDesc.Width            = width;
+        regionDesc.Height           = height;
+        regionDesc.DepthOrArraySize = 1;
+        regionDesc.MipLevels        = 1;
+        regionDesc.Layout           = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+        regionDesc.Flags            = D3D12_RESOURCE_FLAG_NONE;
+
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint;
+        UINT64 totalBytes = 0;
+
+        pDevice->GetCopyableFootprints(&regionDesc, 0, 1, 0, &footprint, &numRows, &rowSize, &totalBytes);
+
+        UINT64 offset = AllocateStaging(totalBytes, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        if (offset == INVALID_OFFSET) {
+            return nullptr;
+        }
+
+        footprint.Offset = offset;
+        rowPitch         = footprint.Footprint.RowPitch;
+
+        D3D12_TEXTURE_COPY_LOCATION dstLoc {
+            .pResource        = dst,
+            .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+            .SubresourceIndex = subresource,
+        };
+
+        D3D12_TEXTURE_COPY_LOCATION srcLoc {
+            .pResource       = pStaging,
+            .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+            .PlacedFootprint = footprint
+        };
+
+        pCommandList->CopyTextureRegion(&dstLoc, dstX, dstY, 0, &srcLoc, nullptr);
+        recording.payloadBytes += rowSize * numRows;
+
+        return pStagingData + offset;
+    }
+
+    //
+    // Kick the batch recorded so far. Returns the fence value the consumer has to wait on
+    // (the last submitted value if nothing was recorded).
+    //
+    UINT64 Submit() {
+        if (!isRecording) {
+            return nextFenceValue - 1;
+        }
+
+        pCommandList->Close();
+
+        ID3D12CommandList* lists[] = { pCommandList };
+        pQueue->ExecuteCommandLists(1, lists);
+
+        recording.fenceValue = nextFenceValue++;
+        recording.submitTime = std::chrono::steady_clock::now();
+        pQueue->Signal(pFence, recording.fenceValue);
+
+        inFlight.push_back(recording);
+        isRecording = false;
+
+        return recording.fenceValue;
+    }
+
+    // Recycles finished batches; call once per frame.
+    void Poll() {
+        UINT64 completed = pFence->GetCompletedValue();
+
+        while (!inFlight.empty() && inFlight.front().fenceValue <= completed) {
+            Retire(inFlight.front());
+            inFlight.pop_front();
+        }
+
+        ReportStats(false);
+    }
+
+    void WaitIdle() {
+        if (!pFence) {
+            return;
+        }
+
+        Submit();
+        WaitForFence(pFence, nextFenceValue - 1, waitEvent);
+        Poll();
+    }
+
+    ID3D12Fence* GetFence() const {
+        return pFence;
+    }
+
+private:
+    static constexpr UINT64 INVALID_OFFSET = ~0ull;
+
+    struct Batch
+    {
+        UINT64                                fenceValue   = 0;
+        UINT64                                stagingBytes = 0;    // ring space incl. padding, freed on retire
+        UINT64                                payloadBytes = 0;
+        ID3D12CommandAllocator*               pAllocator   = nullptr;
+        std::chrono::steady_clock::time_point submitTime;
+    };
+
+    bool BeginBatch() {
+        if (isRecording) {
+            return true;
+        }
+
+        ID3D12CommandAllocator* pAllocator = nullptr;
+
+        if (!freeAllocators.empty()) {
+            pAllocator = freeAllocators.back();
+            freeAllocators.pop_back();
+        }
+        else if (FAILED(pDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(&pAllocator)))) {
+            return false;
+        }
+
+        if (!pCommandList) {
+            if (FAILED(pDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, pAllocator, nullptr, IID_PPV_ARGS(&pCommandList)))) {
+                pAllocator->Release();
+                return false;
+            }
+        }
+        else {
+            pCommandList->Reset(pAllocator, nullptr);
+        }
+
+        recording   = Batch{ .pAllocator = pAllocator };
+        isRecording = true;
+
+        return true;
+    }
+
+    //
+    // Ring allocation: live data is the contiguous (wrapping) range of usedBytes ending at head,
+    // so anything that fits in the remaining space can't overlap an in-flight batch.
+    //
+    UINT64 AllocateStaging(UINT64 size, UINT64 alignment) {
+        UINT64 offset   = (head + alignment - 1) & ~(alignment - 1);
+        UINT64 consumed = offset + size - head;
+
+        if (offset + size > STAGING_SIZE) {
+            offset   = 0;
+            consumed = (STAGING_SIZE - head) + size;
+        }
+
+        if (usedBytes + consumed > STAGING_SIZE) {
+            return INVALID_OFFSET;
+        }
+
+        head       = (offset + size) % STAGING_SIZE;
+        usedBytes += consumed;
+
+        recording.stagingBytes += consumed;
+
+        return offset;
+    }
+
+    void Retire(const Batch& batch) {
+        auto now = std::chrono::steady_clock::now();
+
+        usedBytes -= batch.stagingBytes;
+
+        batch.pAllocator->Reset();
+        freeAllocators.push_back(batch.pAllocator);
+
+        // batches complete in order, so the busy time is the union of [submit, complete]
+        auto busyFrom = (std::max)(batch.submitTime, busyUntil);
+
+        statBusy     += now - busyFrom;
+        busyUntil     = now;
+
+        float latencyMs = std::chrono::duration<float, std::milli>(now - batch.submitTime).count();
+
+        statBatches  += 1;
+        statBytes    += batch.payloadBytes;
+        statLatency  += latencyMs;
+        statMaxLat    = (std::max)(statMaxLat, latencyMs);
+
+        if (statBatches == 1) {
+            statStart = batch.submitTime;
+        }
+    }
+
+    //
+    // Latency is submit -> completion observed by Poll, so it includes up to a frame of
+    // polling slack. Throughput is measured over the time the copy queue had work queued.
+    //
+    void ReportStats(bool force) {
+        if (statBatches == 0) {
+            return;
+        }
+
+        if (!force && (std::chrono::steady_clock::now() - statStart) < std::chrono::seconds(1)) {
+            return;
+        }
+
+        float busySec = std::chrono::duration<float>(statBusy).count();
+        float mb      = statBytes / (1024.0f * 1024.0f);
+
+        std::cout << "Uploads: " << statBatches << " batches, " << mb << " MB, "
+                  << (busySec > 0.0f ? mb / busySec : 0.0f) << " MB/s, latency avg "
+                  << statLatency / statBatches << " ms max " << statMaxLat << " ms" << std::endl;
+
+        statBatches = 0;
+        statBytes   = 0;
+        statLatency = 0.0f;
+        statMaxLat  = 0.0f;
+        statBusy    = {};
+    }
+
+    ID3D12Device*                        pDevice        = nullptr;
+    ID3D12CommandQueue*                  pQueue         = nullptr;
+    ID3D12GraphicsCommandList*           pCommandList   = nullptr;
+    ID3D12Fence*                         pFence         = nullptr;
+    ID3D12Resource*                      pStaging       = nullptr;
+    uint8_t*                             pStagingData   = nullptr;
+    HANDLE                               waitEvent      = NULL;
+
+    std::deque<Batch>                    inFlight;
+    std::vector<ID3D12CommandAllocator*> freeAllocators;
+    Batch                                recording;
+    bool                                 isRecording    = false;
+
+    UINT64                               head           = 0;
+    UINT64                               usedBytes      = 0;
+    UINT64                               nextFenceValue = 1;
+
+    UINT64                               statBatches    = 0;
+    UINT64                               statBytes      = 0;
+    float                                statLatency    = 0.0f;
+    float                                statMaxLat     = 0.0f;
+    std::chrono::steady_clock::duration  statBusy       = {};
+    std::chrono::steady_clock::time_point statStart;
+    std::chrono::steady_clock::time_point busyUntil;
+};
+
+//
+// GPU -> CPU readback with one persistently mapped buffer per frame slot. The frame being recorded
+// writes into its slot's slice (Acquire) and the slice becomes readable once the fence value the
+// frame signals has completed, so the CPU never reads a slice the GPU may still write. Slices are
+// separate resources since resolves into buffers can't take an offset. Used for sampler feedback
+// and timestamp queries; anything that copies into a buffer (screenshots, statistics) fits.
+//
+class ReadbackRing {
+public:
+    static constexpr uint32_t MAX_SLICES = 8;
+
+    void Init(ID3D12Device* device, UINT64 size, uint32_t count) {
+        if (count == 0 || count > MAX_SLICES) {
+            throw std::runtime_error("Unsupported number of readback slices!");
+        }
+
+        sliceSize  = size;
+        sliceCount = count;
+
+        D3D12_RESOURCE_DESC bufferDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = sliceSize,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_HEAP_PROPERTIES readbackHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_READBACK,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        for (uint32_t i = 0; i < sliceCount; ++i) {
+            Slice& slice = slices[i];
+
+            if (FAILED(device->CreateCommittedResource(&readbackHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&slice.pResource)))) {
+                throw std::runtime_error("Could not create readback slice!");
+            }
+
+            void* pData = nullptr;
+            if (FAILED(slice.pResource->Map(0, nullptr, &pData)) || pData == nullptr) {
+                throw std::runtime_error("Could not map readback slice!");
+            }
+
+            slice.pData = reinterpret_cast<const uint8_t*>(pData);
+        }
+    }
+
+    void Destroy() {
+        D3D12_RANGE writeRange { .Begin = 0, .End = 0 };
+
+        for (auto& slice : slices) {
+            if (slice.pResource) {
+                slice.pResource->Unmap(0, &writeRange);
+                slice.pResource->Release();
+            }
+
+            slice = {};
+        }
+    }
+
+    //
+    // Slice the frame being recorded writes into; fenceValue is what the frame's queue signals
+    // when it is done.
+    //
+    ID3D12Resource* Acquire(uint32_t slice, UINT64 fenceValue) {
+        slices[slice].fenceValue = fenceValue;
+        slices[slice].sequence   = ++sequence;
+
+        return slices[slice].pResource;
+    }
+
+    // contents of a slice if its writer has completed, nullptr otherwise. Valid until acquired again.
+    const uint8_t* Read(uint32_t slice, UINT64 completedValue) const {
+        const Slice& s = slices[slice];
+
+        return (s.sequence != 0 && s.fenceValue <= completedValue) ? s.pData : nullptr;
+    }
+
+    //
+    // Newest completed slice, or nullptr. Never waits; the age (how many acquires behind the
+    // newest one the data is) and any stall the caller took go into the stats. pSequence gets the
+    // slice's acquire number, which tells a new slice from one already read.
+    //
+    const uint8_t* ReadLatest(UINT64 completedValue, float stallMs = 0.0f, uint64_t* pSequence = nullptr) {
+        const Slice* pNewest = nullptr;
+
+        for (uint32_t i = 0; i < sliceCount; ++i) {
+            const Slice& s = slices[i];
+
+            if (s.sequence != 0 && s.fenceValue <= completedValue && (!pNewest || s.sequence > pNewest->sequence)) {
+                pNewest = &s;
+            }
+        }
+
+        statReads   += 1;
+        statStallMs += stallMs;
+        statMaxStall = (std::max)(statMaxStall, stallMs);
+
+        if (!pNewest) {
+            statMisses += 1;
+            return nullptr;
+        }
+
+        statAge += sequence - pNewest->sequence;
+
+        if (pSequence) {
+            *pSequence = pNewest->sequence;
+        }
+
+        return pNewest->pData;
+    }
+
+    UINT64 GetSliceSize() const {
+        return sliceSize;
+    }
+
+    void ReportStats(const char* name, bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (statReads == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Readback " << name << ": stall avg " << statStallMs / statReads << " ms max " << statMaxStall
+                  << " ms, age avg " << float(statAge) / statReads << " frames, " << statMisses << " misses" << std::endl;
+
+        statReads    = 0;
+        statMisses   = 0;
+        statAge      = 0;
+        statStallMs  = 0.0f;
+        statMaxStall = 0.0f;
+        statStart    = now;
+    }
+
+private:
+    struct Slice
+    {
+        ID3D12Resource* pResource  = nullptr;
+        const uint8_t*  pData      = nullptr;
+        UINT64          fenceValue = 0;
+        uint64_t        sequence   = 0;         // 0: never written
+    };
+
+    std::array<Slice, MAX_SLICES>         slices     = {};
+    UINT64                                sliceSize  = 0;
+    uint32_t                              sliceCount = 0;
+    uint64_t                              sequence   = 0;
+
+    uint64_t                              statReads    = 0;
+    uint64_t                              statMisses   = 0;
+    uint64_t                              statAge      = 0;
+    float                                 statStallMs  = 0.0f;
+    float                                 statMaxStall = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
+
+struct FrameTimestamps
+{
+    std::chrono::steady_clock::time_point cpuStart;
+    std::chrono::steady_clock::time_point submit;
+    std::chrono::steady_clock::time_point present;
+    std::chrono::steady_clock::time_point gpuComplete;
+    bool                                  valid = false;
+};
+
+//
+// Aggregates completed frames (in order) and prints them roughly once a second.
+//
+class FrameTimingStats {
+public:
+    void Add(const FrameTimestamps& timestamps) {
+        using Ms = std::chrono::duration<float, std::milli>;
+
+        frames    += 1;
+        toSubmit  += Ms(timestamps.submit      - timestamps.cpuStart).count();
+        toPresent += Ms(timestamps.present     - timestamps.cpuStart).count();
+        toGpu     += Ms(timestamps.gpuComplete - timestamps.cpuStart).count();
+
+        if (havePresent) {
+            float interval = Ms(timestamps.present - lastPresent).count();
+
+            intervals     += 1;
+            intervalSum   += interval;
+            intervalSqSum += double(interval) * interval;
+            intervalMin    = (std::min)(intervalMin, interval);
+            intervalMax    = (std::max)(intervalMax, interval);
+        }
+
+        lastPresent = timestamps.present;
+        havePresent = true;
+    }
+
+    // returns true if it printed
+    bool Report(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (frames == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return false;
+        }
+
+        std::cout << "Timing: start->submit " << toSubmit / frames << " ms, ->present " << toPresent / frames
+                  << " ms, ->gpu done " << toGpu / frames << " ms";
+
+        if (intervals > 0) {
+            double mean   = double(intervalSum) / intervals;
+            double stddev = sqrt((std::max)(intervalSqSum / intervals - mean * mean, 0.0));
+
+            std::cout << ", present-to-present avg " << mean << " ms (min " << intervalMin << " max "
+                      << intervalMax << " jitter " << stddev << ")";
+        }
+
+        std::cout << std::endl;
+
+        frames        = 0;
+        intervals     = 0;
+        toSubmit      = 0.0f;
+        toPresent     = 0.0f;
+        toGpu         = 0.0f;
+        intervalSum   = 0.0f;
+        intervalSqSum = 0.0;
+        intervalMin   = (std::numeric_limits<float>::max)();
+        intervalMax   = 0.0f;
+        statStart     = now;
+
+        return true;
+    }
+
+private:
+    uint64_t                              frames        = 0;
+    uint64_t                              intervals     = 0;
+    float                                 toSubmit      = 0.0f;
+    float                                 toPresent     = 0.0f;
+    float                                 toGpu         = 0.0f;
+    float                                 intervalSum   = 0.0f;
+    double                                intervalSqSum = 0.0;
+    float                                 intervalMin   = (std::numeric_limits<float>::max)();
+    float                                 intervalMax   = 0.0f;
+    std::chrono::steady_clock::time_point lastPresent;
+    bool                                  havePresent   = false;
+    std::chrono::steady_clock::time_point statStart     = std::chrono::steady_clock::now();
+};
+
+//
+// CPU side of the min mip map the pixel shader clamps its LOD with, one byte per feedback region.
+// Update diffs the streamer's residency against what the GPU copy last received, 32 (AVX2) or 16
+// (SSE2) regions at a time, takes the changes over and returns what to copy: one rectangle per run of
+// changed rows, so scattered tile changes don't turn into a copy of the whole map. Unchanged rows cost
+// one compare per vector, a 16K x 16K texture (128 x 128 regions) is a 16 KB scan.
+//
+class MinMipMap {
+public:
+    static constexpr uint32_t MAX_RECTS = 16;     // further runs are merged into the last rectangle
+
+    struct Rect {
+        uint32_t left;
+        uint32_t top;
+        uint32_t right;         // exclusive
+        uint32_t bottom;
+
+        bool operator==(const Rect&) const = default;
+    };
+
+    void Init(uint32_t mapWidth, uint32_t mapHeight) {
+        width  = mapWidth;
+        height = mapHeight;
+
+        // matches no residency, the first update covers the whole map
+        map.assign(size_t(width) * height, 0xFF);
+    }
+
+    const std::vector<Rect>& Update(const uint8_t* residency) {
+        auto begin = std::chrono::steady_clock::now();
+
+        dirty.clear();
+
+        for (uint32_t y = 0; y < height; ++y) {
+            const uint8_t* pResident = residency + size_t(y) * width;
+            uint8_t*       pMap      = map.data() + size_t(y) * width;
+
+            uint32_t first = width;
+            uint32_t last  = 0;
+            uint32_t x     = 0;
+
+#if defined(__AVX2__)
+            for (; x + 32 <= width; x += 32) {
+                __m256i resident = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pResident + x));
+                __m256i current  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pMap + x));
+
+                uint32_t changed = ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(resident, current)));
+
+                if (changed != 0) {
+                    first = (std::min)(first, x + static_cast<uint32_t>(std::countr_zero(changed)));
+                    last  = x + static_cast<uint32_t>(std::bit_width(changed));
+
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(pMap + x), resident);
+                }
+            }
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+            for (; x + 16 <= width; x += 16) {
+                __m128i resident = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pResident + x));
+                __m128i current  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pMap + x));
+
+                uint32_t changed = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(resident, current))) & 0xFFFF;
+
+                if (changed != 0) {
+                    first = (std::min)(first, x + static_cast<uint32_t>(std::countr_zero(changed)));
+                    last  = x + static_cast<uint32_t>(std::bit_width(changed));
+
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(pMap + x), resident);
+                }
+            }
+#endif
+
+            UpdateScalar(x, pResident, pMap, first, last);
+            AddDirtyRow(y, first, last);
+        }
+
+        statUpdates  += 1;
+        statUpdateUs += std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - begin).count();
+
+        for (const auto& rect : dirty) {
+            statCopies  += 1;
+            statRegions += uint64_t(rect.right - rect.left) * (rect.bottom - rect.top);
+        }
+
+        return dirty;
+    }
+
+    // reference path, same result as Update
+    const std::vector<Rect>& UpdateReference(const uint8_t* residency) {
+        dirty.clear();
+
+        for (uint32_t y = 0; y < height; ++y) {
+            uint32_t first = width;
+            uint32_t last  = 0;
+
+            UpdateScalar(0, residency + size_t(y) * width, map.data() + size_t(y) * width, first, last);
+            AddDirtyRow(y, first, last);
+        }
+
+        return dirty;
+    }
+
+    // width bytes per row, tightly packed
+    const uint8_t* GetData() const {
+        return map.data();
+    }
+
+    uint32_t GetWidth() const {
+        return width;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (statUpdates == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "MinMip: " << float(statCopies) / statUpdates << " copies, " << float(statRegions) / statUpdates
+                  << " regions per frame, update " << statUpdateUs / statUpdates << " us" << std::endl;
+
+        statUpdates  = 0;
+        statCopies   = 0;
+        statRegions  = 0;
+        statUpdateUs = 0.0f;
+        statStart    = now;
+    }
+
+private:
+    void AddDirtyRow(uint32_t y, uint32_t first, uint32_t last) {
+        if (first >= last) {
+            return;
+        }
+
+        if (dirty.empty() || (dirty.back().bottom != y && dirty.size() < MAX_RECTS)) {
+            dirty.push_back({ first, y, last, y + 1 });
+            return;
+        }
+
+        Rect& rect = dirty.back();
+
+        rect.left   = (std::min)(rect.left, first);
+        rect.right  = (std::max)(rect.right, last);
+        rect.bottom = y + 1;
+    }
+
+    void UpdateScalar(uint32_t x, const uint8_t* pResident, uint8_t* pMap, uint32_t& first, uint32_t& last) {
+        for (; x < width; ++x) {
+            if (pResident[x] != pMap[x]) {
+                first   = (std::min)(first, x);
+                last    = x + 1;
+                pMap[x] = pResident[x];
+            }
+        }
+    }
+
+    uint32_t                              width        = 0;
+    uint32_t                              height       = 0;
+    std::vector<uint8_t>                  map;
+    std::vector<Rect>                     dirty;
+
+    uint64_t                              statUpdates  = 0;
+    uint64_t                              statCopies   = 0;
+    uint64_t                              statRegions  = 0;
+    float                                 statUpdateUs = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
+
+//
+// Decides per frame whether and how sampler feedback gets written. Feedback frames run PsFeedback,
+// which writes for 1/pixelRate of the pixels: a 4x4 ordered dither whose phase advances every
+// feedback frame, so a window of pixelRate feedback frames covers every pixel exactly once. The
+// feedback map accumulates over the window (MinMip writes keep the finest mip) and is only cleared
+// at its start and resolved at its end. With a frameInterval above 1 the frames in between run
+// PsMain and don't touch feedback at all.
+//
+class FeedbackRateController {
+public:
+    static constexpr uint32_t MAX_PIXEL_RATE = 16;
+
+    // keep in sync with PsFeedback (Shaders.hlsl)
+    static constexpr uint8_t DITHER[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
+    struct Frame {
+        bool     write;         // PsFeedback, otherwise PsMain
+        bool     clear;         // first feedback frame of a window
+        bool     resolve;       // last feedback frame of a window
+        uint32_t phase;         // dither phase for the shader
+    };
+
+    void Init(uint32_t rate, uint32_t interval) {
+        // the shader masks with rate - 1
+        pixelRate     = std::bit_floor(std::clamp(rate, 1u, MAX_PIXEL_RATE));
+        frameInterval = (std::max)(interval, 1u);
+        frame         = 0;
+    }
+
+    Frame NextFrame() {
+        uint64_t current = frame++;
+
+        if (current % frameInterval != 0) {
+            return { false, false, false, 0 };
+        }
+
+        uint32_t phase = static_cast<uint32_t>((current / frameInterval) % pixelRate);
+
+        return { true, phase == 0, phase == pixelRate - 1, phase };
+    }
+
+    // whether pixel (x, y) writes feedback at this phase, as the shader decides it
+    static bool Writes(uint32_t x, uint32_t y, uint32_t rate, uint32_t phase) {
+        return ((DITHER[(y & 3) * 4 + (x & 3)] + phase) & (rate - 1)) == 0;
+    }
+
+    uint32_t GetPixelRate() const {
+        return pixelRate;
+    }
+
+    uint32_t GetFrameInterval() const {
+        return frameInterval;
+    }
+
+    // frames from the first write of a window to its resolve
+    uint32_t GetWindowFrames() const {
+        return (pixelRate - 1) * frameInterval + 1;
+    }
+
+private:
+    uint32_t pixelRate     = 1;
+    uint32_t frameInterval = 1;
+    uint64_t frame         = 0;
+};
+
+//
+// Feedback maps of many textures packed into one R8_UINT atlas. A feedback window resolves every map
+// into its rect back to back, between one barrier batch in and one out, and a single copy brings the
+// atlas into one readback slice; per texture resolves would each need their own barriers, readback
+// buffer and map (resolves into buffers can't take an offset, into textures they can). The entries
+// are the offset table: Add() every map, Pack() once, then size the atlas from GetWidth()/GetHeight()
+// and the readback from GetReadbackSize(). Decode() walks a read back slice in one pass.
+//
+class FeedbackBatch {
+public:
+    struct Entry {
+        uint32_t texture;
+        uint32_t width;         // regions
+        uint32_t height;
+        uint32_t x;             // rect in the atlas, set by Pack
+        uint32_t y;
+    };
+
+    void Init(uint32_t atlasMaxWidth) {
+        maxWidth = atlasMaxWidth;
+        width    = 0;
+        height   = 0;
+        rowPitch = 0;
+
+        entries.clear();
+    }
+
+    // index of the map in the offset table
+    uint32_t Add(uint32_t texture, uint32_t mapWidth, uint32_t mapHeight) {
+        if (mapWidth == 0 || mapHeight == 0 || mapWidth > maxWidth) {
+            throw std::runtime_error("Feedback map doesn't fit the batch atlas!");
+        }
+
+        entries.push_back({ texture, mapWidth, mapHeight, 0, 0 });
+
+        return static_cast<uint32_t>(entries.size() - 1);
+    }
+
+    // shelf packing, tallest maps first so the shelves waste little
+    void Pack() {
+        std::vector<uint32_t> order(entries.size());
+
+        for (uint32_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return entries[a].height > entries[b].height;
+        });
+
+        uint32_t shelfX      = 0;
+        uint32_t shelfY      = 0;
+        uint32_t shelfHeight = 0;
+
+        width = 0;
+
+        for (uint32_t i : order) {
+            Entry& entry = entries[i];
+
+            if (shelfX + entry.width > maxWidth) {
+                shelfY     += shelfHeight;
+                shelfX      = 0;
+                shelfHeight = 0;
+            }
+
+            entry.x = shelfX;
+            entry.y = shelfY;
+
+            shelfX     += entry.width;
+            shelfHeight = (std::max)(shelfHeight, entry.height);
+            width       = (std::max)(width, shelfX);
+        }
+
+        height   = shelfY + shelfHeight;
+        rowPitch = (width + D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1) & ~(D3D12_TEXTURE_DATA_PITCH_ALIGNMENT - 1);
+    }
+
+    //
+    // One pass over a read back atlas, calling visit(entry, feedback, feedbackPitch) for every map in
+    // offset table order.
+    //
+    template<typename Visit>
+    void Decode(const uint8_t* readback, Visit&& visit) {
+        auto begin = std::chrono::steady_clock::now();
+
+        for (const auto& entry : entries) {
+            visit(entry, readback + size_t(entry.y) * rowPitch + entry.x, size_t(rowPitch));
+        }
+
+        statDecodes  += 1;
+        statDecodeUs += std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    const std::vector<Entry>& GetEntries() const {
+        return entries;
+    }
+
+    uint32_t GetWidth() const {
+        return width;
+    }
+
+    uint32_t GetHeight() const {
+        return height;
+    }
+
+    uint32_t GetRowPitch() const {
+        return rowPitch;
+    }
+
+    UINT64 GetReadbackSize() const {
+        return UINT64(rowPitch) * height;
+    }
+
+    void ReportStats(bool force) {
+        auto now = std::chrono::steady_clock::now();
+
+        if (statDecodes == 0 || (!force && (now - statStart) < std::chrono::seconds(1))) {
+            return;
+        }
+
+        std::cout << "Feedback batch: " << entries.size() << " maps in a " << width << " x " << height << " atlas, "
+                  << GetReadbackSize() << " bytes read back, decode " << statDecodeUs / statDecodes << " us" << std::endl;
+
+        statDecodes  = 0;
+        statDecodeUs = 0.0f;
+        statStart    = now;
+    }
+
+private:
+    std::vector<Entry>                    entries;
+    uint32_t                              maxWidth     = 0;
+    uint32_t                              width        = 0;
+    uint32_t                              height       = 0;
+    uint32_t                              rowPitch     = 0;
+
+    uint64_t                              statDecodes  = 0;
+    float                                 statDecodeUs = 0.0f;
+    std::chrono::steady_clock::time_point statStart    = std::chrono::steady_clock::now();
+};
+
+enum class PresentMode {
+    Vsync,
+    Uncapped,
+    Tearing
+};
+
+//
+// Command line:
+//   --frames=N                       frames in flight, 1 to FrameScheduler::MAX_FRAMES
+//   --latency=N                      waitable swap chain with at most N queued frames (0: off)
+//   --present=vsync|uncapped|tearing
+//   --pacing=none|deadline           sleep-to-deadline needs vsync to have anything to aim at
+//   --readback=ring|sync             sync waits for the frame just submitted, for comparison
+//   --tilepool=N                     64 KB heap tiles for streamed mips, on top of the packed mip tail
+//   --tileloads=N                    tile loads issued per frame at most
+//   --tilebytes=N                    KB of tile reads issued per frame at most (0: no byte budget)
+//   --feedback-rate=N                feedback written for 1/N of the pixels per feedback frame (1, 2, 4, 8, 16)
+//   --feedback-interval=N            feedback frames every Nth frame, the others don't write feedback
+//   --aggregate=raw|hysteresis       how feedback is smoothed over time before it drives streaming
+//   --trace=<file>                   record the feedback fed to the streamer (replay it with AggregationTest <file>)
+//   --asset=<file>                   load mip 0 from a chunked asset, cooked from the built in texture if missing
+//   --simhz=N                        fixed simulation steps per second, the render thread draws the latest one
+//   --bench=<name>                   run a benchmark and exit
+//
+struct Settings
+{
+    uint32_t                   framesInFlight   = 2;
+    uint32_t                   maxLatency       = 0;
+    PresentMode                presentMode      = PresentMode::Vsync;
+    FramePacer::Policy         pacing           = FramePacer::Policy::None;
+    bool                       syncReadback     = false;
+    uint32_t                   tilePool         = 64;
+    uint32_t                   loadsPerUpdate   = 16;
+    uint64_t                   tileBytes        = 1024 * 1024;
+    uint32_t                   feedbackRate     = 4;
+    uint32_t                   feedbackInterval = 1;
+    FeedbackAggregator::Policy aggregation      = FeedbackAggregator::HYSTERESIS;
+    uint32_t                   simulationHz     = 120;
+    std::string                trace;
+    std::string                asset;
+    std::string                bench;
+};
+
+#pragma region ClassDecl
+
+class alignas(64) Harmony
+{
+public:
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = FrameScheduler::MAX_FRAMES;   // per-frame resources are made for the most --frames allows
+    static constexpr uint32_t SWAP_CHAIN_BUFFERS   = 3;
+    static constexpr uint32_t DEFAULT_CHUNK_SIZE   = 128 * 1024 * 1024;
+
+    // scheduler timelines
+    static constexpr uint32_t QUEUE_GRAPHICS       = 0;
+    static constexpr uint32_t QUEUE_COMPUTE        = 1;
+    static constexpr uint32_t QUEUE_COUNT          = 2;
+
+    // steps run after a stall before simulated time is let go, and the WM_TIMER id ticking the
+    // simulation during modal size/move loops
+    static constexpr uint32_t MAX_CATCHUP_STEPS    = 8;
+    static constexpr UINT_PTR SIMULATION_TIMER     = 1;
+
+    bool Init(HINSTANCE inst, const Settings& appSettings);
+    void Run();
+    void Shutdown();
+    void Resize();
+
+private:
+    inline uint32_t GetSizeInMB(UINT64 sizeInBytes) {
+        return (sizeInBytes >> 20) & 0xFFFFFFFF;
+    }
+
+    void OpenWindow(HINSTANCE instance);
+    void CreateAdapter();
+    void CreateDevice();
+    void CreateCommandQueue();
+    void CreateSwapChain();
+    void CreateHeaps();
+    void CreateResourcesAndViews();
+    void CreatePipelines();
+    void CreateCommandLists();
+    void CreateSyncObjects();
+    void CreateFrameScheduler();
+    void CreateFrameTiming();
+    void CreateUploadManager();
+    void CreateJobSystem();
+    void CreateFileReader();
+    void CreateExecutor();
+    void CreateSimulation();
+    void LoadFiles(std::initializer_list<std::pair<const char*, std::vector<char>*>> loads);
+    void DownloadDataAndGenMips();
+    Task LoadTexture();
+    void GenerateMips(UINT64 uploadValue);
+    void BakeBackingMips();
+    void StartShaderWatcher();
+    void StartStreaming();
+
+    ID3D12PipelineState* BuildGraphicsPipeline(const std::vector<char>& vs, const std::vector<char>& ps);
+    ID3D12PipelineState* BuildComputePipeline(const std::vector<char>& cs);
+
+    void ReloadShaders(const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange);
+    void ApplyReloadedPipelines();
+
+    void Simulate();
+    void RenderLoop();
+    void UpdateUbo(const FramePacket& packet);
+    void PopulateCommandList(const FramePacket& packet);
+    void WaitForFrameStart();
+    void MoveToNextFrame();
+    void CollectFrameTiming(UINT slot);
+    void ResolveFeedback();
+    void ProcessFeedback();
+    void UpdateMinMip();
+    UINT64 SubmitTileMappings(const TileMapping* pMappings, uint32_t count, bool reusesTiles);
+    void CalibrateClocks();
+
+    std::chrono::steady_clock::time_point QpcToTime(INT64 qpc);
+    std::chrono::steady_clock::time_point GpuTicksToTime(UINT64 ticks);
+    void WaitForGpu();
+    void Render();
+
+    static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam,
+        LPARAM lParam);
+
+    DeletionQueue               delQ;
+    DeferredReleaseQueue        retireQ;
+
+    IDXGIFactory7*              pFactory7         = nullptr;
+    IDXGIAdapter1*              pAdapter1         = nullptr;
+    IDXGISwapChain4*            pSwapChain4       = nullptr;
+
+    ID3D12Device9*              pDevice9          = nullptr;
+    ID3D12CommandQueue*         pCommandQueue     = nullptr;
+    ID3D12CommandQueue*         pCopyQueue        = nullptr;
+    ID3D12CommandQueue*         pComputeQueue     = nullptr;
+
+    ID3D12DescriptorHeap*       pRtvHeap          = nullptr;
+    ID3D12DescriptorHeap*       pDsvHeap          = nullptr;
+    ID3D12DescriptorHeap*       pSrvHeap          = nullptr;
+    ID3D12DescriptorHeap*       pUavHeap          = nullptr;
+    ID3D12DescriptorHeap*       pSmpHeap          = nullptr;
+
+    ID3D12Resource*             pRenderTargets[SWAP_CHAIN_BUFFERS] = { nullptr };
+    ID3D12CommandAllocator*     pCommandAllocators[MAX_FRAMES_IN_FLIGHT] = { nullptr };
+    ID3D12GraphicsCommandList1* pCommandList      = nullptr;
+    ID3D12Fence*                pFence            = nullptr;
+    ID3D12Fence*                pComputeFence     = nullptr;
+    ID3D12Heap*                 pResourceHeap     = nullptr;
+
+    ID3D12RootSignature*        pRootSignature    = nullptr;
+    ID3D12PipelineState*        pPipelineState    = nullptr;    // PsFeedback
+    ID3D12PipelineState*        pMainPipelineState = nullptr;   // PsMain, frames that don't write feedback
+
+    ID3D12RootSignature*        pCsRootSignature  = nullptr;
+    ID3D12PipelineState*        pCsPipelineState  = nullptr;
+
+    ID3D12Resource*             pConstantBuffer   = nullptr;
+    ID3D12Resource*             pDepthBuffer      = nullptr;
+    ID3D12Resource*             pTexture          = nullptr;    // reserved, streamed
+    ID3D12Resource*             pSourceTexture    = nullptr;    // mip generation target, baked out as the backing store
+    ID3D12Resource*             pBakeReadback     = nullptr;
+    ID3D12Heap*                 pTilePool         = nullptr;
+    ID3D12Resource*             pMinMipTexture    = nullptr;    // finest resident mip per region, clamps the LOD
+    ID3D12Resource*             pMinMipUpload     = nullptr;    // one slice per frame slot
+    uint8_t*                    pMinMipUploadData = nullptr;
+    ID3D12Resource*             pFeedbackTexture  = nullptr;
+    ID3D12Resource*             pFeedbackAtlas    = nullptr;    // every map of feedbackBatch decodes into its rect
+    ID3D12Resource*             pVertexBuffer     = nullptr;
+    ID3D12Resource*             pIndexBuffer      = nullptr;
+
+    HINSTANCE                   hInstance         = NULL;
+    HWND                        hMainWindow       = NULL;
+
+    UINT                        frameIndex        = 0;      // slot of the per-frame resources, from the scheduler
+    UINT                        backBufferIndex   = 0;
+    HANDLE                      fenceHandle       = NULL;
+    FrameScheduler              scheduler;
+    Settings                    settings;
+
+    HANDLE                      frameLatencyWaitable = NULL;
+    HANDLE                      pacingTimer          = NULL;
+    FramePacer                  pacer;
+
+    // end of frame GPU timestamps, one per frame slot, mapped to CPU time through the clock calibration
+    ID3D12QueryHeap*            pTimestampHeap       = nullptr;
+    ReadbackRing                timestampReadback;
+    UINT64                      gpuTimestampFrequency = 0;
+    UINT64                      calibrationGpu       = 0;
+    UINT64                      calibrationQpc       = 0;
+    INT64                       qpcFrequency         = 0;
+    FrameTimestamps             frameTimestamps[MAX_FRAMES_IN_FLIGHT];
+    FrameTimingStats            timingStats;
+
+    ReadbackRing                feedbackReadback;
+    FeedbackBatch               feedbackBatch;
+    std::vector<ID3D12Resource*> feedbackMaps;              // feedback texture of each batch entry
+    std::vector<D3D12_RESOURCE_BARRIER> resolveBarriers;
+    FeedbackProcessor           feedbackProcessor;
+    FeedbackRateController      feedbackRate;
+    FeedbackAggregator          feedbackAggregator;
+    FeedbackTrace               feedbackTrace;
+    uint64_t                    feedbackSequence     = 0;   // last feedback slice processed
+
+    // standard mips stream from backingMips (standing in for the disk) into pTilePool; the packed tail
+    // sits in the first tiles of the pool for good
+    TileStreamer                streamer;
+    D3D12_PACKED_MIP_INFO       packedMipInfo        = {};
+    D3D12_TILE_SHAPE            textureTileShape     = {};
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> bakeFootprints;
+    std::vector<std::vector<UINT>> backingMips;
+    MinMipMap                   minMipMap;
+
+    UploadManager               uploadManager;
+    JobSystem                   jobSystem;
+    AsyncFileReader             fileReader;
+    ChunkLoader                 chunkLoader;
+    CoroutineExecutor           executor;
+
+    // the main thread pumps messages and simulates, the render thread renders what it publishes
+    FrameExchange<FramePacket>  frameExchange;
+    SimulationClock             simulationClock;
+    HANDLE                      simulationTimer      = NULL;
+    std::thread                 renderThread;
+    std::atomic<bool>           renderQuit           = false;
+
+    DeletionQueue               initQ;                      // upload/mipgen/bake objects, released once the texture is acquired
+    UINT64                      mipsReadyValue       = 0;   // pComputeFence value at which the mip chain is complete
+    bool                        textureAcquired      = false;
+
+    UINT                        rtvDescriptorSize    = 0;
+    UINT                        dsvDescriptorSize    = 0;
+    UINT                        srvDescriptorSize    = 0;
+    UINT                        srvCpuDescriptorSize = 0;
+    UINT                        smpDescriptorSize    = 0;
+
+    D3D_FEATURE_LEVEL           featureLevel         = D3D_FEATURE_LEVEL_12_2;
+    D3D12_VIEWPORT              viewport;
+    D3D12_RECT                  scissorRect;
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS featureDataOpts;
+
+    ShaderWatcher               shaderWatcher;
+    ComPtr<IDxcUtils>           dxcUtils;
+    ComPtr<IDxcCompiler3>       dxcCompiler;
+    ComPtr<IDxcIncludeHandler>  dxcIncludeHandler;
+
+    // entry point -> last good bytecode (only touched by the watcher thread after Init)
+    std::map<std::wstring, std::vector<char>> shaderBytecode;
+
+    // pipelines compiled on the watcher thread, swapped in at the next frame boundary
+    std::mutex                  reloadMutex;
+    std::vector<std::pair<ID3D12PipelineState**, ID3D12PipelineState*>> reloadedPipelines;
+
+#ifdef _DEBUG
+    static inline const bool enableDebugLayers = true;
+#else
+    static inline const bool enableDebugLayers = false;
+#endif
+};
+
+#pragma endregion
+
+#pragma region Public Interface
+
+bool Harmony::Init(HINSTANCE inst, const Settings& appSettings) {
+    hInstance = inst;
+    settings  = appSettings;
+
+    try {
+        OpenWindow(hInstance);
+
+        CreateAdapter();
+
+        CreateDevice();
+
+        CreateCommandQueue();
+
+        CreateSwapChain();
+
+        CreateHeaps();
+
+        CreateResourcesAndViews();
+
+        CreateJobSystem();
+        CreateFileReader();
+        CreateExecutor();
+
+        CreatePipelines();
+
+        CreateCommandLists();
+
+        CreateSyncObjects();
+
+        CreateFrameScheduler();
+
+        CreateFrameTiming();
+
+        CreateUploadManager();
+
+        CreateSimulation();
+
+        DownloadDataAndGenMips();
+
+        StartShaderWatcher();
+    }
+    catch (std::runtime_error& err) {
+        std::cerr << err.what() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+//
+// The main thread pumps window messages and steps the simulation, the render thread renders the
+// newest packet it published; a message that takes a while only holds up the simulation. The first
+// packet goes out before the render thread starts, so it always has one.
+//
+void Harmony::Run() {
+    simulationClock.Init(settings.simulationHz, MAX_CATCHUP_STEPS, std::chrono::steady_clock::now());
+    Simulate();
+
+    renderThread = std::thread(&Harmony::RenderLoop, this);
+
+    for (;;) {
+        MSG  msg;
+        bool quit = false;
+
+        while (PeekMessage(&msg, 0, 0, 0, PM_REMOVE)) {
+            quit |= msg.message == WM_QUIT;
+
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+
+        if (quit) {
+            break;
+        }
+
+        Simulate();
+
+        // sleep until the next step is due or a message comes in
+        auto remaining = simulationClock.GetNextStep() - std::chrono::steady_clock::now();
+
+        if (remaining > std::chrono::steady_clock::duration::zero()) {
+            // relative due time in 100ns units
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(remaining).count();
+
+            SetWaitableTimer(simulationTimer, &dueTime, 0, nullptr, nullptr, FALSE);
+            MsgWaitForMultipleObjects(1, &simulationTimer, FALSE, INFINITE, QS_ALLINPUT);
+        }
+    }
+
+    renderQuit.store(true, std::memory_order_release);
+    renderThread.join();
+}
+
+void Harmony::Shutdown() {
+    shaderWatcher.Stop();
+
+    frameExchange.ReportStats(true);
+
+    // a texture still loading may be on a worker, reading what initQ releases
+    executor.ReportStats(true);
+    executor.Destroy();
+
+    WaitForGpu();
+
+    if (!textureAcquired) {
+        initQ.Finalize();
+    }
+
+    scheduler.ReportStats(true);
+    timingStats.Report(true);
+    feedbackBatch.ReportStats(true);
+    feedbackProcessor.ReportStats(true);
+
+    if (textureAcquired) {
+        feedbackAggregator.ReportStats(true);
+        streamer.ReportStats(true);
+        minMipMap.ReportStats(true);
+    }
+
+    for (auto& [slot, pso] : reloadedPipelines) {
+        pso->Release();
+    }
+    reloadedPipelines.clear();
+
+    retireQ.Finalize();
+    delQ.Finalize();
+}
+
+void Harmony::Resize() {
+    //TODO:
+}
+
+#pragma endregion
+
+#pragma region Init Calls
+
+void Harmony::OpenWindow(HINSTANCE instance) {
+    WNDCLASSEX wcex{
+       sizeof(WNDCLASSEX),
+       CS_HREDRAW | CS_VREDRAW,
+       WndProc,
+       0,
+       0,
+       instance,
+       LoadIcon(instance, IDI_APPLICATION),
+       LoadCursor(instance, IDC_ARROW),
+       (HBRUSH)GetStockObject(BLACK_BRUSH),
+       NULL,
+       APPLICATION_NAME,
+       LoadIcon(instance, IDI_APPLICATION)
+    };
+
+    if (!RegisterClassEx(&wcex)) {
+        throw std::runtime_error("Could not register class!");
+    }
+
+    int screenWidth  = GetSystemMetrics(SM_CXSCREEN);
+    int screenHeight = GetSystemMetrics(SM_CYSCREEN);
+
+    int windowX = screenWidth / 2 - WINDOW_WIDTH / 2;
+    int windowY = screenHeight / 2 - WINDOW_HEIGHT / 2;
+
+    hMainWindow = CreateWindowEx(
+        WS_EX_OVERLAPPEDWINDOW, APPLICATION_NAME, APPLICATION_NAME,
+        WS_OVERLAPPEDWINDOW | WS_CLIPCHILDREN | WS_CLIPSIBLINGS,
+        windowX, windowY, WINDOW_WIDTH, WINDOW_HEIGHT,
+        NULL,
+        NULL,
+        instance,
+        NULL);
+
+    if (!hMainWindow) {
+        throw std::runtime_error("Could not create main window!");
+    }
+
+    ShowWindow(hMainWindow, SW_SHOW);
+    UpdateWindow(hMainWindow);
+    SetForegroundWindow(hMainWindow);
+    SetFocus(hMainWindow);
+
+    SetWindowLongPtr(hMainWindow, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+
+    delQ.Append(
+        [ cHwnd = hMainWindow] {
+            DestroyWindow(cHwnd);
+        }
+    );
+}
+
+void Harmony::CreateAdapter() {
+    UINT dxgiFactoryFlags = 0;
+
+    if constexpr (enableDebugLayers) {
+        ComPtr<ID3D12Debug> debugController;
+
+        if (SUCCEEDED(D3D12GetDebugInterface(IID_PPV_ARGS(&debugController)))) {
+            debugController->EnableDebugLayer();
+
+            dxgiFactoryFlags |= DXGI_CREATE_FACTORY_DEBUG;
+        }
+    }
+
+    ComPtr<IDXGIFactory> factory;
+    if (FAILED(CreateDXGIFactory2(dxgiFactoryFlags, IID_PPV_ARGS(&factory)))) {
+        throw std::runtime_error("Could not create DXGI factory!");
+    }
+
+    ComPtr<IDXGIAdapter1> adapter1;
+    ComPtr<IDXGIFactory7> factory7;
+    if (SUCCEEDED(factory->QueryInterface(IID_PPV_ARGS(&factory7)))) {
+        UINT adapterIndex = 0;
+
+        for (; SUCCEEDED(factory7->EnumAdapterByGpuPreference(0, DXGI_GPU_PREFERENCE_HIGH_PERFORMANCE, IID_PPV_ARGS(&adapter1))); ++adapterIndex)
+        {
+            DXGI_ADAPTER_DESC1 desc;
+            adapter1->GetDesc1(&desc);
+
+            if (desc.Flags & DXGI_ADAPTER_FLAG::DXGI_ADAPTER_FLAG_SOFTWARE) {
+                continue;
+            }
+
+            if (SUCCEEDED(D3D12CreateDevice(adapter1.Get(), featureLevel, __uuidof(ID3D12Device), nullptr))) {
+                break;
+            }
+        }
+    }
+
+    if (!adapter1.Get()) {
+        throw std::runtime_error("Could not find GPU HW adapter!");
+    }
+
+    pFactory7 = factory7.Detach();
+    pAdapter1 = adapter1.Detach();
+
+    delQ.Append([cFactory = pFactory7, cAdapter = pAdapter1] {
+        cAdapter->Release();
+        cFactory->Release();
+    });
+
+    DXGI_ADAPTER_DESC1 adDesc = {};
+    pAdapter1->GetDesc1(&adDesc);
+
+    std::wcout << "Running on: " << adDesc.Description << std::endl;
+    std::wcout << "     Video  Mem: " << GetSizeInMB(adDesc.DedicatedVideoMemory)  << "MB" << std::endl;
+    std::wcout << "     System Mem: " << GetSizeInMB(adDesc.DedicatedSystemMemory) << "MB" << std::endl;
+    std::wcout << "     Shared Mem: " << GetSizeInMB(adDesc.SharedSystemMemory)    << "MB" << std::endl;
+}
+
+void Harmony::CreateDevice() {
+    ComPtr<ID3D12Device9> device;
+
+    if (FAILED(D3D12CreateDevice(pAdapter1, featureLevel, IID_PPV_ARGS(&device)))) {
+        throw std::runtime_error("Could not create ID3D12Device9 device!");
+    }
+
+    pDevice9 = device.Detach();
+
+    delQ.Append([cDevice = pDevice9] {
+        cDevice->Release();
+    });
+
+    // Query feature 
+    pDevice9->CheckFeatureSupport(D3D12_FEATURE::D3D12_FEATURE_D3D12_OPTIONS, &featureDataOpts, sizeof featureDataOpts);
+    if (featureDataOpts.ResourceHeapTier != D3D12_RESOURCE_HEAP_TIER_2) {
+        std::cout << "Resource heap Tier is not Tier 2!" << std::endl;
+    }
+
+    D3D12_FEATURE_DATA_SHADER_MODEL shaderModel = { D3D_SHADER_MODEL_6_6 };
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_SHADER_MODEL, &shaderModel, sizeof(shaderModel)))
+        || (shaderModel.HighestShaderModel < D3D_SHADER_MODEL_6_6)) {
+        throw std::runtime_error("Shader Model 6.6 is not supported!");
+    }
+
+    D3D12_FEATURE_DATA_D3D12_OPTIONS7 features = {};
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS7, &features, sizeof(features)))
+        || (features.SamplerFeedbackTier == D3D12_SAMPLER_FEEDBACK_TIER_NOT_SUPPORTED)) {
+        throw std::exception("Sampler Feedback isn't supported!");
+    }
+}
+
+void Harmony::CreateCommandQueue() {
+    ComPtr<ID3D12CommandQueue> cmdQueue;
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_DIRECT,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create graphics command queue");
+        }
+
+        pCommandQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pCommandQueue] {
+            cCommandQueue->Release();
+        });
+    }
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_COPY,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create copy command queue");
+        }
+
+        pCopyQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pCopyQueue] {
+            cCommandQueue->Release();
+        });
+    }
+
+    {
+        D3D12_COMMAND_QUEUE_DESC desc = {
+            .Type     = D3D12_COMMAND_LIST_TYPE_COMPUTE,
+            .Priority = 0,
+            .Flags    = D3D12_COMMAND_QUEUE_FLAG_NONE,
+            .NodeMask = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommandQueue(&desc, IID_PPV_ARGS(&cmdQueue)))) {
+            throw std::runtime_error("Could not create compute command queue");
+        }
+
+        pComputeQueue = cmdQueue.Detach();
+
+        delQ.Append([cCommandQueue = pComputeQueue] {
+            cCommandQueue->Release();
+        });
+    }
+}
+
+void Harmony::CreateSwapChain() {
+    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = { 0 };
+
+    swapChainDesc.BufferCount = SWAP_CHAIN_BUFFERS;
+    swapChainDesc.Width       = WINDOW_WIDTH;
+    swapChainDesc.Height      = WINDOW_HEIGHT;
+    swapChainDesc.Format      = DXGI_FORMAT_R8G8B8A8_UNORM;
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.SwapEffect  = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+
+    swapChainDesc.SampleDesc.Count   = 1;
+    swapChainDesc.SampleDesc.Quality = 0;
+
+    if (settings.presentMode == PresentMode::Tearing) {
+        BOOL allowTearing = FALSE;
+
+        if (FAILED(pFactory7->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof allowTearing)) || !allowTearing) {
+            std::cout << "Tearing not supported, presenting uncapped" << std::endl;
+            settings.presentMode = PresentMode::Uncapped;
+        }
+        else {
+            swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+        }
+    }
+
+    if (settings.maxLatency > 0) {
+        swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    }
+
+    ComPtr<IDXGISwapChain1> swapChain;
+    
+    if (FAILED(pFactory7->CreateSwapChainForHwnd(pCommandQueue, hMainWindow, &swapChainDesc, nullptr, nullptr, &swapChain))) {
+        throw std::runtime_error("Could not create swap chain!");
+    }
+
+    if (FAILED(pFactory7->MakeWindowAssociation(hMainWindow, DXGI_MWA_NO_ALT_ENTER))) {
+        throw std::runtime_error("Could not associate swap chain with hWnd!");
+    }
+
+    swapChain->QueryInterface(&pSwapChain4);
+    if (!pSwapChain4) {
+        throw std::runtime_error("Could not get SwapChain4 interface!");
+    }
+
+    backBufferIndex = pSwapChain4->GetCurrentBackBufferIndex();
+
+    delQ.Append([cSwapChain = pSwapChain4 ] {
+        cSwapChain->Release();
+    });
+
+    if (settings.maxLatency > 0) {
+        if (FAILED(pSwapChain4->SetMaximumFrameLatency(settings.maxLatency))) {
+            throw std::runtime_error("Could not set maximum frame latency!");
+        }
+
+        frameLatencyWaitable = pSwapChain4->GetFrameLatencyWaitableObject();
+
+        delQ.Append([cWaitable = frameLatencyWaitable] {
+            CloseHandle(cWaitable);
+        });
+    }
+
+    viewport    = D3D12_VIEWPORT{ .TopLeftX = 0.0f, .TopLeftY = 0.0f, .Width = WINDOW_WIDTH, .Height = WINDOW_HEIGHT, .MinDepth = D3D12_MIN_DEPTH, .MaxDepth = D3D12_MAX_DEPTH };
+    scissorRect = D3D12_RECT{ .left = 0, .top = 0, .right = WINDOW_WIDTH, .bottom = WINDOW_HEIGHT };
+}
+
+void Harmony::CreateHeaps() {
+    ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc = {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_RTV,
+            .NumDescriptors = SWAP_CHAIN_BUFFERS,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create RTV heap!");
+        }
+
+        rtvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+        pRtvHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pRtvHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_DSV,
+            .NumDescriptors = 1,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_NONE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create DSV heap!");
+        }
+
+        dsvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+        pDsvHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pDsvHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+            .NumDescriptors = 128, // sufficiently large to hold mipgen SRV and UAV chain
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        }
+
+        srvDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        pSrvHeap = descriptorHeap.Detach();
+
+        // CPU only (for UAV clear)
+        srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        if (FAILED(pDevice9->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create CBV_SRV_UAV CPU only heap!");
+        }
+
+        pUavHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pUavHeap] {
+            cHeap->Release();
+        });
+    }
+
+    {
+        D3D12_DESCRIPTOR_HEAP_DESC smpHeapDesc {
+            .Type           = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER,
+            .NumDescriptors = 8,
+            .Flags          = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE
+        };
+
+        if (FAILED(pDevice9->CreateDescriptorHeap(&smpHeapDesc, IID_PPV_ARGS(&descriptorHeap)))) {
+            throw std::runtime_error("Could not create CBV_SRV_UAV heap!");
+        }
+
+        smpDescriptorSize = pDevice9->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+        pSmpHeap = descriptorHeap.Detach();
+
+        delQ.Append([cHeap = pSmpHeap] {
+            cHeap->Release();
+        });
+    }
+
+    auto AllocateHeap = [cDevice = pDevice9](UINT64 chunkSize, D3D12_HEAP_TYPE type) -> ID3D12Heap* {
+        D3D12_HEAP_PROPERTIES hProps = cDevice->GetCustomHeapProperties(0, type);
+
+        D3D12_HEAP_DESC heapDesc {
+            .SizeInBytes = chunkSize,
+            .Properties = {.Type = type, .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN, .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN, .CreationNodeMask = hProps.CreationNodeMask , .VisibleNodeMask = hProps.VisibleNodeMask },
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Flags      = D3D12_HEAP_FLAG_NONE
+        };
+
+        ComPtr<ID3D12Heap> memHeap;
+        if (FAILED(cDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(&memHeap)))) {
+            throw std::runtime_error("Could not create default memory heap!");
+        }
+
+        return memHeap.Detach();
+    };
+
+    pResourceHeap = AllocateHeap(DEFAULT_CHUNK_SIZE, D3D12_HEAP_TYPE_DEFAULT);
+    
+    delQ.Append([cHeap = pResourceHeap] {
+        cHeap->Release();
+    });
+}
+
+void Harmony::CreateResourcesAndViews() {
+    UINT64 defaultHeapOffset = 0;
+
+    // CB
+    {
+        D3D12_RESOURCE_DESC cbDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = sizeof(UniformBuffer) * FramePacket::MAX_DRAWS * MAX_FRAMES_IN_FLIGHT,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_HEAP_PROPERTIES uploadHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &cbDesc);
+        if (resInfo.Alignment != D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT) {
+            cbDesc.Alignment = resInfo.Alignment;
+        }
+
+        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &cbDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pConstantBuffer)))) {
+            throw std::runtime_error("Could not create constant buffer!");
+        }
+
+        delQ.Append([cbuff = pConstantBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    // Feedback batch (the one streamed texture for now) and its readback, one slice per frame slot
+    // (written at the end of each feedback window)
+    {
+        feedbackBatch.Init(D3D12_REQ_TEXTURE2D_U_OR_V_DIMENSION);
+        feedbackBatch.Add(0, FEEDBACK_WIDTH, FEEDBACK_HEIGHT);
+        feedbackBatch.Pack();
+
+        feedbackReadback.Init(pDevice9, feedbackBatch.GetReadbackSize(), MAX_FRAMES_IN_FLIGHT);
+        feedbackRate.Init(settings.feedbackRate, settings.feedbackInterval);
+
+        delQ.Append([cReadback = &feedbackReadback] {
+            cReadback->Destroy();
+        });
+    }
+    
+    // DS
+    {
+        D3D12_CLEAR_VALUE dsVal {
+            .Format = DXGI_FORMAT_D32_FLOAT,
+            .Color = { 1.0f, 1.0f, 1.0f, 1.0f }
+        };
+
+        D3D12_RESOURCE_DESC depthDesc {
+            .Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width     = WINDOW_WIDTH,
+            .Height    = WINDOW_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels = 1,
+            .Format = DXGI_FORMAT_D32_FLOAT,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags  = D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &depthDesc);
+        
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &depthDesc, D3D12_RESOURCE_STATE_COMMON, &dsVal, IID_PPV_ARGS(&pDepthBuffer)))) {
+            throw std::runtime_error("Could not create depth buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pDepthBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    // Texture + SRV. then Feedback + UAV.
+    {
+        //
+        // source tex, mips are generated here and then baked out as the streaming backing store
+        //
+        D3D12_CLEAR_VALUE texVal {
+            .Format = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .Color = { 0.0f, 0.0f, 0.0f, 0.0f }
+        };
+
+        D3D12_RESOURCE_DESC texDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = TEXTURE_WIDTH,
+            .Height     = TEXTURE_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
+            .Format     = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE,
+            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &texDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &texDesc, D3D12_RESOURCE_STATE_COMMON, &texVal, IID_PPV_ARGS(&pSourceTexture)))) {
+            throw std::runtime_error("Could not create source texture!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        initQ.Append([ctex = pSourceTexture] {
+            ctex->Release();
+            });
+
+        //
+        // streamed tex, reserved. Tiles get mapped from the tile pool as feedback asks for them
+        //
+        D3D12_RESOURCE_DESC streamDesc = texDesc;
+        streamDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+        if (FAILED(pDevice9->CreateReservedResource(&streamDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pTexture)))) {
+            throw std::runtime_error("Could not create texture!");
+        }
+
+        delQ.Append([ctex = pTexture] {
+            ctex->Release();
+            });
+
+        UINT textureTiles = 0;
+        pDevice9->GetResourceTiling(pTexture, &textureTiles, &packedMipInfo, &textureTileShape, nullptr, 0, nullptr);
+
+        // the streamer works in feedback regions, one tile each
+        if (textureTileShape.WidthInTexels != TEXTURE_MMW || textureTileShape.HeightInTexels != TEXTURE_MMH) {
+            throw std::runtime_error("Texture tiles don't match the feedback mip regions!");
+        }
+
+        //
+        // tile pool: packed mip tail first, then the tiles the streamer hands out
+        //
+        D3D12_HEAP_DESC poolDesc {
+            .SizeInBytes = UINT64(packedMipInfo.NumTilesForPackedMips + settings.tilePool) * TileStreamer::TILE_SIZE,
+            .Properties = {.Type = D3D12_HEAP_TYPE_DEFAULT, .CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN, .MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN, .CreationNodeMask = 0, .VisibleNodeMask = 0 },
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Flags      = D3D12_HEAP_FLAG_DENY_BUFFERS | D3D12_HEAP_FLAG_DENY_RT_DS_TEXTURES
+        };
+
+        if (FAILED(pDevice9->CreateHeap(&poolDesc, IID_PPV_ARGS(&pTilePool)))) {
+            throw std::runtime_error("Could not create tile pool!");
+        }
+
+        delQ.Append([cHeap = pTilePool] {
+            cHeap->Release();
+            });
+
+        //
+        // feedback texture dimensions is same size as paired resource
+        // size is controlled by mip regions ( 8x8 with mips here )
+        // 
+        D3D12_RESOURCE_DESC1 feedbackDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = TEXTURE_WIDTH,
+            .Height     = TEXTURE_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels  = static_cast<UINT16>(log2(TEXTURE_HEIGHT) + 1),
+            .Format     = DXGI_FORMAT_SAMPLER_FEEDBACK_MIN_MIP_OPAQUE,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags      = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+            .SamplerFeedbackMipRegion = { .Width = TEXTURE_MMW, .Height = TEXTURE_MMH, .Depth = 1 }
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO fbInfo = pDevice9->GetResourceAllocationInfo2(0, 1, &feedbackDesc, nullptr);
+
+        if (FAILED(pDevice9->CreatePlacedResource1(pResourceHeap, defaultHeapOffset, &feedbackDesc, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, nullptr, IID_PPV_ARGS(&pFeedbackTexture)))) {
+            throw std::runtime_error("Could not create feedback texture!");
+        }
+
+        defaultHeapOffset += fbInfo.SizeInBytes;
+
+        delQ.Append([ctex = pFeedbackTexture] {
+            ctex->Release();
+            });
+
+        feedbackMaps.push_back(pFeedbackTexture);
+
+        //
+        // SRV
+        //
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
+            .Format                  = DXGI_FORMAT_R8G8B8A8_UNORM,
+            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Texture2D = {
+                .MostDetailedMip     = 0,
+                .MipLevels           = texDesc.MipLevels,
+                .PlaneSlice          = 0,
+                .ResourceMinLODClamp = 0.0f
+            }
+        };
+
+        D3D12_CPU_DESCRIPTOR_HANDLE viewCpuHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        pDevice9->CreateShaderResourceView(pTexture, &srvDesc, viewCpuHandle);
+
+        //
+        // feedback UAV
+        //
+        viewCpuHandle.ptr += srvDescriptorSize;
+        pDevice9->CreateSamplerFeedbackUnorderedAccessView(pTexture, pFeedbackTexture, viewCpuHandle);
+
+        //
+        // feedback UAV CPU only Heap handle
+        //
+        viewCpuHandle = pUavHeap->GetCPUDescriptorHandleForHeapStart();
+        pDevice9->CreateSamplerFeedbackUnorderedAccessView(pTexture, pFeedbackTexture, viewCpuHandle);
+    }
+
+    // Feedback atlas, resolved into and copied out of once per feedback window
+    {
+        D3D12_RESOURCE_DESC fbDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = feedbackBatch.GetWidth(),
+            .Height     = feedbackBatch.GetHeight(),
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_R8_UINT,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &fbDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &fbDesc, D3D12_RESOURCE_STATE_COPY_SOURCE, nullptr, IID_PPV_ARGS(&pFeedbackAtlas)))) {
+            throw std::runtime_error("Could not create feedback atlas!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([ctex = pFeedbackAtlas] {
+            ctex->Release();
+            });
+    }
+
+    // Min mip map + SRV, and its upload slices (updated on the graphics queue, see UpdateMinMip)
+    {
+        D3D12_RESOURCE_DESC mmDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_TEXTURE2D,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = FEEDBACK_WIDTH,
+            .Height     = FEEDBACK_HEIGHT,
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_R8_UINT,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_UNKNOWN,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &mmDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &mmDesc, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr, IID_PPV_ARGS(&pMinMipTexture)))) {
+            throw std::runtime_error("Could not create min mip texture!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([ctex = pMinMipTexture] {
+            ctex->Release();
+            });
+
+        D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
+            .Format                  = DXGI_FORMAT_R8_UINT,
+            .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+            .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+            .Texture2D = {
+                .MostDetailedMip     = 0,
+                .MipLevels           = 1,
+                .PlaneSlice          = 0,
+                .ResourceMinLODClamp = 0.0f
+            }
+        };
+
+        // Srv = 0, feedback UAV = 1, min mip = 2
+        D3D12_CPU_DESCRIPTOR_HANDLE viewCpuHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        viewCpuHandle.ptr += 2 * srvDescriptorSize;
+
+        pDevice9->CreateShaderResourceView(pMinMipTexture, &srvDesc, viewCpuHandle);
+
+        D3D12_RESOURCE_DESC uploadDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = FEEDBACK_ROW_PITCH * FEEDBACK_HEIGHT * MAX_FRAMES_IN_FLIGHT,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE,
+        };
+
+        D3D12_HEAP_PROPERTIES uploadHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_UPLOAD,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &uploadDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pMinMipUpload)))) {
+            throw std::runtime_error("Could not create min mip upload buffer!");
+        }
+
+        D3D12_RANGE readRange { .Begin = 0, .End = 0 };
+
+        void* pData = nullptr;
+        if (FAILED(pMinMipUpload->Map(0, &readRange, &pData)) || pData == nullptr) {
+            throw std::runtime_error("Could not map min mip upload buffer!");
+        }
+
+        pMinMipUploadData = reinterpret_cast<uint8_t*>(pData);
+
+        delQ.Append([cbuff = pMinMipUpload] {
+            cbuff->Unmap(0, nullptr);
+            cbuff->Release();
+        });
+
+        minMipMap.Init(FEEDBACK_WIDTH, FEEDBACK_HEIGHT);
+    }
+
+    // Sampler 
+    {
+        D3D12_SAMPLER_DESC smpDesc {
+            .Filter         = D3D12_FILTER_MIN_MAG_LINEAR_MIP_POINT,
+            .AddressU       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressV       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .AddressW       = D3D12_TEXTURE_ADDRESS_MODE_CLAMP,
+            .MipLODBias     = 0.0f,
+            .MaxAnisotropy  = 0,
+            .ComparisonFunc = D3D12_COMPARISON_FUNC_NEVER,
+            .BorderColor    = D3D12_STATIC_BORDER_COLOR_OPAQUE_BLACK,
+            .MinLOD         = 0.0f,
+            .MaxLOD         = D3D12_FLOAT32_MAX 
+        };
+
+        pDevice9->CreateSampler(&smpDesc, pSmpHeap->GetCPUDescriptorHandleForHeapStart());
+    }
+
+    // VB
+    {
+        D3D12_RESOURCE_DESC vbDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = sizeof(vertices),
+            .Height     = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &vbDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &vbDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pVertexBuffer)))) {
+            throw std::runtime_error("Could not create vertex buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pVertexBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    // IB
+    {
+        D3D12_RESOURCE_DESC ibDesc {
+            .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width      = sizeof(indices),
+            .Height     = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels  = 1,
+            .Format     = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc = {.Count = 1, .Quality = 0 },
+            .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags      = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_RESOURCE_ALLOCATION_INFO resInfo = pDevice9->GetResourceAllocationInfo(0, 1, &ibDesc);
+
+        if (FAILED(pDevice9->CreatePlacedResource(pResourceHeap, defaultHeapOffset, &ibDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(&pIndexBuffer)))) {
+            throw std::runtime_error("Could not create index buffer!");
+        }
+
+        defaultHeapOffset += resInfo.SizeInBytes;
+
+        delQ.Append([cbuff = pIndexBuffer] {
+            cbuff->Release();
+        });
+    }
+
+    // RTV
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = pRtvHeap->GetCPUDescriptorHandleForHeapStart();
+
+        for (UINT i = 0; i < SWAP_CHAIN_BUFFERS; ++i) {
+            if (FAILED(pSwapChain4->GetBuffer(i, IID_PPV_ARGS(&pRenderTargets[i])))) {
+                throw std::runtime_error("Could not Get swap chain buffer!");
+            }
+
+            pDevice9->CreateRenderTargetView(pRenderTargets[i], nullptr, rtvHandle);
+            rtvHandle.ptr += rtvDescriptorSize;
+        }
+    }
+
+    // DSV
+    {
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsViewDesc {
+            .Format        = DXGI_FORMAT_D32_FLOAT,
+            .ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D,
+            .Flags         = D3D12_DSV_FLAG_NONE,
+            .Texture2D     = { 0 }
+        };
+
+        D3D12_CPU_DESCRIPTOR_HANDLE dsvHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+
+        pDevice9->CreateDepthStencilView(pDepthBuffer, &dsViewDesc, dsvHandle);
+    }
+}
+
+void Harmony::CreatePipelines() {
+    D3D12_FEATURE_DATA_ROOT_SIGNATURE rootFeatures = {};
+
+    rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+
+    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &rootFeatures, sizeof rootFeatures))) {
+        rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1;
+    }
+
+    // Graphics root signature (has 5 params, the last one root constants for the pixel shader)
+    {
+        D3D12_ROOT_PARAMETER rootParams[5];
+
+        // SRV table: texture (t0) at slot 0, min mip map (t1) at slot 2, past the feedback UAV
+        D3D12_DESCRIPTOR_RANGE  descRange[5] = {
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 1, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 2 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+        };
+
+        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_CBV;
+        rootParams[0].Descriptor.ShaderRegister           = 0;
+        rootParams[0].Descriptor.RegisterSpace            = 0;
+        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+
+        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[1].DescriptorTable.NumDescriptorRanges = 2;
+        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[1];
+        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[3];
+        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[4];
+        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        // feedback rate and dither phase
+        rootParams[4].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParams[4].Constants.ShaderRegister            = 1;
+        rootParams[4].Constants.RegisterSpace             = 0;
+        rootParams[4].Constants.Num32BitValues            = 2;
+        rootParams[4].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+
+        D3D12_ROOT_SIGNATURE_DESC rDesc {
+            .NumParameters     = 5,
+            .pParameters       = rootParams,
+            .NumStaticSamplers = 0,
+            .pStaticSamplers   = nullptr,
+            .Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
+        };
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> errBlob;
+
+        // FIXME: Root signature version 1_1 not working
+        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
+            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
+        }
+
+        ComPtr<ID3D12RootSignature> rs;
+        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rs)))) {
+            throw std::runtime_error("Could not create root signature!");
+        }
+
+        pRootSignature = rs.Detach();
+        delQ.Append([cRootSignature = pRootSignature] {
+            cRootSignature->Release();
+        });
+    }
+
+    // Graphics pipeline
+    {
+        std::vector<char>           vs, ps, psMain;
+        
+        UINT compileFlags = 0;
+
+        if constexpr (enableDebugLayers) {
+            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        }
+
+        // load VS, PS and PS without feedback writes
+        LoadFiles({ { "shaders/vs.bin", &vs }, { "shaders/ps.bin", &ps }, { "shaders/psmain.bin", &psMain } });
+
+        pPipelineState     = BuildGraphicsPipeline(vs, ps);
+        pMainPipelineState = BuildGraphicsPipeline(vs, psMain);
+
+        shaderBytecode[L"VsMain"]     = std::move(vs);
+        shaderBytecode[L"PsFeedback"] = std::move(ps);
+        shaderBytecode[L"PsMain"]     = std::move(psMain);
+
+        delQ.Append([&cPipelineState = pPipelineState] {
+            cPipelineState->Release();
+            });
+
+        delQ.Append([&cPipelineState = pMainPipelineState] {
+            cPipelineState->Release();
+            });
+    }
+
+    // Compute root signature (has 3 params and 1 root constant)
+    {
+        D3D12_ROOT_PARAMETER rootParams[4];
+
+        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
+        };
+
+        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParams[0].Constants.ShaderRegister            = 0;
+        rootParams[0].Constants.RegisterSpace             = 0;
+        rootParams[0].Constants.Num32BitValues            = 2;
+        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[0];
+        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[1];
+        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
+        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[2];
+        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+
+        D3D12_ROOT_SIGNATURE_DESC rDesc {
+            .NumParameters     = 4,
+            .pParameters       = rootParams,
+            .NumStaticSamplers = 0,
+            .pStaticSamplers   = nullptr,
+            .Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE
+        };
+
+        ComPtr<ID3DBlob> signature;
+        ComPtr<ID3DBlob> errBlob;
+
+        // FIXME: Root signature version 1_1 not working
+        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
+            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
+        }
+
+        ComPtr<ID3D12RootSignature> cs;
+        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&cs)))) {
+            throw std::runtime_error("Could not create root signature!");
+        }
+
+        pCsRootSignature = cs.Detach();
+        delQ.Append([cRootSignature = pCsRootSignature] {
+            cRootSignature->Release();
+        });
+    }
+
+    // Compute pipeline
+    {
+        std::vector<char>           cs;
+
+        UINT compileFlags = 0;
+
+        if constexpr (enableDebugLayers) {
+            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+        }
+
+        //load CS
+        LoadFiles({ { "shaders/mipgen.bin", &cs } });
+
+        pCsPipelineState = BuildComputePipeline(cs);
+
+        shaderBytecode[L"GenMips"] = std::move(cs);
+
+        delQ.Append([&cPipelineState = pCsPipelineState] {
+            cPipelineState->Release();
+        });
+    }
+}
+
+ID3D12PipelineState* Harmony::BuildGraphicsPipeline(const std::vector<char>& vs, const std::vector<char>& ps) {
+    ComPtr<ID3D12PipelineState> pso;
+
+    D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        { "COLOR",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+    };
+
+    D3D12_BLEND_DESC blendDesc {
+        .AlphaToCoverageEnable  = FALSE,
+        .IndependentBlendEnable = FALSE
+    };
+
+    for (UINT i = 0; i < 8; ++i) {
+        blendDesc.RenderTarget[i] = {
+            FALSE,FALSE,
+            D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+            D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
+            D3D12_LOGIC_OP_NOOP,
+            D3D12_COLOR_WRITE_ENABLE_ALL,
+        };
+    }
+
+    D3D12_RASTERIZER_DESC rastDesc {
+        .FillMode               = D3D12_FILL_MODE_SOLID,
+        .CullMode               = D3D12_CULL_MODE_BACK,
+        .FrontCounterClockwise  = FALSE,
+        .DepthBias              = 0,
+        .DepthBiasClamp         = 0.0f,
+        .SlopeScaledDepthBias   = 0.0f,
+        .DepthClipEnable        = FALSE,
+        .MultisampleEnable      = FALSE,
+        .AntialiasedLineEnable  = FALSE,
+        .ForcedSampleCount      = 0,
+        .ConservativeRaster     = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
+    };
+
+    D3D12_DEPTH_STENCILOP_DESC defaultStencilOp {
+        .StencilFailOp      = D3D12_STENCIL_OP_KEEP,
+        .StencilDepthFailOp = D3D12_STENCIL_OP_KEEP,
+        .StencilPassOp      = D3D12_STENCIL_OP_KEEP,
+        .StencilFunc        = D3D12_COMPARISON_FUNC_ALWAYS
+    };
+
+    D3D12_DEPTH_STENCIL_DESC dsDesc {
+        .DepthEnable      = TRUE,
+        .DepthWriteMask   = D3D12_DEPTH_WRITE_MASK_ALL,
+        .DepthFunc        = D3D12_COMPARISON_FUNC_LESS_EQUAL,
+        .StencilEnable    = FALSE,
+        .StencilReadMask  = 0,
+        .StencilWriteMask = 0,
+        .FrontFace        = defaultStencilOp,
+        .BackFace         = defaultStencilOp
+    };
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc {
+        .pRootSignature        = pRootSignature,
+        .VS                    = { .pShaderBytecode = vs.data(), .BytecodeLength = vs.size() },
+        .PS                    = { .pShaderBytecode = ps.data(), .BytecodeLength = ps.size() },
+        .BlendState            = blendDesc,
+        .SampleMask            = D3D12_DEFAULT_SAMPLE_MASK,
+        .RasterizerState       = rastDesc,
+        .DepthStencilState     = dsDesc,
+        .InputLayout           = { .pInputElementDescs = inputElementDesc, .NumElements = 3 },
+        .IBStripCutValue       = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED,
+        .PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
+        .NumRenderTargets      = 1,
+        .RTVFormats            = { DXGI_FORMAT_R8G8B8A8_UNORM },
+        .DSVFormat             = DXGI_FORMAT_D32_FLOAT,
+        .SampleDesc            = { .Count = 1, .Quality = 0 },
+        .NodeMask              = 0,
+        .CachedPSO             = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
+        .Flags                 = D3D12_PIPELINE_STATE_FLAG_NONE
+    };
+
+    if(FAILED(pDevice9->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
+        throw std::runtime_error("Could not create pipeline state object!");
+    }
+
+    return pso.Detach();
+}
+
+ID3D12PipelineState* Harmony::BuildComputePipeline(const std::vector<char>& cs) {
+    ComPtr<ID3D12PipelineState> pso;
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc {
+        .pRootSignature = pCsRootSignature,
+        .CS             = { .pShaderBytecode = cs.data(), .BytecodeLength = cs.size() },
+        .NodeMask       = 0,
+        .CachedPSO      = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
+        .Flags          = D3D12_PIPELINE_STATE_FLAG_NONE
+    };
+
+    if(FAILED(pDevice9->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
+        throw std::runtime_error("Could not create compute pipeline state object!");
+    }
+
+    return pso.Detach();
+}
+
+void Harmony::CreateCommandLists() {
+    for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+        if (FAILED(pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&pCommandAllocators[i])))) {
+            throw std::runtime_error("Could not allocate command allocator!");
+        }
+    }
+
+    ComPtr<ID3D12GraphicsCommandList> cmdList;
+    if (FAILED(pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocators[0], nullptr, IID_PPV_ARGS(&cmdList)))) {
+        throw std::runtime_error("Could not create command list!");
+    }
+
+    if (FAILED(cmdList->QueryInterface<ID3D12GraphicsCommandList1>(&pCommandList))) {
+        throw std::runtime_error("Could not query cmdlist1 interface!");
+    }
+
+    pCommandList->Close();
+
+    delQ.Append([cCommandList = pCommandList, cCommandAllocators = pCommandAllocators] {
+        cCommandList->Release();
+
+        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            cCommandAllocators[i]->Release();
+        }
+    });
+}
+
+void Harmony::CreateSyncObjects() {
+    ComPtr<ID3D12Fence> fence;
+
+    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+        throw std::runtime_error("Could not create fence!");
+    }
+
+    fenceHandle = CreateEventA(nullptr, FALSE, FALSE, "gpuFence");
+    if (!fenceHandle) {
+        throw std::runtime_error("Could not create fence event!");
+    }
+
+    pFence = fence.Detach();
+
+    delQ.Append([cEvent = fenceHandle, cFence = pFence] {
+        cFence->Release();
+        CloseHandle(cEvent);
+    });
+
+    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
+        throw std::runtime_error("Could not create compute fence!");
+    }
+
+    pComputeFence = fence.Detach();
+
+    delQ.Append([cFence = pComputeFence] {
+        cFence->Release();
+    });
+}
+
+void Harmony::CreateFrameScheduler() {
+    auto queueFence = [this](uint32_t queue) {
+        return queue == QUEUE_COMPUTE ? pComputeFence : pFence;
+    };
+
+    auto queue = [this](uint32_t queue) {
+        return queue == QUEUE_COMPUTE ? pComputeQueue : pCommandQueue;
+    };
+
+    // clamps --frames to [1, MAX_FRAMES_IN_FLIGHT]
+    scheduler.Init(QUEUE_COUNT, settings.framesInFlight, {
+        .completedValue = [queueFence](uint32_t q) {
+            return queueFence(q)->GetCompletedValue();
+        },
+        .signal = [queueFence, queue](uint32_t q, uint64_t value) {
+            queue(q)->Signal(queueFence(q), value);
+        },
+        .wait = [this, queueFence](const FrameScheduler::TimelinePoint* points, uint32_t count, bool waitAll) {
+            ID3D12Fence* fences[FrameScheduler::MAX_QUEUES];
+            UINT64       values[FrameScheduler::MAX_QUEUES];
+
+            for (uint32_t i = 0; i < count; ++i) {
+                fences[i] = queueFence(points[i].queue);
+                values[i] = points[i].value;
+            }
+
+            D3D12_MULTIPLE_FENCE_WAIT_FLAGS flags = waitAll ? D3D12_MULTIPLE_FENCE_WAIT_FLAG_ALL : D3D12_MULTIPLE_FENCE_WAIT_FLAG_ANY;
+
+            if (FAILED(pDevice9->SetEventOnMultipleFenceCompletion(fences, values, count, flags, fenceHandle))) {
+                throw std::runtime_error("Could not wait on fences!");
+            }
+
+            WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
+        }
+    });
+
+    frameIndex = scheduler.GetFrameSlot();
+
+    std::cout << "Frames in flight: " << scheduler.GetFramesInFlight() << std::endl;
+}
+
+void Harmony::CreateFrameTiming() {
+    D3D12_QUERY_HEAP_DESC queryHeapDesc {
+        .Type     = D3D12_QUERY_HEAP_TYPE_TIMESTAMP,
+        .Count    = MAX_FRAMES_IN_FLIGHT,
+        .NodeMask = 0
+    };
+
+    if (FAILED(pDevice9->CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&pTimestampHeap)))) {
+        throw std::runtime_error("Could not create timestamp query heap!");
+    }
+
+    delQ.Append([cHeap = pTimestampHeap] {
+        cHeap->Release();
+    });
+
+    timestampReadback.Init(pDevice9, sizeof(UINT64), MAX_FRAMES_IN_FLIGHT);
+
+    delQ.Append([cReadback = &timestampReadback] {
+        cReadback->Destroy();
+    });
+
+    if (FAILED(pCommandQueue->GetTimestampFrequency(&gpuTimestampFrequency))) {
+        throw std::runtime_error("Could not query timestamp frequency!");
+    }
+
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    qpcFrequency = frequency.QuadPart;
+
+    CalibrateClocks();
+
+    //
+    // Pacing sleeps need better than the default timer resolution
+    //
+    pacer.Init(settings.pacing, std::chrono::milliseconds(1));
+
+    pacingTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!pacingTimer) {
+        pacingTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+
+    if (!pacingTimer) {
+        throw std::runtime_error("Could not create pacing timer!");
+    }
+
+    delQ.Append([cTimer = pacingTimer] {
+        CloseHandle(cTimer);
+    });
+}
+
+void Harmony::CreateUploadManager() {
+    uploadManager.Init(pDevice9, pCopyQueue);
+
+    delQ.Append([cUploadManager = &uploadManager] {
+        cUploadManager->Destroy();
+    });
+}
+
+//
+// One worker per core but the one this thread runs on.
+//
+void Harmony::CreateJobSystem() {
+    jobSystem.Init((std::max)(std::thread::hardware_concurrency(), 2u) - 1);
+
+    delQ.Append([cJobs = &jobSystem] {
+        cJobs->ReportStats(true);
+        cJobs->Destroy();
+    });
+}
+
+void Harmony::CreateFileReader() {
+    fileReader.Init(AsyncFileReader::Backend::Native, 32);
+
+    delQ.Append([cReader = &fileReader] {
+        cReader->Destroy();
+    });
+
+    chunkLoader.Init(&fileReader, &jobSystem);
+
+    delQ.Append([cLoader = &chunkLoader] {
+        cLoader->ReportStats(true);
+        cLoader->Destroy();
+    });
+}
+
+void Harmony::CreateExecutor() {
+    executor.Init(&fileReader);
+
+    delQ.Append([cExecutor = &executor] {
+        cExecutor->Destroy();
+    });
+}
+
+//
+// The hand-off between the simulation and the render thread, and the timer the main thread sleeps
+// on between simulation steps (high resolution where the system has it).
+//
+void Harmony::CreateSimulation() {
+    frameExchange.Init();
+
+    simulationTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!simulationTimer) {
+        simulationTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+
+    if (!simulationTimer) {
+        throw std::runtime_error("Could not create simulation timer!");
+    }
+
+    delQ.Append([cTimer = simulationTimer] {
+        CloseHandle(cTimer);
+    });
+}
+
+//
+// Reads whole files into the vectors, all in one batch, and blocks until they are in.
+//
+void Harmony::LoadFiles(std::initializer_list<std::pair<const char*, std::vector<char>*>> loads) {
+    std::vector<uint32_t> opened;
+    std::string           failed;
+
+    for (const auto& load : loads) {
+        const char*        name  = load.first;
+        std::vector<char>* pData = load.second;
+
+        uint32_t file = fileReader.Open(std::wstring(name, name + strlen(name)), false);
+
+        if (file == AsyncFileReader::INVALID_FILE) {
+            failed = name;
+            break;
+        }
+
+        opened.push_back(file);
+        pData->resize(size_t(fileReader.GetFileSize(file)));
+
+        fileReader.Read(file, 0, pData->size(), pData->data(), [&failed, name](bool ok, const uint8_t*, UINT64) {
+            if (!ok && failed.empty()) {
+                failed = name;
+            }
+        });
+    }
+
+    fileReader.WaitIdle();
+
+    for (uint32_t file : opened) {
+        fileReader.Close(file);
+    }
+
+    if (!failed.empty()) {
+        throw std::runtime_error("Could not load " + failed + "!");
+    }
+}
+
+void Harmony::DownloadDataAndGenMips() {
+    //
+    // The mesh goes through the copy queue right away, the texture loads in the background
+    //
+    bool queued = uploadManager.UploadBuffer(pVertexBuffer, 0, vertices, sizeof vertices)
+               && uploadManager.UploadBuffer(pIndexBuffer, 0, indices, sizeof indices);
+
+    if (!queued) {
+        throw std::runtime_error("Could not stage initial uploads!");
+    }
+
+    uploadManager.Submit();
+
+    executor.Spawn(LoadTexture());
+}
+
+//
+// decode -> upload -> mipgen -> ready, with the render loop running throughout. Mip 0 comes from the
+// chunked asset when there is one, its chunks read on the executor and decompressed on workers
+// straight into the staging ring; otherwise it is generated on a worker and cooked into the asset
+// for next time. The mip chain is awaited on the
+// compute fence, the bake copied out on a worker, and streaming starts back on the frame thread.
+//
+Task Harmony::LoadTexture() {
+    std::wstring assetPath(settings.asset.begin(), settings.asset.end());
+    ChunkedAsset asset;
+
+    if (!settings.asset.empty() && asset.Open(assetPath)) {
+        UINT     rowPitch = 0;
+        UINT     numRows  = 0;
+        UINT64   rowSize  = 0;
+        uint8_t* pStaged  = uploadManager.MapTexture(pSourceTexture, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, rowPitch, numRows, rowSize);
+
+        // chunks land at their raw offsets, so the staged rows have to be tightly packed
+        if (!pStaged || rowPitch != rowSize || asset.GetHeader().rawSize != UINT64(rowSize) * numRows) {
+            throw std::runtime_error("Could not stage " + settings.asset + "!");
+        }
+
+        uint32_t file = fileReader.Open(assetPath, true);
+
+        std::vector<ChunkLoader::Target> targets;
+
+        for (uint32_t i = 0; i < asset.GetChunks().size(); ++i) {
+            targets.push_back({ i, pStaged + asset.GetChunks()[i].rawOffset });
+        }
+
+        bool loaded = false;
+
+        if (file != AsyncFileReader::INVALID_FILE) {
+            co_await chunkLoader.LoadAsync(executor, asset, file, targets, loaded);
+
+            fileReader.Close(file);
+        }
+
+        if (!loaded) {
+            throw std::runtime_error("Could not load " + settings.asset + "!");
+        }
+    }
+    else {
+        std::vector<UINT> texels(TEXTURE_WIDTH * TEXTURE_HEIGHT);
+
+        co_await jobSystem.Schedule();
+
+        {
+            for (UINT i = 0; i < TEXTURE_HEIGHT; ++i) {
+                UINT* pRow = texels.data() + (i * TEXTURE_WIDTH);
+
+                for (UINT j = 0; j < TEXTURE_HEIGHT; ++j) {
+                    if (((j / 96) % 2) == 0)
+                    {
+                        pRow[j] = (((i / 96) % 2) == 0) ? 0x0F0F0FFF : 0x0;
+                    }
+                    else
+                    {
+                        pRow[j] = (((i / 96) % 2) == 0) ? 0x0 : 0x0F0F0FFF;
+                    }
+                }
+            }
+        }
+
+        if (!settings.asset.empty()
+            && !ChunkedAsset::Write(assetPath, reinterpret_cast<const uint8_t*>(texels.data()), texels.size() * sizeof(UINT), 64 * 1024, COMPRESS_ALGORITHM_XPRESS_HUFF)) {
+            std::cerr << "Could not cook " << settings.asset << std::endl;
+        }
+
+        co_await executor.Yield();
+
+        if (!uploadManager.UploadTexture(pSourceTexture, 0, 0, 0, TEXTURE_WIDTH, TEXTURE_HEIGHT, texels.data(), TEXTURE_WIDTH * sizeof(UINT))) {
+            throw std::runtime_error("Could not stage mip 0!");
+        }
+    }
+
+    UINT64 uploadValue = uploadManager.Submit();
+
+    GenerateMips(uploadValue);
+
+    co_await executor.Fence(pComputeFence, mipsReadyValue);
+    co_await jobSystem.Schedule();
+
+    BakeBackingMips();
+
+    co_await executor.Yield();
+
+    initQ.Finalize();
+
+    StartStreaming();
+
+    textureAcquired = true;
+}
+
+//
+// Generate texture mip maps on the compute queue. It only waits on the upload of mip 0.
+//
+// Everything leaves the copy queue in COMMON. The buffers are promoted implicitly by the graphics
+// queue, which is ordered after the copy through the upload fence it waits on.
+//
+void Harmony::GenerateMips(UINT64 uploadValue) {
+    ComPtr<ID3D12GraphicsCommandList>   mipsCmdlist;
+    ComPtr<ID3D12CommandAllocator>      mipsCmdAllocator;
+
+    HRESULT hr;
+
+    hr = pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COMPUTE, IID_PPV_ARGS (&mipsCmdAllocator));
+    if (FAILED(hr)) {
+        throw std::runtime_error("Could not create compute command allocator!");
+    }
+
+    hr = pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COMPUTE, mipsCmdAllocator.Get (), nullptr, IID_PPV_ARGS (&mipsCmdlist));
+    if (FAILED(hr)) {
+        throw std::runtime_error("Could not create compute command list!");
+    }
+
+    pComputeQueue->Wait(uploadManager.GetFence(), uploadValue);
+
+    D3D12_RESOURCE_BARRIER barrierTex {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pSourceTexture,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
+            .StateAfter  = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,   // to Gen Mips
+        }
+    };
+
+    mipsCmdlist->ResourceBarrier(1, &barrierTex);
+
+    D3D12_RESOURCE_DESC tdesc = pSourceTexture->GetDesc();
+
+    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
+        .Format                  = tdesc.Format,
+        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
+        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
+        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
+    };
+    
+    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc {
+        .Format                  = tdesc.Format,
+        .ViewDimension           = D3D12_UAV_DIMENSION_TEXTURE2D,
+        .Texture2D               = { .MipSlice = 0, .PlaneSlice = 0 }
+    };
+    
+    mipsCmdlist->SetComputeRootSignature(pCsRootSignature);
+    mipsCmdlist->SetPipelineState(pCsPipelineState);
+    
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+
+    mipsCmdlist->SetDescriptorHeaps(2, pDescHeaps);
+
+    {
+        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+
+        D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+        
+        //
+        // Srv = 0, feedback UAV = 1, min mip = 2, use rest
+        //
+        UINT mipgenSrvHeapOffset = 3;
+
+        D3D12_RESOURCE_BARRIER uavBarrier {
+            .Type  = D3D12_RESOURCE_BARRIER_TYPE_UAV,
+            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+            .UAV   = pSourceTexture
+        };
+
+        union FloatAsInt {
+            UINT  u;
+            FLOAT f;
+
+            explicit FloatAsInt(float val)
+                : f(val)
+            {}
+        };
+
+        // set sampler state in root once
+        mipsCmdlist->SetComputeRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+
+        for (UINT16 i = 0; i < (tdesc.MipLevels - 1); ++i) {
+            UINT dstWidth  = TEXTURE_WIDTH  >> (i + 1);
+            UINT dstHeight = TEXTURE_HEIGHT >> (i + 1);
+
+            SIZE_T bytesToSrv = (mipgenSrvHeapOffset + i) * srvDescriptorSize;
+
+            srvHandle.ptr += bytesToSrv;
+            srvGpuHandle.ptr += bytesToSrv;
+
+            SIZE_T bytesToUav = (mipgenSrvHeapOffset + i + 1) * srvDescriptorSize;
+
+            uavHandle.ptr += bytesToUav;
+            uavGpuHandle.ptr += bytesToUav;
+
+            srvDesc.Texture2D.MostDetailedMip = i;
+            pDevice9->CreateShaderResourceView(pSourceTexture, &srvDesc, srvHandle);
+
+            uavDesc.Texture2D.MipSlice = i + 1;
+            pDevice9->CreateUnorderedAccessView(pSourceTexture, nullptr, &uavDesc, uavHandle);
+
+            UINT rootConstData[2] = { FloatAsInt(1.0f / dstWidth).u, FloatAsInt(1.0f / dstHeight).u };
+
+            mipsCmdlist->SetComputeRoot32BitConstants(0, 2, rootConstData, 0);
+            mipsCmdlist->SetComputeRootDescriptorTable(1, srvGpuHandle);
+            mipsCmdlist->SetComputeRootDescriptorTable(2, uavGpuHandle);
+            
+            UINT dispatchX = max(dstWidth  / 8, 1u);
+            UINT dispatchY = max(dstHeight / 8, 1u);
+
+            mipsCmdlist->Dispatch(dispatchX, dispatchY, 1);
+
+            mipsCmdlist->ResourceBarrier(1, &uavBarrier);
+        }
+
+        //
+        // bake the chain out to the CPU, the streamer's backing store (BakeBackingMips)
+        //
+        barrierTex.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+        barrierTex.Transition.StateAfter  = D3D12_RESOURCE_STATE_COPY_SOURCE;
+
+        mipsCmdlist->ResourceBarrier(1, &barrierTex);
+
+        UINT64 bakeSize = 0;
+
+        bakeFootprints.resize(tdesc.MipLevels);
+        pDevice9->GetCopyableFootprints(&tdesc, 0, tdesc.MipLevels, 0, bakeFootprints.data(), nullptr, nullptr, &bakeSize);
+
+        D3D12_RESOURCE_DESC bakeDesc {
+            .Dimension        = D3D12_RESOURCE_DIMENSION_BUFFER,
+            .Alignment        = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+            .Width            = bakeSize,
+            .Height           = 1,
+            .DepthOrArraySize = 1,
+            .MipLevels        = 1,
+            .Format           = DXGI_FORMAT_UNKNOWN,
+            .SampleDesc       = { .Count = 1, .Quality = 0 },
+            .Layout           = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
+            .Flags            = D3D12_RESOURCE_FLAG_NONE
+        };
+
+        D3D12_HEAP_PROPERTIES readbackHeapProps {
+            .Type                   = D3D12_HEAP_TYPE_READBACK,
+            .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
+            .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
+            .CreationNodeMask       = 0,
+            .VisibleNodeMask        = 0
+        };
+
+        if (FAILED(pDevice9->CreateCommittedResource(&readbackHeapProps, D3D12_HEAP_FLAG_NONE, &bakeDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pBakeReadback)))) {
+            throw std::runtime_error("Could not create bake readback buffer!");
+        }
+
+        initQ.Append([cBuffer = pBakeReadback] {
+            cBuffer->Release();
+        });
+
+        for (UINT mip = 0; mip < tdesc.MipLevels; ++mip) {
+            D3D12_TEXTURE_COPY_LOCATION dst {
+                .pResource       = pBakeReadback,
+                .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+                .PlacedFootprint = bakeFootprints[mip]
+            };
+
+            D3D12_TEXTURE_COPY_LOCATION src {
+                .pResource        = pSourceTexture,
+                .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+                .SubresourceIndex = mip
+            };
+
+            mipsCmdlist->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+        }
+    }
+    
+    mipsCmdlist->Close();
+
+    ID3D12CommandList* mipsLists[] = { mipsCmdlist.Get() };
+    pComputeQueue->ExecuteCommandLists(1, mipsLists);
+
+    // not frame scoped, frames keep going while the chain is generated
+    mipsReadyValue = scheduler.Signal(QUEUE_COMPUTE, false);
+
+    initQ.Append([cMipsCmdList = mipsCmdlist.Detach(), cMipsAllocator = mipsCmdAllocator.Detach()] {
+        cMipsAllocator->Release();
+        cMipsCmdList->Release();
+    });
+}
+
+#pragma endregion
+
+#pragma region Shader Hot Reload
+
+void Harmony::StartShaderWatcher() {
+    //
+    // dxcompiler.dll is loaded on demand so the app still runs (without hot reload) when it is missing.
+    // Place dxil.dll next to it, otherwise the produced DXIL is unsigned and PSO creation will fail.
+    //
+    HMODULE dxcModule = LoadLibraryW(L"dxcompiler.dll");
+    if (!dxcModule) {
+        std::cout << "dxcompiler.dll not found, shader hot reload disabled" << std::endl;
+        return;
+    }
+
+    auto pfnDxcCreateInstance = reinterpret_cast<DxcCreateInstanceProc>(GetProcAddress(dxcModule, "DxcCreateInstance"));
+
+    if (!pfnDxcCreateInstance
+        || FAILED(pfnDxcCreateInstance(CLSID_DxcUtils, IID_PPV_ARGS(&dxcUtils)))
+        || FAILED(pfnDxcCreateInstance(CLSID_DxcCompiler, IID_PPV_ARGS(&dxcCompiler)))
+        || FAILED(dxcUtils->CreateDefaultIncludeHandler(&dxcIncludeHandler))) {
+        std::cout << "Could not create DXC instance, shader hot reload disabled" << std::endl;
+        return;
+    }
+
+    delQ.Append([cModule = dxcModule] {
+        FreeLibrary(cModule);
+    });
+
+    const std::wstring shaderDir = L"" SHADER_SOURCE_DIR;
+
+    // reported when the watcher loses track of the changes
+    std::vector<std::wstring> files;
+
+    for (const ShaderSource& source : shaderSources) {
+        if (std::find(files.begin(), files.end(), source.file) == files.end()) {
+            files.push_back(source.file);
+        }
+    }
+
+    bool watching = shaderWatcher.Start(shaderDir, std::move(files),
+        [this](const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange) {
+            ReloadShaders(files, firstChange);
+        });
+
+    if (watching) {
+        std::wcout << "Watching " << shaderDir << " for shader changes" << std::endl;
+    }
+}
+
+//
+// Runs on the watcher thread: recompiles only the entry points that live in the changed files and
+// builds the affected PSOs. Nothing the render loop touches is modified here; the new pipelines are
+// handed over through reloadedPipelines.
+//
+void Harmony::ReloadShaders(const std::vector<std::wstring>& files, std::chrono::steady_clock::time_point firstChange) {
+    const std::wstring shaderDir = L"" SHADER_SOURCE_DIR;
+
+    for (const std::wstring& file : files) {
+        bool graphicsDirty = false;
+        bool computeDirty  = false;
+        bool failed        = false;
+        UINT entryCount    = 0;
+
+        for (const ShaderSource& source : shaderSources) {
+            if (_wcsicmp(source.file, file.c_str()) != 0) {
+                continue;
+            }
+
+            std::wstring path = shaderDir + L"/" + file;
+
+            ComPtr<IDxcBlobEncoding> sourceBlob;
+            if (FAILED(dxcUtils->LoadFile(path.c_str(), nullptr, &sourceBlob))) {
+                // editors may still hold the file, the next write notification retries
+                failed = true;
+                break;
+            }
+
+            DxcBuffer sourceBuffer {
+                .Ptr      = sourceBlob->GetBufferPointer(),
+                .Size     = sourceBlob->GetBufferSize(),
+                .Encoding = DXC_CP_ACP
+            };
+
+            std::vector<LPCWSTR> args = { path.c_str(), L"-E", source.entry, L"-T", source.target };
+
+            if constexpr (enableDebugLayers) {
+                args.push_back(DXC_ARG_DEBUG);
+                args.push_back(DXC_ARG_SKIP_OPTIMIZATIONS);
+            }
+
+            ComPtr<IDxcResult> result;
+            HRESULT            status = E_FAIL;
+
+            if (SUCCEEDED(dxcCompiler->Compile(&sourceBuffer, args.data(), static_cast<UINT32>(args.size()), dxcIncludeHandler.Get(), IID_PPV_ARGS(&result)))) {
+                result->GetStatus(&status);
+            }
+
+            if (FAILED(status)) {
+                ComPtr<IDxcBlobUtf8> errors;
+
+                if (result && SUCCEEDED(result->GetOutput(DXC_OUT_ERRORS, IID_PPV_ARGS(&errors), nullptr)) && errors && errors->GetStringLength()) {
+                    std::cerr << errors->GetStringPointer() << std::endl;
+                }
+
+                failed = true;
+                break;
+            }
+
+            ComPtr<IDxcBlob> object;
+            result->GetOutput(DXC_OUT_OBJECT, IID_PPV_ARGS(&object), nullptr);
+
+            const char* bytes = reinterpret_cast<const char*>(object->GetBufferPointer());
+            shaderBytecode[source.entry].assign(bytes, bytes + object->GetBufferSize());
+
+            if (wcsncmp(source.target, L"cs_", 3) == 0) {
+                computeDirty = true;
+            }
+            else {
+                graphicsDirty = true;
+            }
+
+            ++entryCount;
+        }
+
+        if (failed) {
+            std::wcerr << "Hot reload: " << file << " failed, keeping previous pipelines" << std::endl;
+            continue;
+        }
+
+        if (entryCount == 0) {
+            continue;
+        }
+
+        std::vector<std::pair<ID3D12PipelineState**, ID3D12PipelineState*>> built;
+
+        try {
+            if (graphicsDirty) {
+                built.emplace_back(&pPipelineState, BuildGraphicsPipeline(shaderBytecode[L"VsMain"], shaderBytecode[L"PsFeedback"]));
+                built.emplace_back(&pMainPipelineState, BuildGraphicsPipeline(shaderBytecode[L"VsMain"], shaderBytecode[L"PsMain"]));
+            }
+
+            if (computeDirty) {
+                built.emplace_back(&pCsPipelineState, BuildComputePipeline(shaderBytecode[L"GenMips"]));
+            }
+
+            std::lock_guard<std::mutex> lock(reloadMutex);
+            reloadedPipelines.insert(reloadedPipelines.end(), built.begin(), built.end());
+        }
+        catch (std::runtime_error& err) {
+            std::cerr << err.what() << std::endl;
+
+            for (auto& [slot, pso] : built) {
+                pso->Release();
+            }
+            continue;
+        }
+
+        float latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - firstChange).count();
+
+        std::wcout << "Hot reload: " << file << " (" << entryCount << " entry points) in " << latencyMs << " ms" << std::endl;
+    }
+}
+
+//
+// Called at the frame boundary: swaps in the pipelines built by the watcher thread and retires the
+// old ones once the frame being recorded now (and hence every earlier frame) has completed on the GPU.
+//
+void Harmony::ApplyReloadedPipelines() {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+
+    for (auto& [slot, pso] : reloadedPipelines) {
+        retireQ.Append(scheduler.GetNextValue(QUEUE_GRAPHICS), [cPipelineState = *slot] {
+            cPipelineState->Release();
+        });
+
+        *slot = pso;
+    }
+
+    reloadedPipelines.clear();
+}
+
+#pragma endregion
+
+#pragma region Misc
+
+LRESULT Harmony::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    Harmony* pApp = reinterpret_cast<Harmony*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+
+    switch (msg) {
+    case WM_CLOSE:
+    case WM_DESTROY:
+        PostQuitMessage(0);         // close the application entirely
+        return 0;
+
+    case WM_SIZE:
+        if (pApp) {
+            pApp->Resize();
+        }
+        return 0;
+
+    // dragging or sizing runs a modal loop inside DefWindowProc, a timer keeps the simulation going
+    case WM_ENTERSIZEMOVE:
+        SetTimer(hWnd, SIMULATION_TIMER, USER_TIMER_MINIMUM, nullptr);
+        return 0;
+
+    case WM_EXITSIZEMOVE:
+        KillTimer(hWnd, SIMULATION_TIMER);
+        return 0;
+
+    case WM_TIMER:
+        if (pApp && wParam == SIMULATION_TIMER) {
+            pApp->Simulate();
+        }
+        return 0;
+    }
+
+    return DefWindowProc(hWnd, msg, wParam, lParam);
+}
+
+#pragma endregion
+
+#pragma region Rendering
+
+//
+// Main thread: runs the simulation steps that fell due and publishes the result. The pyramid's
+// motion is a function of simulated time, so the state is just the clock.
+//
+void Harmony::Simulate() {
+    if (simulationClock.Advance(std::chrono::steady_clock::now()) == 0) {
+        return;
+    }
+
+    // the render thread holds every packet, the next step publishes
+    FramePacket* pPacket = frameExchange.Begin();
+    if (!pPacket) {
+        return;
+    }
+
+    float time = float(simulationClock.GetTime());
+
+    const XMVECTOR Eye = XMVectorSet( 0.0f,  0.75f, -1.5f, 0.0f );
+    const XMVECTOR At  = XMVectorSet( 0.0f,  0.0f,  0.0f, 0.0f );
+    const XMVECTOR Up  = XMVectorSet( 0.0f,  1.0f,  0.0f, 0.0f );
+
+    float yDisplacement = (sin(time * 5) * 0.25f) - 0.25f;
+
+    XMMATRIX  world      = XMMatrixRotationY(time * XMConvertToRadians(90.0f));
+    world *= XMMatrixTranslation(0.0f, yDisplacement, 0.0f);
+
+    float scaleValue     = (sin(time) * 0.5f) + 0.5f;
+    world *= XMMatrixScaling(scaleValue, scaleValue, scaleValue);
+
+    XMMATRIX  view       = XMMatrixLookAtLH( Eye, At, Up );
+    XMMATRIX  projection = XMMatrixPerspectiveFovLH(70, WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 20.0f);
+
+    pPacket->step      = simulationClock.GetStep();
+    pPacket->time      = simulationClock.GetTime();
+    pPacket->drawCount = 1;
+
+    XMStoreFloat4x4(&pPacket->viewProj, view * projection);
+    XMStoreFloat4x4(&pPacket->draws[0].world, world);
+
+    pPacket->draws[0].indexCount = uint32_t(std::size(indices));
+    pPacket->draws[0].firstIndex = 0;
+
+    frameExchange.Publish();
+}
+
+//
+// Render thread. A failed frame closes the window, Run() then stops the thread like on any quit.
+//
+void Harmony::RenderLoop() {
+    try {
+        while (!renderQuit.load(std::memory_order_acquire)) {
+            Render();
+        }
+    }
+    catch (std::exception& err) {
+        std::cerr << err.what() << std::endl;
+        PostMessage(hMainWindow, WM_CLOSE, 0, 0);
+    }
+}
+
+void Harmony::Render() {
+    WaitForFrameStart();
+
+    FrameTimestamps& timestamps = frameTimestamps[frameIndex];
+    timestamps.cpuStart = std::chrono::steady_clock::now();
+
+    // latched after the wait, like everything else the frame shows
+    const FramePacket& packet = *frameExchange.Acquire();
+
+    retireQ.Collect(pFence->GetCompletedValue());
+    ApplyReloadedPipelines();
+
+    uploadManager.Poll();
+
+    backBufferIndex = pSwapChain4->GetCurrentBackBufferIndex();
+
+    executor.Poll();
+
+    UpdateUbo(packet);
+    PopulateCommandList(packet);
+
+    ID3D12CommandList* ppCmdLists[] = { pCommandList };
+    pCommandQueue->ExecuteCommandLists(1, ppCmdLists);
+
+    timestamps.submit = std::chrono::steady_clock::now();
+
+    UINT syncInterval = settings.presentMode == PresentMode::Vsync ? 1 : 0;
+    UINT presentFlags = settings.presentMode == PresentMode::Tearing ? DXGI_PRESENT_ALLOW_TEARING : 0;
+
+    pSwapChain4->Present(syncInterval, presentFlags);
+
+    timestamps.present = std::chrono::steady_clock::now();
+    timestamps.valid   = true;
+
+    MoveToNextFrame();
+}
+
+void Harmony::UpdateUbo(const FramePacket& packet) {
+    XMMATRIX viewProj = XMLoadFloat4x4(&packet.viewProj);
+
+    void* pData = nullptr;
+    if (FAILED(pConstantBuffer->Map(0, nullptr, &pData)) || pData == nullptr) {
+        throw std::runtime_error("Could not map CB!");
+    }
+
+    // one constant buffer per draw, MAX_DRAWS per frame slot
+    uint8_t* pBytePtr = ((uint8_t*)pData) + frameIndex * FramePacket::MAX_DRAWS * sizeof(UniformBuffer);
+
+    for (uint32_t i = 0; i < packet.drawCount; ++i) {
+        UniformBuffer ubo;
+        ubo.mvp = XMLoadFloat4x4(&packet.draws[i].world) * viewProj;
+
+        memcpy_s(pBytePtr + i * sizeof(UniformBuffer), sizeof(XMMATRIX), &ubo.mvp, sizeof(XMMATRIX));
+    }
+
+    pConstantBuffer->Unmap(0, nullptr);
+}
+
+//
+// Copies the baked mip chain out as the streaming backing store. Runs on a worker.
+//
+void Harmony::BakeBackingMips() {
+    void* pData = nullptr;
+    if (FAILED(pBakeReadback->Map(0, nullptr, &pData)) || pData == nullptr) {
+        throw std::runtime_error("Could not map bake readback buffer!");
+    }
+
+    backingMips.resize(bakeFootprints.size());
+
+    for (size_t mip = 0; mip < bakeFootprints.size(); ++mip) {
+        const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& footprint = bakeFootprints[mip];
+
+        UINT width  = footprint.Footprint.Width;
+        UINT height = footprint.Footprint.Height;
+
+        backingMips[mip].resize(size_t(width) * height);
+
+        for (UINT y = 0; y < height; ++y) {
+            const uint8_t* pRow = reinterpret_cast<const uint8_t*>(pData) + footprint.Offset + y * footprint.Footprint.RowPitch;
+            memcpy_s(backingMips[mip].data() + size_t(y) * width, width * sizeof(UINT), pRow, width * sizeof(UINT));
+        }
+    }
+
+    D3D12_RANGE writeRange { .Begin = 0, .End = 0 };
+    pBakeReadback->Unmap(0, &writeRange);
+}
+
+//
+// Maps the packed mip tail to the front of the tile pool and uploads it; it stays resident and the
+// streamer maps standard mip tiles on top. Mapping changes and uploads all go through the copy queue,
+// the texture is left in COMMON and promoted implicitly on either queue.
+//
+void Harmony::StartStreaming() {
+    UINT standardMips = packedMipInfo.NumStandardMips;
+    UINT packedTiles  = packedMipInfo.NumTilesForPackedMips;
+
+    if (packedTiles > 0) {
+        D3D12_TILED_RESOURCE_COORDINATE tailStart { .X = 0, .Y = 0, .Z = 0, .Subresource = standardMips };
+        D3D12_TILE_REGION_SIZE          tailSize  { .NumTiles = packedTiles, .UseBox = FALSE, .Width = 0, .Height = 0, .Depth = 0 };
+        D3D12_TILE_RANGE_FLAGS          tailFlags = D3D12_TILE_RANGE_FLAG_NONE;
+        UINT                            poolStart = 0;
+
+        pCopyQueue->UpdateTileMappings(pTexture, 1, &tailStart, &tailSize, pTilePool, 1, &tailFlags, &poolStart, &packedTiles, D3D12_TILE_MAPPING_FLAG_NONE);
+    }
+
+    for (UINT mip = standardMips; mip < backingMips.size(); ++mip) {
+        UINT width  = (std::max)(TEXTURE_WIDTH  >> mip, 1);
+        UINT height = (std::max)(TEXTURE_HEIGHT >> mip, 1);
+
+        if (!uploadManager.UploadTexture(pTexture, mip, 0, 0, width, height, backingMips[mip].data(), width * sizeof(UINT))) {
+            throw std::runtime_error("Could not stage packed mips!");
+        }
+    }
+
+    // the first frame that draws samples the tail
+    pCommandQueue->Wait(uploadManager.GetFence(), uploadManager.Submit());
+
+    feedbackAggregator.Init(FEEDBACK_WIDTH, FEEDBACK_HEIGHT, static_cast<uint8_t>(standardMips), settings.aggregation);
+
+    if (!settings.trace.empty() && !feedbackTrace.Create(settings.trace, FEEDBACK_WIDTH, FEEDBACK_HEIGHT, standardMips)) {
+        std::cerr << "Could not create feedback trace " << settings.trace << std::endl;
+    }
+
+    streamer.Init({
+        .regionsX       = FEEDBACK_WIDTH,
+        .regionsY       = FEEDBACK_HEIGHT,
+        .standardMips   = standardMips,
+        .poolTiles      = settings.tilePool,
+        .firstHeapTile  = packedTiles,
+        .io             = {
+            .bytesPerFrame    = settings.tileBytes,
+            .requestsPerFrame = settings.loadsPerUpdate,
+            .maxBytesInFlight = UploadManager::STAGING_SIZE / 4
+        }
+    }, {
+        .upload = [this](const TileCoord& tile) {
+            UINT mipWidth  = TEXTURE_WIDTH  >> tile.mip;
+            UINT mipHeight = TEXTURE_HEIGHT >> tile.mip;
+
+            UINT x = tile.x * textureTileShape.WidthInTexels;
+            UINT y = tile.y * textureTileShape.HeightInTexels;
+
+            UINT width  = (std::min)(textureTileShape.WidthInTexels,  mipWidth  - x);
+            UINT height = (std::min)(textureTileShape.HeightInTexels, mipHeight - y);
+
+            return uploadManager.UploadTexture(pTexture, tile.mip, x, y, width, height,
+                backingMips[tile.mip].data() + size_t(y) * mipWidth + x, mipWidth * sizeof(UINT));
+        },
+        .submit = [this](const TileMapping* pMappings, uint32_t count, bool reusesTiles) {
+            return SubmitTileMappings(pMappings, count, reusesTiles);
+        },
+        .completedValue = [this]() {
+            return uploadManager.GetFence()->GetCompletedValue();
+        }
+    });
+}
+
+void Harmony::PopulateCommandList(const FramePacket& packet) {
+    FeedbackRateController::Frame feedback = feedbackRate.NextFrame();
+
+    pCommandAllocators[frameIndex]->Reset();
+    pCommandList->Reset(pCommandAllocators[frameIndex], feedback.write ? pPipelineState : pMainPipelineState);
+
+    pCommandList->SetGraphicsRootSignature(pRootSignature);
+
+    D3D12_RESOURCE_BARRIER rtBarrier {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pRenderTargets[backBufferIndex],
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_PRESENT,
+            .StateAfter  = D3D12_RESOURCE_STATE_RENDER_TARGET,
+        }
+    };
+    D3D12_RESOURCE_BARRIER dsBarrier {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pDepthBuffer,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
+            .StateAfter  = D3D12_RESOURCE_STATE_DEPTH_WRITE,
+        }
+    };
+
+    // PRESENT -> RT barriers. The streamed texture stays in COMMON, the copy queue writes it between frames
+    {
+        D3D12_RESOURCE_BARRIER barriersIn[] = { rtBarrier, dsBarrier };
+        pCommandList->ResourceBarrier(2, barriersIn);
+    }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE rtHandle = static_cast<D3D12_CPU_DESCRIPTOR_HANDLE>(pRtvHeap->GetCPUDescriptorHandleForHeapStart().ptr + backBufferIndex * rtvDescriptorSize);
+    D3D12_CPU_DESCRIPTOR_HANDLE dsHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
+  
+    pCommandList->OMSetRenderTargets(1, &rtHandle, FALSE, &dsHandle);
+    pCommandList->RSSetViewports(1, &viewport);
+    pCommandList->RSSetScissorRects(1, &scissorRect);
+
+    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
+    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+
+    //
+    // clear RT & depth
+    //
+    const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    pCommandList->ClearRenderTargetView(rtHandle, clearColor, 0, nullptr);
+    pCommandList->ClearDepthStencilView(dsHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    pCommandList->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    UpdateMinMip();
+
+    //
+    // Clear feedback, once per window; it accumulates until the window is resolved
+    //
+    if (feedback.clear) {
+        D3D12_CPU_DESCRIPTOR_HANDLE fbCpuHandle = pUavHeap->GetCPUDescriptorHandleForHeapStart();
+        D3D12_GPU_DESCRIPTOR_HANDLE fbGpuHandle = static_cast<D3D12_GPU_DESCRIPTOR_HANDLE>(pSrvHeap->GetGPUDescriptorHandleForHeapStart().ptr + srvDescriptorSize);
+
+        const UINT clearValue[] = { 0, 0, 0, 0 }; // NB: values are ignored
+        pCommandList->ClearUnorderedAccessViewUint(fbGpuHandle, fbCpuHandle, pFeedbackTexture, clearValue, 0, nullptr);
+    }
+
+    D3D12_INDEX_BUFFER_VIEW ibv {
+        pIndexBuffer->GetGPUVirtualAddress(),
+        sizeof indices,
+        DXGI_FORMAT_R32_UINT,
+    };
+
+    D3D12_VERTEX_BUFFER_VIEW vbv{
+        pVertexBuffer->GetGPUVirtualAddress(),
+        sizeof vertices,
+        sizeof Vertex
+    };
+
+    pCommandList->IASetIndexBuffer(&ibv);
+    pCommandList->IASetVertexBuffers(0, 1, &vbv);
+
+    D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+    D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = { srvGpuHandle.ptr + srvDescriptorSize };
+
+    pCommandList->SetGraphicsRootDescriptorTable(1, srvGpuHandle);
+    pCommandList->SetGraphicsRootDescriptorTable(2, uavGpuHandle);
+    pCommandList->SetGraphicsRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+
+    if (feedback.write) {
+        UINT rateConstants[2] = { feedbackRate.GetPixelRate(), feedback.phase };
+        pCommandList->SetGraphicsRoot32BitConstants(4, 2, rateConstants, 0);
+    }
+
+    // nothing to sample until streaming has started
+    if (textureAcquired) {
+        D3D12_GPU_VIRTUAL_ADDRESS cbAddress = pConstantBuffer->GetGPUVirtualAddress() + frameIndex * FramePacket::MAX_DRAWS * sizeof(UniformBuffer);
+
+        for (uint32_t i = 0; i < packet.drawCount; ++i) {
+            const DrawItem& draw = packet.draws[i];
+
+            pCommandList->SetGraphicsRootConstantBufferView(0, cbAddress + i * sizeof(UniformBuffer));
+            pCommandList->DrawIndexedInstanced(draw.indexCount, 1, draw.firstIndex, 0, 0);
+        }
+    }
+
+    // resolve the feedback into host readable memory, at the end of a window
+    if (feedback.resolve) {
+        ResolveFeedback();
+    }
+
+    // RT -> Present barriers
+    {
+        std::swap(dsBarrier.Transition.StateBefore, dsBarrier.Transition.StateAfter);
+        std::swap(rtBarrier.Transition.StateBefore, rtBarrier.Transition.StateAfter);
+
+        D3D12_RESOURCE_BARRIER barriersOut[] = { rtBarrier, dsBarrier };
+        pCommandList->ResourceBarrier(2, barriersOut);
+    }
+
+    // GPU completion time of the frame, read back once its slot retires
+    pCommandList->EndQuery(pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, frameIndex);
+    ID3D12Resource* pTimestampSlice = timestampReadback.Acquire(frameIndex, scheduler.GetNextValue(QUEUE_GRAPHICS));
+    pCommandList->ResolveQueryData(pTimestampHeap, D3D12_QUERY_TYPE_TIMESTAMP, frameIndex, 1, pTimestampSlice, 0);
+
+    pCommandList->Close();
+}
+
+//
+// Blocks on the swap chain's latency waitable, then sleeps until the pacer wants the frame to
+// start. Everything the frame latches (its frame packet) happens after this returns.
+//
+void Harmony::WaitForFrameStart() {
+    if (frameLatencyWaitable) {
+        WaitForSingleObjectEx(frameLatencyWaitable, 1000, TRUE);
+    }
+
+    if (pacer.GetPolicy() == FramePacer::Policy::None) {
+        return;
+    }
+
+    DXGI_FRAME_STATISTICS frameStats;
+    if (SUCCEEDED(pSwapChain4->GetFrameStatistics(&frameStats))) {
+        pacer.OnVblank(QpcToTime(frameStats.SyncQPCTime.QuadPart), frameStats.SyncRefreshCount);
+    }
+
+    auto remaining = pacer.NextStart(std::chrono::steady_clock::now()) - std::chrono::steady_clock::now();
+
+    if (remaining > std::chrono::steady_clock::duration::zero()) {
+        // relative due time in 100ns units
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(remaining).count();
+
+        SetWaitableTimer(pacingTimer, &dueTime, 0, nullptr, nullptr, FALSE);
+        WaitForSingleObject(pacingTimer, INFINITE);
+    }
+}
+
+//
+// Ends the frame on the graphics timeline and blocks until the next frame's slot is free
+// (the frame recorded framesInFlight frames ago has completed).
+//
+void Harmony::MoveToNextFrame() {
+    scheduler.Signal(QUEUE_GRAPHICS);
+    scheduler.NextFrame();
+
+    frameIndex = scheduler.GetFrameSlot();
+
+    // the slot just retired, so its frame is complete on the GPU
+    CollectFrameTiming(frameIndex);
+    ProcessFeedback();
+
+    scheduler.ReportStats(false);
+    frameExchange.ReportStats(false);
+}
+
+void Harmony::CollectFrameTiming(UINT slot) {
+    FrameTimestamps& timestamps = frameTimestamps[slot];
+
+    const uint8_t* pData = timestampReadback.Read(slot, scheduler.GetCompletedValue(QUEUE_GRAPHICS));
+
+    if (!timestamps.valid || pData == nullptr) {
+        return;
+    }
+
+    UINT64 ticks = *reinterpret_cast<const UINT64*>(pData);
+
+    timestamps.gpuComplete = GpuTicksToTime(ticks);
+    timestamps.valid       = false;
+
+    pacer.OnFrameWork(timestamps.gpuComplete - timestamps.cpuStart);
+    timingStats.Add(timestamps);
+
+    // GPU and CPU clocks drift apart, re-sync along with every report
+    if (timingStats.Report(false)) {
+        CalibrateClocks();
+    }
+}
+
+//
+// Resolves every feedback map of the batch into its rect of the atlas and copies the atlas into the
+// frame's readback slice: one barrier batch in (maps to RESOLVE_SOURCE, atlas to RESOLVE_DEST), the
+// resolves back to back, one barrier batch out (maps back to UAV for the next window, atlas to
+// COPY_SOURCE) and a single copy, however many textures there are.
+//
+void Harmony::ResolveFeedback() {
+    const auto& entries = feedbackBatch.GetEntries();
+
+    resolveBarriers.clear();
+
+    for (ID3D12Resource* pMap : feedbackMaps) {
+        resolveBarriers.push_back({
+            .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+            .Transition = {
+                .pResource   = pMap,
+                .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+                .StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+                .StateAfter  = D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
+            }
+        });
+    }
+
+    resolveBarriers.push_back({
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pFeedbackAtlas,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_COPY_SOURCE,
+            .StateAfter  = D3D12_RESOURCE_STATE_RESOLVE_DEST,
+        }
+    });
+
+    pCommandList->ResourceBarrier(static_cast<UINT>(resolveBarriers.size()), resolveBarriers.data());
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        pCommandList->ResolveSubresourceRegion(pFeedbackAtlas,
+            0,                  // atlas only has 1 subresource
+            entries[i].x, entries[i].y,
+            feedbackMaps[i],
+            UINT_MAX,           // decode all src subresources
+            nullptr,
+            DXGI_FORMAT_R8_UINT, // target format must be R8_UINT
+            D3D12_RESOLVE_MODE_DECODE_SAMPLER_FEEDBACK // resolve feedback mode
+        );
+    }
+
+    for (auto& barrier : resolveBarriers) {
+        std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
+    }
+
+    pCommandList->ResourceBarrier(static_cast<UINT>(resolveBarriers.size()), resolveBarriers.data());
+
+    D3D12_TEXTURE_COPY_LOCATION dst {
+        .pResource       = feedbackReadback.Acquire(frameIndex, scheduler.GetNextValue(QUEUE_GRAPHICS)),
+        .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+        .PlacedFootprint = {
+            .Offset      = 0,
+            .Footprint   = { .Format = DXGI_FORMAT_R8_UINT, .Width = feedbackBatch.GetWidth(), .Height = feedbackBatch.GetHeight(), .Depth = 1, .RowPitch = feedbackBatch.GetRowPitch() }
+        }
+    };
+
+    D3D12_TEXTURE_COPY_LOCATION src {
+        .pResource        = pFeedbackAtlas,
+        .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+        .SubresourceIndex = 0
+    };
+
+    pCommandList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+}
+
+//
+// Smooths the newest completed frame's feedback (FeedbackAggregator), diffs it against residency
+// without waiting for the GPU and hands the requests to the streamer. --readback=sync instead waits for the frame just submitted, to
+// measure what that would cost.
+//
+void Harmony::ProcessFeedback() {
+    float stallMs = settings.syncReadback ? scheduler.WaitIdle() : 0.0f;
+
+    uint64_t       sequence = 0;
+    const uint8_t* pData    = feedbackReadback.ReadLatest(scheduler.GetCompletedValue(QUEUE_GRAPHICS), stallMs, &sequence);
+
+    feedbackReadback.ReportStats(settings.syncReadback ? "feedback (sync)" : "feedback", false);
+
+    // windows resolve every few frames, the newest slice is often one already handed over
+    if (pData == nullptr || !textureAcquired || sequence == feedbackSequence) {
+        return;
+    }
+
+    feedbackSequence = sequence;
+
+    // one pass over the batch; the aggregator and streamer only know the one texture, entry 0
+    const uint8_t* pTargets = nullptr;
+
+    feedbackProcessor.Begin();
+
+    feedbackBatch.Decode(pData, [&](const FeedbackBatch::Entry& entry, const uint8_t* pFeedback, size_t feedbackPitch) {
+        if (feedbackTrace.IsOpen()) {
+            feedbackTrace.Append(pFeedback, feedbackPitch);
+        }
+
+        pTargets = feedbackAggregator.Update(pFeedback, feedbackPitch);
+
+        feedbackProcessor.Process(entry.texture, pTargets, entry.width, streamer.GetResidency(), entry.width, entry.height, streamer.GetCoarsestMip());
+    });
+
+    streamer.Update(pTargets, FEEDBACK_WIDTH, feedbackProcessor.Finish());
+
+    feedbackBatch.ReportStats(false);
+    feedbackAggregator.ReportStats(false);
+    feedbackProcessor.ReportStats(false);
+    streamer.ReportStats(false);
+}
+
+//
+// Copies the regions whose residency changed into the min mip map ahead of the draw. The copy runs on
+// the graphics queue so each frame clamps to the residency it was recorded with: tiles only count as
+// resident once their upload has completed, and evicted tiles are clamped away before the copy queue,
+// which waits for the frames already submitted, unmaps them.
+//
+void Harmony::UpdateMinMip() {
+    if (!textureAcquired) {
+        return;
+    }
+
+    const auto& rects = minMipMap.Update(streamer.GetResidency());
+
+    minMipMap.ReportStats(false);
+
+    if (rects.empty()) {
+        return;
+    }
+
+    UINT64   sliceOffset = UINT64(frameIndex) * FEEDBACK_ROW_PITCH * FEEDBACK_HEIGHT;
+    uint8_t* pSlice      = pMinMipUploadData + sliceOffset;
+
+    D3D12_RESOURCE_BARRIER mmBarrier {
+        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
+        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
+        .Transition = {
+            .pResource   = pMinMipTexture,
+            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
+            .StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
+            .StateAfter  = D3D12_RESOURCE_STATE_COPY_DEST,
+        }
+    };
+    pCommandList->ResourceBarrier(1, &mmBarrier);
+
+    D3D12_TEXTURE_COPY_LOCATION dst {
+        .pResource        = pMinMipTexture,
+        .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
+        .SubresourceIndex = 0
+    };
+
+    D3D12_TEXTURE_COPY_LOCATION src {
+        .pResource       = pMinMipUpload,
+        .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
+        .PlacedFootprint = {
+            .Offset      = sliceOffset,
+            .Footprint   = { .Format = DXGI_FORMAT_R8_UINT, .Width = FEEDBACK_WIDTH, .Height = FEEDBACK_HEIGHT, .Depth = 1, .RowPitch = FEEDBACK_ROW_PITCH }
+        }
+    };
+
+    const uint8_t* pMap = minMipMap.GetData();
+
+    for (const auto& rect : rects) {
+        for (uint32_t y = rect.top; y < rect.bottom; ++y) {
+            memcpy_s(pSlice + y * FEEDBACK_ROW_PITCH + rect.left, FEEDBACK_ROW_PITCH - rect.left,
+                     pMap + y * minMipMap.GetWidth() + rect.left, rect.right - rect.left);
+        }
+
+        D3D12_BOX box { .left = rect.left, .top = rect.top, .front = 0, .right = rect.right, .bottom = rect.bottom, .back = 1 };
+
+        pCommandList->CopyTextureRegion(&dst, rect.left, rect.top, 0, &src, &box);
+    }
+
+    std::swap(mmBarrier.Transition.StateBefore, mmBarrier.Transition.StateAfter);
+    pCommandList->ResourceBarrier(1, &mmBarrier);
+}
+
+//
+// One streamer batch in a single UpdateTileMappings call, queued ahead of its tile uploads. Heap tiles
+// taken over from evicted tiles may still be sampled by frames in flight, so those batches first wait
+// for everything the graphics queue has been given.
+//
+UINT64 Harmony::SubmitTileMappings(const TileMapping* pMappings, uint32_t count, bool reusesTiles) {
+    std::vector<D3D12_TILED_RESOURCE_COORDINATE> coords(count);
+    std::vector<D3D12_TILE_RANGE_FLAGS>          flags(count);
+    std::vector<UINT>                            poolOffsets(count);
+    std::vector<UINT>                            tileCounts(count, 1);
+
+    for (uint32_t i = 0; i < count; ++i) {
+        const TileMapping& mapping = pMappings[i];
+
+        coords[i] = { .X = mapping.coord.x, .Y = mapping.coord.y, .Z = 0, .Subresource = mapping.coord.mip };
+
+        if (mapping.heapTile == TileStreamer::UNMAPPED) {
+            flags[i]       = D3D12_TILE_RANGE_FLAG_NULL;
+            poolOffsets[i] = 0;
+        }
+        else {
+            flags[i]       = D3D12_TILE_RANGE_FLAG_NONE;
+            poolOffsets[i] = mapping.heapTile;
+        }
+    }
+
+    if (reusesTiles) {
+        pCopyQueue->Wait(pFence, scheduler.GetLastSignaled(QUEUE_GRAPHICS));
+    }
+
+    // no region sizes: one tile per region
+    pCopyQueue->UpdateTileMappings(pTexture, count, coords.data(), nullptr, pTilePool, count, flags.data(), poolOffsets.data(), tileCounts.data(), D3D12_TILE_MAPPING_FLAG_NONE);
+
+    return uploadManager.Submit();
+}
+
+void Harmony::CalibrateClocks() {
+    if (FAILED(pCommandQueue->GetClockCalibration(&calibrationGpu, &calibrationQpc))) {
+        throw std::runtime_error("Could not calibrate GPU clock!");
+    }
+}
+
+std::chrono::steady_clock::time_point Harmony::QpcToTime(INT64 qpc) {
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto elapsed   = std::chrono::duration<double>(double(now.QuadPart - qpc) / double(qpcFrequency));
+
+    return steadyNow - std::chrono::duration_cast<std::chrono::steady_clock::duration>(elapsed);
+}
+
+std::chrono::steady_clock::time_point Harmony::GpuTicksToTime(UINT64 ticks) {
+    double gpuSeconds = (double(ticks) - double(calibrationGpu)) / double(gpuTimestampFrequency);
+
+    return QpcToTime(INT64(calibrationQpc) + INT64(gpuSeconds * double(qpcFrequency)));
+}
+
+void Harmony::WaitForGpu() {
+    scheduler.WaitIdle();
+}
+
+#pragma endregion
+
+#pragma region Benchmarks
+
+//
+// --bench=feedback: synthetic 64x64 region MinMip maps (8K textures at 128x128 regions) for a few
+// thousand textures, decoded with the vector path and the scalar reference. "steady" has 1% of
+// regions changing per frame, "churn" 20%.
+//
+static void BenchFeedback() {
+    using namespace std::chrono;
+
+    const uint32_t textures    = 4096;
+    const uint32_t width       = 64;
+    const uint32_t height      = 64;
+    const uint32_t pitch       = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+    const uint8_t  coarsestMip = 6;
+
+    struct Scenario {
+        const char* name;
+        int         changePercent;
+    };
+
+    const Scenario scenarios[] = { { "steady", 1 }, { "churn", 20 } };
+
+    for (const auto& scenario : scenarios) {
+        std::mt19937                        rng(7);
+        std::uniform_int_distribution<int>  percent(0, 99);
+        std::uniform_int_distribution<int>  mip(0, coarsestMip);
+
+        std::vector<uint8_t> feedback(size_t(textures) * pitch * height);
+        std::vector<uint8_t> residency(size_t(textures) * width * height);
+
+        for (uint32_t t = 0; t < textures; ++t) {
+            for (uint32_t y = 0; y < height; ++y) {
+                for (uint32_t x = 0; x < width; ++x) {
+                    uint8_t resident = uint8_t(mip(rng));
+                    uint8_t wanted   = resident;
+
+                    if (percent(rng) < scenario.changePercent) {
+                        wanted = percent(rng) < 20 ? 0xFF : uint8_t(mip(rng));
+                    }
+
+                    residency[(size_t(t) * height + y) * width + x] = resident;
+                    feedback[(size_t(t) * height + y) * pitch + x]  = wanted;
+                }
+            }
+        }
+
+        FeedbackProcessor processor;
+        float             bestUs[2] = { (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)() };
+        std::vector<FeedbackProcessor::Request> results[2];
+
+        for (int pass = 0; pass < 10; ++pass) {
+            for (int vectorized = 0; vectorized < 2; ++vectorized) {
+                auto begin = steady_clock::now();
+
+                processor.Begin();
+
+                for (uint32_t t = 0; t < textures; ++t) {
+                    const uint8_t* pFeedback  = feedback.data() + size_t(t) * pitch * height;
+                    const uint8_t* pResidency = residency.data() + size_t(t) * width * height;
+
+                    if (vectorized) {
+                        processor.Process(t, pFeedback, pitch, pResidency, width, height, coarsestMip);
+                    }
+                    else {
+                        processor.ProcessReference(t, pFeedback, pitch, pResidency, width, height, coarsestMip);
+                    }
+                }
+
+                results[vectorized] = processor.GetRequests();
+                bestUs[vectorized] = (std::min)(bestUs[vectorized], duration<float, std::micro>(steady_clock::now() - begin).count());
+            }
+        }
+
+        bool match = std::equal(results[0].begin(), results[0].end(), results[1].begin(), results[1].end(),
+            [](const FeedbackProcessor::Request& a, const FeedbackProcessor::Request& b) {
+                return a.texture == b.texture && a.regionX == b.regionX && a.regionY == b.regionY &&
+                       a.mip == b.mip && a.load == b.load && a.priority == b.priority;
+            });
+
+        float regions = float(textures) * width * height;
 
-        pDevice9->CreateDepthStencilView(pDepthBuffer, &dsViewDesc, dsvHandle);
+        std::cout << "Feedback " << scenario.name << ": " << textures << " textures, " << results[1].size() << " requests"
+                  << (match ? "" : " (MISMATCH)") << ", scalar " << bestUs[0] / 1000.0f << " ms ("
+                  << regions / bestUs[0] << " regions/us), vector " << bestUs[1] / 1000.0f << " ms ("
+                  << regions / bestUs[1] << " regions/us)" << std::endl;
     }
 }
 
-void Harmony::CreatePipelines() {
-    D3D12_FEATURE_DATA_ROOT_SIGNATURE rootFeatures = {};
-
-    rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+//
+// --bench=minmip: min mip map updates for a 16K x 16K texture (128 x 128 regions). Each frame a
+// few tiles change residency, mostly fine ones (a mip N tile covers 2^N x 2^N regions); the vector
+// and scalar paths run on their own maps and have to report the same rectangles and contents.
+//
+static void BenchMinMip() {
+    using namespace std::chrono;
 
-    if (FAILED(pDevice9->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &rootFeatures, sizeof rootFeatures))) {
-        rootFeatures.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1;
-    }
+    const uint32_t regions = 128;
+    const uint32_t frames  = 2000;
+    const uint32_t changes[] = { 0, 4, 64 };
 
-    // Graphics root signature (has 4 params for the shader)
-    {
-        D3D12_ROOT_PARAMETER rootParams[4];
+    std::mt19937 rng(7);
 
-        D3D12_DESCRIPTOR_RANGE  descRange[4] = {
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-        };
+    std::cout << "MinMip: " << regions << " x " << regions << " regions, " << frames << " frames" << std::endl;
 
-        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_CBV;
-        rootParams[0].Descriptor.ShaderRegister           = 0;
-        rootParams[0].Descriptor.RegisterSpace            = 0;
-        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_VERTEX;
+    for (uint32_t changesPerFrame : changes) {
+        std::vector<uint8_t> residency(regions * regions, 7);
 
-        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[1];
-        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+        MinMipMap vectorMap;
+        MinMipMap scalarMap;
 
-        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[2];
-        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+        vectorMap.Init(regions, regions);
+        scalarMap.Init(regions, regions);
 
-        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[3];
-        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_PIXEL;
+        float    bestUs[2]  = { (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)() };
+        double   sumUs[2]   = {};
+        uint64_t copied     = 0;
+        uint64_t copies     = 0;
+        bool     mismatch   = false;
 
-        D3D12_ROOT_SIGNATURE_DESC rDesc {
-            .NumParameters     = 4,
-            .pParameters       = rootParams,
-            .NumStaticSamplers = 0,
-            .pStaticSamplers   = nullptr,
-            .Flags = D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT
-        };
+        for (uint32_t i = 0; i < frames; ++i) {
+            for (uint32_t c = 0; c < changesPerFrame; ++c) {
+                uint32_t mip  = static_cast<uint32_t>(std::countr_zero(rng() | 0x80u));     // half of them mip 0, a quarter mip 1, ...
+                uint32_t size = 1u << mip;
+                uint32_t x0   = (rng() % (regions / size)) * size;
+                uint32_t y0   = (rng() % (regions / size)) * size;
+                uint8_t  to   = uint8_t(rng() % 8);
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> errBlob;
+                for (uint32_t y = y0; y < y0 + size; ++y) {
+                    memset(residency.data() + y * regions + x0, to, size);
+                }
+            }
 
-        // FIXME: Root signature version 1_1 not working
-        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
-            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
-        }
+            auto begin = steady_clock::now();
+            const auto& vectorRects = vectorMap.Update(residency.data());
+            float vectorUs = duration<float, std::micro>(steady_clock::now() - begin).count();
 
-        ComPtr<ID3D12RootSignature> rs;
-        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&rs)))) {
-            throw std::runtime_error("Could not create root signature!");
-        }
+            begin = steady_clock::now();
+            const auto& scalarRects = scalarMap.UpdateReference(residency.data());
+            float scalarUs = duration<float, std::micro>(steady_clock::now() - begin).count();
 
-        pRootSignature = rs.Detach();
-        delQ.Append([cRootSignature = pRootSignature] {
-            cRootSignature->Release();
-        });
-    }
+            // the first frame copies everything
+            if (i > 0) {
+                bestUs[0] = (std::min)(bestUs[0], vectorUs);
+                bestUs[1] = (std::min)(bestUs[1], scalarUs);
+                sumUs[0] += vectorUs;
+                sumUs[1] += scalarUs;
+            }
 
-    // Graphics pipeline
-    {
-        ComPtr<ID3D12PipelineState> pso;
-        std::vector<char>           vs, ps;
-        
-        UINT compileFlags = 0;
+            for (const auto& rect : vectorRects) {
+                copied += uint64_t(rect.right - rect.left) * (rect.bottom - rect.top);
+                copies += 1;
+            }
 
-        if constexpr (enableDebugLayers) {
-            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+            mismatch |= vectorRects != scalarRects;
+            mismatch |= memcmp(vectorMap.GetData(), scalarMap.GetData(), residency.size()) != 0;
         }
 
-        //load VS
-        {
-            std::ifstream file("shaders/vs.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load vs.bin!");
-            }
+        std::cout << "  " << changesPerFrame << " tile changes/frame: vector " << sumUs[0] / (frames - 1) << " us (best " << bestUs[0]
+                  << "), scalar " << sumUs[1] / (frames - 1) << " us (best " << bestUs[1] << "), "
+                  << double(copied) / frames << " regions in " << double(copies) / frames << " copies/frame" << (mismatch ? ", MISMATCH" : "") << std::endl;
+    }
+}
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+//
+// --bench=feedbackrate: replays a synthetic UV stream (a 16K texture on a plane that zooms, pans and
+// rotates under a perspective-like falloff, 480 x 270 pixels) through the rate controller and
+// compares every resolved window against full rate feedback of the same frame. Under-requests are
+// regions where the window asks for a coarser mip (or nothing) than full rate would, which is what
+// makes streaming fall behind; over-requests are stale finer mips.
+//
+static void BenchFeedbackRate() {
+    const uint32_t screenWidth  = 480;
+    const uint32_t screenHeight = 270;
+    const uint32_t regions      = 128;
+    const uint32_t mips         = 8;
+    const uint32_t frames       = 600;
+
+    struct Run {
+        uint32_t               rate      = 1;
+        uint32_t               interval  = 1;
+        FeedbackRateController controller;
+        std::vector<uint8_t>   accumulated;
+        uint64_t               writes    = 0;
+        uint64_t               windows   = 0;
+        uint64_t               compared  = 0;
+        uint64_t               exact     = 0;
+        uint64_t               under     = 0;
+        uint64_t               over      = 0;
+    };
 
-            vs.resize((size_t)filesize);
-            file.read(vs.data(), filesize);
-        }
+    std::vector<Run> runs;
 
-        // load PS
-        {
-            std::ifstream file("shaders/ps.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load ps.bin!");
-            }
+    for (auto [rate, interval] : { std::pair{ 1u, 1u }, { 2u, 1u }, { 4u, 1u }, { 8u, 1u }, { 16u, 1u }, { 4u, 2u } }) {
+        Run& run = runs.emplace_back();
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+        run.rate     = rate;
+        run.interval = interval;
+        run.controller.Init(rate, interval);
+        run.accumulated.assign(regions * regions, 0xFF);
+    }
 
-            ps.resize((size_t)filesize);
-            file.read(ps.data(), filesize);
-        }
+    std::vector<uint16_t> pixelRegion(screenWidth * screenHeight);      // 0xFFFF: off the texture
+    std::vector<uint8_t>  pixelMip(screenWidth * screenHeight);
+    std::vector<uint8_t>  reference(regions * regions);
 
-        D3D12_INPUT_ELEMENT_DESC inputElementDesc[] = {
-            { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0,  0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            { "COLOR",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-        };
+    for (uint32_t i = 0; i < frames; ++i) {
+        float t     = i / 60.0f;
+        float zoom  = 0.35f + 0.25f * sinf(t);                          // uv extent across the screen
+        float angle = 0.2f * t;
+        float cx    = 0.5f + 0.25f * cosf(0.3f * t);
+        float cy    = 0.5f + 0.25f * sinf(0.3f * t);
 
-        D3D12_BLEND_DESC blendDesc {
-            .AlphaToCoverageEnable  = FALSE,
-            .IndependentBlendEnable = FALSE
-        };
+        std::fill(reference.begin(), reference.end(), uint8_t(0xFF));
 
-        for (UINT i = 0; i < 8; ++i) {
-            blendDesc.RenderTarget[i] = {
-                FALSE,FALSE,
-                D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-                D3D12_BLEND_ONE, D3D12_BLEND_ZERO, D3D12_BLEND_OP_ADD,
-                D3D12_LOGIC_OP_NOOP,
-                D3D12_COLOR_WRITE_ENABLE_ALL,
-            };
-        }
+        for (uint32_t py = 0; py < screenHeight; ++py) {
+            float depth  = 1.0f + 2.0f * py / screenHeight;
+            float extent = zoom * depth / screenWidth;                  // uv per pixel
+            float lod    = log2f(extent * 16384.0f);
+            uint8_t mip  = uint8_t((std::min)((std::max)(lod, 0.0f), float(mips - 1)));
 
-        D3D12_RASTERIZER_DESC rastDesc {
-            .FillMode               = D3D12_FILL_MODE_SOLID,
-            .CullMode               = D3D12_CULL_MODE_BACK,
-            .FrontCounterClockwise  = FALSE,
-            .DepthBias              = 0,
-            .DepthBiasClamp         = 0.0f,
-            .SlopeScaledDepthBias   = 0.0f,
-            .DepthClipEnable        = FALSE,
-            .MultisampleEnable      = FALSE,
-            .AntialiasedLineEnable  = FALSE,
-            .ForcedSampleCount      = 0,
-            .ConservativeRaster     = D3D12_CONSERVATIVE_RASTERIZATION_MODE_OFF
-        };
+            for (uint32_t px = 0; px < screenWidth; ++px) {
+                float lx = (float(px) - screenWidth * 0.5f) * extent;
+                float ly = (float(py) - screenHeight * 0.5f) * extent;
+                float u  = cx + lx * cosf(angle) - ly * sinf(angle);
+                float v  = cy + lx * sinf(angle) + ly * cosf(angle);
 
-        D3D12_DEPTH_STENCILOP_DESC defaultStencilOp {
-            .StencilFailOp      = D3D12_STENCIL_OP_KEEP,
-            .StencilDepthFailOp = D3D12_STENCIL_OP_KEEP,
-            .StencilPassOp      = D3D12_STENCIL_OP_KEEP,
-            .StencilFunc        = D3D12_COMPARISON_FUNC_ALWAYS
-        };
+                size_t pixel = py * screenWidth + px;
 
-        D3D12_DEPTH_STENCIL_DESC dsDesc {
-            .DepthEnable      = TRUE,
-            .DepthWriteMask   = D3D12_DEPTH_WRITE_MASK_ALL,
-            .DepthFunc        = D3D12_COMPARISON_FUNC_LESS_EQUAL,
-            .StencilEnable    = FALSE,
-            .StencilReadMask  = 0,
-            .StencilWriteMask = 0,
-            .FrontFace        = defaultStencilOp,
-            .BackFace         = defaultStencilOp
-        };
+                if (u < 0.0f || u >= 1.0f || v < 0.0f || v >= 1.0f) {
+                    pixelRegion[pixel] = 0xFFFF;
+                    continue;
+                }
 
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc {
-            .pRootSignature        = pRootSignature,
-            .VS                    = { .pShaderBytecode = vs.data(), .BytecodeLength = vs.size() },
-            .PS                    = { .pShaderBytecode = ps.data(), .BytecodeLength = ps.size() },
-            .BlendState            = blendDesc,
-            .SampleMask            = D3D12_DEFAULT_SAMPLE_MASK,
-            .RasterizerState       = rastDesc,
-            .DepthStencilState     = dsDesc,
-            .InputLayout           = { .pInputElementDescs = inputElementDesc, .NumElements = 3 },
-            .IBStripCutValue       = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED,
-            .PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE,
-            .NumRenderTargets      = 1,
-            .RTVFormats            = { DXGI_FORMAT_R8G8B8A8_UNORM },
-            .DSVFormat             = DXGI_FORMAT_D32_FLOAT,
-            .SampleDesc            = { .Count = 1, .Quality = 0 },
-            .NodeMask              = 0,
-            .CachedPSO             = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
-            .Flags                 = D3D12_PIPELINE_STATE_FLAG_NONE
-        };
+                uint16_t region = uint16_t(uint32_t(v * regions) * regions + uint32_t(u * regions));
 
-        if(FAILED(pDevice9->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
-            throw std::runtime_error("Could not create pipeline state object!");
+                pixelRegion[pixel] = region;
+                pixelMip[pixel]    = mip;
+                reference[region]  = (std::min)(reference[region], mip);
+            }
         }
 
-        pPipelineState = pso.Detach();
+        for (auto& run : runs) {
+            FeedbackRateController::Frame frame = run.controller.NextFrame();
 
-        delQ.Append([cPipelineState = pPipelineState] {
-            cPipelineState->Release();
-            });
-    }
+            if (!frame.write) {
+                continue;
+            }
 
-    // Compute root signature (has 3 params and 1 root constant)
-    {
-        D3D12_ROOT_PARAMETER rootParams[4];
+            if (frame.clear) {
+                std::fill(run.accumulated.begin(), run.accumulated.end(), uint8_t(0xFF));
+            }
 
-        D3D12_DESCRIPTOR_RANGE  descRange[3] = {
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_UAV,     .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-            {.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER, .NumDescriptors = 1, .BaseShaderRegister = 0, .RegisterSpace = 0, .OffsetInDescriptorsFromTableStart = 0 },
-        };
+            for (uint32_t py = 0; py < screenHeight; ++py) {
+                for (uint32_t px = 0; px < screenWidth; ++px) {
+                    size_t pixel = py * screenWidth + px;
 
-        rootParams[0].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-        rootParams[0].Constants.ShaderRegister            = 0;
-        rootParams[0].Constants.RegisterSpace             = 0;
-        rootParams[0].Constants.Num32BitValues            = 2;
-        rootParams[0].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+                    if (pixelRegion[pixel] == 0xFFFF || !FeedbackRateController::Writes(px, py, run.rate, frame.phase)) {
+                        continue;
+                    }
 
-        rootParams[1].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[1].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[1].DescriptorTable.pDescriptorRanges   = &descRange[0];
-        rootParams[1].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+                    uint8_t& entry = run.accumulated[pixelRegion[pixel]];
 
-        rootParams[2].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[2].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[2].DescriptorTable.pDescriptorRanges   = &descRange[1];
-        rootParams[2].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+                    entry       = (std::min)(entry, pixelMip[pixel]);
+                    run.writes += 1;
+                }
+            }
 
-        rootParams[3].ParameterType                       = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-        rootParams[3].DescriptorTable.NumDescriptorRanges = 1;
-        rootParams[3].DescriptorTable.pDescriptorRanges   = &descRange[2];
-        rootParams[3].ShaderVisibility                    = D3D12_SHADER_VISIBILITY_ALL;
+            if (!frame.resolve) {
+                continue;
+            }
 
-        D3D12_ROOT_SIGNATURE_DESC rDesc {
-            .NumParameters     = 4,
-            .pParameters       = rootParams,
-            .NumStaticSamplers = 0,
-            .pStaticSamplers   = nullptr,
-            .Flags = D3D12_ROOT_SIGNATURE_FLAG_NONE
-        };
+            run.windows += 1;
 
-        ComPtr<ID3DBlob> signature;
-        ComPtr<ID3DBlob> errBlob;
+            for (uint32_t r = 0; r < regions * regions; ++r) {
+                if (reference[r] == 0xFF && run.accumulated[r] == 0xFF) {
+                    continue;
+                }
 
-        // FIXME: Root signature version 1_1 not working
-        if (FAILED(D3D12SerializeRootSignature(&rDesc, /*rootFeatures.HighestVersion*/ D3D_ROOT_SIGNATURE_VERSION_1, &signature, &errBlob))) {
-            throw std::runtime_error(reinterpret_cast<const char*>(errBlob->GetBufferPointer()));
+                run.compared += 1;
+                run.exact    += reference[r] == run.accumulated[r] ? 1 : 0;
+                run.under    += reference[r] <  run.accumulated[r] ? 1 : 0;
+                run.over     += reference[r] >  run.accumulated[r] ? 1 : 0;
+            }
         }
+    }
 
-        ComPtr<ID3D12RootSignature> cs;
-        if (FAILED(pDevice9->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(&cs)))) {
-            throw std::runtime_error("Could not create root signature!");
-        }
+    double fullRateWrites = double(runs[0].writes);
 
-        pCsRootSignature = cs.Detach();
-        delQ.Append([cRootSignature = pCsRootSignature] {
-            cRootSignature->Release();
-        });
+    std::cout << "Feedback rate: " << screenWidth << " x " << screenHeight << " pixels, " << regions << " x " << regions
+              << " regions, " << frames << " frames" << std::endl;
+
+    for (const auto& run : runs) {
+        std::cout << "  1/" << run.rate << " pixels, every " << run.interval << " frame(s): writes "
+                  << 100.0 * run.writes / fullRateWrites << "%, resolves " << 100.0 * run.windows / frames
+                  << "% of frames, window " << run.controller.GetWindowFrames() << " frames, regions exact "
+                  << 100.0 * run.exact / run.compared << "%, under " << 100.0 * run.under / run.compared
+                  << "%, over " << 100.0 * run.over / run.compared << "%" << std::endl;
     }
+}
 
-    // Compute pipeline
-    {
-        ComPtr<ID3D12PipelineState> pso;
-        std::vector<char>           cs;
+//
+// --bench=feedbackbatch: feedback maps of a growing number of streamed textures (8 x 8 to 64 x 64
+// regions, 1K to 8K texels) read back per texture, each with its own resolve, barrier pair and
+// readback buffer of pitch aligned rows decoded buffer by buffer, against one batch: an atlas read
+// back through a single slice and decoded in one pass. Both feed the same FeedbackProcessor and must
+// produce the same requests; GPU work is counted, CPU decode (readback to requests) is timed.
+//
+static void BenchFeedbackBatch() {
+    using namespace std::chrono;
 
-        UINT compileFlags = 0;
+    const uint32_t counts[]   = { 1, 16, 64, 256, 1024 };
+    const uint32_t pitch      = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+    const uint32_t atlasWidth = 1024;
+    const int      passes     = 20;
 
-        if constexpr (enableDebugLayers) {
-            compileFlags |= D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-        }
+    std::cout << "Feedback batch: per texture resolve and readback vs one atlas" << std::endl;
 
-        //load CS
-        {
-            std::ifstream file("shaders/mipgen.bin", std::ios::in | std::ios::binary);
-            if (!file) {
-                throw std::runtime_error("Could not load mipgen.bin!");
-            }
+    for (uint32_t count : counts) {
+        std::mt19937 rng(7);
 
-            file.seekg(0, std::ios_base::end);
-            std::streampos filesize = file.tellg();
-            file.seekg(0, std::ios_base::beg);
+        FeedbackBatch batch;
+        batch.Init(atlasWidth);
 
-            cs.resize((size_t)filesize);
-            file.read(cs.data(), filesize);
-        }
+        std::vector<uint8_t> coarsestMip(count);
 
-        D3D12_COMPUTE_PIPELINE_STATE_DESC psoDesc {
-            .pRootSignature = pCsRootSignature,
-            .CS             = { .pShaderBytecode = cs.data(), .BytecodeLength = cs.size() },
-            .NodeMask       = 0,
-            .CachedPSO      = { .pCachedBlob = nullptr, .CachedBlobSizeInBytes = 0 },
-            .Flags          = D3D12_PIPELINE_STATE_FLAG_NONE
-        };
+        for (uint32_t t = 0; t < count; ++t) {
+            uint32_t mips    = 4 + rng() % 4;
+            uint32_t regions = 1u << (mips - 1);
 
-        if(FAILED(pDevice9->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&pso)))) {
-            throw std::runtime_error("Could not create compute pipeline state object!");
+            coarsestMip[t] = uint8_t(mips);
+            batch.Add(t, regions, regions);
         }
 
-        pCsPipelineState = pso.Detach();
-
-        delQ.Append([cPipelineState = pCsPipelineState] {
-            cPipelineState->Release();
-        });
-    }
-}
+        batch.Pack();
 
-void Harmony::CreateCommandLists() {
-    for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-        if (FAILED(pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&pCommandAllocators[i])))) {
-            throw std::runtime_error("Could not allocate command allocator!");
-        }
-    }
+        const auto& entries = batch.GetEntries();
 
-    ComPtr<ID3D12GraphicsCommandList> cmdList;
-    if (FAILED(pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, pCommandAllocators[0], nullptr, IID_PPV_ARGS(&cmdList)))) {
-        throw std::runtime_error("Could not create command list!");
-    }
+        std::vector<std::vector<uint8_t>> buffers(count);
+        std::vector<std::vector<uint8_t>> residency(count);
+        std::vector<uint8_t>              atlas(batch.GetReadbackSize());
+        uint64_t                          perTextureBytes = 0;
 
-    if (FAILED(cmdList->QueryInterface<ID3D12GraphicsCommandList1>(&pCommandList))) {
-        throw std::runtime_error("Could not query cmdlist1 interface!");
-    }
+        for (const auto& entry : entries) {
+            uint32_t t = entry.texture;
 
-    pCommandList->Close();
+            buffers[t].resize(size_t(pitch) * entry.height);
+            residency[t].resize(size_t(entry.width) * entry.height);
+            perTextureBytes += buffers[t].size();
 
-    delQ.Append([cCommandList = pCommandList, cCommandAllocators = pCommandAllocators] {
-        cCommandList->Release();
+            for (uint32_t y = 0; y < entry.height; ++y) {
+                for (uint32_t x = 0; x < entry.width; ++x) {
+                    uint8_t resident = uint8_t(rng() % (coarsestMip[t] + 1));
+                    uint8_t wanted   = (rng() % 10 == 0) ? uint8_t(rng() % (coarsestMip[t] + 1)) : resident;
 
-        for (UINT i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-            cCommandAllocators[i]->Release();
+                    residency[t][size_t(y) * entry.width + x]                      = resident;
+                    buffers[t][size_t(y) * pitch + x]                              = wanted;
+                    atlas[size_t(entry.y + y) * batch.GetRowPitch() + entry.x + x] = wanted;
+                }
+            }
         }
-    });
-}
 
-void Harmony::CreateSyncObjects() {
-    ComPtr<ID3D12Fence> fence;
+        FeedbackProcessor processor;
+        float             bestUs[2] = { (std::numeric_limits<float>::max)(), (std::numeric_limits<float>::max)() };
+        std::vector<FeedbackProcessor::Request> results[2];
 
-    if (FAILED(pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&fence)))) {
-        throw std::runtime_error("Could not create fence!");
-    }
+        for (int pass = 0; pass < passes; ++pass) {
+            auto begin = steady_clock::now();
 
-    fenceHandle = CreateEventA(nullptr, FALSE, FALSE, "gpuFence");
-    if (!fenceHandle) {
-        throw std::runtime_error("Could not create fence event!");
-    }
+            processor.Begin();
 
-    pFence = fence.Detach();
+            for (uint32_t t = 0; t < count; ++t) {
+                processor.Process(t, buffers[t].data(), pitch, residency[t].data(), entries[t].width, entries[t].height, coarsestMip[t]);
+            }
 
-    delQ.Append([cEvent = fenceHandle, cFence = pFence] {
-        cFence->Release();
-        CloseHandle(cEvent);
-    });
-}
+            bestUs[0] = (std::min)(bestUs[0], duration<float, std::micro>(steady_clock::now() - begin).count());
+            results[0] = processor.GetRequests();
 
-void Harmony::DownloadDataAndGenMips() {
-    ComPtr<ID3D12GraphicsCommandList>   initCmdlist;
-    ComPtr<ID3D12CommandAllocator>      initCmdAllocator;
-    ComPtr<ID3D12Fence>                 initFence;
+            begin = steady_clock::now();
 
-    HRESULT hr;
-    void*   pData = nullptr;
+            processor.Begin();
 
-    hr = pDevice9->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS (&initFence));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create fence!");
-    }
-    
-    hr = pDevice9->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS (&initCmdAllocator));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create command allocator!");
-    }
+            batch.Decode(atlas.data(), [&](const FeedbackBatch::Entry& entry, const uint8_t* pFeedback, size_t feedbackPitch) {
+                processor.Process(entry.texture, pFeedback, feedbackPitch, residency[entry.texture].data(), entry.width, entry.height, coarsestMip[entry.texture]);
+            });
 
-    hr = pDevice9->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, initCmdAllocator.Get (), nullptr, IID_PPV_ARGS (&initCmdlist));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create command list!");
-    }
+            bestUs[1] = (std::min)(bestUs[1], duration<float, std::micro>(steady_clock::now() - begin).count());
+            results[1] = processor.GetRequests();
+        }
+
+        bool match = std::equal(results[0].begin(), results[0].end(), results[1].begin(), results[1].end(),
+            [](const FeedbackProcessor::Request& a, const FeedbackProcessor::Request& b) {
+                return a.texture == b.texture && a.regionX == b.regionX && a.regionY == b.regionY &&
+                       a.mip == b.mip && a.load == b.load && a.priority == b.priority;
+            });
 
-    HANDLE initCompleteEvent = CreateEvent (nullptr, FALSE, FALSE, nullptr);
-    if (initCompleteEvent == NULL) {
-        throw std::runtime_error("Could not create event!");
+        std::cout << "  " << count << " textures, " << results[1].size() << " requests" << (match ? "" : " (MISMATCH)") << std::endl
+                  << "    per texture: " << count << " resolves, " << 2 * count << " barrier batches, " << count << " readback buffers, "
+                  << perTextureBytes / 1024.0 << " KB, decode " << bestUs[0] << " us" << std::endl
+                  << "    batched:     " << count << " resolves, 2 barrier batches, 1 copy, 1 readback buffer, "
+                  << batch.GetReadbackSize() / 1024.0 << " KB (" << batch.GetWidth() << " x " << batch.GetHeight() << " atlas), decode "
+                  << bestUs[1] << " us" << std::endl;
     }
+}
 
-    UINT   rowPitch     = Align(TEXTURE_WIDTH * sizeof(uint32_t), D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
-    UINT64 textureBytes = rowPitch * TEXTURE_HEIGHT;
+//
+// Chunked, compressed assets against plain reads of the same texels: effective GB/s is uncompressed
+// bytes in memory per second. The texture is a smooth gradient with noise and a checker, not as
+// compressible as real albedo but not random either. Every cooked asset starts cold (written
+// unbuffered, loaded direct); warm loads read buffered after the file went through the cache once.
+//
+static void BenchAssets() {
+    using namespace std::chrono;
+
+    const std::string  rawName   = "assets.bench";
+    const std::string  assetName = "assets.sfca";
+    const std::wstring rawPath(rawName.begin(), rawName.end());
+    const std::wstring assetPath(assetName.begin(), assetName.end());
+    const UINT         width     = 8192;
+    const UINT64       size      = UINT64(width) * width * sizeof(UINT);
+    const uint32_t     cores     = (std::max)(std::thread::hardware_concurrency(), 1u);
+
+    uint8_t* pSource = static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    uint8_t* pDest   = static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+    if (!pSource || !pDest) {
+        std::cerr << "Could not allocate asset buffers" << std::endl;
+        return;
+    }
 
-    UINT   meshSize     = sizeof vertices + sizeof indices;
-    UINT64 textureBase  = Align(meshSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    std::mt19937 rng(11);
 
-    UINT64 totalBytes   = textureBase + textureBytes;
+    for (UINT y = 0; y < width; ++y) {
+        UINT* pRow = reinterpret_cast<UINT*>(pSource) + UINT64(y) * width;
 
-    D3D12_SUBRESOURCE_FOOTPRINT subresFP {
-        .Format   = DXGI_FORMAT_R8G8B8A8_UNORM,
-        .Width    = TEXTURE_WIDTH,
-        .Height   = TEXTURE_HEIGHT,
-        .Depth    = 1,
-        .RowPitch = rowPitch
-    };
+        for (UINT x = 0; x < width; ++x) {
+            UINT noise   = rng() & 0x07;
+            UINT checker = (((x / 96) ^ (y / 96)) & 1) ? 0x30 : 0;
+            UINT r       = ((x >> 5) + noise + checker) & 0xFF;
+            UINT g       = ((y >> 5) + noise) & 0xFF;
+            UINT b       = (((x + y) >> 6) + checker) & 0xFF;
 
-    D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedSFP{
-        .Offset    = textureBase,
-        .Footprint = subresFP
-    };
+            pRow[x] = r | (g << 8) | (b << 16) | 0xFF000000;
+        }
+    }
 
-    D3D12_RESOURCE_DESC bufferDesc {
-        .Dimension  = D3D12_RESOURCE_DIMENSION_BUFFER,
-        .Alignment  = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-        .Width      = totalBytes,
-        .Height     = 1,
-        .DepthOrArraySize = 1,
-        .MipLevels  = 1,
-        .Format     = DXGI_FORMAT_UNKNOWN,
-        .SampleDesc = { 1, 0 },
-        .Layout     = D3D12_TEXTURE_LAYOUT_ROW_MAJOR,
-        .Flags      = D3D12_RESOURCE_FLAG_NONE
-    };
+    auto ReadRaw = [&](bool direct) {
+        AsyncFileReader reader;
+        reader.Init(AsyncFileReader::Backend::Native, 32);
 
-    D3D12_HEAP_PROPERTIES uploadHeapProps {
-        .Type                   = D3D12_HEAP_TYPE_UPLOAD,
-        .CPUPageProperty        = D3D12_CPU_PAGE_PROPERTY_UNKNOWN,
-        .MemoryPoolPreference   = D3D12_MEMORY_POOL_UNKNOWN,
-        .CreationNodeMask       = 0,
-        .VisibleNodeMask        = 0
-    };
+        uint32_t file = reader.Open(rawPath, direct);
+        bool     ok   = file != AsyncFileReader::INVALID_FILE;
 
-    hr = pDevice9->CreateCommittedResource(&uploadHeapProps, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pUploadBuffer));
-    if (FAILED(hr)) {
-        throw std::runtime_error("Could not create upload buffer!");
-    }
+        for (UINT64 offset = 0; ok && offset < size; offset += 1 << 20) {
+            reader.Read(file, offset, 1 << 20, pDest + offset, [&ok](bool readOk, const uint8_t*, UINT64) {
+                ok &= readOk;
+            });
+        }
 
-    if (FAILED(pUploadBuffer->Map(0, 0, &pData)) || pData == nullptr) {
-        throw std::runtime_error("Could not map upload buffer!");
-    }
+        reader.WaitIdle();
+        reader.Destroy();
+        return ok;
+    };
 
-    char* px = reinterpret_cast<char*>(pData);
+    auto LoadAsset = [&](const ChunkedAsset& asset, uint32_t threads, bool direct, bool shuffle) {
+        AsyncFileReader reader;
+        JobSystem       jobSystem;
+        ChunkLoader     loader;
 
-    memcpy_s(px, sizeof vertices, vertices, sizeof vertices);
-    px += sizeof vertices;
+        reader.Init(AsyncFileReader::Backend::Native, 32);
+        jobSystem.Init(threads);
+        loader.Init(&reader, &jobSystem);
 
-    memcpy_s(px, sizeof indices, indices, sizeof indices);
-    
-    {
-        px = reinterpret_cast<char*>(pData) + textureBase;
+        std::vector<ChunkLoader::Target> targets;
 
-        for (UINT i = 0; i < TEXTURE_HEIGHT; ++i) {
-            UINT* pRow = reinterpret_cast<UINT*>(px) + (i * TEXTURE_WIDTH);
+        for (uint32_t i = 0; i < asset.GetChunks().size(); ++i) {
+            targets.push_back({ i, pDest + asset.GetChunks()[i].rawOffset });
+        }
 
-            for (UINT j = 0; j < TEXTURE_HEIGHT; ++j) {
-                if (((j / 96) % 2) == 0)
-                {
-                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0F0F0FFF : 0x0;
-                }
-                else
-                {
-                    pRow[j] = (((i / 96) % 2) == 0) ? 0x0 : 0x0F0F0FFF;
-                }
-            }
+        if (shuffle) {
+            std::shuffle(targets.begin(), targets.end(), std::mt19937(7));
         }
-    }
 
-    pUploadBuffer->Unmap(0, nullptr);
-    
-    // copy all
-    initCmdlist->CopyBufferRegion(pVertexBuffer, 0, pUploadBuffer, 0, sizeof vertices);
-    initCmdlist->CopyBufferRegion(pIndexBuffer, 0, pUploadBuffer, sizeof vertices, sizeof indices);
+        uint32_t file = reader.Open(asset.GetPath(), direct);
+        bool     ok   = file != AsyncFileReader::INVALID_FILE && loader.Load(asset, file, targets);
 
-    {
-        D3D12_TEXTURE_COPY_LOCATION dstLoc{
-            .pResource        = pTexture,
-            .Type             = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX,
-            .SubresourceIndex = 0,
-        };
+        reader.WaitIdle();
+        loader.Destroy();
+        jobSystem.Destroy();
+        reader.Destroy();
+        return ok;
+    };
 
-        D3D12_TEXTURE_COPY_LOCATION srcLoc{
-            .pResource       = pUploadBuffer,
-            .Type            = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT,
-            .PlacedFootprint = placedSFP
-        };
+    // GB/s of one run, negative if it failed or the data doesn't match
+    auto Measure = [&](const std::function<bool()>& run) {
+        memset(pDest, 0, size);
 
-        initCmdlist->CopyTextureRegion(&dstLoc, 0, 0, 0, &srcLoc, nullptr);
-    }
-    
-    //
-    // Transition resources to thier next OPs
-    //
+        auto begin = steady_clock::now();
+        bool ok    = run();
+        auto end   = steady_clock::now();
 
-    D3D12_RESOURCE_BARRIER barrierIB {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pIndexBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_INDEX_BUFFER,
+        if (!ok || memcmp(pSource, pDest, size) != 0) {
+            return -1.0;
         }
+
+        return (size / double(1 << 30)) / duration<double>(end - begin).count();
     };
 
-    D3D12_RESOURCE_BARRIER barrierVB {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pVertexBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+    auto WriteRaw = [&] {
+        HANDLE file = CreateFileW(rawPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, nullptr);
+
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        const DWORD chunk = 8 << 20;
+        bool        ok    = true;
+
+        for (UINT64 offset = 0; offset < size && ok; offset += chunk) {
+            DWORD written = 0;
+            ok = WriteFile(file, pSource + offset, chunk, &written, nullptr) && written == chunk;
         }
+
+        CloseHandle(file);
+        return ok;
     };
 
-    D3D12_RESOURCE_BARRIER barrierTex {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pTexture,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COPY_DEST,
-            .StateAfter  = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,   // to Gen Mips
+    auto Print = [](double gbs) {
+        if (gbs < 0.0) {
+            std::cout << "FAILED";
+        }
+        else {
+            std::cout << gbs;
         }
     };
-    
-    D3D12_RESOURCE_BARRIER barriers[] = { barrierIB, barrierVB, barrierTex };
-    initCmdlist->ResourceBarrier(3, barriers);
 
-    //
-    // Generate texture mip maps
-    //
+    std::cout << "Assets: " << (size >> 20) << " MB texture, effective GB/s, " << cores << " cores" << std::endl;
 
-    D3D12_RESOURCE_DESC tdesc = pTexture->GetDesc();
+    if (WriteRaw()) {
+        std::cout << "  uncompressed: cold ";
+        Print(Measure([&] { return ReadRaw(true); }));
+        ReadRaw(false);
+        std::cout << ", warm ";
+        Print(Measure([&] { return ReadRaw(false); }));
+        std::cout << std::endl;
+    }
+    else {
+        std::cerr << "Could not write " << rawName << std::endl;
+    }
 
-    D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc {
-        .Format                  = tdesc.Format,
-        .ViewDimension           = D3D12_SRV_DIMENSION_TEXTURE2D,
-        .Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING,
-        .Texture2D               = { .MostDetailedMip = 0, .MipLevels = 1, .PlaneSlice = 0, .ResourceMinLODClamp = 0.0f }
-    };
-    
-    D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc {
-        .Format                  = tdesc.Format,
-        .ViewDimension           = D3D12_UAV_DIMENSION_TEXTURE2D,
-        .Texture2D               = { .MipSlice = 0, .PlaneSlice = 0 }
+    struct Format {
+        const char* name;
+        uint32_t    algorithm;
+        uint32_t    chunkSize;
     };
-    
-    initCmdlist->SetComputeRootSignature(pCsRootSignature);
-    initCmdlist->SetPipelineState(pCsPipelineState);
-    
-    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
 
-    initCmdlist->SetDescriptorHeaps(2, pDescHeaps);
+    const Format formats[] = {
+        { "xpress 64 KB",       COMPRESS_ALGORITHM_XPRESS,      64 * 1024 },
+        { "xpress huff 64 KB",  COMPRESS_ALGORITHM_XPRESS_HUFF, 64 * 1024 },
+        { "xpress huff 256 KB", COMPRESS_ALGORITHM_XPRESS_HUFF, 256 * 1024 },
+    };
 
-    {
-        D3D12_CPU_DESCRIPTOR_HANDLE srvHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
+    std::vector<uint32_t> threadCounts = { 1, 2, 4 };
 
-        D3D12_CPU_DESCRIPTOR_HANDLE uavHandle = pSrvHeap->GetCPUDescriptorHandleForHeapStart();
-        D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
-        
-        //
-        // Srv = 0, feedback UAV = 1, use rest 
-        //
-        UINT mipgenSrvHeapOffset = 2;
+    if (cores > 4) {
+        threadCounts.push_back(cores);
+    }
 
-        D3D12_RESOURCE_BARRIER uavBarrier {
-            .Type  = D3D12_RESOURCE_BARRIER_TYPE_UAV,
-            .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-            .UAV   = pTexture
-        };
+    for (const auto& format : formats) {
+        auto cookBegin = steady_clock::now();
+        bool cooked    = ChunkedAsset::Write(assetPath, pSource, size, format.chunkSize, format.algorithm);
+        auto cookEnd   = steady_clock::now();
 
-        union FloatAsInt {
-            UINT  u;
-            FLOAT f;
+        ChunkedAsset asset;
 
-            explicit FloatAsInt(float val)
-                : f(val)
-            {}
-        };
+        if (!cooked || !asset.Open(assetPath)) {
+            std::cerr << "Could not cook " << assetName << std::endl;
+            continue;
+        }
 
-        // set sampler state in root once
-        initCmdlist->SetComputeRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+        UINT64 stored = 0;
 
-        for (UINT16 i = 0; i < (tdesc.MipLevels - 1); ++i) {
-            UINT dstWidth  = TEXTURE_WIDTH  >> (i + 1);
-            UINT dstHeight = TEXTURE_HEIGHT >> (i + 1);
+        for (const auto& chunk : asset.GetChunks()) {
+            stored += chunk.storedSize;
+        }
 
-            SIZE_T bytesToSrv = (mipgenSrvHeapOffset + i) * srvDescriptorSize;
+        std::cout << "  " << format.name << ": " << double(size) / stored << ":1, cooked at "
+                  << (size >> 20) / duration<double>(cookEnd - cookBegin).count() << " MB/s, cold ";
 
-            srvHandle.ptr += bytesToSrv;
-            srvGpuHandle.ptr += bytesToSrv;
+        Print(Measure([&] { return LoadAsset(asset, cores, true, false); }));
 
-            SIZE_T bytesToUav = (mipgenSrvHeapOffset + i + 1) * srvDescriptorSize;
+        std::cout << " (" << cores << " threads), warm";
 
-            uavHandle.ptr += bytesToUav;
-            uavGpuHandle.ptr += bytesToUav;
+        LoadAsset(asset, cores, false, false);
 
-            srvDesc.Texture2D.MostDetailedMip = i;
-            pDevice9->CreateShaderResourceView(pTexture, &srvDesc, srvHandle);
+        for (uint32_t threads : threadCounts) {
+            std::cout << " " << threads << "t ";
+            Print(Measure([&] { return LoadAsset(asset, threads, false, false); }));
+        }
 
-            uavDesc.Texture2D.MipSlice = i + 1;
-            pDevice9->CreateUnorderedAccessView(pTexture, nullptr, &uavDesc, uavHandle);
+        // every chunk on its own, in random order: what streamed tiles see
+        std::cout << ", random chunks ";
+        Print(Measure([&] { return LoadAsset(asset, cores, false, true); }));
+        std::cout << std::endl;
+    }
 
-            UINT rootConstData[2] = { FloatAsInt(1.0f / dstWidth).u, FloatAsInt(1.0f / dstHeight).u };
+    DeleteFileW(rawPath.c_str());
+    DeleteFileW(assetPath.c_str());
 
-            initCmdlist->SetComputeRoot32BitConstants(0, 2, rootConstData, 0);
-            initCmdlist->SetComputeRootDescriptorTable(1, srvGpuHandle);
-            initCmdlist->SetComputeRootDescriptorTable(2, uavGpuHandle);
-            
-            UINT dispatchX = max(dstWidth  / 8, 1u);
-            UINT dispatchY = max(dstHeight / 8, 1u);
+    VirtualFree(pSource, 0, MEM_RELEASE);
+    VirtualFree(pDest, 0, MEM_RELEASE);
+}
 
-            initCmdlist->Dispatch(dispatchX, dispatchY, 1);
+//
+// Coroutine costs and concurrency. Await overhead is per co_await, each kind on its own: a Yield()
+// round trip through Poll(), a Fence() that's already reached, a nested Task, a 4 KB FileRead()
+// the file cache serves (issued, completed and resumed by Poll()), and a hop onto a worker and back. Concurrency runs texture-load shaped tasks (decode on a worker, upload on the
+// frame thread, GPU work awaited on a simulated fence, bake on a worker) against a frame loop that
+// polls once a millisecond, and reports how many loads overlapped and what Poll() cost the frame.
+//
+namespace CoroutineBench {
 
-            initCmdlist->ResourceBarrier(1, &uavBarrier);
-        }
+struct SimulatedFence
+{
+    SimulatedGpu* pGpu;
+    uint32_t      queue;
 
-        barrierTex.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-        barrierTex.Transition.StateAfter  = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+    UINT64 GetCompletedValue() {
+        return pGpu->CompletedValue(queue);
+    }
+};
 
-        initCmdlist->ResourceBarrier(1, &barrierTex);
+struct AlwaysReached
+{
+    UINT64 GetCompletedValue() {
+        return ~0ull;
     }
-    
-    initCmdlist->Close();
+};
 
-    ID3D12CommandList* commandLists[] = { initCmdlist.Get() };
-    pCommandQueue->ExecuteCommandLists(1, commandLists);
-    pCommandQueue->Signal(initFence.Get(), 1);
+static void Spin(std::chrono::microseconds duration) {
+    auto until = std::chrono::steady_clock::now() + duration;
 
-    WaitForFence(initFence.Get(), 1, initCompleteEvent);
-    initCmdAllocator->Reset();
-    CloseHandle(initCompleteEvent);
+    while (std::chrono::steady_clock::now() < until) {}
 }
 
-#pragma endregion
+static Task Yields(CoroutineExecutor& executor, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        co_await executor.Yield();
+    }
+}
 
-#pragma region Misc
+static Task ReachedFences(CoroutineExecutor& executor, uint32_t count) {
+    AlwaysReached fence;
 
-LRESULT Harmony::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
-    Harmony* pApp = reinterpret_cast<Harmony*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+    for (uint32_t i = 0; i < count; ++i) {
+        co_await executor.Fence(&fence, i);
+    }
+}
 
-    switch (msg) {
-    case WM_CLOSE:
-    case WM_DESTROY:
-        PostQuitMessage(0);         // close the application entirely
-        return 0;
+static Task Empty() {
+    co_return;
+}
 
-    case WM_SIZE:
-        if (pApp) {
-            pApp->Resize();
+static Task Nested(uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        co_await Empty();
+    }
+}
+
+static Task FileReads(CoroutineExecutor& executor, uint32_t file, uint8_t* pBuffer, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        auto read = co_await executor.FileRead(file, (i % 16) * 4096ull, 4096, pBuffer);
+
+        if (!read.ok) {
+            throw std::runtime_error("Could not read coroutines.bench!");
         }
-        return 0;
     }
+}
 
-    return DefWindowProc(hWnd, msg, wParam, lParam);
+static Task Hops(CoroutineExecutor& executor, JobSystem& jobSystem, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        co_await jobSystem.Schedule();
+        co_await executor.Yield();
+    }
 }
 
-#pragma endregion
+struct LoadTimes
+{
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+};
 
-#pragma region Rendering
+static Task Load(CoroutineExecutor& executor, JobSystem& jobSystem, SimulatedGpu& gpu, SimulatedFence& fence, UINT64& nextValue, LoadTimes& times) {
+    using namespace std::chrono;
 
-void Harmony::Render() {
-    UpdateUbo();
-    PopulateCommandList();
+    times.begin = steady_clock::now();
 
-    ID3D12CommandList* ppCmdLists[] = { pCommandList };
-    pCommandQueue->ExecuteCommandLists(1, ppCmdLists);
+    co_await jobSystem.Schedule();
+    Spin(microseconds(2000));                           // decode
 
-    pSwapChain4->Present(1, 0);
+    co_await executor.Yield();
+    Spin(microseconds(100));                            // stage the upload
 
-    MoveToNextFrame();
-}
+    UINT64 value = ++nextValue;
 
-void Harmony::UpdateUbo() {
-    static auto epoch = std::chrono::high_resolution_clock::now();
+    gpu.Submit(fence.queue, microseconds(1500));        // copy and mipgen
+    gpu.Signal(fence.queue, value);
 
-    auto current = std::chrono::high_resolution_clock::now();
-    float time   = std::chrono::duration<float, std::chrono::seconds::period>( current - epoch ).count();
+    co_await executor.Fence(&fence, value);
+    co_await jobSystem.Schedule();
+    Spin(microseconds(500));                            // bake
 
-    const XMVECTOR Eye = XMVectorSet( 0.0f,  0.75f, -1.5f, 0.0f );
-    const XMVECTOR At  = XMVectorSet( 0.0f,  0.0f,  0.0f, 0.0f );
-    const XMVECTOR Up  = XMVectorSet( 0.0f,  1.0f,  0.0f, 0.0f );
+    co_await executor.Yield();
 
-    float yDisplacement = (sin(time * 5) * 0.25f) - 0.25f;
+    times.end = steady_clock::now();
+}
 
-    XMMATRIX  world      = XMMatrixRotationY(time * XMConvertToRadians(90.0f));
-    world *= XMMatrixTranslation(0.0f, yDisplacement, 0.0f);
+}
 
-    float scaleValue     = (sin(time) * 0.5f) + 0.5f;
-    world *= XMMatrixScaling(scaleValue, scaleValue, scaleValue);
+static void BenchCoroutines() {
+    using namespace std::chrono;
+    using namespace CoroutineBench;
 
-    XMMATRIX  view       = XMMatrixLookAtLH( Eye, At, Up );
-    XMMATRIX  projection = XMMatrixPerspectiveFovLH(70, WINDOW_WIDTH / float(WINDOW_HEIGHT), 0.1f, 20.0f);
-    
-    void* pData = nullptr;
-    if (FAILED(pConstantBuffer->Map(0, nullptr, &pData)) || pData == nullptr) {
-        throw std::runtime_error("Could not map CB!");
-    }
+    const uint32_t cores = (std::max)(std::thread::hardware_concurrency(), 1u);
 
-    UniformBuffer ubo;
-    ubo.mvp = world * view * projection;
+    JobSystem jobSystem;
+    jobSystem.Init((std::max)(cores, 2u) - 1);
 
-    uint8_t* pBytePtr = ((uint8_t*)pData) + frameIndex * sizeof(UniformBuffer);
+    CoroutineExecutor executor;
+    executor.Init(nullptr);
 
-    memcpy_s(pBytePtr, sizeof(XMMATRIX), &ubo.mvp, sizeof(XMMATRIX));
-    
-    pConstantBuffer->Unmap(0, nullptr);
-}
+    // reads go through an executor of their own, so the other awaits don't pay for polling the reader
+    AsyncFileReader   fileReader;
+    CoroutineExecutor fileExecutor;
 
-void Harmony::PopulateCommandList() {
-    pCommandAllocators[frameIndex]->Reset();
-    pCommandList->Reset(pCommandAllocators[frameIndex], pPipelineState);
+    fileReader.Init(AsyncFileReader::Backend::Native, 32);
+    fileExecutor.Init(&fileReader);
 
-    pCommandList->SetGraphicsRootSignature(pRootSignature);
+    auto RunToEnd = [&](CoroutineExecutor& runner, Task&& task) {
+        auto begin = steady_clock::now();
 
-    D3D12_RESOURCE_BARRIER rtBarrier {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pRenderTargets[frameIndex],
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_PRESENT,
-            .StateAfter  = D3D12_RESOURCE_STATE_RENDER_TARGET,
-        }
-    };
-    D3D12_RESOURCE_BARRIER dsBarrier {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pDepthBuffer,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_COMMON,
-            .StateAfter  = D3D12_RESOURCE_STATE_DEPTH_WRITE,
+        runner.Spawn(std::move(task));
+
+        while (runner.GetActiveTasks() > 0) {
+            runner.Poll();
         }
+
+        return duration<double, std::nano>(steady_clock::now() - begin).count();
     };
 
-    // PRESENT -> RT barriers
+    const uint32_t awaits = 1 << 20;
+
+    std::cout << "Coroutines: " << cores << " cores, ns per await" << std::endl;
+    std::cout << "  yield round trip:    " << RunToEnd(executor, Yields(executor, awaits)) / awaits << std::endl;
+    std::cout << "  fence, reached:      " << RunToEnd(executor, ReachedFences(executor, awaits)) / awaits << std::endl;
+    std::cout << "  nested task:         " << RunToEnd(executor, Nested(awaits)) / awaits << std::endl;
+
     {
-        D3D12_RESOURCE_BARRIER barriersIn[] = { rtBarrier, dsBarrier };
-        pCommandList->ResourceBarrier(2, barriersIn);
-    }
+        const std::string  name = "coroutines.bench";
+        const std::wstring path(name.begin(), name.end());
 
-    D3D12_CPU_DESCRIPTOR_HANDLE rtHandle = static_cast<D3D12_CPU_DESCRIPTOR_HANDLE>(pRtvHeap->GetCPUDescriptorHandleForHeapStart().ptr + frameIndex * rtvDescriptorSize);
-    D3D12_CPU_DESCRIPTOR_HANDLE dsHandle = pDsvHeap->GetCPUDescriptorHandleForHeapStart();
-  
-    pCommandList->OMSetRenderTargets(1, &rtHandle, FALSE, &dsHandle);
-    pCommandList->RSSetViewports(1, &viewport);
-    pCommandList->RSSetScissorRects(1, &scissorRect);
+        std::vector<char> contents(16 * 4096, 'x');
+        std::ofstream(name, std::ios::out | std::ios::binary).write(contents.data(), std::streamsize(contents.size()));
 
-    ID3D12DescriptorHeap* pDescHeaps[2] = { pSrvHeap, pSmpHeap };
-    pCommandList->SetDescriptorHeaps(2, pDescHeaps);
+        uint8_t* pBuffer = static_cast<uint8_t*>(VirtualAlloc(nullptr, 4096, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        uint32_t file    = fileReader.Open(path, false);
 
-    //
-    // clear RT & depth
-    //
-    const float clearColor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    pCommandList->ClearRenderTargetView(rtHandle, clearColor, 0, nullptr);
-    pCommandList->ClearDepthStencilView(dsHandle, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-    pCommandList->IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY::D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        if (pBuffer && file != AsyncFileReader::INVALID_FILE) {
+            std::cout << "  file read, cached:   " << RunToEnd(fileExecutor, FileReads(fileExecutor, file, pBuffer, awaits / 64)) / (awaits / 64) << std::endl;
+        }
+
+        if (file != AsyncFileReader::INVALID_FILE) {
+            fileReader.Close(file);
+        }
+
+        if (pBuffer) {
+            VirtualFree(pBuffer, 0, MEM_RELEASE);
+        }
+
+        DeleteFileW(path.c_str());
+    }
+
+    std::cout << "  worker and back:     " << RunToEnd(executor, Hops(executor, jobSystem, awaits / 256)) / (awaits / 256) << std::endl;
 
     //
-    // Clear feedback
+    // Concurrency
     //
-    D3D12_CPU_DESCRIPTOR_HANDLE fbCpuHandle = pUavHeap->GetCPUDescriptorHandleForHeapStart();
-    D3D12_GPU_DESCRIPTOR_HANDLE fbGpuHandle = static_cast<D3D12_GPU_DESCRIPTOR_HANDLE>(pSrvHeap->GetGPUDescriptorHandleForHeapStart().ptr + srvDescriptorSize);
+    for (uint32_t loads : { 1u, 16u, 64u }) {
+        SimulatedGpu           gpu;
+        SimulatedFence         fence { &gpu, 0 };
+        UINT64                 nextValue = 0;
+        std::vector<LoadTimes> times(loads);
 
-    const UINT clearValue[] = { 0, 0, 0, 0 }; // NB: values are ignored
-    pCommandList->ClearUnorderedAccessViewUint(fbGpuHandle, fbCpuHandle, pFeedbackTexture, clearValue, 0, nullptr);
+        auto begin = steady_clock::now();
 
-    D3D12_INDEX_BUFFER_VIEW ibv {
-        pIndexBuffer->GetGPUVirtualAddress(),
-        sizeof indices,
-        DXGI_FORMAT_R32_UINT,
-    };
+        for (uint32_t i = 0; i < loads; ++i) {
+            executor.Spawn(Load(executor, jobSystem, gpu, fence, nextValue, times[i]));
+        }
 
-    D3D12_VERTEX_BUFFER_VIEW vbv{
-        pVertexBuffer->GetGPUVirtualAddress(),
-        sizeof vertices,
-        sizeof Vertex
-    };
+        double   maxPollMs   = 0.0;
+        double   totalPollMs = 0.0;
+        uint32_t frames      = 0;
 
-    pCommandList->IASetIndexBuffer(&ibv);
-    pCommandList->IASetVertexBuffers(0, 1, &vbv);
+        while (executor.GetActiveTasks() > 0) {
+            auto pollBegin = steady_clock::now();
+            executor.Poll();
+            double pollMs = duration<double, std::milli>(steady_clock::now() - pollBegin).count();
 
-    D3D12_GPU_DESCRIPTOR_HANDLE srvGpuHandle = pSrvHeap->GetGPUDescriptorHandleForHeapStart();
-    D3D12_GPU_DESCRIPTOR_HANDLE uavGpuHandle = { srvGpuHandle.ptr + srvDescriptorSize };
+            maxPollMs    = (std::max)(maxPollMs, pollMs);
+            totalPollMs += pollMs;
+            frames      += 1;
 
-    pCommandList->SetGraphicsRootConstantBufferView(0, pConstantBuffer->GetGPUVirtualAddress() + frameIndex * sizeof(UniformBuffer) );
-    pCommandList->SetGraphicsRootDescriptorTable(1, srvGpuHandle);
-    pCommandList->SetGraphicsRootDescriptorTable(2, uavGpuHandle);
-    pCommandList->SetGraphicsRootDescriptorTable(3, pSmpHeap->GetGPUDescriptorHandleForHeapStart());
+            SimulatedGpu::SpinUntil(pollBegin + milliseconds(1));
+        }
 
-    pCommandList->DrawIndexedInstanced(12, 1, 0, 0, 0);
+        double wallMs = duration<double, std::milli>(steady_clock::now() - begin).count();
+        double busyMs = 0.0;
 
-    // transition feedback resource from UNORDERED_ACCESS to RESOLVE_SOURCE
-    D3D12_RESOURCE_BARRIER rsBarrier {
-        .Type  = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION,
-        .Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE,
-        .Transition = {
-            .pResource   = pFeedbackTexture,
-            .Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES,
-            .StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
-            .StateAfter  = D3D12_RESOURCE_STATE_RESOLVE_SOURCE,
+        for (const auto& load : times) {
+            busyMs += duration<double, std::milli>(load.end - load.begin).count();
         }
-    };
-    pCommandList->ResourceBarrier(1, &rsBarrier);
-    
-    // resolve the feedback directly to host readable resource (buffer)
-    pCommandList->ResolveSubresourceRegion(pFeedbackBuffer,
-        0,                  // decode target only has 1 layer (or is a buffer)
-        0, 0,               // no offsets
-        pFeedbackTexture,
-        UINT_MAX,           // decode all src subresources
-        nullptr,
-        DXGI_FORMAT_R8_UINT, // target format must be R8_UINT
-        D3D12_RESOLVE_MODE_DECODE_SAMPLER_FEEDBACK // resolve feedback mode
-    );
-
-    // RT -> Present barriers, feedback RESOURCE_SRC -> UAV
-    {
-        std::swap(dsBarrier.Transition.StateBefore, dsBarrier.Transition.StateAfter);
-        std::swap(rtBarrier.Transition.StateBefore, rtBarrier.Transition.StateAfter);
-        std::swap(rsBarrier.Transition.StateBefore, rsBarrier.Transition.StateAfter);
 
-        D3D12_RESOURCE_BARRIER barriersOut[] = { rtBarrier, dsBarrier, rsBarrier };
-        pCommandList->ResourceBarrier(3, barriersOut);
+        // a load alone: 2 + 0.1 + 1.5 + 0.5 ms of work, plus the frames it waits for
+        std::cout << "  " << loads << " loads: " << wallMs << " ms (" << loads * 4.1 << " ms of work), " << busyMs / wallMs
+                  << " in flight on average, Poll avg " << totalPollMs / frames << " ms max " << maxPollMs << " ms" << std::endl;
     }
 
-    pCommandList->Close();
+    executor.ReportStats(true);
+    executor.Destroy();
+    fileExecutor.Destroy();
+    fileReader.Destroy();
+    jobSystem.Destroy();
 }
 
-void Harmony::MoveToNextFrame(bool singlestep) {
-    auto curFenceVal = fenceValues[frameIndex];
-
-    // signal in cmd queue
-    pCommandQueue->Signal(pFence, curFenceVal);
+static bool RunBenchmark(const Settings& settings) {
+    const std::string& name = settings.bench;
 
-    // move frame index
-    if (!singlestep)
-    {
-        // move first, then wait if GPU isn't done on that frame 
-        frameIndex = pSwapChain4->GetCurrentBackBufferIndex();
-
-        if (pFence->GetCompletedValue() < fenceValues[frameIndex]) {
-            pFence->SetEventOnCompletion(fenceValues[frameIndex], fenceHandle);
-
-            WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
-        }
+    if (name == "feedback") {
+        BenchFeedback();
+        return true;
     }
-    else {
-        // wait first then move 
-        if (pFence->GetCompletedValue() < fenceValues[frameIndex]) {
-            pFence->SetEventOnCompletion(fenceValues[frameIndex], fenceHandle);
 
-            WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
-        }
+    if (name == "minmip") {
+        BenchMinMip();
+        return true;
+    }
 
-        frameIndex = pSwapChain4->GetCurrentBackBufferIndex();
+    if (name == "feedbackrate") {
+        BenchFeedbackRate();
+        return true;
     }
 
-    fenceValues[frameIndex] = curFenceVal + 1;
-}
+    if (name == "feedbackbatch") {
+        BenchFeedbackBatch();
+        return true;
+    }
 
-void Harmony::WaitForGpu() {
-    pCommandQueue->Signal(pFence, fenceValues[frameIndex]);
+    if (name == "assets") {
+        BenchAssets();
+        return true;
+    }
 
-    pFence->SetEventOnCompletion(fenceValues[frameIndex], fenceHandle);
-    WaitForSingleObjectEx(fenceHandle, INFINITE, FALSE);
+    if (name == "coroutines") {
+        BenchCoroutines();
+        return true;
+    }
 
-    fenceValues[frameIndex] += 1;
+    std::cerr << "Unknown benchmark: " << name << std::endl;
+    return false;
 }
 
 #pragma endregion
@@ -1826,14 +5911,94 @@ static void MakeConsole() {
     freopen_s(&fDummy, "CONOUT$", "w", stdout);
 }
 
+static Settings ParseSettings(int argc, char* argv[]) {
+    Settings settings;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        if (arg.rfind("--frames=", 0) == 0) {
+            settings.framesInFlight = static_cast<uint32_t>(strtoul(arg.c_str() + 9, nullptr, 10));
+        }
+        else if (arg.rfind("--latency=", 0) == 0) {
+            settings.maxLatency = static_cast<uint32_t>(strtoul(arg.c_str() + 10, nullptr, 10));
+        }
+        else if (arg == "--present=vsync") {
+            settings.presentMode = PresentMode::Vsync;
+        }
+        else if (arg == "--present=uncapped") {
+            settings.presentMode = PresentMode::Uncapped;
+        }
+        else if (arg == "--present=tearing") {
+            settings.presentMode = PresentMode::Tearing;
+        }
+        else if (arg == "--pacing=none") {
+            settings.pacing = FramePacer::Policy::None;
+        }
+        else if (arg == "--pacing=deadline") {
+            settings.pacing = FramePacer::Policy::SleepToDeadline;
+        }
+        else if (arg == "--readback=ring") {
+            settings.syncReadback = false;
+        }
+        else if (arg == "--readback=sync") {
+            settings.syncReadback = true;
+        }
+        else if (arg.rfind("--tilepool=", 0) == 0) {
+            settings.tilePool = static_cast<uint32_t>(strtoul(arg.c_str() + 11, nullptr, 10));
+        }
+        else if (arg.rfind("--tileloads=", 0) == 0) {
+            settings.loadsPerUpdate = static_cast<uint32_t>(strtoul(arg.c_str() + 12, nullptr, 10));
+        }
+        else if (arg.rfind("--tilebytes=", 0) == 0) {
+            settings.tileBytes = strtoull(arg.c_str() + 12, nullptr, 10) * 1024;
+        }
+        else if (arg.rfind("--feedback-rate=", 0) == 0) {
+            settings.feedbackRate = static_cast<uint32_t>(strtoul(arg.c_str() + 16, nullptr, 10));
+        }
+        else if (arg.rfind("--feedback-interval=", 0) == 0) {
+            settings.feedbackInterval = static_cast<uint32_t>(strtoul(arg.c_str() + 20, nullptr, 10));
+        }
+        else if (arg == "--aggregate=raw") {
+            settings.aggregation = FeedbackAggregator::RAW;
+        }
+        else if (arg == "--aggregate=hysteresis") {
+            settings.aggregation = FeedbackAggregator::HYSTERESIS;
+        }
+        else if (arg.rfind("--simhz=", 0) == 0) {
+            settings.simulationHz = (std::max)(static_cast<uint32_t>(strtoul(arg.c_str() + 8, nullptr, 10)), 1u);
+        }
+        else if (arg.rfind("--trace=", 0) == 0) {
+            settings.trace = arg.substr(8);
+        }
+        else if (arg.rfind("--asset=", 0) == 0) {
+            settings.asset = arg.substr(8);
+        }
+        else if (arg.rfind("--bench=", 0) == 0) {
+            settings.bench = arg.substr(8);
+        }
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+        }
+    }
+
+    return settings;
+}
+
 int main(int argc, char* argv[]) {
     HINSTANCE instance = NULL;
 
     MakeConsole();
 
+    Settings settings = ParseSettings(argc, argv);
+
+    if (!settings.bench.empty()) {
+        return RunBenchmark(settings) ? 0 : -1;
+    }
+
     Harmony app;
 
-    if (!app.Init(instance)) {
+    if (!app.Init(instance, settings)) {
         std::cerr << "App::Init failed!" << std::endl;
         return -1;
     }
@@ -31,18 +31,44 @@ VsOutput VsMain(VsInput v)
 }
 
 Texture2D<float4>                           colorTexture  : register(t0);
+Texture2D<uint>                             minMipMap     : register(t1);
 SamplerState                                colorSampler  : register(s0);
 FeedbackTexture2D<SAMPLER_FEEDBACK_MIN_MIP> colorFeedback : register(u0);
 
 float4 PsMain(VsOutput vo) : SV_Target
 {
-    float4 tex = colorTexture.Sample(colorSampler, vo.uv);
+    // one texel per mip region: finest mip resident there, never sample finer
+    uint2 regions;
+    minMipMap.GetDimensions(regions.x, regions.y);
+
+    uint2 region = min(uint2(vo.uv * regions), regions - 1);
+
+    float4 tex = colorTexture.Sample(colorSampler, vo.uv, int2(0, 0), float(minMipMap[region]));
     return tex + float4(vo.color, 1.0f);
 }
 
+struct FeedbackRate
+{
+    uint rate;      // 1/rate of the pixels write feedback, power of two up to 16
+    uint phase;     // advances every feedback frame, rate frames cover every pixel once
+};
+
+ConstantBuffer<FeedbackRate> fbRate : register(b1);
+
+// 4x4 ordered dither, keep in sync with FeedbackRateController::DITHER
+static const uint dither[16] = { 0, 8, 2, 10, 12, 4, 14, 6, 3, 11, 1, 9, 15, 7, 13, 5 };
+
 float4 PsFeedback(VsOutput vo) : SV_Target
 {
-    colorFeedback.WriteSamplerFeedback(colorTexture, colorSampler, vo.uv);
+    // derivatives outside the branch, neighbouring pixels in the quad may not take it
+    float2 dx = ddx(vo.uv);
+    float2 dy = ddy(vo.uv);
+
+    uint2 cell = uint2(vo.position.xy) & 3;
+
+    if (((dither[cell.y * 4 + cell.x] + fbRate.phase) & (fbRate.rate - 1)) == 0) {
+        colorFeedback.WriteSamplerFeedbackGrad(colorTexture, colorSampler, vo.uv, dx, dy);
+    }
     
     return PsMain(vo);
 }
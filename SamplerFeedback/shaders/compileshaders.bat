@@ -4,4 +4,6 @@
 
 "c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T ps_6_6 -E PsFeedback -Fo ps.bin Shaders.hlsl
 
+"c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T ps_6_6 -E PsMain -Fo psmain.bin Shaders.hlsl
+
 "c:\Program Files (x86)\Windows Kits\10\bin\10.0.22621.0\x64\dxc.exe" -T cs_6_6 -E GenMips -Fo mipgen.bin Mipgen.hlsl